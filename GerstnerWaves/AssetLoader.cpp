@@ -0,0 +1,430 @@
+﻿#include "AssetLoader.h"
+#include "AssetPackage.h"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+
+struct AssetLoader::Request
+{
+	std::string key;
+	std::string type;
+	std::wstring fileName;
+	std::atomic<State> state;
+	std::atomic<AssetLoader*> pLoader;		// 完成后置为nullptr
+	int priority;
+	uint64_t queuedSequence;				// 最近一次入队的序号，出队后(阶段执行中)为0
+	int refCount;							// 尚未取消的句柄数目
+
+	// 读取的数据，view指向资源包的映射内存或buffer
+	AssetView view;
+	std::vector<uint8_t> buffer;
+	std::shared_ptr<void> decoded;
+	std::shared_ptr<void> result;
+};
+
+namespace
+{
+	bool IsDoneState(AssetLoader::State state)
+	{
+		return state == AssetLoader::State::Ready || state == AssetLoader::State::Failed ||
+			state == AssetLoader::State::Canceled;
+	}
+
+	bool ReadLooseFile(const std::wstring& fileName, std::vector<uint8_t>& buffer)
+	{
+		std::ifstream fin(std::filesystem::path(fileName), std::ios::in | std::ios::binary | std::ios::ate);
+		if (!fin.is_open())
+			return false;
+
+		buffer.resize(static_cast<size_t>(fin.tellg()));
+		fin.seekg(0);
+		fin.read(reinterpret_cast<char*>(buffer.data()), buffer.size());
+		return !fin.fail();
+	}
+
+	double GetSeconds(std::chrono::high_resolution_clock::time_point start)
+	{
+		return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+}
+
+//
+// AssetLoader::Handle
+//
+
+AssetLoader::Handle::~Handle()
+{
+	Cancel();
+}
+
+AssetLoader::Handle::Handle(Handle&& other) noexcept
+	: m_pRequest(std::move(other.m_pRequest)), m_Canceled(other.m_Canceled)
+{
+	other.m_Canceled = false;
+}
+
+AssetLoader::Handle& AssetLoader::Handle::operator=(Handle&& other) noexcept
+{
+	if (this != &other)
+	{
+		// 先释放对原请求的引用，否则共享该请求的其他句柄无法再取消它
+		Cancel();
+		m_pRequest = std::move(other.m_pRequest);
+		m_Canceled = other.m_Canceled;
+		other.m_Canceled = false;
+	}
+	return *this;
+}
+
+AssetLoader::State AssetLoader::Handle::GetState() const
+{
+	return m_pRequest ? m_pRequest->state.load() : State::Failed;
+}
+
+bool AssetLoader::Handle::IsDone() const
+{
+	return IsDoneState(GetState());
+}
+
+void AssetLoader::Handle::Cancel()
+{
+	if (!m_pRequest || m_Canceled)
+		return;
+	m_Canceled = true;
+
+	AssetLoader* pLoader = m_pRequest->pLoader;
+	if (pLoader)
+	{
+		std::lock_guard<std::mutex> lock(pLoader->m_Mutex);
+		pLoader->Release(m_pRequest);
+	}
+}
+
+std::shared_ptr<void> AssetLoader::Handle::Get() const
+{
+	// 结果在状态变为Ready之前写入，之后不再修改
+	return IsReady() ? m_pRequest->result : nullptr;
+}
+
+//
+// AssetLoader
+//
+
+AssetLoader::AssetLoader(size_t decodeThreadCount)
+	: m_Sequence(), m_Stop(false), m_Statistics()
+{
+	if (decodeThreadCount == 0)
+	{
+		unsigned hardwareThreads = std::thread::hardware_concurrency();
+		decodeThreadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	// 读取以I/O为主，一个线程即可
+	m_Threads.emplace_back(&AssetLoader::IoThread, this);
+	for (size_t i = 0; i < decodeThreadCount; ++i)
+		m_Threads.emplace_back(&AssetLoader::DecodeThread, this);
+}
+
+AssetLoader::~AssetLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stop = true;
+
+		std::vector<std::shared_ptr<Request>> requests;
+		for (auto& it : m_InFlight)
+			requests.push_back(it.second);
+		for (auto& pRequest : requests)
+			Finish(pRequest, State::Canceled);
+
+		m_IoQueue = std::priority_queue<QueueEntry>();
+		m_DecodeQueue = std::priority_queue<QueueEntry>();
+		m_UploadQueue = std::priority_queue<QueueEntry>();
+	}
+	m_IoCondition.notify_all();
+	m_DecodeCondition.notify_all();
+	m_DoneCondition.notify_all();
+
+	for (auto& thread : m_Threads)
+		thread.join();
+}
+
+void AssetLoader::RegisterType(const std::string& type, Decoder decoder, Uploader uploader)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	TypeInfo& info = m_Types[type];
+	info.decoder = std::move(decoder);
+	info.uploader = std::move(uploader);
+}
+
+AssetLoader::Handle AssetLoader::Load(const std::string& type, const std::wstring& fileName, int priority)
+{
+	Handle handle;
+	std::string key = type + '|' + AssetPackage::NormalizeName(fileName.c_str());
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	++m_Statistics.requestCount;
+
+	// 合并到未完成的相同请求
+	auto it = m_InFlight.find(key);
+	if (it != m_InFlight.end())
+	{
+		std::shared_ptr<Request> pRequest = it->second;
+		++pRequest->refCount;
+		++m_Statistics.mergedCount;
+		if (priority > pRequest->priority)
+		{
+			pRequest->priority = priority;
+			// 仍在队列中等待时以新的优先级重新入队，旧的队列项出队时会被忽略
+			if (pRequest->queuedSequence != 0)
+			{
+				State state = pRequest->state;
+				if (state == State::Queued)
+					Push(m_IoQueue, pRequest);
+				else if (state == State::Decoding)
+					Push(m_DecodeQueue, pRequest);
+				else if (state == State::WaitingForUpload)
+					Push(m_UploadQueue, pRequest);
+			}
+		}
+		handle.m_pRequest = pRequest;
+		return handle;
+	}
+
+	auto pRequest = std::make_shared<Request>();
+	pRequest->key = std::move(key);
+	pRequest->type = type;
+	pRequest->fileName = fileName;
+	pRequest->state = State::Queued;
+	pRequest->pLoader = this;
+	pRequest->priority = priority;
+	pRequest->queuedSequence = 0;
+	pRequest->refCount = 1;
+	pRequest->view = AssetView();
+	handle.m_pRequest = pRequest;
+
+	if (m_Stop || m_Types.find(type) == m_Types.end())
+	{
+		Finish(pRequest, State::Failed);
+		return handle;
+	}
+
+	m_InFlight[pRequest->key] = pRequest;
+	Push(m_IoQueue, pRequest);
+	m_IoCondition.notify_one();
+	return handle;
+}
+
+size_t AssetLoader::Update(size_t maxUploads)
+{
+	size_t uploadCount = 0;
+	while (uploadCount < maxUploads)
+	{
+		std::shared_ptr<Request> pRequest;
+		std::shared_ptr<void> decoded;
+		Uploader uploader;
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			if (!Pop(m_UploadQueue, State::WaitingForUpload, pRequest))
+				break;
+			decoded = std::move(pRequest->decoded);
+			uploader = m_Types[pRequest->type].uploader;
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		std::shared_ptr<void> result = uploader(pRequest->fileName, decoded);
+		double seconds = GetSeconds(start);
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Statistics.uploadSeconds += seconds;
+		++uploadCount;
+		// 上传期间被取消
+		if (pRequest->state != State::WaitingForUpload)
+			continue;
+		pRequest->result = std::move(result);
+		Finish(pRequest, pRequest->result ? State::Ready : State::Failed);
+	}
+	return uploadCount;
+}
+
+bool AssetLoader::Wait(const Handle& handle)
+{
+	if (!handle.m_pRequest)
+		return false;
+
+	const std::shared_ptr<Request>& pRequest = handle.m_pRequest;
+	for (;;)
+	{
+		Update();
+
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_DoneCondition.wait(lock, [this, &pRequest]() {
+			return IsDoneState(pRequest->state) || !m_UploadQueue.empty();
+		});
+		if (IsDoneState(pRequest->state))
+			return pRequest->state == State::Ready;
+	}
+}
+
+size_t AssetLoader::GetPendingCount() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_InFlight.size();
+}
+
+AssetLoader::Statistics AssetLoader::GetStatistics() const
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	return m_Statistics;
+}
+
+void AssetLoader::IoThread()
+{
+	for (;;)
+	{
+		std::shared_ptr<Request> pRequest;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_IoCondition.wait(lock, [this]() { return m_Stop || !m_IoQueue.empty(); });
+			if (m_Stop)
+				return;
+			if (!Pop(m_IoQueue, State::Queued, pRequest))
+				continue;
+			pRequest->state = State::Reading;
+		}
+
+		// 优先从挂载的资源包中读取，未压缩的资源直接使用映射内存
+		auto start = std::chrono::high_resolution_clock::now();
+		AssetView view = {};
+		std::vector<uint8_t> buffer;
+		bool status = AssetPackage::FindMounted(pRequest->fileName.c_str(), view, buffer);
+		if (!status && ReadLooseFile(pRequest->fileName, buffer))
+		{
+			view.data = buffer.data();
+			view.size = buffer.size();
+			status = true;
+		}
+		double seconds = GetSeconds(start);
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Statistics.readSeconds += seconds;
+		// 读取期间被取消
+		if (pRequest->state != State::Reading)
+			continue;
+		if (!status)
+		{
+			Finish(pRequest, State::Failed);
+			continue;
+		}
+
+		// 移动vector不会改变其数据的地址，view仍然有效
+		pRequest->buffer = std::move(buffer);
+		pRequest->view = view;
+		pRequest->state = State::Decoding;
+		Push(m_DecodeQueue, pRequest);
+		m_DecodeCondition.notify_one();
+	}
+}
+
+void AssetLoader::DecodeThread()
+{
+	for (;;)
+	{
+		std::shared_ptr<Request> pRequest;
+		Decoder decoder;
+		// 取走读取的数据，解码期间请求被取消也不会释放它
+		AssetView view;
+		std::vector<uint8_t> buffer;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_DecodeCondition.wait(lock, [this]() { return m_Stop || !m_DecodeQueue.empty(); });
+			if (m_Stop)
+				return;
+			if (!Pop(m_DecodeQueue, State::Decoding, pRequest))
+				continue;
+			decoder = m_Types[pRequest->type].decoder;
+			view = pRequest->view;
+			buffer = std::move(pRequest->buffer);
+			pRequest->view = AssetView();
+		}
+
+		auto start = std::chrono::high_resolution_clock::now();
+		std::shared_ptr<void> decoded = decoder(pRequest->fileName, view.data, view.size);
+		buffer = std::vector<uint8_t>();
+		double seconds = GetSeconds(start);
+
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Statistics.decodeSeconds += seconds;
+		// 解码期间被取消
+		if (pRequest->state != State::Decoding)
+			continue;
+
+		if (!decoded)
+		{
+			Finish(pRequest, State::Failed);
+		}
+		else if (m_Types[pRequest->type].uploader)
+		{
+			pRequest->decoded = std::move(decoded);
+			pRequest->state = State::WaitingForUpload;
+			Push(m_UploadQueue, pRequest);
+			m_DoneCondition.notify_all();
+		}
+		else
+		{
+			pRequest->result = std::move(decoded);
+			Finish(pRequest, State::Ready);
+		}
+	}
+}
+
+void AssetLoader::Push(std::priority_queue<QueueEntry>& queue, const std::shared_ptr<Request>& pRequest)
+{
+	QueueEntry entry = { pRequest->priority, ++m_Sequence, pRequest };
+	pRequest->queuedSequence = entry.sequence;
+	queue.push(std::move(entry));
+}
+
+bool AssetLoader::Pop(std::priority_queue<QueueEntry>& queue, State state, std::shared_ptr<Request>& pRequest)
+{
+	while (!queue.empty())
+	{
+		QueueEntry entry = queue.top();
+		queue.pop();
+		// 忽略已取消的请求以及提升优先级后留下的旧队列项
+		if (entry.pRequest->state == state && entry.pRequest->queuedSequence == entry.sequence)
+		{
+			entry.pRequest->queuedSequence = 0;
+			pRequest = std::move(entry.pRequest);
+			return true;
+		}
+	}
+	return false;
+}
+
+void AssetLoader::Finish(const std::shared_ptr<Request>& pRequest, State state)
+{
+	auto it = m_InFlight.find(pRequest->key);
+	if (it != m_InFlight.end() && it->second == pRequest)
+		m_InFlight.erase(it);
+
+	pRequest->view = AssetView();
+	pRequest->buffer = std::vector<uint8_t>();
+	pRequest->decoded.reset();
+	pRequest->pLoader = nullptr;
+	pRequest->state = state;
+
+	if (state == State::Ready)
+		++m_Statistics.readyCount;
+	else if (state == State::Failed)
+		++m_Statistics.failedCount;
+	else
+		++m_Statistics.canceledCount;
+	m_DoneCondition.notify_all();
+}
+
+void AssetLoader::Release(const std::shared_ptr<Request>& pRequest)
+{
+	if (--pRequest->refCount == 0 && !IsDoneState(pRequest->state))
+		Finish(pRequest, State::Canceled);
+}
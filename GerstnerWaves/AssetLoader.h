@@ -0,0 +1,177 @@
+﻿//***************************************************************************************
+// AssetLoader.h
+// Licensed under the MIT License.
+//
+// 异步资源加载服务
+// - 每个请求依次经过: 读取(I/O线程) -> 解码(解码线程) -> 上传(调用Update的线程，可选)
+// - 读取与解码队列按优先级出队，相同优先级按请求顺序
+// - 同一类型、同一路径的未完成请求会被合并，返回共享同一结果的句柄
+// - 所有句柄都取消后请求才会被取消，尚未执行的阶段会被跳过
+// - 读取与解码不依赖D3D，上传阶段由资源类型注册的回调提供(例如创建纹理)，不注册时解码完成即就绪
+// Asynchronous asset loading service. Requests flow through an I/O thread, a pool of
+// decode threads ordered by priority, and an optional upload stage that runs on the
+// thread calling Update (e.g. for device resource creation). In-flight requests for
+// the same type and path are merged and can be canceled through their handles.
+//***************************************************************************************
+
+#ifndef ASSETLOADER_H
+#define ASSETLOADER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class AssetLoader
+{
+public:
+	enum class State
+	{
+		Queued,				// 等待读取
+		Reading,			// 正在读取
+		Decoding,			// 等待解码或正在解码
+		WaitingForUpload,	// 等待在Update中上传
+		Ready,				// 已完成，可以获取结果
+		Failed,				// 读取、解码或上传失败
+		Canceled			// 已取消
+	};
+
+	// 常用的优先级，数值越大越先处理
+	static const int kPriorityLow = 0;
+	static const int kPriorityNormal = 50;
+	static const int kPriorityHigh = 100;
+
+	// 解码回调，在解码线程上执行，data在回调返回后失效
+	// 返回解码结果，失败时返回nullptr
+	typedef std::function<std::shared_ptr<void>(const std::wstring& fileName, const uint8_t* data, size_t size)> Decoder;
+	// 上传回调，在调用Update的线程上执行，输入解码结果，返回最终结果，失败时返回nullptr
+	typedef std::function<std::shared_ptr<void>(const std::wstring& fileName, const std::shared_ptr<void>& decoded)> Uploader;
+
+	struct Request;
+
+	// 请求的句柄，类似std::future只能移动
+	// 析构或被覆盖时放弃对原请求的需求(同Cancel)，需要结果时应持有句柄直到完成
+	class Handle
+	{
+	public:
+		Handle() : m_Canceled() {}
+		~Handle();
+		Handle(Handle&& other) noexcept;
+		Handle& operator=(Handle&& other) noexcept;
+		Handle(const Handle&) = delete;
+		Handle& operator=(const Handle&) = delete;
+
+		bool IsValid() const { return m_pRequest != nullptr; }
+		State GetState() const;
+		bool IsReady() const { return GetState() == State::Ready; }
+		// 已就绪、失败或取消
+		bool IsDone() const;
+
+		// 放弃该句柄对结果的需求，共享该请求的句柄都取消后请求才会被取消
+		// 不能与AssetLoader的析构同时调用
+		void Cancel();
+
+		// 获取结果，未就绪时返回nullptr
+		std::shared_ptr<void> Get() const;
+		template<class T>
+		std::shared_ptr<T> Get() const { return std::static_pointer_cast<T>(Get()); }
+
+	private:
+		friend class AssetLoader;
+
+		std::shared_ptr<Request> m_pRequest;
+		bool m_Canceled;
+	};
+
+	struct Statistics
+	{
+		uint64_t requestCount;			// Load的调用次数
+		uint64_t mergedCount;			// 与未完成请求合并的次数
+		uint64_t readyCount;
+		uint64_t failedCount;
+		uint64_t canceledCount;
+		double readSeconds;				// 各阶段累计耗时
+		double decodeSeconds;
+		double uploadSeconds;
+	};
+
+	// decodeThreadCount为0时使用硬件线程数减1(至少为1)
+	explicit AssetLoader(size_t decodeThreadCount = 0);
+	// 取消所有未完成的请求并结束工作线程
+	~AssetLoader();
+
+	AssetLoader(const AssetLoader&) = delete;
+	AssetLoader& operator=(const AssetLoader&) = delete;
+
+	// 注册资源类型，uploader可以为空
+	void RegisterType(const std::string& type, Decoder decoder, Uploader uploader = nullptr);
+
+	// 请求加载资源，文件优先从挂载的资源包(见AssetPackage)中读取
+	// 合并到未完成的请求时，若优先级更高则提升该请求的优先级
+	Handle Load(const std::string& type, const std::wstring& fileName, int priority = kPriorityNormal);
+
+	// 在调用线程上执行至多maxUploads个上传，返回执行的数目
+	size_t Update(size_t maxUploads = SIZE_MAX);
+
+	// 阻塞直到请求完成，等待期间在调用线程上执行上传，因此应在调用Update的线程上使用
+	// 返回请求是否就绪
+	bool Wait(const Handle& handle);
+
+	// 未完成的请求数目
+	size_t GetPendingCount() const;
+	Statistics GetStatistics() const;
+
+private:
+	struct QueueEntry
+	{
+		int priority;
+		uint64_t sequence;
+		std::shared_ptr<Request> pRequest;
+
+		bool operator<(const QueueEntry& other) const
+		{
+			// 优先级高的先出队，相同优先级时序号小的先出队
+			return priority != other.priority ? priority < other.priority : sequence > other.sequence;
+		}
+	};
+
+	struct TypeInfo
+	{
+		Decoder decoder;
+		Uploader uploader;
+	};
+
+	void IoThread();
+	void DecodeThread();
+
+	// 以下函数需要在持有m_Mutex时调用
+	void Push(std::priority_queue<QueueEntry>& queue, const std::shared_ptr<Request>& pRequest);
+	bool Pop(std::priority_queue<QueueEntry>& queue, State state, std::shared_ptr<Request>& pRequest);
+	void Finish(const std::shared_ptr<Request>& pRequest, State state);
+	void Release(const std::shared_ptr<Request>& pRequest);
+
+	mutable std::mutex m_Mutex;
+	std::condition_variable m_IoCondition;
+	std::condition_variable m_DecodeCondition;
+	std::condition_variable m_DoneCondition;		// 请求完成或有新的上传时通知
+
+	std::unordered_map<std::string, TypeInfo> m_Types;
+	std::unordered_map<std::string, std::shared_ptr<Request>> m_InFlight;	// 键为类型与规范化的路径
+	std::priority_queue<QueueEntry> m_IoQueue;
+	std::priority_queue<QueueEntry> m_DecodeQueue;
+	std::priority_queue<QueueEntry> m_UploadQueue;
+	uint64_t m_Sequence;
+	bool m_Stop;
+	Statistics m_Statistics;
+
+	std::vector<std::thread> m_Threads;
+};
+
+#endif
@@ -0,0 +1,386 @@
+﻿#include "AssetPackage.h"
+#include "LzCompression.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+//
+// [文件头]32字节
+// [目录]48*资源数目 字节，按名称哈希升序排列
+// [名称表]以'\0'结尾的规范化名称
+// [数据]每个资源的起始位置按64字节对齐，压缩的资源为LzCompression的分块流
+//
+
+struct AssetPackage::TocEntry
+{
+	uint64_t nameHash;
+	uint64_t offset;				// 数据在文件中的偏移
+	uint64_t size;					// 原始大小
+	uint64_t storedSize;			// 存储的大小
+	uint32_t nameOffset;			// 名称在名称表中的偏移
+	uint32_t nameLength;
+	uint32_t compression;
+	uint32_t reserved;
+};
+
+namespace
+{
+	const uint32_t kPakMagic = 0x004B4150;		// "PAK\0"
+	const uint32_t kPakVersion = 1;
+	const size_t kTocAlignment = 16;
+	const size_t kDataAlignment = 64;
+
+	struct PakHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t entryCount;
+		uint32_t reserved;
+		uint64_t tocOffset;
+		uint64_t namesOffset;
+	};
+
+	static_assert(sizeof(PakHeader) == 32, "The layout of PakHeader is stored in .pak files!");
+
+	const AssetPackage* s_pMountedPackage = nullptr;
+
+	size_t AlignUp(size_t value, size_t alignment)
+	{
+		return (value + alignment - 1) / alignment * alignment;
+	}
+
+	bool IsCompressionSupported(uint32_t compression)
+	{
+		return compression == static_cast<uint32_t>(AssetPackage::Compression::None) ||
+			compression == static_cast<uint32_t>(AssetPackage::Compression::LZ);
+	}
+}
+
+bool AssetPackage::Open(const wchar_t* pakFileName)
+{
+	static_assert(sizeof(TocEntry) == 48 && sizeof(TocEntry) % kTocAlignment == 0,
+		"The layout of TocEntry is stored in .pak files!");
+
+	Close();
+	if (!m_File.Open(pakFileName))
+		return false;
+
+	const uint8_t* data = m_File.GetData();
+	size_t size = m_File.GetSize();
+	PakHeader header;
+	if (size < sizeof(PakHeader))
+	{
+		Close();
+		return false;
+	}
+	memcpy(&header, data, sizeof(PakHeader));
+
+	if (header.magic != kPakMagic || header.version != kPakVersion ||
+		header.tocOffset % kTocAlignment != 0 || header.tocOffset > size ||
+		(size - header.tocOffset) / sizeof(TocEntry) < header.entryCount ||
+		header.namesOffset < header.tocOffset + header.entryCount * sizeof(TocEntry) || header.namesOffset > size)
+	{
+		Close();
+		return false;
+	}
+
+	m_pToc = reinterpret_cast<const TocEntry*>(data + header.tocOffset);
+	m_EntryCount = header.entryCount;
+	m_pNames = reinterpret_cast<const char*>(data + header.namesOffset);
+	m_NamesSize = static_cast<size_t>(size - header.namesOffset);
+
+	// 校验每个资源的范围，之后的查找无需再检查
+	for (size_t i = 0; i < m_EntryCount; ++i)
+	{
+		const TocEntry& entry = m_pToc[i];
+		if (entry.offset > size || entry.storedSize > size - entry.offset ||
+			entry.nameOffset > m_NamesSize || entry.nameLength >= m_NamesSize - entry.nameOffset ||
+			m_pNames[entry.nameOffset + entry.nameLength] != '\0' ||
+			!IsCompressionSupported(entry.compression) || entry.size > static_cast<uint64_t>(SIZE_MAX) ||
+			(entry.compression == static_cast<uint32_t>(Compression::None) && entry.size != entry.storedSize) ||
+			// 每个压缩字节最多展开为约255字节，超出时目录必定已损坏，避免按错误的大小分配内存
+			(entry.compression == static_cast<uint32_t>(Compression::LZ) && entry.size / 256 > entry.storedSize) ||
+			(i > 0 && m_pToc[i - 1].nameHash > entry.nameHash))
+		{
+			Close();
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void AssetPackage::Close()
+{
+	if (s_pMountedPackage == this)
+		s_pMountedPackage = nullptr;
+
+	m_File.Close();
+	m_pToc = nullptr;
+	m_pNames = nullptr;
+	m_NamesSize = 0;
+	m_EntryCount = 0;
+
+	std::lock_guard<std::mutex> lock(m_StatisticsMutex);
+	m_Statistics = DecompressStatistics();
+}
+
+bool AssetPackage::Find(const wchar_t* name, AssetView& view, std::vector<uint8_t>& buffer) const
+{
+	if (!m_pToc)
+		return false;
+
+	std::string normalizedName = NormalizeName(name);
+	uint64_t hash = HashName(normalizedName);
+	const TocEntry* end = m_pToc + m_EntryCount;
+	const TocEntry* it = std::lower_bound(m_pToc, end, hash,
+		[](const TocEntry& entry, uint64_t value) { return entry.nameHash < value; });
+
+	// 哈希相同时再比较名称
+	for (; it != end && it->nameHash == hash; ++it)
+	{
+		if (it->nameLength != normalizedName.size() ||
+			memcmp(m_pNames + it->nameOffset, normalizedName.data(), normalizedName.size()) != 0)
+			continue;
+
+		const uint8_t* stored = m_File.GetData() + it->offset;
+		size_t size = static_cast<size_t>(it->size);
+		if (it->compression == static_cast<uint32_t>(Compression::None))
+		{
+			view.data = stored;
+			view.size = size;
+			return true;
+		}
+
+		// 各块并行地直接解压到buffer中
+		ThreadPool& pool = ThreadPool::GetDefault();
+		buffer.resize(size);
+		auto start = std::chrono::high_resolution_clock::now();
+		if (!LzCompression::DecompressBlocks(buffer.data(), size, stored, static_cast<size_t>(it->storedSize), &pool))
+			return false;
+		auto end = std::chrono::high_resolution_clock::now();
+
+		{
+			std::lock_guard<std::mutex> lock(m_StatisticsMutex);
+			++m_Statistics.entryCount;
+			m_Statistics.rawBytes += it->size;
+			m_Statistics.storedBytes += it->storedSize;
+			m_Statistics.seconds += std::chrono::duration<double>(end - start).count();
+			m_Statistics.threadCount = pool.GetThreadCount() + 1;
+		}
+
+		view.data = buffer.data();
+		view.size = size;
+		return true;
+	}
+	return false;
+}
+
+AssetPackage::EntryInfo AssetPackage::GetEntryInfo(size_t index) const
+{
+	EntryInfo info = {};
+	if (index < m_EntryCount)
+	{
+		const TocEntry& entry = m_pToc[index];
+		info.name.assign(m_pNames + entry.nameOffset, entry.nameLength);
+		info.size = entry.size;
+		info.storedSize = entry.storedSize;
+		info.compression = static_cast<Compression>(entry.compression);
+	}
+	return info;
+}
+
+AssetPackage::DecompressStatistics AssetPackage::GetStatistics() const
+{
+	std::lock_guard<std::mutex> lock(m_StatisticsMutex);
+	return m_Statistics;
+}
+
+void AssetPackage::Mount(const AssetPackage* package)
+{
+	s_pMountedPackage = package;
+}
+
+const AssetPackage* AssetPackage::GetMounted()
+{
+	return s_pMountedPackage;
+}
+
+bool AssetPackage::FindMounted(const wchar_t* name, AssetView& view, std::vector<uint8_t>& buffer)
+{
+	return s_pMountedPackage && name && s_pMountedPackage->Find(name, view, buffer);
+}
+
+std::string AssetPackage::NormalizeName(const wchar_t* name)
+{
+	std::string result;
+	for (const wchar_t* p = name; *p; ++p)
+	{
+		uint32_t code = static_cast<uint32_t>(*p);
+		// UTF-16代理对(wchar_t为16位时)
+		if (code >= 0xD800 && code < 0xDC00 && p[1] >= 0xDC00 && p[1] < 0xE000)
+		{
+			code = 0x10000 + ((code - 0xD800) << 10) + (static_cast<uint32_t>(p[1]) - 0xDC00);
+			++p;
+		}
+
+		if (code == '\\')
+			code = '/';
+		else if (code >= 'A' && code <= 'Z')
+			code += 'a' - 'A';
+
+		if (code < 0x80)
+			result += static_cast<char>(code);
+		else if (code < 0x800)
+		{
+			result += static_cast<char>(0xC0 | (code >> 6));
+			result += static_cast<char>(0x80 | (code & 0x3F));
+		}
+		else if (code < 0x10000)
+		{
+			result += static_cast<char>(0xE0 | (code >> 12));
+			result += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+			result += static_cast<char>(0x80 | (code & 0x3F));
+		}
+		else
+		{
+			result += static_cast<char>(0xF0 | (code >> 18));
+			result += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+			result += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+			result += static_cast<char>(0x80 | (code & 0x3F));
+		}
+	}
+
+	while (result.compare(0, 2, "./") == 0)
+		result.erase(0, 2);
+	return result;
+}
+
+uint64_t AssetPackage::HashName(const std::string& normalizedName)
+{
+	uint64_t hash = 0xCBF29CE484222325ull;
+	for (char c : normalizedName)
+	{
+		hash ^= static_cast<uint8_t>(c);
+		hash *= 0x100000001B3ull;
+	}
+	return hash;
+}
+
+void AssetPackageWriter::AddEntry(const wchar_t* name, std::vector<uint8_t>&& data, AssetPackage::Compression compression)
+{
+	Entry entry;
+	entry.name = AssetPackage::NormalizeName(name);
+	entry.hash = AssetPackage::HashName(entry.name);
+	entry.compression = compression;
+	entry.data = std::move(data);
+
+	for (auto& existing : m_Entries)
+	{
+		if (existing.name == entry.name)
+		{
+			existing = std::move(entry);
+			return;
+		}
+	}
+	m_Entries.push_back(std::move(entry));
+}
+
+bool AssetPackageWriter::AddFile(const wchar_t* fileName, AssetPackage::Compression compression)
+{
+	std::ifstream fin(std::filesystem::path(fileName), std::ios::in | std::ios::binary | std::ios::ate);
+	if (!fin.is_open())
+		return false;
+
+	std::vector<uint8_t> data(static_cast<size_t>(fin.tellg()));
+	fin.seekg(0);
+	fin.read(reinterpret_cast<char*>(data.data()), data.size());
+	if (!fin)
+		return false;
+
+	AddEntry(fileName, std::move(data), compression);
+	return true;
+}
+
+bool AssetPackageWriter::Write(const wchar_t* pakFileName) const
+{
+	// 目录按哈希排序，便于运行时二分查找
+	std::vector<const Entry*> sorted;
+	for (const auto& entry : m_Entries)
+		sorted.push_back(&entry);
+	std::sort(sorted.begin(), sorted.end(), [](const Entry* lhs, const Entry* rhs) {
+		return lhs->hash != rhs->hash ? lhs->hash < rhs->hash : lhs->name < rhs->name;
+	});
+
+	PakHeader header = {};
+	header.magic = kPakMagic;
+	header.version = kPakVersion;
+	header.entryCount = static_cast<uint32_t>(sorted.size());
+	header.tocOffset = AlignUp(sizeof(PakHeader), kTocAlignment);
+	header.namesOffset = header.tocOffset + sorted.size() * sizeof(AssetPackage::TocEntry);
+
+	// 压缩后没有变小的资源不压缩存储
+	std::vector<std::vector<uint8_t>> compressed(sorted.size());
+	for (size_t i = 0; i < sorted.size(); ++i)
+	{
+		const Entry& entry = *sorted[i];
+		if (entry.compression != AssetPackage::Compression::LZ)
+			continue;
+		compressed[i] = LzCompression::CompressBlocks(entry.data.data(), entry.data.size(),
+			LzCompression::kDefaultBlockSize, &ThreadPool::GetDefault());
+		if (compressed[i].size() >= entry.data.size())
+			compressed[i].clear();
+	}
+
+	std::string names;
+	std::vector<AssetPackage::TocEntry> toc(sorted.size());
+	for (size_t i = 0; i < sorted.size(); ++i)
+	{
+		toc[i] = AssetPackage::TocEntry();
+		toc[i].nameHash = sorted[i]->hash;
+		toc[i].nameOffset = static_cast<uint32_t>(names.size());
+		toc[i].nameLength = static_cast<uint32_t>(sorted[i]->name.size());
+		names += sorted[i]->name;
+		names += '\0';
+	}
+
+	uint64_t offset = AlignUp(static_cast<size_t>(header.namesOffset) + names.size(), kDataAlignment);
+	for (size_t i = 0; i < sorted.size(); ++i)
+	{
+		bool isCompressed = !compressed[i].empty();
+		toc[i].offset = offset;
+		toc[i].size = sorted[i]->data.size();
+		toc[i].storedSize = isCompressed ? compressed[i].size() : sorted[i]->data.size();
+		toc[i].compression = static_cast<uint32_t>(isCompressed ? AssetPackage::Compression::LZ : AssetPackage::Compression::None);
+		offset = AlignUp(static_cast<size_t>(offset + toc[i].storedSize), kDataAlignment);
+	}
+
+	std::ofstream fout(std::filesystem::path(pakFileName), std::ios::out | std::ios::binary);
+	if (!fout.is_open())
+		return false;
+
+	// 对齐时以0填充
+	static const char zeros[kDataAlignment] = {};
+	auto pad = [&fout](uint64_t position) {
+		uint64_t current = static_cast<uint64_t>(fout.tellp());
+		if (position > current)
+			fout.write(zeros, static_cast<std::streamsize>(position - current));
+	};
+
+	fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	pad(header.tocOffset);
+	fout.write(reinterpret_cast<const char*>(toc.data()), toc.size() * sizeof(AssetPackage::TocEntry));
+	fout.write(names.data(), names.size());
+	for (size_t i = 0; i < sorted.size(); ++i)
+	{
+		const std::vector<uint8_t>& stored = compressed[i].empty() ? sorted[i]->data : compressed[i];
+		pad(toc[i].offset);
+		fout.write(reinterpret_cast<const char*>(stored.data()), stored.size());
+	}
+	fout.close();
+
+	return !fout.fail();
+}
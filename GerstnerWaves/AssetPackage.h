@@ -0,0 +1,139 @@
+﻿//***************************************************************************************
+// AssetPackage.h
+// Licensed under the MIT License.
+//
+// 单文件资源包(.pak)
+// - 文件头之后是按名称哈希排序、16字节对齐的目录，之后是名称表与按64字节对齐的数据区
+// - 运行时整个资源包只映射一次，查找到的资源以指向映射内存的视图返回，不发生复制
+// - 资源名即松散文件的相对路径，不区分大小写，/与\等价
+// - 每个资源带有压缩方式的标记，压缩的资源按块存储(见LzCompression)，读取时在线程池中并行解压
+// Single-file asset package: an aligned, hash-sorted table of contents followed by
+// a name table and a blob region. The runtime maps the whole file once and serves
+// read-only views into it.
+//***************************************************************************************
+
+#ifndef ASSETPACKAGE_H
+#define ASSETPACKAGE_H
+
+#include "MappedFile.h"
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 资源的只读视图
+struct AssetView
+{
+	const uint8_t* data;
+	size_t size;
+};
+
+class AssetPackage
+{
+public:
+	// 资源数据的存储方式
+	enum class Compression : uint32_t
+	{
+		None = 0,
+		LZ = 1,			// LzCompression的分块流
+	};
+
+	struct EntryInfo
+	{
+		std::string name;				// 规范化后的资源名(UTF-8)
+		uint64_t size;					// 原始大小
+		uint64_t storedSize;			// 在资源包中占用的大小
+		Compression compression;
+	};
+
+	// 解压的统计，用于输出压缩率与解压速度
+	struct DecompressStatistics
+	{
+		uint64_t entryCount;			// 解压的资源数目
+		uint64_t rawBytes;				// 解压后的字节数
+		uint64_t storedBytes;			// 解压前的字节数
+		double seconds;					// 解压耗时(墙上时间)
+		size_t threadCount;				// 参与解压的线程数目
+	};
+
+	AssetPackage() : m_pToc(), m_pNames(), m_NamesSize(), m_EntryCount(), m_Statistics() {}
+	~AssetPackage() { Close(); }
+
+	AssetPackage(const AssetPackage&) = delete;
+	AssetPackage& operator=(const AssetPackage&) = delete;
+
+	// 映射资源包并校验目录
+	bool Open(const wchar_t* pakFileName);
+	void Close();
+	bool IsOpen() const { return m_File.IsOpen(); }
+
+	// 查找资源
+	// 未压缩的资源直接返回指向映射内存的视图，在Close之前有效；
+	// 压缩的资源并行解压到buffer中，返回的视图指向buffer
+	bool Find(const wchar_t* name, AssetView& view, std::vector<uint8_t>& buffer) const;
+
+	size_t GetEntryCount() const { return m_EntryCount; }
+	EntryInfo GetEntryInfo(size_t index) const;
+
+	DecompressStatistics GetStatistics() const;
+
+	//
+	// 全局挂载的资源包
+	//
+
+	// 挂载后，各加载函数会优先从该资源包中读取同名资源，传入nullptr取消挂载
+	static void Mount(const AssetPackage* package);
+	static const AssetPackage* GetMounted();
+	// 在挂载的资源包中查找资源，没有挂载资源包或找不到时返回false
+	static bool FindMounted(const wchar_t* name, AssetView& view, std::vector<uint8_t>& buffer);
+
+	//
+	// 资源名
+	//
+
+	// 转换为UTF-8，ASCII字母转为小写，\转为/，并去掉开头的./
+	static std::string NormalizeName(const wchar_t* name);
+	// 规范化名称的64位FNV-1a哈希
+	static uint64_t HashName(const std::string& normalizedName);
+
+private:
+	friend class AssetPackageWriter;
+	struct TocEntry;
+
+	MappedFile m_File;
+	const TocEntry* m_pToc;
+	const char* m_pNames;
+	size_t m_NamesSize;
+	size_t m_EntryCount;
+
+	mutable std::mutex m_StatisticsMutex;
+	mutable DecompressStatistics m_Statistics;
+};
+
+class AssetPackageWriter
+{
+public:
+	// 添加资源，name为运行时查找使用的名称，同名资源后添加的会覆盖先添加的
+	// 压缩后没有变小的资源会以不压缩的方式存储
+	void AddEntry(const wchar_t* name, std::vector<uint8_t>&& data,
+		AssetPackage::Compression compression = AssetPackage::Compression::LZ);
+	// 读取文件并以文件名作为资源名添加
+	bool AddFile(const wchar_t* fileName, AssetPackage::Compression compression = AssetPackage::Compression::LZ);
+
+	size_t GetEntryCount() const { return m_Entries.size(); }
+
+	// 压缩并写入资源包
+	bool Write(const wchar_t* pakFileName) const;
+
+private:
+	struct Entry
+	{
+		std::string name;
+		uint64_t hash;
+		AssetPackage::Compression compression;
+		std::vector<uint8_t> data;
+	};
+
+	std::vector<Entry> m_Entries;
+};
+
+#endif
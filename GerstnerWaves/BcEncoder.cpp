@@ -0,0 +1,891 @@
+﻿#include "BcEncoder.h"
+#include "DdsReader.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define BCENCODER_SIMD 1
+#define BCENCODER_TARGET_SSE2
+#define BCENCODER_TARGET_AVX2
+#include <intrin.h>
+#include <immintrin.h>
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define BCENCODER_SIMD 1
+#define BCENCODER_TARGET_SSE2 __attribute__((target("sse2")))
+#define BCENCODER_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+
+//
+// 块格式(小端序):
+// BC1   [颜色0 565][颜色1 565][16个2位索引]，颜色0大于颜色1时为4色模式，否则为3色模式(索引3为透明)
+// BC4   [端点0][端点1][16个3位索引]，端点0大于端点1时为8级插值，否则为6级插值加0与255
+// BC3 = BC4(Alpha) + BC1(颜色，总是4色模式)，BC5 = BC4(R) + BC4(G)
+//
+// 编码器的确定性:
+// 载入块的和、颜色距离与误差都是不超过2^24的整数，浮点运算是精确的，与求和顺序无关
+// 投影按相同的顺序逐个像素做乘加(不合并为FMA)，各实现的结果相同
+//
+
+namespace
+{
+	// 一个块的RGB，按通道分开存放，值为0~255的整数
+	struct ColorBlock
+	{
+		alignas(32) float r[16];
+		alignas(32) float g[16];
+		alignas(32) float b[16];
+		// Σr Σg Σb Σrr Σgg Σbb Σrg Σrb Σgb
+		float sums[9];
+	};
+
+	// 各指令集实现的热点部分
+	struct Kernels
+	{
+		// 载入按行排列的16个RGBA像素
+		void (*loadColors)(const uint8_t* rgba, ColorBlock& block);
+		// 像素相对均值在轴上投影的范围
+		void (*project)(const ColorBlock& block, const float mean[3], const float axis[3], float& minT, float& maxT);
+		// 为每个像素选择最近的调色板颜色，返回平方误差之和
+		float (*selectColors)(const ColorBlock& block, const float palette[4][3], uint8_t indices[16]);
+		// 为单通道的8级插值选择索引，maxValue > minValue
+		void (*selectChannel)(const uint8_t values[16], int minValue, int maxValue, uint8_t indices[16]);
+	};
+
+	//
+	// 标量实现
+	//
+
+	void LoadColorsScalar(const uint8_t* rgba, ColorBlock& block)
+	{
+		int sums[9] = {};
+		for (int i = 0; i < 16; ++i)
+		{
+			int r = rgba[i * 4], g = rgba[i * 4 + 1], b = rgba[i * 4 + 2];
+			block.r[i] = static_cast<float>(r);
+			block.g[i] = static_cast<float>(g);
+			block.b[i] = static_cast<float>(b);
+			sums[0] += r; sums[1] += g; sums[2] += b;
+			sums[3] += r * r; sums[4] += g * g; sums[5] += b * b;
+			sums[6] += r * g; sums[7] += r * b; sums[8] += g * b;
+		}
+		for (int i = 0; i < 9; ++i)
+			block.sums[i] = static_cast<float>(sums[i]);
+	}
+
+	void ProjectScalar(const ColorBlock& block, const float mean[3], const float axis[3], float& minT, float& maxT)
+	{
+		minT = maxT = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			float t = (block.r[i] - mean[0]) * axis[0] + (block.g[i] - mean[1]) * axis[1];
+			t = t + (block.b[i] - mean[2]) * axis[2];
+			minT = i == 0 ? t : (std::min)(minT, t);
+			maxT = i == 0 ? t : (std::max)(maxT, t);
+		}
+	}
+
+	float SelectColorsScalar(const ColorBlock& block, const float palette[4][3], uint8_t indices[16])
+	{
+		float error = 0.0f;
+		for (int i = 0; i < 16; ++i)
+		{
+			float best = 0.0f;
+			uint8_t bestIndex = 0;
+			for (int k = 0; k < 4; ++k)
+			{
+				float dr = block.r[i] - palette[k][0], dg = block.g[i] - palette[k][1], db = block.b[i] - palette[k][2];
+				float d = dr * dr + dg * dg + db * db;
+				if (k == 0 || d < best)
+				{
+					best = d;
+					bestIndex = static_cast<uint8_t>(k);
+				}
+			}
+			indices[i] = bestIndex;
+			error += best;
+		}
+		return error;
+	}
+
+	// 插值位置pos = round((max - v) * 7 / range)，即满足(max - v) * 14 >= (2k - 1) * range的k的个数
+	// pos为0对应端点0(max)，为7对应端点1(min)，其余对应索引pos + 1
+	uint8_t ChannelIndexFromPosition(int pos)
+	{
+		return static_cast<uint8_t>(pos == 0 ? 0 : pos == 7 ? 1 : pos + 1);
+	}
+
+	void SelectChannelScalar(const uint8_t values[16], int minValue, int maxValue, uint8_t indices[16])
+	{
+		int range = maxValue - minValue;
+		for (int i = 0; i < 16; ++i)
+		{
+			int diff = (maxValue - values[i]) * 14;
+			int pos = 0;
+			for (int k = 1; k <= 7; ++k)
+				pos += diff >= (2 * k - 1) * range ? 1 : 0;
+			indices[i] = ChannelIndexFromPosition(pos);
+		}
+	}
+
+	const Kernels kScalarKernels = { LoadColorsScalar, ProjectScalar, SelectColorsScalar, SelectChannelScalar };
+
+#ifdef BCENCODER_SIMD
+	bool HasSSE2()
+	{
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 1);
+		return (info[3] & (1 << 26)) != 0;
+#else
+		return __builtin_cpu_supports("sse2") != 0;
+#endif
+	}
+
+	bool HasAVX2()
+	{
+#if defined(_MSC_VER)
+		// 除CPU支持外还需要操作系统保存YMM寄存器
+		int info[4];
+		__cpuid(info, 1);
+		if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+			return false;
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		return __builtin_cpu_supports("avx2") != 0;
+#endif
+	}
+
+	//
+	// SSE2实现，每次处理4个像素
+	//
+
+	BCENCODER_TARGET_SSE2 inline float HorizontalSum(__m128 v)
+	{
+		v = _mm_add_ps(v, _mm_movehl_ps(v, v));
+		v = _mm_add_ss(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1)));
+		return _mm_cvtss_f32(v);
+	}
+
+	BCENCODER_TARGET_SSE2 void LoadColorsSSE2(const uint8_t* rgba, ColorBlock& block)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		__m128 sums[9];
+		for (int i = 0; i < 9; ++i)
+			sums[i] = _mm_setzero_ps();
+
+		for (int j = 0; j < 4; ++j)
+		{
+			__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(rgba + j * 16));
+			__m128i lo = _mm_unpacklo_epi8(pixels, zero);
+			__m128i hi = _mm_unpackhi_epi8(pixels, zero);
+			__m128 r = _mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero));
+			__m128 g = _mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero));
+			__m128 b = _mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero));
+			__m128 a = _mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero));
+			// 4个像素的RGBA转置为4个通道
+			_MM_TRANSPOSE4_PS(r, g, b, a);
+			_mm_store_ps(block.r + j * 4, r);
+			_mm_store_ps(block.g + j * 4, g);
+			_mm_store_ps(block.b + j * 4, b);
+
+			sums[0] = _mm_add_ps(sums[0], r);
+			sums[1] = _mm_add_ps(sums[1], g);
+			sums[2] = _mm_add_ps(sums[2], b);
+			sums[3] = _mm_add_ps(sums[3], _mm_mul_ps(r, r));
+			sums[4] = _mm_add_ps(sums[4], _mm_mul_ps(g, g));
+			sums[5] = _mm_add_ps(sums[5], _mm_mul_ps(b, b));
+			sums[6] = _mm_add_ps(sums[6], _mm_mul_ps(r, g));
+			sums[7] = _mm_add_ps(sums[7], _mm_mul_ps(r, b));
+			sums[8] = _mm_add_ps(sums[8], _mm_mul_ps(g, b));
+		}
+		for (int i = 0; i < 9; ++i)
+			block.sums[i] = HorizontalSum(sums[i]);
+	}
+
+	BCENCODER_TARGET_SSE2 void ProjectSSE2(const ColorBlock& block, const float mean[3], const float axis[3], float& minT, float& maxT)
+	{
+		const __m128 meanR = _mm_set1_ps(mean[0]), meanG = _mm_set1_ps(mean[1]), meanB = _mm_set1_ps(mean[2]);
+		const __m128 axisR = _mm_set1_ps(axis[0]), axisG = _mm_set1_ps(axis[1]), axisB = _mm_set1_ps(axis[2]);
+		__m128 minV = _mm_set1_ps(HUGE_VALF), maxV = _mm_set1_ps(-HUGE_VALF);
+		for (int j = 0; j < 16; j += 4)
+		{
+			__m128 t = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(block.r + j), meanR), axisR),
+				_mm_mul_ps(_mm_sub_ps(_mm_load_ps(block.g + j), meanG), axisG));
+			t = _mm_add_ps(t, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(block.b + j), meanB), axisB));
+			minV = _mm_min_ps(minV, t);
+			maxV = _mm_max_ps(maxV, t);
+		}
+		minV = _mm_min_ps(minV, _mm_movehl_ps(minV, minV));
+		minV = _mm_min_ss(minV, _mm_shuffle_ps(minV, minV, _MM_SHUFFLE(1, 1, 1, 1)));
+		maxV = _mm_max_ps(maxV, _mm_movehl_ps(maxV, maxV));
+		maxV = _mm_max_ss(maxV, _mm_shuffle_ps(maxV, maxV, _MM_SHUFFLE(1, 1, 1, 1)));
+		minT = _mm_cvtss_f32(minV);
+		maxT = _mm_cvtss_f32(maxV);
+	}
+
+	BCENCODER_TARGET_SSE2 float SelectColorsSSE2(const ColorBlock& block, const float palette[4][3], uint8_t indices[16])
+	{
+		__m128 error = _mm_setzero_ps();
+		__m128i index[4];
+		for (int j = 0; j < 4; ++j)
+		{
+			__m128 r = _mm_load_ps(block.r + j * 4), g = _mm_load_ps(block.g + j * 4), b = _mm_load_ps(block.b + j * 4);
+			__m128 best = _mm_setzero_ps();
+			__m128i bestIndex = _mm_setzero_si128();
+			for (int k = 0; k < 4; ++k)
+			{
+				__m128 dr = _mm_sub_ps(r, _mm_set1_ps(palette[k][0]));
+				__m128 dg = _mm_sub_ps(g, _mm_set1_ps(palette[k][1]));
+				__m128 db = _mm_sub_ps(b, _mm_set1_ps(palette[k][2]));
+				__m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dr, dr), _mm_mul_ps(dg, dg)), _mm_mul_ps(db, db));
+				if (k == 0)
+				{
+					best = d;
+					continue;
+				}
+				__m128 closer = _mm_cmplt_ps(d, best);
+				best = _mm_min_ps(d, best);
+				bestIndex = _mm_or_si128(_mm_andnot_si128(_mm_castps_si128(closer), bestIndex),
+					_mm_and_si128(_mm_castps_si128(closer), _mm_set1_epi32(k)));
+			}
+			error = _mm_add_ps(error, best);
+			index[j] = bestIndex;
+		}
+		__m128i packed = _mm_packus_epi16(_mm_packs_epi32(index[0], index[1]), _mm_packs_epi32(index[2], index[3]));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(indices), packed);
+		return HorizontalSum(error);
+	}
+
+	BCENCODER_TARGET_SSE2 __m128i SelectChannelSSE2(__m128i values, __m128i maxValue, int range)
+	{
+		// (max - v) * 14不超过3570，与阈值的比较都在16位有符号整数内
+		__m128i diff = _mm_mullo_epi16(_mm_sub_epi16(maxValue, values), _mm_set1_epi16(14));
+		__m128i pos = _mm_setzero_si128();
+		for (int k = 1; k <= 7; ++k)
+			pos = _mm_sub_epi16(pos, _mm_cmpgt_epi16(diff, _mm_set1_epi16(static_cast<short>((2 * k - 1) * range - 1))));
+		__m128i isFirst = _mm_cmpeq_epi16(pos, _mm_setzero_si128());
+		__m128i isLast = _mm_cmpeq_epi16(pos, _mm_set1_epi16(7));
+		__m128i index = _mm_add_epi16(pos, _mm_set1_epi16(1));
+		index = _mm_andnot_si128(_mm_or_si128(isFirst, isLast), index);
+		return _mm_or_si128(index, _mm_and_si128(isLast, _mm_set1_epi16(1)));
+	}
+
+	BCENCODER_TARGET_SSE2 void SelectChannelSSE2(const uint8_t values[16], int minValue, int maxValue, uint8_t indices[16])
+	{
+		const __m128i zero = _mm_setzero_si128();
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values));
+		__m128i maxV = _mm_set1_epi16(static_cast<short>(maxValue));
+		int range = maxValue - minValue;
+		__m128i lo = SelectChannelSSE2(_mm_unpacklo_epi8(v, zero), maxV, range);
+		__m128i hi = SelectChannelSSE2(_mm_unpackhi_epi8(v, zero), maxV, range);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(indices), _mm_packus_epi16(lo, hi));
+	}
+
+	const Kernels kSSE2Kernels = { LoadColorsSSE2, ProjectSSE2, SelectColorsSSE2, SelectChannelSSE2 };
+
+	//
+	// AVX2实现，每次处理8个像素
+	//
+
+	BCENCODER_TARGET_AVX2 inline float HorizontalSum(__m256 v)
+	{
+		__m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+		sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+		sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 1, 1, 1)));
+		return _mm_cvtss_f32(sum);
+	}
+
+	BCENCODER_TARGET_AVX2 void LoadColorsAVX2(const uint8_t* rgba, ColorBlock& block)
+	{
+		// 每128位内把4个像素的RGBA重排为RRRRGGGGBBBBAAAA，再跨128位合并为8个R、8个G与8个B
+		const __m256i groupChannels = _mm256_setr_epi8(
+			0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15,
+			0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+		const __m256i gatherLanes = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+		__m256 sums[9];
+		for (int i = 0; i < 9; ++i)
+			sums[i] = _mm256_setzero_ps();
+
+		for (int j = 0; j < 2; ++j)
+		{
+			__m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(rgba + j * 32));
+			pixels = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(pixels, groupChannels), gatherLanes);
+			__m128i rg = _mm256_castsi256_si128(pixels);
+			__m128i ba = _mm256_extracti128_si256(pixels, 1);
+			__m256 r = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(rg));
+			__m256 g = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(_mm_srli_si128(rg, 8)));
+			__m256 b = _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(ba));
+			_mm256_store_ps(block.r + j * 8, r);
+			_mm256_store_ps(block.g + j * 8, g);
+			_mm256_store_ps(block.b + j * 8, b);
+
+			sums[0] = _mm256_add_ps(sums[0], r);
+			sums[1] = _mm256_add_ps(sums[1], g);
+			sums[2] = _mm256_add_ps(sums[2], b);
+			sums[3] = _mm256_add_ps(sums[3], _mm256_mul_ps(r, r));
+			sums[4] = _mm256_add_ps(sums[4], _mm256_mul_ps(g, g));
+			sums[5] = _mm256_add_ps(sums[5], _mm256_mul_ps(b, b));
+			sums[6] = _mm256_add_ps(sums[6], _mm256_mul_ps(r, g));
+			sums[7] = _mm256_add_ps(sums[7], _mm256_mul_ps(r, b));
+			sums[8] = _mm256_add_ps(sums[8], _mm256_mul_ps(g, b));
+		}
+		for (int i = 0; i < 9; ++i)
+			block.sums[i] = HorizontalSum(sums[i]);
+	}
+
+	BCENCODER_TARGET_AVX2 void ProjectAVX2(const ColorBlock& block, const float mean[3], const float axis[3], float& minT, float& maxT)
+	{
+		const __m256 meanR = _mm256_set1_ps(mean[0]), meanG = _mm256_set1_ps(mean[1]), meanB = _mm256_set1_ps(mean[2]);
+		const __m256 axisR = _mm256_set1_ps(axis[0]), axisG = _mm256_set1_ps(axis[1]), axisB = _mm256_set1_ps(axis[2]);
+		__m256 minV = _mm256_set1_ps(HUGE_VALF), maxV = _mm256_set1_ps(-HUGE_VALF);
+		for (int j = 0; j < 16; j += 8)
+		{
+			__m256 t = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(block.r + j), meanR), axisR),
+				_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(block.g + j), meanG), axisG));
+			t = _mm256_add_ps(t, _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(block.b + j), meanB), axisB));
+			minV = _mm256_min_ps(minV, t);
+			maxV = _mm256_max_ps(maxV, t);
+		}
+		__m128 minH = _mm_min_ps(_mm256_castps256_ps128(minV), _mm256_extractf128_ps(minV, 1));
+		__m128 maxH = _mm_max_ps(_mm256_castps256_ps128(maxV), _mm256_extractf128_ps(maxV, 1));
+		minH = _mm_min_ps(minH, _mm_movehl_ps(minH, minH));
+		minH = _mm_min_ss(minH, _mm_shuffle_ps(minH, minH, _MM_SHUFFLE(1, 1, 1, 1)));
+		maxH = _mm_max_ps(maxH, _mm_movehl_ps(maxH, maxH));
+		maxH = _mm_max_ss(maxH, _mm_shuffle_ps(maxH, maxH, _MM_SHUFFLE(1, 1, 1, 1)));
+		minT = _mm_cvtss_f32(minH);
+		maxT = _mm_cvtss_f32(maxH);
+	}
+
+	BCENCODER_TARGET_AVX2 float SelectColorsAVX2(const ColorBlock& block, const float palette[4][3], uint8_t indices[16])
+	{
+		__m256 error = _mm256_setzero_ps();
+		__m256i index[2];
+		for (int j = 0; j < 2; ++j)
+		{
+			__m256 r = _mm256_load_ps(block.r + j * 8), g = _mm256_load_ps(block.g + j * 8), b = _mm256_load_ps(block.b + j * 8);
+			__m256 best = _mm256_setzero_ps();
+			__m256 bestIndex = _mm256_setzero_ps();
+			for (int k = 0; k < 4; ++k)
+			{
+				__m256 dr = _mm256_sub_ps(r, _mm256_set1_ps(palette[k][0]));
+				__m256 dg = _mm256_sub_ps(g, _mm256_set1_ps(palette[k][1]));
+				__m256 db = _mm256_sub_ps(b, _mm256_set1_ps(palette[k][2]));
+				__m256 d = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dr, dr), _mm256_mul_ps(dg, dg)), _mm256_mul_ps(db, db));
+				if (k == 0)
+				{
+					best = d;
+					continue;
+				}
+				__m256 closer = _mm256_cmp_ps(d, best, _CMP_LT_OQ);
+				best = _mm256_min_ps(d, best);
+				bestIndex = _mm256_blendv_ps(bestIndex, _mm256_castsi256_ps(_mm256_set1_epi32(k)), closer);
+			}
+			error = _mm256_add_ps(error, best);
+			index[j] = _mm256_castps_si256(bestIndex);
+		}
+		__m128i lo = _mm_packs_epi32(_mm256_castsi256_si128(index[0]), _mm256_extracti128_si256(index[0], 1));
+		__m128i hi = _mm_packs_epi32(_mm256_castsi256_si128(index[1]), _mm256_extracti128_si256(index[1], 1));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(indices), _mm_packus_epi16(lo, hi));
+		return HorizontalSum(error);
+	}
+
+	BCENCODER_TARGET_AVX2 void SelectChannelAVX2(const uint8_t values[16], int minValue, int maxValue, uint8_t indices[16])
+	{
+		// 16个值恰好占满一个256位寄存器的16位通道
+		__m256i v = _mm256_cvtepu8_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(values)));
+		int range = maxValue - minValue;
+		__m256i diff = _mm256_mullo_epi16(_mm256_sub_epi16(_mm256_set1_epi16(static_cast<short>(maxValue)), v), _mm256_set1_epi16(14));
+		__m256i pos = _mm256_setzero_si256();
+		for (int k = 1; k <= 7; ++k)
+			pos = _mm256_sub_epi16(pos, _mm256_cmpgt_epi16(diff, _mm256_set1_epi16(static_cast<short>((2 * k - 1) * range - 1))));
+		__m256i isFirst = _mm256_cmpeq_epi16(pos, _mm256_setzero_si256());
+		__m256i isLast = _mm256_cmpeq_epi16(pos, _mm256_set1_epi16(7));
+		__m256i index = _mm256_add_epi16(pos, _mm256_set1_epi16(1));
+		index = _mm256_andnot_si256(_mm256_or_si256(isFirst, isLast), index);
+		index = _mm256_or_si256(index, _mm256_and_si256(isLast, _mm256_set1_epi16(1)));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(indices),
+			_mm_packus_epi16(_mm256_castsi256_si128(index), _mm256_extracti128_si256(index, 1)));
+	}
+
+	const Kernels kAVX2Kernels = { LoadColorsAVX2, ProjectAVX2, SelectColorsAVX2, SelectChannelAVX2 };
+#endif
+
+	const Kernels& GetKernels(BcEncoder::Simd simd)
+	{
+		switch (simd)
+		{
+#ifdef BCENCODER_SIMD
+		case BcEncoder::Simd::AVX2: return kAVX2Kernels;
+		case BcEncoder::Simd::SSE2: return kSSE2Kernels;
+#endif
+		default: return kScalarKernels;
+		}
+	}
+
+	//
+	// 与指令集无关的部分
+	//
+
+	int Expand5(int value) { return (value << 3) | (value >> 2); }
+	int Expand6(int value) { return (value << 2) | (value >> 4); }
+
+	int Quantize(float value, int maxValue)
+	{
+		int q = static_cast<int>(value * maxValue / 255.0f + 0.5f);
+		return (std::min)((std::max)(q, 0), maxValue);
+	}
+
+	uint16_t Pack565(const float color[3])
+	{
+		return static_cast<uint16_t>(Quantize(color[0], 31) << 11 | Quantize(color[1], 63) << 5 | Quantize(color[2], 31));
+	}
+
+	void Unpack565(uint16_t color, int rgb[3])
+	{
+		rgb[0] = Expand5(color >> 11);
+		rgb[1] = Expand6((color >> 5) & 63);
+		rgb[2] = Expand5(color & 31);
+	}
+
+	// 纯色块: 对每个8位值预先求出一对端点，使索引2的插值((2 * a + b) / 3)最接近该值
+	struct SingleColorTables
+	{
+		SingleColorTables()
+		{
+			Build(table5, 31, Expand5);
+			Build(table6, 63, Expand6);
+		}
+
+		static void Build(uint8_t (&table)[256][2], int maxValue, int (*expand)(int))
+		{
+			for (int v = 0; v < 256; ++v)
+			{
+				int bestError = 256;
+				for (int a = 0; a <= maxValue; ++a)
+				{
+					for (int b = 0; b <= maxValue; ++b)
+					{
+						int error = std::abs((2 * expand(a) + expand(b)) / 3 - v);
+						if (error < bestError)
+						{
+							bestError = error;
+							table[v][0] = static_cast<uint8_t>(a);
+							table[v][1] = static_cast<uint8_t>(b);
+						}
+					}
+				}
+			}
+		}
+
+		uint8_t table5[256][2];
+		uint8_t table6[256][2];
+	};
+
+	const SingleColorTables& GetSingleColorTables()
+	{
+		static const SingleColorTables tables;
+		return tables;
+	}
+
+	void WriteColorBlock(uint8_t* output, uint16_t color0, uint16_t color1, const uint8_t indices[16])
+	{
+		uint32_t bits = 0;
+		for (int i = 0; i < 16; ++i)
+			bits |= static_cast<uint32_t>(indices[i]) << (i * 2);
+		output[0] = static_cast<uint8_t>(color0);
+		output[1] = static_cast<uint8_t>(color0 >> 8);
+		output[2] = static_cast<uint8_t>(color1);
+		output[3] = static_cast<uint8_t>(color1 >> 8);
+		memcpy(output + 4, &bits, 4);
+	}
+
+	// 用一对端点编码，返回平方误差之和
+	// 端点相等时4个调色板颜色相同，索引全为0，在BC1的3色模式下也不会选到透明的索引3
+	float TryEndpoints(const Kernels& kernels, const ColorBlock& block, uint16_t& color0, uint16_t& color1, uint8_t indices[16])
+	{
+		// 4色模式要求颜色0大于颜色1
+		if (color0 < color1)
+			std::swap(color0, color1);
+		int c0[3], c1[3];
+		Unpack565(color0, c0);
+		Unpack565(color1, c1);
+		float palette[4][3];
+		for (int c = 0; c < 3; ++c)
+		{
+			palette[0][c] = static_cast<float>(c0[c]);
+			palette[1][c] = static_cast<float>(c1[c]);
+			palette[2][c] = static_cast<float>(color0 == color1 ? c0[c] : (2 * c0[c] + c1[c]) / 3);
+			palette[3][c] = static_cast<float>(color0 == color1 ? c0[c] : (c0[c] + 2 * c1[c]) / 3);
+		}
+		return kernels.selectColors(block, palette, indices);
+	}
+
+	void EncodeColorBlock(const Kernels& kernels, const uint8_t* rgba, uint8_t* output)
+	{
+		ColorBlock block;
+		kernels.loadColors(rgba, block);
+		const float* sums = block.sums;
+
+		// 协方差(乘以16)
+		float cov[6] = {
+			sums[3] - sums[0] * sums[0] / 16.0f, sums[4] - sums[1] * sums[1] / 16.0f, sums[5] - sums[2] * sums[2] / 16.0f,
+			sums[6] - sums[0] * sums[1] / 16.0f, sums[7] - sums[0] * sums[2] / 16.0f, sums[8] - sums[1] * sums[2] / 16.0f
+		};
+		uint8_t indices[16];
+
+		// 纯色块
+		if (cov[0] <= 0.0f && cov[1] <= 0.0f && cov[2] <= 0.0f)
+		{
+			const SingleColorTables& tables = GetSingleColorTables();
+			int r = rgba[0], g = rgba[1], b = rgba[2];
+			uint16_t color0 = static_cast<uint16_t>(tables.table5[r][0] << 11 | tables.table6[g][0] << 5 | tables.table5[b][0]);
+			uint16_t color1 = static_cast<uint16_t>(tables.table5[r][1] << 11 | tables.table6[g][1] << 5 | tables.table5[b][1]);
+			uint8_t index = color0 > color1 ? 2 : color0 < color1 ? 3 : 0;
+			if (color0 < color1)
+				std::swap(color0, color1);
+			memset(indices, index, sizeof(indices));
+			WriteColorBlock(output, color0, color1, indices);
+			return;
+		}
+
+		// 幂迭代求主轴，初始向量取方差最大的通道所在的行
+		float mean[3] = { sums[0] / 16.0f, sums[1] / 16.0f, sums[2] / 16.0f };
+		const float matrix[3][3] = { { cov[0], cov[3], cov[4] }, { cov[3], cov[1], cov[5] }, { cov[4], cov[5], cov[2] } };
+		int row = cov[0] >= cov[1] && cov[0] >= cov[2] ? 0 : cov[1] >= cov[2] ? 1 : 2;
+		float axis[3] = { matrix[row][0], matrix[row][1], matrix[row][2] };
+		for (int iteration = 0; iteration < 8; ++iteration)
+		{
+			float x = matrix[0][0] * axis[0] + matrix[0][1] * axis[1] + matrix[0][2] * axis[2];
+			float y = matrix[1][0] * axis[0] + matrix[1][1] * axis[1] + matrix[1][2] * axis[2];
+			float z = matrix[2][0] * axis[0] + matrix[2][1] * axis[1] + matrix[2][2] * axis[2];
+			float scale = (std::max)((std::max)(std::fabs(x), std::fabs(y)), std::fabs(z));
+			if (scale <= 0.0f)
+				break;
+			axis[0] = x / scale;
+			axis[1] = y / scale;
+			axis[2] = z / scale;
+		}
+		float length = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+		for (int c = 0; c < 3; ++c)
+			axis[c] /= length;
+
+		// 端点取投影范围两端向内收缩1/16，减小两端的量化误差
+		float minT, maxT;
+		kernels.project(block, mean, axis, minT, maxT);
+		float inset = (maxT - minT) / 16.0f;
+		float end0[3], end1[3];
+		for (int c = 0; c < 3; ++c)
+		{
+			end0[c] = mean[c] + axis[c] * (maxT - inset);
+			end1[c] = mean[c] + axis[c] * (minT + inset);
+		}
+		uint16_t color0 = Pack565(end0), color1 = Pack565(end1);
+		float error = TryEndpoints(kernels, block, color0, color1, indices);
+
+		// 按选出的索引用最小二乘求端点，误差不再减小时停止
+		// 索引0~3对应颜色0的权重为3/3、0/3、2/3、1/3
+		static const int kWeight0[4] = { 3, 0, 2, 1 };
+		for (int iteration = 0; iteration < 2 && error > 0.0f; ++iteration)
+		{
+			float aa = 0.0f, bb = 0.0f, ab = 0.0f, ap[3] = {}, bp[3] = {};
+			for (int i = 0; i < 16; ++i)
+			{
+				float a = static_cast<float>(kWeight0[indices[i]]), b = 3.0f - a;
+				aa += a * a;
+				bb += b * b;
+				ab += a * b;
+				const float p[3] = { block.r[i], block.g[i], block.b[i] };
+				for (int c = 0; c < 3; ++c)
+				{
+					ap[c] += a * p[c];
+					bp[c] += b * p[c];
+				}
+			}
+			float det = aa * bb - ab * ab;
+			if (det == 0.0f)
+				break;
+			for (int c = 0; c < 3; ++c)
+			{
+				end0[c] = 3.0f * (ap[c] * bb - bp[c] * ab) / det;
+				end1[c] = 3.0f * (bp[c] * aa - ap[c] * ab) / det;
+			}
+
+			uint16_t refined0 = Pack565(end0), refined1 = Pack565(end1);
+			uint8_t refinedIndices[16];
+			float refinedError = TryEndpoints(kernels, block, refined0, refined1, refinedIndices);
+			if (refinedError >= error)
+				break;
+			error = refinedError;
+			color0 = refined0;
+			color1 = refined1;
+			memcpy(indices, refinedIndices, sizeof(indices));
+		}
+
+		WriteColorBlock(output, color0, color1, indices);
+	}
+
+	void EncodeChannelBlock(const Kernels& kernels, const uint8_t* rgba, int channel, uint8_t* output)
+	{
+		alignas(16) uint8_t values[16];
+		int minValue = 255, maxValue = 0;
+		for (int i = 0; i < 16; ++i)
+		{
+			values[i] = rgba[i * 4 + channel];
+			minValue = (std::min)(minValue, static_cast<int>(values[i]));
+			maxValue = (std::max)(maxValue, static_cast<int>(values[i]));
+		}
+
+		memset(output, 0, 8);
+		output[0] = static_cast<uint8_t>(maxValue);
+		output[1] = static_cast<uint8_t>(minValue);
+		if (minValue == maxValue)
+			return;
+
+		uint8_t indices[16];
+		kernels.selectChannel(values, minValue, maxValue, indices);
+		uint64_t bits = 0;
+		for (int i = 0; i < 16; ++i)
+			bits |= static_cast<uint64_t>(indices[i]) << (i * 3);
+		for (int i = 0; i < 6; ++i)
+			output[2 + i] = static_cast<uint8_t>(bits >> (i * 8));
+	}
+
+	void EncodeBlock(const Kernels& kernels, BcEncoder::Format format, const uint8_t* rgba, uint8_t* output)
+	{
+		switch (format)
+		{
+		case BcEncoder::Format::BC1:
+			EncodeColorBlock(kernels, rgba, output);
+			break;
+		case BcEncoder::Format::BC3:
+			EncodeChannelBlock(kernels, rgba, 3, output);
+			EncodeColorBlock(kernels, rgba, output + 8);
+			break;
+		case BcEncoder::Format::BC4:
+			EncodeChannelBlock(kernels, rgba, 0, output);
+			break;
+		case BcEncoder::Format::BC5:
+			EncodeChannelBlock(kernels, rgba, 0, output);
+			EncodeChannelBlock(kernels, rgba, 1, output + 8);
+			break;
+		}
+	}
+
+	//
+	// 解码
+	//
+
+	void DecodeColorBlock(const uint8_t* block, bool allowThreeColor, uint8_t* rgba, size_t stride)
+	{
+		uint16_t color0 = static_cast<uint16_t>(block[0] | block[1] << 8);
+		uint16_t color1 = static_cast<uint16_t>(block[2] | block[3] << 8);
+		uint32_t bits;
+		memcpy(&bits, block + 4, 4);
+
+		int palette[4][4];
+		Unpack565(color0, palette[0]);
+		Unpack565(color1, palette[1]);
+		palette[0][3] = palette[1][3] = 255;
+		bool fourColor = !allowThreeColor || color0 > color1;
+		for (int c = 0; c < 3; ++c)
+		{
+			palette[2][c] = fourColor ? (2 * palette[0][c] + palette[1][c]) / 3 : (palette[0][c] + palette[1][c]) / 2;
+			palette[3][c] = fourColor ? (palette[0][c] + 2 * palette[1][c]) / 3 : 0;
+		}
+		palette[2][3] = 255;
+		palette[3][3] = fourColor ? 255 : 0;
+
+		for (int i = 0; i < 16; ++i)
+		{
+			const int* color = palette[(bits >> (i * 2)) & 3];
+			uint8_t* pixel = rgba + (i / 4) * stride + (i % 4) * 4;
+			for (int c = 0; c < 4; ++c)
+				pixel[c] = static_cast<uint8_t>(color[c]);
+		}
+	}
+
+	void DecodeChannelBlock(const uint8_t* block, uint8_t* rgba, size_t stride, int channel)
+	{
+		int a0 = block[0], a1 = block[1];
+		int palette[8] = { a0, a1 };
+		if (a0 > a1)
+		{
+			for (int k = 1; k <= 6; ++k)
+				palette[k + 1] = ((7 - k) * a0 + k * a1 + 3) / 7;
+		}
+		else
+		{
+			for (int k = 1; k <= 4; ++k)
+				palette[k + 1] = ((5 - k) * a0 + k * a1 + 2) / 5;
+			palette[6] = 0;
+			palette[7] = 255;
+		}
+
+		uint64_t bits = 0;
+		for (int i = 0; i < 6; ++i)
+			bits |= static_cast<uint64_t>(block[2 + i]) << (i * 8);
+		for (int i = 0; i < 16; ++i)
+			rgba[(i / 4) * stride + (i % 4) * 4 + channel] = static_cast<uint8_t>(palette[(bits >> (i * 3)) & 7]);
+	}
+}
+
+uint32_t BcEncoder::GetDxgiFormat(Format format)
+{
+	switch (format)
+	{
+	case Format::BC1: return DdsFormat::BC1_UNORM;
+	case Format::BC3: return DdsFormat::BC3_UNORM;
+	case Format::BC4: return DdsFormat::BC4_UNORM;
+	default: return DdsFormat::BC5_UNORM;
+	}
+}
+
+size_t BcEncoder::GetBlockBytes(Format format)
+{
+	return format == Format::BC1 || format == Format::BC4 ? 8 : 16;
+}
+
+size_t BcEncoder::GetEncodedSize(Format format, uint32_t width, uint32_t height)
+{
+	return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * GetBlockBytes(format);
+}
+
+BcEncoder::Simd BcEncoder::GetBestSimd()
+{
+#ifdef BCENCODER_SIMD
+	static const Simd best = HasAVX2() ? Simd::AVX2 : HasSSE2() ? Simd::SSE2 : Simd::Scalar;
+	return best;
+#else
+	return Simd::Scalar;
+#endif
+}
+
+const char* BcEncoder::GetSimdName(Simd simd)
+{
+	switch (simd)
+	{
+	case Simd::Scalar: return "scalar";
+	case Simd::SSE2: return "SSE2";
+	case Simd::AVX2: return "AVX2";
+	default: return GetSimdName(GetBestSimd());
+	}
+}
+
+void BcEncoder::Encode(Format format, const uint8_t* rgba, uint32_t width, uint32_t height, size_t rowPitch,
+	uint8_t* output, ThreadPool* pool, Simd simd)
+{
+	Simd best = GetBestSimd();
+	if (simd == Simd::Best || static_cast<int>(simd) > static_cast<int>(best))
+		simd = best;
+	const Kernels& kernels = GetKernels(simd);
+	if (width == 0 || height == 0)
+		return;
+
+	uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+	size_t blockBytes = GetBlockBytes(format);
+	auto encodeRow = [&](size_t by)
+	{
+		// 把4x4块复制到连续的缓冲区，超出图像的部分重复边缘的像素
+		alignas(32) uint8_t block[64];
+		uint8_t* destination = output + by * blocksX * blockBytes;
+		for (uint32_t bx = 0; bx < blocksX; ++bx)
+		{
+			for (uint32_t j = 0; j < 4; ++j)
+			{
+				uint32_t y = (std::min)(static_cast<uint32_t>(by) * 4 + j, height - 1);
+				const uint8_t* row = rgba + y * rowPitch;
+				if (bx * 4 + 4 <= width)
+					memcpy(block + j * 16, row + bx * 16, 16);
+				else
+				{
+					for (uint32_t i = 0; i < 4; ++i)
+						memcpy(block + j * 16 + i * 4, row + (std::min)(bx * 4 + i, width - 1) * 4, 4);
+				}
+			}
+			EncodeBlock(kernels, format, block, destination + bx * blockBytes);
+		}
+	};
+
+	if (pool && blocksY > 1)
+		pool->ParallelFor(blocksY, encodeRow);
+	else
+	{
+		for (uint32_t by = 0; by < blocksY; ++by)
+			encodeRow(by);
+	}
+}
+
+void BcEncoder::Decode(Format format, const uint8_t* blocks, uint32_t width, uint32_t height,
+	uint8_t* rgba, size_t rowPitch)
+{
+	uint32_t blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+	size_t blockBytes = GetBlockBytes(format);
+	alignas(16) uint8_t pixels[64];
+	for (uint32_t by = 0; by < blocksY; ++by)
+	{
+		for (uint32_t bx = 0; bx < blocksX; ++bx)
+		{
+			const uint8_t* block = blocks + (static_cast<size_t>(by) * blocksX + bx) * blockBytes;
+			switch (format)
+			{
+			case Format::BC1:
+				DecodeColorBlock(block, true, pixels, 16);
+				break;
+			case Format::BC3:
+				DecodeColorBlock(block + 8, false, pixels, 16);
+				DecodeChannelBlock(block, pixels, 16, 3);
+				break;
+			case Format::BC4:
+			case Format::BC5:
+				for (int i = 0; i < 16; ++i)
+				{
+					pixels[i * 4] = pixels[i * 4 + 1] = pixels[i * 4 + 2] = 0;
+					pixels[i * 4 + 3] = 255;
+				}
+				DecodeChannelBlock(block, pixels, 16, 0);
+				if (format == Format::BC5)
+					DecodeChannelBlock(block + 8, pixels, 16, 1);
+				break;
+			}
+
+			// 只写回位于图像内的像素
+			for (uint32_t j = 0; j < 4 && by * 4 + j < height; ++j)
+			{
+				uint32_t count = (std::min)(4u, width - bx * 4);
+				memcpy(rgba + (by * 4 + j) * rowPitch + bx * 16, pixels + j * 16, count * 4);
+			}
+		}
+	}
+}
+
+double BcEncoder::ComputePsnr(Format format, const uint8_t* source, size_t sourceRowPitch,
+	const uint8_t* decoded, size_t decodedRowPitch, uint32_t width, uint32_t height)
+{
+	int channelCount = format == Format::BC3 ? 4 : format == Format::BC1 ? 3 : format == Format::BC5 ? 2 : 1;
+	uint64_t sum = 0;
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		const uint8_t* a = source + y * sourceRowPitch;
+		const uint8_t* b = decoded + y * decodedRowPitch;
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			for (int c = 0; c < channelCount; ++c)
+			{
+				int diff = a[x * 4 + c] - b[x * 4 + c];
+				sum += static_cast<uint64_t>(diff * diff);
+			}
+		}
+	}
+	if (sum == 0)
+		return 999.0;
+	double mse = static_cast<double>(sum) / (static_cast<double>(width) * height * channelCount);
+	return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
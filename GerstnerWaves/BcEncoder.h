@@ -0,0 +1,70 @@
+﻿//***************************************************************************************
+// BcEncoder.h
+// Licensed under the MIT License.
+//
+// CPU块压缩编码器(BC1/BC3/BC4/BC5)，用于把PNG/JPG等烘焙为DDS
+// - BC1/BC3的颜色: 按协方差的主轴求端点，选出每个像素最近的调色板颜色后再用最小二乘优化端点
+// - BC4/BC5与BC3的Alpha: 以块内的最大最小值为端点，按8级插值取整
+// - 热点部分(载入块、投影、选择索引)有标量、SSE2与AVX2三种实现，运行时选择CPU支持的最快一种
+//   三种实现只使用精确的整数运算或相同顺序的浮点运算，输出逐字节相同
+// - 按4x4块的行在线程池中并行编码
+// CPU block-compression encoder for BC1/BC3/BC4/BC5 with scalar, SSE2 and AVX2
+// kernels that produce bit-identical output, parallelised over rows of 4x4 blocks.
+//***************************************************************************************
+
+#ifndef BCENCODER_H
+#define BCENCODER_H
+
+#include <cstddef>
+#include <cstdint>
+
+class ThreadPool;
+
+namespace BcEncoder
+{
+	enum class Format
+	{
+		BC1,		// RGB，不透明
+		BC3,		// RGBA
+		BC4,		// 只编码R
+		BC5			// 只编码RG，如法线贴图
+	};
+
+	// 编码使用的指令集，Best表示CPU支持的最快一种
+	enum class Simd
+	{
+		Scalar,
+		SSE2,
+		AVX2,
+		Best
+	};
+
+	// 对应的DXGI_FORMAT(见DdsFormat)
+	uint32_t GetDxgiFormat(Format format);
+	// 每个4x4块的字节数
+	size_t GetBlockBytes(Format format);
+	// 编码后的字节数，宽高按4向上取整
+	size_t GetEncodedSize(Format format, uint32_t width, uint32_t height);
+
+	// CPU支持的最快实现
+	Simd GetBestSimd();
+	// 实现的名称，用于输出
+	const char* GetSimdName(Simd simd);
+
+	// 编码RGBA8图像，宽高不是4的倍数时边缘的块重复最后一行与最后一列
+	// [In]rowPitch		源图像一行的字节数
+	// [Out]output		至少GetEncodedSize字节，块按行优先排列
+	// pool不为nullptr时并行编码，simd指定的实现不受CPU支持时退回到支持的最快一种
+	void Encode(Format format, const uint8_t* rgba, uint32_t width, uint32_t height, size_t rowPitch,
+		uint8_t* output, ThreadPool* pool = nullptr, Simd simd = Simd::Best);
+
+	// 解码为RGBA8，BC4与BC5没有的通道填0，Alpha填255
+	void Decode(Format format, const uint8_t* blocks, uint32_t width, uint32_t height,
+		uint8_t* rgba, size_t rowPitch);
+
+	// 按格式编码的通道(BC1为RGB，BC3为RGBA，BC4为R，BC5为RG)计算峰值信噪比(dB)，两幅图像相同时返回999
+	double ComputePsnr(Format format, const uint8_t* source, size_t sourceRowPitch,
+		const uint8_t* decoded, size_t decodedRowPitch, uint32_t width, uint32_t height);
+}
+
+#endif
@@ -76,6 +76,11 @@ D3D11_VIEWPORT Camera::GetViewPort() const
 	return m_ViewPort;
 }
 
+float Camera::GetFovY() const
+{
+	return m_FovY;
+}
+
 void Camera::SetFrustum(float fovY, float aspect, float nearZ, float farZ)
 {
 	m_FovY = fovY;
@@ -58,6 +58,9 @@ public:
 	// 获取视口
 	D3D11_VIEWPORT GetViewPort() const;
 
+	// 获取竖直方向的视野角度(弧度)
+	float GetFovY() const;
+
 
 	// 设置视锥体
 	void SetFrustum(float fovY, float aspect, float nearZ, float farZ);
@@ -280,6 +280,44 @@ std::vector<Transform> XM_CALLCONV Collision::FrustumCulling3(
 	return acceptedData;
 }
 
+size_t XM_CALLCONV Collision::ClusterCulling(
+	const std::vector<MeshCluster::Cluster>& clusters, DirectX::FXMMATRIX World, const Camera& camera, std::vector<IndexRange>& visibleRanges)
+{
+	visibleRanges.clear();
+
+	BoundingFrustum frustum, localFrustum;
+	BoundingFrustum::CreateFromMatrix(frustum, camera.GetProjXM());
+	XMMATRIX InvView = XMMatrixInverse(nullptr, camera.GetViewXM());
+	XMMATRIX InvWorld = XMMatrixInverse(nullptr, World);
+
+	// 将视锥体与观察点变换到物体所在的局部坐标系中，避免逐簇变换包围体
+	frustum.Transform(localFrustum, InvView * InvWorld);
+	XMFLOAT3 eye;
+	XMStoreFloat3(&eye, XMVector3TransformCoord(camera.GetPositionXM(), InvWorld));
+
+	size_t visibleCount = 0;
+	for (const auto& cluster : clusters)
+	{
+		// 法线锥背面裁剪的开销最小，先进行
+		if (MeshCluster::IsBackfacing(cluster, &eye.x))
+			continue;
+
+		BoundingSphere sphere(XMFLOAT3(cluster.center), cluster.radius);
+		if (!localFrustum.Intersects(sphere))
+			continue;
+
+		++visibleCount;
+		// 与上一段索引相邻则合并，减少绘制调用
+		if (!visibleRanges.empty() &&
+			visibleRanges.back().startIndex + visibleRanges.back().indexCount == cluster.startIndex)
+			visibleRanges.back().indexCount += cluster.indexCount;
+		else
+			visibleRanges.push_back(IndexRange{ cluster.startIndex, cluster.indexCount });
+	}
+
+	return visibleCount;
+}
+
 Collision::WireFrameData Collision::CreateFromCorners(const DirectX::XMFLOAT3(&corners)[8], const DirectX::XMFLOAT4& color)
 {
 	WireFrameData data;
@@ -14,6 +14,7 @@
 #include <vector>
 #include "Vertex.h"
 #include "Camera.h"
+#include "MeshCluster.h"
 
 
 struct Ray
@@ -44,6 +45,13 @@ public:
 		std::vector<WORD> indexVec;					// 索引数组
 	};
 
+	// 一段需要绘制的索引
+	struct IndexRange
+	{
+		UINT startIndex;
+		UINT indexCount;
+	};
+
 	//
 	// 包围盒线框的创建
 	//
@@ -81,6 +89,15 @@ public:
 	static std::vector<Transform> XM_CALLCONV FrustumCulling3(
 		const std::vector<Transform>& transforms, const DirectX::BoundingBox& localBox, DirectX::FXMMATRIX View, DirectX::CXMMATRIX Proj);
 
+	//
+	// 簇裁剪
+	//
+
+	// 对模型空间下的三角形簇进行视锥体裁剪与法线锥背面裁剪，可见的相邻簇会合并成一段索引
+	// 背面裁剪在局部坐标系下进行，物体存在非均匀缩放时结果偏保守
+	// 返回值: 可见簇的数目
+	static size_t XM_CALLCONV ClusterCulling(
+		const std::vector<MeshCluster::Cluster>& clusters, DirectX::FXMMATRIX World, const Camera& camera, std::vector<IndexRange>& visibleRanges);
 
 private:
 	static WireFrameData CreateFromCorners(const DirectX::XMFLOAT3(&corners)[8], const DirectX::XMFLOAT4& color);
@@ -0,0 +1,97 @@
+﻿#include "CubeMapLayout.h"
+#include "ThreadPool.h"
+#include <cstring>
+
+namespace
+{
+	// 各布局中每个面所在的格子(列, 行)，按+X、-X、+Y、-Y、+Z、-Z排列
+	const uint32_t kHorizontalCross[6][2] = { { 2, 1 }, { 0, 1 }, { 1, 0 }, { 1, 2 }, { 1, 1 }, { 3, 1 } };
+	const uint32_t kVerticalCross[6][2] = { { 2, 1 }, { 0, 1 }, { 1, 0 }, { 1, 2 }, { 1, 1 }, { 1, 3 } };
+}
+
+CubeMapLayout::Layout CubeMapLayout::DetectLayout(uint32_t width, uint32_t height)
+{
+	if (width == 0 || height == 0)
+		return Layout::Unknown;
+	if (width % 4 == 0 && width / 4 * 3 == height)
+		return Layout::HorizontalCross;
+	if (height % 4 == 0 && height / 4 * 3 == width)
+		return Layout::VerticalCross;
+	if (width % 6 == 0 && width / 6 == height)
+		return Layout::HorizontalStrip;
+	if (height % 6 == 0 && height / 6 == width)
+		return Layout::VerticalStrip;
+	return Layout::Unknown;
+}
+
+const char* CubeMapLayout::GetLayoutName(Layout layout)
+{
+	switch (layout)
+	{
+	case Layout::HorizontalCross: return "horizontal cross";
+	case Layout::VerticalCross: return "vertical cross";
+	case Layout::HorizontalStrip: return "horizontal strip";
+	case Layout::VerticalStrip: return "vertical strip";
+	case Layout::Faces: return "6 faces";
+	default: return "unknown";
+	}
+}
+
+bool CubeMapLayout::Split(const uint8_t* pixels, uint32_t width, uint32_t height, size_t rowPitch, Layout layout,
+	FaceView (&faces)[6], uint32_t& faceSize, std::vector<uint8_t>& scratch)
+{
+	if (layout == Layout::Faces || DetectLayout(width, height) != layout)
+		return false;
+
+	faceSize = (layout == Layout::HorizontalCross || layout == Layout::HorizontalStrip) ?
+		width / (layout == Layout::HorizontalCross ? 4 : 6) : height / (layout == Layout::VerticalCross ? 4 : 6);
+	for (uint32_t i = 0; i < 6; ++i)
+	{
+		uint32_t column, row;
+		switch (layout)
+		{
+		case Layout::HorizontalCross: column = kHorizontalCross[i][0]; row = kHorizontalCross[i][1]; break;
+		case Layout::VerticalCross: column = kVerticalCross[i][0]; row = kVerticalCross[i][1]; break;
+		case Layout::HorizontalStrip: column = i; row = 0; break;
+		default: column = 0; row = i; break;
+		}
+		faces[i].data = pixels + static_cast<size_t>(row) * faceSize * rowPitch + static_cast<size_t>(column) * faceSize * 4;
+		faces[i].rowPitch = rowPitch;
+	}
+
+	if (layout == Layout::VerticalCross)
+	{
+		// -Z面在展开图中上下左右都是反的，旋转180度后复制出来
+		size_t facePitch = static_cast<size_t>(faceSize) * 4;
+		scratch.resize(facePitch * faceSize);
+		const uint8_t* source = faces[5].data;
+		for (uint32_t y = 0; y < faceSize; ++y)
+		{
+			const uint8_t* src = source + static_cast<size_t>(faceSize - 1 - y) * rowPitch;
+			uint8_t* dst = scratch.data() + y * facePitch;
+			for (uint32_t x = 0; x < faceSize; ++x)
+				memcpy(dst + x * 4, src + (faceSize - 1 - x) * 4, 4);
+		}
+		faces[5].data = scratch.data();
+		faces[5].rowPitch = facePitch;
+	}
+	return true;
+}
+
+void CubeMapLayout::GenerateMips(const FaceView* faces, size_t faceCount, uint32_t faceSize, const MipGenerator::Options& options,
+	std::vector<std::vector<MipGenerator::Level>>& levels, uint32_t maxLevels, ThreadPool* pool)
+{
+	levels.resize(faceCount);
+	auto generate = [&](size_t i) {
+		MipGenerator::Generate(faces[i].data, faceSize, faceSize, faces[i].rowPitch, options, levels[i], maxLevels, pool);
+	};
+
+	// ParallelFor可以嵌套，面内的行并行能用上面之间剩余的线程
+	if (pool)
+		pool->ParallelFor(faceCount, generate);
+	else
+	{
+		for (size_t i = 0; i < faceCount; ++i)
+			generate(i);
+	}
+}
@@ -0,0 +1,60 @@
+﻿//***************************************************************************************
+// CubeMapLayout.h
+// Licensed under the MIT License.
+//
+// 立方体贴图的展开图拆分
+// - 按宽高比识别水平十字(4:3)、竖直十字(3:4)、水平条带(6:1)与竖直条带(1:6)
+// - 每个面是源图像中按源行距访问的一块区域，不复制像素；只有竖直十字中旋转了180度的-Z面需要复制
+// - 6张单独的图像可以直接作为6个面的视图
+// - 各面的mip在线程池中并行生成，面内再按行并行
+// Cube map layout detection and zero-copy face views over cross and strip images,
+// plus parallel per-face mip generation.
+//***************************************************************************************
+
+#ifndef CUBEMAPLAYOUT_H
+#define CUBEMAPLAYOUT_H
+
+#include "MipGenerator.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+namespace CubeMapLayout
+{
+	enum class Layout
+	{
+		Unknown,
+		HorizontalCross,	// 第二行为-X、+Z、+X、-Z，+Y与-Y位于+Z的上下
+		VerticalCross,		// 第二行为-X、+Z、+X，+Y、-Y、-Z依次位于+Z的上下，-Z旋转了180度
+		HorizontalStrip,	// 按+X、-X、+Y、-Y、+Z、-Z从左到右排列
+		VerticalStrip,		// 按+X、-X、+Y、-Y、+Z、-Z从上到下排列
+		Faces				// 6张单独的图像
+	};
+
+	// 一个面的RGBA8(或BGRA8)像素，只引用源图像
+	struct FaceView
+	{
+		const uint8_t* data;	// 面左上角的像素
+		size_t rowPitch;		// 源图像一行的字节数
+	};
+
+	// 按宽高比识别单张图像的布局，无法识别时返回Unknown
+	Layout DetectLayout(uint32_t width, uint32_t height);
+	// 布局的名称，用于输出
+	const char* GetLayoutName(Layout layout);
+
+	// 按D3D11_TEXTURECUBE_FACE的顺序(+X、-X、+Y、-Y、+Z、-Z)取出6个面，faceSize返回面的边长
+	// 竖直十字的-Z面旋转后复制到scratch中，其他面直接指向源图像，使用期间源图像与scratch需要保持有效
+	// 布局与尺寸不符时返回false
+	bool Split(const uint8_t* pixels, uint32_t width, uint32_t height, size_t rowPitch, Layout layout,
+		FaceView (&faces)[6], uint32_t& faceSize, std::vector<uint8_t>& scratch);
+
+	// 为faceCount个边长为faceSize的面生成mip链，levels[i]对应faces[i]
+	// 各面在pool中并行生成，maxLevels与MipGenerator::Generate相同
+	void GenerateMips(const FaceView* faces, size_t faceCount, uint32_t faceSize, const MipGenerator::Options& options,
+		std::vector<std::vector<MipGenerator::Level>>& levels, uint32_t maxLevels = 0, ThreadPool* pool = nullptr);
+}
+
+#endif
@@ -0,0 +1,561 @@
+﻿#include "DdsReader.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	// DDS文件结构，见DDSTextureLoader.cpp
+	const uint32_t kDdsMagic = 0x20534444;	// "DDS "
+
+	constexpr uint32_t MakeFourCC(char ch0, char ch1, char ch2, char ch3)
+	{
+		return static_cast<uint32_t>(static_cast<uint8_t>(ch0)) | static_cast<uint32_t>(static_cast<uint8_t>(ch1)) << 8 |
+			static_cast<uint32_t>(static_cast<uint8_t>(ch2)) << 16 | static_cast<uint32_t>(static_cast<uint8_t>(ch3)) << 24;
+	}
+
+#pragma pack(push, 1)
+	struct DdsPixelFormat
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t fourCC;
+		uint32_t rgbBitCount;
+		uint32_t rBitMask;
+		uint32_t gBitMask;
+		uint32_t bBitMask;
+		uint32_t aBitMask;
+	};
+
+	struct DdsHeader
+	{
+		uint32_t size;
+		uint32_t flags;
+		uint32_t height;
+		uint32_t width;
+		uint32_t pitchOrLinearSize;
+		uint32_t depth;
+		uint32_t mipMapCount;
+		uint32_t reserved1[11];
+		DdsPixelFormat ddspf;
+		uint32_t caps;
+		uint32_t caps2;
+		uint32_t caps3;
+		uint32_t caps4;
+		uint32_t reserved2;
+	};
+
+	struct DdsHeaderDxt10
+	{
+		uint32_t dxgiFormat;
+		uint32_t resourceDimension;
+		uint32_t miscFlag;
+		uint32_t arraySize;
+		uint32_t miscFlags2;
+	};
+#pragma pack(pop)
+
+	static_assert(sizeof(DdsHeader) == 124, "DDS header size mismatch");
+	static_assert(sizeof(DdsHeaderDxt10) == 20, "DDS DX10 header size mismatch");
+
+	const uint32_t kDdsFourCC = 0x00000004;
+	const uint32_t kDdsRgb = 0x00000040;
+	const uint32_t kDdsLuminance = 0x00020000;
+	const uint32_t kDdsAlpha = 0x00000002;
+	const uint32_t kDdsBumpDuDv = 0x00080000;
+	const uint32_t kDdsHeaderFlagsVolume = 0x00800000;
+	const uint32_t kDdsHeight = 0x00000002;
+	const uint32_t kDdsHeaderFlagsTexture = 0x00001007;		// CAPS | HEIGHT | WIDTH | PIXELFORMAT
+	const uint32_t kDdsHeaderFlagsMipmap = 0x00020000;
+	const uint32_t kDdsHeaderFlagsPitch = 0x00000008;
+	const uint32_t kDdsHeaderFlagsLinearSize = 0x00080000;
+	const uint32_t kDdsSurfaceFlagsTexture = 0x00001000;
+	const uint32_t kDdsSurfaceFlagsMipmap = 0x00400008;		// COMPLEX | MIPMAP
+	const uint32_t kDdsSurfaceFlagsCubeMap = 0x00000008;	// COMPLEX
+	const uint32_t kDdsFlagsVolume = 0x00200000;
+	const uint32_t kDdsCubeMap = 0x00000200;
+	const uint32_t kDdsCubeMapAllFaces = 0x0000FE00;
+	const uint32_t kMiscTextureCube = 0x4;			// D3D11_RESOURCE_MISC_TEXTURECUBE
+	const uint32_t kAlphaModeMask = 0x7;
+
+	// D3D11的尺寸限制
+	const uint32_t kMaxMipLevels = 15;
+	const uint32_t kMaxTexture1DSize = 16384;
+	const uint32_t kMaxTexture2DSize = 16384;
+	const uint32_t kMaxTexture3DSize = 2048;
+	const uint32_t kMaxArraySize = 2048;
+
+	bool IsBitMask(const DdsPixelFormat& ddpf, uint32_t r, uint32_t g, uint32_t b, uint32_t a)
+	{
+		return ddpf.rBitMask == r && ddpf.gBitMask == g && ddpf.bBitMask == b && ddpf.aBitMask == a;
+	}
+
+	// 从旧式的像素格式推导DXGI格式，与DDSTextureLoader的GetDXGIFormat相同
+	uint32_t GetLegacyFormat(const DdsPixelFormat& ddpf)
+	{
+		using namespace DdsFormat;
+		if (ddpf.flags & kDdsRgb)
+		{
+			switch (ddpf.rgbBitCount)
+			{
+			case 32:
+				if (IsBitMask(ddpf, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000))
+					return R8G8B8A8_UNORM;
+				if (IsBitMask(ddpf, 0x00ff0000, 0x0000ff00, 0x000000ff, 0xff000000))
+					return B8G8R8A8_UNORM;
+				if (IsBitMask(ddpf, 0x00ff0000, 0x0000ff00, 0x000000ff, 0x00000000))
+					return B8G8R8X8_UNORM;
+				// D3DX写出的10:10:10:2格式交换了红蓝通道的掩码
+				if (IsBitMask(ddpf, 0x3ff00000, 0x000ffc00, 0x000003ff, 0xc0000000))
+					return R10G10B10A2_UNORM;
+				if (IsBitMask(ddpf, 0x0000ffff, 0xffff0000, 0x00000000, 0x00000000))
+					return R16G16_UNORM;
+				if (IsBitMask(ddpf, 0xffffffff, 0x00000000, 0x00000000, 0x00000000))
+					return R32_FLOAT;
+				break;
+
+			case 16:
+				if (IsBitMask(ddpf, 0x7c00, 0x03e0, 0x001f, 0x8000))
+					return B5G5R5A1_UNORM;
+				if (IsBitMask(ddpf, 0xf800, 0x07e0, 0x001f, 0x0000))
+					return B5G6R5_UNORM;
+				if (IsBitMask(ddpf, 0x0f00, 0x00f0, 0x000f, 0xf000))
+					return B4G4R4A4_UNORM;
+				break;
+			}
+		}
+		else if (ddpf.flags & kDdsLuminance)
+		{
+			if (ddpf.rgbBitCount == 8)
+			{
+				if (IsBitMask(ddpf, 0x000000ff, 0x00000000, 0x00000000, 0x00000000))
+					return R8_UNORM;
+				if (IsBitMask(ddpf, 0x000000ff, 0x00000000, 0x00000000, 0x0000ff00))
+					return R8G8_UNORM;
+			}
+			if (ddpf.rgbBitCount == 16)
+			{
+				if (IsBitMask(ddpf, 0x0000ffff, 0x00000000, 0x00000000, 0x00000000))
+					return R16_UNORM;
+				if (IsBitMask(ddpf, 0x000000ff, 0x00000000, 0x00000000, 0x0000ff00))
+					return R8G8_UNORM;
+			}
+		}
+		else if (ddpf.flags & kDdsAlpha)
+		{
+			if (ddpf.rgbBitCount == 8)
+				return A8_UNORM;
+		}
+		else if (ddpf.flags & kDdsBumpDuDv)
+		{
+			if (ddpf.rgbBitCount == 16 && IsBitMask(ddpf, 0x00ff, 0xff00, 0x0000, 0x0000))
+				return R8G8_SNORM;
+			if (ddpf.rgbBitCount == 32)
+			{
+				if (IsBitMask(ddpf, 0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000))
+					return R8G8B8A8_SNORM;
+				if (IsBitMask(ddpf, 0x0000ffff, 0xffff0000, 0x00000000, 0x00000000))
+					return R16G16_SNORM;
+			}
+		}
+		else if (ddpf.flags & kDdsFourCC)
+		{
+			switch (ddpf.fourCC)
+			{
+			case MakeFourCC('D', 'X', 'T', '1'): return BC1_UNORM;
+			case MakeFourCC('D', 'X', 'T', '3'): return BC2_UNORM;
+			case MakeFourCC('D', 'X', 'T', '5'): return BC3_UNORM;
+			// 预乘Alpha的格式与对应的BC格式存储方式相同
+			case MakeFourCC('D', 'X', 'T', '2'): return BC2_UNORM;
+			case MakeFourCC('D', 'X', 'T', '4'): return BC3_UNORM;
+			case MakeFourCC('A', 'T', 'I', '1'): return BC4_UNORM;
+			case MakeFourCC('B', 'C', '4', 'U'): return BC4_UNORM;
+			case MakeFourCC('B', 'C', '4', 'S'): return BC4_SNORM;
+			case MakeFourCC('A', 'T', 'I', '2'): return BC5_UNORM;
+			case MakeFourCC('B', 'C', '5', 'U'): return BC5_UNORM;
+			case MakeFourCC('B', 'C', '5', 'S'): return BC5_SNORM;
+			case MakeFourCC('R', 'G', 'B', 'G'): return R8G8_B8G8_UNORM;
+			case MakeFourCC('G', 'R', 'G', 'B'): return G8R8_G8B8_UNORM;
+			case MakeFourCC('Y', 'U', 'Y', '2'): return YUY2;
+			// D3DFORMAT的枚举值
+			case 36: return R16G16B16A16_UNORM;		// D3DFMT_A16B16G16R16
+			case 110: return R16G16B16A16_SNORM;	// D3DFMT_Q16W16V16U16
+			case 111: return R16_FLOAT;				// D3DFMT_R16F
+			case 112: return R16G16_FLOAT;			// D3DFMT_G16R16F
+			case 113: return R16G16B16A16_FLOAT;	// D3DFMT_A16B16G16R16F
+			case 114: return R32_FLOAT;				// D3DFMT_R32F
+			case 115: return R32G32_FLOAT;			// D3DFMT_G32R32F
+			case 116: return R32G32B32A32_FLOAT;	// D3DFMT_A32B32G32R32F
+			}
+		}
+
+		return UNKNOWN;
+	}
+}
+
+DdsReader::DdsReader()
+	: m_Error(""), m_Dimension(Dimension::Unknown), m_Format(DdsFormat::UNKNOWN), m_Width(), m_Height(), m_Depth(),
+	m_MipCount(), m_ArraySize(), m_IsCubeMap(), m_AlphaMode(AlphaMode::Unknown), m_DataSize()
+{
+}
+
+bool DdsReader::Fail(const char* error)
+{
+	m_Error = error;
+	m_Subresources.clear();
+	m_DataSize = 0;
+	return false;
+}
+
+bool DdsReader::Parse(const uint8_t* data, size_t size)
+{
+	m_Error = "";
+	m_Subresources.clear();
+	m_DataSize = 0;
+
+	//
+	// 文件头
+	//
+	uint32_t magic;
+	DdsHeader header;
+	if (!data || size < sizeof(magic) + sizeof(header))
+		return Fail("file too small");
+	memcpy(&magic, data, sizeof(magic));
+	memcpy(&header, data + sizeof(magic), sizeof(header));
+	if (magic != kDdsMagic || header.size != sizeof(DdsHeader) || header.ddspf.size != sizeof(DdsPixelFormat))
+		return Fail("invalid header");
+
+	size_t offset = sizeof(magic) + sizeof(header);
+	m_Width = header.width;
+	m_Height = header.height;
+	m_Depth = header.depth;
+	m_MipCount = (std::max)(header.mipMapCount, 1u);
+	m_ArraySize = 1;
+	m_IsCubeMap = false;
+	m_AlphaMode = AlphaMode::Unknown;
+
+	if ((header.ddspf.flags & kDdsFourCC) && header.ddspf.fourCC == MakeFourCC('D', 'X', '1', '0'))
+	{
+		DdsHeaderDxt10 dxt10;
+		if (size < offset + sizeof(dxt10))
+			return Fail("file too small for DX10 header");
+		memcpy(&dxt10, data + offset, sizeof(dxt10));
+		offset += sizeof(dxt10);
+
+		m_ArraySize = dxt10.arraySize;
+		if (m_ArraySize == 0)
+			return Fail("zero array size");
+
+		m_Format = dxt10.dxgiFormat;
+		if (m_Format == DdsFormat::AI44 || m_Format == DdsFormat::IA44 ||
+			m_Format == DdsFormat::P8 || m_Format == DdsFormat::A8P8 || GetBitsPerPixel(m_Format) == 0)
+			return Fail("unsupported format");
+
+		switch (dxt10.resourceDimension)
+		{
+		case static_cast<uint32_t>(Dimension::Texture1D):
+			// D3DX写出的一维纹理高度固定为1
+			if ((header.flags & kDdsHeight) && m_Height != 1)
+				return Fail("invalid 1D texture height");
+			m_Height = m_Depth = 1;
+			break;
+
+		case static_cast<uint32_t>(Dimension::Texture2D):
+			if (dxt10.miscFlag & kMiscTextureCube)
+			{
+				if (m_ArraySize > kMaxArraySize / 6)
+					return Fail("array too large");
+				m_ArraySize *= 6;
+				m_IsCubeMap = true;
+			}
+			m_Depth = 1;
+			break;
+
+		case static_cast<uint32_t>(Dimension::Texture3D):
+			if (!(header.flags & kDdsHeaderFlagsVolume))
+				return Fail("volume flag missing");
+			if (m_ArraySize > 1)
+				return Fail("volume texture arrays are not supported");
+			break;
+
+		default:
+			return Fail("unsupported resource dimension");
+		}
+		m_Dimension = static_cast<Dimension>(dxt10.resourceDimension);
+
+		uint32_t alphaMode = dxt10.miscFlags2 & kAlphaModeMask;
+		if (alphaMode <= static_cast<uint32_t>(AlphaMode::Custom))
+			m_AlphaMode = static_cast<AlphaMode>(alphaMode);
+	}
+	else
+	{
+		m_Format = GetLegacyFormat(header.ddspf);
+		if (m_Format == DdsFormat::UNKNOWN)
+			return Fail("unsupported pixel format");
+
+		if (header.flags & kDdsHeaderFlagsVolume)
+		{
+			m_Dimension = Dimension::Texture3D;
+		}
+		else
+		{
+			if (header.caps2 & kDdsCubeMap)
+			{
+				// 要求六个面都存在
+				if ((header.caps2 & kDdsCubeMapAllFaces) != kDdsCubeMapAllFaces)
+					return Fail("partial cube maps are not supported");
+				m_ArraySize = 6;
+				m_IsCubeMap = true;
+			}
+			m_Depth = 1;
+			m_Dimension = Dimension::Texture2D;
+		}
+
+		if ((header.ddspf.flags & kDdsFourCC) &&
+			(header.ddspf.fourCC == MakeFourCC('D', 'X', 'T', '2') || header.ddspf.fourCC == MakeFourCC('D', 'X', 'T', '4')))
+			m_AlphaMode = AlphaMode::Premultiplied;
+	}
+
+	//
+	// 尺寸限制(不信任超出D3D11硬件要求的元数据)
+	//
+	if (m_MipCount > kMaxMipLevels)
+		return Fail("too many mip levels");
+	if (m_Width == 0 || m_Height == 0 || m_Depth == 0)
+		return Fail("zero dimension");
+	uint32_t maxSize = m_Dimension == Dimension::Texture1D ? kMaxTexture1DSize :
+		m_Dimension == Dimension::Texture2D ? kMaxTexture2DSize : kMaxTexture3DSize;
+	if (m_ArraySize > kMaxArraySize || m_Width > maxSize || m_Height > maxSize || m_Depth > maxSize)
+		return Fail("texture too large");
+
+	//
+	// 枚举子资源，所有数组元素依次存放，每个元素内按mip从大到小
+	//
+	m_Subresources.reserve(static_cast<size_t>(m_ArraySize) * m_MipCount);
+	const uint8_t* bits = data + offset;
+	size_t remaining = size - offset;
+	for (uint32_t item = 0; item < m_ArraySize; ++item)
+	{
+		uint32_t width = m_Width, height = m_Height, depth = m_Depth;
+		for (uint32_t mip = 0; mip < m_MipCount; ++mip)
+		{
+			Subresource subresource;
+			if (!GetSurfaceInfo(width, height, m_Format, subresource.rowPitch, subresource.slicePitch, subresource.rowCount))
+				return Fail("surface too large");
+
+			// slicePitch不超过32位，depth不超过2048，乘积不会溢出64位
+			uint64_t byteSize = static_cast<uint64_t>(subresource.slicePitch) * depth;
+			if (byteSize > remaining)
+				return Fail("truncated data");
+
+			subresource.data = bits;
+			subresource.width = width;
+			subresource.height = height;
+			subresource.depth = depth;
+			m_Subresources.push_back(subresource);
+
+			bits += byteSize;
+			remaining -= static_cast<size_t>(byteSize);
+			width = (std::max)(width >> 1, 1u);
+			height = (std::max)(height >> 1, 1u);
+			depth = (std::max)(depth >> 1, 1u);
+		}
+	}
+	m_DataSize = static_cast<size_t>(bits - (data + offset));
+
+	return true;
+}
+
+uint32_t DdsReader::GetBitsPerPixel(uint32_t format)
+{
+	using namespace DdsFormat;
+	switch (format)
+	{
+	case R32G32B32A32_TYPELESS: case R32G32B32A32_FLOAT: case R32G32B32A32_UINT: case R32G32B32A32_SINT:
+		return 128;
+
+	case R32G32B32_TYPELESS: case R32G32B32_FLOAT: case R32G32B32_UINT: case R32G32B32_SINT:
+		return 96;
+
+	case R16G16B16A16_TYPELESS: case R16G16B16A16_FLOAT: case R16G16B16A16_UNORM: case R16G16B16A16_UINT:
+	case R16G16B16A16_SNORM: case R16G16B16A16_SINT: case R32G32_TYPELESS: case R32G32_FLOAT: case R32G32_UINT:
+	case R32G32_SINT: case R32G8X24_TYPELESS: case D32_FLOAT_S8X24_UINT: case R32_FLOAT_X8X24_TYPELESS:
+	case X32_TYPELESS_G8X24_UINT: case Y416: case Y210: case Y216:
+		return 64;
+
+	case R10G10B10A2_TYPELESS: case R10G10B10A2_UNORM: case R10G10B10A2_UINT: case R11G11B10_FLOAT:
+	case R8G8B8A8_TYPELESS: case R8G8B8A8_UNORM: case R8G8B8A8_UNORM_SRGB: case R8G8B8A8_UINT: case R8G8B8A8_SNORM:
+	case R8G8B8A8_SINT: case R16G16_TYPELESS: case R16G16_FLOAT: case R16G16_UNORM: case R16G16_UINT:
+	case R16G16_SNORM: case R16G16_SINT: case R32_TYPELESS: case D32_FLOAT: case R32_FLOAT: case R32_UINT:
+	case R32_SINT: case R24G8_TYPELESS: case D24_UNORM_S8_UINT: case R24_UNORM_X8_TYPELESS: case X24_TYPELESS_G8_UINT:
+	case R9G9B9E5_SHAREDEXP: case R8G8_B8G8_UNORM: case G8R8_G8B8_UNORM: case B8G8R8A8_UNORM: case B8G8R8X8_UNORM:
+	case R10G10B10_XR_BIAS_A2_UNORM: case B8G8R8A8_TYPELESS: case B8G8R8A8_UNORM_SRGB: case B8G8R8X8_TYPELESS:
+	case B8G8R8X8_UNORM_SRGB: case AYUV: case Y410: case YUY2:
+		return 32;
+
+	case P010: case P016:
+		return 24;
+
+	case R8G8_TYPELESS: case R8G8_UNORM: case R8G8_UINT: case R8G8_SNORM: case R8G8_SINT: case R16_TYPELESS:
+	case R16_FLOAT: case D16_UNORM: case R16_UNORM: case R16_UINT: case R16_SNORM: case R16_SINT:
+	case B5G6R5_UNORM: case B5G5R5A1_UNORM: case A8P8: case B4G4R4A4_UNORM:
+		return 16;
+
+	case NV12: case OPAQUE_420: case NV11:
+		return 12;
+
+	case R8_TYPELESS: case R8_UNORM: case R8_UINT: case R8_SNORM: case R8_SINT: case A8_UNORM:
+	case AI44: case IA44: case P8:
+		return 8;
+
+	case R1_UNORM:
+		return 1;
+
+	case BC1_TYPELESS: case BC1_UNORM: case BC1_UNORM_SRGB: case BC4_TYPELESS: case BC4_UNORM: case BC4_SNORM:
+		return 4;
+
+	case BC2_TYPELESS: case BC2_UNORM: case BC2_UNORM_SRGB: case BC3_TYPELESS: case BC3_UNORM: case BC3_UNORM_SRGB:
+	case BC5_TYPELESS: case BC5_UNORM: case BC5_SNORM: case BC6H_TYPELESS: case BC6H_UF16: case BC6H_SF16:
+	case BC7_TYPELESS: case BC7_UNORM: case BC7_UNORM_SRGB:
+		return 8;
+
+	default:
+		return 0;
+	}
+}
+
+bool DdsReader::IsBlockCompressed(uint32_t format)
+{
+	return (format >= DdsFormat::BC1_TYPELESS && format <= DdsFormat::BC5_SNORM) ||
+		(format >= DdsFormat::BC6H_TYPELESS && format <= DdsFormat::BC7_UNORM_SRGB);
+}
+
+bool DdsReader::GetSurfaceInfo(uint32_t width, uint32_t height, uint32_t format,
+	size_t& rowPitch, size_t& slicePitch, size_t& rowCount)
+{
+	using namespace DdsFormat;
+	uint64_t rowBytes = 0, numRows = 0, numBytes = 0;
+
+	// 块压缩、打包与平面格式的每块(每对像素)字节数
+	uint64_t bpe = 0;
+	bool bc = false, packed = false, planar = false;
+	switch (format)
+	{
+	case BC1_TYPELESS: case BC1_UNORM: case BC1_UNORM_SRGB: case BC4_TYPELESS: case BC4_UNORM: case BC4_SNORM:
+		bc = true; bpe = 8; break;
+	case BC2_TYPELESS: case BC2_UNORM: case BC2_UNORM_SRGB: case BC3_TYPELESS: case BC3_UNORM: case BC3_UNORM_SRGB:
+	case BC5_TYPELESS: case BC5_UNORM: case BC5_SNORM: case BC6H_TYPELESS: case BC6H_UF16: case BC6H_SF16:
+	case BC7_TYPELESS: case BC7_UNORM: case BC7_UNORM_SRGB:
+		bc = true; bpe = 16; break;
+	case R8G8_B8G8_UNORM: case G8R8_G8B8_UNORM: case YUY2:
+		packed = true; bpe = 4; break;
+	case Y210: case Y216:
+		packed = true; bpe = 8; break;
+	case NV12: case OPAQUE_420:
+		planar = true; bpe = 2; break;
+	case P010: case P016:
+		planar = true; bpe = 4; break;
+	default:
+		break;
+	}
+
+	if (bc)
+	{
+		rowBytes = (std::max)(static_cast<uint64_t>(1), (static_cast<uint64_t>(width) + 3) / 4) * bpe;
+		numRows = (std::max)(static_cast<uint64_t>(1), (static_cast<uint64_t>(height) + 3) / 4);
+		numBytes = rowBytes * numRows;
+	}
+	else if (packed)
+	{
+		rowBytes = ((static_cast<uint64_t>(width) + 1) >> 1) * bpe;
+		numRows = height;
+		numBytes = rowBytes * height;
+	}
+	else if (format == NV11)
+	{
+		// 与D3D的简化假设一致，比实际的4:1:1数据大
+		rowBytes = ((static_cast<uint64_t>(width) + 3) >> 2) * 4;
+		numRows = static_cast<uint64_t>(height) * 2;
+		numBytes = rowBytes * numRows;
+	}
+	else if (planar)
+	{
+		rowBytes = ((static_cast<uint64_t>(width) + 1) >> 1) * bpe;
+		numBytes = rowBytes * height + ((rowBytes * height + 1) >> 1);
+		numRows = height + ((static_cast<uint64_t>(height) + 1) >> 1);
+	}
+	else
+	{
+		uint32_t bpp = GetBitsPerPixel(format);
+		if (bpp == 0)
+			return false;
+		rowBytes = (static_cast<uint64_t>(width) * bpp + 7) / 8;
+		numRows = height;
+		numBytes = rowBytes * height;
+	}
+
+	// D3D11_SUBRESOURCE_DATA的行距与切片大小为32位
+	if (numBytes > UINT32_MAX || rowBytes > UINT32_MAX || numRows > UINT32_MAX)
+		return false;
+
+	rowPitch = static_cast<size_t>(rowBytes);
+	slicePitch = static_cast<size_t>(numBytes);
+	rowCount = static_cast<size_t>(numRows);
+	return true;
+}
+
+std::vector<uint8_t> DdsReader::CreateHeader(const Desc& desc)
+{
+	DdsHeader header = {};
+	header.size = sizeof(DdsHeader);
+	header.flags = kDdsHeaderFlagsTexture;
+	header.width = desc.width;
+	header.height = desc.height;
+	header.depth = desc.dimension == Dimension::Texture3D ? desc.depth : 0;
+	header.mipMapCount = desc.mipCount;
+	header.ddspf.size = sizeof(DdsPixelFormat);
+	header.ddspf.flags = kDdsFourCC;
+	header.ddspf.fourCC = MakeFourCC('D', 'X', '1', '0');
+	header.caps = kDdsSurfaceFlagsTexture;
+
+	size_t rowPitch = 0, slicePitch = 0, rowCount = 0;
+	GetSurfaceInfo(desc.width, desc.height, desc.format, rowPitch, slicePitch, rowCount);
+	if (IsBlockCompressed(desc.format))
+	{
+		header.flags |= kDdsHeaderFlagsLinearSize;
+		header.pitchOrLinearSize = static_cast<uint32_t>(slicePitch);
+	}
+	else
+	{
+		header.flags |= kDdsHeaderFlagsPitch;
+		header.pitchOrLinearSize = static_cast<uint32_t>(rowPitch);
+	}
+	if (desc.mipCount > 1)
+	{
+		header.flags |= kDdsHeaderFlagsMipmap;
+		header.caps |= kDdsSurfaceFlagsMipmap;
+	}
+	if (desc.isCubeMap)
+	{
+		header.caps |= kDdsSurfaceFlagsCubeMap;
+		header.caps2 = kDdsCubeMap | kDdsCubeMapAllFaces;
+	}
+	if (desc.dimension == Dimension::Texture3D)
+	{
+		header.flags |= kDdsHeaderFlagsVolume;
+		header.caps2 |= kDdsFlagsVolume;
+	}
+
+	DdsHeaderDxt10 dxt10 = {};
+	dxt10.dxgiFormat = desc.format;
+	dxt10.resourceDimension = static_cast<uint32_t>(desc.dimension);
+	// DX10头中立方体贴图的数组大小为立方体的个数
+	dxt10.miscFlag = desc.isCubeMap ? kMiscTextureCube : 0;
+	dxt10.arraySize = desc.isCubeMap ? desc.arraySize / 6 : desc.arraySize;
+	dxt10.miscFlags2 = static_cast<uint32_t>(desc.alphaMode);
+
+	std::vector<uint8_t> result(sizeof(kDdsMagic) + sizeof(header) + sizeof(dxt10));
+	memcpy(result.data(), &kDdsMagic, sizeof(kDdsMagic));
+	memcpy(result.data() + sizeof(kDdsMagic), &header, sizeof(header));
+	memcpy(result.data() + sizeof(kDdsMagic) + sizeof(header), &dxt10, sizeof(dxt10));
+	return result;
+}
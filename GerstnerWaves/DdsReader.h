@@ -0,0 +1,162 @@
+﻿//***************************************************************************************
+// DdsReader.h
+// Licensed under the MIT License.
+//
+// 不依赖平台的DDS文件解析
+// - 校验文件头(包括DX10扩展头)，从旧式的像素格式推导出DXGI格式
+// - 枚举所有数组元素(立方体贴图的每个面)的每一级mip，计算行距与切片大小
+// - 只保存指向输入数据的指针，不发生复制，输入数据(如映射的文件)需要在使用期间保持有效
+// - 创建D3D资源的部分见d3dUtil的CreateTextureFromDds
+// Platform-independent DDS container parser. Validates the headers (including the
+// DX10 extension) and enumerates every mip of every array slice or cube face as a
+// zero-copy view into the caller's buffer.
+//***************************************************************************************
+
+#ifndef DDSREADER_H
+#define DDSREADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// DXGI_FORMAT的取值，与dxgiformat.h一致，使解析部分不依赖Windows头文件
+namespace DdsFormat
+{
+	enum : uint32_t
+	{
+		UNKNOWN = 0,
+		R32G32B32A32_TYPELESS = 1, R32G32B32A32_FLOAT = 2, R32G32B32A32_UINT = 3, R32G32B32A32_SINT = 4,
+		R32G32B32_TYPELESS = 5, R32G32B32_FLOAT = 6, R32G32B32_UINT = 7, R32G32B32_SINT = 8,
+		R16G16B16A16_TYPELESS = 9, R16G16B16A16_FLOAT = 10, R16G16B16A16_UNORM = 11, R16G16B16A16_UINT = 12,
+		R16G16B16A16_SNORM = 13, R16G16B16A16_SINT = 14,
+		R32G32_TYPELESS = 15, R32G32_FLOAT = 16, R32G32_UINT = 17, R32G32_SINT = 18,
+		R32G8X24_TYPELESS = 19, D32_FLOAT_S8X24_UINT = 20, R32_FLOAT_X8X24_TYPELESS = 21, X32_TYPELESS_G8X24_UINT = 22,
+		R10G10B10A2_TYPELESS = 23, R10G10B10A2_UNORM = 24, R10G10B10A2_UINT = 25, R11G11B10_FLOAT = 26,
+		R8G8B8A8_TYPELESS = 27, R8G8B8A8_UNORM = 28, R8G8B8A8_UNORM_SRGB = 29, R8G8B8A8_UINT = 30,
+		R8G8B8A8_SNORM = 31, R8G8B8A8_SINT = 32,
+		R16G16_TYPELESS = 33, R16G16_FLOAT = 34, R16G16_UNORM = 35, R16G16_UINT = 36, R16G16_SNORM = 37, R16G16_SINT = 38,
+		R32_TYPELESS = 39, D32_FLOAT = 40, R32_FLOAT = 41, R32_UINT = 42, R32_SINT = 43,
+		R24G8_TYPELESS = 44, D24_UNORM_S8_UINT = 45, R24_UNORM_X8_TYPELESS = 46, X24_TYPELESS_G8_UINT = 47,
+		R8G8_TYPELESS = 48, R8G8_UNORM = 49, R8G8_UINT = 50, R8G8_SNORM = 51, R8G8_SINT = 52,
+		R16_TYPELESS = 53, R16_FLOAT = 54, D16_UNORM = 55, R16_UNORM = 56, R16_UINT = 57, R16_SNORM = 58, R16_SINT = 59,
+		R8_TYPELESS = 60, R8_UNORM = 61, R8_UINT = 62, R8_SNORM = 63, R8_SINT = 64, A8_UNORM = 65,
+		R1_UNORM = 66, R9G9B9E5_SHAREDEXP = 67, R8G8_B8G8_UNORM = 68, G8R8_G8B8_UNORM = 69,
+		BC1_TYPELESS = 70, BC1_UNORM = 71, BC1_UNORM_SRGB = 72,
+		BC2_TYPELESS = 73, BC2_UNORM = 74, BC2_UNORM_SRGB = 75,
+		BC3_TYPELESS = 76, BC3_UNORM = 77, BC3_UNORM_SRGB = 78,
+		BC4_TYPELESS = 79, BC4_UNORM = 80, BC4_SNORM = 81,
+		BC5_TYPELESS = 82, BC5_UNORM = 83, BC5_SNORM = 84,
+		B5G6R5_UNORM = 85, B5G5R5A1_UNORM = 86, B8G8R8A8_UNORM = 87, B8G8R8X8_UNORM = 88,
+		R10G10B10_XR_BIAS_A2_UNORM = 89, B8G8R8A8_TYPELESS = 90, B8G8R8A8_UNORM_SRGB = 91,
+		B8G8R8X8_TYPELESS = 92, B8G8R8X8_UNORM_SRGB = 93,
+		BC6H_TYPELESS = 94, BC6H_UF16 = 95, BC6H_SF16 = 96,
+		BC7_TYPELESS = 97, BC7_UNORM = 98, BC7_UNORM_SRGB = 99,
+		AYUV = 100, Y410 = 101, Y416 = 102, NV12 = 103, P010 = 104, P016 = 105, OPAQUE_420 = 106,
+		YUY2 = 107, Y210 = 108, Y216 = 109, NV11 = 110, AI44 = 111, IA44 = 112, P8 = 113, A8P8 = 114,
+		B4G4R4A4_UNORM = 115
+	};
+}
+
+class DdsReader
+{
+public:
+	// 与D3D11_RESOURCE_DIMENSION的取值一致
+	enum class Dimension : uint32_t
+	{
+		Unknown = 0,
+		Texture1D = 2,
+		Texture2D = 3,
+		Texture3D = 4
+	};
+
+	// 与DirectX::DDS_ALPHA_MODE的取值一致
+	enum class AlphaMode : uint32_t
+	{
+		Unknown = 0,
+		Straight = 1,
+		Premultiplied = 2,
+		Opaque = 3,
+		Custom = 4
+	};
+
+	// 一个数组元素的一级mip
+	struct Subresource
+	{
+		const uint8_t* data;		// 指向输入数据
+		uint32_t width;
+		uint32_t height;
+		uint32_t depth;
+		size_t rowPitch;			// 一行(块压缩格式为一行块)的字节数
+		size_t slicePitch;			// 一个深度切片的字节数
+		size_t rowCount;			// 一个深度切片的行数
+	};
+
+	DdsReader();
+
+	// 解析内存中的DDS文件，data需要在使用解析结果期间保持有效
+	// 文件头不合法、格式不支持、尺寸超出D3D11的限制或数据被截断时返回false
+	bool Parse(const uint8_t* data, size_t size);
+	// 上次解析失败的原因
+	const char* GetError() const { return m_Error; }
+
+	Dimension GetDimension() const { return m_Dimension; }
+	uint32_t GetFormat() const { return m_Format; }
+	uint32_t GetWidth() const { return m_Width; }
+	uint32_t GetHeight() const { return m_Height; }
+	uint32_t GetDepth() const { return m_Depth; }
+	uint32_t GetMipCount() const { return m_MipCount; }
+	// 立方体贴图的数组大小包含6个面
+	uint32_t GetArraySize() const { return m_ArraySize; }
+	bool IsCubeMap() const { return m_IsCubeMap; }
+	AlphaMode GetAlphaMode() const { return m_AlphaMode; }
+
+	// 子资源按D3D的顺序排列: 下标为item * mipCount + mip
+	const std::vector<Subresource>& GetSubresources() const { return m_Subresources; }
+	const Subresource& GetSubresource(uint32_t item, uint32_t mip) const { return m_Subresources[item * m_MipCount + mip]; }
+	// 所有子资源的总字节数
+	size_t GetDataSize() const { return m_DataSize; }
+
+	// 每个像素的位数，不支持的格式返回0
+	static uint32_t GetBitsPerPixel(uint32_t format);
+	// 是否为块压缩(BC1~BC7)格式
+	static bool IsBlockCompressed(uint32_t format);
+	// 计算一个表面的行距、大小与行数，不支持的格式或超出32位时返回false
+	static bool GetSurfaceInfo(uint32_t width, uint32_t height, uint32_t format,
+		size_t& rowPitch, size_t& slicePitch, size_t& rowCount);
+
+	// 写出DDS文件时的描述，arraySize与GetArraySize相同，立方体贴图包含6个面
+	struct Desc
+	{
+		Dimension dimension;
+		uint32_t format;
+		uint32_t width;
+		uint32_t height;
+		uint32_t depth;
+		uint32_t mipCount;
+		uint32_t arraySize;
+		bool isCubeMap;
+		AlphaMode alphaMode;
+	};
+
+	// 生成带DX10扩展头的文件头(魔数+头+DX10头)
+	// 之后按子资源的顺序(见GetSubresources)紧接着写入每个子资源的数据即为完整的DDS文件
+	static std::vector<uint8_t> CreateHeader(const Desc& desc);
+
+private:
+	bool Fail(const char* error);
+
+	const char* m_Error;
+	Dimension m_Dimension;
+	uint32_t m_Format;
+	uint32_t m_Width;
+	uint32_t m_Height;
+	uint32_t m_Depth;
+	uint32_t m_MipCount;
+	uint32_t m_ArraySize;
+	bool m_IsCubeMap;
+	AlphaMode m_AlphaMode;
+	size_t m_DataSize;
+	std::vector<Subresource> m_Subresources;
+};
+
+#endif
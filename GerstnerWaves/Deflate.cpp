@@ -0,0 +1,1024 @@
+﻿#include "Deflate.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+	const int kFastBits = 10;
+	const int kMaxBits = 15;
+
+	// 长度符号257~285与距离符号0~29的基数与额外位数
+	const uint16_t kLengthBase[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+		35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+	const uint8_t kLengthExtra[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+		3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+	const uint16_t kDistanceBase[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+		257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+	const uint8_t kDistanceExtra[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+		7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+	// 动态块中码长码的码长按此顺序存放
+	const uint8_t kCodeLengthOrder[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+	// 规范哈夫曼码的解码表
+	struct Huffman
+	{
+		uint16_t fast[1 << kFastBits];	// 按接下来的kFastBits位查表，值为(符号 << 4) | 码长，0表示需要逐位解码
+		uint16_t counts[kMaxBits + 1];	// 每种码长的码字数
+		uint16_t symbols[288];			// 按码字顺序排列的符号
+	};
+
+	// 由各符号的码长构建解码表，码长超额时返回false
+	// 不完整的码是允许的(如只有一个距离码)，用到不存在的码字时在解码中报错
+	bool BuildHuffman(Huffman& huffman, const uint8_t* lengths, int count)
+	{
+		memset(huffman.counts, 0, sizeof(huffman.counts));
+		for (int i = 0; i < count; ++i)
+			++huffman.counts[lengths[i]];
+		huffman.counts[0] = 0;
+
+		int left = 1;
+		for (int length = 1; length <= kMaxBits; ++length)
+		{
+			left = (left << 1) - huffman.counts[length];
+			if (left < 0)
+				return false;
+		}
+
+		uint16_t offsets[kMaxBits + 2] = {};
+		for (int length = 1; length <= kMaxBits; ++length)
+			offsets[length + 1] = static_cast<uint16_t>(offsets[length] + huffman.counts[length]);
+		for (int i = 0; i < count; ++i)
+		{
+			if (lengths[i])
+				huffman.symbols[offsets[lengths[i]]++] = static_cast<uint16_t>(i);
+		}
+
+		// 码字从高位开始写入位流，查表的下标是位序反转后的码字，填满所有可能的后续位
+		memset(huffman.fast, 0, sizeof(huffman.fast));
+		int code = 0, index = 0;
+		for (int length = 1; length <= kFastBits; ++length)
+		{
+			for (int i = 0; i < huffman.counts[length]; ++i, ++code, ++index)
+			{
+				int reversed = 0;
+				for (int bit = 0; bit < length; ++bit)
+					reversed |= ((code >> bit) & 1) << (length - 1 - bit);
+				uint16_t entry = static_cast<uint16_t>((huffman.symbols[index] << 4) | length);
+				for (int k = reversed; k < (1 << kFastBits); k += 1 << length)
+					huffman.fast[k] = entry;
+			}
+			code <<= 1;
+		}
+		return true;
+	}
+
+	// 固定哈夫曼码的块共用的解码表
+	struct FixedTables
+	{
+		FixedTables()
+		{
+			uint8_t lengths[288];
+			std::fill(lengths, lengths + 144, static_cast<uint8_t>(8));
+			std::fill(lengths + 144, lengths + 256, static_cast<uint8_t>(9));
+			std::fill(lengths + 256, lengths + 280, static_cast<uint8_t>(7));
+			std::fill(lengths + 280, lengths + 288, static_cast<uint8_t>(8));
+			BuildHuffman(literals, lengths, 288);
+			std::fill(lengths, lengths + 30, static_cast<uint8_t>(5));
+			BuildHuffman(distances, lengths, 30);
+		}
+
+		Huffman literals;
+		Huffman distances;
+	};
+
+	// 按小端序读取8字节，与平台的字节序无关
+	inline uint64_t LoadLittleEndian64(const uint8_t* data)
+	{
+		uint64_t value = 0;
+		for (int i = 7; i >= 0; --i)
+			value = (value << 8) | data[i];
+		return value;
+	}
+
+	// 从低位开始读取的位流，读到数据末尾之后补0并记录补了多少字节
+	struct BitReader
+	{
+		const uint8_t* data;
+		size_t size;
+		size_t pos;
+		uint64_t buffer;
+		int count;			// buffer中的有效位数
+		size_t padding;		// buffer末尾补的0字节数
+
+		// 补充到至少56位
+		void Refill()
+		{
+			if (pos + 8 <= size)
+			{
+				buffer |= LoadLittleEndian64(data + pos) << count;
+				pos += (63 - count) >> 3;
+				count |= 56;
+			}
+			else
+			{
+				for (; count <= 56; count += 8)
+				{
+					if (pos < size)
+						buffer |= static_cast<uint64_t>(data[pos++]) << count;
+					else
+						++padding;
+				}
+			}
+		}
+
+		uint32_t Read(int bits)
+		{
+			uint32_t value = static_cast<uint32_t>(buffer & ((1ull << bits) - 1));
+			buffer >>= bits;
+			count -= bits;
+			return value;
+		}
+
+		void Consume(int bits)
+		{
+			buffer >>= bits;
+			count -= bits;
+		}
+
+		// 是否已经消耗了补上的0，即数据被截断
+		bool Overrun() const
+		{
+			return static_cast<size_t>(count) < padding * 8;
+		}
+
+		// 丢弃到字节边界，把缓冲区中尚未消耗的字节退回到数据中，之后可以直接按字节读取
+		bool AlignToByte()
+		{
+			Consume(count % 8);
+			size_t buffered = static_cast<size_t>(count) / 8;
+			if (buffered < padding)
+				return false;
+			pos -= buffered - padding;
+			buffer = 0;
+			count = 0;
+			padding = 0;
+			return true;
+		}
+	};
+
+	// 解码一个符号，调用前缓冲区至少有kMaxBits位，无效的码字返回-1
+	inline int DecodeSymbol(BitReader& reader, const Huffman& huffman)
+	{
+		uint16_t entry = huffman.fast[reader.buffer & ((1 << kFastBits) - 1)];
+		if (entry)
+		{
+			reader.Consume(entry & 15);
+			return entry >> 4;
+		}
+
+		// 逐位比较规范哈夫曼码每种码长的码字范围
+		int code = 0, first = 0, index = 0;
+		for (int length = 1; length <= kMaxBits; ++length)
+		{
+			code |= static_cast<int>((reader.buffer >> (length - 1)) & 1);
+			int count = huffman.counts[length];
+			if (code < first + count)
+			{
+				reader.Consume(length);
+				return huffman.symbols[index + code - first];
+			}
+			index += count;
+			first = (first + count) << 1;
+			code <<= 1;
+		}
+		return -1;
+	}
+
+	// 解码一个哈夫曼编码的块
+	bool InflateBlock(BitReader& reader, const Huffman& literals, const Huffman& distances,
+		uint8_t* begin, uint8_t*& out, uint8_t* end)
+	{
+		for (;;)
+		{
+			// 一个符号最多用到15 + 5 + 15 + 13 = 48位，补充一次就够
+			reader.Refill();
+			int symbol = DecodeSymbol(reader, literals);
+			if (symbol < 256)
+			{
+				if (symbol < 0 || out == end)
+					return false;
+				*out++ = static_cast<uint8_t>(symbol);
+
+				// 补充后至少还剩41位，下一个符号是快速表中的字面量时不必再补充
+				uint16_t entry = literals.fast[reader.buffer & ((1 << kFastBits) - 1)];
+				if (entry && (entry >> 4) < 256 && out != end)
+				{
+					reader.Consume(entry & 15);
+					*out++ = static_cast<uint8_t>(entry >> 4);
+				}
+				continue;
+			}
+			if (symbol == 256)
+				return !reader.Overrun();
+
+			symbol -= 257;
+			if (symbol >= 29)
+				return false;
+			size_t length = kLengthBase[symbol] + reader.Read(kLengthExtra[symbol]);
+			int distanceSymbol = DecodeSymbol(reader, distances);
+			if (distanceSymbol < 0 || distanceSymbol >= 30)
+				return false;
+			size_t distance = kDistanceBase[distanceSymbol] + reader.Read(kDistanceExtra[distanceSymbol]);
+			if (distance > static_cast<size_t>(out - begin) || length > static_cast<size_t>(end - out))
+				return false;
+
+			const uint8_t* from = out - distance;
+			if (distance >= 8 && length + 8 <= static_cast<size_t>(end - out))
+			{
+				// 每次复制的8字节不重叠，多写的部分在缓冲区内并会被后续数据覆盖
+				uint8_t* target = out + length;
+				do
+				{
+					memcpy(out, from, 8);
+					out += 8;
+					from += 8;
+				} while (out < target);
+				out = target;
+			}
+			else
+			{
+				for (size_t i = 0; i < length; ++i)
+					out[i] = from[i];
+				out += length;
+			}
+		}
+	}
+
+	// 读取动态块头部的码长并构建解码表
+	bool ReadDynamicTables(BitReader& reader, Huffman& literals, Huffman& distances)
+	{
+		reader.Refill();
+		int literalCount = static_cast<int>(reader.Read(5)) + 257;
+		int distanceCount = static_cast<int>(reader.Read(5)) + 1;
+		int codeLengthCount = static_cast<int>(reader.Read(4)) + 4;
+		if (literalCount > 286 || distanceCount > 30)
+			return false;
+
+		uint8_t lengths[286 + 30] = {};
+		for (int i = 0; i < codeLengthCount; ++i)
+		{
+			reader.Refill();
+			lengths[kCodeLengthOrder[i]] = static_cast<uint8_t>(reader.Read(3));
+		}
+		Huffman codeLengths;
+		if (!BuildHuffman(codeLengths, lengths, 19))
+			return false;
+
+		// 码长本身也经过哈夫曼编码，16~18为重复
+		int total = literalCount + distanceCount;
+		memset(lengths, 0, sizeof(lengths));
+		for (int i = 0; i < total;)
+		{
+			reader.Refill();
+			int symbol = DecodeSymbol(reader, codeLengths);
+			if (symbol < 0)
+				return false;
+			if (symbol < 16)
+			{
+				lengths[i++] = static_cast<uint8_t>(symbol);
+				continue;
+			}
+
+			uint8_t value = 0;
+			int repeat;
+			if (symbol == 16)
+			{
+				if (i == 0)
+					return false;
+				value = lengths[i - 1];
+				repeat = 3 + static_cast<int>(reader.Read(2));
+			}
+			else if (symbol == 17)
+				repeat = 3 + static_cast<int>(reader.Read(3));
+			else
+				repeat = 11 + static_cast<int>(reader.Read(7));
+			if (i + repeat > total)
+				return false;
+			std::fill(lengths + i, lengths + i + repeat, value);
+			i += repeat;
+		}
+		if (reader.Overrun() || lengths[256] == 0)
+			return false;
+
+		return BuildHuffman(literals, lengths, literalCount) &&
+			BuildHuffman(distances, lengths + literalCount, distanceCount);
+	}
+
+	// 解压DEFLATE流，consumed返回流占用的字节数
+	bool InflateStream(const uint8_t* source, size_t sourceSize, uint8_t* destination, size_t destinationSize,
+		size_t& written, size_t& consumed)
+	{
+		static const FixedTables fixedTables;
+		BitReader reader = { source, sourceSize, 0, 0, 0, 0 };
+		uint8_t* out = destination;
+		uint8_t* end = destination + destinationSize;
+		Huffman literals, distances;
+
+		bool last = false;
+		while (!last)
+		{
+			reader.Refill();
+			if (reader.Overrun())
+				return false;
+			last = reader.Read(1) != 0;
+			uint32_t type = reader.Read(2);
+			if (type == 0)
+			{
+				// 未压缩的块: 对齐到字节后为LEN与其反码NLEN，然后是LEN字节的数据
+				if (!reader.AlignToByte() || sourceSize - reader.pos < 4)
+					return false;
+				const uint8_t* header = source + reader.pos;
+				size_t length = header[0] | (header[1] << 8);
+				size_t complement = header[2] | (header[3] << 8);
+				if (length != (~complement & 0xFFFF))
+					return false;
+				reader.pos += 4;
+				if (length > sourceSize - reader.pos || length > static_cast<size_t>(end - out))
+					return false;
+				memcpy(out, source + reader.pos, length);
+				out += length;
+				reader.pos += length;
+			}
+			else if (type == 1)
+			{
+				if (!InflateBlock(reader, fixedTables.literals, fixedTables.distances, destination, out, end))
+					return false;
+			}
+			else if (type == 2)
+			{
+				if (!ReadDynamicTables(reader, literals, distances) ||
+					!InflateBlock(reader, literals, distances, destination, out, end))
+					return false;
+			}
+			else
+				return false;
+		}
+
+		if (!reader.AlignToByte())
+			return false;
+		written = static_cast<size_t>(out - destination);
+		consumed = reader.pos;
+		return true;
+	}
+
+	struct CrcTable
+	{
+		CrcTable()
+		{
+			for (uint32_t i = 0; i < 256; ++i)
+			{
+				uint32_t value = i;
+				for (int bit = 0; bit < 8; ++bit)
+					value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+				entries[i] = value;
+			}
+		}
+
+		uint32_t entries[256];
+	};
+
+	//
+	// 压缩
+	//
+
+	const size_t kWindowSize = 32768;
+	const int kMinMatch = 3;
+	const int kMaxMatch = 258;
+	const int kHashBits = 15;
+	const size_t kBlockSymbols = 16384;		// 每个块最多的符号数，块越小哈夫曼表越贴合局部的统计
+
+	// 各压缩级别的匹配查找参数，与zlib的取值相同
+	struct LevelParams
+	{
+		int goodLength;		// 上一个匹配不短于此长度时只查找1/4的候选位置
+		int lazyLength;		// 懒惰匹配时上一个匹配不短于此长度就不再查找；贪心匹配时长于此长度的匹配内部不加入哈希链
+		int niceLength;		// 找到这么长的匹配后不再继续查找
+		int maxChain;		// 沿哈希链最多比较的候选位置数
+		bool lazy;			// 是否在下一个位置有更长的匹配时推迟输出(懒惰匹配)
+	};
+	const LevelParams kLevels[10] = { { 0, 0, 0, 0, false },
+		{ 4, 4, 8, 4, false }, { 4, 5, 16, 8, false }, { 4, 6, 32, 32, false },
+		{ 4, 4, 16, 16, true }, { 8, 16, 32, 32, true }, { 8, 16, 128, 128, true },
+		{ 8, 32, 128, 256, true }, { 32, 128, 258, 1024, true }, { 32, 258, 258, 4096, true } };
+
+	// 字面量(distance为0)或匹配
+	struct Symbol
+	{
+		uint16_t value;		// 字面量的字节或匹配长度
+		uint16_t distance;
+	};
+
+	// 长度与距离到符号的映射
+	struct SymbolTables
+	{
+		SymbolTables()
+		{
+			for (int code = 0; code < 29; ++code)
+			{
+				int end = code == 28 ? kMaxMatch + 1 : kLengthBase[code + 1];
+				for (int length = kLengthBase[code]; length < end; ++length)
+					lengthCodes[length] = static_cast<uint8_t>(code);
+			}
+			// 长度258单独使用符号285，不能用符号284加额外位表示
+			lengthCodes[kMaxMatch] = 28;
+			for (int code = 0; code < 30; ++code)
+			{
+				for (int distance = kDistanceBase[code]; distance < (code == 29 ? 32769 : kDistanceBase[code + 1]); ++distance)
+				{
+					if (distance <= 256)
+						distanceCodes[distance - 1] = static_cast<uint8_t>(code);
+					else
+						distanceCodes[256 + ((distance - 1) >> 7)] = static_cast<uint8_t>(code);
+				}
+			}
+		}
+
+		int GetDistanceCode(int distance) const
+		{
+			return distance <= 256 ? distanceCodes[distance - 1] : distanceCodes[256 + ((distance - 1) >> 7)];
+		}
+
+		uint8_t lengthCodes[kMaxMatch + 1];
+		uint8_t distanceCodes[512];
+	};
+
+	// 低位在前写入位流
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(std::vector<uint8_t>& output) : m_Output(output), m_Bits(), m_Count() {}
+
+		// 一次最多写入32位
+		void Put(uint32_t value, int count)
+		{
+			m_Bits |= static_cast<uint64_t>(value) << m_Count;
+			m_Count += count;
+			if (m_Count >= 32)
+			{
+				for (int i = 0; i < 4; ++i)
+					m_Output.push_back(static_cast<uint8_t>(m_Bits >> (i * 8)));
+				m_Bits >>= 32;
+				m_Count -= 32;
+			}
+		}
+
+		// 补0到字节边界并写出剩余的位
+		void Align()
+		{
+			for (; m_Count > 0; m_Count -= 8, m_Bits >>= 8)
+				m_Output.push_back(static_cast<uint8_t>(m_Bits));
+			m_Bits = 0;
+			m_Count = 0;
+		}
+
+		std::vector<uint8_t>& GetOutput() { return m_Output; }
+
+	private:
+		std::vector<uint8_t>& m_Output;
+		uint64_t m_Bits;
+		int m_Count;
+	};
+
+	// 由频率生成不超过maxBits位的码长
+	// 用到的符号不足两个时补足两个，使码总是完整的
+	void BuildLengths(const uint32_t* frequencies, int count, int maxBits, uint8_t* lengths)
+	{
+		memset(lengths, 0, count);
+		std::vector<int> leaves;
+		for (int i = 0; i < count; ++i)
+		{
+			if (frequencies[i])
+				leaves.push_back(i);
+		}
+		if (leaves.size() < 2)
+		{
+			int first = leaves.empty() ? 0 : leaves[0];
+			lengths[first] = 1;
+			lengths[first == 0 ? 1 : 0] = 1;
+			return;
+		}
+		std::stable_sort(leaves.begin(), leaves.end(), [frequencies](int a, int b) { return frequencies[a] < frequencies[b]; });
+
+		// 叶子按频率升序排列，新建的内部结点的权重也是递增的，用两个队列即可合并出哈夫曼树
+		size_t leafCount = leaves.size();
+		std::vector<uint64_t> weights(2 * leafCount - 1);
+		std::vector<size_t> parents(2 * leafCount - 1);
+		for (size_t i = 0; i < leafCount; ++i)
+			weights[i] = frequencies[leaves[i]];
+		size_t nextLeaf = 0, nextNode = leafCount;
+		for (size_t node = leafCount; node < weights.size(); ++node)
+		{
+			weights[node] = 0;
+			for (int child = 0; child < 2; ++child)
+			{
+				size_t pick = (nextLeaf < leafCount && (nextNode >= node || weights[nextLeaf] <= weights[nextNode])) ?
+					nextLeaf++ : nextNode++;
+				weights[node] += weights[pick];
+				parents[pick] = node;
+			}
+		}
+
+		// 父结点的下标总比子结点大，从根向下即可求出深度
+		std::vector<int> depths(weights.size(), 0);
+		std::vector<int> lengthCounts(maxBits + 1, 0);
+		for (size_t node = weights.size() - 1; node-- > 0;)
+			depths[node] = depths[parents[node]] + 1;
+		for (size_t i = 0; i < leafCount; ++i)
+			++lengthCounts[(std::min)(depths[i], maxBits)];
+
+		// 超过maxBits的码字截断后码长总和超出Kraft不等式，把较短的码字逐个加长直到恰好满足
+		uint32_t total = 0;
+		for (int length = 1; length <= maxBits; ++length)
+			total += static_cast<uint32_t>(lengthCounts[length]) << (maxBits - length);
+		while (total > (1u << maxBits))
+		{
+			--lengthCounts[maxBits];
+			for (int length = maxBits - 1; length > 0; --length)
+			{
+				if (lengthCounts[length])
+				{
+					--lengthCounts[length];
+					lengthCounts[length + 1] += 2;
+					break;
+				}
+			}
+			--total;
+		}
+
+		// 频率越低的符号码长越长
+		size_t leaf = 0;
+		for (int length = maxBits; length > 0; --length)
+		{
+			for (int i = 0; i < lengthCounts[length]; ++i)
+				lengths[leaves[leaf++]] = static_cast<uint8_t>(length);
+		}
+	}
+
+	// 由码长生成规范哈夫曼码，码字从高位开始写入位流，这里存放位序反转后的结果
+	void BuildCodes(const uint8_t* lengths, int count, uint16_t* codes)
+	{
+		int lengthCounts[kMaxBits + 1] = {};
+		for (int i = 0; i < count; ++i)
+			++lengthCounts[lengths[i]];
+		lengthCounts[0] = 0;
+		int nextCode[kMaxBits + 2] = {};
+		for (int length = 1; length <= kMaxBits; ++length)
+			nextCode[length + 1] = (nextCode[length] + lengthCounts[length]) << 1;
+		for (int i = 0; i < count; ++i)
+		{
+			int length = lengths[i];
+			if (length == 0)
+				continue;
+			int code = nextCode[length]++, reversed = 0;
+			for (int bit = 0; bit < length; ++bit)
+				reversed |= ((code >> bit) & 1) << (length - 1 - bit);
+			codes[i] = static_cast<uint16_t>(reversed);
+		}
+	}
+
+	// 不压缩的块，每块最多65535字节
+	void WriteStored(BitWriter& writer, const uint8_t* raw, size_t rawSize, bool final)
+	{
+		size_t offset = 0;
+		do
+		{
+			size_t chunk = (std::min)(rawSize - offset, static_cast<size_t>(65535));
+			bool last = final && offset + chunk == rawSize;
+			writer.Put(last ? 1 : 0, 3);
+			writer.Align();
+			writer.Put(static_cast<uint32_t>(chunk) | (static_cast<uint32_t>(~chunk & 0xFFFF) << 16), 32);
+			writer.Align();
+			std::vector<uint8_t>& output = writer.GetOutput();
+			output.insert(output.end(), raw + offset, raw + offset + chunk);
+			offset += chunk;
+		} while (offset < rawSize);
+	}
+
+	// 把一个块的符号写入位流，按动态哈夫曼、固定哈夫曼与不压缩三种方式中位数最少的一种输出
+	// raw为这些符号对应的原始数据，用于不压缩的块
+	void WriteBlock(BitWriter& writer, const std::vector<Symbol>& symbols, const uint8_t* raw, size_t rawSize, bool final)
+	{
+		static const SymbolTables tables;
+
+		uint32_t literalFrequencies[286] = {}, distanceFrequencies[30] = {};
+		for (const Symbol& symbol : symbols)
+		{
+			if (symbol.distance == 0)
+				++literalFrequencies[symbol.value];
+			else
+			{
+				++literalFrequencies[257 + tables.lengthCodes[symbol.value]];
+				++distanceFrequencies[tables.GetDistanceCode(symbol.distance)];
+			}
+		}
+		literalFrequencies[256] = 1;
+
+		uint8_t literalBuffer[286], distanceLengths[30];
+		uint8_t* literalLengths = literalBuffer;
+		BuildLengths(literalFrequencies, 286, kMaxBits, literalLengths);
+		BuildLengths(distanceFrequencies, 30, kMaxBits, distanceLengths);
+		int literalCount = 286, distanceCount = 30;
+		while (literalCount > 257 && literalLengths[literalCount - 1] == 0)
+			--literalCount;
+		while (distanceCount > 1 && distanceLengths[distanceCount - 1] == 0)
+			--distanceCount;
+		uint8_t lengths[286 + 30];
+		memcpy(lengths, literalLengths, literalCount);
+		memcpy(lengths + literalCount, distanceLengths, distanceCount);
+
+		// 码长序列用16(重复上一个码长3~6次)、17(3~10个0)与18(11~138个0)做游程编码
+		struct RunSymbol
+		{
+			uint8_t symbol;
+			uint8_t extra;
+		};
+		std::vector<RunSymbol> runs;
+		uint32_t codeLengthFrequencies[19] = {};
+		int lengthTotal = literalCount + distanceCount;
+		for (int i = 0; i < lengthTotal;)
+		{
+			int value = lengths[i], run = 1;
+			while (i + run < lengthTotal && lengths[i + run] == value)
+				++run;
+			i += run;
+			if (value == 0)
+			{
+				for (; run >= 11; run -= (std::min)(run, 138))
+					runs.push_back({ 18, static_cast<uint8_t>((std::min)(run, 138) - 11) });
+				if (run >= 3)
+				{
+					runs.push_back({ 17, static_cast<uint8_t>(run - 3) });
+					run = 0;
+				}
+			}
+			else
+			{
+				runs.push_back({ static_cast<uint8_t>(value), 0 });
+				--run;
+				for (; run >= 3; run -= (std::min)(run, 6))
+					runs.push_back({ 16, static_cast<uint8_t>((std::min)(run, 6) - 3) });
+			}
+			for (; run > 0; --run)
+				runs.push_back({ static_cast<uint8_t>(value), 0 });
+		}
+		for (const RunSymbol& run : runs)
+			++codeLengthFrequencies[run.symbol];
+		uint8_t codeLengthLengths[19];
+		BuildLengths(codeLengthFrequencies, 19, 7, codeLengthLengths);
+		int codeLengthCount = 19;
+		while (codeLengthCount > 4 && codeLengthLengths[kCodeLengthOrder[codeLengthCount - 1]] == 0)
+			--codeLengthCount;
+
+		// 估计三种方式的位数
+		const uint8_t kRunExtra[3] = { 2, 3, 7 };
+		uint64_t dataBits = 0, fixedBits = 0;
+		for (int i = 0; i < 286; ++i)
+		{
+			uint64_t extra = i >= 257 ? kLengthExtra[i - 257] : 0;
+			int fixedLength = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+			dataBits += literalFrequencies[i] * (literalLengths[i] + extra);
+			fixedBits += literalFrequencies[i] * (fixedLength + extra);
+		}
+		for (int i = 0; i < 30; ++i)
+		{
+			dataBits += distanceFrequencies[i] * static_cast<uint64_t>(distanceLengths[i] + kDistanceExtra[i]);
+			fixedBits += distanceFrequencies[i] * static_cast<uint64_t>(5 + kDistanceExtra[i]);
+		}
+		uint64_t dynamicBits = 3 + 5 + 5 + 4 + 3 * codeLengthCount + dataBits;
+		for (const RunSymbol& run : runs)
+			dynamicBits += codeLengthLengths[run.symbol] + (run.symbol >= 16 ? kRunExtra[run.symbol - 16] : 0);
+		fixedBits += 3;
+		uint64_t storedBits = (rawSize / 65535 + 1) * (3 + 7 + 32) + rawSize * 8;
+
+		if (storedBits <= dynamicBits && storedBits <= fixedBits)
+		{
+			WriteStored(writer, raw, rawSize, final);
+			return;
+		}
+
+		uint16_t literalCodes[288] = {}, distanceCodes[30] = {};
+		uint8_t fixedLengths[288];
+		if (fixedBits <= dynamicBits)
+		{
+			writer.Put(final ? 3 : 2, 3);
+			std::fill(fixedLengths, fixedLengths + 144, static_cast<uint8_t>(8));
+			std::fill(fixedLengths + 144, fixedLengths + 256, static_cast<uint8_t>(9));
+			std::fill(fixedLengths + 256, fixedLengths + 280, static_cast<uint8_t>(7));
+			std::fill(fixedLengths + 280, fixedLengths + 288, static_cast<uint8_t>(8));
+			literalLengths = fixedLengths;
+			std::fill(distanceLengths, distanceLengths + 30, static_cast<uint8_t>(5));
+			BuildCodes(literalLengths, 288, literalCodes);
+			BuildCodes(distanceLengths, 30, distanceCodes);
+		}
+		else
+		{
+			writer.Put(final ? 5 : 4, 3);
+			writer.Put(literalCount - 257, 5);
+			writer.Put(distanceCount - 1, 5);
+			writer.Put(codeLengthCount - 4, 4);
+			for (int i = 0; i < codeLengthCount; ++i)
+				writer.Put(codeLengthLengths[kCodeLengthOrder[i]], 3);
+			uint16_t codeLengthCodes[19] = {};
+			BuildCodes(codeLengthLengths, 19, codeLengthCodes);
+			for (const RunSymbol& run : runs)
+			{
+				writer.Put(codeLengthCodes[run.symbol], codeLengthLengths[run.symbol]);
+				if (run.symbol >= 16)
+					writer.Put(run.extra, kRunExtra[run.symbol - 16]);
+			}
+			BuildCodes(literalLengths, 286, literalCodes);
+			BuildCodes(distanceLengths, 30, distanceCodes);
+		}
+
+		for (const Symbol& symbol : symbols)
+		{
+			if (symbol.distance == 0)
+			{
+				writer.Put(literalCodes[symbol.value], literalLengths[symbol.value]);
+				continue;
+			}
+			int lengthCode = tables.lengthCodes[symbol.value];
+			writer.Put(literalCodes[257 + lengthCode], literalLengths[257 + lengthCode]);
+			writer.Put(symbol.value - kLengthBase[lengthCode], kLengthExtra[lengthCode]);
+			int distanceCode = tables.GetDistanceCode(symbol.distance);
+			writer.Put(distanceCodes[distanceCode], distanceLengths[distanceCode]);
+			writer.Put(symbol.distance - kDistanceBase[distanceCode], kDistanceExtra[distanceCode]);
+		}
+		writer.Put(literalCodes[256], literalLengths[256]);
+	}
+
+	// LZ77匹配查找，哈希链保存最近32KiB窗口内以相同3字节开头的位置
+	class MatchFinder
+	{
+	public:
+		MatchFinder(const uint8_t* source, size_t size, const LevelParams& params)
+			: m_pSource(source), m_Size(size), m_Params(params), m_Head(1 << kHashBits, 0), m_Prev(kWindowSize, 0) {}
+
+		// 把pos加入哈希链
+		void Insert(size_t pos)
+		{
+			if (pos + kMinMatch > m_Size)
+				return;
+			uint32_t hash = Hash(pos);
+			m_Prev[pos & (kWindowSize - 1)] = m_Head[hash];
+			m_Head[hash] = static_cast<uint32_t>(pos + 1);
+		}
+
+		// 把pos加入哈希链并查找此前最长的匹配，没有不短于kMinMatch的匹配时返回0
+		// previousLength为懒惰匹配中上一个位置的匹配长度，只有更长的匹配才有意义
+		int InsertAndFind(size_t pos, int previousLength, int& distance)
+		{
+			if (pos + kMinMatch > m_Size)
+				return 0;
+			uint32_t hash = Hash(pos);
+			uint32_t candidate = m_Head[hash];
+			m_Prev[pos & (kWindowSize - 1)] = candidate;
+			m_Head[hash] = static_cast<uint32_t>(pos + 1);
+
+			int limit = static_cast<int>((std::min)(m_Size - pos, static_cast<size_t>(kMaxMatch)));
+			int bestLength = (std::max)(previousLength, kMinMatch - 1);
+			if (bestLength >= limit)
+				return 0;
+			int chain = previousLength >= m_Params.goodLength ? m_Params.maxChain >> 2 : m_Params.maxChain;
+			const uint8_t* current = m_pSource + pos;
+			int found = 0;
+			for (; candidate != 0 && chain > 0; --chain)
+			{
+				size_t match = candidate - 1;
+				// 距离为32768时pos与match共用m_Prev的同一项，链会指回自己，因此最大距离取32767
+				if (match >= pos || pos - match >= kWindowSize)
+					break;
+				const uint8_t* previous = m_pSource + match;
+				candidate = m_Prev[match & (kWindowSize - 1)];
+				// 先比较能使匹配变长的那个字节
+				if (previous[bestLength] != current[bestLength] || previous[0] != current[0])
+					continue;
+
+				int length = 0;
+				while (length + 8 <= limit)
+				{
+					uint64_t a, b;
+					memcpy(&a, current + length, 8);
+					memcpy(&b, previous + length, 8);
+					if (a != b)
+						break;
+					length += 8;
+				}
+				while (length < limit && current[length] == previous[length])
+					++length;
+				if (length > bestLength)
+				{
+					bestLength = found = length;
+					distance = static_cast<int>(pos - match);
+					if (length >= m_Params.niceLength || length == limit)
+						break;
+				}
+			}
+			return found;
+		}
+
+	private:
+		uint32_t Hash(size_t pos) const
+		{
+			const uint8_t* p = m_pSource + pos;
+			uint32_t value = p[0] | (p[1] << 8) | (p[2] << 16);
+			return (value * 2654435761u) >> (32 - kHashBits);
+		}
+
+		const uint8_t* m_pSource;
+		size_t m_Size;
+		LevelParams m_Params;
+		std::vector<uint32_t> m_Head;		// 每个哈希值最近的位置 + 1，0表示没有
+		std::vector<uint32_t> m_Prev;		// 窗口内每个位置在链上的前一个位置 + 1
+	};
+
+	void DeflateStream(const uint8_t* source, size_t size, int level, std::vector<uint8_t>& output)
+	{
+		BitWriter writer(output);
+		const LevelParams& params = kLevels[level];
+		if (params.maxChain == 0)
+		{
+			WriteStored(writer, source, size, true);
+			writer.Align();
+			return;
+		}
+
+		MatchFinder finder(source, size, params);
+		std::vector<Symbol> symbols;
+		symbols.reserve(kBlockSymbols + 1);
+		size_t blockStart = 0, blockEnd = 0;
+		auto emit = [&](int value, int distance, size_t end) {
+			symbols.push_back({ static_cast<uint16_t>(value), static_cast<uint16_t>(distance) });
+			blockEnd = end;
+			if (symbols.size() >= kBlockSymbols)
+			{
+				WriteBlock(writer, symbols, source + blockStart, blockEnd - blockStart, false);
+				symbols.clear();
+				blockStart = blockEnd;
+			}
+		};
+
+		size_t pos = 0;
+		if (!params.lazy)
+		{
+			// 贪心匹配，长匹配内部的位置不再加入哈希链以节省时间
+			while (pos < size)
+			{
+				int distance = 0;
+				int length = finder.InsertAndFind(pos, 0, distance);
+				if (length == 0)
+				{
+					emit(source[pos], 0, pos + 1);
+					++pos;
+					continue;
+				}
+				emit(length, distance, pos + length);
+				if (length <= params.lazyLength)
+				{
+					for (size_t i = pos + 1; i < pos + length; ++i)
+						finder.Insert(i);
+				}
+				pos += length;
+			}
+		}
+		else
+		{
+			// 懒惰匹配: 上一个位置的匹配不比当前位置的长时才输出，否则上一个位置输出为字面量
+			bool pending = false;
+			int pendingLength = 0, pendingDistance = 0;
+			while (pos < size || pending)
+			{
+				int distance = 0, length = 0;
+				if (pos < size && (!pending || pendingLength < params.lazyLength))
+					length = finder.InsertAndFind(pos, pending ? pendingLength : 0, distance);
+				else if (pos < size)
+					finder.Insert(pos);
+
+				if (pending && pendingLength >= kMinMatch && length <= pendingLength)
+				{
+					// 匹配从pos - 1开始，pos已经加入哈希链
+					size_t end = pos - 1 + pendingLength;
+					emit(pendingLength, pendingDistance, end);
+					for (size_t i = pos + 1; i < end; ++i)
+						finder.Insert(i);
+					pos = end;
+					pending = false;
+					continue;
+				}
+				if (pending)
+					emit(source[pos - 1], 0, pos);
+				if (pos >= size)
+					break;
+				pending = true;
+				pendingLength = length;
+				pendingDistance = distance;
+				++pos;
+			}
+		}
+		WriteBlock(writer, symbols, source + blockStart, size - blockStart, true);
+		writer.Align();
+	}
+}
+
+bool Deflate::Inflate(const uint8_t* source, size_t sourceSize, uint8_t* destination, size_t destinationSize, size_t& written)
+{
+	size_t consumed = 0;
+	written = 0;
+	return InflateStream(source, sourceSize, destination, destinationSize, written, consumed);
+}
+
+bool Deflate::InflateZlib(const uint8_t* source, size_t sourceSize, uint8_t* destination, size_t destinationSize, size_t& written)
+{
+	written = 0;
+	// 头部: 压缩方法8(DEFLATE)，窗口不超过32KiB，没有预设字典，校验位使两字节能被31整除
+	if (sourceSize < 6)
+		return false;
+	uint32_t cmf = source[0], flags = source[1];
+	if ((cmf & 15) != 8 || (cmf >> 4) > 7 || ((cmf << 8) | flags) % 31 != 0 || (flags & 0x20))
+		return false;
+
+	size_t consumed = 0;
+	if (!InflateStream(source + 2, sourceSize - 2, destination, destinationSize, written, consumed) ||
+		sourceSize - 2 - consumed < 4)
+		return false;
+	const uint8_t* trailer = source + 2 + consumed;
+	uint32_t expected = (static_cast<uint32_t>(trailer[0]) << 24) | (trailer[1] << 16) | (trailer[2] << 8) | trailer[3];
+	return Adler32(1, destination, written) == expected;
+}
+
+uint32_t Deflate::Crc32(uint32_t crc, const uint8_t* data, size_t size)
+{
+	static const CrcTable table;
+	crc = ~crc;
+	for (size_t i = 0; i < size; ++i)
+		crc = table.entries[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+uint32_t Deflate::Adler32(uint32_t adler, const uint8_t* data, size_t size)
+{
+	// 每5552字节取一次模，保证32位的累加不溢出
+	const uint32_t kModulus = 65521;
+	uint32_t a = adler & 0xFFFF, b = adler >> 16;
+	while (size > 0)
+	{
+		size_t n = (std::min)(size, static_cast<size_t>(5552));
+		size -= n;
+		for (; n >= 8; n -= 8, data += 8)
+		{
+			a += data[0]; b += a;
+			a += data[1]; b += a;
+			a += data[2]; b += a;
+			a += data[3]; b += a;
+			a += data[4]; b += a;
+			a += data[5]; b += a;
+			a += data[6]; b += a;
+			a += data[7]; b += a;
+		}
+		for (; n > 0; --n)
+		{
+			a += *data++;
+			b += a;
+		}
+		a %= kModulus;
+		b %= kModulus;
+	}
+	return (b << 16) | a;
+}
+
+std::vector<uint8_t> Deflate::Compress(const uint8_t* source, size_t size, int level)
+{
+	std::vector<uint8_t> output;
+	output.reserve(size / 2 + 64);
+	DeflateStream(source, size, (std::max)(0, (std::min)(level, 9)), output);
+	return output;
+}
+
+std::vector<uint8_t> Deflate::CompressZlib(const uint8_t* source, size_t size, int level)
+{
+	level = (std::max)(0, (std::min)(level, 9));
+	std::vector<uint8_t> output;
+	output.reserve(size / 2 + 64);
+	// 头部: 压缩方法8，32KiB窗口，FLEVEL按级别给出(只用于提示)
+	uint32_t header = (0x78 << 8) | ((level <= 1 ? 0 : level <= 5 ? 1 : level == 6 ? 2 : 3) << 6);
+	if (header % 31 != 0)
+		header += 31 - header % 31;
+	output.push_back(static_cast<uint8_t>(header >> 8));
+	output.push_back(static_cast<uint8_t>(header));
+	DeflateStream(source, size, level, output);
+	uint32_t adler = Adler32(1, source, size);
+	for (int shift = 24; shift >= 0; shift -= 8)
+		output.push_back(static_cast<uint8_t>(adler >> shift));
+	return output;
+}
@@ -0,0 +1,40 @@
+﻿//***************************************************************************************
+// Deflate.h
+// Licensed under the MIT License.
+//
+// DEFLATE(RFC 1951)与zlib(RFC 1950)格式的解压与压缩，用于不依赖WIC读写PNG
+// - 解压到调用者提供的缓冲区，数据损坏、被截断或缓冲区不足时返回false，不会越界读写
+// - 哈夫曼解码先查10位的快速表，更长的码字按规范哈夫曼码逐位解码
+// - 压缩使用哈希链查找匹配(较高级别为懒惰匹配)，每个块在动态哈夫曼、固定哈夫曼与不压缩中取最小的一种
+// - 同时提供PNG与zlib使用的CRC-32与Adler-32校验
+// Portable DEFLATE/zlib decompressor into caller-provided memory and hash-chain
+// compressor with per-block dynamic Huffman tables, plus the CRC-32 and Adler-32
+// checksums used by PNG and zlib.
+//***************************************************************************************
+
+#ifndef DEFLATE_H
+#define DEFLATE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace Deflate
+{
+	// 解压原始的DEFLATE流，written返回解压出的字节数
+	bool Inflate(const uint8_t* source, size_t sourceSize, uint8_t* destination, size_t destinationSize, size_t& written);
+
+	// 解压zlib流(2字节头 + DEFLATE流 + Adler-32)，校验和不一致时返回false
+	bool InflateZlib(const uint8_t* source, size_t sourceSize, uint8_t* destination, size_t destinationSize, size_t& written);
+
+	// 压缩为原始的DEFLATE流，level为0~9，0为不压缩，越大匹配查找越充分、压缩越慢
+	std::vector<uint8_t> Compress(const uint8_t* source, size_t size, int level = 6);
+	// 压缩为zlib流
+	std::vector<uint8_t> CompressZlib(const uint8_t* source, size_t size, int level = 6);
+
+	// 累计校验和，首次调用时crc为0、adler为1
+	uint32_t Crc32(uint32_t crc, const uint8_t* data, size_t size);
+	uint32_t Adler32(uint32_t adler, const uint8_t* data, size_t size);
+}
+
+#endif
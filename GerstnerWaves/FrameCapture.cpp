@@ -0,0 +1,130 @@
+﻿#include "FrameCapture.h"
+
+namespace
+{
+	bool IsBgra(DXGI_FORMAT format)
+	{
+		return format == DXGI_FORMAT_B8G8R8A8_UNORM || format == DXGI_FORMAT_B8G8R8A8_UNORM_SRGB;
+	}
+
+	bool IsSupported(DXGI_FORMAT format)
+	{
+		return IsBgra(format) || format == DXGI_FORMAT_R8G8B8A8_UNORM || format == DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+	}
+}
+
+FrameCapture::FrameCapture(const FrameEncoder::Options& options, FrameEncoder::Sink sink, uint32_t slotCount)
+	: m_Encoder(options, std::move(sink)), m_Policy(options.policy), m_StagingTextures(slotCount > 0 ? slotCount : 1),
+	m_Desc(), m_FirstPending(), m_PendingCount(), m_DroppedFrames()
+{
+}
+
+HRESULT FrameCapture::Capture(ID3D11DeviceContext* deviceContext, ID3D11Texture2D* pTexture)
+{
+	if (!deviceContext || !pTexture)
+		return E_INVALIDARG;
+
+	D3D11_TEXTURE2D_DESC desc;
+	pTexture->GetDesc(&desc);
+	if (!IsSupported(desc.Format) || desc.ArraySize != 1)
+		return E_INVALIDARG;
+
+	// 尺寸或格式改变(如窗口大小改变)后重新创建暂存纹理
+	if (!m_StagingTextures[0] || desc.Width != m_Desc.Width || desc.Height != m_Desc.Height || desc.Format != m_Desc.Format)
+	{
+		Flush(deviceContext);
+		for (auto& pStaging : m_StagingTextures)
+			pStaging.Reset();
+		m_pResolveTexture.Reset();
+
+		ComPtr<ID3D11Device> device;
+		deviceContext->GetDevice(device.GetAddressOf());
+		m_Desc = CD3D11_TEXTURE2D_DESC(desc.Format, desc.Width, desc.Height, 1, 1, 0, D3D11_USAGE_STAGING, D3D11_CPU_ACCESS_READ);
+		for (auto& pStaging : m_StagingTextures)
+		{
+			HRESULT hr = device->CreateTexture2D(&m_Desc, nullptr, pStaging.GetAddressOf());
+			if (FAILED(hr))
+			{
+				m_StagingTextures[0].Reset();
+				return hr;
+			}
+		}
+	}
+
+	// 环满时按策略丢弃或等待最早的一帧，丢帧时编码器积压同样不再复制
+	if (m_PendingCount == static_cast<uint32_t>(m_StagingTextures.size()))
+	{
+		if (m_Policy == FrameEncoder::Policy::Drop)
+		{
+			++m_DroppedFrames;
+			return S_FALSE;
+		}
+		ReadBack(deviceContext, true);
+	}
+	if (m_Policy == FrameEncoder::Policy::Drop && !m_Encoder.CanSubmit())
+	{
+		++m_DroppedFrames;
+		return S_FALSE;
+	}
+
+	uint32_t slotCount = static_cast<uint32_t>(m_StagingTextures.size());
+	ID3D11Texture2D* pStaging = m_StagingTextures[(m_FirstPending + m_PendingCount) % slotCount].Get();
+	if (desc.SampleDesc.Count > 1)
+	{
+		if (!m_pResolveTexture)
+		{
+			ComPtr<ID3D11Device> device;
+			deviceContext->GetDevice(device.GetAddressOf());
+			CD3D11_TEXTURE2D_DESC resolveDesc(desc.Format, desc.Width, desc.Height, 1, 1, 0);
+			HRESULT hr = device->CreateTexture2D(&resolveDesc, nullptr, m_pResolveTexture.GetAddressOf());
+			if (FAILED(hr))
+				return hr;
+		}
+		deviceContext->ResolveSubresource(m_pResolveTexture.Get(), 0, pTexture, 0, desc.Format);
+		deviceContext->CopyResource(pStaging, m_pResolveTexture.Get());
+	}
+	else
+	{
+		deviceContext->CopyResource(pStaging, pTexture);
+	}
+	++m_PendingCount;
+	return S_OK;
+}
+
+void FrameCapture::Update(ID3D11DeviceContext* deviceContext)
+{
+	while (m_PendingCount > 0 && ReadBack(deviceContext, false))
+		continue;
+}
+
+void FrameCapture::Flush(ID3D11DeviceContext* deviceContext)
+{
+	while (m_PendingCount > 0)
+		ReadBack(deviceContext, true);
+	m_Encoder.Flush();
+}
+
+bool FrameCapture::ReadBack(ID3D11DeviceContext* deviceContext, bool wait)
+{
+	ID3D11Texture2D* pStaging = m_StagingTextures[m_FirstPending].Get();
+	D3D11_MAPPED_SUBRESOURCE mappedData;
+	HRESULT hr = deviceContext->Map(pStaging, 0, D3D11_MAP_READ, wait ? 0 : D3D11_MAP_FLAG_DO_NOT_WAIT, &mappedData);
+	if (hr == DXGI_ERROR_WAS_STILL_DRAWING)
+		return false;
+
+	// 映射失败(如设备移除)时放弃这一帧，避免环一直被占用
+	if (SUCCEEDED(hr))
+	{
+		// 编码器只复制像素，复制完即可解除映射；Block策略下这里可能等待编码器腾出缓冲区
+		m_Encoder.Submit(static_cast<const uint8_t*>(mappedData.pData), m_Desc.Width, m_Desc.Height, mappedData.RowPitch,
+			IsBgra(m_Desc.Format));
+		deviceContext->Unmap(pStaging, 0);
+	}
+	else
+	{
+		++m_DroppedFrames;
+	}
+	m_FirstPending = (m_FirstPending + 1) % static_cast<uint32_t>(m_StagingTextures.size());
+	--m_PendingCount;
+	return true;
+}
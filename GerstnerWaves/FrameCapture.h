@@ -0,0 +1,67 @@
+﻿//***************************************************************************************
+// FrameCapture.h
+// Licensed under the MIT License.
+//
+// 不阻塞渲染的截图与录制
+// - Capture把纹理(通常是后备缓冲区，多重采样时先解析)复制到N个暂存纹理组成的环中的下一个，不等待GPU
+// - Update在之后的帧中按顺序映射GPU已完成复制的暂存纹理(不等待)，提交给后台的FrameEncoder编码与写入
+// - 环满时按编码器的策略丢弃新帧或等待最早的一帧读回，编码器积压时同样处理
+// - 替代ScreenGrab中同步复制、映射与编码的SaveDDSTextureToFile/SaveWICTextureToFile
+// Non-blocking frame capture: a ring of staging textures read back a few frames later
+// and handed to a background FrameEncoder, with drop or block backpressure.
+//***************************************************************************************
+
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include <d3d11_1.h>
+#include <wrl/client.h>
+#include <vector>
+#include "FrameEncoder.h"
+
+class FrameCapture
+{
+public:
+	template<class T>
+	using ComPtr = Microsoft::WRL::ComPtr<T>;
+
+	// 默认3个暂存纹理，GPU通常落后CPU不超过2帧
+	static const uint32_t kDefaultSlotCount = 3;
+
+	FrameCapture(const FrameEncoder::Options& options, FrameEncoder::Sink sink, uint32_t slotCount = kDefaultSlotCount);
+	~FrameCapture() = default;
+
+	FrameCapture(const FrameCapture&) = delete;
+	FrameCapture& operator=(const FrameCapture&) = delete;
+
+	// 复制纹理，支持R8G8B8A8与B8G8R8A8格式(含sRGB)
+	// 丢弃时返回S_FALSE，尺寸或格式改变时先读回已复制的帧再重新创建暂存纹理
+	HRESULT Capture(ID3D11DeviceContext* deviceContext, ID3D11Texture2D* pTexture);
+
+	// 读回GPU已完成复制的帧，每帧调用一次
+	void Update(ID3D11DeviceContext* deviceContext);
+
+	// 等待所有已复制的帧读回并编码完成
+	void Flush(ID3D11DeviceContext* deviceContext);
+
+	// 暂存纹理的环中尚未读回的帧数
+	uint32_t GetPendingCount() const { return m_PendingCount; }
+	// 环满或编码器积压而没有复制的帧数，编码器自己丢弃的帧见编码器的统计
+	uint64_t GetDroppedFrames() const { return m_DroppedFrames; }
+	FrameEncoder::Statistics GetStatistics() const { return m_Encoder.GetStatistics(); }
+
+private:
+	// 读回最早的一帧，wait为false且GPU尚未完成复制时返回false
+	bool ReadBack(ID3D11DeviceContext* deviceContext, bool wait);
+
+	FrameEncoder m_Encoder;
+	FrameEncoder::Policy m_Policy;
+	std::vector<ComPtr<ID3D11Texture2D>> m_StagingTextures;
+	ComPtr<ID3D11Texture2D> m_pResolveTexture;		// 多重采样的纹理先解析到这里
+	D3D11_TEXTURE2D_DESC m_Desc;					// 暂存纹理的描述
+	uint32_t m_FirstPending;						// 最早的尚未读回的暂存纹理
+	uint32_t m_PendingCount;
+	uint64_t m_DroppedFrames;
+};
+
+#endif
@@ -0,0 +1,434 @@
+﻿#include "FrameEncoder.h"
+#include "DdsReader.h"
+#include "Deflate.h"
+#include "ThreadPool.h"
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+
+struct FrameEncoder::Impl
+{
+	// 编码完成、等待按顺序输出的帧
+	struct Encoded
+	{
+		std::vector<uint8_t> data;
+		uint64_t inputBytes;
+	};
+
+	Impl(const Options& options, Sink sink);
+
+	// 在编码线程上编码一帧，然后按顺序输出所有已完成的帧
+	void Run(uint64_t index, std::vector<uint8_t>& pixels, uint32_t width, uint32_t height, bool bgra);
+	void Drain();
+
+	Options options;
+	Sink sink;
+
+	mutable std::mutex mutex;
+	std::condition_variable condition;		// 有帧输出后通知，用于阻塞提交与Flush
+	std::vector<std::vector<uint8_t>> freeBuffers;
+	std::map<uint64_t, Encoded> completed;
+	size_t pendingCount;
+	uint64_t nextSubmitIndex;
+	uint64_t nextOutputIndex;
+	Statistics stats;
+	std::chrono::high_resolution_clock::time_point startTime;
+
+	// 持有时才能调用sink，保证输出按顺序且不并发
+	std::mutex sinkMutex;
+
+	// 最后声明，析构时先结束工作线程
+	ThreadPool pool;
+};
+
+namespace
+{
+	void WriteBe32(uint8_t* dst, uint32_t value)
+	{
+		dst[0] = static_cast<uint8_t>(value >> 24);
+		dst[1] = static_cast<uint8_t>(value >> 16);
+		dst[2] = static_cast<uint8_t>(value >> 8);
+		dst[3] = static_cast<uint8_t>(value);
+	}
+
+	// 追加一个PNG块: 长度 + 类型 + 数据 + CRC(类型与数据)
+	void AppendPngChunk(std::vector<uint8_t>& output, const char* type, const uint8_t* data, size_t size)
+	{
+		size_t start = output.size();
+		output.resize(start + 12 + size);
+		uint8_t* dst = output.data() + start;
+		WriteBe32(dst, static_cast<uint32_t>(size));
+		memcpy(dst + 4, type, 4);
+		if (size > 0)
+			memcpy(dst + 8, data, size);
+		WriteBe32(dst + 8 + size, Deflate::Crc32(0, dst + 4, size + 4));
+	}
+
+	// 取出一行的RGB，忽略Alpha(后备缓冲区的Alpha通常没有意义)
+	void ExtractRgb(const uint8_t* src, uint32_t width, bool bgra, uint8_t* dst)
+	{
+		int r = bgra ? 2 : 0, b = bgra ? 0 : 2;
+		for (uint32_t x = 0; x < width; ++x, src += 4, dst += 3)
+		{
+			dst[0] = src[r];
+			dst[1] = src[1];
+			dst[2] = src[b];
+		}
+	}
+
+	uint8_t Paeth(int a, int b, int c)
+	{
+		int p = a + b - c;
+		int pa = std::abs(p - a), pb = std::abs(p - b), pc = std::abs(p - c);
+		if (pa <= pb && pa <= pc)
+			return static_cast<uint8_t>(a);
+		return static_cast<uint8_t>(pb <= pc ? b : c);
+	}
+
+	// 用第filter种滤波处理一行，返回按有符号字节计算的绝对值之和(越小通常越容易压缩)
+	uint32_t FilterRow(int filter, const uint8_t* row, const uint8_t* prior, size_t size, uint8_t* dst)
+	{
+		const size_t bpp = 3;
+		uint32_t sum = 0;
+		for (size_t i = 0; i < size; ++i)
+		{
+			int left = i >= bpp ? row[i - bpp] : 0;
+			int up = prior[i];
+			int upLeft = i >= bpp ? prior[i - bpp] : 0;
+			int predicted;
+			switch (filter)
+			{
+			case 1: predicted = left; break;
+			case 2: predicted = up; break;
+			case 3: predicted = (left + up) >> 1; break;
+			case 4: predicted = Paeth(left, up, upLeft); break;
+			default: predicted = 0; break;
+			}
+			uint8_t value = static_cast<uint8_t>(row[i] - predicted);
+			dst[i] = value;
+			sum += value < 128 ? value : 256 - value;
+		}
+		return sum;
+	}
+
+	bool EncodePng(const uint8_t* pixels, uint32_t width, uint32_t height, size_t rowPitch, bool bgra, int level,
+		std::vector<uint8_t>& output)
+	{
+		// 每行在5种滤波中取绝对值之和最小的一种(与libpng的默认做法相同)
+		size_t rowSize = static_cast<size_t>(width) * 3;
+		std::vector<uint8_t> filtered((rowSize + 1) * height);
+		std::vector<uint8_t> rows(rowSize * 2), candidate(rowSize), best(rowSize);
+		uint8_t* current = rows.data();
+		uint8_t* prior = rows.data() + rowSize;
+		memset(prior, 0, rowSize);
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			ExtractRgb(pixels + y * rowPitch, width, bgra, current);
+			uint8_t* dst = filtered.data() + y * (rowSize + 1);
+			uint32_t bestSum = UINT32_MAX;
+			for (int filter = 0; filter < 5; ++filter)
+			{
+				uint32_t sum = FilterRow(filter, current, prior, rowSize, candidate.data());
+				if (sum < bestSum)
+				{
+					bestSum = sum;
+					dst[0] = static_cast<uint8_t>(filter);
+					best.swap(candidate);
+				}
+			}
+			memcpy(dst + 1, best.data(), rowSize);
+			std::swap(current, prior);
+		}
+		std::vector<uint8_t> compressed = Deflate::CompressZlib(filtered.data(), filtered.size(), level);
+
+		static const uint8_t kSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+		uint8_t header[13] = {};
+		WriteBe32(header, width);
+		WriteBe32(header + 4, height);
+		header[8] = 8;		// 位深度
+		header[9] = 2;		// 颜色类型: RGB
+		output.assign(kSignature, kSignature + 8);
+		AppendPngChunk(output, "IHDR", header, sizeof(header));
+		AppendPngChunk(output, "IDAT", compressed.data(), compressed.size());
+		AppendPngChunk(output, "IEND", nullptr, 0);
+		return true;
+	}
+
+	bool EncodeDds(const uint8_t* pixels, uint32_t width, uint32_t height, size_t rowPitch, bool bgra,
+		std::vector<uint8_t>& output)
+	{
+		DdsReader::Desc desc = { DdsReader::Dimension::Texture2D, bgra ? DdsFormat::B8G8R8A8_UNORM : DdsFormat::R8G8B8A8_UNORM,
+			width, height, 1, 1, 1, false, DdsReader::AlphaMode::Opaque };
+		output = DdsReader::CreateHeader(desc);
+		size_t headerSize = output.size();
+		size_t rowSize = static_cast<size_t>(width) * 4;
+		output.resize(headerSize + rowSize * height);
+		for (uint32_t y = 0; y < height; ++y)
+			memcpy(output.data() + headerSize + y * rowSize, pixels + y * rowPitch, rowSize);
+		return true;
+	}
+
+	bool EncodeRgb(const uint8_t* pixels, uint32_t width, uint32_t height, size_t rowPitch, bool bgra,
+		std::vector<uint8_t>& output)
+	{
+		size_t rowSize = static_cast<size_t>(width) * 3;
+		output.resize(rowSize * height);
+		for (uint32_t y = 0; y < height; ++y)
+			ExtractRgb(pixels + y * rowPitch, width, bgra, output.data() + y * rowSize);
+		return true;
+	}
+
+	// BT.709有限范围: Y在[16, 235]，U、V在[16, 240]，系数放大256倍
+	// 加上的常数使被移位的值总为正，同时完成四舍五入
+	bool EncodeYuv420(const uint8_t* pixels, uint32_t width, uint32_t height, size_t rowPitch, bool bgra,
+		std::vector<uint8_t>& output)
+	{
+		if (width % 2 != 0 || height % 2 != 0)
+			return false;
+		size_t lumaSize = static_cast<size_t>(width) * height;
+		size_t chromaWidth = width / 2;
+		output.resize(lumaSize + lumaSize / 2);
+		uint8_t* planeY = output.data();
+		uint8_t* planeU = planeY + lumaSize;
+		uint8_t* planeV = planeU + lumaSize / 4;
+		int r = bgra ? 2 : 0, b = bgra ? 0 : 2;
+		for (uint32_t y = 0; y < height; y += 2)
+		{
+			const uint8_t* row0 = pixels + y * rowPitch;
+			const uint8_t* row1 = row0 + rowPitch;
+			uint8_t* dstY0 = planeY + static_cast<size_t>(y) * width;
+			uint8_t* dstY1 = dstY0 + width;
+			uint8_t* dstU = planeU + y / 2 * chromaWidth;
+			uint8_t* dstV = planeV + y / 2 * chromaWidth;
+			for (uint32_t x = 0; x < width; x += 2)
+			{
+				const uint8_t* p[4] = { row0 + x * 4, row0 + x * 4 + 4, row1 + x * 4, row1 + x * 4 + 4 };
+				uint8_t* dstY[4] = { dstY0 + x, dstY0 + x + 1, dstY1 + x, dstY1 + x + 1 };
+				int sumR = 0, sumG = 0, sumB = 0;
+				for (int i = 0; i < 4; ++i)
+				{
+					*dstY[i] = static_cast<uint8_t>(((47 * p[i][r] + 157 * p[i][1] + 16 * p[i][b] + 128) >> 8) + 16);
+					sumR += p[i][r];
+					sumG += p[i][1];
+					sumB += p[i][b];
+				}
+				// 2x2像素的平均值，每组系数之和为0(U的G系数取-86而不是-87)，加上(128 + 0.5) * 1024
+				dstU[x / 2] = static_cast<uint8_t>((-26 * sumR - 86 * sumG + 112 * sumB + 131584) >> 10);
+				dstV[x / 2] = static_cast<uint8_t>((112 * sumR - 102 * sumG - 10 * sumB + 131584) >> 10);
+			}
+		}
+		return true;
+	}
+}
+
+FrameEncoder::Impl::Impl(const Options& options, Sink sink)
+	: options(options), sink(std::move(sink)), pendingCount(), nextSubmitIndex(), nextOutputIndex(), stats(),
+	pool(options.threadCount)
+{
+	if (this->options.maxPendingFrames == 0)
+		this->options.maxPendingFrames = 1;
+}
+
+void FrameEncoder::Impl::Run(uint64_t index, std::vector<uint8_t>& pixels, uint32_t width, uint32_t height, bool bgra)
+{
+	auto start = std::chrono::high_resolution_clock::now();
+	Encoded encoded;
+	encoded.inputBytes = static_cast<uint64_t>(width) * height * 4;
+	// 编码失败(如YUV420的宽高为奇数)时data为空，输出时跳过
+	if (!Encode(options.format, pixels.data(), width, height, static_cast<size_t>(width) * 4, bgra, options.pngLevel, encoded.data))
+		encoded.data.clear();
+	double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stats.encodeSeconds += seconds;
+		completed[index] = std::move(encoded);
+		freeBuffers.push_back(std::move(pixels));
+	}
+	Drain();
+}
+
+void FrameEncoder::Impl::Drain()
+{
+	// 其他线程正在输出时也等待，之后由本线程检查是否还有轮到的帧
+	std::lock_guard<std::mutex> sinkLock(sinkMutex);
+	for (;;)
+	{
+		Encoded encoded;
+		uint64_t index;
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			auto it = completed.find(nextOutputIndex);
+			if (it == completed.end())
+				return;
+			encoded = std::move(it->second);
+			completed.erase(it);
+			index = nextOutputIndex++;
+		}
+
+		if (!encoded.data.empty())
+			sink(index, encoded.data);
+
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			--pendingCount;
+			if (encoded.data.empty())
+				++stats.droppedFrames;
+			else
+			{
+				++stats.encodedFrames;
+				stats.inputBytes += encoded.inputBytes;
+				stats.outputBytes += encoded.data.size();
+			}
+			stats.elapsedSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - startTime).count();
+		}
+		condition.notify_all();
+	}
+}
+
+FrameEncoder::Options FrameEncoder::GetDefaultOptions()
+{
+	return Options{ Format::Png, Policy::Drop, 4, 0, 1 };
+}
+
+FrameEncoder::FrameEncoder(const Options& options, Sink sink)
+	: m_pImpl(std::make_unique<Impl>(options, std::move(sink)))
+{
+}
+
+FrameEncoder::~FrameEncoder()
+{
+	Flush();
+}
+
+bool FrameEncoder::CanSubmit() const
+{
+	std::lock_guard<std::mutex> lock(m_pImpl->mutex);
+	return m_pImpl->pendingCount < m_pImpl->options.maxPendingFrames;
+}
+
+bool FrameEncoder::Submit(const uint8_t* pixels, uint32_t width, uint32_t height, size_t rowPitch, bool bgra)
+{
+	Impl& impl = *m_pImpl;
+	uint64_t index;
+	std::vector<uint8_t> buffer;
+	{
+		std::unique_lock<std::mutex> lock(impl.mutex);
+		if (impl.stats.submittedFrames++ == 0)
+			impl.startTime = std::chrono::high_resolution_clock::now();
+		if (impl.pendingCount >= impl.options.maxPendingFrames)
+		{
+			if (impl.options.policy == Policy::Drop)
+			{
+				++impl.stats.droppedFrames;
+				return false;
+			}
+			impl.condition.wait(lock, [&impl]() { return impl.pendingCount < impl.options.maxPendingFrames; });
+		}
+		++impl.pendingCount;
+		index = impl.nextSubmitIndex++;
+		if (!impl.freeBuffers.empty())
+		{
+			buffer = std::move(impl.freeBuffers.back());
+			impl.freeBuffers.pop_back();
+		}
+	}
+
+	// 复制为紧密排列的行，缓冲区在帧之间复用，尺寸不变时不再分配内存
+	size_t rowSize = static_cast<size_t>(width) * 4;
+	buffer.resize(rowSize * height);
+	if (rowPitch == rowSize)
+		memcpy(buffer.data(), pixels, buffer.size());
+	else
+	{
+		for (uint32_t y = 0; y < height; ++y)
+			memcpy(buffer.data() + y * rowSize, pixels + y * rowPitch, rowSize);
+	}
+
+	auto pBuffer = std::make_shared<std::vector<uint8_t>>(std::move(buffer));
+	impl.pool.Enqueue([&impl, index, pBuffer, width, height, bgra]() {
+		impl.Run(index, *pBuffer, width, height, bgra);
+	});
+	return true;
+}
+
+void FrameEncoder::Flush()
+{
+	std::unique_lock<std::mutex> lock(m_pImpl->mutex);
+	m_pImpl->condition.wait(lock, [this]() { return m_pImpl->pendingCount == 0; });
+}
+
+FrameEncoder::Statistics FrameEncoder::GetStatistics() const
+{
+	std::lock_guard<std::mutex> lock(m_pImpl->mutex);
+	return m_pImpl->stats;
+}
+
+bool FrameEncoder::Encode(Format format, const uint8_t* pixels, uint32_t width, uint32_t height, size_t rowPitch, bool bgra,
+	int pngLevel, std::vector<uint8_t>& output)
+{
+	if (width == 0 || height == 0)
+		return false;
+	switch (format)
+	{
+	case Format::Png: return EncodePng(pixels, width, height, rowPitch, bgra, pngLevel, output);
+	case Format::Dds: return EncodeDds(pixels, width, height, rowPitch, bgra, output);
+	case Format::Rgb: return EncodeRgb(pixels, width, height, rowPitch, bgra, output);
+	case Format::Yuv420: return EncodeYuv420(pixels, width, height, rowPitch, bgra, output);
+	default: return false;
+	}
+}
+
+const char* FrameEncoder::GetFormatName(Format format)
+{
+	switch (format)
+	{
+	case Format::Png: return "PNG";
+	case Format::Dds: return "DDS";
+	case Format::Rgb: return "RGB24";
+	case Format::Yuv420: return "YUV420";
+	default: return "unknown";
+	}
+}
+
+const wchar_t* FrameEncoder::GetExtension(Format format)
+{
+	switch (format)
+	{
+	case Format::Png: return L".png";
+	case Format::Dds: return L".dds";
+	case Format::Rgb: return L".rgb";
+	case Format::Yuv420: return L".yuv";
+	default: return L"";
+	}
+}
+
+FrameEncoder::Sink FrameEncoder::CreateFileSink(const std::wstring& path, Format format)
+{
+	const wchar_t* extension = GetExtension(format);
+	if (format == Format::Rgb || format == Format::Yuv420)
+	{
+		// 序列文件在第一帧输出时创建
+		// 文件名经由std::filesystem::path传给文件流，宽字符串版本的open只有MSVC提供
+		auto pFile = std::make_shared<std::ofstream>();
+		std::filesystem::path fileName = path + extension;
+		return [pFile, fileName](uint64_t, const std::vector<uint8_t>& data) {
+			if (!pFile->is_open())
+				pFile->open(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+			pFile->write(reinterpret_cast<const char*>(data.data()), data.size());
+		};
+	}
+
+	return [path, extension](uint64_t frameIndex, const std::vector<uint8_t>& data) {
+		std::wstring number = std::to_wstring(frameIndex);
+		if (number.size() < 6)
+			number.insert(0, 6 - number.size(), L'0');
+		std::ofstream fout(std::filesystem::path(path + L"_" + number + extension), std::ios::out | std::ios::binary);
+		fout.write(reinterpret_cast<const char*>(data.data()), data.size());
+	};
+}
@@ -0,0 +1,105 @@
+﻿//***************************************************************************************
+// FrameEncoder.h
+// Licensed under the MIT License.
+//
+// 截图与录制帧的后台编码
+// - Submit把CPU上的RGBA8/BGRA8图像复制到复用的缓冲区后立即返回，编码在自己的线程池中进行
+// - 编码为PNG(内置的Deflate压缩)、DDS(不压缩)、RGB24或YUV420(I420，BT.709有限范围)
+// - 编码结果按提交的顺序交给输出回调，RGB24与YUV420的输出首尾相接即为原始的视频序列
+// - 尚未输出的帧达到上限时按策略丢弃新帧或阻塞提交的线程
+// - 不依赖D3D与Windows，可以直接用CPU上的图像测试(见Tools/FrameEncoderTest)与测量吞吐量(见AssetTool的capture命令)
+// Background frame encoder (PNG with in-tree deflate, raw DDS, RGB24 and I420 sequences)
+// with in-order output and a drop-or-block backpressure policy; independent of D3D.
+//***************************************************************************************
+
+#ifndef FRAMEENCODER_H
+#define FRAMEENCODER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+class FrameEncoder
+{
+public:
+	enum class Format
+	{
+		Png,		// 每帧一个PNG文件，RGB 8位
+		Dds,		// 每帧一个DDS文件，与输入相同的RGBA8/BGRA8
+		Rgb,		// RGB24逐帧相接
+		Yuv420		// I420逐帧相接(Y平面，然后是1/4大小的U与V平面)，宽高需要为偶数
+	};
+
+	// 尚未输出的帧达到上限时的处理方式
+	enum class Policy
+	{
+		Drop,		// 丢弃新提交的帧，Submit返回false，适合录制时保证帧率
+		Block		// 等待最早的帧输出后再提交，适合截图或离线录制保证不丢帧
+	};
+
+	struct Options
+	{
+		Format format;
+		Policy policy;
+		uint32_t maxPendingFrames;	// 已提交但尚未输出的最大帧数，决定输入缓冲区的最大数目
+		uint32_t threadCount;		// 编码线程数，为0时使用硬件线程数减1(至少为1)
+		int pngLevel;				// PNG的Deflate压缩级别(0~9)
+	};
+
+	// 默认: PNG，丢帧，最多4帧，自动线程数，压缩级别1
+	static Options GetDefaultOptions();
+
+	// 按提交的顺序在某个编码线程上调用，同一时间只有一个调用，frameIndex为接受的帧的序号(从0开始，不含丢弃的帧)
+	typedef std::function<void(uint64_t frameIndex, const std::vector<uint8_t>& data)> Sink;
+
+	struct Statistics
+	{
+		uint64_t submittedFrames;	// 调用Submit的次数
+		uint64_t encodedFrames;		// 已输出的帧数
+		uint64_t droppedFrames;		// 丢弃与编码失败的帧数
+		uint64_t inputBytes;		// 已输出的帧的输入字节数(宽 * 高 * 4)
+		uint64_t outputBytes;		// 已输出的编码后字节数
+		double encodeSeconds;		// 所有编码线程的编码耗时之和
+		double elapsedSeconds;		// 第一次提交到最后一帧输出的时间
+	};
+
+	FrameEncoder(const Options& options, Sink sink);
+	// 等待已提交的帧全部输出
+	~FrameEncoder();
+
+	FrameEncoder(const FrameEncoder&) = delete;
+	FrameEncoder& operator=(const FrameEncoder&) = delete;
+
+	// 不丢帧时Submit可以立即接受一帧
+	bool CanSubmit() const;
+
+	// 提交一帧，pixels在返回后即可复用，bgra表示像素按B、G、R、A排列
+	// 按Drop策略丢弃时返回false
+	bool Submit(const uint8_t* pixels, uint32_t width, uint32_t height, size_t rowPitch, bool bgra);
+
+	// 等待已提交的帧全部输出
+	void Flush();
+
+	Statistics GetStatistics() const;
+
+	// 把一帧编码为format，可以在任意线程上调用
+	static bool Encode(Format format, const uint8_t* pixels, uint32_t width, uint32_t height, size_t rowPitch, bool bgra,
+		int pngLevel, std::vector<uint8_t>& output);
+
+	static const char* GetFormatName(Format format);
+	// 输出文件的扩展名(含点)
+	static const wchar_t* GetExtension(Format format);
+
+	// 写入文件的输出回调: PNG与DDS每帧写入"path_000000.png"这样的文件，RGB24与YUV420依次追加到"path.rgb"/"path.yuv"
+	// path不含扩展名，文件无法写入时丢弃该帧
+	static Sink CreateFileSink(const std::wstring& path, Format format);
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_pImpl;
+};
+
+#endif
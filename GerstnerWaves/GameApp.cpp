@@ -1,6 +1,11 @@
 #include "GameApp.h"
 #include "d3dUtil.h"
 #include "DXTrace.h"
+#include "ResourceCache.h"
+#include "TextureBudget.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include <chrono>
 using namespace DirectX;
 
 #pragma warning(disable: 26812)
@@ -17,12 +22,29 @@ GameApp::GameApp(HINSTANCE hInstance)
 	m_WindDirection(0),
 	m_WindSpeed(0),
 	m_IsGpuEnable(true),
-	m_IsWireframe(false)
+	m_IsWireframe(false),
+	m_IsClusterCullingEnable(true),
+	m_ClusterCullingStats(),
+	m_ClusterCullingTime(),
+	m_IsPartCullingSceneVisible(false),
+	m_IsPartCullingEnable(true),
+	m_VisiblePartCount(),
+	m_PartCullingTime(),
+	m_StartupTime(),
+	m_pAssetLoader(std::make_unique<AssetLoader>()),
+	m_pMipStreamer(std::make_unique<MipStreamer>(&ThreadPool::GetDefault())),
+	m_WaterTextureId(MipStreamer::kInvalidId),
+	m_IsScreenshotRequested(false),
+	m_RecordingCount()
 {
 }
 
 GameApp::~GameApp()
 {
+	// дѸƵδصĽͼ¼֡
+	if (m_pScreenshotCapture)
+		m_pScreenshotCapture->Flush(m_pd3dImmediateContext.Get());
+	StopRecording();
 }
 
 bool GameApp::Init()
@@ -33,6 +55,11 @@ bool GameApp::Init()
 	// ȳʼȾ״̬ԹЧʹ
 	RenderStates::InitAll(m_pd3dDevice.Get());
 
+	// ԴʱɫģԴжȡȡɢļ
+	auto start = std::chrono::high_resolution_clock::now();
+	if (m_AssetPackage.Open(L"Assets.pak"))
+		AssetPackage::Mount(&m_AssetPackage);
+
 	if (!m_pBasicEffect->InitAll(m_pd3dDevice.Get()))
 		return false;
 	
@@ -42,6 +69,43 @@ bool GameApp::Init()
 	if (!InitResource())
 		return false;
 
+	auto end = std::chrono::high_resolution_clock::now();
+	m_StartupTime = std::chrono::duration<float, std::milli>(end - start).count();
+	wchar_t strBuffer[256];
+	swprintf_s(strBuffer, L"Startup (%ls, %zu entries): %.1f ms\n",
+		m_AssetPackage.IsOpen() ? L"packed" : L"loose", m_AssetPackage.GetEntryCount(), m_StartupTime);
+	OutputDebugStringW(strBuffer);
+	AssetLoader::Statistics loaderStats = m_pAssetLoader->GetStatistics();
+	swprintf_s(strBuffer, L"AssetLoader: %llu requests (%llu merged), read %.2f ms, decode %.2f ms, upload %.2f ms\n",
+		loaderStats.requestCount, loaderStats.mergedCount, loaderStats.readSeconds * 1000.0,
+		loaderStats.decodeSeconds * 1000.0, loaderStats.uploadSeconds * 1000.0);
+	OutputDebugStringW(strBuffer);
+	AssetPackage::DecompressStatistics stats = m_AssetPackage.GetStatistics();
+	if (stats.entryCount > 0)
+	{
+		swprintf_s(strBuffer, L"Decompressed %llu entries: %llu -> %llu bytes (ratio %.3f) in %.2f ms, %.2f GB/s (%.2f GB/s per core)\n",
+			stats.entryCount, stats.storedBytes, stats.rawBytes, (double)stats.storedBytes / stats.rawBytes, stats.seconds * 1000.0,
+			stats.rawBytes / stats.seconds / 1e9, stats.rawBytes / stats.seconds / 1e9 / stats.threadCount);
+		OutputDebugStringW(strBuffer);
+	}
+	ResourceCache::Statistics cacheStats = ResourceCache::GetDefault().GetStatistics();
+	swprintf_s(strBuffer, L"ResourceCache: %llu hits, %llu misses, %llu evictions, %zu entries (%zu bytes)\n",
+		cacheStats.hitCount, cacheStats.missCount, cacheStats.evictCount, cacheStats.entryCount, cacheStats.totalBytes);
+	OutputDebugStringW(strBuffer);
+	TextureBudget::Statistics budgetStats = TextureBudget::GetDefault().GetStatistics();
+	swprintf_s(strBuffer, L"TextureBudget: %zu textures, %zu -> %zu bytes (%llu mips skipped), budget %zu bytes\n",
+		budgetStats.textureCount, budgetStats.fullBytes, budgetStats.residentBytes, budgetStats.trimmedMipCount,
+		budgetStats.budget);
+	OutputDebugStringW(strBuffer);
+
+	// F12ͼ: ͼ٣֡PNGϸߵļѹ
+	FrameEncoder::Options screenshotOptions = FrameEncoder::GetDefaultOptions();
+	screenshotOptions.policy = FrameEncoder::Policy::Block;
+	screenshotOptions.threadCount = 1;
+	screenshotOptions.pngLevel = 6;
+	m_pScreenshotCapture = std::make_unique<FrameCapture>(screenshotOptions,
+		FrameEncoder::CreateFileSink(L"Screenshot", screenshotOptions.format), 1);
+
 	// ʼ̲꣬Ҫ
 	m_pMouse->SetWindow(m_hMainWnd);
 	m_pMouse->SetMode(DirectX::Mouse::MODE_RELATIVE);
@@ -103,6 +167,8 @@ void GameApp::OnResize()
 
 void GameApp::UpdateScene(float dt)
 {
+	// 첽ص豸Դ
+	m_pAssetLoader->Update();
 
 	// ¼ȡƫ
 	Mouse::State mouseState = m_pMouse->GetState();
@@ -134,6 +200,31 @@ void GameApp::UpdateScene(float dt)
 
 	m_pGerstnerWavesEffect->SetViewMatrix(m_pCamera->GetViewXM());
 	m_pGerstnerWavesEffect->SetEyePos(m_pCamera->GetPosition());
+
+	// ѡLOD
+	m_Ground.SelectLod(*m_pCamera);
+
+	// Եдزüͳƺʱ
+	if (m_IsClusterCullingEnable)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		m_ClusterCullingStats = m_Ground.CullClusters(*m_pCamera);
+		auto end = std::chrono::high_resolution_clock::now();
+		float time = std::chrono::duration<float, std::micro>(end - start).count();
+		// ƽʾ
+		m_ClusterCullingTime = m_ClusterCullingTime * 0.95f + time * 0.05f;
+	}
+
+	// ԶPartԳPartüͳƺʱ
+	if (m_IsPartCullingSceneVisible && m_IsPartCullingEnable)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		m_VisiblePartCount = m_PartCullingScene.CullParts(*m_pCamera);
+		auto end = std::chrono::high_resolution_clock::now();
+		float time = std::chrono::duration<float, std::micro>(end - start).count();
+		// ƽʾ
+		m_PartCullingTime = m_PartCullingTime * 0.95f + time * 0.05f;
+	}
 	
 	// ùֵ
 	m_pMouse->ResetScrollWheelValue();
@@ -145,19 +236,51 @@ void GameApp::UpdateScene(float dt)
 		m_pGerstnerWavesEffect->SetRSWireframe(m_IsWireframe);
 	}
 
+	// شزü
+	if (m_KeyboardTracker.IsKeyPressed(Keyboard::D3))
+	{
+		m_IsClusterCullingEnable = !m_IsClusterCullingEnable;
+		if (!m_IsClusterCullingEnable)
+		{
+			m_Ground.ResetClusterCulling();
+			m_ClusterCullingStats = GameObject::ClusterCullingStatistics();
+			m_ClusterCullingTime = 0.0f;
+		}
+	}
+
+	// ضPartԳ
+	if (m_KeyboardTracker.IsKeyPressed(Keyboard::D4))
+	{
+		m_IsPartCullingSceneVisible = !m_IsPartCullingSceneVisible;
+	}
+
+	// Partü
+	if (m_KeyboardTracker.IsKeyPressed(Keyboard::D5))
+	{
+		m_IsPartCullingEnable = !m_IsPartCullingEnable;
+		if (!m_IsPartCullingEnable)
+		{
+			m_PartCullingScene.ResetPartCulling();
+			m_VisiblePartCount = 0;
+			m_PartCullingTime = 0.0f;
+		}
+	}
+
 	// CPU/GPUģʽл
 	if (m_KeyboardTracker.IsKeyPressed(Keyboard::D1))
 	{
 		m_IsGpuEnable = !m_IsGpuEnable;
 		if (m_IsGpuEnable)
 		{
-			HR(m_pGpuGerstnerWavesRender->InitResource(m_pd3dDevice.Get(), L"..\\Texture\\water2.dds",
+			HR(m_pGpuGerstnerWavesRender->InitResource(m_pd3dDevice.Get(), L"",
 				256, 256, 5.0f, 5.0f, 0.625f, m_NumWaves, m_Gradient, m_GerstnerWaveParameters));
+			m_pGpuGerstnerWavesRender->SetTexture(m_pWaterTexture.Get());
 		}
 		else
 		{
-			HR(m_pCpuGerstnerWavesRender->InitResource(m_pd3dDevice.Get(), L"..\\Texture\\water2.dds",
+			HR(m_pCpuGerstnerWavesRender->InitResource(m_pd3dDevice.Get(), L"",
 				256, 256, 5.0f, 5.0f, 0.625f, m_NumWaves, m_Gradient, m_GerstnerWaveParameters));
+			m_pCpuGerstnerWavesRender->SetTexture(m_pWaterTexture.Get());
 		}
 	}
 
@@ -167,6 +290,54 @@ void GameApp::UpdateScene(float dt)
 	else
 		m_pCpuGerstnerWavesRender->Update(m_Timer.TotalTime());
 
+	// ˮʽ: ˮľmipѶmipÿ֡ϴ256KB
+	if (m_WaterTextureId != MipStreamer::kInvalidId)
+	{
+		// ˮԭΪģ߳255 * 0.625ظ5
+		const float halfSize = 255 * 0.625f * 0.5f;
+		XMFLOAT3 pos = m_pCamera->GetPosition();
+		float dx = (std::max)(fabsf(pos.x) - halfSize, 0.0f);
+		float dz = (std::max)(fabsf(pos.z) - halfSize, 0.0f);
+		float distance = sqrtf(dx * dx + pos.y * pos.y + dz * dz);
+		const DdsReader& reader = m_pMipStreamer->GetReader(m_WaterTextureId);
+		float desiredMip = MipStreamer::ComputeDesiredMip((std::max)(reader.GetWidth(), reader.GetHeight()),
+			halfSize * 2.0f / 5.0f, distance, m_pCamera->GetFovY(), m_pCamera->GetViewPort().Height);
+		m_pMipStreamer->SetDesiredMip(m_WaterTextureId, static_cast<uint32_t>((std::max)(desiredMip, 0.0f)));
+
+		m_pMipStreamer->Update(256 * 1024,
+			[this](MipStreamer::TextureId id, uint32_t mip) {
+				UpdateStreamingTextureMip(m_pd3dImmediateContext.Get(), m_pWaterTexture.Get(), m_pMipStreamer->GetReader(id), mip);
+			},
+			[this](MipStreamer::TextureId, uint32_t residentMip) {
+				// ʱֻҪ߲һmipԴʱѾ
+				ComPtr<ID3D11Resource> pResource;
+				m_pWaterTexture->GetResource(pResource.GetAddressOf());
+				m_pd3dImmediateContext->SetResourceMinLOD(pResource.Get(), static_cast<FLOAT>(residentMip));
+			});
+	}
+
+	// F12ͼF11ʼ/ֹͣ¼ƣ󱸻DrawSceneгǰ
+	if (m_KeyboardTracker.IsKeyPressed(Keyboard::F12))
+		m_IsScreenshotRequested = true;
+	if (m_KeyboardTracker.IsKeyPressed(Keyboard::F11))
+	{
+		if (m_pRecordCapture)
+			StopRecording();
+		else
+		{
+			// ¼ΪYUV420Уʱ֡Ⱦ
+			FrameEncoder::Options options = FrameEncoder::GetDefaultOptions();
+			options.format = FrameEncoder::Format::Yuv420;
+			options.maxPendingFrames = 8;
+			m_pRecordCapture = std::make_unique<FrameCapture>(options,
+				FrameEncoder::CreateFileSink(L"Recording_" + std::to_wstring(m_RecordingCount++), options.format));
+		}
+	}
+
+	// ֮ǰ֡GPUɸƵĽͼ¼̨֡
+	m_pScreenshotCapture->Update(m_pd3dImmediateContext.Get());
+	if (m_pRecordCapture)
+		m_pRecordCapture->Update(m_pd3dImmediateContext.Get());
 
 	// ˳Ӧ򴰿ڷϢ
 	if (m_KeyboardTracker.IsKeyPressed(Keyboard::Escape))
@@ -189,6 +360,14 @@ void GameApp::DrawScene()
 	m_pBasicEffect->SetRenderDefault(m_pd3dImmediateContext.Get(), BasicEffect::RenderObject);
 	m_Ground.Draw(m_pd3dImmediateContext.Get(), m_pBasicEffect.get());
 
+	// ƶPartԳóû
+	if (m_IsPartCullingSceneVisible)
+	{
+		m_pBasicEffect->SetTextureUsed(false);
+		m_PartCullingScene.Draw(m_pd3dImmediateContext.Get(), m_pBasicEffect.get());
+		m_pBasicEffect->SetTextureUsed(true);
+	}
+
 	// Ʋ
 	m_pGerstnerWavesEffect->SetRenderDefault(m_pd3dImmediateContext.Get());
 	if (m_IsGpuEnable)
@@ -207,19 +386,156 @@ void GameApp::DrawScene()
 		text += m_IsGpuEnable ? L"GPUͨüģʽ  " : L"CPU̬ģʽ  ";
 		text += L"(1-л)\n߿:";
 		text += m_IsWireframe ? L"  " : L"  ";
-		text += L"(2-л)";
+		text += L"(2-л)\nزü:";
+		text += m_IsClusterCullingEnable ? L"  " : L"  ";
+		text += L"(3-л)";
+		if (m_IsClusterCullingEnable)
+		{
+			wchar_t strBuffer[128];
+			swprintf_s(strBuffer, L"\nɼ: %u/%u  ޳: %u/%u  ʱ: %.1fus",
+				m_ClusterCullingStats.visibleClusterCount, m_ClusterCullingStats.clusterCount,
+				m_ClusterCullingStats.triangleCount - m_ClusterCullingStats.visibleTriangleCount,
+				m_ClusterCullingStats.triangleCount, m_ClusterCullingTime);
+			text += strBuffer;
+		}
+		text += L"\nPartԳ:";
+		text += m_IsPartCullingSceneVisible ? L"  " : L"  ";
+		text += L"(4-л)  Partü:";
+		text += m_IsPartCullingEnable ? L"  " : L"  ";
+		text += L"(5-л)";
+		if (m_IsPartCullingSceneVisible && m_IsPartCullingEnable)
+		{
+			wchar_t strBuffer[128];
+			swprintf_s(strBuffer, L"\nɼPart: %u/%zu  ʱ: %.1fus",
+				m_VisiblePartCount, m_PartCullingScene.GetModel().modelParts.size(), m_PartCullingTime);
+			text += strBuffer;
+		}
+		wchar_t strBuffer[128];
+		swprintf_s(strBuffer, L"\nԴ: %ls  ʱ: %.1fms",
+			m_AssetPackage.IsOpen() ? L"Դ" : L"ɢļ", m_StartupTime);
+		text += strBuffer;
+		ResourceCache::Statistics cacheStats = ResourceCache::GetDefault().GetStatistics();
+		swprintf_s(strBuffer, L"\nԴ:  %llu  δ %llu  ̭ %llu  ռ: %.1fMB",
+			cacheStats.hitCount, cacheStats.missCount, cacheStats.evictCount, cacheStats.totalBytes / 1048576.0);
+		text += strBuffer;
+		if (m_WaterTextureId != MipStreamer::kInvalidId)
+		{
+			MipStreamer::Statistics streamStats = m_pMipStreamer->GetStatistics();
+			swprintf_s(strBuffer, L"\nˮ: mip %u( %u)  Ѷ: %.1fKB",
+				m_pMipStreamer->GetResidentMip(m_WaterTextureId), m_pMipStreamer->GetDesiredMip(m_WaterTextureId),
+				streamStats.streamedBytes / 1024.0);
+			text += strBuffer;
+		}
+		TextureBudget::Statistics budgetStats = TextureBudget::GetDefault().GetStatistics();
+		swprintf_s(strBuffer, L"\nԤ: %.1f/%.1fMB  mip: %llu  ʡ: %.1fMB",
+			budgetStats.residentBytes / 1048576.0, budgetStats.budget / 1048576.0, budgetStats.trimmedMipCount,
+			(budgetStats.fullBytes - budgetStats.residentBytes) / 1048576.0);
+		text += strBuffer;
+		if (m_pRecordCapture)
+		{
+			FrameEncoder::Statistics captureStats = m_pRecordCapture->GetStatistics();
+			swprintf_s(strBuffer, L"\n¼(F11-ֹͣ): ѱ %llu֡   %llu֡  %.1fMB/s",
+				captureStats.encodedFrames, captureStats.droppedFrames + m_pRecordCapture->GetDroppedFrames(),
+				captureStats.elapsedSeconds > 0.0 ? captureStats.inputBytes / captureStats.elapsedSeconds / 1e6 : 0.0);
+			text += strBuffer;
+		}
+		else
+		{
+			text += L"\nF12-ͼ  F11-ʼ¼";
+		}
 
 
 		m_pd2dRenderTarget->DrawTextW(text.c_str(), (UINT32)text.length(), m_pTextFormat.Get(),
-			D2D1_RECT_F{ 0.0f, 0.0f, 600.0f, 200.0f }, m_pColorBrush.Get());
+			D2D1_RECT_F{ 0.0f, 0.0f, 600.0f, 300.0f }, m_pColorBrush.Get());
 		HR(m_pd2dRenderTarget->EndDraw());
 	}
 
+	// ͼ¼ֻѺ󱸻Ƶݴ̨֮֡߳
+	if (m_IsScreenshotRequested || m_pRecordCapture)
+	{
+		ComPtr<ID3D11Texture2D> pBackBuffer;
+		HR(m_pSwapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), reinterpret_cast<void**>(pBackBuffer.GetAddressOf())));
+		if (m_IsScreenshotRequested)
+			HR(m_pScreenshotCapture->Capture(m_pd3dImmediateContext.Get(), pBackBuffer.Get()));
+		if (m_pRecordCapture)
+			HR(m_pRecordCapture->Capture(m_pd3dImmediateContext.Get(), pBackBuffer.Get()));
+		m_IsScreenshotRequested = false;
+	}
+
 	HR(m_pSwapChain->Present(0, 0));
 }
 
+void GameApp::StopRecording()
+{
+	if (!m_pRecordCapture)
+		return;
+
+	m_pRecordCapture->Flush(m_pd3dImmediateContext.Get());
+	FrameEncoder::Statistics stats = m_pRecordCapture->GetStatistics();
+	wchar_t strBuffer[256];
+	swprintf_s(strBuffer, L"[FrameCapture] %llu frames encoded, %llu dropped, %.1f MB/s in, %.1f MB/s out, encode %.2f ms/frame\n",
+		stats.encodedFrames, stats.droppedFrames + m_pRecordCapture->GetDroppedFrames(),
+		stats.elapsedSeconds > 0.0 ? stats.inputBytes / stats.elapsedSeconds / 1e6 : 0.0,
+		stats.elapsedSeconds > 0.0 ? stats.outputBytes / stats.elapsedSeconds / 1e6 : 0.0,
+		stats.encodedFrames > 0 ? stats.encodeSeconds * 1000.0 / stats.encodedFrames : 0.0);
+	OutputDebugStringW(strBuffer);
+	m_pRecordCapture.reset();
+}
+
+// ȡļݣԴʱȴвңصĶ
+static std::shared_ptr<void> OpenTextureData(const wchar_t* fileName, const uint8_t*& data, size_t& size)
+{
+	AssetView view;
+	std::vector<uint8_t> buffer;
+	if (AssetPackage::FindMounted(fileName, view, buffer))
+	{
+		// ѹԴѹbufferУƶvectorıݵĵַ
+		auto pBuffer = std::make_shared<std::vector<uint8_t>>(std::move(buffer));
+		data = view.data;
+		size = view.size;
+		return pBuffer;
+	}
+
+	auto pFile = std::make_shared<MappedFile>();
+	if (!pFile->Open(fileName))
+		return nullptr;
+	data = pFile->GetData();
+	size = pFile->GetSize();
+	return pFile;
+}
+
 bool GameApp::InitResource()
 {
+	// ******************
+	// ύ첽
+	// ģ͵Ķȡڹ߳ϽУԴĳʼص
+	// 豸Դϴ׶ִ߳
+	//
+
+	ID3D11Device* device = m_pd3dDevice.Get();
+	// DDSԤʱļmip(ʽصˮԤ)
+	TextureBudget::GetDefault().SetBudget(16 * 1024 * 1024);
+	m_pAssetLoader->RegisterType("mbo",
+		[](const std::wstring& fileName, const uint8_t* data, size_t size) -> std::shared_ptr<void> {
+			auto pReader = std::make_shared<ObjReader>();
+			if (!pReader->ReadMbo(data, size, fileName.c_str()))
+				return nullptr;
+			return pReader;
+		},
+		[device](const std::wstring& fileName, const std::shared_ptr<void>& decoded) -> std::shared_ptr<void> {
+			// ϴԴ棬ͬһ·ģֻһ
+			return ResourceCache::GetDefault().Acquire("model", fileName, "", [&](size_t& byteSize) -> std::shared_ptr<void> {
+				auto pModel = std::make_shared<Model>(device, *std::static_pointer_cast<ObjReader>(decoded));
+				byteSize = 0;
+				for (const auto& part : pModel->modelParts)
+					byteSize += part.vertexCount * sizeof(VertexPosNormalTex) +
+						part.indexCount * (part.indexFormat == DXGI_FORMAT_R16_UINT ? sizeof(WORD) : sizeof(DWORD));
+				return pModel;
+			});
+		});
+
+	AssetLoader::Handle groundHandle = m_pAssetLoader->Load("mbo", L"..\\Model\\ground_35.mbo", AssetLoader::kPriorityHigh);
+
 	// ******************
 	// ʼ
 	//
@@ -252,9 +568,49 @@ bool GameApp::InitResource()
 	// ʼ
 	//
 
-	// ʼ
-	m_ObjReader.Read(L"..\\Model\\ground_35.mbo", L"..\\Model\\ground_35.obj");
-	m_Ground.SetModel(Model(m_pd3dDevice.Get(), m_ObjReader));
+	// ʼPartԳֲڴΧڵ32x32һģͣÿΪһPart
+	{
+		const UINT gridSize = 32;
+		const float spacing = 12.0f;
+		std::mt19937 randEngine(2020);
+		std::uniform_real_distribution<float> heightRange(2.0f, 16.0f);
+		std::uniform_real_distribution<float> colorRange(0.2f, 1.0f);
+
+		ObjReader sceneReader;
+		sceneReader.objParts.resize(gridSize * gridSize);
+		for (UINT i = 0; i < gridSize; ++i)
+		{
+			for (UINT j = 0; j < gridSize; ++j)
+			{
+				// Ķԭ㣬ҪƽƵ
+				float height = heightRange(randEngine);
+				Geometry::MeshData<VertexPosNormalTex, WORD> meshData;
+				switch ((i + j) % 3)
+				{
+				case 0: meshData = Geometry::CreateBox<VertexPosNormalTex, WORD>(4.0f, height, 4.0f); break;
+				case 1: meshData = Geometry::CreateCylinder<VertexPosNormalTex, WORD>(2.0f, height, 32, 8); break;
+				default: meshData = Geometry::CreateSphere<VertexPosNormalTex, WORD>(2.5f, 24, 24); height = 5.0f; break;
+				}
+				XMFLOAT3 offset((j + 0.5f - gridSize * 0.5f) * spacing, height * 0.5f, (i + 0.5f - gridSize * 0.5f) * spacing);
+				for (auto& vertex : meshData.vertexVec)
+				{
+					vertex.pos.x += offset.x;
+					vertex.pos.y += offset.y;
+					vertex.pos.z += offset.z;
+				}
+
+				auto& part = sceneReader.objParts[i * gridSize + j];
+				part.vertices = std::move(meshData.vertexVec);
+				part.indices16 = std::move(meshData.indexVec);
+				XMFLOAT4 color(colorRange(randEngine), colorRange(randEngine), colorRange(randEngine), 1.0f);
+				part.material.ambient = XMFLOAT4(color.x * 0.5f, color.y * 0.5f, color.z * 0.5f, 1.0f);
+				part.material.diffuse = color;
+				part.material.specular = XMFLOAT4(0.2f, 0.2f, 0.2f, 16.0f);
+			}
+		}
+		sceneReader.ComputeBounds();
+		m_PartCullingScene.SetModel(Model(m_pd3dDevice.Get(), sceneReader));
+	}
 
 	// ******************
 	// ʼ
@@ -296,7 +652,8 @@ bool GameApp::InitResource()
 
 	m_Gradient = 0.25f;
 
-	HR(m_pCpuGerstnerWavesRender->InitResource(m_pd3dDevice.Get(), L"..\\Texture\\water2.dds",
+	// 첽أɺ
+	HR(m_pCpuGerstnerWavesRender->InitResource(m_pd3dDevice.Get(), L"",
 		256, 256, 5.0f, 5.0f, 0.625f, m_NumWaves, m_Gradient, m_GerstnerWaveParameters));
 	Material material{};
 	material.ambient = XMFLOAT4(0.5f, 0.5f, 0.5f, 1.0f);
@@ -306,14 +663,46 @@ bool GameApp::InitResource()
 	m_pCpuGerstnerWavesRender->SetMaterial(material);
 
 
-	HR(m_pGpuGerstnerWavesRender->InitResource(m_pd3dDevice.Get(), L"..\\Texture\\water2.dds",
+	HR(m_pGpuGerstnerWavesRender->InitResource(m_pd3dDevice.Get(), L"",
 		256, 256, 5.0f, 5.0f, 0.625f, m_NumWaves, m_Gradient, m_GerstnerWaveParameters));
 	m_pGpuGerstnerWavesRender->SetMaterial(material);
 
+	// ******************
+	// ȴ첽
+	//
+
+	// ʼ棬.mboʱҪ.objȡ決
+	if (m_pAssetLoader->Wait(groundHandle))
+	{
+		m_Ground.SetModel(*groundHandle.Get<Model>());
+	}
+	else
+	{
+		m_ObjReader.Read(L"..\\Model\\ground_35.mbo", L"..\\Model\\ground_35.obj");
+		m_Ground.SetModel(Model(m_pd3dDevice.Get(), m_ObjReader));
+	}
+
+	// ˮʽأʱֻϴmipβȾ
+	{
+		const uint8_t* data = nullptr;
+		size_t size = 0;
+		DdsReader reader;
+		std::shared_ptr<void> owner = OpenTextureData(L"..\\Texture\\water2.dds", data, size);
+		if (owner && reader.Parse(data, size))
+		{
+			m_WaterTextureId = m_pMipStreamer->Add(reader, owner);
+			HR(CreateStreamingTextureFromDds(m_pd3dDevice.Get(), m_pd3dImmediateContext.Get(), reader,
+				m_pMipStreamer->GetTailMip(m_WaterTextureId), m_pWaterTexture.GetAddressOf()));
+			m_pCpuGerstnerWavesRender->SetTexture(m_pWaterTexture.Get());
+			m_pGpuGerstnerWavesRender->SetTexture(m_pWaterTexture.Get());
+		}
+	}
+
 	// ******************
 	// õԶ
 	//
 	m_Ground.SetDebugObjectName("Ground");
+	m_PartCullingScene.SetDebugObjectName("PartCullingScene");
 	m_pGerstnerWavesEffect->SetDebugObjectName("GerstnerWavesEffect");
 	m_pCpuGerstnerWavesRender->SetDebugObjectName("CpuGerstnerWaves");
 	m_pGpuGerstnerWavesRender->SetDebugObjectName("GpuGerstnerWaves");
@@ -9,6 +9,10 @@
 #include "SkyRender.h"
 #include "GerstnerWavesRender.h"
 #include "Collision.h"
+#include "AssetPackage.h"
+#include "AssetLoader.h"
+#include "MipStreamer.h"
+#include "FrameCapture.h"
 
 class GameApp : public D3DApp
 {
@@ -26,6 +30,8 @@ public:
 
 private:
 	bool InitResource();
+	// 停止录制，写完剩余的帧并输出统计
+	void StopRecording();
 
 private:
 
@@ -35,6 +41,7 @@ private:
 
 	ObjReader m_ObjReader;
 	GameObject m_Ground;																// 地面
+	GameObject m_PartCullingScene;														// 多Part测试场景
 
 	std::unique_ptr<BasicEffect> m_pBasicEffect;										// 基础特效
 	std::unique_ptr<GerstnerWavesEffect> m_pGerstnerWavesEffect;						// Gerstner波浪特效
@@ -49,7 +56,26 @@ private:
 
 	bool m_IsGpuEnable;																	// 是否开启GPU绘制
 	bool m_IsWireframe;																	// 是否开启线框
+	bool m_IsClusterCullingEnable;														// 是否开启地面的簇裁剪
+	GameObject::ClusterCullingStatistics m_ClusterCullingStats;							// 簇裁剪统计
+	float m_ClusterCullingTime;															// 簇裁剪耗时(微秒)
+	bool m_IsPartCullingSceneVisible;													// 是否显示多Part测试场景
+	bool m_IsPartCullingEnable;															// 是否开启测试场景的Part裁剪
+	UINT m_VisiblePartCount;															// 可见Part数目
+	float m_PartCullingTime;															// Part裁剪耗时(微秒)
 	std::shared_ptr<Camera> m_pCamera;													// 摄像机
+
+	AssetPackage m_AssetPackage;														// 资源包，存在时优先从中加载资源
+	std::unique_ptr<AssetLoader> m_pAssetLoader;										// 异步资源加载，需在资源包之前销毁
+	float m_StartupTime;																// 资源初始化耗时(毫秒)
+	std::unique_ptr<MipStreamer> m_pMipStreamer;										// 水面纹理的mip流式加载，需在资源包之前销毁
+	MipStreamer::TextureId m_WaterTextureId;											// 水面纹理在流式加载中的ID
+	ComPtr<ID3D11ShaderResourceView> m_pWaterTexture;									// 流式加载的水面纹理
+
+	std::unique_ptr<FrameCapture> m_pScreenshotCapture;									// F12截图
+	std::unique_ptr<FrameCapture> m_pRecordCapture;										// F11录制，不录制时为空
+	bool m_IsScreenshotRequested;														// 本帧呈现前是否截图
+	UINT m_RecordingCount;																// 录制的次数，用于区分文件名
 };
 
 
@@ -1,6 +1,7 @@
 ﻿#include "GameObject.h"
 #include "d3dUtil.h"
 #include "DXTrace.h"
+#include <algorithm>
 using namespace DirectX;
 
 struct InstancedData
@@ -69,11 +70,129 @@ void GameObject::SetModel(Model && model)
 	std::swap(m_Model, model);
 	model.modelParts.clear();
 	model.boundingBox = BoundingBox();
+	m_PartLods.clear();
+	ResetPartCulling();
+	ResetClusterCulling();
 }
 
 void GameObject::SetModel(const Model & model)
 {
 	m_Model = model;
+	m_PartLods.clear();
+	ResetPartCulling();
+	ResetClusterCulling();
+}
+
+const Model& GameObject::GetModel() const
+{
+	return m_Model;
+}
+
+void GameObject::SelectLod(const Camera& camera, float pixelError)
+{
+	// 以包围盒表面到摄像机的距离估计误差投影到屏幕上的像素数
+	BoundingBox box = GetBoundingBox();
+	XMVECTOR toCamera = XMVectorSubtract(camera.GetPositionXM(), XMLoadFloat3(&box.Center));
+	float distance = XMVectorGetX(XMVector3Length(toCamera)) - XMVectorGetX(XMVector3Length(XMLoadFloat3(&box.Extents)));
+	distance = (std::max)(distance, 1e-3f);
+
+	// 单位长度的物体在距离为1处于屏幕上占据的像素数：viewportHeight * cot(fovY / 2) / 2
+	XMFLOAT4X4 proj;
+	XMStoreFloat4x4(&proj, camera.GetProjXM());
+	float pixelsPerUnit = camera.GetViewPort().Height * proj._22 * 0.5f / distance;
+
+	// 模型空间误差需要乘上最大的缩放比例
+	XMFLOAT3 scale = m_Transform.GetScale();
+	float maxScale = (std::max)(fabsf(scale.x), (std::max)(fabsf(scale.y), fabsf(scale.z)));
+
+	m_PartLods.resize(m_Model.modelParts.size());
+	for (size_t i = 0; i < m_Model.modelParts.size(); ++i)
+	{
+		const auto& lods = m_Model.modelParts[i].lods;
+		UINT level = 0;
+		// LOD逐级变粗糙，误差单调递增
+		while (level + 1 < lods.size() && lods[level + 1].error * maxScale * pixelsPerUnit <= pixelError)
+			++level;
+		m_PartLods[i] = level;
+	}
+}
+
+UINT GameObject::GetPartLod(size_t partIndex) const
+{
+	return partIndex < m_PartLods.size() ? m_PartLods[partIndex] : 0;
+}
+
+UINT GameObject::CullParts(const Camera& camera)
+{
+	BoundingFrustum frustum;
+	BoundingFrustum::CreateFromMatrix(frustum, camera.GetProjXM());
+	frustum.Transform(frustum, XMMatrixInverse(nullptr, camera.GetViewXM()));
+	XMMATRIX World = m_Transform.GetLocalToWorldMatrixXM();
+
+	// 包围体变换到世界坐标系后再测试，物体存在非均匀缩放时结果依然保守
+	UINT visibleCount = 0;
+	m_PartVisible.resize(m_Model.modelParts.size());
+	for (size_t i = 0; i < m_Model.modelParts.size(); ++i)
+	{
+		const auto& part = m_Model.modelParts[i];
+		BoundingSphere sphere;
+		part.boundingSphere.Transform(sphere, World);
+		// 包围球的测试开销较小，先进行；与视锥体相交时再用更紧的AABB盒确认
+		bool visible = frustum.Intersects(sphere);
+		if (visible)
+		{
+			BoundingBox box;
+			part.boundingBox.Transform(box, World);
+			visible = frustum.Intersects(box);
+		}
+		m_PartVisible[i] = visible;
+		visibleCount += visible;
+	}
+
+	return visibleCount;
+}
+
+void GameObject::ResetPartCulling()
+{
+	m_PartVisible.clear();
+}
+
+bool GameObject::IsPartVisible(size_t partIndex) const
+{
+	return partIndex >= m_PartVisible.size() || m_PartVisible[partIndex];
+}
+
+GameObject::ClusterCullingStatistics GameObject::CullClusters(const Camera& camera)
+{
+	ClusterCullingStatistics stats = {};
+	XMMATRIX World = m_Transform.GetLocalToWorldMatrixXM();
+
+	m_PartClusterCulled.assign(m_Model.modelParts.size(), false);
+	m_PartVisibleRanges.resize(m_Model.modelParts.size());
+	for (size_t i = 0; i < m_Model.modelParts.size(); ++i)
+	{
+		const auto& part = m_Model.modelParts[i];
+		// 簇信息只针对完整网格
+		if (part.clusters.empty() || GetPartLod(i) != 0 || !IsPartVisible(i))
+			continue;
+
+		size_t visibleCount = Collision::ClusterCulling(part.clusters, World, camera, m_PartVisibleRanges[i]);
+		m_PartClusterCulled[i] = true;
+
+		stats.clusterCount += (UINT)part.clusters.size();
+		stats.visibleClusterCount += (UINT)visibleCount;
+		stats.triangleCount += part.lods[0].indexCount / 3;
+		for (const auto& range : m_PartVisibleRanges[i])
+			stats.visibleTriangleCount += range.indexCount / 3;
+	}
+
+	return stats;
+}
+
+void GameObject::ResetClusterCulling()
+{
+	m_PartClusterCulled.clear();
+	m_PartVisibleRanges.clear();
 }
 
 void GameObject::Draw(ID3D11DeviceContext * deviceContext, IEffect * effect)
@@ -81,8 +200,14 @@ void GameObject::Draw(ID3D11DeviceContext * deviceContext, IEffect * effect)
 	UINT strides = m_Model.vertexStride;
 	UINT offsets = 0;
 
-	for (auto& part : m_Model.modelParts)
+	for (size_t i = 0; i < m_Model.modelParts.size(); ++i)
 	{
+		// 跳过被Part裁剪剔除的Part
+		if (!IsPartVisible(i))
+			continue;
+
+		auto& part = m_Model.modelParts[i];
+
 		// 设置顶点/索引缓冲区
 		deviceContext->IASetVertexBuffers(0, 1, part.vertexBuffer.GetAddressOf(), &strides, &offsets);
 		deviceContext->IASetIndexBuffer(part.indexBuffer.Get(), part.indexFormat, 0);
@@ -114,7 +239,17 @@ void GameObject::Draw(ID3D11DeviceContext * deviceContext, IEffect * effect)
 		
 		effect->Apply(deviceContext);
 
-		deviceContext->DrawIndexed(part.indexCount, 0, 0);
+		if (i < m_PartClusterCulled.size() && m_PartClusterCulled[i])
+		{
+			// 只绘制可见的簇
+			for (const auto& range : m_PartVisibleRanges[i])
+				deviceContext->DrawIndexed(range.indexCount, range.startIndex, 0);
+		}
+		else
+		{
+			const ModelPartLod& lod = part.lods[GetPartLod(i)];
+			deviceContext->DrawIndexed(lod.indexCount, lod.startIndex, 0);
+		}
 	}
 }
 
@@ -146,8 +281,9 @@ void GameObject::DrawInstanced(ID3D11DeviceContext* deviceContext, IEffect * eff
 	UINT strides[2] = { m_Model.vertexStride, sizeof(InstancedData) };
 	UINT offsets[2] = { 0, 0 };
 	ID3D11Buffer* buffers[2] = { nullptr, m_pInstancedBuffer.Get() };
-	for (auto& part : m_Model.modelParts)
+	for (size_t i = 0; i < m_Model.modelParts.size(); ++i)
 	{
+		auto& part = m_Model.modelParts[i];
 		buffers[0] = part.vertexBuffer.Get();
 
 		// 设置顶点/索引缓冲区
@@ -181,7 +317,8 @@ void GameObject::DrawInstanced(ID3D11DeviceContext* deviceContext, IEffect * eff
 
 		effect->Apply(deviceContext);
 
-		deviceContext->DrawIndexedInstanced(part.indexCount, numInsts, 0, 0, 0);
+		const ModelPartLod& lod = part.lods[GetPartLod(i)];
+		deviceContext->DrawIndexedInstanced(lod.indexCount, numInsts, lod.startIndex, 0, 0);
 	}
 }
 
@@ -11,6 +11,8 @@
 
 #include "Model.h"
 #include "Transform.h"
+#include "Camera.h"
+#include "Collision.h"
 
 class GameObject
 {
@@ -18,6 +20,14 @@ public:
 	template <class T>
 	using ComPtr = Microsoft::WRL::ComPtr<T>;
 
+	// 簇裁剪统计
+	struct ClusterCullingStatistics
+	{
+		UINT clusterCount;				// 参与裁剪的簇数目
+		UINT visibleClusterCount;		// 可见簇数目
+		UINT triangleCount;				// 参与裁剪的三角形数目
+		UINT visibleTriangleCount;		// 可见三角形数目
+	};
 
 	GameObject() = default;
 	~GameObject() = default;
@@ -57,6 +67,39 @@ public:
 
 	void SetModel(Model&& model);
 	void SetModel(const Model& model);
+	// 获取模型
+	const Model& GetModel() const;
+
+	//
+	// LOD
+	//
+
+	// 根据摄像机距离为每个Part选择满足屏幕空间误差(像素)要求的最粗糙LOD
+	void SelectLod(const Camera& camera, float pixelError = 1.0f);
+	// 获取某个Part当前使用的LOD级别
+	UINT GetPartLod(size_t partIndex) const;
+
+	//
+	// Part裁剪
+	//
+
+	// 使用每个Part的包围球与AABB盒进行视锥体裁剪，之后的Draw跳过不可见的Part
+	// 返回值: 可见Part的数目
+	UINT CullParts(const Camera& camera);
+	// 取消Part裁剪的结果，Draw重新绘制所有Part
+	void ResetPartCulling();
+	// 获取某个Part在上一次裁剪中是否可见
+	bool IsPartVisible(size_t partIndex) const;
+
+	//
+	// 簇裁剪
+	//
+
+	// 对当前使用第0级LOD且带有簇信息的Part进行簇裁剪，之后的Draw只绘制可见的簇
+	// 应在SelectLod之后调用，已被Part裁剪剔除的Part不参与
+	ClusterCullingStatistics CullClusters(const Camera& camera);
+	// 取消簇裁剪的结果，Draw重新绘制整个Part
+	void ResetClusterCulling();
 
 	//
 	// 绘制
@@ -81,6 +124,11 @@ private:
 
 	ComPtr<ID3D11Buffer> m_pInstancedBuffer = nullptr;				// 实例缓冲区
 	size_t m_Capacity = 0;										    // 缓冲区容量
+
+	std::vector<UINT> m_PartLods;									// 每个Part当前使用的LOD级别
+	std::vector<bool> m_PartVisible;								// 每个Part在上一次Part裁剪中是否可见
+	std::vector<bool> m_PartClusterCulled;							// 每个Part是否使用簇裁剪的结果进行绘制
+	std::vector<std::vector<Collision::IndexRange>> m_PartVisibleRanges;	// 每个Part可见簇对应的索引范围
 };
 
 
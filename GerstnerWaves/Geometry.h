@@ -9,11 +9,12 @@
 #ifndef GEOMETRY_H_
 #define GEOMETRY_H_
 
+#include <algorithm>
 #include <vector>
-#include <string>
-#include <map>
 #include <functional>
+#include <type_traits>
 #include "Vertex.h"
+#include "ThreadPool.h"
 
 namespace Geometry
 {
@@ -81,14 +82,31 @@ namespace Geometry
 	MeshData<VertexType, IndexType> CreateTerrain(const DirectX::XMFLOAT2& terrainSize,
 		const DirectX::XMUINT2& slices = { 10, 10 }, const DirectX::XMFLOAT2 & maxTexCoord = { 1.0f, 1.0f },
 		const std::function<float(float, float)>& heightFunc = [](float x, float z) { return 0.0f; },
-		const std::function<DirectX::XMFLOAT3(float, float)>& normalFunc = [](float x, float z) { return XMFLOAT3(0.0f, 1.0f, 0.0f); },
-		const std::function<DirectX::XMFLOAT4(float, float)>& colorFunc = [](float x, float z) { return XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f); });
+		const std::function<DirectX::XMFLOAT3(float, float)>& normalFunc = [](float x, float z) { return DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f); },
+		const std::function<DirectX::XMFLOAT4(float, float)>& colorFunc = [](float x, float z) { return DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f); });
 	template<class VertexType = VertexPosNormalTex, class IndexType = DWORD>
 	MeshData<VertexType, IndexType> CreateTerrain(float width = 10.0f, float depth = 10.0f,
 		UINT slicesX = 10, UINT slicesZ = 10, float texU = 1.0f, float texV = 1.0f,
 		const std::function<float(float, float)>& heightFunc = [](float x, float z) { return 0.0f; },
-		const std::function<DirectX::XMFLOAT3(float, float)>& normalFunc = [](float x, float z) { return XMFLOAT3(0.0f, 1.0f, 0.0f); },
-		const std::function<DirectX::XMFLOAT4(float, float)>& colorFunc = [](float x, float z) { return XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f); });
+		const std::function<DirectX::XMFLOAT3(float, float)>& normalFunc = [](float x, float z) { return DirectX::XMFLOAT3(0.0f, 1.0f, 0.0f); },
+		const std::function<DirectX::XMFLOAT4(float, float)>& colorFunc = [](float x, float z) { return DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f); });
+
+	// 回调为任意可调用对象(签名与上面的std::function相同)，可以内联到生成顶点的循环中
+	// pool不为nullptr时按行并行生成顶点与索引，回调会在多个线程上同时调用，需要是线程安全的
+	// 生成结果与串行时逐字节相同
+	template<class VertexType, class IndexType, class HeightFunc, class NormalFunc, class ColorFunc>
+	MeshData<VertexType, IndexType> CreateTerrain(float width, float depth, UINT slicesX, UINT slicesZ, float texU, float texV,
+		const HeightFunc& heightFunc, const NormalFunc& normalFunc, const ColorFunc& colorFunc, ThreadPool* pool);
+
+	// 按行批量计算的地形，每个回调一次填满一行，便于接入SIMD实现的高度函数等
+	// heightRowFunc(const float* posX, float posZ, UINT count, float* heights)
+	// normalRowFunc(const float* posX, float posZ, UINT count, DirectX::XMFLOAT3* normals)，法线不需要归一化
+	// colorRowFunc(const float* posX, float posZ, UINT count, DirectX::XMFLOAT4* colors)
+	// 顶点类型没有法线(与切线)或颜色时不调用对应的回调，但仍需给出可调用对象，并行时的要求同上
+	template<class VertexType, class IndexType, class HeightRowFunc, class NormalRowFunc, class ColorRowFunc>
+	MeshData<VertexType, IndexType> CreateTerrainByRows(float width, float depth, UINT slicesX, UINT slicesZ, float texU, float texV,
+		const HeightRowFunc& heightRowFunc, const NormalRowFunc& normalRowFunc, const ColorRowFunc& colorRowFunc,
+		ThreadPool* pool = nullptr);
 }
 
 
@@ -112,27 +130,100 @@ namespace Geometry
 			DirectX::XMFLOAT2 tex;
 		};
 
-		// 根据目标顶点类型选择性将数据插入
+		// 顶点属性在编译期的映射: 顶点结构体中名为pos、normal、tangent、color、tex的成员
+		// 分别对应输入布局中的POSITION、NORMAL、TANGENT、COLOR、TEXCOORD语义(见Vertex.h)
+		// 存在对应成员时value为true，Store直接赋值；不存在时Store为空操作
+		template<class VertexType, class = void>
+		struct PositionAttribute { static const bool value = false; static void Store(VertexType&, const VertexData&) {} };
+		template<class VertexType>
+		struct PositionAttribute<VertexType, decltype(void(&VertexType::pos))>
+		{
+			static const bool value = true;
+			static void Store(VertexType& vertexDst, const VertexData& vertexSrc) { vertexDst.pos = vertexSrc.pos; }
+		};
+
+		template<class VertexType, class = void>
+		struct NormalAttribute { static const bool value = false; static void Store(VertexType&, const VertexData&) {} };
+		template<class VertexType>
+		struct NormalAttribute<VertexType, decltype(void(&VertexType::normal))>
+		{
+			static const bool value = true;
+			static void Store(VertexType& vertexDst, const VertexData& vertexSrc) { vertexDst.normal = vertexSrc.normal; }
+		};
+
+		template<class VertexType, class = void>
+		struct TangentAttribute { static const bool value = false; static void Store(VertexType&, const VertexData&) {} };
+		template<class VertexType>
+		struct TangentAttribute<VertexType, decltype(void(&VertexType::tangent))>
+		{
+			static const bool value = true;
+			static void Store(VertexType& vertexDst, const VertexData& vertexSrc) { vertexDst.tangent = vertexSrc.tangent; }
+		};
+
+		template<class VertexType, class = void>
+		struct ColorAttribute { static const bool value = false; static void Store(VertexType&, const VertexData&) {} };
+		template<class VertexType>
+		struct ColorAttribute<VertexType, decltype(void(&VertexType::color))>
+		{
+			static const bool value = true;
+			static void Store(VertexType& vertexDst, const VertexData& vertexSrc) { vertexDst.color = vertexSrc.color; }
+		};
+
+		template<class VertexType, class = void>
+		struct TexCoordAttribute { static const bool value = false; static void Store(VertexType&, const VertexData&) {} };
+		template<class VertexType>
+		struct TexCoordAttribute<VertexType, decltype(void(&VertexType::tex))>
+		{
+			static const bool value = true;
+			static void Store(VertexType& vertexDst, const VertexData& vertexSrc) { vertexDst.tex = vertexSrc.tex; }
+		};
+
+		// 顶点类型包含的属性，生成器据此跳过不需要的计算(如没有颜色时不调用colorFunc)
+		template<class VertexType>
+		struct VertexAttributes
+		{
+			static constexpr bool position = PositionAttribute<VertexType>::value;
+			static constexpr bool normal = NormalAttribute<VertexType>::value;
+			static constexpr bool tangent = TangentAttribute<VertexType>::value;
+			static constexpr bool color = ColorAttribute<VertexType>::value;
+			static constexpr bool texCoord = TexCoordAttribute<VertexType>::value;
+			// 所有已知属性的字节数，与顶点大小相同时顶点的每个成员都能被生成
+			static constexpr size_t byteSize = (position ? sizeof(DirectX::XMFLOAT3) : 0) + (normal ? sizeof(DirectX::XMFLOAT3) : 0) +
+				(tangent ? sizeof(DirectX::XMFLOAT4) : 0) + (color ? sizeof(DirectX::XMFLOAT4) : 0) + (texCoord ? sizeof(DirectX::XMFLOAT2) : 0);
+		};
+
+		// 根据目标顶点类型选择性将数据插入，编译后只剩下对存在的成员的直接赋值
 		template<class VertexType>
 		inline void InsertVertexElement(VertexType& vertexDst, const VertexData& vertexSrc)
 		{
-			static std::string semanticName;
-			static const std::map<std::string, std::pair<size_t, size_t>> semanticSizeMap = {
-				{"POSITION", std::pair<size_t, size_t>(0, 12)},
-				{"NORMAL", std::pair<size_t, size_t>(12, 24)},
-				{"TANGENT", std::pair<size_t, size_t>(24, 40)},
-				{"COLOR", std::pair<size_t, size_t>(40, 56)},
-				{"TEXCOORD", std::pair<size_t, size_t>(56, 64)}
-			};
+			static_assert(VertexAttributes<VertexType>::position, "VertexType must have a POSITION member named pos!");
+			static_assert(VertexAttributes<VertexType>::byteSize == sizeof(VertexType),
+				"VertexType has members that Geometry cannot generate (only pos, normal, tangent, color and tex)!");
+
+			PositionAttribute<VertexType>::Store(vertexDst, vertexSrc);
+			NormalAttribute<VertexType>::Store(vertexDst, vertexSrc);
+			TangentAttribute<VertexType>::Store(vertexDst, vertexSrc);
+			ColorAttribute<VertexType>::Store(vertexDst, vertexSrc);
+			TexCoordAttribute<VertexType>::Store(vertexDst, vertexSrc);
+		}
 
-			for (size_t i = 0; i < ARRAYSIZE(VertexType::inputLayout); i++)
+		// 把[0, rowCount)行按每16行分为一个任务，pool不为nullptr时并行执行func(firstRow, lastRow)
+		template<class RowFunc>
+		inline void ForEachRows(UINT rowCount, ThreadPool* pool, const RowFunc& func)
+		{
+			const UINT kRowsPerTask = 16;
+			UINT taskCount = (rowCount + kRowsPerTask - 1) / kRowsPerTask;
+			auto run = [&](size_t task)
+			{
+				UINT first = static_cast<UINT>(task) * kRowsPerTask;
+				func(first, (std::min)(first + kRowsPerTask, rowCount));
+			};
+			if (pool && taskCount > 1)
+				pool->ParallelFor(taskCount, run);
+			else
 			{
-				semanticName = VertexType::inputLayout[i].SemanticName;
-				const auto& range = semanticSizeMap.at(semanticName);
-				memcpy_s(reinterpret_cast<char*>(&vertexDst) + VertexType::inputLayout[i].AlignedByteOffset,
-					range.second - range.first,
-					reinterpret_cast<const char*>(&vertexSrc) + range.first,
-					range.second - range.first);
+				for (UINT task = 0; task < taskCount; ++task)
+					run(task);
 			}
 		}
 	}
@@ -637,67 +728,124 @@ namespace Geometry
 		float texU, float texV, const std::function<float(float, float)>& heightFunc,
 		const std::function<DirectX::XMFLOAT3(float, float)>& normalFunc,
 		const std::function<DirectX::XMFLOAT4(float, float)>& colorFunc)
+	{
+		// std::function的调用者不一定线程安全，保持串行
+		return CreateTerrain<VertexType, IndexType>(width, depth, slicesX, slicesZ, texU, texV,
+			heightFunc, normalFunc, colorFunc, nullptr);
+	}
+
+	template<class VertexType, class IndexType, class HeightFunc, class NormalFunc, class ColorFunc>
+	MeshData<VertexType, IndexType> CreateTerrain(float width, float depth, UINT slicesX, UINT slicesZ, float texU, float texV,
+		const HeightFunc& heightFunc, const NormalFunc& normalFunc, const ColorFunc& colorFunc, ThreadPool* pool)
+	{
+		// 逐顶点的回调包装为按行的回调，内联后与直接逐顶点调用相同
+		return CreateTerrainByRows<VertexType, IndexType>(width, depth, slicesX, slicesZ, texU, texV,
+			[&heightFunc](const float* posX, float posZ, UINT count, float* heights) {
+				for (UINT i = 0; i < count; ++i)
+					heights[i] = heightFunc(posX[i], posZ);
+			},
+			[&normalFunc](const float* posX, float posZ, UINT count, DirectX::XMFLOAT3* normals) {
+				for (UINT i = 0; i < count; ++i)
+					normals[i] = normalFunc(posX[i], posZ);
+			},
+			[&colorFunc](const float* posX, float posZ, UINT count, DirectX::XMFLOAT4* colors) {
+				for (UINT i = 0; i < count; ++i)
+					colors[i] = colorFunc(posX[i], posZ);
+			}, pool);
+	}
+
+	template<class VertexType, class IndexType, class HeightRowFunc, class NormalRowFunc, class ColorRowFunc>
+	MeshData<VertexType, IndexType> CreateTerrainByRows(float width, float depth, UINT slicesX, UINT slicesZ, float texU, float texV,
+		const HeightRowFunc& heightRowFunc, const NormalRowFunc& normalRowFunc, const ColorRowFunc& colorRowFunc,
+		ThreadPool* pool)
 	{
 		using namespace DirectX;
 
 		MeshData<VertexType, IndexType> meshData;
-		UINT vertexCount = (slicesX + 1) * (slicesZ + 1);
-		UINT indexCount = 6 * slicesX * slicesZ;
-		meshData.vertexVec.resize(vertexCount);
-		meshData.indexVec.resize(indexCount);
-
-		Internal::VertexData vertexData;
-		UINT vIndex = 0;
-		UINT iIndex = 0;
+		UINT columnCount = slicesX + 1;
+		UINT rowCount = slicesZ + 1;
+		meshData.vertexVec.resize(columnCount * rowCount);
+		meshData.indexVec.resize(6 * slicesX * slicesZ);
 
 		float sliceWidth = width / slicesX;
 		float sliceDepth = depth / slicesZ;
 		float leftBottomX = -width / 2;
 		float leftBottomZ = -depth / 2;
-		float posX, posZ;
 		float sliceTexWidth = texU / slicesX;
 		float sliceTexDepth = texV / slicesZ;
 
-		XMFLOAT3 normal;
-		XMFLOAT4 tangent;
+		// 每一行的顶点x坐标都相同
+		std::vector<float> posXs(columnCount);
+		for (UINT x = 0; x <= slicesX; ++x)
+			posXs[x] = leftBottomX + x * sliceWidth;
+
+		// 顶点类型没有的属性不计算，也不调用对应的回调
+		const bool needNormal = Internal::VertexAttributes<VertexType>::normal || Internal::VertexAttributes<VertexType>::tangent;
+		const bool needTangent = Internal::VertexAttributes<VertexType>::tangent;
+		const bool needColor = Internal::VertexAttributes<VertexType>::color;
+
 		// 创建网格顶点
 		//  __ __
 		// | /| /|
 		// |/_|/_|
 		// | /| /| 
 		// |/_|/_|
-		for (UINT z = 0; z <= slicesZ; ++z)
+		auto fillVertices = [&](UINT firstRow, UINT lastRow)
 		{
-			posZ = leftBottomZ + z * sliceDepth;
-			for (UINT x = 0; x <= slicesX; ++x)
+			std::vector<float> heights(columnCount);
+			std::vector<XMFLOAT3> normals(needNormal ? columnCount : 0);
+			std::vector<XMFLOAT4> colors(needColor ? columnCount : 0);
+			Internal::VertexData vertexData = { XMFLOAT3(), XMFLOAT3(0.0f, 1.0f, 0.0f), XMFLOAT4(1.0f, 0.0f, 0.0f, 1.0f),
+				XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), XMFLOAT2() };
+			for (UINT z = firstRow; z < lastRow; ++z)
 			{
-				posX = leftBottomX + x * sliceWidth;
-				// 计算法向量并归一化
-				normal = normalFunc(posX, posZ);
-				XMStoreFloat3(&normal, XMVector3Normalize(XMLoadFloat3(&normal)));
-				// 计算法平面与z=posZ平面构成的直线单位切向量，维持w分量为1.0f
-				XMStoreFloat4(&tangent, XMVector3Normalize(XMVectorSet(normal.y, -normal.x, 0.0f, 0.0f)) + g_XMIdentityR3);
-
-				vertexData = { XMFLOAT3(posX, heightFunc(posX, posZ), posZ),
-					normal, tangent, colorFunc(posX, posZ), XMFLOAT2(x * sliceTexWidth, texV - z * sliceTexDepth) };
-				Internal::InsertVertexElement(meshData.vertexVec[vIndex++], vertexData);
+				float posZ = leftBottomZ + z * sliceDepth;
+				heightRowFunc(posXs.data(), posZ, columnCount, heights.data());
+				if (needNormal)
+					normalRowFunc(posXs.data(), posZ, columnCount, normals.data());
+				if (needColor)
+					colorRowFunc(posXs.data(), posZ, columnCount, colors.data());
+
+				VertexType* vertices = meshData.vertexVec.data() + z * columnCount;
+				for (UINT x = 0; x <= slicesX; ++x)
+				{
+					vertexData.pos = XMFLOAT3(posXs[x], heights[x], posZ);
+					// 法向量归一化
+					if (needNormal)
+						XMStoreFloat3(&vertexData.normal, XMVector3Normalize(XMLoadFloat3(&normals[x])));
+					// 计算法平面与z=posZ平面构成的直线单位切向量，维持w分量为1.0f
+					if (needTangent)
+						XMStoreFloat4(&vertexData.tangent,
+							XMVector3Normalize(XMVectorSet(vertexData.normal.y, -vertexData.normal.x, 0.0f, 0.0f)) + g_XMIdentityR3);
+					if (needColor)
+						vertexData.color = colors[x];
+					vertexData.tex = XMFLOAT2(x * sliceTexWidth, texV - z * sliceTexDepth);
+					Internal::InsertVertexElement(vertices[x], vertexData);
+				}
 			}
-		}
-		// 放入索引
-		for (UINT i = 0; i < slicesZ; ++i)
+		};
+
+		// 放入索引，每行网格的索引位置固定，可以各行独立生成
+		auto fillIndices = [&](UINT firstRow, UINT lastRow)
 		{
-			for (UINT j = 0; j < slicesX; ++j)
+			for (UINT i = firstRow; i < lastRow; ++i)
 			{
-				meshData.indexVec[iIndex++] = i * (slicesX + 1) + j;
-				meshData.indexVec[iIndex++] = (i + 1) * (slicesX + 1) + j;
-				meshData.indexVec[iIndex++] = (i + 1) * (slicesX + 1) + j + 1;
-
-				meshData.indexVec[iIndex++] = (i + 1) * (slicesX + 1) + j + 1;
-				meshData.indexVec[iIndex++] = i * (slicesX + 1) + j + 1;
-				meshData.indexVec[iIndex++] = i * (slicesX + 1) + j;
+				IndexType* indices = meshData.indexVec.data() + 6 * slicesX * i;
+				for (UINT j = 0; j < slicesX; ++j)
+				{
+					*indices++ = i * (slicesX + 1) + j;
+					*indices++ = (i + 1) * (slicesX + 1) + j;
+					*indices++ = (i + 1) * (slicesX + 1) + j + 1;
+
+					*indices++ = (i + 1) * (slicesX + 1) + j + 1;
+					*indices++ = i * (slicesX + 1) + j + 1;
+					*indices++ = i * (slicesX + 1) + j;
+				}
 			}
-		}
+		};
 
+		Internal::ForEachRows(rowCount, pool, fillVertices);
+		Internal::ForEachRows(slicesZ, pool, fillIndices);
 		return meshData;
 	}
 
@@ -82,6 +82,7 @@ HRESULT CpuGerstnerWavesRender::InitResource(ID3D11Device* device, const std::ws
 	m_pVertexBuffer.Reset();
 	m_pIndexBuffer.Reset();
 	m_pTextureDiffuse.Reset();
+	m_pTextureReference.reset();
 	
 
 	// ʼˮ
@@ -126,16 +127,7 @@ HRESULT CpuGerstnerWavesRender::InitResource(ID3D11Device* device, const std::ws
 	//ȡ
 	if (texFileName.size() > 4)
 	{
-		if (texFileName.substr(texFileName.size() - 3, 3) == L"dds")
-		{
-			hr = CreateDDSTextureFromFile(device, texFileName.c_str(), nullptr,
-				m_pTextureDiffuse.GetAddressOf());
-		}
-		else
-		{
-			hr = CreateWICTextureFromFile(device, texFileName.c_str(), nullptr,
-				m_pTextureDiffuse.GetAddressOf());
-		}
+		hr = CreateTextureFromCache(device, texFileName.c_str(), m_pTextureDiffuse.GetAddressOf(), m_pTextureReference);
 	}
 	return hr;
 
@@ -221,6 +213,12 @@ void CpuGerstnerWavesRender::Draw(ID3D11DeviceContext* deviceContext, GerstnerWa
 	deviceContext->DrawIndexed(m_IndexCount, 0, 0);
 }
 
+void CpuGerstnerWavesRender::SetTexture(ID3D11ShaderResourceView* texture, std::shared_ptr<void> reference)
+{
+	m_pTextureDiffuse = texture;
+	m_pTextureReference = std::move(reference);
+}
+
 void CpuGerstnerWavesRender::SetDebugObjectName(const std::string& name)
 {
 #if (defined(DEBUG)||defined(_DEBUG)&&(GRAPHICS_DEBUGGER_OBJECT_NAME))
@@ -247,6 +245,7 @@ HRESULT GpuGerstnerWavesRender::InitResource(ID3D11Device* device, const std::ws
 	m_pIndexBuffer.Reset();
 
 	m_pTextureDiffuse.Reset();
+	m_pTextureReference.reset();
 	m_pOriSolution.Reset();
 	m_pCurrSolution.Reset();
 	m_pNormalSolution.Reset();
@@ -374,16 +373,7 @@ HRESULT GpuGerstnerWavesRender::InitResource(ID3D11Device* device, const std::ws
 	// ȡ
 	if (texFileName.size() > 4)
 	{
-		if (texFileName.substr(texFileName.size() - 3, 3) == L"dds")
-		{
-			hr = CreateDDSTextureFromFile(device, texFileName.c_str(), nullptr,
-				m_pTextureDiffuse.GetAddressOf());
-		}
-		else
-		{
-			hr = CreateWICTextureFromFile(device, texFileName.c_str(), nullptr,
-				m_pTextureDiffuse.GetAddressOf());
-		}
+		hr = CreateTextureFromCache(device, texFileName.c_str(), m_pTextureDiffuse.GetAddressOf(), m_pTextureReference);
 	}
 	return hr;
 }
@@ -469,6 +459,12 @@ void GpuGerstnerWavesRender::Draw(ID3D11DeviceContext* deviceContext, GerstnerWa
 	deviceContext->DrawIndexed(m_IndexCount, 0, 0);
 }
 
+void GpuGerstnerWavesRender::SetTexture(ID3D11ShaderResourceView* texture, std::shared_ptr<void> reference)
+{
+	m_pTextureDiffuse = texture;
+	m_pTextureReference = std::move(reference);
+}
+
 void GpuGerstnerWavesRender::SetDebugObjectName(const std::string& name)
 {
 #if (defined(DEBUG)||defined(_DEBUG)&&(GRAPHICS_DEBUGGER_OBJECT_NAME))
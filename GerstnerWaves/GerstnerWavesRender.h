@@ -2,6 +2,7 @@
 #define GERSTNERWAVESRENDER_H
 
 #include <vector>
+#include <memory>
 #include <string>
 #include "Effects.h"
 #include "Transform.h"
@@ -93,6 +94,9 @@ public:
 
 	void Draw(ID3D11DeviceContext* deviceContext, GerstnerWavesEffect* gerstnerwaveseffect);
 
+	// ˮInitResourceʱûָļ(첽)
+	// referenceΪԴе(ResourceCache)Ϊ
+	void SetTexture(ID3D11ShaderResourceView* texture, std::shared_ptr<void> reference = nullptr);
 
 
 	// õԶ
@@ -109,6 +113,7 @@ private:
 	ComPtr<ID3D11Buffer> m_pIndexBuffer;					// ǰģ
 
 	ComPtr<ID3D11ShaderResourceView> m_pTextureDiffuse;		// ˮ
+	std::shared_ptr<void> m_pTextureReference;				// ˮԴе
 
 
 };
@@ -141,6 +146,10 @@ public:
 
 	void Draw(ID3D11DeviceContext* deviceContext, GerstnerWavesEffect* gerstnerwaveseffect);
 
+	// ˮInitResourceʱûָļ(첽)
+	// referenceΪԴе(ResourceCache)Ϊ
+	void SetTexture(ID3D11ShaderResourceView* texture, std::shared_ptr<void> reference = nullptr);
+
 	// õԶ
 	void SetDebugObjectName(const std::string& name);
 
@@ -166,6 +175,7 @@ private:
 	ComPtr<ID3D11Buffer> m_pIndexBuffer;					// ǰģ
 
 	ComPtr<ID3D11ShaderResourceView> m_pTextureDiffuse;		// ˮ
+	std::shared_ptr<void> m_pTextureReference;				// ˮԴе
 };
 
 #endif // !GERSTNERWAVESRENDER_H
@@ -0,0 +1,864 @@
+﻿#include "GlbReader.h"
+#include <cctype>
+#include <cfloat>
+#include <chrono>
+#include <climits>
+#include <cstdarg>
+#include <cstring>
+
+using namespace DirectX;
+
+namespace
+{
+	// .glb文件头与块类型
+	const uint32_t kGlbMagic = 0x46546C67;			// "glTF"
+	const uint32_t kGlbVersion = 2;
+	const uint32_t kChunkJson = 0x4E4F534A;			// "JSON"
+	const uint32_t kChunkBin = 0x004E4942;			// "BIN\0"
+
+	// 访问器的分量类型
+	const UINT kComponentByte = 5120;
+	const UINT kComponentUnsignedByte = 5121;
+	const UINT kComponentShort = 5122;
+	const UINT kComponentUnsignedShort = 5123;
+	const UINT kComponentUnsignedInt = 5125;
+	const UINT kComponentFloat = 5126;
+
+	// 图元类型
+	const UINT kModeTriangles = 4;
+
+	const size_t kInvalidIndex = static_cast<size_t>(-1);
+
+	struct GlbHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t length;
+	};
+
+	struct GlbChunkHeader
+	{
+		uint32_t length;
+		uint32_t type;
+	};
+
+	void Log(const wchar_t* glbFileName, const wchar_t* message)
+	{
+		wchar_t strBuffer[512];
+		swprintf_s(strBuffer, L"%ls: %ls\n", glbFileName, message);
+		OutputDebugStringW(strBuffer);
+	}
+
+	// 获取非负整数形式的索引，不存在或格式不对时返回kInvalidIndex
+	size_t GetIndex(const JsonValue& value)
+	{
+		double number = value.GetNumber(-1.0);
+		if (number < 0.0 || number != static_cast<double>(static_cast<size_t>(number)))
+			return kInvalidIndex;
+		return static_cast<size_t>(number);
+	}
+
+	size_t GetComponentSize(UINT componentType)
+	{
+		switch (componentType)
+		{
+		case kComponentByte:
+		case kComponentUnsignedByte: return 1;
+		case kComponentShort:
+		case kComponentUnsignedShort: return 2;
+		case kComponentUnsignedInt:
+		case kComponentFloat: return 4;
+		default: return 0;
+		}
+	}
+
+	UINT GetComponentCount(const std::string& type)
+	{
+		if (type == "SCALAR") return 1;
+		if (type == "VEC2") return 2;
+		if (type == "VEC3") return 3;
+		if (type == "VEC4") return 4;
+		if (type == "MAT2") return 4;
+		if (type == "MAT3") return 9;
+		if (type == "MAT4") return 16;
+		return 0;
+	}
+
+	template<class T>
+	T LoadUnaligned(const uint8_t* p)
+	{
+		T value;
+		memcpy(&value, p, sizeof(T));
+		return value;
+	}
+
+	std::wstring Utf8ToWide(const std::string& str)
+	{
+		if (str.empty())
+			return std::wstring();
+		int length = MultiByteToWideChar(CP_UTF8, 0, str.data(), (int)str.size(), nullptr, 0);
+		std::wstring wstr(length, L'\0');
+		MultiByteToWideChar(CP_UTF8, 0, str.data(), (int)str.size(), &wstr[0], length);
+		return wstr;
+	}
+
+	std::string WideToUtf8(const std::wstring& wstr)
+	{
+		if (wstr.empty())
+			return std::string();
+		int length = WideCharToMultiByte(CP_UTF8, 0, wstr.data(), (int)wstr.size(), nullptr, 0, nullptr, nullptr);
+		std::string str(length, '\0');
+		WideCharToMultiByte(CP_UTF8, 0, wstr.data(), (int)wstr.size(), &str[0], length, nullptr, nullptr);
+		return str;
+	}
+
+	// 解码URI中的%XX
+	std::string DecodeUri(const std::string& uri)
+	{
+		auto hexValue = [](char c) {
+			unsigned char u = static_cast<unsigned char>(c);
+			return isdigit(u) ? u - '0' : isxdigit(u) ? tolower(u) - 'a' + 10 : -1;
+		};
+
+		std::string result;
+		for (size_t i = 0; i < uri.size(); ++i)
+		{
+			if (uri[i] == '%' && i + 2 < uri.size() && hexValue(uri[i + 1]) >= 0 && hexValue(uri[i + 2]) >= 0)
+			{
+				result += static_cast<char>(hexValue(uri[i + 1]) * 16 + hexValue(uri[i + 2]));
+				i += 2;
+			}
+			else
+			{
+				result += uri[i];
+			}
+		}
+		return result;
+	}
+
+	// 获取文件所在的目录，包含末尾的分隔符
+	std::wstring GetDirectory(const std::wstring& fileName)
+	{
+		size_t pos = fileName.find_last_of(L"/\\");
+		return pos == std::wstring::npos ? std::wstring() : fileName.substr(0, pos + 1);
+	}
+
+	ULONGLONG GetFileBytes(const wchar_t* fileName)
+	{
+		WIN32_FILE_ATTRIBUTE_DATA attributes;
+		if (!GetFileAttributesExW(fileName, GetFileExInfoStandard, &attributes))
+			return 0;
+		return static_cast<ULONGLONG>(attributes.nFileSizeHigh) << 32 | attributes.nFileSizeLow;
+	}
+
+	// 根据三角形计算面积加权的顶点法线
+	void ComputeNormals(ObjReader::ObjPart& part)
+	{
+		std::vector<XMVECTOR> normals(part.vertices.size(), XMVectorZero());
+		for (size_t i = 0; i + 2 < part.indices32.size(); i += 3)
+		{
+			DWORD i0 = part.indices32[i], i1 = part.indices32[i + 1], i2 = part.indices32[i + 2];
+			XMVECTOR p0 = XMLoadFloat3(&part.vertices[i0].pos);
+			XMVECTOR e1 = XMVectorSubtract(XMLoadFloat3(&part.vertices[i1].pos), p0);
+			XMVECTOR e2 = XMVectorSubtract(XMLoadFloat3(&part.vertices[i2].pos), p0);
+			// 左手坐标系下顺时针为正面
+			XMVECTOR n = XMVector3Cross(e1, e2);
+			normals[i0] = XMVectorAdd(normals[i0], n);
+			normals[i1] = XMVectorAdd(normals[i1], n);
+			normals[i2] = XMVectorAdd(normals[i2], n);
+		}
+		for (size_t i = 0; i < part.vertices.size(); ++i)
+			XMStoreFloat3(&part.vertices[i].normal, XMVector3Normalize(normals[i]));
+	}
+
+	void AppendFormat(std::string& str, const char* format, ...)
+	{
+		char buffer[512];
+		va_list args;
+		va_start(args, format);
+		vsnprintf(buffer, sizeof(buffer), format, args);
+		va_end(args);
+		str += buffer;
+	}
+
+	std::string EscapeJsonString(const std::string& str)
+	{
+		std::string result;
+		for (char c : str)
+		{
+			if (c == '"' || c == '\\')
+				result += '\\';
+			result += c;
+		}
+		return result;
+	}
+
+	// 比较顶点与索引，材质经过glTF的PBR参数转换后不能完全还原，不参与比较
+	bool IsSameGeometry(const std::vector<ObjReader::ObjPart>& lhs, const std::vector<ObjReader::ObjPart>& rhs)
+	{
+		if (lhs.size() != rhs.size())
+			return false;
+		for (size_t i = 0; i < lhs.size(); ++i)
+		{
+			const auto& a = lhs[i];
+			const auto& b = rhs[i];
+			if (a.vertices.size() != b.vertices.size() || a.indices16 != b.indices16 || a.indices32 != b.indices32 ||
+				memcmp(a.vertices.data(), b.vertices.data(), a.vertices.size() * sizeof(VertexPosNormalTex)) != 0)
+				return false;
+		}
+		return true;
+	}
+}
+
+void GlbReader::Accessor::ReadFloats(size_t index, float values[4]) const
+{
+	values[0] = values[1] = values[2] = values[3] = 0.0f;
+	if (!data || index >= count)
+		return;
+
+	const uint8_t* p = data + index * stride;
+	UINT n = componentCount < 4 ? componentCount : 4;
+	for (UINT i = 0; i < n; ++i)
+	{
+		switch (componentType)
+		{
+		case kComponentFloat:
+			values[i] = LoadUnaligned<float>(p + i * 4);
+			break;
+		case kComponentUnsignedByte:
+			values[i] = normalized ? p[i] / 255.0f : p[i];
+			break;
+		case kComponentByte:
+			values[i] = normalized ? (std::max)(static_cast<int8_t>(p[i]) / 127.0f, -1.0f) : static_cast<int8_t>(p[i]);
+			break;
+		case kComponentUnsignedShort:
+			values[i] = LoadUnaligned<uint16_t>(p + i * 2) / (normalized ? 65535.0f : 1.0f);
+			break;
+		case kComponentShort:
+			values[i] = normalized ? (std::max)(LoadUnaligned<int16_t>(p + i * 2) / 32767.0f, -1.0f) : LoadUnaligned<int16_t>(p + i * 2);
+			break;
+		case kComponentUnsignedInt:
+			values[i] = static_cast<float>(LoadUnaligned<uint32_t>(p + i * 4));
+			break;
+		}
+	}
+}
+
+uint32_t GlbReader::Accessor::ReadIndex(size_t index) const
+{
+	if (!data || index >= count)
+		return 0;
+
+	const uint8_t* p = data + index * stride;
+	switch (componentType)
+	{
+	case kComponentUnsignedByte: return *p;
+	case kComponentUnsignedShort: return LoadUnaligned<uint16_t>(p);
+	case kComponentUnsignedInt: return LoadUnaligned<uint32_t>(p);
+	default: return 0;
+	}
+}
+
+bool GlbReader::Open(const wchar_t* glbFileName)
+{
+	Close();
+	m_FileName = glbFileName;
+
+	if (!m_File.Open(glbFileName))
+		return false;
+
+	//
+	// [文件头]12字节
+	// [JSON块长度]4字节 [块类型"JSON"]4字节 [JSON文本]
+	// [BIN块长度]4字节 [块类型"BIN\0"]4字节 [二进制数据] (可选)
+	//
+	const uint8_t* data = m_File.GetData();
+	size_t size = m_File.GetSize();
+	if (size < sizeof(GlbHeader) + sizeof(GlbChunkHeader))
+		return false;
+
+	GlbHeader header = LoadUnaligned<GlbHeader>(data);
+	if (header.magic != kGlbMagic || header.version != kGlbVersion || header.length > size)
+	{
+		Log(glbFileName, L"not a glTF 2.0 binary file");
+		Close();
+		return false;
+	}
+	size = header.length;
+
+	size_t offset = sizeof(GlbHeader);
+	const char* jsonText = nullptr;
+	size_t jsonLength = 0;
+	while (offset + sizeof(GlbChunkHeader) <= size)
+	{
+		GlbChunkHeader chunk = LoadUnaligned<GlbChunkHeader>(data + offset);
+		offset += sizeof(GlbChunkHeader);
+		if (chunk.length > size - offset)
+		{
+			Close();
+			return false;
+		}
+
+		// 第一个块必须为JSON块，BIN块最多只有一个，其余类型的块忽略
+		if (!jsonText)
+		{
+			if (chunk.type != kChunkJson)
+			{
+				Close();
+				return false;
+			}
+			jsonText = reinterpret_cast<const char*>(data + offset);
+			jsonLength = chunk.length;
+		}
+		else if (chunk.type == kChunkBin && !m_pBin)
+		{
+			m_pBin = data + offset;
+			m_BinSize = chunk.length;
+		}
+		offset += chunk.length;
+	}
+
+	if (!jsonText || !JsonValue::Parse(jsonText, jsonLength, m_Json) || !m_Json.IsObject())
+	{
+		Log(glbFileName, L"invalid JSON chunk");
+		Close();
+		return false;
+	}
+
+	//
+	// 缓冲区：只支持引用BIN块的第0个缓冲区
+	//
+	const JsonValue& buffers = m_Json["buffers"];
+	for (size_t i = 0; i < buffers.GetSize(); ++i)
+	{
+		if (i > 0 || buffers[i].HasMember("uri") || !m_pBin)
+		{
+			Log(glbFileName, L"external buffers are not supported");
+			Close();
+			return false;
+		}
+	}
+
+	//
+	// 缓冲区视图
+	//
+	const JsonValue& bufferViews = m_Json["bufferViews"];
+	m_BufferViews.resize(bufferViews.GetSize());
+	for (size_t i = 0; i < bufferViews.GetSize(); ++i)
+	{
+		const JsonValue& view = bufferViews[i];
+		size_t byteOffset = static_cast<size_t>(view["byteOffset"].GetNumber());
+		size_t byteLength = static_cast<size_t>(view["byteLength"].GetNumber());
+		if (GetIndex(view["buffer"]) != 0 || byteOffset > m_BinSize || byteLength > m_BinSize - byteOffset)
+		{
+			Log(glbFileName, L"buffer view out of range");
+			Close();
+			return false;
+		}
+		m_BufferViews[i] = BufferView{ m_pBin + byteOffset, byteLength, static_cast<size_t>(view["byteStride"].GetNumber()) };
+	}
+
+	//
+	// 访问器
+	//
+	const JsonValue& accessors = m_Json["accessors"];
+	m_Accessors.resize(accessors.GetSize());
+	for (size_t i = 0; i < accessors.GetSize(); ++i)
+	{
+		const JsonValue& json = accessors[i];
+		Accessor& accessor = m_Accessors[i];
+		accessor.data = nullptr;
+		accessor.count = static_cast<size_t>(json["count"].GetNumber());
+		accessor.componentType = static_cast<UINT>(json["componentType"].GetNumber());
+		accessor.componentCount = GetComponentCount(json["type"].GetString());
+		accessor.normalized = json["normalized"].GetBool();
+
+		size_t elementSize = GetComponentSize(accessor.componentType) * accessor.componentCount;
+		accessor.stride = elementSize;
+		if (elementSize == 0 || json.HasMember("sparse"))
+		{
+			Log(glbFileName, L"unsupported accessor");
+			Close();
+			return false;
+		}
+
+		size_t viewIndex = GetIndex(json["bufferView"]);
+		if (viewIndex == kInvalidIndex)
+			continue;
+		if (viewIndex >= m_BufferViews.size())
+		{
+			Close();
+			return false;
+		}
+
+		// 元素必须完整地落在缓冲区视图中
+		const BufferView& view = m_BufferViews[viewIndex];
+		size_t byteOffset = static_cast<size_t>(json["byteOffset"].GetNumber());
+		if (view.byteStride)
+			accessor.stride = view.byteStride;
+		if (byteOffset > view.byteLength || accessor.count > view.byteLength ||
+			(accessor.count > 0 && (accessor.count - 1) * accessor.stride + elementSize > view.byteLength - byteOffset))
+		{
+			Log(glbFileName, L"accessor out of range");
+			Close();
+			return false;
+		}
+		accessor.data = view.data + byteOffset;
+	}
+
+	return true;
+}
+
+void GlbReader::Close()
+{
+	m_Json = JsonValue();
+	m_BufferViews.clear();
+	m_Accessors.clear();
+	m_pBin = nullptr;
+	m_BinSize = 0;
+	m_File.Close();
+}
+
+bool GlbReader::ConvertToParts(std::vector<ObjReader::ObjPart>& parts) const
+{
+	parts.clear();
+	const JsonValue& meshes = m_Json["meshes"];
+	const JsonValue& nodes = m_Json["nodes"];
+	const JsonValue& scenes = m_Json["scenes"];
+
+	auto convertMesh = [&](size_t meshIndex, FXMMATRIX World) {
+		const JsonValue& primitives = meshes[meshIndex]["primitives"];
+		for (size_t i = 0; i < primitives.GetSize(); ++i)
+		{
+			ObjReader::ObjPart part;
+			if (ConvertPrimitive(primitives[i], World, part))
+				parts.push_back(std::move(part));
+		}
+	};
+
+	// 没有场景时直接转换所有网格
+	if (!scenes.IsArray() || scenes.GetSize() == 0)
+	{
+		for (size_t i = 0; i < meshes.GetSize(); ++i)
+			convertMesh(i, XMMatrixIdentity());
+		return !parts.empty();
+	}
+
+	size_t sceneIndex = GetIndex(m_Json["scene"]);
+	if (sceneIndex == kInvalidIndex)
+		sceneIndex = 0;
+
+	// 深度优先遍历节点，节点数即为合法的最大深度，用于防止循环引用
+	struct NodeEntry
+	{
+		size_t node;
+		size_t depth;
+		XMFLOAT4X4 parentWorld;
+	};
+	std::vector<NodeEntry> stack;
+	const JsonValue& roots = scenes[sceneIndex]["nodes"];
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+	for (size_t i = 0; i < roots.GetSize(); ++i)
+		stack.push_back(NodeEntry{ GetIndex(roots[i]), 0, identity });
+
+	while (!stack.empty())
+	{
+		NodeEntry entry = stack.back();
+		stack.pop_back();
+		if (entry.node >= nodes.GetSize() || entry.depth > nodes.GetSize())
+			return false;
+
+		const JsonValue& node = nodes[entry.node];
+		// glTF的矩阵按列存储，按行读入XMFLOAT4X4后正好是DirectXMath使用的行向量形式
+		XMMATRIX Local = XMMatrixIdentity();
+		const JsonValue& matrix = node["matrix"];
+		if (matrix.GetSize() == 16)
+		{
+			XMFLOAT4X4 m;
+			for (size_t i = 0; i < 16; ++i)
+				(&m._11)[i] = static_cast<float>(matrix[i].GetNumber());
+			Local = XMLoadFloat4x4(&m);
+		}
+		else
+		{
+			const JsonValue& s = node["scale"];
+			const JsonValue& r = node["rotation"];
+			const JsonValue& t = node["translation"];
+			XMVECTOR scale = XMVectorSet((float)s[(size_t)0].GetNumber(1.0), (float)s[(size_t)1].GetNumber(1.0), (float)s[(size_t)2].GetNumber(1.0), 0.0f);
+			XMVECTOR rotation = XMVectorSet((float)r[(size_t)0].GetNumber(), (float)r[(size_t)1].GetNumber(), (float)r[(size_t)2].GetNumber(), (float)r[(size_t)3].GetNumber(1.0));
+			XMVECTOR translation = XMVectorSet((float)t[(size_t)0].GetNumber(), (float)t[(size_t)1].GetNumber(), (float)t[(size_t)2].GetNumber(), 1.0f);
+			Local = XMMatrixAffineTransformation(scale, XMVectorZero(), rotation, translation);
+		}
+		XMMATRIX World = Local * XMLoadFloat4x4(&entry.parentWorld);
+
+		size_t meshIndex = GetIndex(node["mesh"]);
+		if (meshIndex != kInvalidIndex)
+		{
+			if (meshIndex >= meshes.GetSize())
+				return false;
+			convertMesh(meshIndex, World);
+		}
+
+		const JsonValue& children = node["children"];
+		NodeEntry child = { 0, entry.depth + 1, XMFLOAT4X4() };
+		XMStoreFloat4x4(&child.parentWorld, World);
+		for (size_t i = 0; i < children.GetSize(); ++i)
+		{
+			child.node = GetIndex(children[i]);
+			stack.push_back(child);
+		}
+	}
+
+	return !parts.empty();
+}
+
+bool GlbReader::ConvertPrimitive(const JsonValue& primitive, FXMMATRIX World, ObjReader::ObjPart& part) const
+{
+	size_t mode = GetIndex(primitive["mode"]);
+	if (mode != kInvalidIndex && mode != kModeTriangles)
+	{
+		Log(m_FileName.c_str(), L"skipped a non-triangle primitive");
+		return false;
+	}
+
+	const JsonValue& attributes = primitive["attributes"];
+	size_t positionIndex = GetIndex(attributes["POSITION"]);
+	size_t normalIndex = GetIndex(attributes["NORMAL"]);
+	size_t texCoordIndex = GetIndex(attributes["TEXCOORD_0"]);
+	size_t indicesIndex = GetIndex(primitive["indices"]);
+	if (positionIndex >= m_Accessors.size() ||
+		(normalIndex != kInvalidIndex && normalIndex >= m_Accessors.size()) ||
+		(texCoordIndex != kInvalidIndex && texCoordIndex >= m_Accessors.size()) ||
+		(indicesIndex != kInvalidIndex && indicesIndex >= m_Accessors.size()))
+		return false;
+
+	const Accessor& positions = m_Accessors[positionIndex];
+	size_t vertexCount = positions.count;
+	if (vertexCount == 0 || vertexCount > UINT_MAX)
+		return false;
+
+	// 变换后的法线需要使用逆转置矩阵，存在镜像时三角形的朝向也会反转
+	// 单位变换时跳过变换，使顶点数据保持不变
+	bool identity = XMMatrixIsIdentity(World);
+	XMMATRIX InvTranspose = XMMatrixTranspose(XMMatrixInverse(nullptr, World));
+	bool mirrored = XMVectorGetX(XMMatrixDeterminant(World)) < 0.0f;
+
+	//
+	// 顶点：glTF使用右手坐标系，需要将z值反转
+	//
+	part.vertices.resize(vertexCount);
+	float values[4];
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		VertexPosNormalTex& vertex = part.vertices[i];
+		positions.ReadFloats(i, values);
+		vertex.pos = XMFLOAT3(values[0], values[1], values[2]);
+		if (!identity)
+			XMStoreFloat3(&vertex.pos, XMVector3TransformCoord(XMLoadFloat3(&vertex.pos), World));
+		vertex.pos.z = -vertex.pos.z;
+
+		if (normalIndex != kInvalidIndex)
+		{
+			m_Accessors[normalIndex].ReadFloats(i, values);
+			vertex.normal = XMFLOAT3(values[0], values[1], values[2]);
+			if (!identity)
+				XMStoreFloat3(&vertex.normal, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&vertex.normal), InvTranspose)));
+			vertex.normal.z = -vertex.normal.z;
+		}
+
+		// glTF的纹理坐标原点在左上角，与Direct3D一致
+		if (texCoordIndex != kInvalidIndex)
+			m_Accessors[texCoordIndex].ReadFloats(i, values);
+		else
+			values[0] = values[1] = 0.0f;
+		vertex.tex = XMFLOAT2(values[0], values[1]);
+	}
+
+	//
+	// 索引：转变为左手坐标系需要将三角形顶点反过来
+	//
+	size_t indexCount = indicesIndex != kInvalidIndex ? m_Accessors[indicesIndex].count : vertexCount;
+	indexCount -= indexCount % 3;
+	part.indices32.resize(indexCount);
+	for (size_t i = 0; i < indexCount; i += 3)
+	{
+		for (size_t k = 0; k < 3; ++k)
+		{
+			size_t src = i + (mirrored ? k : 2 - k);
+			DWORD index = indicesIndex != kInvalidIndex ? m_Accessors[indicesIndex].ReadIndex(src) : static_cast<DWORD>(src);
+			if (index >= vertexCount)
+				return false;
+			part.indices32[i + k] = index;
+		}
+	}
+
+	if (normalIndex == kInvalidIndex)
+		ComputeNormals(part);
+
+	ConvertMaterial(GetIndex(primitive["material"]), part);
+	return true;
+}
+
+void GlbReader::ConvertMaterial(size_t materialIndex, ObjReader::ObjPart& part) const
+{
+	// 与.obj相同的默认材质
+	part.material.ambient = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
+	part.material.diffuse = XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f);
+	part.material.specular = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+	part.material.reflect = XMFLOAT4();
+
+	const JsonValue& material = m_Json["materials"][materialIndex];
+	if (!material.IsObject())
+		return;
+
+	const JsonValue& pbr = material["pbrMetallicRoughness"];
+	const JsonValue& baseColor = pbr["baseColorFactor"];
+	XMFLOAT4 color(1.0f, 1.0f, 1.0f, 1.0f);
+	if (baseColor.GetSize() == 4)
+		color = XMFLOAT4((float)baseColor[(size_t)0].GetNumber(), (float)baseColor[(size_t)1].GetNumber(),
+			(float)baseColor[(size_t)2].GetNumber(), (float)baseColor[(size_t)3].GetNumber());
+	float metallic = (float)pbr["metallicFactor"].GetNumber(1.0);
+	float roughness = (float)pbr["roughnessFactor"].GetNumber(1.0);
+
+	part.material.diffuse = color;
+	part.material.ambient = XMFLOAT4(color.x * 0.25f, color.y * 0.25f, color.z * 0.25f, color.w);
+	// 镜面反射颜色介于非金属的0.04与基础颜色之间，粗糙度按Blinn-Phong的近似关系转换为镜面系数
+	XMVECTOR specular = XMVectorLerp(XMVectorReplicate(0.04f), XMLoadFloat4(&color), metallic);
+	specular = XMVectorScale(specular, 1.0f - roughness * 0.5f);
+	XMStoreFloat4(&part.material.specular, specular);
+	float r4 = (std::max)(roughness * roughness * roughness * roughness, 1e-4f);
+	part.material.specular.w = (std::min)((std::max)(2.0f / r4 - 2.0f, 1.0f), 256.0f);
+
+	size_t textureIndex = GetIndex(pbr["baseColorTexture"]["index"]);
+	if (textureIndex != kInvalidIndex)
+	{
+		size_t imageIndex = GetIndex(m_Json["textures"][textureIndex]["source"]);
+		if (imageIndex != kInvalidIndex)
+			part.texStrDiffuse = GetImagePath(imageIndex);
+	}
+}
+
+std::wstring GlbReader::GetImagePath(size_t imageIndex) const
+{
+	const JsonValue& image = m_Json["images"][imageIndex];
+	const std::string& uri = image["uri"].GetString();
+	std::wstring dir = GetDirectory(m_FileName);
+
+	if (!uri.empty())
+	{
+		if (uri.compare(0, 5, "data:") == 0)
+		{
+			Log(m_FileName.c_str(), L"data URI images are not supported");
+			return std::wstring();
+		}
+		return dir + Utf8ToWide(DecodeUri(uri));
+	}
+
+	// 内嵌在BIN块中的图像需要提取为文件，已存在则直接使用
+	size_t viewIndex = GetIndex(image["bufferView"]);
+	if (viewIndex >= m_BufferViews.size())
+		return std::wstring();
+
+	const std::string& mimeType = image["mimeType"].GetString();
+	const wchar_t* extension = mimeType == "image/png" ? L"png" : mimeType == "image/jpeg" ? L"jpg" :
+		mimeType == "image/vnd-ms.dds" ? L"dds" : L"bin";
+	wchar_t suffix[64];
+	swprintf_s(suffix, L".image%zu.%ls", imageIndex, extension);
+	std::wstring imagePath = m_FileName + suffix;
+
+	if (GetFileAttributesW(imagePath.c_str()) == INVALID_FILE_ATTRIBUTES)
+	{
+		const BufferView& view = m_BufferViews[viewIndex];
+		std::ofstream fout(imagePath, std::ios::out | std::ios::binary);
+		fout.write(reinterpret_cast<const char*>(view.data), view.byteLength);
+		if (!fout)
+		{
+			fout.close();
+			DeleteFileW(imagePath.c_str());
+			return std::wstring();
+		}
+	}
+	return imagePath;
+}
+
+bool GlbReader::WriteGlb(const wchar_t* glbFileName, const std::vector<ObjReader::ObjPart>& parts)
+{
+	std::wstring dir = GetDirectory(glbFileName);
+	std::vector<uint8_t> bin;
+	std::string bufferViews, accessors, meshes, materials, nodes, images, textures;
+	size_t imageCount = 0;
+
+	// 以4字节对齐追加数据，返回其在BIN块中的偏移
+	auto append = [&bin](const void* data, size_t size) {
+		bin.resize((bin.size() + 3) & ~size_t(3));
+		size_t offset = bin.size();
+		bin.insert(bin.end(), static_cast<const uint8_t*>(data), static_cast<const uint8_t*>(data) + size);
+		return offset;
+	};
+	auto separator = [](std::string& str) {
+		if (!str.empty())
+			str += ',';
+	};
+
+	for (size_t i = 0; i < parts.size(); ++i)
+	{
+		const auto& part = parts[i];
+		size_t vertexCount = part.vertices.size();
+		bool use32 = !part.indices32.empty();
+		size_t indexCount = use32 ? part.indices32.size() : part.indices16.size();
+		if (vertexCount == 0)
+			return false;
+
+		//
+		// 顶点交错存放，转换回右手坐标系
+		//
+		std::vector<VertexPosNormalTex> vertices(part.vertices);
+		XMFLOAT3 vMin(FLT_MAX, FLT_MAX, FLT_MAX), vMax(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+		for (auto& vertex : vertices)
+		{
+			vertex.pos.z = -vertex.pos.z;
+			vertex.normal.z = -vertex.normal.z;
+			vMin = XMFLOAT3((std::min)(vMin.x, vertex.pos.x), (std::min)(vMin.y, vertex.pos.y), (std::min)(vMin.z, vertex.pos.z));
+			vMax = XMFLOAT3((std::max)(vMax.x, vertex.pos.x), (std::max)(vMax.y, vertex.pos.y), (std::max)(vMax.z, vertex.pos.z));
+		}
+		size_t vertexOffset = append(vertices.data(), vertexCount * sizeof(VertexPosNormalTex));
+		size_t vertexView = i * 2, indexView = i * 2 + 1;
+		separator(bufferViews);
+		AppendFormat(bufferViews, "{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu,\"byteStride\":%zu,\"target\":34962}",
+			vertexOffset, vertexCount * sizeof(VertexPosNormalTex), sizeof(VertexPosNormalTex));
+
+		// 三角形顶点顺序反转回逆时针
+		size_t indexOffset;
+		if (use32)
+		{
+			std::vector<DWORD> indices(part.indices32);
+			for (size_t j = 0; j + 2 < indices.size(); j += 3)
+				std::swap(indices[j], indices[j + 2]);
+			indexOffset = append(indices.data(), indices.size() * sizeof(DWORD));
+		}
+		else
+		{
+			std::vector<WORD> indices(part.indices16);
+			for (size_t j = 0; j + 2 < indices.size(); j += 3)
+				std::swap(indices[j], indices[j + 2]);
+			indexOffset = append(indices.data(), indices.size() * sizeof(WORD));
+		}
+		separator(bufferViews);
+		AppendFormat(bufferViews, "{\"buffer\":0,\"byteOffset\":%zu,\"byteLength\":%zu,\"target\":34963}",
+			indexOffset, indexCount * (use32 ? sizeof(DWORD) : sizeof(WORD)));
+
+		size_t firstAccessor = i * 4;
+		separator(accessors);
+		AppendFormat(accessors, "{\"bufferView\":%zu,\"byteOffset\":0,\"componentType\":%u,\"count\":%zu,\"type\":\"VEC3\","
+			"\"min\":[%.9g,%.9g,%.9g],\"max\":[%.9g,%.9g,%.9g]},",
+			vertexView, kComponentFloat, vertexCount, vMin.x, vMin.y, vMin.z, vMax.x, vMax.y, vMax.z);
+		AppendFormat(accessors, "{\"bufferView\":%zu,\"byteOffset\":12,\"componentType\":%u,\"count\":%zu,\"type\":\"VEC3\"},",
+			vertexView, kComponentFloat, vertexCount);
+		AppendFormat(accessors, "{\"bufferView\":%zu,\"byteOffset\":24,\"componentType\":%u,\"count\":%zu,\"type\":\"VEC2\"},",
+			vertexView, kComponentFloat, vertexCount);
+		AppendFormat(accessors, "{\"bufferView\":%zu,\"componentType\":%u,\"count\":%zu,\"type\":\"SCALAR\"}",
+			indexView, use32 ? kComponentUnsignedInt : kComponentUnsignedShort, indexCount);
+
+		separator(meshes);
+		AppendFormat(meshes, "{\"primitives\":[{\"attributes\":{\"POSITION\":%zu,\"NORMAL\":%zu,\"TEXCOORD_0\":%zu},"
+			"\"indices\":%zu,\"material\":%zu,\"mode\":4}]}",
+			firstAccessor, firstAccessor + 1, firstAccessor + 2, firstAccessor + 3, i);
+
+		separator(nodes);
+		AppendFormat(nodes, "{\"mesh\":%zu}", i);
+
+		//
+		// 材质：漫射光颜色作为基础颜色，纹理路径相对于.glb所在目录
+		//
+		const Material& material = part.material;
+		separator(materials);
+		AppendFormat(materials, "{\"pbrMetallicRoughness\":{\"baseColorFactor\":[%.9g,%.9g,%.9g,%.9g],\"metallicFactor\":0,\"roughnessFactor\":1",
+			material.diffuse.x, material.diffuse.y, material.diffuse.z, material.diffuse.w);
+		if (!part.texStrDiffuse.empty())
+		{
+			std::wstring texPath = part.texStrDiffuse;
+			if (!dir.empty() && texPath.compare(0, dir.size(), dir) == 0)
+				texPath = texPath.substr(dir.size());
+			std::replace(texPath.begin(), texPath.end(), L'\\', L'/');
+
+			separator(images);
+			images += "{\"uri\":\"" + EscapeJsonString(WideToUtf8(texPath)) + "\"}";
+			separator(textures);
+			AppendFormat(textures, "{\"source\":%zu}", imageCount);
+			AppendFormat(materials, ",\"baseColorTexture\":{\"index\":%zu}", imageCount);
+			++imageCount;
+		}
+		materials += "}}";
+	}
+
+	std::string json = "{\"asset\":{\"version\":\"2.0\",\"generator\":\"GerstnerWaves GlbReader\"},\"scene\":0,\"scenes\":[{\"nodes\":[";
+	for (size_t i = 0; i < parts.size(); ++i)
+		AppendFormat(json, i ? ",%zu" : "%zu", i);
+	json += "]}],\"nodes\":[" + nodes + "],\"meshes\":[" + meshes + "],\"materials\":[" + materials + "]";
+	if (imageCount > 0)
+		json += ",\"images\":[" + images + "],\"textures\":[" + textures + "]";
+	AppendFormat(json, ",\"buffers\":[{\"byteLength\":%zu}]", bin.size());
+	json += ",\"bufferViews\":[" + bufferViews + "],\"accessors\":[" + accessors + "]}";
+
+	// JSON块以空格、BIN块以0补齐到4字节
+	json.resize((json.size() + 3) & ~size_t(3), ' ');
+	bin.resize((bin.size() + 3) & ~size_t(3), 0);
+
+	std::ofstream fout(glbFileName, std::ios::out | std::ios::binary);
+	if (!fout.is_open())
+		return false;
+
+	GlbHeader header = { kGlbMagic, kGlbVersion,
+		(uint32_t)(sizeof(GlbHeader) + 2 * sizeof(GlbChunkHeader) + json.size() + bin.size()) };
+	GlbChunkHeader jsonChunk = { (uint32_t)json.size(), kChunkJson };
+	GlbChunkHeader binChunk = { (uint32_t)bin.size(), kChunkBin };
+	fout.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	fout.write(reinterpret_cast<const char*>(&jsonChunk), sizeof(jsonChunk));
+	fout.write(json.data(), json.size());
+	fout.write(reinterpret_cast<const char*>(&binChunk), sizeof(binChunk));
+	fout.write(reinterpret_cast<const char*>(bin.data()), bin.size());
+	fout.close();
+
+	if (fout.fail())
+	{
+		DeleteFileW(glbFileName);
+		return false;
+	}
+	return true;
+}
+
+bool GlbReader::CompareLoadTime(const wchar_t* objFileName, const wchar_t* glbFileName, LoadTimeReport& report)
+{
+	report = LoadTimeReport();
+
+	ObjReader objReader;
+	auto start = std::chrono::high_resolution_clock::now();
+	if (!objReader.ReadObj(objFileName))
+		return false;
+	auto end = std::chrono::high_resolution_clock::now();
+	report.objSeconds = std::chrono::duration<double>(end - start).count();
+
+	if (GetFileAttributesW(glbFileName) == INVALID_FILE_ATTRIBUTES && !WriteGlb(glbFileName, objReader.objParts))
+		return false;
+
+	ObjReader glbReader;
+	start = std::chrono::high_resolution_clock::now();
+	if (!glbReader.ReadGlb(glbFileName))
+		return false;
+	end = std::chrono::high_resolution_clock::now();
+	report.glbSeconds = std::chrono::duration<double>(end - start).count();
+
+	report.objFileBytes = GetFileBytes(objFileName);
+	report.glbFileBytes = GetFileBytes(glbFileName);
+	report.geometryMatches = IsSameGeometry(objReader.objParts, glbReader.objParts);
+
+	wchar_t strBuffer[512];
+	swprintf_s(strBuffer, L"%ls: %.2f ms (%.1f MB), %ls: %.2f ms (%.1f MB), %.1fx faster, geometry %ls\n",
+		objFileName, report.objSeconds * 1000.0, report.objFileBytes / 1048576.0,
+		glbFileName, report.glbSeconds * 1000.0, report.glbFileBytes / 1048576.0,
+		report.glbSeconds > 0.0 ? report.objSeconds / report.glbSeconds : 0.0,
+		report.geometryMatches ? L"matches" : L"differs");
+	OutputDebugStringW(strBuffer);
+	return true;
+}
@@ -0,0 +1,99 @@
+﻿//***************************************************************************************
+// GlbReader.h
+// Licensed under the MIT License.
+//
+// 二进制glTF(.glb)读取器
+// - 整个文件以内存映射的方式打开，缓冲区视图与访问器直接指向BIN块，不复制数据
+// - 只支持内嵌在BIN块中的缓冲区，不支持外部.bin文件与稀疏访问器
+// - 只转换三角形列表图元，每个被场景节点引用的图元生成一个ObjPart，节点变换会应用到顶点上
+// - 材质只使用pbrMetallicRoughness的基础颜色与纹理，粗糙度/金属度近似转换为镜面反射参数
+// - 内嵌的图像会被提取到.glb旁的文件中，以便按路径加载纹理
+// Binary glTF (.glb) reader. The BIN chunk is memory mapped and buffer views and
+// accessors point straight into it. Triangle primitives are converted into the same
+// ObjPart structures used by ObjReader.
+//***************************************************************************************
+
+#ifndef GLBREADER_H
+#define GLBREADER_H
+
+#include "ObjReader.h"
+#include "MappedFile.h"
+#include "Json.h"
+
+class GlbReader
+{
+public:
+	// 缓冲区视图，指向映射的BIN块
+	struct BufferView
+	{
+		const uint8_t* data;
+		size_t byteLength;
+		size_t byteStride;			// 0表示元素紧密排列
+	};
+
+	// 访问器，指向映射的BIN块
+	struct Accessor
+	{
+		const uint8_t* data;		// 第一个元素的地址，没有缓冲区视图时为nullptr，所有元素视为0
+		size_t count;				// 元素数目
+		size_t stride;				// 相邻元素的字节间隔
+		UINT componentType;			// 5120~5126，与OpenGL的类型枚举一致
+		UINT componentCount;		// SCALAR为1，VECn为n，MATn为n*n
+		bool normalized;
+
+		// 读取第index个元素的前(最多)4个分量并转换为浮点数，不足的分量填0
+		void ReadFloats(size_t index, float values[4]) const;
+		// 读取第index个无符号整数元素
+		uint32_t ReadIndex(size_t index) const;
+	};
+
+	// .obj与.glb加载耗时的比较
+	struct LoadTimeReport
+	{
+		double objSeconds;
+		double glbSeconds;
+		ULONGLONG objFileBytes;
+		ULONGLONG glbFileBytes;
+		bool geometryMatches;		// 两者读取出的顶点与索引是否完全一致
+	};
+
+	GlbReader() : m_pBin(), m_BinSize() {}
+	~GlbReader() = default;
+
+	GlbReader(const GlbReader&) = delete;
+	GlbReader& operator=(const GlbReader&) = delete;
+
+	// 映射.glb文件并解析JSON块
+	bool Open(const wchar_t* glbFileName);
+	void Close();
+
+	const JsonValue& GetJson() const { return m_Json; }
+	// 以下视图在Close之前有效
+	const std::vector<BufferView>& GetBufferViews() const { return m_BufferViews; }
+	const std::vector<Accessor>& GetAccessors() const { return m_Accessors; }
+
+	// 将默认场景引用的所有三角形图元转换为ObjPart
+	// 顶点已转换为左手坐标系，索引存放在indices32中
+	bool ConvertToParts(std::vector<ObjReader::ObjPart>& parts) const;
+
+	// 将ObjPart写入.glb文件，坐标转换回glTF的右手坐标系
+	static bool WriteGlb(const wchar_t* glbFileName, const std::vector<ObjReader::ObjPart>& parts);
+
+	// 分别读取同一网格的.obj与.glb并比较耗时，.glb不存在时先由.obj生成
+	static bool CompareLoadTime(const wchar_t* objFileName, const wchar_t* glbFileName, LoadTimeReport& report);
+
+private:
+	bool ConvertPrimitive(const JsonValue& primitive, DirectX::FXMMATRIX World, ObjReader::ObjPart& part) const;
+	void ConvertMaterial(size_t materialIndex, ObjReader::ObjPart& part) const;
+	std::wstring GetImagePath(size_t imageIndex) const;
+
+	std::wstring m_FileName;
+	MappedFile m_File;
+	JsonValue m_Json;
+	const uint8_t* m_pBin;
+	size_t m_BinSize;
+	std::vector<BufferView> m_BufferViews;
+	std::vector<Accessor> m_Accessors;
+};
+
+#endif
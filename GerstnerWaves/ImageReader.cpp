@@ -0,0 +1,957 @@
+﻿#include "ImageReader.h"
+#include "Deflate.h"
+#include "PixelConvert.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+	const uint32_t kMaxTextureSize = 16384;		// D3D11二维纹理的尺寸限制
+	const uint8_t kPngSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+
+	// TGA的图像类型，加8为对应的RLE压缩类型
+	const uint32_t kTgaColorMapped = 1;
+	const uint32_t kTgaTrueColor = 2;
+	const uint32_t kTgaGray = 3;
+	const uint32_t kTgaRle = 8;
+
+	// BMP的压缩方式
+	const uint32_t kBmpRgb = 0;
+	const uint32_t kBmpRle8 = 1;
+	const uint32_t kBmpRle4 = 2;
+	const uint32_t kBmpBitFields = 3;
+	const uint32_t kBmpAlphaBitFields = 6;
+
+	// PNG的颜色类型
+	const uint32_t kPngGray = 0;
+	const uint32_t kPngRgb = 2;
+	const uint32_t kPngPalette = 3;
+	const uint32_t kPngGrayAlpha = 4;
+	const uint32_t kPngRgba = 6;
+
+	constexpr uint32_t MakeChunkType(char ch0, char ch1, char ch2, char ch3)
+	{
+		return static_cast<uint32_t>(static_cast<uint8_t>(ch0)) << 24 | static_cast<uint32_t>(static_cast<uint8_t>(ch1)) << 16 |
+			static_cast<uint32_t>(static_cast<uint8_t>(ch2)) << 8 | static_cast<uint32_t>(static_cast<uint8_t>(ch3));
+	}
+
+	inline uint32_t ReadLe16(const uint8_t* p)
+	{
+		return p[0] | (p[1] << 8);
+	}
+
+	inline uint32_t ReadLe32(const uint8_t* p)
+	{
+		return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+			(static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+	}
+
+	inline uint32_t ReadBe16(const uint8_t* p)
+	{
+		return (p[0] << 8) | p[1];
+	}
+
+	inline uint32_t ReadBe32(const uint8_t* p)
+	{
+		return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+			(static_cast<uint32_t>(p[2]) << 8) | static_cast<uint32_t>(p[3]);
+	}
+
+	// 把bits位的值扩展到8位，按最近值取整
+	inline uint8_t ScaleTo8(uint32_t value, uint32_t bits)
+	{
+		if (bits == 0)
+			return 0;
+		if (bits == 8)
+			return static_cast<uint8_t>(value);
+		uint64_t maxValue = (1ull << bits) - 1;
+		return static_cast<uint8_t>((value * 255ull + maxValue / 2) / maxValue);
+	}
+
+	// 16位通道转为8位，与PixelConvert::R16ToR8的取整一致
+	inline uint8_t Scale16To8(uint32_t value)
+	{
+		return static_cast<uint8_t>((value * 255 + 32767) / 65535);
+	}
+
+	// 读取按高位在前打包的第index个bits位样本
+	inline uint32_t ReadPackedSample(const uint8_t* src, uint32_t index, uint32_t bits)
+	{
+		uint32_t bitOffset = index * bits;
+		return (src[bitOffset >> 3] >> (8 - bits - (bitOffset & 7))) & ((1u << bits) - 1);
+	}
+
+	// 位域掩码的最低位与位数
+	struct BitField
+	{
+		explicit BitField(uint32_t mask) : mask(mask), shift(), bits()
+		{
+			if (mask)
+			{
+				while (!((mask >> shift) & 1))
+					++shift;
+				while (shift + bits < 32 && ((mask >> (shift + bits)) & 1))
+					++bits;
+			}
+		}
+
+		uint8_t Extract(uint32_t value) const
+		{
+			return ScaleTo8((value & mask) >> shift, bits);
+		}
+
+		uint32_t mask;
+		uint32_t shift;
+		uint32_t bits;
+	};
+
+	// TGA的16位像素为A1R5G5B5，按小端序存放
+	inline void ConvertTga16(const uint8_t* src, uint8_t* dst, bool hasAlpha)
+	{
+		uint32_t value = ReadLe16(src);
+		dst[0] = ScaleTo8((value >> 10) & 31, 5);
+		dst[1] = ScaleTo8((value >> 5) & 31, 5);
+		dst[2] = ScaleTo8(value & 31, 5);
+		dst[3] = hasAlpha && !(value & 0x8000) ? 0 : 255;
+	}
+
+	// 预测值p = a + b - c，与a、b、c的距离展开后不依赖p，编译器可以生成无分支的选择
+	inline uint8_t Paeth(int a, int b, int c)
+	{
+		int pa = std::abs(b - c), pb = std::abs(a - c), pc = std::abs(a + b - 2 * c);
+		int nearest = pb <= pc ? b : c;
+		return static_cast<uint8_t>(pa <= pb && pa <= pc ? a : nearest);
+	}
+
+	// Paeth滤波逐字节依赖左侧像素，按常量像素大小展开后左侧与左上的值可以留在寄存器中
+	template <size_t Stride>
+	void UnfilterPaeth(uint8_t* row, const uint8_t* prior, size_t size)
+	{
+		for (size_t i = 0; i < Stride && i < size; ++i)
+			row[i] = static_cast<uint8_t>(row[i] + prior[i]);
+		for (size_t i = Stride; i + Stride <= size; i += Stride)
+		{
+			for (size_t k = 0; k < Stride; ++k)
+				row[i + k] = static_cast<uint8_t>(row[i + k] + Paeth(row[i + k - Stride], prior[i + k], prior[i + k - Stride]));
+		}
+	}
+
+	// 原地还原PNG一行的滤波，prior为已还原的上一行(第一行为全0)，stride为一个像素的字节数(不足1字节按1算)
+	bool Unfilter(uint32_t filter, uint8_t* row, const uint8_t* prior, size_t size, size_t stride)
+	{
+		switch (filter)
+		{
+		case 0:
+			return true;
+		case 1:
+			for (size_t i = stride; i < size; ++i)
+				row[i] = static_cast<uint8_t>(row[i] + row[i - stride]);
+			return true;
+		case 2:
+			for (size_t i = 0; i < size; ++i)
+				row[i] = static_cast<uint8_t>(row[i] + prior[i]);
+			return true;
+		case 3:
+			for (size_t i = 0; i < stride && i < size; ++i)
+				row[i] = static_cast<uint8_t>(row[i] + (prior[i] >> 1));
+			for (size_t i = stride; i < size; ++i)
+				row[i] = static_cast<uint8_t>(row[i] + ((row[i - stride] + prior[i]) >> 1));
+			return true;
+		case 4:
+			// 8位RGB与RGBA最常见，行的字节数总是像素大小的整数倍
+			if (stride == 3)
+			{
+				UnfilterPaeth<3>(row, prior, size);
+				return true;
+			}
+			if (stride == 4)
+			{
+				UnfilterPaeth<4>(row, prior, size);
+				return true;
+			}
+			for (size_t i = 0; i < stride && i < size; ++i)
+				row[i] = static_cast<uint8_t>(row[i] + prior[i]);
+			for (size_t i = stride; i < size; ++i)
+				row[i] = static_cast<uint8_t>(row[i] + Paeth(row[i - stride], prior[i], prior[i - stride]));
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	// Adam7隔行的7个pass: 起点x、y与间隔x、y
+	const uint32_t kAdam7[7][4] = {
+		{ 0, 0, 8, 8 }, { 4, 0, 8, 8 }, { 0, 4, 4, 8 }, { 2, 0, 4, 4 }, { 0, 2, 2, 4 }, { 1, 0, 2, 2 }, { 0, 1, 1, 2 }
+	};
+	const uint32_t kNoInterlace[1][4] = { { 0, 0, 1, 1 } };
+}
+
+ImageReader::ImageReader()
+	: m_pData(), m_Size(), m_Error(""), m_Format(Format::Unknown), m_Width(), m_Height(), m_HasAlpha(), m_IsSrgb(),
+	m_BitsPerPixel(), m_Compression(), m_TopDown(), m_RightToLeft(), m_DataOffset(), m_Masks(),
+	m_ColorType(), m_BitDepth(), m_Interlaced(), m_HasColorKey(), m_ColorKey()
+{
+}
+
+bool ImageReader::Fail(const char* error)
+{
+	m_Error = error;
+	return false;
+}
+
+ImageReader::Format ImageReader::DetectFormat(const uint8_t* data, size_t size)
+{
+	if (size >= sizeof(kPngSignature) && memcmp(data, kPngSignature, sizeof(kPngSignature)) == 0)
+		return Format::Png;
+	if (size >= 18 && data[0] == 'B' && data[1] == 'M')
+		return Format::Bmp;
+
+	// TGA没有魔数，按文件头各字段的取值判断
+	if (size >= 18)
+	{
+		uint32_t colorMapType = data[1], imageType = data[2] & ~kTgaRle, bitsPerPixel = data[16];
+		bool validType = (data[2] & ~(kTgaRle | 3)) == 0 && imageType != 0;
+		bool validDepth = bitsPerPixel == 8 || bitsPerPixel == 15 || bitsPerPixel == 16 || bitsPerPixel == 24 || bitsPerPixel == 32;
+		if (validType && validDepth && colorMapType <= 1 && (imageType != kTgaColorMapped || colorMapType == 1) &&
+			ReadLe16(data + 12) != 0 && ReadLe16(data + 14) != 0)
+			return Format::Tga;
+	}
+	return Format::Unknown;
+}
+
+bool ImageReader::Parse(const uint8_t* data, size_t size)
+{
+	m_pData = data;
+	m_Size = size;
+	m_Error = "";
+	m_Width = m_Height = 0;
+	m_HasAlpha = m_IsSrgb = false;
+	m_BitsPerPixel = m_Compression = 0;
+	m_TopDown = m_RightToLeft = false;
+	m_DataOffset = 0;
+	// 调色板总是256项，文件中未给出的项为不透明黑色
+	m_Palette.assign(256 * 4, 0);
+	for (size_t i = 3; i < m_Palette.size(); i += 4)
+		m_Palette[i] = 255;
+	memset(m_Masks, 0, sizeof(m_Masks));
+	m_ColorType = m_BitDepth = 0;
+	m_Interlaced = m_HasColorKey = false;
+	memset(m_ColorKey, 0, sizeof(m_ColorKey));
+	m_DataChunks.clear();
+
+	m_Format = DetectFormat(data, size);
+	bool parsed;
+	switch (m_Format)
+	{
+	case Format::Tga: parsed = ParseTga(); break;
+	case Format::Bmp: parsed = ParseBmp(); break;
+	case Format::Png: parsed = ParsePng(); break;
+	default: parsed = Fail("unknown image format"); break;
+	}
+	if (!parsed)
+	{
+		m_Format = Format::Unknown;
+		return false;
+	}
+
+	if (m_Width == 0 || m_Height == 0)
+	{
+		m_Format = Format::Unknown;
+		return Fail("zero dimension");
+	}
+	if (m_Width > kMaxTextureSize || m_Height > kMaxTextureSize)
+	{
+		m_Format = Format::Unknown;
+		return Fail("image too large");
+	}
+	return true;
+}
+
+bool ImageReader::Decode(uint8_t* destination, size_t rowPitch)
+{
+	if (rowPitch < static_cast<size_t>(m_Width) * 4)
+		return Fail("row pitch too small");
+
+	switch (m_Format)
+	{
+	case Format::Tga: return DecodeTga(destination, rowPitch);
+	case Format::Bmp: return DecodeBmp(destination, rowPitch);
+	case Format::Png: return DecodePng(destination, rowPitch);
+	default: return Fail("no image parsed");
+	}
+}
+
+//
+// TGA
+//
+
+bool ImageReader::ParseTga()
+{
+	const uint8_t* header = m_pData;
+	uint32_t idLength = header[0], colorMapType = header[1];
+	uint32_t mapFirst = ReadLe16(header + 3), mapLength = ReadLe16(header + 5), mapEntryBits = header[7];
+	uint32_t descriptor = header[17];
+	m_Compression = header[2];
+	m_Width = ReadLe16(header + 12);
+	m_Height = ReadLe16(header + 14);
+	m_BitsPerPixel = header[16];
+	m_TopDown = (descriptor & 0x20) != 0;
+	m_RightToLeft = (descriptor & 0x10) != 0;
+
+	uint32_t imageType = m_Compression & ~kTgaRle;
+	if ((imageType == kTgaColorMapped || imageType == kTgaGray) ? m_BitsPerPixel != 8 : m_BitsPerPixel == 8)
+		return Fail("unsupported pixel depth");
+
+	size_t offset = 18 + idLength;
+	if (colorMapType == 1)
+	{
+		if (mapEntryBits != 15 && mapEntryBits != 16 && mapEntryBits != 24 && mapEntryBits != 32)
+			return Fail("unsupported color map entry size");
+		size_t entryBytes = (mapEntryBits + 7) / 8;
+		if (offset > m_Size || mapLength * entryBytes > m_Size - offset)
+			return Fail("truncated color map");
+
+		// 真彩色图像也可能带有调色板，跳过即可
+		if (imageType == kTgaColorMapped)
+		{
+			const uint8_t* entry = m_pData + offset;
+			for (uint32_t i = 0; i < mapLength; ++i, entry += entryBytes)
+			{
+				uint32_t index = mapFirst + i;
+				if (index >= 256)
+					break;
+				uint8_t* dst = &m_Palette[index * 4];
+				if (entryBytes == 2)
+					ConvertTga16(entry, dst, (descriptor & 15) != 0);
+				else
+				{
+					dst[0] = entry[2];
+					dst[1] = entry[1];
+					dst[2] = entry[0];
+					dst[3] = entryBytes == 4 ? entry[3] : 255;
+				}
+			}
+			m_HasAlpha = mapEntryBits == 32 || (mapEntryBits == 16 && (descriptor & 15) != 0);
+		}
+		offset += mapLength * entryBytes;
+	}
+
+	if (imageType == kTgaTrueColor)
+		m_HasAlpha = m_BitsPerPixel == 32 || (m_BitsPerPixel == 16 && (descriptor & 15) != 0);
+	if (offset > m_Size)
+		return Fail("truncated header");
+	m_DataOffset = offset;
+	return true;
+}
+
+void ImageReader::ConvertTgaRow(const uint8_t* src, uint8_t* dst) const
+{
+	switch (m_BitsPerPixel)
+	{
+	case 8:
+		if ((m_Compression & ~kTgaRle) == kTgaGray)
+		{
+			for (uint32_t x = 0; x < m_Width; ++x, dst += 4)
+			{
+				dst[0] = dst[1] = dst[2] = src[x];
+				dst[3] = 255;
+			}
+		}
+		else
+		{
+			for (uint32_t x = 0; x < m_Width; ++x)
+				memcpy(dst + x * 4, &m_Palette[src[x] * 4], 4);
+		}
+		break;
+	case 15:
+	case 16:
+		for (uint32_t x = 0; x < m_Width; ++x)
+			ConvertTga16(src + x * 2, dst + x * 4, m_HasAlpha);
+		break;
+	case 24:
+		PixelConvert::RgbToRgba(src, dst, m_Width, true);
+		break;
+	default:
+		PixelConvert::SwapRedBlue(src, dst, m_Width);
+		break;
+	}
+
+	if (m_RightToLeft)
+	{
+		uint32_t* pixels = reinterpret_cast<uint32_t*>(dst);
+		std::reverse(pixels, pixels + m_Width);
+	}
+}
+
+bool ImageReader::DecodeTga(uint8_t* destination, size_t rowPitch)
+{
+	size_t pixelBytes = (m_BitsPerPixel + 7) / 8;
+	size_t rowBytes = m_Width * pixelBytes;
+	const uint8_t* src = m_pData + m_DataOffset;
+	const uint8_t* end = m_pData + m_Size;
+	bool rle = (m_Compression & kTgaRle) != 0;
+
+	// RLE的包可以跨行，先展开到一行源像素再转换
+	std::vector<uint8_t> row(rle ? rowBytes : 0);
+	size_t runLeft = 0;
+	bool repeat = false;
+	const uint8_t* runPixel = nullptr;
+	for (uint32_t y = 0; y < m_Height; ++y)
+	{
+		uint8_t* dst = destination + (m_TopDown ? y : m_Height - 1 - y) * rowPitch;
+		if (!rle)
+		{
+			if (static_cast<size_t>(end - src) < rowBytes)
+				return Fail("truncated pixel data");
+			ConvertTgaRow(src, dst);
+			src += rowBytes;
+			continue;
+		}
+
+		for (size_t x = 0; x < m_Width;)
+		{
+			if (runLeft == 0)
+			{
+				if (src == end)
+					return Fail("truncated pixel data");
+				uint8_t packet = *src++;
+				runLeft = (packet & 127) + 1;
+				repeat = (packet & 128) != 0;
+				if (repeat)
+				{
+					if (static_cast<size_t>(end - src) < pixelBytes)
+						return Fail("truncated pixel data");
+					runPixel = src;
+					src += pixelBytes;
+				}
+			}
+
+			size_t count = (std::min)(runLeft, m_Width - x);
+			uint8_t* out = row.data() + x * pixelBytes;
+			if (repeat)
+			{
+				for (size_t i = 0; i < count; ++i)
+					memcpy(out + i * pixelBytes, runPixel, pixelBytes);
+			}
+			else
+			{
+				if (static_cast<size_t>(end - src) < count * pixelBytes)
+					return Fail("truncated pixel data");
+				memcpy(out, src, count * pixelBytes);
+				src += count * pixelBytes;
+			}
+			x += count;
+			runLeft -= count;
+		}
+		ConvertTgaRow(row.data(), dst);
+	}
+	return true;
+}
+
+//
+// BMP
+//
+
+bool ImageReader::ParseBmp()
+{
+	const uint8_t* info = m_pData + 14;
+	uint32_t headerSize = ReadLe32(info);
+	size_t paletteOffset = 14 + static_cast<size_t>(headerSize);
+	size_t entryBytes = 4;
+	uint32_t colorsUsed = 0;
+	if (headerSize == 12)
+	{
+		// OS/2的BITMAPCOREHEADER，调色板每项3字节
+		if (m_Size < 26)
+			return Fail("truncated header");
+		m_Width = ReadLe16(info + 4);
+		m_Height = ReadLe16(info + 6);
+		m_BitsPerPixel = ReadLe16(info + 10);
+		m_Compression = kBmpRgb;
+		entryBytes = 3;
+	}
+	else if (headerSize >= 40 && headerSize <= m_Size - 14)
+	{
+		int32_t width = static_cast<int32_t>(ReadLe32(info + 4));
+		int32_t height = static_cast<int32_t>(ReadLe32(info + 8));
+		if (width <= 0 || height == 0 || height == INT32_MIN)
+			return Fail("invalid dimension");
+		m_Width = static_cast<uint32_t>(width);
+		m_Height = static_cast<uint32_t>(height < 0 ? -height : height);
+		m_TopDown = height < 0;
+		m_BitsPerPixel = ReadLe16(info + 14);
+		m_Compression = ReadLe32(info + 16);
+		colorsUsed = ReadLe32(info + 32);
+
+		if (m_Compression == kBmpBitFields || m_Compression == kBmpAlphaBitFields)
+		{
+			// BITMAPINFOHEADER之后紧接着3个(或4个)掩码，V2及以上的头部自带掩码
+			size_t maskCount = m_Compression == kBmpAlphaBitFields ? 4 : 3;
+			const uint8_t* masks = info + 40;
+			if (headerSize >= 52)
+				maskCount = headerSize >= 56 ? 4 : 3;
+			else
+			{
+				if (paletteOffset + maskCount * 4 > m_Size)
+					return Fail("truncated header");
+				paletteOffset += maskCount * 4;
+			}
+			for (size_t i = 0; i < maskCount; ++i)
+				m_Masks[i] = ReadLe32(masks + i * 4);
+		}
+	}
+	else
+		return Fail("unsupported header");
+
+	switch (m_Compression)
+	{
+	case kBmpRgb:
+		if (m_BitsPerPixel != 1 && m_BitsPerPixel != 4 && m_BitsPerPixel != 8 && m_BitsPerPixel != 16 &&
+			m_BitsPerPixel != 24 && m_BitsPerPixel != 32)
+			return Fail("unsupported pixel depth");
+		if (m_BitsPerPixel == 16)
+		{
+			m_Masks[0] = 0x7C00;
+			m_Masks[1] = 0x03E0;
+			m_Masks[2] = 0x001F;
+		}
+		else if (m_BitsPerPixel == 32)
+		{
+			m_Masks[0] = 0xFF0000;
+			m_Masks[1] = 0xFF00;
+			m_Masks[2] = 0xFF;
+		}
+		break;
+	case kBmpRle8:
+	case kBmpRle4:
+		if (m_BitsPerPixel != (m_Compression == kBmpRle8 ? 8u : 4u))
+			return Fail("unsupported pixel depth");
+		if (m_TopDown)
+			return Fail("top-down RLE bitmap");
+		break;
+	case kBmpBitFields:
+	case kBmpAlphaBitFields:
+		if (m_BitsPerPixel != 16 && m_BitsPerPixel != 32)
+			return Fail("unsupported pixel depth");
+		break;
+	default:
+		return Fail("unsupported compression");
+	}
+	m_HasAlpha = m_Masks[3] != 0;
+
+	if (m_BitsPerPixel <= 8)
+	{
+		uint32_t maxColors = 1u << m_BitsPerPixel;
+		uint32_t count = colorsUsed && colorsUsed < maxColors ? colorsUsed : maxColors;
+		if (paletteOffset > m_Size || count * entryBytes > m_Size - paletteOffset)
+			return Fail("truncated palette");
+		const uint8_t* entry = m_pData + paletteOffset;
+		for (uint32_t i = 0; i < count; ++i, entry += entryBytes)
+		{
+			m_Palette[i * 4 + 0] = entry[2];
+			m_Palette[i * 4 + 1] = entry[1];
+			m_Palette[i * 4 + 2] = entry[0];
+		}
+	}
+
+	m_DataOffset = ReadLe32(m_pData + 10);
+	if (m_DataOffset > m_Size)
+		return Fail("truncated pixel data");
+	return true;
+}
+
+void ImageReader::ConvertBmpRow(const uint8_t* src, uint8_t* dst) const
+{
+	switch (m_BitsPerPixel)
+	{
+	case 1:
+	case 4:
+	case 8:
+		for (uint32_t x = 0; x < m_Width; ++x)
+			memcpy(dst + x * 4, &m_Palette[ReadPackedSample(src, x, m_BitsPerPixel) * 4], 4);
+		return;
+	case 24:
+		PixelConvert::RgbToRgba(src, dst, m_Width, true);
+		return;
+	default:
+		break;
+	}
+
+	// 最常见的BGRA/BGRX排列直接交换R与B
+	if (m_BitsPerPixel == 32 && m_Masks[0] == 0xFF0000 && m_Masks[1] == 0xFF00 && m_Masks[2] == 0xFF &&
+		(m_Masks[3] == 0 || m_Masks[3] == 0xFF000000))
+	{
+		PixelConvert::SwapRedBlue(src, dst, m_Width);
+		if (!m_Masks[3])
+		{
+			for (uint32_t x = 0; x < m_Width; ++x)
+				dst[x * 4 + 3] = 255;
+		}
+		return;
+	}
+
+	BitField red(m_Masks[0]), green(m_Masks[1]), blue(m_Masks[2]), alpha(m_Masks[3]);
+	uint32_t pixelBytes = m_BitsPerPixel / 8;
+	for (uint32_t x = 0; x < m_Width; ++x, src += pixelBytes, dst += 4)
+	{
+		uint32_t value = pixelBytes == 2 ? ReadLe16(src) : ReadLe32(src);
+		dst[0] = red.Extract(value);
+		dst[1] = green.Extract(value);
+		dst[2] = blue.Extract(value);
+		dst[3] = alpha.mask ? alpha.Extract(value) : 255;
+	}
+}
+
+bool ImageReader::DecodeBmp(uint8_t* destination, size_t rowPitch)
+{
+	const uint8_t* src = m_pData + m_DataOffset;
+	const uint8_t* end = m_pData + m_Size;
+	if (m_Compression != kBmpRle8 && m_Compression != kBmpRle4)
+	{
+		// 每行按4字节对齐
+		size_t stride = ((static_cast<size_t>(m_Width) * m_BitsPerPixel + 31) / 32) * 4;
+		if (static_cast<size_t>(end - src) / stride < m_Height)
+			return Fail("truncated pixel data");
+		for (uint32_t y = 0; y < m_Height; ++y)
+			ConvertBmpRow(src + y * stride, destination + (m_TopDown ? y : m_Height - 1 - y) * rowPitch);
+		return true;
+	}
+
+	// RLE先解码为调色板下标，跳过的像素使用第0项
+	bool rle4 = m_Compression == kBmpRle4;
+	std::vector<uint8_t> indices(static_cast<size_t>(m_Width) * m_Height, 0);
+	size_t x = 0, y = 0;
+	for (;;)
+	{
+		if (end - src < 2)
+			return Fail("truncated pixel data");
+		uint32_t count = src[0], value = src[1];
+		src += 2;
+		if (count)
+		{
+			// 重复: RLE4的两个下标交替出现
+			for (uint32_t i = 0; i < count; ++i, ++x)
+			{
+				if (x < m_Width && y < m_Height)
+					indices[y * m_Width + x] = static_cast<uint8_t>(rle4 ? (i & 1 ? value & 15 : value >> 4) : value);
+			}
+		}
+		else if (value == 0)
+		{
+			x = 0;
+			++y;
+		}
+		else if (value == 1)
+			break;
+		else if (value == 2)
+		{
+			if (end - src < 2)
+				return Fail("truncated pixel data");
+			x += src[0];
+			y += src[1];
+			src += 2;
+		}
+		else
+		{
+			// 不压缩的value个下标，按2字节对齐
+			size_t bytes = rle4 ? (value + 1) / 2 : value;
+			size_t padded = (bytes + 1) & ~static_cast<size_t>(1);
+			if (static_cast<size_t>(end - src) < padded)
+				return Fail("truncated pixel data");
+			for (uint32_t i = 0; i < value; ++i, ++x)
+			{
+				if (x < m_Width && y < m_Height)
+					indices[y * m_Width + x] = static_cast<uint8_t>(rle4 ? ReadPackedSample(src, i, 4) : src[i]);
+			}
+			src += padded;
+		}
+	}
+
+	for (uint32_t row = 0; row < m_Height; ++row)
+	{
+		const uint8_t* index = &indices[static_cast<size_t>(row) * m_Width];
+		uint8_t* dst = destination + (m_Height - 1 - row) * rowPitch;
+		for (uint32_t i = 0; i < m_Width; ++i)
+			memcpy(dst + i * 4, &m_Palette[index[i] * 4], 4);
+	}
+	return true;
+}
+
+//
+// PNG
+//
+
+bool ImageReader::ParsePng()
+{
+	const uint32_t kHeader = MakeChunkType('I', 'H', 'D', 'R');
+	const uint32_t kPalette = MakeChunkType('P', 'L', 'T', 'E');
+	const uint32_t kTransparency = MakeChunkType('t', 'R', 'N', 'S');
+	const uint32_t kSrgb = MakeChunkType('s', 'R', 'G', 'B');
+	const uint32_t kData = MakeChunkType('I', 'D', 'A', 'T');
+	const uint32_t kEnd = MakeChunkType('I', 'E', 'N', 'D');
+
+	bool hasHeader = false, hasPalette = false, hasTransparency = false;
+	for (size_t pos = sizeof(kPngSignature);;)
+	{
+		// 块: 长度 + 类型 + 数据 + CRC，长度与CRC按大端序存放
+		if (m_Size - pos < 12)
+			return Fail("truncated chunk");
+		uint32_t length = ReadBe32(m_pData + pos);
+		uint32_t type = ReadBe32(m_pData + pos + 4);
+		const uint8_t* body = m_pData + pos + 8;
+		if (length > m_Size - pos - 12)
+			return Fail("truncated chunk");
+		if (!hasHeader && type != kHeader)
+			return Fail("missing IHDR");
+
+		// 解析用到的小块校验CRC，IDAT由zlib流的Adler-32校验
+		if ((type == kHeader || type == kPalette || type == kTransparency || type == kSrgb) &&
+			Deflate::Crc32(0, m_pData + pos + 4, length + 4) != ReadBe32(body + length))
+			return Fail("chunk CRC mismatch");
+
+		if (type == kHeader)
+		{
+			if (hasHeader || length != 13)
+				return Fail("invalid IHDR");
+			hasHeader = true;
+			m_Width = ReadBe32(body);
+			m_Height = ReadBe32(body + 4);
+			m_BitDepth = body[8];
+			m_ColorType = body[9];
+			if (body[10] != 0 || body[11] != 0 || body[12] > 1)
+				return Fail("unsupported compression, filter or interlace method");
+			m_Interlaced = body[12] == 1;
+
+			uint32_t channels;
+			bool validDepth;
+			switch (m_ColorType)
+			{
+			case kPngGray:
+				channels = 1;
+				validDepth = m_BitDepth == 1 || m_BitDepth == 2 || m_BitDepth == 4 || m_BitDepth == 8 || m_BitDepth == 16;
+				break;
+			case kPngPalette:
+				channels = 1;
+				validDepth = m_BitDepth == 1 || m_BitDepth == 2 || m_BitDepth == 4 || m_BitDepth == 8;
+				break;
+			case kPngRgb:
+			case kPngGrayAlpha:
+			case kPngRgba:
+				channels = m_ColorType == kPngRgb ? 3 : m_ColorType == kPngGrayAlpha ? 2 : 4;
+				validDepth = m_BitDepth == 8 || m_BitDepth == 16;
+				break;
+			default:
+				return Fail("invalid color type");
+			}
+			if (!validDepth)
+				return Fail("invalid bit depth");
+			m_BitsPerPixel = channels * m_BitDepth;
+		}
+		else if (type == kPalette)
+		{
+			if (length % 3 != 0 || length > 256 * 3)
+				return Fail("invalid PLTE");
+			hasPalette = true;
+			for (uint32_t i = 0; i < length / 3; ++i)
+			{
+				m_Palette[i * 4 + 0] = body[i * 3 + 0];
+				m_Palette[i * 4 + 1] = body[i * 3 + 1];
+				m_Palette[i * 4 + 2] = body[i * 3 + 2];
+			}
+		}
+		else if (type == kTransparency)
+		{
+			// 调色板图像为每项的Alpha，灰度与RGB图像为一个透明色
+			hasTransparency = true;
+			if (m_ColorType == kPngPalette)
+			{
+				if (length > 256)
+					return Fail("invalid tRNS");
+				for (uint32_t i = 0; i < length; ++i)
+					m_Palette[i * 4 + 3] = body[i];
+			}
+			else if (m_ColorType == kPngGray || m_ColorType == kPngRgb)
+			{
+				if (length != (m_ColorType == kPngGray ? 2u : 6u))
+					return Fail("invalid tRNS");
+				m_HasColorKey = true;
+				for (uint32_t i = 0; i < length / 2; ++i)
+					m_ColorKey[i] = static_cast<uint16_t>(ReadBe16(body + i * 2));
+			}
+		}
+		else if (type == kSrgb)
+			m_IsSrgb = true;
+		else if (type == kData)
+			m_DataChunks.push_back({ static_cast<size_t>(body - m_pData), length });
+		else if (type == kEnd)
+			break;
+		else if (!(m_pData[pos + 4] & 0x20))
+			return Fail("unsupported critical chunk");
+
+		pos += 12 + static_cast<size_t>(length);
+	}
+
+	if (m_ColorType == kPngPalette && !hasPalette)
+		return Fail("missing PLTE");
+	if (m_DataChunks.empty())
+		return Fail("missing IDAT");
+	m_HasAlpha = m_ColorType == kPngGrayAlpha || m_ColorType == kPngRgba || m_HasColorKey ||
+		(m_ColorType == kPngPalette && hasTransparency);
+	return true;
+}
+
+void ImageReader::ConvertPngRow(const uint8_t* src, uint8_t* dst, uint32_t width) const
+{
+	switch (m_ColorType)
+	{
+	case kPngGray:
+		for (uint32_t x = 0; x < width; ++x, dst += 4)
+		{
+			uint32_t value;
+			uint8_t gray;
+			if (m_BitDepth == 16)
+			{
+				value = ReadBe16(src + x * 2);
+				gray = Scale16To8(value);
+			}
+			else
+			{
+				value = m_BitDepth == 8 ? src[x] : ReadPackedSample(src, x, m_BitDepth);
+				gray = ScaleTo8(value, m_BitDepth);
+			}
+			dst[0] = dst[1] = dst[2] = gray;
+			dst[3] = m_HasColorKey && value == m_ColorKey[0] ? 0 : 255;
+		}
+		break;
+	case kPngRgb:
+		if (m_BitDepth == 8)
+		{
+			PixelConvert::RgbToRgba(src, dst, width);
+			if (m_HasColorKey)
+			{
+				for (uint32_t x = 0; x < width; ++x)
+				{
+					if (src[x * 3] == m_ColorKey[0] && src[x * 3 + 1] == m_ColorKey[1] && src[x * 3 + 2] == m_ColorKey[2])
+						dst[x * 4 + 3] = 0;
+				}
+			}
+		}
+		else
+		{
+			for (uint32_t x = 0; x < width; ++x, src += 6, dst += 4)
+			{
+				uint32_t r = ReadBe16(src), g = ReadBe16(src + 2), b = ReadBe16(src + 4);
+				dst[0] = Scale16To8(r);
+				dst[1] = Scale16To8(g);
+				dst[2] = Scale16To8(b);
+				dst[3] = m_HasColorKey && r == m_ColorKey[0] && g == m_ColorKey[1] && b == m_ColorKey[2] ? 0 : 255;
+			}
+		}
+		break;
+	case kPngPalette:
+		for (uint32_t x = 0; x < width; ++x)
+		{
+			uint32_t index = m_BitDepth == 8 ? src[x] : ReadPackedSample(src, x, m_BitDepth);
+			memcpy(dst + x * 4, &m_Palette[index * 4], 4);
+		}
+		break;
+	case kPngGrayAlpha:
+		for (uint32_t x = 0; x < width; ++x, dst += 4)
+		{
+			if (m_BitDepth == 8)
+			{
+				dst[0] = dst[1] = dst[2] = src[x * 2];
+				dst[3] = src[x * 2 + 1];
+			}
+			else
+			{
+				dst[0] = dst[1] = dst[2] = Scale16To8(ReadBe16(src + x * 4));
+				dst[3] = Scale16To8(ReadBe16(src + x * 4 + 2));
+			}
+		}
+		break;
+	default:
+		if (m_BitDepth == 8)
+			memcpy(dst, src, static_cast<size_t>(width) * 4);
+		else
+		{
+			for (size_t i = 0; i < static_cast<size_t>(width) * 4; ++i)
+				dst[i] = Scale16To8(ReadBe16(src + i * 2));
+		}
+		break;
+	}
+}
+
+bool ImageReader::DecodePng(uint8_t* destination, size_t rowPitch)
+{
+	// 各pass的每行以1字节的滤波类型开头，计算解压后的总大小
+	const uint32_t (*passes)[4] = m_Interlaced ? kAdam7 : kNoInterlace;
+	uint32_t passCount = m_Interlaced ? 7 : 1;
+	size_t inflatedSize = 0, maxRowBytes = 0;
+	for (uint32_t i = 0; i < passCount; ++i)
+	{
+		// 图像很小时部分pass没有像素
+		if (m_Width <= passes[i][0] || m_Height <= passes[i][1])
+			continue;
+		uint32_t width = (m_Width - passes[i][0] + passes[i][2] - 1) / passes[i][2];
+		uint32_t height = (m_Height - passes[i][1] + passes[i][3] - 1) / passes[i][3];
+		size_t rowBytes = (static_cast<size_t>(width) * m_BitsPerPixel + 7) / 8;
+		inflatedSize += height * (rowBytes + 1);
+		maxRowBytes = (std::max)(maxRowBytes, rowBytes);
+	}
+
+	// 多个IDAT块拼接为一个zlib流，只有一个时直接解压
+	const uint8_t* compressed = m_pData + m_DataChunks[0].offset;
+	size_t compressedSize = m_DataChunks[0].size;
+	std::vector<uint8_t> joined;
+	if (m_DataChunks.size() > 1)
+	{
+		size_t totalSize = 0;
+		for (const Chunk& chunk : m_DataChunks)
+			totalSize += chunk.size;
+		joined.reserve(totalSize);
+		for (const Chunk& chunk : m_DataChunks)
+			joined.insert(joined.end(), m_pData + chunk.offset, m_pData + chunk.offset + chunk.size);
+		compressed = joined.data();
+		compressedSize = joined.size();
+	}
+
+	std::vector<uint8_t> inflated(inflatedSize);
+	size_t written = 0;
+	if (!Deflate::InflateZlib(compressed, compressedSize, inflated.data(), inflated.size(), written) || written != inflatedSize)
+		return Fail("corrupt image data");
+
+	std::vector<uint8_t> zeros(maxRowBytes + 8, 0);
+	std::vector<uint8_t> line(m_Interlaced ? static_cast<size_t>(m_Width) * 4 : 0);
+	size_t filterStride = (std::max)(m_BitsPerPixel / 8, 1u);
+	uint8_t* row = inflated.data();
+	for (uint32_t i = 0; i < passCount; ++i)
+	{
+		if (m_Width <= passes[i][0] || m_Height <= passes[i][1])
+			continue;
+		uint32_t x0 = passes[i][0], y0 = passes[i][1], dx = passes[i][2], dy = passes[i][3];
+		uint32_t width = (m_Width - x0 + dx - 1) / dx;
+		uint32_t height = (m_Height - y0 + dy - 1) / dy;
+		size_t rowBytes = (static_cast<size_t>(width) * m_BitsPerPixel + 7) / 8;
+
+		const uint8_t* prior = zeros.data();
+		for (uint32_t y = 0; y < height; ++y, row += rowBytes + 1)
+		{
+			if (!Unfilter(row[0], row + 1, prior, rowBytes, filterStride))
+				return Fail("invalid filter type");
+			prior = row + 1;
+
+			if (!m_Interlaced)
+			{
+				ConvertPngRow(row + 1, destination + y * rowPitch, width);
+				continue;
+			}
+			ConvertPngRow(row + 1, line.data(), width);
+			uint8_t* dst = destination + (y0 + y * dy) * rowPitch + x0 * 4;
+			for (uint32_t x = 0; x < width; ++x)
+				memcpy(dst + x * dx * 4, &line[x * 4], 4);
+		}
+	}
+	return true;
+}
@@ -0,0 +1,103 @@
+﻿//***************************************************************************************
+// ImageReader.h
+// Licensed under the MIT License.
+//
+// 不依赖WIC的TGA、BMP与PNG解码，使烘焙与纹理缓存可以在没有COM的环境中运行
+// - TGA: 调色板、真彩色与灰度图像，支持RLE压缩与各种原点
+// - BMP: 1/4/8位调色板(包括RLE4/RLE8)、16/24/32位与位域(BITFIELDS)格式
+// - PNG: 所有颜色类型与位深，支持tRNS透明色与Adam7隔行，压缩数据由Deflate解压
+// - Parse只解析文件头，Decode把像素解码为RGBA8直接写入调用者提供的行，不复制输入数据
+// Portable TGA/BMP/PNG decoders that write RGBA8 rows straight into caller-provided
+// memory, so texture import and cooking can run without WIC.
+//***************************************************************************************
+
+#ifndef IMAGEREADER_H
+#define IMAGEREADER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ImageReader
+{
+public:
+	enum class Format
+	{
+		Unknown,
+		Tga,
+		Bmp,
+		Png
+	};
+
+	ImageReader();
+
+	// 解析内存中的图像文件头，data需要在调用Decode之前保持有效
+	// 格式不支持、尺寸超出D3D11的限制或文件头被截断时返回false
+	bool Parse(const uint8_t* data, size_t size);
+	// 上次解析或解码失败的原因
+	const char* GetError() const { return m_Error; }
+
+	Format GetFormat() const { return m_Format; }
+	uint32_t GetWidth() const { return m_Width; }
+	uint32_t GetHeight() const { return m_Height; }
+	// 图像是否带有Alpha(Alpha通道、透明色或带Alpha的调色板)
+	bool HasAlpha() const { return m_HasAlpha; }
+	// PNG带有sRGB块，与WICTextureLoader判断sRGB的方式一致
+	bool IsSrgb() const { return m_IsSrgb; }
+
+	// 按从上到下的顺序把图像解码为RGBA8，destination至少有height行，每行rowPitch字节
+	// 数据损坏或被截断时返回false，此时destination中的内容不确定
+	bool Decode(uint8_t* destination, size_t rowPitch);
+
+	// 按文件头判断格式，无法识别时返回Unknown
+	static Format DetectFormat(const uint8_t* data, size_t size);
+
+private:
+	bool Fail(const char* error);
+
+	bool ParseTga();
+	bool ParseBmp();
+	bool ParsePng();
+	bool DecodeTga(uint8_t* destination, size_t rowPitch);
+	bool DecodeBmp(uint8_t* destination, size_t rowPitch);
+	bool DecodePng(uint8_t* destination, size_t rowPitch);
+
+	// 把一行源像素转换为RGBA8
+	void ConvertTgaRow(const uint8_t* src, uint8_t* dst) const;
+	void ConvertBmpRow(const uint8_t* src, uint8_t* dst) const;
+	void ConvertPngRow(const uint8_t* src, uint8_t* dst, uint32_t width) const;
+
+	// 数据块在输入数据中的位置
+	struct Chunk
+	{
+		size_t offset;
+		size_t size;
+	};
+
+	const uint8_t* m_pData;
+	size_t m_Size;
+	const char* m_Error;
+	Format m_Format;
+	uint32_t m_Width;
+	uint32_t m_Height;
+	bool m_HasAlpha;
+	bool m_IsSrgb;
+
+	uint32_t m_BitsPerPixel;		// 源像素的位数，PNG为一个像素所有通道的位数
+	uint32_t m_Compression;			// TGA的图像类型、BMP的压缩方式
+	bool m_TopDown;					// 源数据的第一行是否为图像的顶部
+	bool m_RightToLeft;				// TGA的行是否从右到左存放
+	size_t m_DataOffset;			// 像素数据的起始位置
+	std::vector<uint8_t> m_Palette;	// 调色板，每项为RGBA8
+
+	uint32_t m_Masks[4];			// BMP位域格式的R、G、B、A掩码
+
+	uint32_t m_ColorType;			// PNG的颜色类型
+	uint32_t m_BitDepth;			// PNG每个通道的位数
+	bool m_Interlaced;				// PNG是否为Adam7隔行
+	bool m_HasColorKey;				// PNG的tRNS块给出的透明色
+	uint16_t m_ColorKey[3];
+	std::vector<Chunk> m_DataChunks;	// PNG的IDAT块
+};
+
+#endif
@@ -0,0 +1,235 @@
+﻿#include "IndexCompression.h"
+#include <cstring>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define INDEXCOMPRESSION_SSSE3 1
+#define INDEXCOMPRESSION_TARGET_SSSE3
+#include <intrin.h>
+#include <tmmintrin.h>
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define INDEXCOMPRESSION_SSSE3 1
+#define INDEXCOMPRESSION_TARGET_SSSE3 __attribute__((target("ssse3")))
+#include <tmmintrin.h>
+#endif
+
+//
+// 编码格式：
+// [控制字节]ceil(索引数/4)字节，每个控制字节的2位对应一个值的字节数减1(低位在前)
+// [数据]每个值1~4字节，小端序
+// 值为ZigZag(当前索引 - 前一个索引)，第一个索引的前一个索引视为0
+//
+
+namespace
+{
+	uint32_t ZigZagEncode(uint32_t delta)
+	{
+		return (delta << 1) ^ static_cast<uint32_t>(static_cast<int32_t>(delta) >> 31);
+	}
+
+	uint32_t ZigZagDecode(uint32_t value)
+	{
+		return (value >> 1) ^ (0u - (value & 1));
+	}
+
+	uint32_t GetByteCount(uint32_t value)
+	{
+		return value < (1u << 8) ? 1 : value < (1u << 16) ? 2 : value < (1u << 24) ? 3 : 4;
+	}
+
+	template<class IndexType>
+	size_t EncodeImpl(uint8_t* buffer, size_t bufferSize, const IndexType* indices, size_t indexCount)
+	{
+		size_t controlSize = (indexCount + 3) / 4;
+		if (bufferSize < controlSize)
+			return 0;
+
+		uint8_t* control = buffer;
+		uint8_t* data = buffer + controlSize;
+		uint8_t* end = buffer + bufferSize;
+		// 没有索引时buffer可以为空指针
+		if (controlSize > 0)
+			memset(control, 0, controlSize);
+
+		uint32_t prev = 0;
+		for (size_t i = 0; i < indexCount; ++i)
+		{
+			uint32_t value = ZigZagEncode(static_cast<uint32_t>(indices[i]) - prev);
+			prev = indices[i];
+
+			uint32_t byteCount = GetByteCount(value);
+			if (static_cast<size_t>(end - data) < byteCount)
+				return 0;
+
+			control[i / 4] |= static_cast<uint8_t>((byteCount - 1) << ((i % 4) * 2));
+			for (uint32_t k = 0; k < byteCount; ++k)
+				*data++ = static_cast<uint8_t>(value >> (k * 8));
+		}
+
+		return static_cast<size_t>(data - buffer);
+	}
+
+	// 从第first个索引开始逐个解码
+	template<class IndexType>
+	bool DecodeScalarImpl(IndexType* destination, size_t first, size_t indexCount,
+		const uint8_t* control, const uint8_t* data, const uint8_t* end, uint32_t prev)
+	{
+		for (size_t i = first; i < indexCount; ++i)
+		{
+			uint32_t byteCount = ((control[i / 4] >> ((i % 4) * 2)) & 3) + 1;
+			if (static_cast<size_t>(end - data) < byteCount)
+				return false;
+
+			uint32_t value = 0;
+			for (uint32_t k = 0; k < byteCount; ++k)
+				value |= static_cast<uint32_t>(data[k]) << (k * 8);
+			data += byteCount;
+
+			prev += ZigZagDecode(value);
+			destination[i] = static_cast<IndexType>(prev);
+		}
+		return true;
+	}
+
+#ifdef INDEXCOMPRESSION_SSSE3
+	// 每种控制字节对应的数据长度以及把数据字节分散到4个32位通道的洗牌掩码
+	struct DecodeTables
+	{
+		DecodeTables()
+		{
+			for (int c = 0; c < 256; ++c)
+			{
+				uint8_t offset = 0;
+				for (int lane = 0; lane < 4; ++lane)
+				{
+					int byteCount = ((c >> (lane * 2)) & 3) + 1;
+					for (int k = 0; k < 4; ++k)
+						shuffle[c][lane * 4 + k] = k < byteCount ? static_cast<uint8_t>(offset + k) : 0x80;
+					offset += static_cast<uint8_t>(byteCount);
+				}
+				length[c] = offset;
+			}
+		}
+
+		alignas(16) uint8_t shuffle[256][16];
+		uint8_t length[256];
+	};
+
+	const DecodeTables& GetDecodeTables()
+	{
+		static const DecodeTables tables;
+		return tables;
+	}
+
+	bool HasSSSE3()
+	{
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 1);
+		return (info[2] & (1 << 9)) != 0;
+#else
+		return __builtin_cpu_supports("ssse3") != 0;
+#endif
+	}
+
+	INDEXCOMPRESSION_TARGET_SSSE3 inline void Store4(uint32_t* destination, __m128i value)
+	{
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(destination), value);
+	}
+
+	INDEXCOMPRESSION_TARGET_SSSE3 inline void Store4(uint16_t* destination, __m128i value)
+	{
+		// 取每个32位通道的低16位
+		const __m128i narrow = _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+		_mm_storel_epi64(reinterpret_cast<__m128i*>(destination), _mm_shuffle_epi8(value, narrow));
+	}
+
+	template<class IndexType>
+	INDEXCOMPRESSION_TARGET_SSSE3 bool DecodeSSSE3(IndexType* destination, size_t indexCount,
+		const uint8_t* control, const uint8_t* data, const uint8_t* end)
+	{
+		const DecodeTables& tables = GetDecodeTables();
+		const __m128i one = _mm_set1_epi32(1);
+		__m128i prev = _mm_setzero_si128();
+
+		// 每组的数据最多16字节，只要剩余数据不少于16字节就可以安全地整体读取
+		size_t groupCount = indexCount / 4;
+		size_t group = 0;
+		for (; group < groupCount && end - data >= 16; ++group)
+		{
+			uint8_t c = control[group];
+			__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+			__m128i value = _mm_shuffle_epi8(bytes, _mm_load_si128(reinterpret_cast<const __m128i*>(tables.shuffle[c])));
+			data += tables.length[c];
+
+			// ZigZag解码
+			value = _mm_xor_si128(_mm_srli_epi32(value, 1), _mm_sub_epi32(_mm_setzero_si128(), _mm_and_si128(value, one)));
+			// 前缀和
+			value = _mm_add_epi32(value, _mm_slli_si128(value, 4));
+			value = _mm_add_epi32(value, _mm_slli_si128(value, 8));
+			value = _mm_add_epi32(value, prev);
+			prev = _mm_shuffle_epi32(value, _MM_SHUFFLE(3, 3, 3, 3));
+
+			Store4(destination + group * 4, value);
+		}
+
+		return DecodeScalarImpl(destination, group * 4, indexCount, control, data, end,
+			static_cast<uint32_t>(_mm_cvtsi128_si32(prev)));
+	}
+#endif
+
+	template<class IndexType>
+	bool DecodeImpl(IndexType* destination, size_t indexCount, const uint8_t* buffer, size_t bufferSize, bool allowSimd)
+	{
+		size_t controlSize = (indexCount + 3) / 4;
+		if (bufferSize < controlSize)
+			return false;
+
+		const uint8_t* control = buffer;
+		const uint8_t* data = buffer + controlSize;
+		const uint8_t* end = buffer + bufferSize;
+
+#ifdef INDEXCOMPRESSION_SSSE3
+		static const bool hasSSSE3 = HasSSSE3();
+		if (allowSimd && hasSSSE3)
+			return DecodeSSSE3(destination, indexCount, control, data, end);
+#else
+		(void)allowSimd;
+#endif
+		return DecodeScalarImpl(destination, 0, indexCount, control, data, end, 0);
+	}
+}
+
+size_t IndexCompression::GetEncodeBound(size_t indexCount)
+{
+	return (indexCount + 3) / 4 + indexCount * 4;
+}
+
+size_t IndexCompression::Encode(uint8_t* buffer, size_t bufferSize, const uint32_t* indices, size_t indexCount)
+{
+	return EncodeImpl(buffer, bufferSize, indices, indexCount);
+}
+
+size_t IndexCompression::Encode(uint8_t* buffer, size_t bufferSize, const uint16_t* indices, size_t indexCount)
+{
+	return EncodeImpl(buffer, bufferSize, indices, indexCount);
+}
+
+bool IndexCompression::Decode(uint32_t* destination, size_t indexCount, const uint8_t* buffer, size_t bufferSize)
+{
+	return DecodeImpl(destination, indexCount, buffer, bufferSize, true);
+}
+
+bool IndexCompression::Decode(uint16_t* destination, size_t indexCount, const uint8_t* buffer, size_t bufferSize)
+{
+	return DecodeImpl(destination, indexCount, buffer, bufferSize, true);
+}
+
+bool IndexCompression::DecodeScalar(uint32_t* destination, size_t indexCount, const uint8_t* buffer, size_t bufferSize)
+{
+	return DecodeImpl(destination, indexCount, buffer, bufferSize, false);
+}
+
+bool IndexCompression::DecodeScalar(uint16_t* destination, size_t indexCount, const uint8_t* buffer, size_t bufferSize)
+{
+	return DecodeImpl(destination, indexCount, buffer, bufferSize, false);
+}
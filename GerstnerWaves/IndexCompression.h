@@ -0,0 +1,42 @@
+﻿//***************************************************************************************
+// IndexCompression.h
+// Licensed under the MIT License.
+//
+// 三角形列表索引的无损压缩：每个索引与前一个索引作差并进行ZigZag编码，
+// 再以每4个数共用1个控制字节的分组变长整数(Stream VByte)存储
+// 经过顶点缓存与顶点读取优化的索引大部分差值都很小，通常只需1个字节
+// 解码可用SSSE3时每次处理4个索引
+// Lossless triangle list index compression: each index is delta coded against the
+// previous one, zigzag encoded and stored as Stream VByte groups (one control byte
+// per four values). Decoding handles four indices at a time with SSSE3.
+//***************************************************************************************
+
+#ifndef INDEXCOMPRESSION_H
+#define INDEXCOMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace IndexCompression
+{
+	// 编码indexCount个索引所需的最大字节数
+	size_t GetEncodeBound(size_t indexCount);
+
+	// 编码索引
+	// [Out]buffer		输出缓冲区，至少需要GetEncodeBound(indexCount)字节
+	// 返回值: 实际写入的字节数，缓冲区不足时返回0
+	size_t Encode(uint8_t* buffer, size_t bufferSize, const uint32_t* indices, size_t indexCount);
+	size_t Encode(uint8_t* buffer, size_t bufferSize, const uint16_t* indices, size_t indexCount);
+
+	// 解码索引，输出与编码前完全一致
+	// 数据不完整或被截断时返回false
+	// 以16位输出时需要保证编码前的索引都不超过65535
+	bool Decode(uint32_t* destination, size_t indexCount, const uint8_t* buffer, size_t bufferSize);
+	bool Decode(uint16_t* destination, size_t indexCount, const uint8_t* buffer, size_t bufferSize);
+
+	// 不使用SIMD的解码，用于验证与对比性能
+	bool DecodeScalar(uint32_t* destination, size_t indexCount, const uint8_t* buffer, size_t bufferSize);
+	bool DecodeScalar(uint16_t* destination, size_t indexCount, const uint8_t* buffer, size_t bufferSize);
+}
+
+#endif
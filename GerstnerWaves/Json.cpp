@@ -0,0 +1,370 @@
+﻿#include "Json.h"
+#include <cstdlib>
+#include <cstring>
+
+class JsonParser
+{
+public:
+	JsonParser(const char* text, size_t length) : m_Cur(text), m_End(text + length), m_Depth() {}
+
+	bool ParseDocument(JsonValue& value)
+	{
+		if (!ParseValue(value))
+			return false;
+		SkipWhitespace();
+		// 文档末尾只允许空白字符
+		return m_Cur == m_End;
+	}
+
+private:
+	// 限制嵌套深度，避免格式错误的文件造成栈溢出
+	static const int kMaxDepth = 256;
+
+	void SkipWhitespace()
+	{
+		while (m_Cur < m_End && (*m_Cur == ' ' || *m_Cur == '\t' || *m_Cur == '\n' || *m_Cur == '\r'))
+			++m_Cur;
+	}
+
+	bool Consume(const char* literal)
+	{
+		size_t length = strlen(literal);
+		if (static_cast<size_t>(m_End - m_Cur) < length || memcmp(m_Cur, literal, length) != 0)
+			return false;
+		m_Cur += length;
+		return true;
+	}
+
+	bool ParseValue(JsonValue& value)
+	{
+		SkipWhitespace();
+		if (m_Cur == m_End)
+			return false;
+
+		switch (*m_Cur)
+		{
+		case 'n': value.m_Type = JsonValue::Type::Null; return Consume("null");
+		case 't': value.m_Type = JsonValue::Type::Bool; value.m_Bool = true; return Consume("true");
+		case 'f': value.m_Type = JsonValue::Type::Bool; value.m_Bool = false; return Consume("false");
+		case '"': value.m_Type = JsonValue::Type::String; return ParseString(value.m_String);
+		case '[': return ParseArray(value);
+		case '{': return ParseObject(value);
+		default: return ParseNumber(value);
+		}
+	}
+
+	bool ParseNumber(JsonValue& value)
+	{
+		// 先按JSON的语法确定数字的范围，再交给strtod转换
+		const char* begin = m_Cur;
+		const char* p = m_Cur;
+		if (p < m_End && *p == '-')
+			++p;
+		const char* digits = p;
+		while (p < m_End && *p >= '0' && *p <= '9')
+			++p;
+		if (p == digits)
+			return false;
+		if (p < m_End && *p == '.')
+		{
+			const char* fraction = ++p;
+			while (p < m_End && *p >= '0' && *p <= '9')
+				++p;
+			if (p == fraction)
+				return false;
+		}
+		if (p < m_End && (*p == 'e' || *p == 'E'))
+		{
+			++p;
+			if (p < m_End && (*p == '+' || *p == '-'))
+				++p;
+			const char* exponent = p;
+			while (p < m_End && *p >= '0' && *p <= '9')
+				++p;
+			if (p == exponent)
+				return false;
+		}
+
+		// 文本不一定以'\0'结尾，复制到临时缓冲区
+		char buffer[64];
+		size_t length = static_cast<size_t>(p - begin);
+		if (length >= sizeof(buffer))
+			return false;
+		memcpy(buffer, begin, length);
+		buffer[length] = '\0';
+
+		value.m_Type = JsonValue::Type::Number;
+		value.m_Number = strtod(buffer, nullptr);
+		m_Cur = p;
+		return true;
+	}
+
+	bool ParseHex4(unsigned& code)
+	{
+		if (m_End - m_Cur < 4)
+			return false;
+		code = 0;
+		for (int i = 0; i < 4; ++i)
+		{
+			char c = *m_Cur++;
+			code <<= 4;
+			if (c >= '0' && c <= '9')
+				code |= c - '0';
+			else if (c >= 'a' && c <= 'f')
+				code |= c - 'a' + 10;
+			else if (c >= 'A' && c <= 'F')
+				code |= c - 'A' + 10;
+			else
+				return false;
+		}
+		return true;
+	}
+
+	static void AppendUtf8(std::string& str, unsigned code)
+	{
+		if (code < 0x80)
+			str += static_cast<char>(code);
+		else if (code < 0x800)
+		{
+			str += static_cast<char>(0xC0 | (code >> 6));
+			str += static_cast<char>(0x80 | (code & 0x3F));
+		}
+		else if (code < 0x10000)
+		{
+			str += static_cast<char>(0xE0 | (code >> 12));
+			str += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+			str += static_cast<char>(0x80 | (code & 0x3F));
+		}
+		else
+		{
+			str += static_cast<char>(0xF0 | (code >> 18));
+			str += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+			str += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+			str += static_cast<char>(0x80 | (code & 0x3F));
+		}
+	}
+
+	bool ParseString(std::string& str)
+	{
+		// 跳过'"'
+		++m_Cur;
+		str.clear();
+		for (;;)
+		{
+			// 连续的普通字符整体追加
+			const char* run = m_Cur;
+			while (m_Cur < m_End && *m_Cur != '"' && *m_Cur != '\\' && static_cast<unsigned char>(*m_Cur) >= 0x20)
+				++m_Cur;
+			str.append(run, m_Cur);
+
+			if (m_Cur == m_End)
+				return false;
+			char c = *m_Cur++;
+			if (c == '"')
+				return true;
+			if (c != '\\' || m_Cur == m_End)
+				return false;
+
+			// 转义字符
+			c = *m_Cur++;
+			switch (c)
+			{
+			case '"': str += '"'; break;
+			case '\\': str += '\\'; break;
+			case '/': str += '/'; break;
+			case 'b': str += '\b'; break;
+			case 'f': str += '\f'; break;
+			case 'n': str += '\n'; break;
+			case 'r': str += '\r'; break;
+			case 't': str += '\t'; break;
+			case 'u':
+			{
+				unsigned code;
+				if (!ParseHex4(code))
+					return false;
+				// UTF-16代理对
+				if (code >= 0xD800 && code < 0xDC00)
+				{
+					unsigned low;
+					if (!Consume("\\u") || !ParseHex4(low) || low < 0xDC00 || low >= 0xE000)
+						return false;
+					code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+				}
+				else if (code >= 0xDC00 && code < 0xE000)
+				{
+					return false;
+				}
+				AppendUtf8(str, code);
+				break;
+			}
+			default:
+				return false;
+			}
+		}
+	}
+
+	bool ParseArray(JsonValue& value)
+	{
+		if (++m_Depth > kMaxDepth)
+			return false;
+		// 跳过'['
+		++m_Cur;
+		value.m_Type = JsonValue::Type::Array;
+		SkipWhitespace();
+		if (m_Cur < m_End && *m_Cur == ']')
+		{
+			++m_Cur;
+			--m_Depth;
+			return true;
+		}
+
+		for (;;)
+		{
+			value.m_Elements.emplace_back();
+			if (!ParseValue(value.m_Elements.back()))
+				return false;
+			SkipWhitespace();
+			if (m_Cur == m_End)
+				return false;
+			char c = *m_Cur++;
+			if (c == ']')
+				break;
+			if (c != ',')
+				return false;
+		}
+		--m_Depth;
+		return true;
+	}
+
+	bool ParseObject(JsonValue& value)
+	{
+		if (++m_Depth > kMaxDepth)
+			return false;
+		// 跳过'{'
+		++m_Cur;
+		value.m_Type = JsonValue::Type::Object;
+		SkipWhitespace();
+		if (m_Cur < m_End && *m_Cur == '}')
+		{
+			++m_Cur;
+			--m_Depth;
+			return true;
+		}
+
+		for (;;)
+		{
+			SkipWhitespace();
+			if (m_Cur == m_End || *m_Cur != '"')
+				return false;
+			value.m_Members.emplace_back();
+			auto& member = value.m_Members.back();
+			if (!ParseString(member.first))
+				return false;
+			SkipWhitespace();
+			if (m_Cur == m_End || *m_Cur++ != ':')
+				return false;
+			if (!ParseValue(member.second))
+				return false;
+			SkipWhitespace();
+			if (m_Cur == m_End)
+				return false;
+			char c = *m_Cur++;
+			if (c == '}')
+				break;
+			if (c != ',')
+				return false;
+		}
+		--m_Depth;
+		return true;
+	}
+
+	const char* m_Cur;
+	const char* m_End;
+	int m_Depth;
+};
+
+namespace
+{
+	const JsonValue& GetNullValue()
+	{
+		static const JsonValue nullValue;
+		return nullValue;
+	}
+
+	const std::string& GetEmptyString()
+	{
+		static const std::string emptyString;
+		return emptyString;
+	}
+}
+
+bool JsonValue::Parse(const char* text, size_t length, JsonValue& value)
+{
+	value = JsonValue();
+	// 跳过UTF-8 BOM
+	if (length >= 3 && memcmp(text, "\xEF\xBB\xBF", 3) == 0)
+	{
+		text += 3;
+		length -= 3;
+	}
+
+	JsonParser parser(text, length);
+	if (!parser.ParseDocument(value))
+	{
+		value = JsonValue();
+		return false;
+	}
+	return true;
+}
+
+bool JsonValue::GetBool(bool defaultValue) const
+{
+	return m_Type == Type::Bool ? m_Bool : defaultValue;
+}
+
+double JsonValue::GetNumber(double defaultValue) const
+{
+	return m_Type == Type::Number ? m_Number : defaultValue;
+}
+
+const std::string& JsonValue::GetString() const
+{
+	return m_Type == Type::String ? m_String : GetEmptyString();
+}
+
+size_t JsonValue::GetSize() const
+{
+	if (m_Type == Type::Array)
+		return m_Elements.size();
+	if (m_Type == Type::Object)
+		return m_Members.size();
+	return 0;
+}
+
+const JsonValue& JsonValue::operator[](size_t index) const
+{
+	if (m_Type != Type::Array || index >= m_Elements.size())
+		return GetNullValue();
+	return m_Elements[index];
+}
+
+const JsonValue& JsonValue::operator[](const char* key) const
+{
+	// glTF中的对象成员很少，线性查找即可
+	for (const auto& member : m_Members)
+	{
+		if (member.first == key)
+			return member.second;
+	}
+	return GetNullValue();
+}
+
+bool JsonValue::HasMember(const char* key) const
+{
+	for (const auto& member : m_Members)
+	{
+		if (member.first == key)
+			return true;
+	}
+	return false;
+}
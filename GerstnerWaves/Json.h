@@ -0,0 +1,62 @@
+﻿//***************************************************************************************
+// Json.h
+// Licensed under the MIT License.
+//
+// 只读的小型JSON解析器，用于读取glTF等资源的描述信息
+// 字符串保持UTF-8编码，对象成员保持文件中的顺序
+// A small read-only JSON parser for asset descriptions such as glTF.
+//***************************************************************************************
+
+#ifndef JSON_H
+#define JSON_H
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+class JsonValue
+{
+public:
+	enum class Type { Null, Bool, Number, String, Array, Object };
+
+	JsonValue() : m_Type(Type::Null), m_Bool(), m_Number() {}
+
+	// 解析UTF-8编码的JSON文本，文本格式错误时返回false
+	static bool Parse(const char* text, size_t length, JsonValue& value);
+
+	Type GetType() const { return m_Type; }
+	bool IsNull() const { return m_Type == Type::Null; }
+	bool IsBool() const { return m_Type == Type::Bool; }
+	bool IsNumber() const { return m_Type == Type::Number; }
+	bool IsString() const { return m_Type == Type::String; }
+	bool IsArray() const { return m_Type == Type::Array; }
+	bool IsObject() const { return m_Type == Type::Object; }
+
+	// 类型不匹配时返回默认值
+	bool GetBool(bool defaultValue = false) const;
+	double GetNumber(double defaultValue = 0.0) const;
+	// 类型不匹配时返回空字符串
+	const std::string& GetString() const;
+
+	// 数组的元素数目或对象的成员数目
+	size_t GetSize() const;
+	// 获取数组元素，越界或不是数组时返回null值
+	const JsonValue& operator[](size_t index) const;
+	// 获取对象成员，不存在或不是对象时返回null值
+	const JsonValue& operator[](const char* key) const;
+	bool HasMember(const char* key) const;
+	const std::vector<std::pair<std::string, JsonValue>>& GetMembers() const { return m_Members; }
+
+private:
+	friend class JsonParser;
+
+	Type m_Type;
+	bool m_Bool;
+	double m_Number;
+	std::string m_String;
+	std::vector<JsonValue> m_Elements;
+	std::vector<std::pair<std::string, JsonValue>> m_Members;
+};
+
+#endif
@@ -0,0 +1,324 @@
+﻿#include "LzCompression.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cstring>
+
+//
+// 块格式：
+// 每个序列以标记字节开头，高4位为字面量长度，低4位为匹配长度减4
+// 长度为15时后面跟随扩展字节，每个扩展字节的值累加到长度上，直到遇到小于255的字节
+// [标记字节][字面量长度扩展][字面量][偏移]2字节(小端序，1~65535)[匹配长度扩展]
+// 最后一个序列只有字面量，没有偏移与匹配
+//
+
+namespace
+{
+	const size_t kMinMatch = 4;
+	// 最后的若干字节总是作为字面量输出，使匹配查找可以一次读取4字节而不越界
+	const size_t kLastLiterals = 5;
+	const size_t kMatchSearchLimit = 12;
+	const size_t kMaxOffset = 65535;
+	const int kHashLog = 14;
+	// 连续查找失败时逐渐增大步长，快速跳过不可压缩的数据
+	const int kSkipTrigger = 6;
+
+	uint32_t Read32(const uint8_t* p)
+	{
+		uint32_t value;
+		memcpy(&value, p, sizeof(value));
+		return value;
+	}
+
+	uint32_t Hash(uint32_t value)
+	{
+		return (value * 2654435761u) >> (32 - kHashLog);
+	}
+
+	uint8_t* WriteLength(uint8_t* out, size_t length)
+	{
+		while (length >= 255)
+		{
+			*out++ = 255;
+			length -= 255;
+		}
+		*out++ = static_cast<uint8_t>(length);
+		return out;
+	}
+
+	// 读取长度扩展字节，越界时返回false
+	bool ReadLength(const uint8_t*& in, const uint8_t* end, size_t& length)
+	{
+		uint8_t byte;
+		do
+		{
+			if (in == end)
+				return false;
+			byte = *in++;
+			length += byte;
+		} while (byte == 255);
+		return true;
+	}
+
+	// 输出一个序列，matchLength为0时只输出字面量
+	uint8_t* WriteSequence(uint8_t* out, const uint8_t* literals, size_t literalLength, size_t offset, size_t matchLength)
+	{
+		uint8_t* token = out++;
+		*token = static_cast<uint8_t>((literalLength >= 15 ? 15 : literalLength) << 4);
+		if (literalLength >= 15)
+			out = WriteLength(out, literalLength - 15);
+		memcpy(out, literals, literalLength);
+		out += literalLength;
+
+		if (matchLength > 0)
+		{
+			*out++ = static_cast<uint8_t>(offset);
+			*out++ = static_cast<uint8_t>(offset >> 8);
+			size_t length = matchLength - kMinMatch;
+			*token |= static_cast<uint8_t>(length >= 15 ? 15 : length);
+			if (length >= 15)
+				out = WriteLength(out, length - 15);
+		}
+		return out;
+	}
+}
+
+size_t LzCompression::GetCompressBound(size_t size)
+{
+	// 最坏情况下全部为字面量，每255字节多出1个长度扩展字节
+	return size + size / 255 + 16;
+}
+
+size_t LzCompression::Compress(uint8_t* buffer, size_t bufferSize, const uint8_t* source, size_t size)
+{
+	if (bufferSize < GetCompressBound(size))
+		return 0;
+
+	uint8_t* out = buffer;
+	size_t anchor = 0;
+
+	if (size > kMatchSearchLimit)
+	{
+		// 哈希表存放最近一次出现某4字节序列的位置
+		uint32_t hashTable[1 << kHashLog] = {};
+		const size_t matchStartLimit = size - kMatchSearchLimit;
+		const size_t matchEndLimit = size - kLastLiterals;
+
+		size_t pos = 1;
+		hashTable[Hash(Read32(source))] = 0;
+		unsigned searchCount = 1u << kSkipTrigger;
+		while (pos < matchStartLimit)
+		{
+			uint32_t sequence = Read32(source + pos);
+			uint32_t& slot = hashTable[Hash(sequence)];
+			size_t candidate = slot;
+			slot = static_cast<uint32_t>(pos);
+
+			if (candidate >= pos || pos - candidate > kMaxOffset || Read32(source + candidate) != sequence)
+			{
+				pos += searchCount++ >> kSkipTrigger;
+				continue;
+			}
+
+			// 向前扩展匹配
+			while (pos > anchor && candidate > 0 && source[pos - 1] == source[candidate - 1])
+			{
+				--pos;
+				--candidate;
+			}
+
+			// 向后扩展匹配，每次比较8字节
+			size_t length = kMinMatch;
+			while (pos + length + 8 <= matchEndLimit)
+			{
+				uint64_t a, b;
+				memcpy(&a, source + pos + length, 8);
+				memcpy(&b, source + candidate + length, 8);
+				if (a != b)
+					break;
+				length += 8;
+			}
+			while (pos + length < matchEndLimit && source[pos + length] == source[candidate + length])
+				++length;
+
+			out = WriteSequence(out, source + anchor, pos - anchor, pos - candidate, length);
+			pos += length;
+			anchor = pos;
+			searchCount = 1u << kSkipTrigger;
+
+			// 匹配内部的位置也加入哈希表，提高后续匹配的概率
+			if (pos - 2 < matchStartLimit)
+				hashTable[Hash(Read32(source + pos - 2))] = static_cast<uint32_t>(pos - 2);
+		}
+	}
+
+	out = WriteSequence(out, source + anchor, size - anchor, 0, 0);
+	return static_cast<size_t>(out - buffer);
+}
+
+bool LzCompression::Decompress(uint8_t* destination, size_t size, const uint8_t* buffer, size_t bufferSize)
+{
+	const uint8_t* in = buffer;
+	const uint8_t* inEnd = buffer + bufferSize;
+	uint8_t* out = destination;
+	uint8_t* outEnd = destination + size;
+
+	for (;;)
+	{
+		if (in == inEnd)
+			return false;
+		uint8_t token = *in++;
+
+		// [字面量]
+		size_t literalLength = token >> 4;
+		if (literalLength == 15 && !ReadLength(in, inEnd, literalLength))
+			return false;
+		if (literalLength > static_cast<size_t>(inEnd - in) || literalLength > static_cast<size_t>(outEnd - out))
+			return false;
+		// 短字面量在两侧都有余量时以固定的16字节复制
+		if (literalLength <= 16 && inEnd - in >= 16 && outEnd - out >= 16)
+			memcpy(out, in, 16);
+		else
+			memcpy(out, in, literalLength);
+		in += literalLength;
+		out += literalLength;
+
+		// 最后一个序列
+		if (in == inEnd)
+			return out == outEnd;
+
+		// [偏移]
+		if (inEnd - in < 2)
+			return false;
+		size_t offset = in[0] | (in[1] << 8);
+		in += 2;
+		if (offset == 0 || offset > static_cast<size_t>(out - destination))
+			return false;
+
+		// [匹配]
+		size_t matchLength = token & 15;
+		if (matchLength == 15 && !ReadLength(in, inEnd, matchLength))
+			return false;
+		matchLength += kMinMatch;
+		if (matchLength > static_cast<size_t>(outEnd - out))
+			return false;
+
+		const uint8_t* match = out - offset;
+		if (offset >= 8 && static_cast<size_t>(outEnd - out) >= matchLength + 8)
+		{
+			// 源与目标相距至少8字节，每次复制8字节，末尾多写的部分会被后续数据覆盖
+			uint8_t* copyEnd = out + matchLength;
+			do
+			{
+				memcpy(out, match, 8);
+				out += 8;
+				match += 8;
+			} while (out < copyEnd);
+			out = copyEnd;
+		}
+		else
+		{
+			// 重叠的复制需要逐字节进行，以重复最近的数据
+			for (size_t i = 0; i < matchLength; ++i)
+				out[i] = match[i];
+			out += matchLength;
+		}
+	}
+}
+
+std::vector<uint8_t> LzCompression::CompressBlocks(const uint8_t* source, size_t size, size_t blockSize, ThreadPool* pool)
+{
+	blockSize = (std::max)(blockSize, static_cast<size_t>(1));
+	size_t blockCount = (size + blockSize - 1) / blockSize;
+
+	// 各块先压缩到独立的缓冲区，再按顺序拼接
+	std::vector<std::vector<uint8_t>> blocks(blockCount);
+	auto compressBlock = [&](size_t i)
+	{
+		size_t offset = i * blockSize;
+		size_t rawSize = (std::min)(blockSize, size - offset);
+		std::vector<uint8_t>& block = blocks[i];
+		block.resize(GetCompressBound(rawSize));
+		size_t compressedSize = Compress(block.data(), block.size(), source + offset, rawSize);
+		// 无法压缩的块直接存储
+		if (compressedSize == 0 || compressedSize >= rawSize)
+			block.assign(source + offset, source + offset + rawSize);
+		else
+			block.resize(compressedSize);
+	};
+	if (pool)
+		pool->ParallelFor(blockCount, compressBlock);
+	else
+		for (size_t i = 0; i < blockCount; ++i)
+			compressBlock(i);
+
+	size_t totalSize = 8 + blockCount * 4;
+	for (const auto& block : blocks)
+		totalSize += block.size();
+
+	std::vector<uint8_t> result(totalSize);
+	uint8_t* out = result.data();
+	uint32_t header[2] = { static_cast<uint32_t>(blockSize), static_cast<uint32_t>(blockCount) };
+	// [块大小]4字节 [块数目]4字节
+	memcpy(out, header, sizeof(header));
+	out += sizeof(header);
+	// [每块压缩后的字节数]
+	for (const auto& block : blocks)
+	{
+		uint32_t blockBytes = static_cast<uint32_t>(block.size());
+		memcpy(out, &blockBytes, sizeof(uint32_t));
+		out += sizeof(uint32_t);
+	}
+	// [块数据]
+	for (const auto& block : blocks)
+	{
+		memcpy(out, block.data(), block.size());
+		out += block.size();
+	}
+	return result;
+}
+
+bool LzCompression::DecompressBlocks(uint8_t* destination, size_t size, const uint8_t* buffer, size_t bufferSize,
+	ThreadPool* pool)
+{
+	uint32_t header[2];
+	if (bufferSize < sizeof(header))
+		return false;
+	memcpy(header, buffer, sizeof(header));
+	size_t blockSize = header[0], blockCount = header[1];
+	if (blockSize == 0 || blockCount != (size + blockSize - 1) / blockSize ||
+		(bufferSize - sizeof(header)) / sizeof(uint32_t) < blockCount)
+		return false;
+
+	// 先计算每个块的起始位置并检查范围
+	const uint8_t* sizes = buffer + sizeof(header);
+	std::vector<size_t> offsets(blockCount + 1);
+	offsets[0] = sizeof(header) + blockCount * sizeof(uint32_t);
+	for (size_t i = 0; i < blockCount; ++i)
+	{
+		uint32_t blockBytes;
+		memcpy(&blockBytes, sizes + i * sizeof(uint32_t), sizeof(uint32_t));
+		if (blockBytes > bufferSize - offsets[i])
+			return false;
+		offsets[i + 1] = offsets[i] + blockBytes;
+	}
+
+	// 各块的输出区域互不重叠，可以并行地直接写入目标缓冲区
+	std::vector<uint8_t> blockStatus(blockCount, 1);
+	auto decompressBlock = [&](size_t i)
+	{
+		size_t offset = i * blockSize;
+		size_t rawSize = (std::min)(blockSize, size - offset);
+		size_t blockBytes = offsets[i + 1] - offsets[i];
+		if (blockBytes == rawSize)
+			memcpy(destination + offset, buffer + offsets[i], rawSize);
+		else
+			blockStatus[i] = Decompress(destination + offset, rawSize, buffer + offsets[i], blockBytes);
+	};
+	if (pool)
+		pool->ParallelFor(blockCount, decompressBlock);
+	else
+		for (size_t i = 0; i < blockCount; ++i)
+			decompressBlock(i);
+
+	return std::find(blockStatus.begin(), blockStatus.end(), 0) == blockStatus.end();
+}
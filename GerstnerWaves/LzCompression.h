@@ -0,0 +1,60 @@
+﻿//***************************************************************************************
+// LzCompression.h
+// Licensed under the MIT License.
+//
+// 面向字节的LZ77压缩(与LZ4的块格式类似)，解压速度优先
+// - 单个块: 由若干序列组成，每个序列为[标记字节][字面量][偏移][匹配长度扩展]
+// - 分块流: 数据按固定大小(默认128KiB)分块后独立压缩，解压时各块可以并行地直接写入目标缓冲区
+// Byte-oriented LZ77 compressor in the spirit of LZ4, tuned for decompression speed.
+// Data is split into independently compressed blocks that can be decompressed in
+// parallel straight into the destination buffer.
+//***************************************************************************************
+
+#ifndef LZCOMPRESSION_H
+#define LZCOMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+namespace LzCompression
+{
+	// 默认的分块大小
+	const size_t kDefaultBlockSize = 128 * 1024;
+
+	//
+	// 单个块
+	//
+
+	// 压缩size字节所需的最大字节数
+	size_t GetCompressBound(size_t size);
+
+	// 压缩一个块
+	// [Out]buffer		输出缓冲区，至少需要GetCompressBound(size)字节
+	// 返回值: 实际写入的字节数，缓冲区不足时返回0
+	size_t Compress(uint8_t* buffer, size_t bufferSize, const uint8_t* source, size_t size);
+
+	// 解压一个块，解压出的字节数必须恰好为size
+	// 数据损坏或被截断时返回false，不会越界读写
+	bool Decompress(uint8_t* destination, size_t size, const uint8_t* buffer, size_t bufferSize);
+
+	//
+	// 分块流
+	// [块大小]4字节
+	// [块数目]4字节
+	// [每块压缩后的字节数]4*块数目 字节，等于块的原始大小时表示该块未压缩
+	// [块数据]
+	//
+
+	// 分块压缩，pool不为nullptr时并行压缩各块
+	std::vector<uint8_t> CompressBlocks(const uint8_t* source, size_t size,
+		size_t blockSize = kDefaultBlockSize, ThreadPool* pool = nullptr);
+
+	// 分块解压到destination，size为原始大小，pool不为nullptr时并行解压各块
+	bool DecompressBlocks(uint8_t* destination, size_t size, const uint8_t* buffer, size_t bufferSize,
+		ThreadPool* pool = nullptr);
+}
+
+#endif
@@ -0,0 +1,137 @@
+﻿#include "MappedFile.h"
+#include <utility>
+#ifndef _WIN32
+#include <filesystem>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+	Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept
+	: MappedFile()
+{
+	*this = std::move(other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept
+{
+	if (this != &other)
+	{
+		Close();
+#ifdef _WIN32
+		std::swap(m_hFile, other.m_hFile);
+		std::swap(m_hMapping, other.m_hMapping);
+#endif
+		std::swap(m_pData, other.m_pData);
+		std::swap(m_Size, other.m_Size);
+	}
+	return *this;
+}
+
+#ifdef _WIN32
+
+bool MappedFile::Open(const wchar_t* fileName)
+{
+	Close();
+
+	m_hFile = CreateFileW(fileName, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	// 空文件无法创建映射
+	if (!GetFileSizeEx(m_hFile, &fileSize) || fileSize.QuadPart == 0 ||
+		static_cast<ULONGLONG>(fileSize.QuadPart) > static_cast<ULONGLONG>(SIZE_MAX))
+	{
+		Close();
+		return false;
+	}
+
+	m_hMapping = CreateFileMappingW(m_hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!m_hMapping)
+	{
+		Close();
+		return false;
+	}
+
+	m_pData = static_cast<const uint8_t*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0));
+	if (!m_pData)
+	{
+		Close();
+		return false;
+	}
+	m_Size = static_cast<size_t>(fileSize.QuadPart);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_pData)
+		UnmapViewOfFile(m_pData);
+	if (m_hMapping)
+		CloseHandle(m_hMapping);
+	if (m_hFile != INVALID_HANDLE_VALUE)
+		CloseHandle(m_hFile);
+
+	m_hFile = INVALID_HANDLE_VALUE;
+	m_hMapping = nullptr;
+	m_pData = nullptr;
+	m_Size = 0;
+}
+
+#else
+
+bool MappedFile::Open(const wchar_t* fileName)
+{
+	Close();
+
+	std::string path;
+	try
+	{
+		path = std::filesystem::path(fileName).string();
+	}
+	catch (const std::exception&)
+	{
+		return false;
+	}
+
+	int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+
+	// 空文件无法创建映射，映射建立后即可关闭文件
+	struct stat fileStat;
+	void* pData = MAP_FAILED;
+	if (fstat(fd, &fileStat) == 0 && S_ISREG(fileStat.st_mode) && fileStat.st_size > 0 &&
+		static_cast<uint64_t>(fileStat.st_size) <= static_cast<uint64_t>(SIZE_MAX))
+	{
+		pData = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	close(fd);
+	if (pData == MAP_FAILED)
+		return false;
+
+	// 与FILE_FLAG_SEQUENTIAL_SCAN相同，提示内核预读
+	madvise(pData, static_cast<size_t>(fileStat.st_size), MADV_SEQUENTIAL);
+	m_pData = static_cast<const uint8_t*>(pData);
+	m_Size = static_cast<size_t>(fileStat.st_size);
+	return true;
+}
+
+void MappedFile::Close()
+{
+	if (m_pData)
+		munmap(const_cast<uint8_t*>(m_pData), m_Size);
+
+	m_pData = nullptr;
+	m_Size = 0;
+}
+
+#endif
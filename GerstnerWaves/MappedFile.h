@@ -0,0 +1,54 @@
+﻿//***************************************************************************************
+// MappedFile.h
+// Licensed under the MIT License.
+//
+// 只读的内存映射文件，用于零拷贝地访问二进制资源
+// Windows下使用CreateFileMapping/MapViewOfFile，其他平台使用mmap
+// Read-only memory-mapped file for zero-copy access to binary assets.
+//***************************************************************************************
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+#include <cstddef>
+#include <cstdint>
+
+class MappedFile
+{
+public:
+#ifdef _WIN32
+	MappedFile() : m_hFile(INVALID_HANDLE_VALUE), m_hMapping(), m_pData(), m_Size() {}
+#else
+	MappedFile() : m_pData(), m_Size() {}
+#endif
+	~MappedFile();
+
+	// 不允许拷贝，允许移动
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	MappedFile(MappedFile&& other) noexcept;
+	MappedFile& operator=(MappedFile&& other) noexcept;
+
+	// 映射整个文件，之前映射的文件会被关闭
+	// 非Windows平台上文件名转换为UTF-8
+	bool Open(const wchar_t* fileName);
+	void Close();
+
+	bool IsOpen() const { return m_pData != nullptr; }
+	// 文件内容在Close之前一直有效
+	const uint8_t* GetData() const { return m_pData; }
+	size_t GetSize() const { return m_Size; }
+
+private:
+#ifdef _WIN32
+	HANDLE m_hFile;
+	HANDLE m_hMapping;
+#endif
+	const uint8_t* m_pData;
+	size_t m_Size;
+};
+
+#endif
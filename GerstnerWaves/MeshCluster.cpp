@@ -0,0 +1,318 @@
+﻿#include "MeshCluster.h"
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+
+namespace
+{
+	struct Vector3
+	{
+		float x, y, z;
+	};
+
+	Vector3 operator-(const Vector3& lhs, const Vector3& rhs)
+	{
+		return Vector3{ lhs.x - rhs.x, lhs.y - rhs.y, lhs.z - rhs.z };
+	}
+
+	Vector3 Cross(const Vector3& lhs, const Vector3& rhs)
+	{
+		return Vector3{ lhs.y * rhs.z - lhs.z * rhs.y, lhs.z * rhs.x - lhs.x * rhs.z, lhs.x * rhs.y - lhs.y * rhs.x };
+	}
+
+	float Dot(const Vector3& lhs, const Vector3& rhs)
+	{
+		return lhs.x * rhs.x + lhs.y * rhs.y + lhs.z * rhs.z;
+	}
+
+	float Normalize(Vector3& v)
+	{
+		float length = sqrtf(Dot(v, v));
+		if (length > 0.0f)
+		{
+			v.x /= length;
+			v.y /= length;
+			v.z /= length;
+		}
+		return length;
+	}
+
+	Vector3 LoadPosition(const float* positions, size_t positionStride, uint32_t index)
+	{
+		const float* p = reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + index * positionStride);
+		return Vector3{ p[0], p[1], p[2] };
+	}
+
+	// 使用Ritter算法计算近似最小包围球
+	void ComputeBoundingSphere(const std::vector<Vector3>& points, Vector3& center, float& radius)
+	{
+		// 从任意点出发找到最远点a，再从a找到最远点b，以ab为直径作为初始包围球
+		auto farthest = [&points](const Vector3& from) {
+			size_t best = 0;
+			float bestDist = -1.0f;
+			for (size_t i = 0; i < points.size(); ++i)
+			{
+				Vector3 d = points[i] - from;
+				float dist = Dot(d, d);
+				if (dist > bestDist)
+				{
+					bestDist = dist;
+					best = i;
+				}
+			}
+			return points[best];
+		};
+
+		Vector3 a = farthest(points[0]);
+		Vector3 b = farthest(a);
+		center = Vector3{ (a.x + b.x) * 0.5f, (a.y + b.y) * 0.5f, (a.z + b.z) * 0.5f };
+		Vector3 ab = b - a;
+		radius = sqrtf(Dot(ab, ab)) * 0.5f;
+
+		// 扩张包围球使其包含所有点
+		for (const Vector3& p : points)
+		{
+			Vector3 d = p - center;
+			float dist = sqrtf(Dot(d, d));
+			if (dist > radius)
+			{
+				float newRadius = (radius + dist) * 0.5f;
+				float k = (newRadius - radius) / dist;
+				center.x += d.x * k;
+				center.y += d.y * k;
+				center.z += d.z * k;
+				radius = newRadius;
+			}
+		}
+	}
+
+	void ComputeClusterBounds(MeshCluster::Cluster& cluster, const uint32_t* indices,
+		const float* positions, size_t positionStride, std::vector<Vector3>& scratch)
+	{
+		scratch.clear();
+		Vector3 minV = { FLT_MAX, FLT_MAX, FLT_MAX }, maxV = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (uint32_t i = 0; i < cluster.indexCount; ++i)
+		{
+			Vector3 p = LoadPosition(positions, positionStride, indices[cluster.startIndex + i]);
+			scratch.push_back(p);
+			minV = Vector3{ (std::min)(minV.x, p.x), (std::min)(minV.y, p.y), (std::min)(minV.z, p.z) };
+			maxV = Vector3{ (std::max)(maxV.x, p.x), (std::max)(maxV.y, p.y), (std::max)(maxV.z, p.z) };
+		}
+
+		cluster.aabbMin[0] = minV.x, cluster.aabbMin[1] = minV.y, cluster.aabbMin[2] = minV.z;
+		cluster.aabbMax[0] = maxV.x, cluster.aabbMax[1] = maxV.y, cluster.aabbMax[2] = maxV.z;
+
+		Vector3 center;
+		ComputeBoundingSphere(scratch, center, cluster.radius);
+		cluster.center[0] = center.x, cluster.center[1] = center.y, cluster.center[2] = center.z;
+
+		//
+		// 法线锥：轴向为平均法线，张角由与轴向夹角最大的法线决定
+		//
+		std::vector<Vector3> normals;
+		normals.reserve(cluster.indexCount / 3);
+		Vector3 axis = {};
+		for (size_t i = 0; i < scratch.size(); i += 3)
+		{
+			Vector3 n = Cross(scratch[i + 1] - scratch[i], scratch[i + 2] - scratch[i]);
+			if (Normalize(n) == 0.0f)
+				continue;
+			normals.push_back(n);
+			axis = Vector3{ axis.x + n.x, axis.y + n.y, axis.z + n.z };
+		}
+		Normalize(axis);
+
+		float minDot = 1.0f;
+		for (const Vector3& n : normals)
+			minDot = (std::min)(minDot, Dot(n, axis));
+
+		cluster.coneAxis[0] = axis.x, cluster.coneAxis[1] = axis.y, cluster.coneAxis[2] = axis.z;
+		cluster.coneApex[0] = center.x, cluster.coneApex[1] = center.y, cluster.coneApex[2] = center.z;
+
+		// 张角接近或超过90度的簇无法进行背面裁剪
+		if (normals.empty() || minDot <= 0.1f)
+		{
+			cluster.coneCutoff = 2.0f;
+			return;
+		}
+
+		// 将锥顶沿轴向后移，使其位于所有三角形平面的背面
+		float maxT = 0.0f;
+		size_t n = 0;
+		for (size_t i = 0; i < scratch.size(); i += 3)
+		{
+			Vector3 normal = Cross(scratch[i + 1] - scratch[i], scratch[i + 2] - scratch[i]);
+			if (Normalize(normal) == 0.0f)
+				continue;
+			float dc = Dot(center - scratch[i], normal);
+			float dn = Dot(axis, normal);
+			maxT = (std::max)(maxT, dc / dn);
+			n++;
+		}
+		assert(n == normals.size());
+
+		cluster.coneApex[0] = center.x - axis.x * maxT;
+		cluster.coneApex[1] = center.y - axis.y * maxT;
+		cluster.coneApex[2] = center.z - axis.z * maxT;
+		// cutoff = sin(张角)
+		cluster.coneCutoff = sqrtf(1.0f - minDot * minDot);
+	}
+}
+
+std::vector<MeshCluster::Cluster> MeshCluster::BuildClusters(uint32_t* destination, const uint32_t* indices, size_t indexCount,
+	const float* positions, size_t vertexCount, size_t positionStride, size_t maxVertices, size_t maxTriangles)
+{
+	assert(destination != indices);
+	assert(indexCount % 3 == 0);
+	assert(maxVertices >= 3 && maxTriangles >= 1);
+
+	std::vector<Cluster> clusters;
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return clusters;
+
+	// 顶点到三角形的邻接表
+	std::vector<uint32_t> offsets(vertexCount + 1, 0);
+	for (size_t i = 0; i < indexCount; ++i)
+		offsets[indices[i] + 1]++;
+	for (size_t i = 0; i < vertexCount; ++i)
+		offsets[i + 1] += offsets[i];
+	std::vector<uint32_t> adjacency(indexCount);
+	{
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t i = 0; i < indexCount; ++i)
+			adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	std::vector<bool> emitted(triangleCount, false);
+	// 记录顶点属于哪个簇(簇序号+1)，用于快速判断顶点是否已在当前簇中
+	std::vector<uint32_t> vertexCluster(vertexCount, 0);
+	std::vector<uint32_t> candidates;
+	std::vector<Vector3> scratch;
+
+	size_t written = 0;
+	size_t cursor = 0;
+	uint32_t nextSeed = ~0u;
+
+	while (written < indexCount)
+	{
+		// 优先从上一个簇的边缘继续生长，保持空间局部性；否则按原有顺序寻找
+		uint32_t seed = nextSeed;
+		if (seed == ~0u || emitted[seed])
+		{
+			while (emitted[cursor])
+				cursor++;
+			seed = static_cast<uint32_t>(cursor);
+		}
+
+		uint32_t clusterId = static_cast<uint32_t>(clusters.size()) + 1;
+		Cluster cluster = {};
+		cluster.startIndex = static_cast<uint32_t>(written);
+
+		size_t clusterVertices = 0, clusterTriangles = 0;
+		Vector3 centroidSum = {};
+		candidates.clear();
+
+		uint32_t tri = seed;
+		for (;;)
+		{
+			// 加入三角形
+			emitted[tri] = true;
+			for (int k = 0; k < 3; ++k)
+			{
+				uint32_t v = indices[tri * 3 + k];
+				destination[written++] = v;
+				if (vertexCluster[v] != clusterId)
+				{
+					vertexCluster[v] = clusterId;
+					clusterVertices++;
+					Vector3 p = LoadPosition(positions, positionStride, v);
+					centroidSum = Vector3{ centroidSum.x + p.x, centroidSum.y + p.y, centroidSum.z + p.z };
+					for (uint32_t j = offsets[v]; j < offsets[v + 1]; ++j)
+					{
+						if (!emitted[adjacency[j]])
+							candidates.push_back(adjacency[j]);
+					}
+				}
+			}
+			clusterTriangles++;
+
+			if (clusterTriangles >= maxTriangles)
+				break;
+
+			// 选择新增顶点最少的相邻三角形，相同时选择离簇中心最近的，使簇尽量紧凑
+			Vector3 centroid = { centroidSum.x / clusterVertices, centroidSum.y / clusterVertices, centroidSum.z / clusterVertices };
+			uint32_t best = ~0u;
+			int bestNew = 4;
+			float bestDist = FLT_MAX;
+			size_t live = 0;
+			for (size_t i = 0; i < candidates.size(); ++i)
+			{
+				uint32_t t = candidates[i];
+				if (emitted[t])
+					continue;
+				candidates[live++] = t;
+
+				int newVertices = (vertexCluster[indices[t * 3]] != clusterId) +
+					(vertexCluster[indices[t * 3 + 1]] != clusterId) +
+					(vertexCluster[indices[t * 3 + 2]] != clusterId);
+				if (newVertices > bestNew)
+					continue;
+
+				Vector3 p0 = LoadPosition(positions, positionStride, indices[t * 3]);
+				Vector3 p1 = LoadPosition(positions, positionStride, indices[t * 3 + 1]);
+				Vector3 p2 = LoadPosition(positions, positionStride, indices[t * 3 + 2]);
+				Vector3 d = Vector3{ (p0.x + p1.x + p2.x) / 3.0f, (p0.y + p1.y + p2.y) / 3.0f, (p0.z + p1.z + p2.z) / 3.0f } - centroid;
+				float dist = Dot(d, d);
+				if (newVertices < bestNew || dist < bestDist || (dist == bestDist && t < best))
+				{
+					bestNew = newVertices;
+					bestDist = dist;
+					best = t;
+				}
+			}
+			candidates.resize(live);
+
+			if (best == ~0u || clusterVertices + bestNew > maxVertices)
+			{
+				nextSeed = best;
+				break;
+			}
+
+			tri = best;
+		}
+
+		cluster.indexCount = static_cast<uint32_t>(written - cluster.startIndex);
+		ComputeClusterBounds(cluster, destination, positions, positionStride, scratch);
+		clusters.push_back(cluster);
+
+		// 簇满了但还存在相邻三角形时，从中选择下一个种子
+		if (nextSeed == ~0u)
+		{
+			for (uint32_t t : candidates)
+			{
+				if (!emitted[t])
+				{
+					nextSeed = t;
+					break;
+				}
+			}
+		}
+	}
+
+	return clusters;
+}
+
+bool MeshCluster::IsBackfacing(const Cluster& cluster, const float eye[3])
+{
+	if (cluster.coneCutoff > 1.0f)
+		return false;
+
+	Vector3 dir = { cluster.coneApex[0] - eye[0], cluster.coneApex[1] - eye[1], cluster.coneApex[2] - eye[2] };
+	if (Normalize(dir) == 0.0f)
+		return false;
+
+	Vector3 axis = { cluster.coneAxis[0], cluster.coneAxis[1], cluster.coneAxis[2] };
+	return Dot(dir, axis) >= cluster.coneCutoff;
+}
@@ -0,0 +1,52 @@
+﻿//***************************************************************************************
+// MeshCluster.h
+// Licensed under the MIT License.
+//
+// 将网格划分成小的三角形簇(meshlet)，并计算每个簇的包围球、AABB以及法线锥，
+// 用于在CPU端进行细粒度的视锥体裁剪与背面裁剪
+// Partition meshes into small triangle clusters (meshlets) with bounding spheres,
+// AABBs and normal cones for fine-grained CPU frustum and backface culling.
+//***************************************************************************************
+
+#ifndef MESHCLUSTER_H
+#define MESHCLUSTER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace MeshCluster
+{
+	// 簇的三角形在重排后的索引数组中连续存放
+	// 该结构体会被直接写入.mbo文件，不要随意改变布局
+	struct Cluster
+	{
+		uint32_t startIndex;	// 在索引数组中的起始位置
+		uint32_t indexCount;	// 索引数目
+		float center[3];		// 包围球球心
+		float radius;			// 包围球半径
+		float aabbMin[3];		// AABB盒最小点
+		float aabbMax[3];		// AABB盒最大点
+		float coneApex[3];		// 法线锥顶点
+		float coneAxis[3];		// 法线锥轴向
+		float coneCutoff;		// 若dot(normalize(coneApex - eye), coneAxis) >= coneCutoff则整个簇背向观察点
+								// 大于1表示该簇无法进行背面裁剪
+	};
+
+	static_assert(sizeof(Cluster) == 76, "The layout of MeshCluster::Cluster is stored in .mbo files!");
+
+	// 划分簇，输出重排后的索引与簇信息
+	// [Out]destination		重排后的索引，不能与indices相同
+	// [In]positions		顶点位置起始地址(每个位置3个float)
+	// [In]positionStride	两个相邻顶点位置之间的字节跨度
+	// [In]maxVertices		每个簇最多引用的顶点数
+	// [In]maxTriangles		每个簇最多包含的三角形数
+	std::vector<Cluster> BuildClusters(uint32_t* destination, const uint32_t* indices, size_t indexCount,
+		const float* positions, size_t vertexCount, size_t positionStride,
+		size_t maxVertices = 64, size_t maxTriangles = 124);
+
+	// 判断簇是否完全背向观察点(观察点需与簇位于同一坐标系)
+	bool IsBackfacing(const Cluster& cluster, const float eye[3]);
+}
+
+#endif
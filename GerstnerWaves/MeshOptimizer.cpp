@@ -0,0 +1,470 @@
+﻿#include "MeshOptimizer.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	//
+	// Forsyth算法参数
+	// https://tomforsyth1000.github.io/papers/fast_vert_cache_opt.html
+	//
+
+	const int kCacheSize = 32;
+	const float kCacheDecayPower = 1.5f;
+	const float kLastTriScore = 0.75f;
+	const float kValenceBoostScale = 2.0f;
+	const float kValenceBoostPower = 0.5f;
+	const uint32_t kMaxValence = 64;
+
+	// 预计算的缓存位置分数与剩余三角形数目分数
+	struct ScoreTable
+	{
+		float cache[kCacheSize];
+		float valence[kMaxValence];
+
+		ScoreTable()
+		{
+			for (int i = 0; i < kCacheSize; ++i)
+			{
+				if (i < 3)
+				{
+					// 刚使用过的三个顶点固定分数，避免偏向于只使用其中一两个
+					cache[i] = kLastTriScore;
+				}
+				else
+				{
+					const float scaler = 1.0f / (kCacheSize - 3);
+					cache[i] = powf(1.0f - (i - 3) * scaler, kCacheDecayPower);
+				}
+			}
+
+			valence[0] = 0.0f;
+			for (uint32_t i = 1; i < kMaxValence; ++i)
+			{
+				// 剩余三角形越少的顶点越优先处理，避免留下孤立的三角形
+				valence[i] = kValenceBoostScale * powf(static_cast<float>(i), -kValenceBoostPower);
+			}
+		}
+	};
+
+	const ScoreTable& GetScoreTable()
+	{
+		static const ScoreTable table;
+		return table;
+	}
+
+	float VertexScore(const ScoreTable& table, int cachePosition, uint32_t remainingTriangles)
+	{
+		if (remainingTriangles == 0)
+			return -1.0f;
+
+		float score = cachePosition < 0 ? 0.0f : table.cache[cachePosition];
+		score += table.valence[std::min(remainingTriangles, kMaxValence - 1)];
+		return score;
+	}
+
+	// 三角形邻接表(CSR格式)
+	struct TriangleAdjacency
+	{
+		std::vector<uint32_t> counts;
+		std::vector<uint32_t> offsets;
+		std::vector<uint32_t> data;
+
+		TriangleAdjacency(const uint32_t* indices, size_t indexCount, size_t vertexCount)
+			: counts(vertexCount), offsets(vertexCount), data(indexCount)
+		{
+			for (size_t i = 0; i < indexCount; ++i)
+			{
+				assert(indices[i] < vertexCount);
+				counts[indices[i]]++;
+			}
+
+			uint32_t offset = 0;
+			for (size_t i = 0; i < vertexCount; ++i)
+			{
+				offsets[i] = offset;
+				offset += counts[i];
+			}
+
+			std::vector<uint32_t> fill(offsets);
+			for (size_t i = 0; i < indexCount; ++i)
+				data[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+		}
+	};
+
+	void Subtract(float* out, const float* a, const float* b)
+	{
+		out[0] = a[0] - b[0];
+		out[1] = a[1] - b[1];
+		out[2] = a[2] - b[2];
+	}
+
+	const float* PositionAt(const float* positions, size_t positionStride, uint32_t index)
+	{
+		return reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + index * positionStride);
+	}
+}
+
+MeshOptimizer::VertexCacheStatistics MeshOptimizer::AnalyzeVertexCache(const uint32_t* indices, size_t indexCount,
+	size_t vertexCount, uint32_t cacheSize)
+{
+	VertexCacheStatistics stats = {};
+	if (indexCount == 0)
+		return stats;
+
+	// 以时间戳模拟FIFO缓存：若顶点进入缓存的时间距今不超过cacheSize则命中
+	std::vector<uint32_t> timestamps(vertexCount, 0);
+	std::vector<bool> referenced(vertexCount, false);
+	uint32_t time = cacheSize + 1;
+	size_t uniqueCount = 0;
+
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		uint32_t index = indices[i];
+		assert(index < vertexCount);
+
+		if (time - timestamps[index] > cacheSize)
+		{
+			timestamps[index] = time++;
+			stats.vertexTransformCount++;
+		}
+
+		if (!referenced[index])
+		{
+			referenced[index] = true;
+			uniqueCount++;
+		}
+	}
+
+	stats.acmr = static_cast<float>(stats.vertexTransformCount) / (indexCount / 3);
+	stats.atvr = static_cast<float>(stats.vertexTransformCount) / uniqueCount;
+	return stats;
+}
+
+void MeshOptimizer::OptimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t indexCount,
+	size_t vertexCount)
+{
+	assert(indexCount % 3 == 0);
+
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	// destination可能与indices相同，需要先拷贝一份
+	std::vector<uint32_t> indicesCopy(indices, indices + indexCount);
+	indices = indicesCopy.data();
+
+	const ScoreTable& table = GetScoreTable();
+	TriangleAdjacency adjacency(indices, indexCount, vertexCount);
+
+	// 每个顶点剩余未输出的三角形数目即为adjacency.counts
+	std::vector<uint32_t>& liveTriangles = adjacency.counts;
+	std::vector<int> cachePositions(vertexCount, -1);
+	std::vector<float> vertexScores(vertexCount);
+	for (size_t i = 0; i < vertexCount; ++i)
+		vertexScores[i] = VertexScore(table, -1, liveTriangles[i]);
+
+	std::vector<float> triangleScores(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	for (size_t i = 0; i < triangleCount; ++i)
+	{
+		triangleScores[i] = vertexScores[indices[i * 3]] + vertexScores[indices[i * 3 + 1]] +
+			vertexScores[indices[i * 3 + 2]];
+	}
+
+	// 第一个三角形选取全局分数最高的
+	uint32_t bestTriangle = static_cast<uint32_t>(
+		std::max_element(triangleScores.begin(), triangleScores.end()) - triangleScores.begin());
+
+	uint32_t cache[kCacheSize + 3];
+	uint32_t cacheCount = 0;
+	uint32_t newCache[kCacheSize + 3];
+
+	size_t outputTriangle = 0;
+	size_t inputCursor = 0;
+
+	while (bestTriangle != ~0u)
+	{
+		const uint32_t* tri = &indices[bestTriangle * 3];
+
+		// 输出三角形
+		destination[outputTriangle * 3] = tri[0];
+		destination[outputTriangle * 3 + 1] = tri[1];
+		destination[outputTriangle * 3 + 2] = tri[2];
+		outputTriangle++;
+		emitted[bestTriangle] = true;
+
+		// 从邻接表中移除该三角形
+		for (int k = 0; k < 3; ++k)
+		{
+			uint32_t v = tri[k];
+			uint32_t* list = &adjacency.data[adjacency.offsets[v]];
+			uint32_t count = liveTriangles[v];
+			for (uint32_t j = 0; j < count; ++j)
+			{
+				if (list[j] == bestTriangle)
+				{
+					list[j] = list[count - 1];
+					break;
+				}
+			}
+			liveTriangles[v]--;
+		}
+
+		// 新的缓存 = 三角形顶点 + 原缓存中除去这三个顶点的部分
+		uint32_t newCount = 0;
+		newCache[newCount++] = tri[0];
+		newCache[newCount++] = tri[1];
+		newCache[newCount++] = tri[2];
+		for (uint32_t i = 0; i < cacheCount; ++i)
+		{
+			uint32_t v = cache[i];
+			if (v != tri[0] && v != tri[1] && v != tri[2])
+				newCache[newCount++] = v;
+		}
+
+		// 被挤出缓存的顶点
+		for (uint32_t i = kCacheSize; i < newCount; ++i)
+			cachePositions[newCache[i]] = -1;
+
+		cacheCount = std::min(newCount, static_cast<uint32_t>(kCacheSize));
+		memcpy(cache, newCache, cacheCount * sizeof(uint32_t));
+
+		for (uint32_t i = 0; i < cacheCount; ++i)
+			cachePositions[cache[i]] = static_cast<int>(i);
+
+		// 更新缓存内以及被挤出顶点的分数，并同步更新其相邻三角形分数
+		for (uint32_t i = 0; i < newCount; ++i)
+		{
+			uint32_t v = newCache[i];
+			float score = VertexScore(table, cachePositions[v], liveTriangles[v]);
+			float delta = score - vertexScores[v];
+			vertexScores[v] = score;
+
+			const uint32_t* list = &adjacency.data[adjacency.offsets[v]];
+			for (uint32_t j = 0; j < liveTriangles[v]; ++j)
+				triangleScores[list[j]] += delta;
+		}
+
+		// 仅在缓存内的顶点相邻的三角形中挑选下一个三角形
+		float bestScore = 0.0f;
+		bestTriangle = ~0u;
+		for (uint32_t i = 0; i < cacheCount; ++i)
+		{
+			uint32_t v = cache[i];
+			const uint32_t* list = &adjacency.data[adjacency.offsets[v]];
+			for (uint32_t j = 0; j < liveTriangles[v]; ++j)
+			{
+				uint32_t t = list[j];
+				if (triangleScores[t] > bestScore)
+				{
+					bestScore = triangleScores[t];
+					bestTriangle = t;
+				}
+			}
+		}
+
+		// 缓存内没有可用三角形时，线性查找下一个未输出的三角形
+		if (bestTriangle == ~0u)
+		{
+			while (inputCursor < triangleCount && emitted[inputCursor])
+				inputCursor++;
+			if (inputCursor < triangleCount)
+				bestTriangle = static_cast<uint32_t>(inputCursor);
+		}
+	}
+
+	assert(outputTriangle == triangleCount);
+}
+
+void MeshOptimizer::OptimizeOverdraw(uint32_t* destination, const uint32_t* indices, size_t indexCount,
+	const float* positions, size_t vertexCount, size_t positionStride, float threshold)
+{
+	assert(destination != indices);
+	assert(indexCount % 3 == 0);
+
+	size_t triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	const uint32_t cacheSize = 16;
+
+	//
+	// 1. 硬边界：三个顶点都未命中缓存的三角形开始一个新簇
+	//
+	std::vector<uint32_t> hardClusters;
+	{
+		std::vector<uint32_t> timestamps(vertexCount, 0);
+		uint32_t time = cacheSize + 1;
+		for (size_t i = 0; i < triangleCount; ++i)
+		{
+			uint32_t misses = 0;
+			for (int k = 0; k < 3; ++k)
+			{
+				uint32_t v = indices[i * 3 + k];
+				if (time - timestamps[v] > cacheSize)
+				{
+					timestamps[v] = time++;
+					misses++;
+				}
+			}
+
+			if (i == 0 || misses == 3)
+				hardClusters.push_back(static_cast<uint32_t>(i));
+		}
+	}
+
+	//
+	// 2. 软边界：在硬簇内部，若从簇起点开始的ACMR不超过threshold倍簇ACMR则切分
+	//
+	std::vector<uint32_t> clusters;
+	{
+		std::vector<uint32_t> timestamps(vertexCount, 0);
+		uint32_t time = cacheSize + 1;
+
+		for (size_t c = 0; c < hardClusters.size(); ++c)
+		{
+			uint32_t start = hardClusters[c];
+			uint32_t end = c + 1 < hardClusters.size() ? hardClusters[c + 1] : static_cast<uint32_t>(triangleCount);
+
+			// 计算整个硬簇的ACMR
+			time += cacheSize + 1;
+			uint32_t clusterMisses = 0;
+			for (uint32_t i = start * 3; i < end * 3; ++i)
+			{
+				if (time - timestamps[indices[i]] > cacheSize)
+				{
+					timestamps[indices[i]] = time++;
+					clusterMisses++;
+				}
+			}
+			float clusterAcmr = static_cast<float>(clusterMisses) / (end - start);
+
+			// 再次模拟，寻找可以切分的位置
+			clusters.push_back(start);
+			time += cacheSize + 1;
+			uint32_t misses = 0, subStart = start;
+			for (uint32_t i = start; i < end; ++i)
+			{
+				for (int k = 0; k < 3; ++k)
+				{
+					uint32_t v = indices[i * 3 + k];
+					if (time - timestamps[v] > cacheSize)
+					{
+						timestamps[v] = time++;
+						misses++;
+					}
+				}
+
+				float acmr = static_cast<float>(misses) / (i + 1 - subStart);
+				if (i + 1 < end && acmr <= clusterAcmr * threshold)
+				{
+					clusters.push_back(i + 1);
+					subStart = i + 1;
+					misses = 0;
+					time += cacheSize + 1;
+				}
+			}
+		}
+	}
+
+	//
+	// 3. 计算每个簇的排序关键字：dot(簇中心 - 网格中心, 簇法线)
+	// 越朝向模型外侧的簇越先绘制，它们更可能遮挡其余部分
+	//
+	float meshCentroid[3] = {};
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		const float* p = PositionAt(positions, positionStride, indices[i]);
+		meshCentroid[0] += p[0];
+		meshCentroid[1] += p[1];
+		meshCentroid[2] += p[2];
+	}
+	meshCentroid[0] /= indexCount;
+	meshCentroid[1] /= indexCount;
+	meshCentroid[2] /= indexCount;
+
+	size_t clusterCount = clusters.size();
+	std::vector<float> sortKeys(clusterCount);
+	for (size_t c = 0; c < clusterCount; ++c)
+	{
+		uint32_t start = clusters[c];
+		uint32_t end = c + 1 < clusterCount ? clusters[c + 1] : static_cast<uint32_t>(triangleCount);
+
+		float centroid[3] = {}, normal[3] = {}, totalArea = 0.0f;
+		for (uint32_t i = start; i < end; ++i)
+		{
+			const float* p0 = PositionAt(positions, positionStride, indices[i * 3]);
+			const float* p1 = PositionAt(positions, positionStride, indices[i * 3 + 1]);
+			const float* p2 = PositionAt(positions, positionStride, indices[i * 3 + 2]);
+
+			float e1[3], e2[3];
+			Subtract(e1, p1, p0);
+			Subtract(e2, p2, p0);
+			float n[3] = {
+				e1[1] * e2[2] - e1[2] * e2[1],
+				e1[2] * e2[0] - e1[0] * e2[2],
+				e1[0] * e2[1] - e1[1] * e2[0]
+			};
+			// 叉积长度为面积的两倍，作为权重即可
+			float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+			for (int k = 0; k < 3; ++k)
+			{
+				centroid[k] += (p0[k] + p1[k] + p2[k]) * (area / 3.0f);
+				normal[k] += n[k];
+			}
+			totalArea += area;
+		}
+
+		float invArea = totalArea == 0.0f ? 0.0f : 1.0f / totalArea;
+		float normalLength = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		float invNormalLength = normalLength == 0.0f ? 0.0f : 1.0f / normalLength;
+
+		float key = 0.0f;
+		for (int k = 0; k < 3; ++k)
+			key += (centroid[k] * invArea - meshCentroid[k]) * (normal[k] * invNormalLength);
+		sortKeys[c] = key;
+	}
+
+	std::vector<uint32_t> order(clusterCount);
+	for (size_t c = 0; c < clusterCount; ++c)
+		order[c] = static_cast<uint32_t>(c);
+	std::stable_sort(order.begin(), order.end(), [&sortKeys](uint32_t lhs, uint32_t rhs) {
+		return sortKeys[lhs] > sortKeys[rhs];
+	});
+
+	//
+	// 4. 按排序结果输出
+	//
+	size_t offset = 0;
+	for (uint32_t c : order)
+	{
+		uint32_t start = clusters[c];
+		uint32_t end = c + 1 < clusterCount ? clusters[c + 1] : static_cast<uint32_t>(triangleCount);
+		memcpy(destination + offset, indices + start * 3, (end - start) * 3 * sizeof(uint32_t));
+		offset += (end - start) * 3;
+	}
+
+	assert(offset == indexCount);
+}
+
+size_t MeshOptimizer::OptimizeVertexFetchRemap(uint32_t* remap, const uint32_t* indices, size_t indexCount,
+	size_t vertexCount)
+{
+	std::fill(remap, remap + vertexCount, ~0u);
+
+	uint32_t next = 0;
+	for (size_t i = 0; i < indexCount; ++i)
+	{
+		uint32_t index = indices[i];
+		assert(index < vertexCount);
+
+		if (remap[index] == ~0u)
+			remap[index] = next++;
+	}
+
+	return next;
+}
@@ -0,0 +1,78 @@
+﻿//***************************************************************************************
+// MeshOptimizer.h
+// Licensed under the MIT License.
+//
+// 模型烘焙阶段使用的网格优化：顶点缓存友好的三角形重排(Forsyth)、
+// 基于簇的Overdraw优化(Tipsify风格)以及按首次使用顺序重排顶点
+// Mesh optimization used at cook time: vertex cache aware triangle reordering (Forsyth),
+// cluster based overdraw optimization (Tipsify style) and vertex fetch reordering.
+//***************************************************************************************
+
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace MeshOptimizer
+{
+	// 顶点缓存统计
+	struct VertexCacheStatistics
+	{
+		uint32_t vertexTransformCount;	// 顶点着色器调用次数(缓存未命中数)
+		float acmr;						// 平均每个三角形的缓存未命中数，最优为0.5左右，最差为3
+		float atvr;						// 平均每个顶点的变换次数，最优为1
+	};
+
+	// 使用FIFO缓存模拟计算ACMR/ATVR
+	// [In]indices		三角形列表的索引
+	// [In]vertexCount	顶点数目(用于统计被引用的顶点)
+	// [In]cacheSize	模拟的后变换缓存大小
+	VertexCacheStatistics AnalyzeVertexCache(const uint32_t* indices, size_t indexCount,
+		size_t vertexCount, uint32_t cacheSize = 16);
+
+	// 按照Forsyth的线性速度顶点缓存优化算法重排三角形
+	// destination可以与indices相同
+	void OptimizeVertexCache(uint32_t* destination, const uint32_t* indices, size_t indexCount,
+		size_t vertexCount);
+
+	// 在已经做过顶点缓存优化的索引上进行Overdraw优化：
+	// 将三角形序列切分成簇，然后按照簇朝向模型外侧的程度从大到小排序
+	// [In]positions		顶点位置起始地址(每个位置3个float)
+	// [In]positionStride	两个相邻顶点位置之间的字节跨度
+	// [In]threshold		允许的ACMR劣化比例，如1.05表示最多比原来差5%
+	// destination不能与indices相同
+	void OptimizeOverdraw(uint32_t* destination, const uint32_t* indices, size_t indexCount,
+		const float* positions, size_t vertexCount, size_t positionStride, float threshold = 1.05f);
+
+	// 生成按首次使用顺序排列的顶点重映射表，未被引用的顶点映射为~0u
+	// 返回被引用的顶点数目
+	size_t OptimizeVertexFetchRemap(uint32_t* remap, const uint32_t* indices, size_t indexCount,
+		size_t vertexCount);
+
+	// 根据重映射表重排顶点与索引，并剔除未被引用的顶点
+	template<class VertexType>
+	void RemapVertexFetch(std::vector<VertexType>& vertices, uint32_t* indices, size_t indexCount);
+}
+
+template<class VertexType>
+inline void MeshOptimizer::RemapVertexFetch(std::vector<VertexType>& vertices, uint32_t* indices, size_t indexCount)
+{
+	std::vector<uint32_t> remap(vertices.size());
+	size_t uniqueCount = OptimizeVertexFetchRemap(remap.data(), indices, indexCount, vertices.size());
+
+	std::vector<VertexType> result(uniqueCount);
+	for (size_t i = 0; i < vertices.size(); ++i)
+	{
+		if (remap[i] != ~0u)
+			result[remap[i]] = vertices[i];
+	}
+
+	for (size_t i = 0; i < indexCount; ++i)
+		indices[i] = remap[indices[i]];
+
+	vertices.swap(result);
+}
+
+#endif
@@ -0,0 +1,659 @@
+﻿#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace
+{
+	// 顶点类型，决定了该顶点可以坍缩到哪些顶点上
+	enum VertexKind : uint8_t
+	{
+		VertexKind_Manifold,	// 内部顶点，可以坍缩到任意相邻顶点
+		VertexKind_Border,		// 开放边界上的顶点，只能沿边界坍缩
+		VertexKind_Seam,		// 纹理/法线接缝上的顶点(同一位置两份属性)，只能沿接缝成对坍缩
+		VertexKind_Locked		// 复杂情况，不允许移动
+	};
+
+	const uint32_t kInvalid = ~0u;
+
+	// 边界约束相对于三角形平面的权重
+	const float kBorderWeight = 10.0f;
+
+	// 单次迭代允许的误差上限为本轮目标误差的倍数
+	const float kPassErrorBound = 1.5f;
+
+	struct Vector3
+	{
+		float x, y, z;
+	};
+
+	Vector3 operator-(const Vector3& lhs, const Vector3& rhs)
+	{
+		return Vector3{ lhs.x - rhs.x, lhs.y - rhs.y, lhs.z - rhs.z };
+	}
+
+	Vector3 Cross(const Vector3& lhs, const Vector3& rhs)
+	{
+		return Vector3{ lhs.y * rhs.z - lhs.z * rhs.y, lhs.z * rhs.x - lhs.x * rhs.z, lhs.x * rhs.y - lhs.y * rhs.x };
+	}
+
+	float Dot(const Vector3& lhs, const Vector3& rhs)
+	{
+		return lhs.x * rhs.x + lhs.y * rhs.y + lhs.z * rhs.z;
+	}
+
+	float Normalize(Vector3& v)
+	{
+		float length = sqrtf(Dot(v, v));
+		if (length > 0.0f)
+		{
+			v.x /= length;
+			v.y /= length;
+			v.z /= length;
+		}
+		return length;
+	}
+
+	// 二次误差矩阵(对称矩阵A、向量b、常数c以及累计权重)
+	struct Quadric
+	{
+		float a00, a11, a22;
+		float a10, a20, a21;
+		float b0, b1, b2, c;
+		float w;
+	};
+
+	void QuadricFromPlane(Quadric& q, const Vector3& n, float d, float w)
+	{
+		q.a00 = w * n.x * n.x;
+		q.a11 = w * n.y * n.y;
+		q.a22 = w * n.z * n.z;
+		q.a10 = w * n.y * n.x;
+		q.a20 = w * n.z * n.x;
+		q.a21 = w * n.z * n.y;
+		q.b0 = w * n.x * d;
+		q.b1 = w * n.y * d;
+		q.b2 = w * n.z * d;
+		q.c = w * d * d;
+		q.w = w;
+	}
+
+	void QuadricAdd(Quadric& q, const Quadric& r)
+	{
+		q.a00 += r.a00;
+		q.a11 += r.a11;
+		q.a22 += r.a22;
+		q.a10 += r.a10;
+		q.a20 += r.a20;
+		q.a21 += r.a21;
+		q.b0 += r.b0;
+		q.b1 += r.b1;
+		q.b2 += r.b2;
+		q.c += r.c;
+		q.w += r.w;
+	}
+
+	// 返回点到累计平面的加权平均距离的平方
+	float QuadricError(const Quadric& q, const Vector3& v)
+	{
+		float rx = q.b0, ry = q.b1, rz = q.b2;
+
+		rx += q.a10 * v.y;
+		ry += q.a21 * v.z;
+		rz += q.a20 * v.x;
+
+		rx *= 2;
+		ry *= 2;
+		rz *= 2;
+
+		rx += q.a00 * v.x;
+		ry += q.a11 * v.y;
+		rz += q.a22 * v.z;
+
+		float r = q.c;
+		r += rx * v.x;
+		r += ry * v.y;
+		r += rz * v.z;
+
+		return q.w == 0.0f ? 0.0f : fabsf(r) / q.w;
+	}
+
+	uint64_t EdgeKey(uint32_t a, uint32_t b)
+	{
+		return (static_cast<uint64_t>(a) << 32) | b;
+	}
+
+	struct PositionHasher
+	{
+		const Vector3* positions;
+
+		size_t operator()(uint32_t index) const
+		{
+			uint32_t h[3];
+			memcpy(h, &positions[index], sizeof(h));
+			// 合并+0.0与-0.0
+			h[0] = (h[0] == 0x80000000) ? 0 : h[0];
+			h[1] = (h[1] == 0x80000000) ? 0 : h[1];
+			h[2] = (h[2] == 0x80000000) ? 0 : h[2];
+			return (h[0] * 73856093) ^ (h[1] * 19349663) ^ (h[2] * 83492791);
+		}
+
+		bool operator()(uint32_t lhs, uint32_t rhs) const
+		{
+			const Vector3& a = positions[lhs];
+			const Vector3& b = positions[rhs];
+			return a.x == b.x && a.y == b.y && a.z == b.z;
+		}
+	};
+
+	struct Collapse
+	{
+		uint32_t v0;	// 被移除的顶点
+		uint32_t v1;	// 目标顶点
+		float error;
+	};
+
+	struct Simplifier
+	{
+		size_t vertexCount;
+		std::vector<Vector3> positions;		// 归一化到单位立方体内的位置
+		std::vector<uint32_t> remap;		// 相同位置的顶点映射到同一个代表顶点
+		std::vector<uint32_t> wedge;		// 相同位置顶点组成的循环链表
+		std::vector<uint32_t> openOut;		// 顶点唯一的开放出边终点
+		std::vector<uint32_t> openIn;		// 顶点唯一的开放入边起点
+		std::vector<VertexKind> kinds;
+		std::vector<Quadric> quadrics;		// 按代表顶点存储
+
+		// 每轮使用的邻接表与坍缩映射
+		std::vector<uint32_t> adjacencyOffsets;
+		std::vector<uint32_t> adjacencyData;
+		std::vector<uint32_t> collapseRemap;
+		std::vector<bool> collapseLocked;
+
+		void Init(const uint32_t* indices, size_t indexCount, const float* srcPositions, size_t positionStride);
+		void BuildPositionRemap(const uint32_t* indices, size_t indexCount);
+		void ClassifyVertices(const uint32_t* indices, size_t indexCount);
+		void ComputeQuadrics(const uint32_t* indices, size_t indexCount);
+		void BuildAdjacency(const uint32_t* indices, size_t indexCount);
+
+		bool CanCollapse(uint32_t v0, uint32_t v1) const;
+		uint32_t FindSeamSibling(uint32_t v0, uint32_t v1) const;
+		bool HasTriangleFlips(const uint32_t* indices, uint32_t v0, uint32_t v1) const;
+		void UpdateOpenEdges(uint32_t v0, uint32_t v1);
+	};
+
+	void Simplifier::Init(const uint32_t* indices, size_t indexCount, const float* srcPositions, size_t positionStride)
+	{
+		// 位置归一化，使误差与模型尺度无关
+		float minV[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, maxV[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+		positions.resize(vertexCount);
+		for (size_t i = 0; i < vertexCount; ++i)
+		{
+			const float* p = reinterpret_cast<const float*>(reinterpret_cast<const char*>(srcPositions) + i * positionStride);
+			positions[i] = Vector3{ p[0], p[1], p[2] };
+			for (int k = 0; k < 3; ++k)
+			{
+				minV[k] = std::min(minV[k], p[k]);
+				maxV[k] = std::max(maxV[k], p[k]);
+			}
+		}
+
+		float extent = std::max(maxV[0] - minV[0], std::max(maxV[1] - minV[1], maxV[2] - minV[2]));
+		float scale = extent == 0.0f ? 0.0f : 1.0f / extent;
+		for (auto& p : positions)
+			p = Vector3{ (p.x - minV[0]) * scale, (p.y - minV[1]) * scale, (p.z - minV[2]) * scale };
+
+		BuildPositionRemap(indices, indexCount);
+		ClassifyVertices(indices, indexCount);
+		ComputeQuadrics(indices, indexCount);
+	}
+
+	void Simplifier::BuildPositionRemap(const uint32_t* indices, size_t indexCount)
+	{
+		remap.resize(vertexCount);
+		wedge.resize(vertexCount);
+
+		// 未被引用的顶点不参与合并，否则会被误认为接缝
+		std::vector<bool> referenced(vertexCount, false);
+		for (size_t i = 0; i < indexCount; ++i)
+			referenced[indices[i]] = true;
+
+		PositionHasher hasher = { positions.data() };
+		std::unordered_map<uint32_t, uint32_t, PositionHasher, PositionHasher> table(vertexCount, hasher, hasher);
+
+		for (uint32_t i = 0; i < vertexCount; ++i)
+		{
+			if (referenced[i])
+				remap[i] = table.emplace(i, i).first->second;
+			else
+				remap[i] = i;
+		}
+
+		// 构造循环链表：wedge[i]指向下一个相同位置的顶点
+		for (uint32_t i = 0; i < vertexCount; ++i)
+			wedge[i] = i;
+
+		for (uint32_t i = 0; i < vertexCount; ++i)
+		{
+			uint32_t r = remap[i];
+			if (r != i)
+			{
+				wedge[i] = wedge[r];
+				wedge[r] = i;
+			}
+		}
+	}
+
+	void Simplifier::ClassifyVertices(const uint32_t* indices, size_t indexCount)
+	{
+		// 统计属性层面与位置层面的有向边
+		std::unordered_set<uint64_t> edges, positionEdges;
+		edges.reserve(indexCount);
+		positionEdges.reserve(indexCount);
+		for (size_t i = 0; i < indexCount; i += 3)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				uint32_t a = indices[i + k], b = indices[i + (k + 1) % 3];
+				edges.insert(EdgeKey(a, b));
+				positionEdges.insert(EdgeKey(remap[a], remap[b]));
+			}
+		}
+
+		openOut.assign(vertexCount, kInvalid);
+		openIn.assign(vertexCount, kInvalid);
+		std::vector<uint8_t> openOutCount(vertexCount), openInCount(vertexCount);
+		std::vector<bool> positionOpen(vertexCount, false);
+
+		for (size_t i = 0; i < indexCount; i += 3)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				uint32_t a = indices[i + k], b = indices[i + (k + 1) % 3];
+
+				// 不存在反向边的即为开放边(边界或接缝)
+				if (edges.find(EdgeKey(b, a)) == edges.end())
+				{
+					openOut[a] = b;
+					openIn[b] = a;
+					openOutCount[a] = static_cast<uint8_t>(std::min(openOutCount[a] + 1, 2));
+					openInCount[b] = static_cast<uint8_t>(std::min(openInCount[b] + 1, 2));
+				}
+
+				if (positionEdges.find(EdgeKey(remap[b], remap[a])) == positionEdges.end())
+				{
+					positionOpen[remap[a]] = true;
+					positionOpen[remap[b]] = true;
+				}
+			}
+		}
+
+		kinds.resize(vertexCount);
+		for (uint32_t i = 0; i < vertexCount; ++i)
+		{
+			if (remap[i] != i)
+				continue;
+
+			uint32_t wedgeCount = 1;
+			for (uint32_t w = wedge[i]; w != i; w = wedge[w])
+				wedgeCount++;
+
+			VertexKind kind = VertexKind_Locked;
+			if (wedgeCount == 1)
+			{
+				// 接缝的端点在位置层面是封闭的，但属性层面存在开放边，需要锁定
+				if (openOutCount[i] == 0 && openInCount[i] == 0)
+					kind = VertexKind_Manifold;
+				else if (openOutCount[i] == 1 && openInCount[i] == 1 && positionOpen[i])
+					kind = VertexKind_Border;
+			}
+			else if (wedgeCount == 2 && !positionOpen[i])
+			{
+				uint32_t s = wedge[i];
+				if (openOutCount[i] == 1 && openInCount[i] == 1 && openOutCount[s] == 1 && openInCount[s] == 1)
+					kind = VertexKind_Seam;
+			}
+
+			kinds[i] = kind;
+			for (uint32_t w = wedge[i]; w != i; w = wedge[w])
+				kinds[w] = kind;
+		}
+
+		// 开放边不唯一的顶点已经被锁定，其记录的开放边无意义
+		for (uint32_t i = 0; i < vertexCount; ++i)
+		{
+			if (kinds[i] == VertexKind_Locked && (openOutCount[i] > 1 || openInCount[i] > 1))
+			{
+				openOut[i] = kInvalid;
+				openIn[i] = kInvalid;
+			}
+		}
+	}
+
+	void Simplifier::ComputeQuadrics(const uint32_t* indices, size_t indexCount)
+	{
+		quadrics.assign(vertexCount, Quadric{});
+
+		for (size_t i = 0; i < indexCount; i += 3)
+		{
+			uint32_t i0 = indices[i], i1 = indices[i + 1], i2 = indices[i + 2];
+			const Vector3& p0 = positions[i0];
+			const Vector3& p1 = positions[i1];
+			const Vector3& p2 = positions[i2];
+
+			Vector3 normal = Cross(p1 - p0, p2 - p0);
+			float area = Normalize(normal);
+
+			Quadric q;
+			QuadricFromPlane(q, normal, -Dot(normal, p0), area);
+			QuadricAdd(quadrics[remap[i0]], q);
+			QuadricAdd(quadrics[remap[i1]], q);
+			QuadricAdd(quadrics[remap[i2]], q);
+
+			// 为开放边添加垂直于三角形的约束平面，防止边界与接缝收缩变形
+			uint32_t tri[3] = { i0, i1, i2 };
+			for (int k = 0; k < 3; ++k)
+			{
+				uint32_t a = tri[k], b = tri[(k + 1) % 3];
+				if (openOut[a] != b)
+					continue;
+
+				Vector3 edge = positions[b] - positions[a];
+				float length = sqrtf(Dot(edge, edge));
+				Vector3 edgeNormal = Cross(edge, normal);
+				Normalize(edgeNormal);
+
+				Quadric eq;
+				QuadricFromPlane(eq, edgeNormal, -Dot(edgeNormal, positions[a]), length * length * kBorderWeight);
+				QuadricAdd(quadrics[remap[a]], eq);
+				QuadricAdd(quadrics[remap[b]], eq);
+			}
+		}
+	}
+
+	void Simplifier::BuildAdjacency(const uint32_t* indices, size_t indexCount)
+	{
+		adjacencyOffsets.assign(vertexCount + 1, 0);
+		for (size_t i = 0; i < indexCount; ++i)
+			adjacencyOffsets[indices[i] + 1]++;
+		for (size_t i = 0; i < vertexCount; ++i)
+			adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+
+		adjacencyData.resize(indexCount);
+		std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+		for (size_t i = 0; i < indexCount; ++i)
+			adjacencyData[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+	}
+
+	bool Simplifier::CanCollapse(uint32_t v0, uint32_t v1) const
+	{
+		VertexKind k0 = kinds[v0], k1 = kinds[v1];
+		switch (k0)
+		{
+		case VertexKind_Manifold:
+			return true;
+		case VertexKind_Border:
+			// 只能沿边界坍缩到边界或锁定顶点上
+			return (k1 == VertexKind_Border || k1 == VertexKind_Locked) &&
+				(openOut[v0] == v1 || openIn[v0] == v1);
+		case VertexKind_Seam:
+			// 只能沿接缝坍缩，且另一侧的属性顶点也必须能找到对应的目标
+			return (k1 == VertexKind_Seam || k1 == VertexKind_Locked) &&
+				(openOut[v0] == v1 || openIn[v0] == v1) &&
+				FindSeamSibling(v0, v1) != kInvalid;
+		default:
+			return false;
+		}
+	}
+
+	uint32_t Simplifier::FindSeamSibling(uint32_t v0, uint32_t v1) const
+	{
+		// v0的另一份属性顶点s需要沿接缝坍缩到与v1位置相同的某个顶点上
+		uint32_t s = wedge[v0];
+		for (uint32_t w = v1;;)
+		{
+			if (w != v1 && (openOut[s] == w || openIn[s] == w))
+				return w;
+			w = wedge[w];
+			if (w == v1)
+				break;
+		}
+		return kInvalid;
+	}
+
+	bool Simplifier::HasTriangleFlips(const uint32_t* indices, uint32_t v0, uint32_t v1) const
+	{
+		const Vector3& p1 = positions[v1];
+
+		for (uint32_t j = adjacencyOffsets[v0]; j < adjacencyOffsets[v0 + 1]; ++j)
+		{
+			uint32_t t = adjacencyData[j];
+			uint32_t a = collapseRemap[indices[t * 3]];
+			uint32_t b = collapseRemap[indices[t * 3 + 1]];
+			uint32_t c = collapseRemap[indices[t * 3 + 2]];
+
+			// 包含目标顶点的三角形坍缩后退化，无需检查
+			if (remap[a] == remap[v1] || remap[b] == remap[v1] || remap[c] == remap[v1])
+				continue;
+
+			// 旋转使得a为被移动的顶点
+			if (b == v0)
+				std::swap(a, b), std::swap(b, c);
+			else if (c == v0)
+				std::swap(a, c), std::swap(b, c);
+
+			if (a != v0)
+				continue;
+
+			Vector3 n0 = Cross(positions[b] - positions[a], positions[c] - positions[a]);
+			Vector3 n1 = Cross(positions[b] - p1, positions[c] - p1);
+			if (Dot(n0, n1) <= 0.0f)
+				return true;
+		}
+
+		return false;
+	}
+
+	void Simplifier::UpdateOpenEdges(uint32_t v0, uint32_t v1)
+	{
+		// 沿开放边坍缩后，需要把v0的另一条开放边接到v1上
+		if (openOut[v0] == v1)
+		{
+			uint32_t prev = openIn[v0];
+			if (prev != kInvalid && prev != v1)
+			{
+				openOut[prev] = v1;
+				openIn[v1] = prev;
+			}
+		}
+		else if (openIn[v0] == v1)
+		{
+			uint32_t next = openOut[v0];
+			if (next != kInvalid && next != v1)
+			{
+				openOut[v1] = next;
+				openIn[next] = v1;
+			}
+		}
+	}
+
+	// 剔除退化三角形后返回新的索引数目
+	size_t RemapIndexBuffer(uint32_t* indices, size_t indexCount, const std::vector<uint32_t>& collapseRemap,
+		const std::vector<uint32_t>& remap)
+	{
+		size_t write = 0;
+		for (size_t i = 0; i < indexCount; i += 3)
+		{
+			uint32_t a = collapseRemap[indices[i]];
+			uint32_t b = collapseRemap[indices[i + 1]];
+			uint32_t c = collapseRemap[indices[i + 2]];
+
+			if (remap[a] != remap[b] && remap[b] != remap[c] && remap[c] != remap[a])
+			{
+				indices[write] = a;
+				indices[write + 1] = b;
+				indices[write + 2] = c;
+				write += 3;
+			}
+		}
+		return write;
+	}
+}
+
+size_t MeshSimplifier::Simplify(uint32_t* destination, const uint32_t* indices, size_t indexCount,
+	const float* positions, size_t vertexCount, size_t positionStride,
+	size_t targetIndexCount, float targetError, float* pResultError)
+{
+	assert(indexCount % 3 == 0);
+
+	if (destination != indices)
+		memcpy(destination, indices, indexCount * sizeof(uint32_t));
+
+	float resultError = 0.0f;
+	if (pResultError)
+		*pResultError = 0.0f;
+
+	if (indexCount <= targetIndexCount)
+		return indexCount;
+
+	Simplifier simplifier;
+	simplifier.vertexCount = vertexCount;
+	simplifier.Init(destination, indexCount, positions, positionStride);
+
+	const float errorLimit = targetError * targetError;
+	std::vector<Collapse> collapses;
+	std::vector<uint32_t> collapseOrder;
+
+	while (indexCount > targetIndexCount)
+	{
+		simplifier.BuildAdjacency(destination, indexCount);
+
+		//
+		// 收集所有可以进行的坍缩
+		//
+		collapses.clear();
+		for (size_t i = 0; i < indexCount; i += 3)
+		{
+			for (int k = 0; k < 3; ++k)
+			{
+				uint32_t i0 = destination[i + k], i1 = destination[i + (k + 1) % 3];
+
+				// 内部边会被两个三角形各访问一次，只保留一次
+				if (i0 > i1 && simplifier.kinds[i0] == VertexKind_Manifold && simplifier.kinds[i1] == VertexKind_Manifold)
+					continue;
+
+				bool can01 = simplifier.CanCollapse(i0, i1);
+				bool can10 = simplifier.CanCollapse(i1, i0);
+				if (!can01 && !can10)
+					continue;
+
+				float e01 = can01 ? QuadricError(simplifier.quadrics[simplifier.remap[i0]], simplifier.positions[i1]) : FLT_MAX;
+				float e10 = can10 ? QuadricError(simplifier.quadrics[simplifier.remap[i1]], simplifier.positions[i0]) : FLT_MAX;
+
+				collapses.push_back(e01 <= e10 ? Collapse{ i0, i1, e01 } : Collapse{ i1, i0, e10 });
+			}
+		}
+
+		if (collapses.empty())
+			break;
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& lhs, const Collapse& rhs) {
+			return lhs.error < rhs.error;
+		});
+
+		// 每次坍缩大约移除两个三角形，以此估计本轮需要的坍缩数目
+		size_t triangleGoal = (indexCount - targetIndexCount) / 3;
+		size_t collapseGoal = std::min(collapses.size(), triangleGoal / 2 + 1);
+		float passErrorLimit = std::min(errorLimit, collapses[collapseGoal - 1].error * kPassErrorBound);
+
+		//
+		// 按误差从小到大执行坍缩，每个顶点每轮最多参与一次
+		//
+		simplifier.collapseRemap.resize(vertexCount);
+		for (uint32_t i = 0; i < vertexCount; ++i)
+			simplifier.collapseRemap[i] = i;
+		simplifier.collapseLocked.assign(vertexCount, false);
+
+		size_t trianglesRemoved = 0;
+		size_t collapseCount = 0;
+		for (const Collapse& c : collapses)
+		{
+			if (c.error > passErrorLimit || trianglesRemoved >= triangleGoal)
+				break;
+
+			uint32_t r0 = simplifier.remap[c.v0], r1 = simplifier.remap[c.v1];
+			if (simplifier.collapseLocked[r0] || simplifier.collapseLocked[r1])
+				continue;
+
+			if (simplifier.HasTriangleFlips(destination, c.v0, c.v1))
+				continue;
+
+			VertexKind kind = simplifier.kinds[c.v0];
+			if (kind == VertexKind_Seam)
+			{
+				uint32_t s0 = simplifier.wedge[c.v0];
+				uint32_t s1 = simplifier.FindSeamSibling(c.v0, c.v1);
+				if (simplifier.HasTriangleFlips(destination, s0, s1))
+					continue;
+
+				simplifier.collapseRemap[c.v0] = c.v1;
+				simplifier.collapseRemap[s0] = s1;
+				simplifier.UpdateOpenEdges(c.v0, c.v1);
+				simplifier.UpdateOpenEdges(s0, s1);
+				trianglesRemoved += 2;
+			}
+			else
+			{
+				simplifier.collapseRemap[c.v0] = c.v1;
+				if (kind == VertexKind_Border)
+				{
+					simplifier.UpdateOpenEdges(c.v0, c.v1);
+					trianglesRemoved += 1;
+				}
+				else
+				{
+					trianglesRemoved += 2;
+				}
+			}
+
+			QuadricAdd(simplifier.quadrics[r1], simplifier.quadrics[r0]);
+			simplifier.collapseLocked[r0] = true;
+			simplifier.collapseLocked[r1] = true;
+			resultError = std::max(resultError, c.error);
+			collapseCount++;
+		}
+
+		if (collapseCount == 0)
+			break;
+
+		indexCount = RemapIndexBuffer(destination, indexCount, simplifier.collapseRemap, simplifier.remap);
+	}
+
+	if (pResultError)
+		*pResultError = sqrtf(resultError);
+
+	return indexCount;
+}
+
+float MeshSimplifier::GetMeshScale(const float* positions, size_t vertexCount, size_t positionStride)
+{
+	float minV[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, maxV[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		const float* p = reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + i * positionStride);
+		for (int k = 0; k < 3; ++k)
+		{
+			minV[k] = std::min(minV[k], p[k]);
+			maxV[k] = std::max(maxV[k], p[k]);
+		}
+	}
+
+	if (vertexCount == 0)
+		return 0.0f;
+	return std::max(maxV[0] - minV[0], std::max(maxV[1] - minV[1], maxV[2] - minV[2]));
+}
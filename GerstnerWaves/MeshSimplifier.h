@@ -0,0 +1,37 @@
+﻿//***************************************************************************************
+// MeshSimplifier.h
+// Licensed under the MIT License.
+//
+// 基于二次误差度量(QEM)的边坍缩网格简化，用于生成LOD链
+// 坍缩只会把顶点合并到已有顶点上，因此各级LOD可以共用同一个顶点缓冲区
+// 纹理坐标/法线接缝以及网格边界会被保留
+// Quadric error metric edge-collapse mesh simplification used to build LOD chains.
+// Vertices only collapse onto existing vertices so all LODs share one vertex buffer.
+// UV/normal seams and open borders are preserved.
+//***************************************************************************************
+
+#ifndef MESHSIMPLIFIER_H
+#define MESHSIMPLIFIER_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace MeshSimplifier
+{
+	// 简化三角形列表
+	// [Out]destination		输出索引，需要至少indexCount个元素的空间
+	// [In]positions		顶点位置起始地址(每个位置3个float)
+	// [In]positionStride	两个相邻顶点位置之间的字节跨度
+	// [In]targetIndexCount	期望的索引数目
+	// [In]targetError		允许的最大误差，为相对于网格包围盒最大边长的比例，如0.01表示1%
+	// [Out]pResultError	实际产生的误差(相对值)，可以为nullptr
+	// 返回值: 简化后的索引数目
+	size_t Simplify(uint32_t* destination, const uint32_t* indices, size_t indexCount,
+		const float* positions, size_t vertexCount, size_t positionStride,
+		size_t targetIndexCount, float targetError, float* pResultError = nullptr);
+
+	// 获取网格包围盒的最大边长，用于将相对误差换算成模型空间的距离
+	float GetMeshScale(const float* positions, size_t vertexCount, size_t positionStride);
+}
+
+#endif
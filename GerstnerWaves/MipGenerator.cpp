@@ -0,0 +1,394 @@
+﻿#include "MipGenerator.h"
+#include "PixelConvert.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define MIPGENERATOR_SSE2 1
+#define MIPGENERATOR_TARGET_SSE2
+#include <intrin.h>
+#include <emmintrin.h>
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define MIPGENERATOR_SSE2 1
+#define MIPGENERATOR_TARGET_SSE2 __attribute__((target("sse2")))
+#include <emmintrin.h>
+#endif
+
+//
+// 每一级先在水平方向重采样(源高度 x 目标宽度)，再在竖直方向重采样，中间结果为线性空间的RGBA浮点数
+// 两种实现对每个通道都按相同的顺序累加权重与像素的乘积(不合并为FMA)，结果相同
+//
+
+namespace
+{
+	const double kPi = 3.14159265358979323846;
+	// 滤波器的半径(以目标像素为单位)
+	const double kWindowedRadius = 3.0;
+	const double kKaiserAlpha = 4.0;
+	// 按行并行时每个任务处理的行数
+	const uint32_t kRowsPerTask = 16;
+
+	double Sinc(double x)
+	{
+		if (std::fabs(x) < 1e-9)
+			return 1.0;
+		return std::sin(kPi * x) / (kPi * x);
+	}
+
+	// 第一类零阶修正贝塞尔函数，级数展开
+	double BesselI0(double x)
+	{
+		double sum = 1.0, term = 1.0;
+		for (int k = 1; k < 32; ++k)
+		{
+			term *= (x / (2.0 * k)) * (x / (2.0 * k));
+			sum += term;
+			if (term < sum * 1e-12)
+				break;
+		}
+		return sum;
+	}
+
+	double EvaluateFilter(MipGenerator::Filter filter, double t)
+	{
+		double x = std::fabs(t);
+		switch (filter)
+		{
+		case MipGenerator::Filter::Box:
+			return x < 0.5 ? 1.0 : x == 0.5 ? 0.5 : 0.0;
+		case MipGenerator::Filter::Kaiser:
+			if (x >= kWindowedRadius)
+				return 0.0;
+			return Sinc(x) * BesselI0(kKaiserAlpha * std::sqrt(1.0 - (x / kWindowedRadius) * (x / kWindowedRadius))) /
+				BesselI0(kKaiserAlpha);
+		default:
+			return x < kWindowedRadius ? Sinc(x) * Sinc(x / kWindowedRadius) : 0.0;
+		}
+	}
+
+	// 一个方向上每个目标像素的源像素下标与权重
+	struct Axis
+	{
+		std::vector<uint32_t> offsets;		// 第i个目标像素的抽头为[offsets[i], offsets[i + 1])
+		std::vector<uint32_t> indices;
+		std::vector<float> weights;
+	};
+
+	Axis BuildAxis(uint32_t srcSize, uint32_t dstSize, MipGenerator::Filter filter, bool wrap)
+	{
+		Axis axis;
+		double scale = static_cast<double>(srcSize) / dstSize;
+		double radius = (filter == MipGenerator::Filter::Box ? 0.5 : kWindowedRadius) * scale;
+		axis.offsets.push_back(0);
+		for (uint32_t x = 0; x < dstSize; ++x)
+		{
+			double center = (x + 0.5) * scale;
+			int first = static_cast<int>(std::floor(center - radius));
+			int last = static_cast<int>(std::ceil(center + radius));
+			std::vector<std::pair<uint32_t, double>> taps;
+			double sum = 0.0;
+			for (int i = first; i <= last; ++i)
+			{
+				double weight = EvaluateFilter(filter, (i + 0.5 - center) / scale);
+				if (weight == 0.0)
+					continue;
+				int size = static_cast<int>(srcSize);
+				uint32_t index = static_cast<uint32_t>(wrap ? ((i % size) + size) % size : (std::min)((std::max)(i, 0), size - 1));
+				// 超出边缘的抽头合并到同一个源像素上
+				auto it = std::find_if(taps.begin(), taps.end(),
+					[index](const std::pair<uint32_t, double>& tap) { return tap.first == index; });
+				if (it == taps.end())
+					taps.emplace_back(index, weight);
+				else
+					it->second += weight;
+				sum += weight;
+			}
+			for (const auto& tap : taps)
+			{
+				axis.indices.push_back(tap.first);
+				axis.weights.push_back(static_cast<float>(tap.second / sum));
+			}
+			axis.offsets.push_back(static_cast<uint32_t>(axis.indices.size()));
+		}
+		return axis;
+	}
+
+	//
+	// 标量实现
+	//
+
+	// 把源图像的若干行在水平方向重采样
+	void ResampleRowsScalar(const float* src, uint32_t srcWidth, float* dst, uint32_t dstWidth,
+		const Axis& axis, uint32_t firstRow, uint32_t lastRow)
+	{
+		for (uint32_t y = firstRow; y < lastRow; ++y)
+		{
+			const float* srcRow = src + static_cast<size_t>(y) * srcWidth * 4;
+			float* dstRow = dst + static_cast<size_t>(y) * dstWidth * 4;
+			for (uint32_t x = 0; x < dstWidth; ++x)
+			{
+				float sum[4] = {};
+				for (uint32_t k = axis.offsets[x]; k < axis.offsets[x + 1]; ++k)
+				{
+					const float* pixel = srcRow + axis.indices[k] * 4;
+					float weight = axis.weights[k];
+					for (int c = 0; c < 4; ++c)
+						sum[c] = sum[c] + weight * pixel[c];
+				}
+				memcpy(dstRow + x * 4, sum, sizeof(sum));
+			}
+		}
+	}
+
+	// 在竖直方向重采样并截取到[0, 1]
+	void ResampleColumnsScalar(const float* src, float* dst, uint32_t width, const Axis& axis,
+		uint32_t firstRow, uint32_t lastRow)
+	{
+		size_t rowFloats = static_cast<size_t>(width) * 4;
+		for (uint32_t y = firstRow; y < lastRow; ++y)
+		{
+			float* dstRow = dst + y * rowFloats;
+			std::fill(dstRow, dstRow + rowFloats, 0.0f);
+			for (uint32_t k = axis.offsets[y]; k < axis.offsets[y + 1]; ++k)
+			{
+				const float* srcRow = src + axis.indices[k] * rowFloats;
+				float weight = axis.weights[k];
+				for (size_t i = 0; i < rowFloats; ++i)
+					dstRow[i] = dstRow[i] + weight * srcRow[i];
+			}
+			for (size_t i = 0; i < rowFloats; ++i)
+				dstRow[i] = (std::min)((std::max)(dstRow[i], 0.0f), 1.0f);
+		}
+	}
+
+#ifdef MIPGENERATOR_SSE2
+	bool HasSSE2()
+	{
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 1);
+		return (info[3] & (1 << 26)) != 0;
+#else
+		return __builtin_cpu_supports("sse2") != 0;
+#endif
+	}
+
+	//
+	// SSE2实现: 水平方向一个像素的RGBA为一个向量，竖直方向每次处理一行中的4个浮点数
+	//
+
+	MIPGENERATOR_TARGET_SSE2 void ResampleRowsSSE2(const float* src, uint32_t srcWidth, float* dst, uint32_t dstWidth,
+		const Axis& axis, uint32_t firstRow, uint32_t lastRow)
+	{
+		for (uint32_t y = firstRow; y < lastRow; ++y)
+		{
+			const float* srcRow = src + static_cast<size_t>(y) * srcWidth * 4;
+			float* dstRow = dst + static_cast<size_t>(y) * dstWidth * 4;
+			for (uint32_t x = 0; x < dstWidth; ++x)
+			{
+				__m128 sum = _mm_setzero_ps();
+				for (uint32_t k = axis.offsets[x]; k < axis.offsets[x + 1]; ++k)
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(axis.weights[k]), _mm_loadu_ps(srcRow + axis.indices[k] * 4)));
+				_mm_storeu_ps(dstRow + x * 4, sum);
+			}
+		}
+	}
+
+	MIPGENERATOR_TARGET_SSE2 void ResampleColumnsSSE2(const float* src, float* dst, uint32_t width, const Axis& axis,
+		uint32_t firstRow, uint32_t lastRow)
+	{
+		size_t rowFloats = static_cast<size_t>(width) * 4;
+		const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+		for (uint32_t y = firstRow; y < lastRow; ++y)
+		{
+			float* dstRow = dst + y * rowFloats;
+			uint32_t first = axis.offsets[y], last = axis.offsets[y + 1];
+			for (size_t i = 0; i < rowFloats; i += 4)
+			{
+				__m128 sum = _mm_setzero_ps();
+				for (uint32_t k = first; k < last; ++k)
+					sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(axis.weights[k]), _mm_loadu_ps(src + axis.indices[k] * rowFloats + i)));
+				_mm_storeu_ps(dstRow + i, _mm_min_ps(_mm_max_ps(sum, zero), one));
+			}
+		}
+	}
+#endif
+
+	void ForEachRows(uint32_t rowCount, ThreadPool* pool, const std::function<void(uint32_t, uint32_t)>& func)
+	{
+		uint32_t taskCount = (rowCount + kRowsPerTask - 1) / kRowsPerTask;
+		auto run = [&](size_t task)
+		{
+			uint32_t first = static_cast<uint32_t>(task) * kRowsPerTask;
+			func(first, (std::min)(first + kRowsPerTask, rowCount));
+		};
+		if (pool && taskCount > 1)
+			pool->ParallelFor(taskCount, run);
+		else
+		{
+			for (uint32_t task = 0; task < taskCount; ++task)
+				run(task);
+		}
+	}
+
+	float ComputeFloatCoverage(const std::vector<float>& pixels, float scale, float reference)
+	{
+		size_t count = 0, pixelCount = pixels.size() / 4;
+		for (size_t i = 0; i < pixelCount; ++i)
+			count += (std::min)(pixels[i * 4 + 3] * scale, 1.0f) > reference ? 1 : 0;
+		return static_cast<float>(count) / pixelCount;
+	}
+
+	// 求Alpha的缩放系数，使覆盖率最接近目标
+	float FindCoverageScale(const std::vector<float>& pixels, float targetCoverage, float reference)
+	{
+		float low = 0.0f, high = 1.0f;
+		while (ComputeFloatCoverage(pixels, high, reference) < targetCoverage && high < 64.0f)
+			high *= 2.0f;
+		for (int iteration = 0; iteration < 16; ++iteration)
+		{
+			float middle = (low + high) * 0.5f;
+			if (ComputeFloatCoverage(pixels, middle, reference) < targetCoverage)
+				low = middle;
+			else
+				high = middle;
+		}
+		// 覆盖率随缩放系数阶跃变化，取两端中更接近目标的一个
+		float lowError = std::fabs(ComputeFloatCoverage(pixels, low, reference) - targetCoverage);
+		float highError = std::fabs(ComputeFloatCoverage(pixels, high, reference) - targetCoverage);
+		return lowError < highError ? low : high;
+	}
+}
+
+MipGenerator::Options MipGenerator::GetDefaultOptions()
+{
+	Options options;
+	options.filter = Filter::Kaiser;
+	options.srgb = true;
+	options.wrap = false;
+	options.alphaReference = -1.0f;
+	return options;
+}
+
+uint32_t MipGenerator::GetMipCount(uint32_t width, uint32_t height)
+{
+	uint32_t count = 1;
+	while (width > 1 || height > 1)
+	{
+		width = (std::max)(width / 2, 1u);
+		height = (std::max)(height / 2, 1u);
+		++count;
+	}
+	return count;
+}
+
+void MipGenerator::Generate(const uint8_t* rgba, uint32_t width, uint32_t height, size_t rowPitch, const Options& options,
+	std::vector<Level>& levels, uint32_t maxLevels, ThreadPool* pool, bool allowSimd)
+{
+	levels.clear();
+	if (width == 0 || height == 0)
+		return;
+
+	uint32_t levelCount = GetMipCount(width, height);
+	if (maxLevels > 0)
+		levelCount = (std::min)(levelCount, maxLevels);
+
+#ifdef MIPGENERATOR_SSE2
+	static const bool hasSSE2 = HasSSE2();
+	bool useSimd = allowSimd && hasSSE2;
+#else
+	(void)allowSimd;
+	bool useSimd = false;
+#endif
+
+	// 第0级复制为紧密排列，同时转换到线性空间
+	PixelConvert::Simd convertSimd = allowSimd ? PixelConvert::Simd::Best : PixelConvert::Simd::Scalar;
+	levels.resize(levelCount);
+	levels[0].width = width;
+	levels[0].height = height;
+	levels[0].data.resize(static_cast<size_t>(width) * height * 4);
+	std::vector<float> current(levels[0].data.size());
+	ForEachRows(height, pool, [&](uint32_t firstRow, uint32_t lastRow)
+	{
+		for (uint32_t y = firstRow; y < lastRow; ++y)
+		{
+			const uint8_t* srcRow = rgba + y * rowPitch;
+			size_t offset = static_cast<size_t>(y) * width * 4;
+			memcpy(levels[0].data.data() + offset, srcRow, static_cast<size_t>(width) * 4);
+			PixelConvert::UnpackRgba(srcRow, current.data() + offset, width, options.srgb, convertSimd);
+		}
+	});
+
+	float reference = options.alphaReference;
+	float targetCoverage = reference >= 0.0f ? ComputeCoverage(rgba, width, height, rowPitch, reference) : 0.0f;
+
+	std::vector<float> resampled, next;
+	uint32_t srcWidth = width, srcHeight = height;
+	for (uint32_t level = 1; level < levelCount; ++level)
+	{
+		uint32_t dstWidth = (std::max)(srcWidth / 2, 1u), dstHeight = (std::max)(srcHeight / 2, 1u);
+		Axis axisX = BuildAxis(srcWidth, dstWidth, options.filter, options.wrap);
+		Axis axisY = BuildAxis(srcHeight, dstHeight, options.filter, options.wrap);
+
+		resampled.resize(static_cast<size_t>(dstWidth) * srcHeight * 4);
+		ForEachRows(srcHeight, pool, [&](uint32_t firstRow, uint32_t lastRow)
+		{
+#ifdef MIPGENERATOR_SSE2
+			if (useSimd)
+			{
+				ResampleRowsSSE2(current.data(), srcWidth, resampled.data(), dstWidth, axisX, firstRow, lastRow);
+				return;
+			}
+#endif
+			ResampleRowsScalar(current.data(), srcWidth, resampled.data(), dstWidth, axisX, firstRow, lastRow);
+		});
+
+		next.resize(static_cast<size_t>(dstWidth) * dstHeight * 4);
+		ForEachRows(dstHeight, pool, [&](uint32_t firstRow, uint32_t lastRow)
+		{
+#ifdef MIPGENERATOR_SSE2
+			if (useSimd)
+			{
+				ResampleColumnsSSE2(resampled.data(), next.data(), dstWidth, axisY, firstRow, lastRow);
+				return;
+			}
+#endif
+			ResampleColumnsScalar(resampled.data(), next.data(), dstWidth, axisY, firstRow, lastRow);
+		});
+
+		// 只缩放输出的Alpha，下一级仍由未缩放的结果生成
+		float alphaScale = reference >= 0.0f ? FindCoverageScale(next, targetCoverage, reference) : 1.0f;
+
+		Level& output = levels[level];
+		output.width = dstWidth;
+		output.height = dstHeight;
+		output.data.resize(next.size());
+		ForEachRows(dstHeight, pool, [&](uint32_t firstRow, uint32_t lastRow)
+		{
+			size_t offset = static_cast<size_t>(firstRow) * dstWidth * 4;
+			PixelConvert::PackRgba(next.data() + offset, output.data.data() + offset,
+				static_cast<size_t>(lastRow - firstRow) * dstWidth, options.srgb, alphaScale, convertSimd);
+		});
+
+		current.swap(next);
+		srcWidth = dstWidth;
+		srcHeight = dstHeight;
+	}
+}
+
+float MipGenerator::ComputeCoverage(const uint8_t* rgba, uint32_t width, uint32_t height, size_t rowPitch, float reference)
+{
+	if (width == 0 || height == 0)
+		return 0.0f;
+	size_t count = 0;
+	for (uint32_t y = 0; y < height; ++y)
+	{
+		const uint8_t* row = rgba + y * rowPitch;
+		for (uint32_t x = 0; x < width; ++x)
+			count += row[x * 4 + 3] / 255.0f > reference ? 1 : 0;
+	}
+	return static_cast<float>(count) / (static_cast<float>(width) * height);
+}
@@ -0,0 +1,65 @@
+﻿//***************************************************************************************
+// MipGenerator.h
+// Licensed under the MIT License.
+//
+// 在CPU上为RGBA8图像生成完整的mip链，用于烘焙以及不支持GPU生成mip的纹理数组与立方体贴图
+// - 可分离的重采样，支持盒式、Kaiser窗与Lanczos3滤波，任意尺寸(包括非2的幂)都按比例计算权重
+// - sRGB图像先转换到线性空间滤波，再编码回sRGB；每一级由上一级的浮点结果生成，不累积量化误差
+// - Alpha测试的纹理可以按参考值缩放每级的Alpha，使通过测试的像素比例与第0级相同
+// - 按行在线程池中并行，滤波有SSE2实现，与标量实现的结果逐字节相同
+// CPU mip-chain generator with box, Kaiser and Lanczos filters, sRGB-correct
+// filtering, alpha-test coverage preservation, SSE2 kernels and row parallelism.
+//***************************************************************************************
+
+#ifndef MIPGENERATOR_H
+#define MIPGENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class ThreadPool;
+
+namespace MipGenerator
+{
+	enum class Filter
+	{
+		Box,		// 2x2平均，最快
+		Kaiser,		// Kaiser窗的sinc，半径3
+		Lanczos		// Lanczos3
+	};
+
+	struct Options
+	{
+		Filter filter;
+		bool srgb;					// 前三个通道为sRGB编码
+		bool wrap;					// 采样超出边缘时环绕(平铺的纹理)，否则重复边缘
+		float alphaReference;		// 不小于0时为Alpha测试的参考值(0~1)，保持每级的覆盖率
+	};
+
+	// 默认: Kaiser滤波，sRGB，重复边缘，不调整Alpha
+	Options GetDefaultOptions();
+
+	// 一级mip，RGBA8紧密排列
+	struct Level
+	{
+		uint32_t width;
+		uint32_t height;
+		std::vector<uint8_t> data;
+	};
+
+	// 完整mip链的级数
+	uint32_t GetMipCount(uint32_t width, uint32_t height);
+
+	// 生成完整的mip链，levels[0]为源图像的副本
+	// [In]rowPitch		源图像一行的字节数，可以是更大图像中一块区域的行距(如立方体贴图展开图中的一个面)
+	// [In]maxLevels	最多生成的级数(包括第0级)，0表示完整的mip链
+	// pool不为nullptr时按行并行，allowSimd为false时只使用标量实现
+	void Generate(const uint8_t* rgba, uint32_t width, uint32_t height, size_t rowPitch, const Options& options,
+		std::vector<Level>& levels, uint32_t maxLevels = 0, ThreadPool* pool = nullptr, bool allowSimd = true);
+
+	// Alpha大于reference(0~1)的像素比例
+	float ComputeCoverage(const uint8_t* rgba, uint32_t width, uint32_t height, size_t rowPitch, float reference);
+}
+
+#endif
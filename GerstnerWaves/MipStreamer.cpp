@@ -0,0 +1,357 @@
+﻿#include "MipStreamer.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+
+struct MipStreamer::Impl
+{
+	struct Texture
+	{
+		DdsReader reader;
+		std::shared_ptr<void> owner;
+		std::vector<size_t> mipBytes;	// 每级mip所有数组元素的字节数
+		uint32_t tailMip;
+		uint32_t residentMip;
+		uint32_t desiredMip;
+		uint32_t pendingMip;			// 正在或已经读入的mip，没有时为UINT32_MAX
+		bool pendingReady;
+	};
+
+	static const uint32_t kNoPending = UINT32_MAX;
+
+	size_t GetBytes(const Texture& texture, uint32_t firstMip) const;
+	// 在工作线程上读入一级mip
+	void Read(const Texture& texture, uint32_t mip);
+
+	ThreadPool* pPool;
+	uint32_t tailDimension;
+	TextureId nextId;
+	// Texture的地址在移除前不变，后台任务可以直接引用
+	std::map<TextureId, std::unique_ptr<Texture>> textures;
+
+	size_t fullBytes;
+	size_t tailBytes;
+	size_t residentBytes;
+	size_t peakResidentBytes;
+	uint64_t streamedBytes;
+	uint64_t evictedBytes;
+	size_t uploadCredit;				// 尚未用完的上传额度
+
+	// 以下成员由后台任务访问
+	std::mutex mutex;
+	std::condition_variable idleCondition;
+	size_t runningCount;
+};
+
+namespace
+{
+	// 逐页读取一遍，使映射文件的页面在工作线程上调入内存，之后在主线程上传时不再产生缺页
+	uint32_t TouchPages(const uint8_t* data, size_t size)
+	{
+		const size_t kPageSize = 4096;
+		uint32_t sum = 0;
+		for (size_t offset = 0; offset < size; offset += kPageSize)
+			sum += data[offset];
+		if (size > 0)
+			sum += data[size - 1];
+		return sum;
+	}
+}
+
+size_t MipStreamer::Impl::GetBytes(const Texture& texture, uint32_t firstMip) const
+{
+	size_t bytes = 0;
+	for (size_t i = firstMip; i < texture.mipBytes.size(); ++i)
+		bytes += texture.mipBytes[i];
+	return bytes;
+}
+
+void MipStreamer::Impl::Read(const Texture& texture, uint32_t mip)
+{
+	volatile uint32_t sink = 0;
+	for (uint32_t item = 0; item < texture.reader.GetArraySize(); ++item)
+	{
+		const DdsReader::Subresource& subresource = texture.reader.GetSubresource(item, mip);
+		sink += TouchPages(subresource.data, subresource.slicePitch * subresource.depth);
+	}
+	(void)sink;
+}
+
+MipStreamer::MipStreamer(ThreadPool* pPool, uint32_t tailDimension)
+	: m_pImpl(new Impl)
+{
+	m_pImpl->pPool = pPool;
+	m_pImpl->tailDimension = (std::max)(tailDimension, 1u);
+	m_pImpl->nextId = kInvalidId + 1;
+	m_pImpl->fullBytes = 0;
+	m_pImpl->tailBytes = 0;
+	m_pImpl->residentBytes = 0;
+	m_pImpl->peakResidentBytes = 0;
+	m_pImpl->streamedBytes = 0;
+	m_pImpl->evictedBytes = 0;
+	m_pImpl->uploadCredit = 0;
+	m_pImpl->runningCount = 0;
+}
+
+MipStreamer::~MipStreamer()
+{
+	std::unique_lock<std::mutex> lock(m_pImpl->mutex);
+	m_pImpl->idleCondition.wait(lock, [this] { return m_pImpl->runningCount == 0; });
+}
+
+MipStreamer::TextureId MipStreamer::Add(const DdsReader& reader, std::shared_ptr<void> owner)
+{
+	std::unique_ptr<Impl::Texture> pTexture(new Impl::Texture);
+	pTexture->reader = reader;
+	pTexture->owner = std::move(owner);
+	pTexture->mipBytes.resize(reader.GetMipCount());
+	for (uint32_t item = 0; item < reader.GetArraySize(); ++item)
+	{
+		for (uint32_t mip = 0; mip < reader.GetMipCount(); ++mip)
+		{
+			const DdsReader::Subresource& subresource = reader.GetSubresource(item, mip);
+			pTexture->mipBytes[mip] += subresource.slicePitch * subresource.depth;
+		}
+	}
+
+	uint32_t tailMip = 0;
+	while (tailMip + 1 < reader.GetMipCount() &&
+		(std::max)(reader.GetWidth() >> tailMip, reader.GetHeight() >> tailMip) > m_pImpl->tailDimension)
+		++tailMip;
+	pTexture->tailMip = pTexture->residentMip = pTexture->desiredMip = tailMip;
+	pTexture->pendingMip = Impl::kNoPending;
+	pTexture->pendingReady = false;
+
+	Impl& impl = *m_pImpl;
+	size_t tailBytes = impl.GetBytes(*pTexture, tailMip);
+	impl.fullBytes += impl.GetBytes(*pTexture, 0);
+	impl.tailBytes += tailBytes;
+	impl.residentBytes += tailBytes;
+	impl.peakResidentBytes = (std::max)(impl.peakResidentBytes, impl.residentBytes);
+
+	TextureId id = impl.nextId++;
+	impl.textures[id] = std::move(pTexture);
+	return id;
+}
+
+void MipStreamer::Remove(TextureId id)
+{
+	Impl& impl = *m_pImpl;
+	auto it = impl.textures.find(id);
+	if (it == impl.textures.end())
+		return;
+
+	// 后台任务可能仍在读取该纹理
+	{
+		std::unique_lock<std::mutex> lock(impl.mutex);
+		impl.idleCondition.wait(lock, [&] { return it->second->pendingMip == Impl::kNoPending || it->second->pendingReady; });
+	}
+	impl.fullBytes -= impl.GetBytes(*it->second, 0);
+	impl.tailBytes -= impl.GetBytes(*it->second, it->second->tailMip);
+	impl.residentBytes -= impl.GetBytes(*it->second, it->second->residentMip);
+	impl.textures.erase(it);
+}
+
+const DdsReader& MipStreamer::GetReader(TextureId id) const
+{
+	return m_pImpl->textures.at(id)->reader;
+}
+
+uint32_t MipStreamer::GetTailMip(TextureId id) const
+{
+	return m_pImpl->textures.at(id)->tailMip;
+}
+
+uint32_t MipStreamer::GetResidentMip(TextureId id) const
+{
+	return m_pImpl->textures.at(id)->residentMip;
+}
+
+uint32_t MipStreamer::GetDesiredMip(TextureId id) const
+{
+	return m_pImpl->textures.at(id)->desiredMip;
+}
+
+void MipStreamer::SetDesiredMip(TextureId id, uint32_t mip)
+{
+	Impl::Texture& texture = *m_pImpl->textures.at(id);
+	texture.desiredMip = (std::min)(mip, texture.tailMip);
+}
+
+void MipStreamer::Update(size_t uploadBudget, const Uploader& upload, const ResidencyCallback& residency)
+{
+	Impl& impl = *m_pImpl;
+
+	// 按期望与驻留相差的级数从多到少排序，相同时按添加顺序
+	std::vector<std::pair<TextureId, Impl::Texture*>> order;
+	order.reserve(impl.textures.size());
+	for (auto& it : impl.textures)
+		order.emplace_back(it.first, it.second.get());
+	std::stable_sort(order.begin(), order.end(), [](const std::pair<TextureId, Impl::Texture*>& lhs,
+		const std::pair<TextureId, Impl::Texture*>& rhs) {
+		int lhsGap = static_cast<int>(lhs.second->residentMip) - static_cast<int>(lhs.second->desiredMip);
+		int rhsGap = static_cast<int>(rhs.second->residentMip) - static_cast<int>(rhs.second->desiredMip);
+		return lhsGap > rhsGap;
+	});
+
+	//
+	// 降级: 期望比驻留低两级以上时，留一级余量避免在边界处反复加载
+	//
+	for (auto& it : order)
+	{
+		Impl::Texture& texture = *it.second;
+		if (texture.desiredMip > texture.residentMip + 1)
+		{
+			size_t bytes = impl.GetBytes(texture, texture.residentMip) - impl.GetBytes(texture, texture.desiredMip - 1);
+			texture.residentMip = texture.desiredMip - 1;
+			impl.residentBytes -= bytes;
+			impl.evictedBytes += bytes;
+			if (residency)
+				residency(it.first, texture.residentMip);
+		}
+	}
+
+	//
+	// 上传已读入的mip
+	// 每次Update增加uploadBudget的额度，比额度大的mip等额度累积够了再上传，
+	// 此时不上传优先级更低的mip，避免大的mip一直得不到上传
+	//
+	size_t maxMipBytes = uploadBudget;
+	for (auto& it : order)
+	{
+		if (it.second->residentMip > it.second->desiredMip)
+			maxMipBytes = (std::max)(maxMipBytes, it.second->mipBytes[it.second->residentMip - 1]);
+	}
+	impl.uploadCredit = (std::min)(impl.uploadCredit + uploadBudget, maxMipBytes);
+	for (auto& it : order)
+	{
+		Impl::Texture& texture = *it.second;
+		{
+			std::lock_guard<std::mutex> lock(impl.mutex);
+			if (texture.pendingMip == Impl::kNoPending || !texture.pendingReady)
+				continue;
+		}
+
+		// 读入期间期望已经提高或者发生了降级，这一级不再需要
+		uint32_t mip = texture.pendingMip;
+		if (mip != texture.residentMip - 1 || mip < texture.desiredMip)
+		{
+			std::lock_guard<std::mutex> lock(impl.mutex);
+			texture.pendingMip = Impl::kNoPending;
+			texture.pendingReady = false;
+			continue;
+		}
+
+		size_t bytes = texture.mipBytes[mip];
+		if (bytes > impl.uploadCredit)
+			break;
+		if (upload)
+			upload(it.first, mip);
+		texture.residentMip = mip;
+		impl.uploadCredit -= bytes;
+		impl.residentBytes += bytes;
+		impl.streamedBytes += bytes;
+		impl.peakResidentBytes = (std::max)(impl.peakResidentBytes, impl.residentBytes);
+		if (residency)
+			residency(it.first, mip);
+		{
+			std::lock_guard<std::mutex> lock(impl.mutex);
+			texture.pendingMip = Impl::kNoPending;
+			texture.pendingReady = false;
+		}
+	}
+
+	//
+	// 发起新的读入，每个纹理同时只读入下一级
+	//
+	for (auto& it : order)
+	{
+		Impl::Texture& texture = *it.second;
+		if (texture.residentMip <= texture.desiredMip)
+			continue;
+		{
+			std::lock_guard<std::mutex> lock(impl.mutex);
+			if (texture.pendingMip != Impl::kNoPending)
+				continue;
+			texture.pendingMip = texture.residentMip - 1;
+			texture.pendingReady = !impl.pPool;
+			if (impl.pPool)
+				++impl.runningCount;
+		}
+
+		uint32_t mip = texture.pendingMip;
+		if (!impl.pPool)
+		{
+			impl.Read(texture, mip);
+			continue;
+		}
+		Impl* pImpl = m_pImpl.get();
+		Impl::Texture* pTexture = &texture;
+		impl.pPool->Enqueue([pImpl, pTexture, mip] {
+			pImpl->Read(*pTexture, mip);
+			std::lock_guard<std::mutex> lock(pImpl->mutex);
+			pTexture->pendingReady = true;
+			--pImpl->runningCount;
+			pImpl->idleCondition.notify_all();
+		});
+	}
+
+	// 同步读入时，本次发起的读入可以在同一次Update中上传
+	if (!impl.pPool)
+	{
+		for (auto& it : order)
+		{
+			Impl::Texture& texture = *it.second;
+			if (texture.pendingMip == Impl::kNoPending)
+				continue;
+			size_t bytes = texture.mipBytes[texture.pendingMip];
+			if (bytes > impl.uploadCredit)
+				break;
+			uint32_t mip = texture.pendingMip;
+			if (upload)
+				upload(it.first, mip);
+			texture.residentMip = mip;
+			texture.pendingMip = Impl::kNoPending;
+			texture.pendingReady = false;
+			impl.uploadCredit -= bytes;
+			impl.residentBytes += bytes;
+			impl.streamedBytes += bytes;
+			impl.peakResidentBytes = (std::max)(impl.peakResidentBytes, impl.residentBytes);
+			if (residency)
+				residency(it.first, mip);
+		}
+	}
+}
+
+MipStreamer::Statistics MipStreamer::GetStatistics() const
+{
+	Impl& impl = *m_pImpl;
+	Statistics statistics = {};
+	statistics.textureCount = impl.textures.size();
+	statistics.fullBytes = impl.fullBytes;
+	statistics.tailBytes = impl.tailBytes;
+	statistics.residentBytes = impl.residentBytes;
+	statistics.peakResidentBytes = impl.peakResidentBytes;
+	statistics.streamedBytes = impl.streamedBytes;
+	statistics.evictedBytes = impl.evictedBytes;
+	std::lock_guard<std::mutex> lock(impl.mutex);
+	for (const auto& it : impl.textures)
+	{
+		if (it.second->pendingMip != Impl::kNoPending)
+			++statistics.pendingCount;
+		if (it.second->residentMip > it.second->desiredMip)
+			++statistics.belowDesiredCount;
+	}
+	return statistics;
+}
+
+float MipStreamer::ComputeDesiredMip(uint32_t textureSize, float worldSize, float distance, float fovY, float viewportHeight)
+{
+	// 距离distance处每个世界单位在屏幕上占的像素数，与每个世界单位的纹素数之比决定mip
+	float pixelsPerUnit = viewportHeight / (2.0f * (std::max)(distance, 1e-3f) * std::tan(fovY * 0.5f));
+	float texelsPerUnit = textureSize / (std::max)(worldSize, 1e-6f);
+	return std::log2(texelsPerUnit / pixelsPerUnit);
+}
@@ -0,0 +1,91 @@
+﻿//***************************************************************************************
+// MipStreamer.h
+// Licensed under the MIT License.
+//
+// DDS纹理的mip流式加载
+// - 添加纹理时只需要上传mip尾部(最大边长不超过tailDimension的几级)，纹理立即可用
+// - 每个纹理由使用者按距离与屏幕尺寸给出期望的mip(见ComputeDesiredMip)
+// - 更高的mip在线程池中预先读入(映射文件的页面)，Update在调用线程上按每次的上传预算逐级上传
+// - 期望的mip比驻留的低两级以上时立即降级，驻留字节数随之减少
+// - 不依赖D3D，上传与限制采样范围由回调完成(见d3dUtil的CreateStreamingTextureFromDds)
+// Progressive mip streaming: the mip tail is resident immediately, higher mips are
+// paged in on a thread pool and uploaded in order within a per-update byte budget.
+//***************************************************************************************
+
+#ifndef MIPSTREAMER_H
+#define MIPSTREAMER_H
+
+#include "DdsReader.h"
+#include <functional>
+#include <memory>
+
+class ThreadPool;
+
+class MipStreamer
+{
+public:
+	typedef uint32_t TextureId;
+	static const TextureId kInvalidId = 0;
+	// 默认最大边长不超过64的mip属于尾部
+	static const uint32_t kDefaultTailDimension = 64;
+
+	// 上传第mip级(所有数组元素)，数据即纹理对应DdsReader中的子资源，在Update的调用线程上执行
+	typedef std::function<void(TextureId id, uint32_t mip)> Uploader;
+	// 驻留的最高一级mip改变(上传完成或降级)后调用，使用者据此限制采样的mip范围
+	typedef std::function<void(TextureId id, uint32_t residentMip)> ResidencyCallback;
+
+	struct Statistics
+	{
+		size_t textureCount;
+		size_t fullBytes;				// 所有纹理完整mip链的大小
+		size_t tailBytes;				// 添加时立即上传的mip尾部大小
+		size_t residentBytes;			// 当前驻留的大小
+		size_t peakResidentBytes;		// 驻留大小的峰值
+		uint64_t streamedBytes;			// 流式上传的总字节数(不含尾部)
+		uint64_t evictedBytes;			// 降级释放的总字节数
+		size_t pendingCount;			// 正在读入的mip数目
+		size_t belowDesiredCount;		// 驻留的mip低于期望的纹理数目
+	};
+
+	// pPool为nullptr时在Update中同步读入
+	explicit MipStreamer(ThreadPool* pPool = nullptr, uint32_t tailDimension = kDefaultTailDimension);
+	// 等待正在进行的读入完成
+	~MipStreamer();
+
+	MipStreamer(const MipStreamer&) = delete;
+	MipStreamer& operator=(const MipStreamer&) = delete;
+
+	// 添加解析好的纹理，owner持有reader引用的数据(例如映射的文件)，在纹理移除前保持有效
+	// 添加后期望的mip为尾部，驻留的mip为GetTailMip
+	TextureId Add(const DdsReader& reader, std::shared_ptr<void> owner = nullptr);
+	void Remove(TextureId id);
+
+	const DdsReader& GetReader(TextureId id) const;
+	// 最大边长不超过tailDimension的第一级mip，使用者创建纹理时需要上传从这一级开始的所有mip
+	uint32_t GetTailMip(TextureId id) const;
+	uint32_t GetResidentMip(TextureId id) const;
+	uint32_t GetDesiredMip(TextureId id) const;
+	void SetDesiredMip(TextureId id, uint32_t mip);
+
+	// 上传已读入的mip，然后发起新的读入
+	// 平均每次上传不超过uploadBudget字节，比它大的mip会在额度累积够之后上传
+	// 需要升级的纹理按期望与驻留相差的级数从多到少处理
+	void Update(size_t uploadBudget, const Uploader& upload, const ResidencyCallback& residency);
+
+	Statistics GetStatistics() const;
+
+	// 估计物体需要的mip
+	// [In]textureSize			纹理的最大边长
+	// [In]worldSize			纹理重复一次覆盖的世界空间大小
+	// [In]distance				摄像机到物体最近点的距离
+	// [In]fovY					竖直方向的视野角度(弧度)
+	// [In]viewportHeight		视口高度(像素)
+	// 返回值可能为负或超出mip数目，由调用者截取
+	static float ComputeDesiredMip(uint32_t textureSize, float worldSize, float distance, float fovY, float viewportHeight);
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_pImpl;
+};
+
+#endif
@@ -49,26 +49,45 @@ void Model::SetModel(ID3D11Device* device, const ObjReader& model)
 		InitData.pSysMem = part.vertices.data();
 		HR(device->CreateBuffer(&vbd, &InitData, modelParts[i].vertexBuffer.ReleaseAndGetAddressOf()));
 
+		// 所有LOD的索引依次存放在同一个索引缓冲区中
+		bool use32 = modelParts[i].vertexCount > 65535;
+		modelParts[i].indexCount = (UINT)(use32 ? part.indices32.size() : part.indices16.size());
+		modelParts[i].indexFormat = use32 ? DXGI_FORMAT_R32_UINT : DXGI_FORMAT_R16_UINT;
+		modelParts[i].lods.resize(1 + part.lods.size());
+		modelParts[i].lods[0] = ModelPartLod{ 0, modelParts[i].indexCount, 0.0f };
+		modelParts[i].clusters = part.clusters;
+		modelParts[i].boundingBox = part.boundingBox;
+		modelParts[i].boundingSphere = part.boundingSphere;
+
+		std::vector<WORD> indices16(part.indices16);
+		std::vector<DWORD> indices32(part.indices32);
+		for (size_t j = 0; j < part.lods.size(); ++j)
+		{
+			auto& lod = part.lods[j];
+			UINT startIndex = (UINT)(use32 ? indices32.size() : indices16.size());
+			UINT lodIndexCount = (UINT)(use32 ? lod.indices32.size() : lod.indices16.size());
+			modelParts[i].lods[j + 1] = ModelPartLod{ startIndex, lodIndexCount, lod.error };
+			if (use32)
+				indices32.insert(indices32.end(), lod.indices32.begin(), lod.indices32.end());
+			else
+				indices16.insert(indices16.end(), lod.indices16.begin(), lod.indices16.end());
+		}
+
 		// 设置索引缓冲区描述
 		D3D11_BUFFER_DESC ibd;
 		ZeroMemory(&ibd, sizeof(ibd));
 		ibd.Usage = D3D11_USAGE_IMMUTABLE;
 		ibd.BindFlags = D3D11_BIND_INDEX_BUFFER;
 		ibd.CPUAccessFlags = 0;
-		if (modelParts[i].vertexCount > 65535)
+		if (use32)
 		{
-			modelParts[i].indexCount = (UINT)part.indices32.size();
-			modelParts[i].indexFormat = DXGI_FORMAT_R32_UINT;
-			ibd.ByteWidth = modelParts[i].indexCount * (UINT)sizeof(DWORD);
-			InitData.pSysMem = part.indices32.data();
-
+			ibd.ByteWidth = (UINT)indices32.size() * (UINT)sizeof(DWORD);
+			InitData.pSysMem = indices32.data();
 		}
 		else
 		{
-			modelParts[i].indexCount = (UINT)part.indices16.size();
-			modelParts[i].indexFormat = DXGI_FORMAT_R16_UINT;
-			ibd.ByteWidth = modelParts[i].indexCount * (UINT)sizeof(WORD);
-			InitData.pSysMem = part.indices16.data();
+			ibd.ByteWidth = (UINT)indices16.size() * (UINT)sizeof(WORD);
+			InitData.pSysMem = indices16.data();
 		}
 		// 新建索引缓冲区
 		HR(device->CreateBuffer(&ibd, &InitData, modelParts[i].indexBuffer.ReleaseAndGetAddressOf()));
@@ -78,16 +97,8 @@ void Model::SetModel(ID3D11Device* device, const ObjReader& model)
 		auto& strD = part.texStrDiffuse;
 		if (strD.size() > 4)
 		{
-			if (strD.substr(strD.size() - 3, 3) == L"dds")
-			{
-				HR(CreateDDSTextureFromFile(device, strD.c_str(), nullptr,
-					modelParts[i].texDiffuse.GetAddressOf()));
-			}
-			else
-			{
-				HR(CreateWICTextureFromFile(device, strD.c_str(), nullptr,
-					modelParts[i].texDiffuse.GetAddressOf()));
-			}
+			HR(CreateTextureFromCache(device, strD.c_str(), modelParts[i].texDiffuse.GetAddressOf(),
+				modelParts[i].texDiffuseReference));
 		}
 
 		modelParts[i].material = part.material;
@@ -105,6 +116,22 @@ void Model::SetMesh(ID3D11Device* device, const void* vertices, UINT vertexSize,
 	modelParts[0].vertexCount = vertexCount;
 	modelParts[0].indexCount = indexCount;
 	modelParts[0].indexFormat = indexFormat;
+	modelParts[0].lods.assign(1, ModelPartLod{ 0, indexCount, 0.0f });
+	modelParts[0].clusters.clear();
+
+	// 创建包围盒与包围球，要求顶点的前12字节为位置
+	if (vertexCount > 0)
+	{
+		const XMFLOAT3* pPositions = reinterpret_cast<const XMFLOAT3*>(vertices);
+		BoundingBox::CreateFromPoints(boundingBox, vertexCount, pPositions, vertexSize);
+		BoundingSphere::CreateFromPoints(modelParts[0].boundingSphere, vertexCount, pPositions, vertexSize);
+	}
+	else
+	{
+		boundingBox = BoundingBox(XMFLOAT3(), XMFLOAT3());
+		modelParts[0].boundingSphere = BoundingSphere(XMFLOAT3(), 0.0f);
+	}
+	modelParts[0].boundingBox = boundingBox;
 
 	modelParts[0].material.ambient = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
 	modelParts[0].material.diffuse = XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f);
@@ -14,6 +14,14 @@
 #include "ObjReader.h"
 #include "Geometry.h"
 
+// 一级LOD在索引缓冲区中的范围
+struct ModelPartLod
+{
+	UINT startIndex;
+	UINT indexCount;
+	float error;			// 模型空间下的几何误差
+};
+
 struct ModelPart
 {
 	// 使用模板别名(C++11)简化类型名
@@ -21,7 +29,7 @@ struct ModelPart
 	using ComPtr = Microsoft::WRL::ComPtr<T>;
 
 	ModelPart() : material(), texDiffuse(), vertexBuffer(), indexBuffer(),
-		vertexCount(), indexCount(), indexFormat() {}
+		vertexCount(), indexCount(), indexFormat(), lods(), clusters(), boundingBox(), boundingSphere() {}
 
 	ModelPart(const ModelPart&) = default;
 	ModelPart& operator=(const ModelPart&) = default;
@@ -32,12 +40,17 @@ struct ModelPart
 
 	Material material;
 	ComPtr<ID3D11ShaderResourceView> texDiffuse;
+	std::shared_ptr<void> texDiffuseReference;	// 漫射光纹理在资源缓存中的引用(见ResourceCache)
 	ComPtr<ID3D11ShaderResourceView> texNormalMap;
 	ComPtr<ID3D11Buffer> vertexBuffer;
 	ComPtr<ID3D11Buffer> indexBuffer;
 	UINT vertexCount;
 	UINT indexCount;
 	DXGI_FORMAT indexFormat;
+	std::vector<ModelPartLod> lods;		// lods[0]为完整网格，所有LOD共用顶点缓冲区与索引缓冲区
+	std::vector<MeshCluster::Cluster> clusters;	// lods[0]的三角形簇(模型空间)，用于CPU端的簇裁剪
+	DirectX::BoundingBox boundingBox;			// 模型空间下Part的AABB盒
+	DirectX::BoundingSphere boundingSphere;		// 模型空间下Part的包围球
 };
 
 struct Model
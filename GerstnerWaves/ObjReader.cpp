@@ -1,214 +1,950 @@
 ﻿#include "ObjReader.h"
+#include "GlbReader.h"
+#include "AssetPackage.h"
+#include <Psapi.h>
+#include <chrono>
+#include <list>
+
+#pragma comment(lib, "psapi.lib")
 
 using namespace DirectX;
-bool ObjReader::Read(const wchar_t* mboFileName, const wchar_t* objFileName)
+
+namespace
 {
-	if (mboFileName && ReadMbo(mboFileName))
+	// .mbo文件标识与当前版本
+	const UINT kMboMagic = 0x004F424D;		// "MBO\0"
+	const UINT kMboVersion = 6;
+
+	// .mbo中顶点的存储格式(版本4)
+	const UINT kMboVertexFloat = 0;			// VertexPosNormalTex，32字节
+	const UINT kMboVertexQuantized = 1;		// VertexCompression::PackedVertex，16字节
+
+	static_assert(sizeof(VertexPosNormalTex) == sizeof(VertexCompression::FloatVertex),
+		"VertexPosNormalTex must match the layout of VertexCompression::FloatVertex!");
+	static_assert(sizeof(BoundingBox) == 24 && sizeof(BoundingSphere) == 16,
+		"The layout of BoundingBox and BoundingSphere is stored in .mbo files!");
+
+	const VertexCompression::FloatVertex* AsFloatVertices(const std::vector<VertexPosNormalTex>& vertices)
 	{
-		return true;
+		return reinterpret_cast<const VertexCompression::FloatVertex*>(vertices.data());
 	}
-	else if (objFileName)
+
+	// 往返解码的误差不能超出各属性量化精度的理论上限
+	bool IsRoundTripExact(const std::vector<VertexPosNormalTex>& vertices,
+		const VertexCompression::QuantizationParams& params, const VertexCompression::ErrorStatistics& error)
 	{
-		bool status = ReadObj(objFileName);
-		if (status && mboFileName)
-			return WriteMbo(mboFileName);
+		const float* s = params.posScale;
+		float maxPosError = 0.5f * sqrtf(s[0] * s[0] + s[1] * s[1] + s[2] * s[2]) * 1.001f + 1e-6f;
+
+		// 半精度浮点的舍入误差为半个ulp，即相对误差2^-11
+		float maxTex = 0.0f;
+		for (const auto& vertex : vertices)
+			maxTex = (std::max)(maxTex, (std::max)(fabsf(vertex.tex.x), fabsf(vertex.tex.y)));
+		float maxTexError = maxTex / 2048.0f + 1e-7f;
+
+		return error.maxPosError <= maxPosError && error.maxNormalError <= 0.05f &&
+			error.maxTexError <= maxTexError;
+	}
+
+	static_assert(sizeof(DWORD) == sizeof(uint32_t), "DWORD indices are decoded as uint32_t!");
+
+	// 索引读写的统计，用于输出压缩率与解码速度
+	struct IndexStatistics
+	{
+		size_t rawBytes = 0;
+		size_t compressedBytes = 0;
+		double decodeSeconds = 0.0;
+	};
+
+	// 以只读的方式将一段内存包装为输入流，用于从资源包的视图中读取.mbo
+	class MemoryStreamBuf : public std::streambuf
+	{
+	public:
+		MemoryStreamBuf(const void* data, size_t size)
+		{
+			char* begin = const_cast<char*>(static_cast<const char*>(data));
+			setg(begin, begin, begin + size);
+		}
+	};
+
+	// 顶点数超过WORD能表示的范围时才使用32位索引，读写.mbo与所有修改索引的步骤都按此选择索引格式
+	bool UseIndex32(size_t vertexCount)
+	{
+		return vertexCount > 65535;
+	}
+
+	bool ReadIndices(std::istream& fin, bool use32, bool compressed, UINT indexCount,
+		std::vector<WORD>& indices16, std::vector<DWORD>& indices32, IndexStatistics& stats)
+	{
+		indices16.clear();
+		indices32.clear();
+		if (use32)
+			indices32.resize(indexCount);
+		else
+			indices16.resize(indexCount);
+
+		if (!compressed)
+		{
+			if (use32)
+				fin.read(reinterpret_cast<char*>(indices32.data()), indexCount * sizeof(DWORD));
+			else
+				fin.read(reinterpret_cast<char*>(indices16.data()), indexCount * sizeof(WORD));
+			return true;
+		}
+
+		UINT byteCount = 0;
+		// [压缩后字节数]4字节
+		fin.read(reinterpret_cast<char*>(&byteCount), sizeof(UINT));
+		// [压缩后的索引]
+		std::vector<uint8_t> buffer(byteCount);
+		fin.read(reinterpret_cast<char*>(buffer.data()), byteCount);
+		if (!fin)
+			return false;
+
+		auto start = std::chrono::high_resolution_clock::now();
+		bool status = use32 ?
+			IndexCompression::Decode(reinterpret_cast<uint32_t*>(indices32.data()), indexCount, buffer.data(), byteCount) :
+			IndexCompression::Decode(indices16.data(), indexCount, buffer.data(), byteCount);
+		auto end = std::chrono::high_resolution_clock::now();
+
+		stats.rawBytes += indexCount * (use32 ? sizeof(DWORD) : sizeof(WORD));
+		stats.compressedBytes += byteCount;
+		stats.decodeSeconds += std::chrono::duration<double>(end - start).count();
 		return status;
 	}
 
-	return false;
-}
+	void WriteIndices(std::ofstream& fout, bool use32, const std::vector<WORD>& indices16, const std::vector<DWORD>& indices32,
+		IndexStatistics& stats)
+	{
+		size_t indexCount = use32 ? indices32.size() : indices16.size();
+		std::vector<uint8_t> buffer(IndexCompression::GetEncodeBound(indexCount));
+		size_t byteCount = use32 ?
+			IndexCompression::Encode(buffer.data(), buffer.size(), reinterpret_cast<const uint32_t*>(indices32.data()), indexCount) :
+			IndexCompression::Encode(buffer.data(), buffer.size(), indices16.data(), indexCount);
 
-bool ObjReader::ReadObj(const wchar_t* objFileName)
-{
-	objParts.clear();
-	vertexCache.clear();
+		UINT compressedSize = (UINT)byteCount;
+		// [压缩后字节数]4字节
+		fout.write(reinterpret_cast<const char*>(&compressedSize), sizeof(UINT));
+		// [压缩后的索引]
+		fout.write(reinterpret_cast<const char*>(buffer.data()), byteCount);
 
-	MtlReader mtlReader;
+		stats.rawBytes += indexCount * (use32 ? sizeof(DWORD) : sizeof(WORD));
+		stats.compressedBytes += byteCount;
+	}
 
-	std::vector<XMFLOAT3>   positions;
-	std::vector<XMFLOAT3>   normals;
-	std::vector<XMFLOAT2>   texCoords;
+	// 获取Part的32位索引
+	std::vector<uint32_t> GetPartIndices(const ObjReader::ObjPart& part)
+	{
+		if (!part.indices32.empty())
+			return std::vector<uint32_t>(part.indices32.begin(), part.indices32.end());
+		return std::vector<uint32_t>(part.indices16.begin(), part.indices16.end());
+	}
 
-	XMVECTOR vecMin = g_XMInfinity, vecMax = g_XMNegInfinity;
+	// 按照Part当前的顶点数选择索引格式写回索引(重排顶点时可能删去未使用的顶点，使顶点数减少)
+	void SetPartIndices(ObjReader::ObjPart& part, const std::vector<uint32_t>& indices)
+	{
+		if (UseIndex32(part.vertices.size()))
+		{
+			part.indices16.clear();
+			part.indices32.assign(indices.begin(), indices.end());
+		}
+		else
+		{
+			part.indices32.clear();
+			part.indices16.resize(indices.size());
+			for (size_t i = 0; i < indices.size(); ++i)
+				part.indices16[i] = static_cast<WORD>(indices[i]);
+		}
+	}
 
-	std::wifstream wfin(objFileName);
-	if (!wfin.is_open())
-		return false;
+	void SetDefaultMaterial(Material& material)
+	{
+		material.ambient = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
+		material.diffuse = XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f);
+		material.specular = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+	}
 
-	// 切换中文
-	std::locale china("chs");
-	china = wfin.imbue(china);
-	for (;;)
+	// 逐条解析.obj文件，解析出的数据交给handler处理，内存导入与流式导入共用
+	// handler需要提供：
+	// OnPart()								新的对象(组)
+	// OnMaterial(material, texStrDiffuse)	当前对象使用的材质
+	// OnPosition(pos)/OnTexCoord(tex)/OnNormal(normal)
+	// OnFace(vpi, vti, vni)				三角形，顶点顺序已经转换为左手坐标系，返回false则中止解析
+	// 引用的.mtl文件会添加到dependencies中
+	template<class Handler>
+	bool ParseObj(const wchar_t* objFileName, Handler& handler, XMFLOAT3& vMin, XMFLOAT3& vMax,
+		std::vector<std::wstring>& dependencies)
 	{
-		std::wstring wstr;
-		if (!(wfin >> wstr))
-			break;
+		MtlReader mtlReader;
 
-		if (wstr[0] == '#')
+		XMVECTOR vecMin = g_XMInfinity, vecMax = g_XMNegInfinity;
+
+		std::wifstream wfin(objFileName);
+		if (!wfin.is_open())
+			return false;
+
+		// 切换中文
+		std::locale china("chs");
+		china = wfin.imbue(china);
+		for (;;)
 		{
-			//
-			// 忽略注释所在行
-			//
-			while (!wfin.eof() && wfin.get() != '\n')
-				continue;
+			std::wstring wstr;
+			if (!(wfin >> wstr))
+				break;
+
+			if (wstr[0] == '#')
+			{
+				//
+				// 忽略注释所在行
+				//
+				while (!wfin.eof() && wfin.get() != '\n')
+					continue;
+			}
+			else if (wstr == L"o" || wstr == L"g")
+			{
+				// 
+				// 对象名(组名)
+				//
+				handler.OnPart();
+			}
+			else if (wstr == L"v")
+			{
+				//
+				// 顶点位置
+				//
+
+				// 注意obj使用的是右手坐标系，而不是左手坐标系
+				// 需要将z值反转
+				XMFLOAT3 pos;
+				wfin >> pos.x >> pos.y >> pos.z;
+				pos.z = -pos.z;
+				handler.OnPosition(pos);
+				XMVECTOR vecPos = XMLoadFloat3(&pos);
+				vecMax = XMVectorMax(vecMax, vecPos);
+				vecMin = XMVectorMin(vecMin, vecPos);
+			}
+			else if (wstr == L"vt")
+			{
+				//
+				// 顶点纹理坐标
+				//
+
+				// 注意obj使用的是笛卡尔坐标系，而不是纹理坐标系
+				float u, v;
+				wfin >> u >> v;
+				v = 1.0f - v;
+				handler.OnTexCoord(XMFLOAT2(u, v));
+			}
+			else if (wstr == L"vn")
+			{
+				//
+				// 顶点法向量
+				//
+
+				// 注意obj使用的是右手坐标系，而不是左手坐标系
+				// 需要将z值反转
+				float x, y, z;
+				wfin >> x >> y >> z;
+				z = -z;
+				handler.OnNormal(XMFLOAT3(x, y, z));
+			}
+			else if (wstr == L"mtllib")
+			{
+				//
+				// 指定某一文件的材质
+				//
+				std::wstring mtlFile;
+				wfin >> mtlFile;
+				// 去掉前后空格
+				size_t beg = 0, ed = mtlFile.size();
+				while (iswspace(mtlFile[beg]))
+					beg++;
+				while (ed > beg&& iswspace(mtlFile[ed - 1]))
+					ed--;
+				mtlFile = mtlFile.substr(beg, ed - beg);
+				// 获取路径
+				std::wstring dir = objFileName;
+				size_t pos;
+				if ((pos = dir.find_last_of('/')) == std::wstring::npos &&
+					(pos = dir.find_last_of('\\')) == std::wstring::npos)
+				{
+					pos = 0;
+				}
+				else
+				{
+					pos += 1;
+				}
+
+
+				dependencies.push_back(dir.erase(pos) + mtlFile);
+				mtlReader.ReadMtl(dependencies.back().c_str());
+			}
+			else if (wstr == L"usemtl")
+			{
+				//
+				// 使用之前指定文件内部的某一材质
+				//
+				std::wstring mtlName;
+				std::getline(wfin, mtlName);
+				// 去掉前后空格
+				size_t beg = 0, ed = mtlName.size();
+				while (iswspace(mtlName[beg]))
+					beg++;
+				while (ed > beg&& iswspace(mtlName[ed - 1]))
+					ed--;
+				mtlName = mtlName.substr(beg, ed - beg);
+
+				handler.OnMaterial(mtlReader.materials[mtlName], mtlReader.mapKdStrs[mtlName]);
+			}
+			else if (wstr == L"f")
+			{
+				//
+				// 几何面
+				//
+				DWORD vpi[3], vni[3], vti[3];
+				wchar_t ignore;
+
+				// 顶点位置索引/纹理坐标索引/法向量索引
+				// 原来右手坐标系下顶点顺序是逆时针排布
+				// 现在需要转变为左手坐标系就需要将三角形顶点反过来输入
+				for (int i = 2; i >= 0; --i)
+				{
+					wfin >> vpi[i] >> ignore >> vti[i] >> ignore >> vni[i];
+				}
+
+				if (!handler.OnFace(vpi, vti, vni))
+					return false;
+
+				while (iswblank(wfin.peek()))
+					wfin.get();
+				// 几何面顶点数可能超过了3，不支持该格式
+				if (wfin.peek() != '\n')
+					return false;
+			}
 		}
-		else if (wstr == L"o" || wstr == L"g")
+
+		XMStoreFloat3(&vMax, vecMax);
+		XMStoreFloat3(&vMin, vecMin);
+
+		return true;
+	}
+
+	// 顶点数不超过WORD的最大值的话就使用16位WORD存储
+	void ShrinkIndices(ObjReader::ObjPart& part)
+	{
+		if (!UseIndex32(part.vertices.size()))
 		{
-			// 
-			// 对象名(组名)
-			//
-			objParts.emplace_back(ObjPart());
-			// 提供默认材质
-			objParts.back().material.ambient = XMFLOAT4(0.2f, 0.2f, 0.2f, 1.0f);
-			objParts.back().material.diffuse = XMFLOAT4(0.8f, 0.8f, 0.8f, 1.0f);
-			objParts.back().material.specular = XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+			for (auto& i : part.indices32)
+			{
+				part.indices16.push_back((WORD)i);
+			}
+			part.indices32.clear();
+		}
+	}
 
-			vertexCache.clear();
+	// 计算Part的AABB盒与包围球
+	// 包围球取Ritter算法的结果与以AABB盒中心为球心的包围球中较小的一个，
+	// 前者适合细长倾斜的Part，后者适合接近轴对齐的Part
+	void ComputePartBounds(ObjReader::ObjPart& part)
+	{
+		if (part.vertices.empty())
+		{
+			part.boundingBox = BoundingBox(XMFLOAT3(), XMFLOAT3());
+			part.boundingSphere = BoundingSphere(XMFLOAT3(), 0.0f);
+			return;
 		}
-		else if (wstr == L"v")
+
+		const XMFLOAT3* pPositions = &part.vertices[0].pos;
+		BoundingBox::CreateFromPoints(part.boundingBox, part.vertices.size(), pPositions, sizeof(VertexPosNormalTex));
+		BoundingSphere::CreateFromPoints(part.boundingSphere, part.vertices.size(), pPositions, sizeof(VertexPosNormalTex));
+
+		XMVECTOR center = XMLoadFloat3(&part.boundingBox.Center);
+		XMVECTOR maxDistSq = XMVectorZero();
+		for (const auto& vertex : part.vertices)
+			maxDistSq = XMVectorMax(maxDistSq, XMVector3LengthSq(XMVectorSubtract(XMLoadFloat3(&vertex.pos), center)));
+		float radius = sqrtf(XMVectorGetX(maxDistSq));
+		if (radius < part.boundingSphere.Radius)
+			part.boundingSphere = BoundingSphere(part.boundingBox.Center, radius);
+	}
+
+	void WriteMboHeader(std::ofstream& fout, UINT parts, const XMFLOAT3& vMin, const XMFLOAT3& vMax)
+	{
+		UINT magic = kMboMagic, version = kMboVersion;
+		// [文件标识] 4字节
+		fout.write(reinterpret_cast<const char*>(&magic), sizeof(UINT));
+		// [版本号] 4字节
+		fout.write(reinterpret_cast<const char*>(&version), sizeof(UINT));
+		// [Part数目] 4字节
+		fout.write(reinterpret_cast<const char*>(&parts), sizeof(UINT));
+		// [AABB盒顶点vMax] 12字节
+		fout.write(reinterpret_cast<const char*>(&vMax), sizeof(XMFLOAT3));
+		// [AABB盒顶点vMin] 12字节
+		fout.write(reinterpret_cast<const char*>(&vMin), sizeof(XMFLOAT3));
+	}
+
+	// 索引必须存放在顶点数对应的格式中，否则按顶点数选择格式写出时会丢失索引
+	bool CheckIndexFormat(const wchar_t* mboFileName, UINT partIndex, const ObjReader::ObjPart& part)
+	{
+		bool use32 = UseIndex32(part.vertices.size());
+		bool valid = (use32 ? part.indices16 : part.indices32).empty();
+		for (const auto& lod : part.lods)
+			valid = valid && (use32 ? lod.indices16 : lod.indices32).empty();
+		if (!valid)
 		{
-			//
-			// 顶点位置
-			//
+			wchar_t strBuffer[256];
+			swprintf_s(strBuffer, L"%ls part[%u]: %zu vertices but indices are stored as %ls\n",
+				mboFileName, partIndex, part.vertices.size(), use32 ? L"WORD" : L"DWORD");
+			OutputDebugStringW(strBuffer);
+		}
+		return valid;
+	}
+
+	bool WriteMboPart(std::ofstream& fout, const wchar_t* mboFileName, UINT partIndex, const ObjReader::ObjPart& part,
+		bool compressVertices, IndexStatistics& indexStats)
+	{
+		if (!CheckIndexFormat(mboFileName, partIndex, part))
+			return false;
 
-			// 注意obj使用的是右手坐标系，而不是左手坐标系
-			// 需要将z值反转
-			XMFLOAT3 pos;
-			wfin >> pos.x >> pos.y >> pos.z;
-			pos.z = -pos.z;
-			positions.push_back(pos);
-			XMVECTOR vecPos = XMLoadFloat3(&pos);
-			vecMax = XMVectorMax(vecMax, vecPos);
-			vecMin = XMVectorMin(vecMin, vecPos);
+		// 结束符之后的部分填0，相同的网格总是写出相同的字节
+		wchar_t filePath[MAX_PATH] = {};
+		part.texStrDiffuse.copy(filePath, MAX_PATH - 1);
+		// [漫射光材质文件名]520字节
+		fout.write(reinterpret_cast<const char*>(filePath), MAX_PATH * sizeof(wchar_t));
+		// [材质]64字节
+		fout.write(reinterpret_cast<const char*>(&part.material), sizeof(Material));
+		UINT vertexCount = (UINT)part.vertices.size();
+		// [顶点数]4字节
+		fout.write(reinterpret_cast<const char*>(&vertexCount), sizeof(UINT));
+
+		bool use32 = UseIndex32(vertexCount);
+		UINT indexCount = (UINT)(use32 ? part.indices32.size() : part.indices16.size());
+		// [索引数]4字节
+		fout.write(reinterpret_cast<const char*>(&indexCount), sizeof(UINT));
+
+		UINT vertexFormat = kMboVertexFloat;
+		VertexCompression::QuantizationParams params = {};
+		std::vector<VertexCompression::PackedVertex> packedVertices;
+		if (compressVertices && vertexCount > 0)
+		{
+			// 压缩后立即解码一遍，校验误差并输出统计
+			const VertexCompression::FloatVertex* floatVertices = AsFloatVertices(part.vertices);
+			params = VertexCompression::ComputeQuantization(floatVertices, vertexCount);
+			packedVertices.resize(vertexCount);
+			VertexCompression::Encode(packedVertices.data(), floatVertices, vertexCount, params);
+			std::vector<VertexCompression::FloatVertex> decodedVertices(vertexCount);
+			VertexCompression::Decode(decodedVertices.data(), packedVertices.data(), vertexCount, params);
+			VertexCompression::ErrorStatistics error = VertexCompression::MeasureError(floatVertices, decodedVertices.data(), vertexCount);
+
+			bool accepted = IsRoundTripExact(part.vertices, params, error);
+			if (accepted)
+				vertexFormat = kMboVertexQuantized;
+
+			wchar_t strBuffer[256];
+			swprintf_s(strBuffer, L"%ls part[%u]: %zu -> %zu bytes/vertex, max error: position %g, normal %.4f deg, texcoord %g%ls\n",
+				mboFileName, partIndex, sizeof(VertexPosNormalTex), accepted ? sizeof(VertexCompression::PackedVertex) : sizeof(VertexPosNormalTex),
+				error.maxPosError, error.maxNormalError, error.maxTexError, accepted ? L"" : L" (rejected)");
+			OutputDebugStringW(strBuffer);
 		}
-		else if (wstr == L"vt")
+
+		// [顶点格式]4字节
+		fout.write(reinterpret_cast<const char*>(&vertexFormat), sizeof(UINT));
+		if (vertexFormat == kMboVertexQuantized)
 		{
-			//
-			// 顶点纹理坐标
-			//
+			// [量化参数]24字节
+			fout.write(reinterpret_cast<const char*>(&params), sizeof(params));
+			// [顶点]16*顶点数 字节
+			fout.write(reinterpret_cast<const char*>(packedVertices.data()), vertexCount * sizeof(VertexCompression::PackedVertex));
+		}
+		else
+		{
+			// [顶点]32*顶点数 字节
+			fout.write(reinterpret_cast<const char*>(part.vertices.data()), vertexCount * sizeof(VertexPosNormalTex));
+		}
+		// [压缩后字节数][压缩后的索引]
+		WriteIndices(fout, use32, part.indices16, part.indices32, indexStats);
 
-			// 注意obj使用的是笛卡尔坐标系，而不是纹理坐标系
-			float u, v;
-			wfin >> u >> v;
-			v = 1.0f - v;
-			texCoords.emplace_back(XMFLOAT2(u, v));
+		UINT lodCount = (UINT)part.lods.size();
+		// [LOD数目]4字节
+		fout.write(reinterpret_cast<const char*>(&lodCount), sizeof(UINT));
+		for (const auto& lod : part.lods)
+		{
+			UINT lodIndexCount = (UINT)(use32 ? lod.indices32.size() : lod.indices16.size());
+			// [索引数]4字节
+			fout.write(reinterpret_cast<const char*>(&lodIndexCount), sizeof(UINT));
+			// [误差]4字节
+			fout.write(reinterpret_cast<const char*>(&lod.error), sizeof(float));
+			// [压缩后字节数][压缩后的索引]
+			WriteIndices(fout, use32, lod.indices16, lod.indices32, indexStats);
 		}
-		else if (wstr == L"vn")
+
+		UINT clusterCount = (UINT)part.clusters.size();
+		// [簇数目]4字节
+		fout.write(reinterpret_cast<const char*>(&clusterCount), sizeof(UINT));
+		// [簇]76*簇数目 字节
+		fout.write(reinterpret_cast<const char*>(part.clusters.data()), clusterCount * sizeof(MeshCluster::Cluster));
+
+		// [包围盒]24字节
+		fout.write(reinterpret_cast<const char*>(&part.boundingBox), sizeof(BoundingBox));
+		// [包围球]16字节
+		fout.write(reinterpret_cast<const char*>(&part.boundingSphere), sizeof(BoundingSphere));
+		return true;
+	}
+
+	void ReportIndexCompression(const wchar_t* mboFileName, const IndexStatistics& indexStats)
+	{
+		wchar_t strBuffer[256];
+		swprintf_s(strBuffer, L"%ls: indices %zu -> %zu bytes (%.1f%%)\n", mboFileName,
+			indexStats.rawBytes, indexStats.compressedBytes,
+			indexStats.rawBytes > 0 ? 100.0 * indexStats.compressedBytes / indexStats.rawBytes : 100.0);
+		OutputDebugStringW(strBuffer);
+	}
+
+	// 超过该大小的.obj文件使用流式导入
+	const ULONGLONG kStreamingThreshold = 1ull << 30;
+
+	// 流式导入时溢出到临时文件的面
+	struct FaceRecord
+	{
+		DWORD vpi[3];
+		DWORD vti[3];
+		DWORD vni[3];
+	};
+
+	// 溢出到磁盘的定长元素数组：写入时顺序追加，读取时以页为单位缓存，
+	// 缓存满时淘汰最久未使用的页。析构时删除临时文件
+	template<class T>
+	class SpillArray
+	{
+	public:
+		static const size_t kPageElements = 4096;
+
+		SpillArray() = default;
+		~SpillArray() { Destroy(); }
+
+		SpillArray(const SpillArray&) = delete;
+		SpillArray& operator=(const SpillArray&) = delete;
+
+		bool Create(const std::wstring& fileName)
 		{
-			//
-			// 顶点法向量
-			//
+			m_FileName = fileName;
+			m_Writer.open(fileName, std::ios::out | std::ios::binary | std::ios::trunc);
+			return m_Writer.is_open();
+		}
 
-			// 注意obj使用的是右手坐标系，而不是左手坐标系
-			// 需要将z值反转
-			float x, y, z;
-			wfin >> x >> y >> z;
-			z = -z;
-			normals.emplace_back(XMFLOAT3(x, y, z));
+		void PushBack(const T& value)
+		{
+			m_Writer.write(reinterpret_cast<const char*>(&value), sizeof(T));
+			++m_Size;
 		}
-		else if (wstr == L"mtllib")
+
+		// 结束写入并开始读取，cacheBytes为页缓存的容量，至少缓存一页
+		bool BeginRead(size_t cacheBytes)
 		{
-			//
-			// 指定某一文件的材质
-			//
-			std::wstring mtlFile;
-			wfin >> mtlFile;
-			// 去掉前后空格
-			size_t beg = 0, ed = mtlFile.size();
-			while (iswspace(mtlFile[beg]))
-				beg++;
-			while (ed > beg&& iswspace(mtlFile[ed - 1]))
-				ed--;
-			mtlFile = mtlFile.substr(beg, ed - beg);
-			// 获取路径
-			std::wstring dir = objFileName;
-			size_t pos;
-			if ((pos = dir.find_last_of('/')) == std::wstring::npos &&
-				(pos = dir.find_last_of('\\')) == std::wstring::npos)
+			m_Writer.close();
+			if (m_Writer.fail())
+				return false;
+			m_MaxPages = (std::max)(cacheBytes / (kPageElements * sizeof(T)), static_cast<size_t>(1));
+			m_Reader.open(m_FileName, std::ios::in | std::ios::binary);
+			return m_Reader.is_open();
+		}
+
+		bool Get(size_t index, T& value)
+		{
+			if (index >= m_Size)
+				return false;
+
+			size_t pageIndex = index / kPageElements;
+			auto it = m_Pages.find(pageIndex);
+			if (it == m_Pages.end())
 			{
-				pos = 0;
+				std::vector<T> data;
+				if (m_Pages.size() >= m_MaxPages)
+				{
+					// 淘汰最久未使用的页并复用其内存
+					auto victim = m_Pages.find(m_Lru.back());
+					data.swap(victim->second.data);
+					m_Pages.erase(victim);
+					m_Lru.pop_back();
+				}
+
+				size_t first = pageIndex * kPageElements;
+				size_t count = (std::min)(static_cast<size_t>(kPageElements), m_Size - first);
+				data.resize(count);
+				m_Reader.clear();
+				m_Reader.seekg(static_cast<std::streamoff>(first * sizeof(T)));
+				m_Reader.read(reinterpret_cast<char*>(data.data()), count * sizeof(T));
+				if (!m_Reader)
+					return false;
+
+				m_Lru.push_front(pageIndex);
+				it = m_Pages.emplace(pageIndex, Page{ std::move(data), m_Lru.begin() }).first;
+				m_PeakPages = (std::max)(m_PeakPages, m_Pages.size());
 			}
-			else
+			else if (it->second.lruIter != m_Lru.begin())
 			{
-				pos += 1;
+				m_Lru.splice(m_Lru.begin(), m_Lru, it->second.lruIter);
 			}
 
+			value = it->second.data[index % kPageElements];
+			return true;
+		}
+
+		size_t GetFileBytes() const { return m_Size * sizeof(T); }
+		size_t GetPeakCacheBytes() const { return (std::min)(m_PeakPages * kPageElements, m_Size) * sizeof(T); }
 
-			mtlReader.ReadMtl((dir.erase(pos) + mtlFile).c_str());
+		void Destroy()
+		{
+			m_Writer.close();
+			m_Reader.close();
+			m_Pages.clear();
+			m_Lru.clear();
+			if (!m_FileName.empty())
+			{
+				DeleteFileW(m_FileName.c_str());
+				m_FileName.clear();
+			}
 		}
-		else if (wstr == L"usemtl")
+
+	private:
+		struct Page
 		{
-			//
-			// 使用之前指定文件内部的某一材质
-			//
-			std::wstring mtlName;
-			std::getline(wfin, mtlName);
-			// 去掉前后空格
-			size_t beg = 0, ed = mtlName.size();
-			while (iswspace(mtlName[beg]))
-				beg++;
-			while (ed > beg&& iswspace(mtlName[ed - 1]))
-				ed--;
-			mtlName = mtlName.substr(beg, ed - beg);
+			std::vector<T> data;
+			std::list<size_t>::iterator lruIter;
+		};
+
+		std::wstring m_FileName;
+		std::ofstream m_Writer;
+		std::ifstream m_Reader;
+		size_t m_Size = 0;
+		size_t m_MaxPages = 1;
+		size_t m_PeakPages = 0;
+		std::unordered_map<size_t, Page> m_Pages;
+		std::list<size_t> m_Lru;
+	};
+
+	size_t GetPeakWorkingSetSize()
+	{
+		PROCESS_MEMORY_COUNTERS counters = {};
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+			return counters.PeakWorkingSetSize;
+		return 0;
+	}
+}
 
-			objParts.back().material = mtlReader.materials[mtlName];
-			objParts.back().texStrDiffuse = mtlReader.mapKdStrs[mtlName];
+bool ObjReader::Read(const wchar_t* mboFileName, const wchar_t* objFileName)
+{
+	if (mboFileName && ReadMbo(mboFileName))
+	{
+		return true;
+	}
+	else if (objFileName)
+	{
+		size_t length = wcslen(objFileName);
+		bool isGlb = length >= 4 && _wcsicmp(objFileName + length - 4, L".glb") == 0;
+
+		// 超大的.obj文件无法整体载入内存，使用流式导入
+		WIN32_FILE_ATTRIBUTE_DATA attributes;
+		if (mboFileName && !isGlb && GetFileAttributesExW(objFileName, GetFileExInfoStandard, &attributes) &&
+			(static_cast<ULONGLONG>(attributes.nFileSizeHigh) << 32 | attributes.nFileSizeLow) >= kStreamingThreshold)
+		{
+			return CookStreaming(mboFileName, objFileName) && ReadMbo(mboFileName);
 		}
-		else if (wstr == L"f")
+
+		bool status = isGlb ? ReadGlb(objFileName) : ReadObj(objFileName);
+		if (status && mboFileName)
 		{
-			//
-			// 几何面
-			//
-			VertexPosNormalTex vertex;
-			DWORD vpi[3], vni[3], vti[3];
-			wchar_t ignore;
+			PrepareForCook(mboFileName, 0);
+			return WriteMbo(mboFileName);
+		}
+		return status;
+	}
+
+	return false;
+}
 
-			// 顶点位置索引/纹理坐标索引/法向量索引
-			// 原来右手坐标系下顶点顺序是逆时针排布
-			// 现在需要转变为左手坐标系就需要将三角形顶点反过来输入
-			for (int i = 2; i >= 0; --i)
+bool ObjReader::CookStreaming(const wchar_t* mboFileName, const wchar_t* objFileName, size_t memoryBudget,
+	bool compressVertices, StreamingReport* pReport)
+{
+	objParts.clear();
+	vertexCache.clear();
+	dependencies.clear();
+
+	std::wstring tempPrefix = mboFileName;
+	SpillArray<XMFLOAT3> positions;
+	SpillArray<XMFLOAT2> texCoords;
+	SpillArray<XMFLOAT3> normals;
+	SpillArray<FaceRecord> faces;
+	if (!positions.Create(tempPrefix + L".pos.tmp") || !texCoords.Create(tempPrefix + L".tex.tmp") ||
+		!normals.Create(tempPrefix + L".normal.tmp") || !faces.Create(tempPrefix + L".face.tmp"))
+		return false;
+
+	//
+	// 第一遍：顺序解析.obj，顶点属性与面数据写入临时文件，只在内存中记录每个Part的材质与面数
+	//
+	struct PartRecord
+	{
+		PartRecord() : material(), faceCount() {}
+
+		Material material;
+		std::wstring texStrDiffuse;
+		size_t faceCount;
+	};
+
+	struct SpillHandler
+	{
+		SpillArray<XMFLOAT3>& positions;
+		SpillArray<XMFLOAT2>& texCoords;
+		SpillArray<XMFLOAT3>& normals;
+		SpillArray<FaceRecord>& faces;
+		std::vector<PartRecord>& parts;
+
+		void OnPart()
+		{
+			parts.emplace_back();
+			// 提供默认材质
+			SetDefaultMaterial(parts.back().material);
+		}
+
+		void OnMaterial(const Material& material, const std::wstring& texStrDiffuse)
+		{
+			if (parts.empty())
+				return;
+			parts.back().material = material;
+			parts.back().texStrDiffuse = texStrDiffuse;
+		}
+
+		void OnPosition(const XMFLOAT3& pos) { positions.PushBack(pos); }
+		void OnTexCoord(const XMFLOAT2& tex) { texCoords.PushBack(tex); }
+		void OnNormal(const XMFLOAT3& normal) { normals.PushBack(normal); }
+
+		bool OnFace(const DWORD vpi[3], const DWORD vti[3], const DWORD vni[3])
+		{
+			if (parts.empty())
+				return false;
+			FaceRecord face;
+			memcpy(face.vpi, vpi, sizeof(face.vpi));
+			memcpy(face.vti, vti, sizeof(face.vti));
+			memcpy(face.vni, vni, sizeof(face.vni));
+			faces.PushBack(face);
+			parts.back().faceCount++;
+			return true;
+		}
+	};
+
+	std::vector<PartRecord> partRecords;
+	SpillHandler handler{ positions, texCoords, normals, faces, partRecords };
+	if (!ParseObj(objFileName, handler, vMin, vMax, dependencies))
+		return false;
+
+	// 面数据按顺序读取，只需要较小的窗口；其余预算按数据量分配给顶点属性
+	size_t faceBudget = memoryBudget / 8;
+	size_t attributeBudget = memoryBudget - faceBudget;
+	size_t attributeBytes = positions.GetFileBytes() + texCoords.GetFileBytes() + normals.GetFileBytes();
+	auto share = [attributeBudget, attributeBytes](size_t bytes) {
+		return attributeBytes > 0 ? static_cast<size_t>(static_cast<double>(attributeBudget) * bytes / attributeBytes) : 0;
+	};
+	if (!positions.BeginRead(share(positions.GetFileBytes())) || !texCoords.BeginRead(share(texCoords.GetFileBytes())) ||
+		!normals.BeginRead(share(normals.GetFileBytes())) || !faces.BeginRead(faceBudget))
+		return false;
+
+	//
+	// 第二遍：逐个Part组装顶点与索引，与内存路径进行相同的处理后直接写入.mbo
+	//
+	std::ofstream fout(mboFileName, std::ios::out | std::ios::binary);
+	if (!fout.is_open())
+		return false;
+
+	// 与ReadObj相同，没有三角形的对象(组)不写入.mbo
+	UINT partCount = (UINT)std::count_if(partRecords.begin(), partRecords.end(),
+		[](const PartRecord& record) { return record.faceCount > 0; });
+
+	IndexStatistics indexStats;
+	WriteMboHeader(fout, partCount, vMin, vMax);
+
+	bool status = true;
+	size_t faceIndex = 0;
+	UINT partIndex = 0;
+	for (size_t r = 0; r < partRecords.size() && status; ++r)
+	{
+		const PartRecord& record = partRecords[r];
+		if (record.faceCount == 0)
+			continue;
+
+		objParts.assign(1, ObjPart());
+		objParts[0].material = record.material;
+		objParts[0].texStrDiffuse = record.texStrDiffuse;
+		vertexCache.clear();
+
+		for (size_t f = 0; f < record.faceCount && status; ++f, ++faceIndex)
+		{
+			FaceRecord face;
+			status = faces.Get(faceIndex, face);
+			VertexPosNormalTex vertex;
+			for (int k = 0; k < 3 && status; ++k)
 			{
-				wfin >> vpi[i] >> ignore >> vti[i] >> ignore >> vni[i];
+				status = positions.Get(face.vpi[k] - 1, vertex.pos) &&
+					normals.Get(face.vni[k] - 1, vertex.normal) &&
+					texCoords.Get(face.vti[k] - 1, vertex.tex);
+				if (status)
+					AddVertex(vertex, face.vpi[k], face.vti[k], face.vni[k]);
 			}
+		}
+
+		if (status)
+		{
+			ShrinkIndices(objParts[0]);
+			ComputePartBounds(objParts[0]);
+			PrepareForCook(mboFileName, partIndex);
+			status = WriteMboPart(fout, mboFileName, partIndex, objParts[0], compressVertices, indexStats);
+		}
+		objParts.clear();
+		++partIndex;
+	}
+	vertexCache.clear();
+	fout.close();
+
+	// 写入中断的.mbo不能被保留
+	if (!status || fout.fail())
+	{
+		DeleteFileW(mboFileName);
+		return false;
+	}
+
+	ReportIndexCompression(mboFileName, indexStats);
+
+	StreamingReport report = {};
+	report.partCount = partCount;
+	report.budgetBytes = memoryBudget;
+	report.peakCacheBytes = positions.GetPeakCacheBytes() + texCoords.GetPeakCacheBytes() +
+		normals.GetPeakCacheBytes() + faces.GetPeakCacheBytes();
+	report.peakWorkingSetBytes = GetPeakWorkingSetSize();
+
+	wchar_t strBuffer[256];
+	swprintf_s(strBuffer, L"%ls: streamed %zu parts, budget %.1f MB, peak cache %.1f MB, peak RSS %.1f MB\n",
+		mboFileName, report.partCount, report.budgetBytes / 1048576.0,
+		report.peakCacheBytes / 1048576.0, report.peakWorkingSetBytes / 1048576.0);
+	OutputDebugStringW(strBuffer);
+
+	if (pReport)
+		*pReport = report;
+	return true;
+}
+
+bool ObjReader::ReadObj(const wchar_t* objFileName)
+{
+	objParts.clear();
+	vertexCache.clear();
+	dependencies.clear();
+
+	// 所有顶点属性都保存在内存中
+	struct InMemoryHandler
+	{
+		ObjReader& reader;
+		std::vector<XMFLOAT3> positions;
+		std::vector<XMFLOAT3> normals;
+		std::vector<XMFLOAT2> texCoords;
+
+		void OnPart()
+		{
+			reader.objParts.emplace_back(ObjPart());
+			// 提供默认材质
+			SetDefaultMaterial(reader.objParts.back().material);
+			reader.vertexCache.clear();
+		}
 
+		void OnMaterial(const Material& material, const std::wstring& texStrDiffuse)
+		{
+			if (reader.objParts.empty())
+				return;
+			reader.objParts.back().material = material;
+			reader.objParts.back().texStrDiffuse = texStrDiffuse;
+		}
+
+		void OnPosition(const XMFLOAT3& pos) { positions.push_back(pos); }
+		void OnTexCoord(const XMFLOAT2& tex) { texCoords.push_back(tex); }
+		void OnNormal(const XMFLOAT3& normal) { normals.push_back(normal); }
+
+		bool OnFace(const DWORD vpi[3], const DWORD vti[3], const DWORD vni[3])
+		{
+			// 与流式导入相同，面必须属于某个对象(组)，且引用的顶点属性必须存在
+			if (reader.objParts.empty())
+				return false;
+			VertexPosNormalTex vertex;
 			for (int i = 0; i < 3; ++i)
 			{
+				if (vpi[i] - 1 >= positions.size() || vni[i] - 1 >= normals.size() || vti[i] - 1 >= texCoords.size())
+					return false;
 				vertex.pos = positions[vpi[i] - 1];
 				vertex.normal = normals[vni[i] - 1];
 				vertex.tex = texCoords[vti[i] - 1];
-				AddVertex(vertex, vpi[i], vti[i], vni[i]);
+				reader.AddVertex(vertex, vpi[i], vti[i], vni[i]);
 			}
+			return true;
+		}
+	};
 
+	InMemoryHandler handler{ *this };
+	if (!ParseObj(objFileName, handler, vMin, vMax, dependencies))
+		return false;
 
-			while (iswblank(wfin.peek()))
-				wfin.get();
-			// 几何面顶点数可能超过了3，不支持该格式
-			if (wfin.peek() != '\n')
-				return false;
-		}
-	}
+	// 没有三角形的对象(组)无法创建顶点缓冲区，不保留
+	objParts.erase(std::remove_if(objParts.begin(), objParts.end(),
+		[](const ObjPart& part) { return part.indices32.empty(); }), objParts.end());
 
-	// 顶点数不超过WORD的最大值的话就使用16位WORD存储
 	for (auto& part : objParts)
 	{
-		if (part.vertices.size() < 65535)
-		{
-			for (auto& i : part.indices32)
-			{
-				part.indices16.push_back((WORD)i);
-			}
-			part.indices32.clear();
-		}
+		ShrinkIndices(part);
+		ComputePartBounds(part);
 	}
 
-	XMStoreFloat3(&vMax, vecMax);
-	XMStoreFloat3(&vMin, vecMin);
+	return true;
+}
+
+bool ObjReader::ReadGlb(const wchar_t* glbFileName)
+{
+	objParts.clear();
+	vertexCache.clear();
+	dependencies.clear();
+
+	// 图元数据直接从映射的BIN块转换到objParts，转换完成后即可关闭文件
+	GlbReader glbReader;
+	if (!glbReader.Open(glbFileName) || !glbReader.ConvertToParts(objParts))
+		return false;
+	glbReader.Close();
+
+	for (auto& part : objParts)
+		ShrinkIndices(part);
+	ComputeBounds();
 
 	return true;
 }
 
 bool ObjReader::ReadMbo(const wchar_t* mboFileName)
 {
+	// 优先从挂载的资源包中读取
+	AssetView view;
+	std::vector<uint8_t> buffer;
+	if (AssetPackage::FindMounted(mboFileName, view, buffer))
+		return ReadMbo(view.data, view.size, mboFileName);
+
+	std::ifstream fin(mboFileName, std::ios::in | std::ios::binary);
+	if (!fin.is_open())
+		return false;
+
+	return ReadMbo(fin, mboFileName);
+}
+
+bool ObjReader::ReadMbo(const void* data, size_t size, const wchar_t* mboFileName)
+{
+	MemoryStreamBuf buffer(data, size);
+	std::istream fin(&buffer);
+	return ReadMbo(fin, mboFileName);
+}
+
+bool ObjReader::ReadMbo(std::istream& fin, const wchar_t* mboFileName)
+{
+	// [文件标识"MBO\0"] 4字节 (旧版本文件没有文件标识与版本号，直接以Part数目开头)
+	// [版本号] 4字节
 	// [Part数目] 4字节
 	// [AABB盒顶点vMax] 12字节
 	// [AABB盒顶点vMin] 12字节
@@ -217,18 +953,39 @@ bool ObjReader::ReadMbo(const wchar_t* mboFileName)
 	//   [材质]64字节
 	//   [顶点数]4字节
 	//   [索引数]4字节
-	//   [顶点]32*顶点数 字节
+	//   [顶点格式]4字节 (版本4)
+	//   [量化参数]24字节 (仅量化格式)
+	//   [顶点]32(或16)*顶点数 字节，取决于顶点格式
 	//   [索引]2(或4)*索引数 字节，取决于顶点数是否不超过65535
+	//         版本5起为[压缩后字节数]4字节 + [压缩后的索引]，见IndexCompression.h
+	//   [LOD数目]4字节 (版本2)
+	//   [LOD
+	//     [索引数]4字节
+	//     [误差]4字节
+	//     [索引]与Part的索引格式相同
+	//   ]
+	//   ...
+	//   [簇数目]4字节 (版本3)
+	//   [簇]76*簇数目 字节
+	//   [包围盒]24字节 (版本6)
+	//   [包围球]16字节
 	// ]
 	// ...
-	std::ifstream fin(mboFileName, std::ios::in | std::ios::binary);
-	if (!fin.is_open())
-		return false;
-
-	UINT parts = (UINT)objParts.size();
-	// [Part数目] 4字节
+	UINT parts = 0, version = 1;
+	// [文件标识]/[Part数目] 4字节
 	fin.read(reinterpret_cast<char*>(&parts), sizeof(UINT));
+	if (parts == kMboMagic)
+	{
+		// [版本号] 4字节
+		fin.read(reinterpret_cast<char*>(&version), sizeof(UINT));
+		// 由更新版本的程序生成的文件无法读取，需要重新生成
+		if (version > kMboVersion)
+			return false;
+		// [Part数目] 4字节
+		fin.read(reinterpret_cast<char*>(&parts), sizeof(UINT));
+	}
 	objParts.resize(parts);
+	IndexStatistics indexStats;
 
 	// [AABB盒顶点vMax] 12字节
 	fin.read(reinterpret_cast<char*>(&vMax), sizeof(XMFLOAT3));
@@ -249,93 +1006,360 @@ bool ObjReader::ReadMbo(const wchar_t* mboFileName)
 		fin.read(reinterpret_cast<char*>(&vertexCount), sizeof(UINT));
 		// [索引数]4字节
 		fin.read(reinterpret_cast<char*>(&indexCount), sizeof(UINT));
-		// [顶点]32*顶点数 字节
+		UINT vertexFormat = kMboVertexFloat;
+		if (version >= 4)
+		{
+			// [顶点格式]4字节
+			fin.read(reinterpret_cast<char*>(&vertexFormat), sizeof(UINT));
+		}
 		objParts[i].vertices.resize(vertexCount);
-		fin.read(reinterpret_cast<char*>(objParts[i].vertices.data()), vertexCount * sizeof(VertexPosNormalTex));
-
-		if (vertexCount > 65535)
+		if (vertexFormat == kMboVertexQuantized)
 		{
-			// [索引]4*索引数 字节
-			objParts[i].indices32.resize(indexCount);
-			fin.read(reinterpret_cast<char*>(objParts[i].indices32.data()), indexCount * sizeof(DWORD));
+			VertexCompression::QuantizationParams params;
+			// [量化参数]24字节
+			fin.read(reinterpret_cast<char*>(&params), sizeof(params));
+			// [顶点]16*顶点数 字节
+			std::vector<VertexCompression::PackedVertex> packedVertices(vertexCount);
+			fin.read(reinterpret_cast<char*>(packedVertices.data()), vertexCount * sizeof(VertexCompression::PackedVertex));
+			VertexCompression::Decode(reinterpret_cast<VertexCompression::FloatVertex*>(objParts[i].vertices.data()),
+				packedVertices.data(), vertexCount, params);
+		}
+		else if (vertexFormat == kMboVertexFloat)
+		{
+			// [顶点]32*顶点数 字节
+			fin.read(reinterpret_cast<char*>(objParts[i].vertices.data()), vertexCount * sizeof(VertexPosNormalTex));
 		}
 		else
 		{
-			// [索引]2*索引数 字节
-			objParts[i].indices16.resize(indexCount);
-			fin.read(reinterpret_cast<char*>(objParts[i].indices16.data()), indexCount * sizeof(WORD));
+			return false;
+		}
+
+		bool use32 = UseIndex32(vertexCount);
+		// [索引]
+		if (!ReadIndices(fin, use32, version >= 5, indexCount, objParts[i].indices16, objParts[i].indices32, indexStats))
+			return false;
+
+		objParts[i].lods.clear();
+		if (version >= 2)
+		{
+			UINT lodCount = 0;
+			// [LOD数目]4字节
+			fin.read(reinterpret_cast<char*>(&lodCount), sizeof(UINT));
+			objParts[i].lods.resize(lodCount);
+			for (auto& lod : objParts[i].lods)
+			{
+				UINT lodIndexCount = 0;
+				// [索引数]4字节
+				fin.read(reinterpret_cast<char*>(&lodIndexCount), sizeof(UINT));
+				// [误差]4字节
+				fin.read(reinterpret_cast<char*>(&lod.error), sizeof(float));
+				// [索引]
+				if (!ReadIndices(fin, use32, version >= 5, lodIndexCount, lod.indices16, lod.indices32, indexStats))
+					return false;
+			}
+		}
+
+		objParts[i].clusters.clear();
+		if (version >= 3)
+		{
+			UINT clusterCount = 0;
+			// [簇数目]4字节
+			fin.read(reinterpret_cast<char*>(&clusterCount), sizeof(UINT));
+			// [簇]76*簇数目 字节
+			objParts[i].clusters.resize(clusterCount);
+			fin.read(reinterpret_cast<char*>(objParts[i].clusters.data()), clusterCount * sizeof(MeshCluster::Cluster));
+		}
+
+		if (version >= 6)
+		{
+			// [包围盒]24字节
+			fin.read(reinterpret_cast<char*>(&objParts[i].boundingBox), sizeof(BoundingBox));
+			// [包围球]16字节
+			fin.read(reinterpret_cast<char*>(&objParts[i].boundingSphere), sizeof(BoundingSphere));
 		}
 	}
 
-	fin.close();
+	if (!fin)
+		return false;
+
+	// 旧版本文件没有簇(版本3)或LOD(版本2)，读取时补全。版本1的文件也没有经过网格优化，按烘焙时的流程完整处理
+	// 该开销在每次读取时都会产生，AssetTool cook会把旧版本的.mbo重新烘焙为当前版本
+	if (version < 3)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		if (version < 2)
+			PrepareForCook(mboFileName, 0);
+		else
+			BuildClusters();
+		double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+		wchar_t strBuffer[256];
+		swprintf_s(strBuffer, L"%ls: upgraded from version %u in %.2f ms, cook it again to skip this\n",
+			mboFileName, version, seconds * 1000.0);
+		OutputDebugStringW(strBuffer);
+	}
+
+	// 旧版本文件没有存储包围体，读取时计算
+	if (version < 6)
+	{
+		for (auto& part : objParts)
+			ComputePartBounds(part);
+	}
+
+	if (indexStats.compressedBytes > 0)
+	{
+		wchar_t strBuffer[256];
+		swprintf_s(strBuffer, L"%ls: decoded %zu -> %zu index bytes in %.3f ms (%.2f GB/s)\n",
+			mboFileName, indexStats.compressedBytes, indexStats.rawBytes, indexStats.decodeSeconds * 1000.0,
+			indexStats.decodeSeconds > 0.0 ? indexStats.rawBytes / indexStats.decodeSeconds / 1e9 : 0.0);
+		OutputDebugStringW(strBuffer);
+	}
 
 	return true;
 }
 
-bool ObjReader::WriteMbo(const wchar_t* mboFileName)
+UINT ObjReader::GetMboVersion()
+{
+	return kMboVersion;
+}
+
+UINT ObjReader::GetMboVersion(const wchar_t* mboFileName)
+{
+	std::ifstream fin(mboFileName, std::ios::in | std::ios::binary);
+	UINT header[2] = {};
+	fin.read(reinterpret_cast<char*>(header), sizeof(header));
+	if (!fin)
+		return 0;
+	// 旧版本文件没有文件标识与版本号
+	return header[0] == kMboMagic ? header[1] : 1;
+}
+
+bool ObjReader::WriteMbo(const wchar_t* mboFileName, bool compressVertices)
 {
+	// [文件标识"MBO\0"] 4字节
+	// [版本号] 4字节
 	// [Part数目] 4字节
 	// [AABB盒顶点vMax] 12字节
 	// [AABB盒顶点vMin] 12字节
 	// [Part
-	//   [环境光材质文件名]520字节
 	//   [漫射光材质文件名]520字节
 	//   [材质]64字节
 	//   [顶点数]4字节
 	//   [索引数]4字节
-	//   [顶点]32*顶点数 字节
-	//   [索引]2(或4)*索引数 字节，取决于顶点数是否不超过65535
+	//   [顶点格式]4字节
+	//   [量化参数]24字节 (仅量化格式)
+	//   [顶点]32(或16)*顶点数 字节，取决于顶点格式
+	//   [压缩后字节数]4字节
+	//   [压缩后的索引]，解码后为2(或4)*索引数 字节，取决于顶点数是否不超过65535
+	//   [LOD数目]4字节
+	//   [LOD
+	//     [索引数]4字节
+	//     [误差]4字节
+	//     [压缩后字节数]4字节
+	//     [压缩后的索引]
+	//   ]
+	//   ...
+	//   [簇数目]4字节
+	//   [簇]76*簇数目 字节
+	//   [包围盒]24字节
+	//   [包围球]16字节
 	// ]
 	// ...
 	std::ofstream fout(mboFileName, std::ios::out | std::ios::binary);
-	UINT parts = (UINT)objParts.size();
-	// [Part数目] 4字节
-	fout.write(reinterpret_cast<const char*>(&parts), sizeof(UINT));
-
-	// [AABB盒顶点vMax] 12字节
-	fout.write(reinterpret_cast<const char*>(&vMax), sizeof(XMFLOAT3));
-	// [AABB盒顶点vMin] 12字节
-	fout.write(reinterpret_cast<const char*>(&vMin), sizeof(XMFLOAT3));
+	if (!fout.is_open())
+		return false;
 
+	IndexStatistics indexStats;
+	WriteMboHeader(fout, (UINT)objParts.size(), vMin, vMax);
 	// [Part
-	for (UINT i = 0; i < parts; ++i)
+	bool status = true;
+	for (UINT i = 0; i < (UINT)objParts.size() && status; ++i)
 	{
-		wchar_t filePath[MAX_PATH];
-		wcscpy_s(filePath, objParts[i].texStrDiffuse.c_str());
-		// [漫射光材质文件名]520字节
-		fout.write(reinterpret_cast<const char*>(filePath), MAX_PATH * sizeof(wchar_t));
-		// [材质]64字节
-		fout.write(reinterpret_cast<const char*>(&objParts[i].material), sizeof(Material));
-		UINT vertexCount = (UINT)objParts[i].vertices.size();
-		// [顶点数]4字节
-		fout.write(reinterpret_cast<const char*>(&vertexCount), sizeof(UINT));
+		status = WriteMboPart(fout, mboFileName, i, objParts[i], compressVertices, indexStats);
+	}
+	// ]
+	fout.close();
+
+	// 写入中断的.mbo不能被保留
+	if (!status || fout.fail())
+	{
+		DeleteFileW(mboFileName);
+		return false;
+	}
+
+	ReportIndexCompression(mboFileName, indexStats);
+
+	return true;
+}
+
+std::vector<ObjReader::OptimizeReport> ObjReader::Optimize(bool optimizeOverdraw)
+{
+	std::vector<OptimizeReport> reports(objParts.size());
+
+	for (size_t i = 0; i < objParts.size(); ++i)
+	{
+		ObjPart& part = objParts[i];
+		std::vector<uint32_t> indices = GetPartIndices(part);
+		if (indices.empty())
+			continue;
+
+		size_t vertexCount = part.vertices.size();
+		reports[i].before = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), vertexCount);
 
-		UINT indexCount;
-		if (vertexCount > 65535)
+		// 顶点缓存优化
+		MeshOptimizer::OptimizeVertexCache(indices.data(), indices.data(), indices.size(), vertexCount);
+
+		// Overdraw优化，允许ACMR最多劣化5%
+		if (optimizeOverdraw)
 		{
-			indexCount = (UINT)objParts[i].indices32.size();
-			// [索引数]4字节
-			fout.write(reinterpret_cast<const char*>(&indexCount), sizeof(UINT));
-			// [顶点]32*顶点数 字节
-			fout.write(reinterpret_cast<const char*>(objParts[i].vertices.data()), vertexCount * sizeof(VertexPosNormalTex));
-			// [索引]4*索引数 字节
-			fout.write(reinterpret_cast<const char*>(objParts[i].indices32.data()), indexCount * sizeof(DWORD));
+			std::vector<uint32_t> result(indices.size());
+			MeshOptimizer::OptimizeOverdraw(result.data(), indices.data(), indices.size(),
+				&part.vertices[0].pos.x, vertexCount, sizeof(VertexPosNormalTex), 1.05f);
+			indices.swap(result);
 		}
-		else
+
+		// 顶点按首次使用顺序重排，提高顶点读取的局部性
+		// 未被索引的顶点会被删去，顶点数可能降到65535以内，SetPartIndices据此改用16位索引
+		MeshOptimizer::RemapVertexFetch(part.vertices, indices.data(), indices.size());
+
+		reports[i].after = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), part.vertices.size());
+		SetPartIndices(part, indices);
+	}
+
+	return reports;
+}
+
+void ObjReader::BuildClusters(UINT maxVertices, UINT maxTriangles)
+{
+	for (auto& part : objParts)
+	{
+		part.clusters.clear();
+
+		std::vector<uint32_t> indices = GetPartIndices(part);
+		if (indices.empty())
+			continue;
+
+		std::vector<uint32_t> clustered(indices.size());
+		part.clusters = MeshCluster::BuildClusters(clustered.data(), indices.data(), indices.size(),
+			&part.vertices[0].pos.x, part.vertices.size(), sizeof(VertexPosNormalTex), maxVertices, maxTriangles);
+
+		// 簇内部再做一次顶点缓存优化，弥补簇划分对三角形顺序的破坏
+		for (const auto& cluster : part.clusters)
 		{
-			indexCount = (UINT)objParts[i].indices16.size();
-			// [索引数]4字节
-			fout.write(reinterpret_cast<const char*>(&indexCount), sizeof(UINT));
-			// [顶点]32*顶点数 字节
-			fout.write(reinterpret_cast<const char*>(objParts[i].vertices.data()), vertexCount * sizeof(VertexPosNormalTex));
-			// [索引]2*索引数 字节
-			fout.write(reinterpret_cast<const char*>(objParts[i].indices16.data()), indexCount * sizeof(WORD));
+			uint32_t* clusterIndices = clustered.data() + cluster.startIndex;
+			MeshOptimizer::OptimizeVertexCache(clusterIndices, clusterIndices, cluster.indexCount, part.vertices.size());
+		}
+
+		// 三角形顺序已经改变，重新按首次使用顺序重排顶点
+		// 原网格未引用的顶点保留并排在最后，顶点数不变，已有LOD的索引同样重映射
+		std::vector<uint32_t> remap(part.vertices.size());
+		uint32_t nextVertex = static_cast<uint32_t>(MeshOptimizer::OptimizeVertexFetchRemap(remap.data(),
+			clustered.data(), clustered.size(), part.vertices.size()));
+		std::vector<VertexPosNormalTex> vertices(part.vertices.size());
+		for (size_t i = 0; i < remap.size(); ++i)
+		{
+			if (remap[i] == ~0u)
+				remap[i] = nextVertex++;
+			vertices[remap[i]] = part.vertices[i];
+		}
+		part.vertices.swap(vertices);
+
+		for (auto& index : clustered)
+			index = remap[index];
+		for (auto& lod : part.lods)
+		{
+			for (auto& index : lod.indices16)
+				index = static_cast<WORD>(remap[index]);
+			for (auto& index : lod.indices32)
+				index = remap[index];
 		}
+
+		SetPartIndices(part, clustered);
 	}
-	// ]
-	fout.close();
+}
 
-	return true;
+void ObjReader::GenerateLods(UINT maxLodCount, float reduction, float maxError)
+{
+	for (auto& part : objParts)
+	{
+		part.lods.clear();
+
+		std::vector<uint32_t> indices = GetPartIndices(part);
+		if (indices.empty())
+			continue;
+
+		const float* positions = &part.vertices[0].pos.x;
+		size_t vertexCount = part.vertices.size();
+		float scale = MeshSimplifier::GetMeshScale(positions, vertexCount, sizeof(VertexPosNormalTex));
+		bool use32 = UseIndex32(vertexCount);
+
+		// 每一级都从原始网格开始简化，避免误差逐级累积
+		size_t prevIndexCount = indices.size();
+		std::vector<uint32_t> lodIndices(indices.size());
+		for (UINT level = 1; level <= maxLodCount; ++level)
+		{
+			size_t targetIndexCount = static_cast<size_t>(prevIndexCount * reduction) / 3 * 3;
+			float error = 0.0f;
+			size_t lodIndexCount = MeshSimplifier::Simplify(lodIndices.data(), indices.data(), indices.size(),
+				positions, vertexCount, sizeof(VertexPosNormalTex), targetIndexCount, maxError, &error);
+
+			// 简化效果不明显时(受误差或拓扑限制)停止生成
+			if (lodIndexCount == 0 || lodIndexCount > prevIndexCount * 0.9f)
+				break;
+
+			MeshOptimizer::OptimizeVertexCache(lodIndices.data(), lodIndices.data(), lodIndexCount, vertexCount);
+
+			ObjLod lod;
+			lod.error = error * scale;
+			if (use32)
+				lod.indices32.assign(lodIndices.begin(), lodIndices.begin() + lodIndexCount);
+			else
+				lod.indices16.assign(lodIndices.begin(), lodIndices.begin() + lodIndexCount);
+			part.lods.push_back(std::move(lod));
+
+			prevIndexCount = lodIndexCount;
+		}
+	}
+}
+
+void ObjReader::ComputeBounds()
+{
+	XMVECTOR vecMin = g_XMInfinity, vecMax = g_XMNegInfinity;
+	for (auto& part : objParts)
+	{
+		ComputePartBounds(part);
+		if (part.vertices.empty())
+			continue;
+		XMVECTOR center = XMLoadFloat3(&part.boundingBox.Center);
+		XMVECTOR extents = XMLoadFloat3(&part.boundingBox.Extents);
+		vecMin = XMVectorMin(vecMin, XMVectorSubtract(center, extents));
+		vecMax = XMVectorMax(vecMax, XMVectorAdd(center, extents));
+	}
+
+	if (XMVector3Greater(vecMin, vecMax))
+		vecMin = vecMax = XMVectorZero();
+	XMStoreFloat3(&vMin, vecMin);
+	XMStoreFloat3(&vMax, vecMax);
+}
+
+void ObjReader::PrepareForCook(const wchar_t* mboFileName, UINT firstPartIndex)
+{
+	// 在烘焙阶段完成网格优化，之后读取.mbo无需再付出该开销
+	std::vector<OptimizeReport> reports = Optimize();
+	BuildClusters();
+	GenerateLods();
+	wchar_t strBuffer[256];
+	for (size_t i = 0; i < reports.size(); ++i)
+	{
+		// 簇划分重排了三角形与顶点，统计最终写出的索引顺序
+		std::vector<uint32_t> indices = GetPartIndices(objParts[i]);
+		if (!indices.empty())
+			reports[i].after = MeshOptimizer::AnalyzeVertexCache(indices.data(), indices.size(), objParts[i].vertices.size());
+		swprintf_s(strBuffer, L"%ls part[%zu]: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f, %zu clusters, %zu LODs\n",
+			mboFileName, firstPartIndex + i, reports[i].before.acmr, reports[i].after.acmr,
+			reports[i].before.atvr, reports[i].after.atvr, objParts[i].clusters.size(), objParts[i].lods.size());
+		OutputDebugStringW(strBuffer);
+	}
 }
 
 void ObjReader::AddVertex(const VertexPosNormalTex& vertex, DWORD vpi, DWORD vti, DWORD vni)
@@ -31,8 +31,14 @@
 #include <string>
 #include <algorithm>
 #include <locale>
+#include <DirectXCollision.h>
 #include "Vertex.h"
 #include "LightHelper.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "MeshCluster.h"
+#include "VertexCompression.h"
+#include "IndexCompression.h"
 
 
 class MtlReader;
@@ -40,9 +46,19 @@ class MtlReader;
 class ObjReader
 {
 public:
+	// 简化后的一级LOD，与原始网格共用顶点集合
+	struct ObjLod
+	{
+		ObjLod() : error() {}
+
+		std::vector<WORD> indices16;				// 顶点数不超过65535时使用
+		std::vector<DWORD> indices32;				// 顶点数超过65535时使用
+		float error;								// 模型空间下的几何误差，用于运行时选择LOD
+	};
+
 	struct ObjPart
 	{
-		ObjPart() : material() {}
+		ObjPart() : material(), boundingBox(), boundingSphere() {}
 		~ObjPart() = default;
 
 		Material material;							// 材质
@@ -50,23 +66,89 @@ public:
 		std::vector<WORD> indices16;				// 顶点数不超过65535时使用
 		std::vector<DWORD> indices32;				// 顶点数超过65535时使用
 		std::wstring texStrDiffuse;					// 漫射光纹理文件名，需为相对路径，在mbo必须占260字节
+		std::vector<ObjLod> lods;					// 第1级开始的LOD链，逐级变粗糙
+		std::vector<MeshCluster::Cluster> clusters;	// 原始网格的三角形簇，每个簇对应一段连续的索引
+		DirectX::BoundingBox boundingBox;			// 模型空间下紧贴顶点的AABB盒
+		DirectX::BoundingSphere boundingSphere;		// 模型空间下的包围球
+	};
+
+	// 网格优化前后的顶点缓存统计
+	struct OptimizeReport
+	{
+		MeshOptimizer::VertexCacheStatistics before;
+		MeshOptimizer::VertexCacheStatistics after;
+	};
+
+	// 流式导入的统计
+	struct StreamingReport
+	{
+		size_t partCount;							// Part数目
+		size_t budgetBytes;							// 内存预算
+		size_t peakCacheBytes;						// 顶点属性与面数据缓存的峰值占用
+		size_t peakWorkingSetBytes;					// 进程的峰值工作集(峰值RSS)
 	};
 
 	ObjReader() : vMin(), vMax() {}
 	~ObjReader() = default;
 
 	// 指定.mbo文件的情况下，若.mbo文件存在，优先读取该文件
-	// 否则会读取.obj文件
-	// 若.obj文件被读取，且提供了.mbo文件的路径，则会根据已经读取的数据创建.mbo文件
+	// 否则会读取.obj文件，objFileName以.glb结尾时按二进制glTF读取
+	// 若.obj文件被读取，且提供了.mbo文件的路径，则会先对网格进行优化再创建.mbo文件
+	// 超大的.obj文件会使用CookStreaming烘焙后再读取.mbo
 	bool Read(const wchar_t* mboFileName, const wchar_t* objFileName);
+
+	// 以有限的内存将.obj流式地烘焙为.mbo，用于无法整体载入内存的大文件
+	// 顶点属性与面数据先溢出到.mbo旁的临时文件，再逐个Part组装、优化并直接写入.mbo
+	// memoryBudget限制顶点属性与面数据缓存的大小，但单个Part本身仍需能放入内存
+	// compressVertices同WriteMbo，生成的.mbo与ReadObj、PrepareForCook后WriteMbo的结果逐字节相同
+	// 完成后objParts为空，需要时再调用ReadMbo。失败时不保留.mbo与临时文件
+	bool CookStreaming(const wchar_t* mboFileName, const wchar_t* objFileName,
+		size_t memoryBudget = 256 * 1024 * 1024, bool compressVertices = true, StreamingReport* pReport = nullptr);
 	
+	// 没有三角形的对象(组)会被丢弃，面引用了不存在的顶点属性时读取失败
 	bool ReadObj(const wchar_t* objFileName);
+	// 读取二进制glTF，见GlbReader
+	bool ReadGlb(const wchar_t* glbFileName);
+	// 挂载了资源包(见AssetPackage)且包含该文件时，直接从资源包的映射内存中读取
+	// 旧版本的文件读取时补全簇与LOD(版本1还会进行网格优化)，结果与当前版本相同，但每次读取都有该开销
 	bool ReadMbo(const wchar_t* mboFileName);
-	bool WriteMbo(const wchar_t* mboFileName);
+	// 从内存中读取.mbo，mboFileName仅用于输出日志
+	bool ReadMbo(const void* data, size_t size, const wchar_t* mboFileName);
+	// compressVertices为true时顶点以量化的形式(16字节)存储，
+	// 若某个Part往返解码的误差超出量化精度，则该Part退回使用完整的浮点顶点
+	bool WriteMbo(const wchar_t* mboFileName, bool compressVertices = true);
+	// 当前写出的.mbo版本，格式变化时需要重新烘焙
+	static UINT GetMboVersion();
+	// .mbo文件的版本，没有文件标识的旧文件为1，无法读取时返回0
+	static UINT GetMboVersion(const wchar_t* mboFileName);
+
+	// 烘焙前对objParts进行优化、簇划分与LOD生成，写出.mbo前调用，firstPartIndex仅用于输出日志
+	void PrepareForCook(const wchar_t* mboFileName, UINT firstPartIndex);
+
+	// 对每个Part重排三角形(顶点缓存，可选Overdraw)以及顶点(按首次使用顺序)
+	// 开销较大，应只在烘焙.mbo时执行一次
+	std::vector<OptimizeReport> Optimize(bool optimizeOverdraw = true);
+
+	// 将每个Part的原始网格划分成三角形簇，并重排索引使每个簇的三角形连续存放
+	// 之后顶点按新的三角形顺序的首次使用顺序重排，已有的LOD随之重映射
+	// 应在Optimize之后调用
+	void BuildClusters(UINT maxVertices = 64, UINT maxTriangles = 124);
+
+	// 使用二次误差度量为每个Part生成LOD链，每一级的三角形数目约为上一级的reduction倍
+	// maxError为允许的最大误差，为相对于Part尺寸的比例
+	// 应在Optimize之后调用
+	void GenerateLods(UINT maxLodCount = 4, float reduction = 0.5f, float maxError = 0.05f);
+
+	// 根据顶点重新计算每个Part的AABB盒与包围球，以及整个模型的AABB盒
+	// 读取.obj/.mbo时会自动计算，直接修改objParts后需要手动调用
+	void ComputeBounds();
 public:
 	std::vector<ObjPart> objParts;
 	DirectX::XMFLOAT3 vMin, vMax;					// AABB盒双顶点
+	std::vector<std::wstring> dependencies;			// 读取.obj时引用的.mtl文件，用于烘焙时记录依赖
 private:
+	bool ReadMbo(std::istream& fin, const wchar_t* mboFileName);
+
 	void AddVertex(const VertexPosNormalTex& vertex, DWORD vpi, DWORD vti, DWORD vni);
 
 	// 缓存有v/vt/vn字符串信息
@@ -0,0 +1,553 @@
+﻿#include "PixelConvert.h"
+#include <algorithm>
+#include <cmath>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define PIXELCONVERT_SIMD 1
+#define PIXELCONVERT_TARGET_SSSE3
+#define PIXELCONVERT_TARGET_AVX2
+#include <intrin.h>
+#include <immintrin.h>
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define PIXELCONVERT_SIMD 1
+#define PIXELCONVERT_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define PIXELCONVERT_TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+
+//
+// 取整的整数形式(对全部输入穷举验证过):
+// (c * a + 127) / 255       == (t + (t >> 8)) >> 8，t = c * a + 128
+// (v * 255 + 32767) / 65535 == (t - (t >> 8)) >> 8，t = v + 128
+//
+// sRGB编码: 线性值v乘以4096取整得到桶，codes为桶下界对应的sRGB值，limits为该值与下一个值的中点
+// 相邻中点的最小间距(约1/3300)大于桶宽，每个桶内至多有一个中点，结果为codes[b] + (v >= limits[b])
+//
+
+namespace
+{
+	const int kSrgbBuckets = 4096;
+
+	struct Tables
+	{
+		Tables()
+		{
+			float thresholds[255];
+			for (int i = 0; i < 256; ++i)
+			{
+				unpack[i] = static_cast<float>(ToLinear(i / 255.0));
+				unpack[256 + i] = i / 255.0f;
+				if (i < 255)
+					thresholds[i] = static_cast<float>(ToLinear((i + 0.5) / 255.0));
+			}
+			for (int i = 0; i <= kSrgbBuckets; ++i)
+			{
+				codes[i] = static_cast<int32_t>(std::upper_bound(thresholds, thresholds + 255,
+					static_cast<float>(i) / kSrgbBuckets) - thresholds);
+				limits[i] = codes[i] < 255 ? thresholds[codes[i]] : 2.0f;
+			}
+		}
+
+		static double ToLinear(double value)
+		{
+			return value <= 0.04045 ? value / 12.92 : std::pow((value + 0.055) / 1.055, 2.4);
+		}
+
+		float unpack[512];					// 前256个为sRGB到线性，后256个为除以255
+		int32_t codes[kSrgbBuckets + 1];	// 最后一个桶只包含1.0
+		float limits[kSrgbBuckets + 1];
+	};
+
+	const Tables& GetTables()
+	{
+		static const Tables tables;
+		return tables;
+	}
+
+	// 与SIMD的max/min相同的限制方式(NaN得到0)
+	inline float Saturate(float value)
+	{
+		value = value > 0.0f ? value : 0.0f;
+		return value < 1.0f ? value : 1.0f;
+	}
+
+	inline uint8_t EncodeSrgb(const Tables& tables, float value)
+	{
+		int bucket = static_cast<int>(value * kSrgbBuckets);
+		return static_cast<uint8_t>(tables.codes[bucket] + (value >= tables.limits[bucket] ? 1 : 0));
+	}
+
+	inline uint8_t EncodeUnorm(float value)
+	{
+		return static_cast<uint8_t>(value * 255.0f + 0.5f);
+	}
+
+	// 各指令集的实现
+	struct Kernels
+	{
+		void (*rgbToRgba)(const uint8_t* src, uint8_t* dst, size_t count, bool swapRedBlue);
+		void (*swapRedBlue)(const uint8_t* src, uint8_t* dst, size_t count);
+		void (*premultiplyAlpha)(const uint8_t* src, uint8_t* dst, size_t count);
+		void (*r16ToR8)(const uint16_t* src, uint8_t* dst, size_t count);
+		void (*unpackRgba)(const uint8_t* src, float* dst, size_t count, bool srgb);
+		void (*packRgba)(const float* src, uint8_t* dst, size_t count, bool srgb, float alphaScale);
+	};
+
+	//
+	// 标量实现，也用于SIMD实现处理剩余的像素
+	//
+
+	void RgbToRgbaScalar(const uint8_t* src, uint8_t* dst, size_t count, bool swapRedBlue)
+	{
+		int r = swapRedBlue ? 2 : 0, b = 2 - r;
+		for (size_t i = 0; i < count; ++i, src += 3, dst += 4)
+		{
+			dst[0] = src[r];
+			dst[1] = src[1];
+			dst[2] = src[b];
+			dst[3] = 255;
+		}
+	}
+
+	void SwapRedBlueScalar(const uint8_t* src, uint8_t* dst, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i, src += 4, dst += 4)
+		{
+			uint8_t r = src[0], g = src[1], b = src[2], a = src[3];
+			dst[0] = b;
+			dst[1] = g;
+			dst[2] = r;
+			dst[3] = a;
+		}
+	}
+
+	void PremultiplyAlphaScalar(const uint8_t* src, uint8_t* dst, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i, src += 4, dst += 4)
+		{
+			unsigned a = src[3];
+			for (int c = 0; c < 3; ++c)
+				dst[c] = static_cast<uint8_t>((src[c] * a + 127) / 255);
+			dst[3] = static_cast<uint8_t>(a);
+		}
+	}
+
+	void R16ToR8Scalar(const uint16_t* src, uint8_t* dst, size_t count)
+	{
+		for (size_t i = 0; i < count; ++i)
+			dst[i] = static_cast<uint8_t>((src[i] * 255u + 32767u) / 65535u);
+	}
+
+	void UnpackRgbaScalar(const uint8_t* src, float* dst, size_t count, bool srgb)
+	{
+		const float* rgbTable = GetTables().unpack + (srgb ? 0 : 256);
+		const float* alphaTable = GetTables().unpack + 256;
+		for (size_t i = 0; i < count; ++i, src += 4, dst += 4)
+		{
+			dst[0] = rgbTable[src[0]];
+			dst[1] = rgbTable[src[1]];
+			dst[2] = rgbTable[src[2]];
+			dst[3] = alphaTable[src[3]];
+		}
+	}
+
+	void PackRgbaScalar(const float* src, uint8_t* dst, size_t count, bool srgb, float alphaScale)
+	{
+		const Tables& tables = GetTables();
+		for (size_t i = 0; i < count; ++i, src += 4, dst += 4)
+		{
+			for (int c = 0; c < 3; ++c)
+			{
+				float value = Saturate(src[c]);
+				dst[c] = srgb ? EncodeSrgb(tables, value) : EncodeUnorm(value);
+			}
+			dst[3] = EncodeUnorm(Saturate(src[3] * alphaScale));
+		}
+	}
+
+	const Kernels kScalarKernels = { RgbToRgbaScalar, SwapRedBlueScalar, PremultiplyAlphaScalar,
+		R16ToR8Scalar, UnpackRgbaScalar, PackRgbaScalar };
+
+#ifdef PIXELCONVERT_SIMD
+	bool HasSSSE3()
+	{
+#if defined(_MSC_VER)
+		int info[4];
+		__cpuid(info, 1);
+		return (info[2] & (1 << 9)) != 0;
+#else
+		return __builtin_cpu_supports("ssse3") != 0;
+#endif
+	}
+
+	bool HasAVX2()
+	{
+#if defined(_MSC_VER)
+		// 除CPU支持外还需要操作系统保存YMM寄存器
+		int info[4];
+		__cpuid(info, 1);
+		if ((info[2] & (1 << 27)) == 0 || (info[2] & (1 << 28)) == 0 || (_xgetbv(0) & 6) != 6)
+			return false;
+		__cpuid(info, 0);
+		if (info[0] < 7)
+			return false;
+		__cpuidex(info, 7, 0);
+		return (info[1] & (1 << 5)) != 0;
+#else
+		return __builtin_cpu_supports("avx2") != 0;
+#endif
+	}
+
+	//
+	// SSSE3实现，每次处理4~16个像素
+	//
+
+	PIXELCONVERT_TARGET_SSSE3 void RgbToRgbaSSSE3(const uint8_t* src, uint8_t* dst, size_t count, bool swapRedBlue)
+	{
+		const __m128i shuffle = swapRedBlue ?
+			_mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1) :
+			_mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+		const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000));
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16, src += 48, dst += 64)
+		{
+			// 48字节中每12字节为4个像素
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16));
+			__m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 32));
+			__m128i p0 = a;
+			__m128i p1 = _mm_alignr_epi8(b, a, 12);
+			__m128i p2 = _mm_alignr_epi8(c, b, 8);
+			__m128i p3 = _mm_srli_si128(c, 4);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_or_si128(_mm_shuffle_epi8(p0, shuffle), alpha));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 16), _mm_or_si128(_mm_shuffle_epi8(p1, shuffle), alpha));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 32), _mm_or_si128(_mm_shuffle_epi8(p2, shuffle), alpha));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 48), _mm_or_si128(_mm_shuffle_epi8(p3, shuffle), alpha));
+		}
+		RgbToRgbaScalar(src, dst, count - i, swapRedBlue);
+	}
+
+	PIXELCONVERT_TARGET_SSSE3 void SwapRedBlueSSSE3(const uint8_t* src, uint8_t* dst, size_t count)
+	{
+		const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4, src += 16, dst += 16)
+		{
+			__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_shuffle_epi8(pixels, shuffle));
+		}
+		SwapRedBlueScalar(src, dst, count - i);
+	}
+
+	// 2个像素的8个16位通道乘以各自的Alpha后除以255取整，alphas中Alpha通道的乘数为255，结果不变
+	PIXELCONVERT_TARGET_SSSE3 inline __m128i PremultiplyWordsSSSE3(__m128i channels, __m128i alphas)
+	{
+		__m128i t = _mm_add_epi16(_mm_mullo_epi16(channels, alphas), _mm_set1_epi16(128));
+		return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+	}
+
+	PIXELCONVERT_TARGET_SSSE3 void PremultiplyAlphaSSSE3(const uint8_t* src, uint8_t* dst, size_t count)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i alphaLo = _mm_setr_epi8(3, -1, 3, -1, 3, -1, -1, -1, 7, -1, 7, -1, 7, -1, -1, -1);
+		const __m128i alphaHi = _mm_setr_epi8(11, -1, 11, -1, 11, -1, -1, -1, 15, -1, 15, -1, 15, -1, -1, -1);
+		const __m128i keepAlpha = _mm_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255);
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4, src += 16, dst += 16)
+		{
+			__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+			__m128i lo = PremultiplyWordsSSSE3(_mm_unpacklo_epi8(pixels, zero),
+				_mm_or_si128(_mm_shuffle_epi8(pixels, alphaLo), keepAlpha));
+			__m128i hi = PremultiplyWordsSSSE3(_mm_unpackhi_epi8(pixels, zero),
+				_mm_or_si128(_mm_shuffle_epi8(pixels, alphaHi), keepAlpha));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(lo, hi));
+		}
+		PremultiplyAlphaScalar(src, dst, count - i);
+	}
+
+	// 4个32位的值按(t - (t >> 8)) >> 8转为8位
+	PIXELCONVERT_TARGET_SSSE3 inline __m128i R16ToR8DwordsSSSE3(__m128i values)
+	{
+		__m128i t = _mm_add_epi32(values, _mm_set1_epi32(128));
+		return _mm_srli_epi32(_mm_sub_epi32(t, _mm_srli_epi32(t, 8)), 8);
+	}
+
+	PIXELCONVERT_TARGET_SSSE3 void R16ToR8SSSE3(const uint16_t* src, uint8_t* dst, size_t count)
+	{
+		const __m128i zero = _mm_setzero_si128();
+		size_t i = 0;
+		for (; i + 16 <= count; i += 16)
+		{
+			__m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+			__m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i + 8));
+			// 结果不超过255，有符号的饱和打包不会改变值
+			__m128i wordsA = _mm_packs_epi32(R16ToR8DwordsSSSE3(_mm_unpacklo_epi16(a, zero)),
+				R16ToR8DwordsSSSE3(_mm_unpackhi_epi16(a, zero)));
+			__m128i wordsB = _mm_packs_epi32(R16ToR8DwordsSSSE3(_mm_unpacklo_epi16(b, zero)),
+				R16ToR8DwordsSSSE3(_mm_unpackhi_epi16(b, zero)));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(wordsA, wordsB));
+		}
+		R16ToR8Scalar(src + i, dst + i, count - i);
+	}
+
+	PIXELCONVERT_TARGET_SSSE3 void UnpackRgbaSSSE3(const uint8_t* src, float* dst, size_t count, bool srgb)
+	{
+		if (srgb)
+		{
+			// SSSE3没有gather，sRGB按标量查表
+			UnpackRgbaScalar(src, dst, count, srgb);
+			return;
+		}
+
+		// 与表中的i / 255.0f相同的除法
+		const __m128i zero = _mm_setzero_si128();
+		const __m128 scale = _mm_set1_ps(255.0f);
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4, src += 16, dst += 16)
+		{
+			__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+			__m128i lo = _mm_unpacklo_epi8(pixels, zero), hi = _mm_unpackhi_epi8(pixels, zero);
+			_mm_storeu_ps(dst, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale));
+			_mm_storeu_ps(dst + 4, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale));
+			_mm_storeu_ps(dst + 8, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale));
+			_mm_storeu_ps(dst + 12, _mm_div_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale));
+		}
+		UnpackRgbaScalar(src, dst, count - i, srgb);
+	}
+
+	PIXELCONVERT_TARGET_SSSE3 void PackRgbaSSSE3(const float* src, uint8_t* dst, size_t count, bool srgb, float alphaScale)
+	{
+		if (srgb)
+		{
+			// 逐个通道查表时向量与标量之间的存取比标量实现更慢
+			PackRgbaScalar(src, dst, count, srgb, alphaScale);
+			return;
+		}
+
+		const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f);
+		const __m128 scale = _mm_setr_ps(1.0f, 1.0f, 1.0f, alphaScale);
+		const __m128 unormScale = _mm_set1_ps(255.0f), half = _mm_set1_ps(0.5f);
+		size_t i = 0;
+		for (; i + 4 <= count; i += 4, src += 16, dst += 16)
+		{
+			__m128i values[4];
+			for (int p = 0; p < 4; ++p)
+			{
+				__m128 v = _mm_mul_ps(_mm_loadu_ps(src + p * 4), scale);
+				v = _mm_min_ps(_mm_max_ps(v, zero), one);
+				values[p] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, unormScale), half));
+			}
+			__m128i words01 = _mm_packs_epi32(values[0], values[1]);
+			__m128i words23 = _mm_packs_epi32(values[2], values[3]);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(words01, words23));
+		}
+		PackRgbaScalar(src, dst, count - i, srgb, alphaScale);
+	}
+
+	const Kernels kSSSE3Kernels = { RgbToRgbaSSSE3, SwapRedBlueSSSE3, PremultiplyAlphaSSSE3,
+		R16ToR8SSSE3, UnpackRgbaSSSE3, PackRgbaSSSE3 };
+
+	//
+	// AVX2实现，每次处理8~32个像素，sRGB查表使用gather
+	//
+
+	PIXELCONVERT_TARGET_AVX2 void RgbToRgbaAVX2(const uint8_t* src, uint8_t* dst, size_t count, bool swapRedBlue)
+	{
+		// 每次读入24字节(6个32位)，前12字节放到低128位，后12字节放到高128位后在各自的128位内重排
+		const __m256i loadMask = _mm256_setr_epi32(-1, -1, -1, -1, -1, -1, 0, 0);
+		const __m256i spread = _mm256_setr_epi32(0, 1, 2, 0, 3, 4, 5, 0);
+		const __m256i shuffle = swapRedBlue ?
+			_mm256_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1,
+				2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1) :
+			_mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+				0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+		const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xFF000000));
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8, src += 24, dst += 32)
+		{
+			__m256i pixels = _mm256_maskload_epi32(reinterpret_cast<const int*>(src), loadMask);
+			pixels = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(pixels, spread), shuffle);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_or_si256(pixels, alpha));
+		}
+		RgbToRgbaScalar(src, dst, count - i, swapRedBlue);
+	}
+
+	PIXELCONVERT_TARGET_AVX2 void SwapRedBlueAVX2(const uint8_t* src, uint8_t* dst, size_t count)
+	{
+		const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15,
+			2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8, src += 32, dst += 32)
+		{
+			__m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_shuffle_epi8(pixels, shuffle));
+		}
+		SwapRedBlueScalar(src, dst, count - i);
+	}
+
+	PIXELCONVERT_TARGET_AVX2 inline __m256i PremultiplyWordsAVX2(__m256i channels, __m256i alphas)
+	{
+		__m256i t = _mm256_add_epi16(_mm256_mullo_epi16(channels, alphas), _mm256_set1_epi16(128));
+		return _mm256_srli_epi16(_mm256_add_epi16(t, _mm256_srli_epi16(t, 8)), 8);
+	}
+
+	PIXELCONVERT_TARGET_AVX2 void PremultiplyAlphaAVX2(const uint8_t* src, uint8_t* dst, size_t count)
+	{
+		// unpack与packus都在各自的128位内进行，顺序保持不变
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i alphaLo = _mm256_setr_epi8(3, -1, 3, -1, 3, -1, -1, -1, 7, -1, 7, -1, 7, -1, -1, -1,
+			3, -1, 3, -1, 3, -1, -1, -1, 7, -1, 7, -1, 7, -1, -1, -1);
+		const __m256i alphaHi = _mm256_setr_epi8(11, -1, 11, -1, 11, -1, -1, -1, 15, -1, 15, -1, 15, -1, -1, -1,
+			11, -1, 11, -1, 11, -1, -1, -1, 15, -1, 15, -1, 15, -1, -1, -1);
+		const __m256i keepAlpha = _mm256_setr_epi16(0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255, 0, 0, 0, 255);
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8, src += 32, dst += 32)
+		{
+			__m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src));
+			__m256i lo = PremultiplyWordsAVX2(_mm256_unpacklo_epi8(pixels, zero),
+				_mm256_or_si256(_mm256_shuffle_epi8(pixels, alphaLo), keepAlpha));
+			__m256i hi = PremultiplyWordsAVX2(_mm256_unpackhi_epi8(pixels, zero),
+				_mm256_or_si256(_mm256_shuffle_epi8(pixels, alphaHi), keepAlpha));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_packus_epi16(lo, hi));
+		}
+		PremultiplyAlphaScalar(src, dst, count - i);
+	}
+
+	PIXELCONVERT_TARGET_AVX2 void R16ToR8AVX2(const uint16_t* src, uint8_t* dst, size_t count)
+	{
+		const __m256i bias = _mm256_set1_epi32(128);
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8)
+		{
+			__m256i t = _mm256_add_epi32(_mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i))), bias);
+			__m256i values = _mm256_srli_epi32(_mm256_sub_epi32(t, _mm256_srli_epi32(t, 8)), 8);
+			// 8个32位的值在两个128位中，合并后取每个32位的最低字节
+			__m128i words = _mm_packs_epi32(_mm256_castsi256_si128(values), _mm256_extracti128_si256(values, 1));
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(dst + i), _mm_packus_epi16(words, words));
+		}
+		R16ToR8Scalar(src + i, dst + i, count - i);
+	}
+
+	PIXELCONVERT_TARGET_AVX2 void UnpackRgbaAVX2(const uint8_t* src, float* dst, size_t count, bool srgb)
+	{
+		// Alpha总是查表的后半部分
+		const float* table = GetTables().unpack;
+		const int rgbOffset = srgb ? 0 : 256;
+		const __m256i offsets = _mm256_setr_epi32(rgbOffset, rgbOffset, rgbOffset, 256, rgbOffset, rgbOffset, rgbOffset, 256);
+		size_t i = 0;
+		for (; i + 2 <= count; i += 2, src += 8, dst += 8)
+		{
+			__m256i indices = _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(src))), offsets);
+			_mm256_storeu_ps(dst, _mm256_i32gather_ps(table, indices, 4));
+		}
+		UnpackRgbaScalar(src, dst, count - i, srgb);
+	}
+
+	PIXELCONVERT_TARGET_AVX2 void PackRgbaAVX2(const float* src, uint8_t* dst, size_t count, bool srgb, float alphaScale)
+	{
+		const Tables& tables = GetTables();
+		const __m256 zero = _mm256_setzero_ps(), one = _mm256_set1_ps(1.0f);
+		const __m256 scale = _mm256_setr_ps(1.0f, 1.0f, 1.0f, alphaScale, 1.0f, 1.0f, 1.0f, alphaScale);
+		const __m256 unormScale = _mm256_set1_ps(255.0f), half = _mm256_set1_ps(0.5f);
+		const __m256 bucketScale = _mm256_set1_ps(static_cast<float>(kSrgbBuckets));
+		// 按sRGB编码的通道
+		const __m256i srgbLanes = srgb ? _mm256_setr_epi32(-1, -1, -1, 0, -1, -1, -1, 0) : _mm256_setzero_si256();
+		size_t i = 0;
+		for (; i + 8 <= count; i += 8, src += 32, dst += 32)
+		{
+			__m256i values[4];
+			for (int p = 0; p < 4; ++p)
+			{
+				__m256 v = _mm256_mul_ps(_mm256_loadu_ps(src + p * 8), scale);
+				v = _mm256_min_ps(_mm256_max_ps(v, zero), one);
+				__m256i unorm = _mm256_cvttps_epi32(_mm256_add_ps(_mm256_mul_ps(v, unormScale), half));
+				if (srgb)
+				{
+					__m256i buckets = _mm256_cvttps_epi32(_mm256_mul_ps(v, bucketScale));
+					__m256i codes = _mm256_i32gather_epi32(tables.codes, buckets, 4);
+					__m256 limits = _mm256_i32gather_ps(tables.limits, buckets, 4);
+					// 比较结果为-1，相减即加1
+					__m256i encoded = _mm256_sub_epi32(codes, _mm256_castps_si256(_mm256_cmp_ps(v, limits, _CMP_GE_OQ)));
+					unorm = _mm256_blendv_epi8(unorm, encoded, srgbLanes);
+				}
+				values[p] = unorm;
+			}
+			// packs与packus在各自的128位内交错，最后按32位重排回像素顺序
+			__m256i words01 = _mm256_packs_epi32(values[0], values[1]);
+			__m256i words23 = _mm256_packs_epi32(values[2], values[3]);
+			__m256i bytes = _mm256_packus_epi16(words01, words23);
+			bytes = _mm256_permutevar8x32_epi32(bytes, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), bytes);
+		}
+		PackRgbaScalar(src, dst, count - i, srgb, alphaScale);
+	}
+
+	const Kernels kAVX2Kernels = { RgbToRgbaAVX2, SwapRedBlueAVX2, PremultiplyAlphaAVX2,
+		R16ToR8AVX2, UnpackRgbaAVX2, PackRgbaAVX2 };
+#endif
+
+	const Kernels& GetKernels(PixelConvert::Simd simd)
+	{
+		PixelConvert::Simd best = PixelConvert::GetBestSimd();
+		if (simd == PixelConvert::Simd::Best || static_cast<int>(simd) > static_cast<int>(best))
+			simd = best;
+#ifdef PIXELCONVERT_SIMD
+		if (simd == PixelConvert::Simd::AVX2)
+			return kAVX2Kernels;
+		if (simd == PixelConvert::Simd::SSSE3)
+			return kSSSE3Kernels;
+#endif
+		return kScalarKernels;
+	}
+}
+
+PixelConvert::Simd PixelConvert::GetBestSimd()
+{
+#ifdef PIXELCONVERT_SIMD
+	static const Simd best = HasAVX2() ? Simd::AVX2 : HasSSSE3() ? Simd::SSSE3 : Simd::Scalar;
+	return best;
+#else
+	return Simd::Scalar;
+#endif
+}
+
+const char* PixelConvert::GetSimdName(Simd simd)
+{
+	switch (simd)
+	{
+	case Simd::Scalar: return "scalar";
+	case Simd::SSSE3: return "SSSE3";
+	case Simd::AVX2: return "AVX2";
+	default: return GetSimdName(GetBestSimd());
+	}
+}
+
+void PixelConvert::RgbToRgba(const uint8_t* src, uint8_t* dst, size_t count, bool swapRedBlue, Simd simd)
+{
+	GetKernels(simd).rgbToRgba(src, dst, count, swapRedBlue);
+}
+
+void PixelConvert::SwapRedBlue(const uint8_t* src, uint8_t* dst, size_t count, Simd simd)
+{
+	GetKernels(simd).swapRedBlue(src, dst, count);
+}
+
+void PixelConvert::PremultiplyAlpha(const uint8_t* src, uint8_t* dst, size_t count, Simd simd)
+{
+	GetKernels(simd).premultiplyAlpha(src, dst, count);
+}
+
+void PixelConvert::R16ToR8(const uint16_t* src, uint8_t* dst, size_t count, Simd simd)
+{
+	GetKernels(simd).r16ToR8(src, dst, count);
+}
+
+void PixelConvert::UnpackRgba(const uint8_t* src, float* dst, size_t count, bool srgb, Simd simd)
+{
+	GetKernels(simd).unpackRgba(src, dst, count, srgb);
+}
+
+void PixelConvert::PackRgba(const float* src, uint8_t* dst, size_t count, bool srgb, float alphaScale, Simd simd)
+{
+	GetKernels(simd).packRgba(src, dst, count, srgb, alphaScale);
+}
@@ -0,0 +1,58 @@
+﻿//***************************************************************************************
+// PixelConvert.h
+// Licensed under the MIT License.
+//
+// 图像导入与烘焙使用的像素格式转换
+// - RGB8/BGR8扩展为RGBA8、BGRA8与RGBA8互换、预乘Alpha、16位单通道转8位
+// - RGBA8与浮点RGBA的互相转换，RGB可以按sRGB查表转换到线性空间，编码回sRGB时按最近值取整
+// - 每种转换有标量、SSSE3与AVX2三种实现，运行时选择CPU支持的最快一种
+//   标量实现作为参考，SIMD实现使用精确的整数运算或相同的查表，输出逐字节相同
+// Pixel format conversion kernels (RGB to RGBA, swizzle, sRGB/linear, premultiply,
+// R16 to R8) with scalar reference, SSSE3 and AVX2 versions producing identical output.
+//***************************************************************************************
+
+#ifndef PIXELCONVERT_H
+#define PIXELCONVERT_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace PixelConvert
+{
+	// 转换使用的指令集，Best表示CPU支持的最快一种
+	enum class Simd
+	{
+		Scalar,
+		SSSE3,
+		AVX2,
+		Best
+	};
+
+	// CPU支持的最快实现
+	Simd GetBestSimd();
+	// 实现的名称，用于输出
+	const char* GetSimdName(Simd simd);
+
+	// 以下函数都转换count个像素，simd指定的实现不受CPU支持时退回到支持的最快一种
+
+	// RGB8扩展为RGBA8，Alpha填255，swapRedBlue为true时同时交换R与B(如BGR8转为RGBA8)
+	void RgbToRgba(const uint8_t* src, uint8_t* dst, size_t count, bool swapRedBlue = false, Simd simd = Simd::Best);
+
+	// 交换4通道像素的R与B(BGRA8与RGBA8互换)，src与dst可以相同
+	void SwapRedBlue(const uint8_t* src, uint8_t* dst, size_t count, Simd simd = Simd::Best);
+
+	// RGB乘以Alpha，按(c * a + 127) / 255取整，Alpha不变，src与dst可以相同
+	void PremultiplyAlpha(const uint8_t* src, uint8_t* dst, size_t count, Simd simd = Simd::Best);
+
+	// 16位单通道转为8位，按(v * 255 + 32767) / 65535取整
+	void R16ToR8(const uint16_t* src, uint8_t* dst, size_t count, Simd simd = Simd::Best);
+
+	// RGBA8转为0~1的浮点RGBA，srgb为true时RGB查表转换到线性空间，Alpha总是除以255
+	void UnpackRgba(const uint8_t* src, float* dst, size_t count, bool srgb, Simd simd = Simd::Best);
+
+	// 浮点RGBA编码为RGBA8，各通道先限制在0~1(Alpha先乘以alphaScale)
+	// srgb为true时RGB编码为最近的sRGB值(在sRGB空间中取整)，否则与Alpha一样按v * 255 + 0.5截断
+	void PackRgba(const float* src, uint8_t* dst, size_t count, bool srgb, float alphaScale = 1.0f, Simd simd = Simd::Best);
+}
+
+#endif
@@ -0,0 +1,310 @@
+﻿#include "ResourceCache.h"
+#include "AssetPackage.h"
+#include <condition_variable>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+struct ResourceCache::Impl
+{
+	struct Entry
+	{
+		std::shared_ptr<void> resource;
+		size_t byteSize;
+		std::weak_ptr<void> reference;					// 所有句柄共享的引用，失效时表示未被引用
+		std::list<std::string>::iterator lruIter;
+		bool loading;
+		bool retained;
+	};
+
+	// 句柄共享的引用对象，最后一个句柄释放时通知缓存
+	struct Reference
+	{
+		std::shared_ptr<void> resource;					// 缓存先于句柄销毁时由它保证资源仍然有效
+		std::weak_ptr<Impl> pImpl;
+		std::string key;
+	};
+
+	// 以下函数需要在持有mutex时调用
+	std::shared_ptr<void> MakeHandle(const std::string& key, Entry& entry);
+	void Retain(const std::string& key, Entry& entry);
+	// 被淘汰的资源移入evicted，由调用者在释放锁之后销毁
+	void EvictOverBudget(size_t budget, std::vector<std::shared_ptr<void>>& evicted);
+
+	void Release(const std::string& key);
+
+	mutable std::mutex mutex;
+	std::condition_variable loadCondition;
+	std::unordered_map<std::string, Entry> entries;
+	std::list<std::string> lru;							// 保留列表，表头为最近释放的资源
+	size_t retainBudget;
+	size_t totalBytes;
+	size_t retainedBytes;
+	uint64_t hitCount;
+	uint64_t missCount;
+	uint64_t evictCount;
+	std::weak_ptr<Impl> self;
+};
+
+std::shared_ptr<void> ResourceCache::Impl::MakeHandle(const std::string& key, Entry& entry)
+{
+	std::shared_ptr<void> reference = entry.reference.lock();
+	if (!reference)
+	{
+		if (entry.retained)
+		{
+			lru.erase(entry.lruIter);
+			retainedBytes -= entry.byteSize;
+			entry.retained = false;
+		}
+
+		Reference* pReference = new Reference{ entry.resource, self, key };
+		reference = std::shared_ptr<Reference>(pReference, [](Reference* p) {
+			if (auto pImpl = p->pImpl.lock())
+				pImpl->Release(p->key);
+			delete p;
+		});
+		entry.reference = reference;
+	}
+	// 句柄与引用对象共享计数，但指向资源本身
+	return std::shared_ptr<void>(reference, entry.resource.get());
+}
+
+void ResourceCache::Impl::Retain(const std::string& key, Entry& entry)
+{
+	lru.push_front(key);
+	entry.lruIter = lru.begin();
+	entry.retained = true;
+	retainedBytes += entry.byteSize;
+}
+
+void ResourceCache::Impl::EvictOverBudget(size_t budget, std::vector<std::shared_ptr<void>>& evicted)
+{
+	while (retainedBytes > budget || (budget == 0 && !lru.empty()))
+	{
+		auto it = entries.find(lru.back());
+		lru.pop_back();
+		retainedBytes -= it->second.byteSize;
+		totalBytes -= it->second.byteSize;
+		evicted.push_back(std::move(it->second.resource));
+		entries.erase(it);
+		++evictCount;
+	}
+}
+
+void ResourceCache::Impl::Release(const std::string& key)
+{
+	// 资源在锁外释放，避免资源的析构函数再次访问缓存时死锁
+	std::vector<std::shared_ptr<void>> evicted;
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = entries.find(key);
+	// 计数归零到这里之间可能已有新的句柄
+	if (it == entries.end() || it->second.loading || it->second.retained || !it->second.reference.expired())
+		return;
+
+	Retain(key, it->second);
+	EvictOverBudget(retainBudget, evicted);
+}
+
+ResourceCache::ResourceCache(size_t retainBudget)
+	: m_pImpl(std::make_shared<Impl>())
+{
+	m_pImpl->retainBudget = retainBudget;
+	m_pImpl->totalBytes = 0;
+	m_pImpl->retainedBytes = 0;
+	m_pImpl->hitCount = 0;
+	m_pImpl->missCount = 0;
+	m_pImpl->evictCount = 0;
+	m_pImpl->self = m_pImpl;
+}
+
+ResourceCache::~ResourceCache()
+{
+	// 仍在使用的资源由句柄持有，这里只需要释放缓存自身的引用
+	std::unordered_map<std::string, Impl::Entry> entries;
+	{
+		std::lock_guard<std::mutex> lock(m_pImpl->mutex);
+		entries.swap(m_pImpl->entries);
+		m_pImpl->lru.clear();
+	}
+}
+
+void ResourceCache::SetRetainBudget(size_t retainBudget)
+{
+	std::vector<std::shared_ptr<void>> evicted;
+	std::lock_guard<std::mutex> lock(m_pImpl->mutex);
+	m_pImpl->retainBudget = retainBudget;
+	m_pImpl->EvictOverBudget(retainBudget, evicted);
+}
+
+std::shared_ptr<void> ResourceCache::Acquire(const std::string& type, const std::wstring& fileName,
+	const std::string& options, const Loader& loader)
+{
+	std::string key = type + '|' + options + '|' + CanonicalizePath(fileName.c_str());
+	Impl& impl = *m_pImpl;
+	{
+		std::unique_lock<std::mutex> lock(impl.mutex);
+		for (;;)
+		{
+			auto it = impl.entries.find(key);
+			if (it == impl.entries.end())
+				break;
+			// 其他线程正在加载同一资源时等待其完成，加载失败时条目会被移除
+			if (it->second.loading)
+			{
+				impl.loadCondition.wait(lock);
+				continue;
+			}
+			++impl.hitCount;
+			return impl.MakeHandle(key, it->second);
+		}
+
+		++impl.missCount;
+		Impl::Entry& entry = impl.entries[key];
+		entry.byteSize = 0;
+		entry.loading = true;
+		entry.retained = false;
+	}
+
+	// 在锁外加载，loader中可以继续获取其他资源
+	size_t byteSize = 0;
+	std::shared_ptr<void> resource = loader ? loader(byteSize) : nullptr;
+
+	std::shared_ptr<void> handle;
+	{
+		std::lock_guard<std::mutex> lock(impl.mutex);
+		auto it = impl.entries.find(key);
+		if (resource)
+		{
+			it->second.resource = resource;
+			it->second.byteSize = byteSize;
+			it->second.loading = false;
+			impl.totalBytes += byteSize;
+			handle = impl.MakeHandle(key, it->second);
+		}
+		else
+		{
+			impl.entries.erase(it);
+		}
+	}
+	impl.loadCondition.notify_all();
+	return handle;
+}
+
+std::shared_ptr<void> ResourceCache::Find(const std::string& type, const std::wstring& fileName,
+	const std::string& options)
+{
+	std::string key = type + '|' + options + '|' + CanonicalizePath(fileName.c_str());
+	Impl& impl = *m_pImpl;
+	std::unique_lock<std::mutex> lock(impl.mutex);
+	for (;;)
+	{
+		auto it = impl.entries.find(key);
+		if (it == impl.entries.end())
+		{
+			++impl.missCount;
+			return nullptr;
+		}
+		if (it->second.loading)
+		{
+			impl.loadCondition.wait(lock);
+			continue;
+		}
+		++impl.hitCount;
+		return impl.MakeHandle(key, it->second);
+	}
+}
+
+std::shared_ptr<void> ResourceCache::Insert(const std::string& type, const std::wstring& fileName,
+	const std::string& options, std::shared_ptr<void> resource, size_t byteSize)
+{
+	if (!resource)
+		return nullptr;
+
+	std::string key = type + '|' + options + '|' + CanonicalizePath(fileName.c_str());
+	Impl& impl = *m_pImpl;
+	std::unique_lock<std::mutex> lock(impl.mutex);
+	for (;;)
+	{
+		auto it = impl.entries.find(key);
+		if (it == impl.entries.end())
+			break;
+		if (it->second.loading)
+		{
+			impl.loadCondition.wait(lock);
+			continue;
+		}
+		return impl.MakeHandle(key, it->second);
+	}
+
+	Impl::Entry& entry = impl.entries[key];
+	entry.resource = std::move(resource);
+	entry.byteSize = byteSize;
+	entry.loading = false;
+	entry.retained = false;
+	impl.totalBytes += byteSize;
+	return impl.MakeHandle(key, entry);
+}
+
+void ResourceCache::Trim()
+{
+	std::vector<std::shared_ptr<void>> evicted;
+	std::lock_guard<std::mutex> lock(m_pImpl->mutex);
+	m_pImpl->EvictOverBudget(0, evicted);
+}
+
+ResourceCache::Statistics ResourceCache::GetStatistics() const
+{
+	std::lock_guard<std::mutex> lock(m_pImpl->mutex);
+	Statistics statistics;
+	statistics.hitCount = m_pImpl->hitCount;
+	statistics.missCount = m_pImpl->missCount;
+	statistics.evictCount = m_pImpl->evictCount;
+	statistics.entryCount = m_pImpl->entries.size();
+	statistics.retainedCount = m_pImpl->lru.size();
+	statistics.totalBytes = m_pImpl->totalBytes;
+	statistics.retainedBytes = m_pImpl->retainedBytes;
+	statistics.retainBudget = m_pImpl->retainBudget;
+	return statistics;
+}
+
+std::string ResourceCache::CanonicalizePath(const wchar_t* fileName)
+{
+	std::string normalized = AssetPackage::NormalizeName(fileName);
+
+	// 逐段处理，..只能抵消之前的普通段，否则保留(如开头的..\)
+	std::vector<std::string> segments;
+	size_t begin = 0;
+	bool absolute = !normalized.empty() && normalized[0] == '/';
+	while (begin <= normalized.size())
+	{
+		size_t end = normalized.find('/', begin);
+		if (end == std::string::npos)
+			end = normalized.size();
+		std::string segment = normalized.substr(begin, end - begin);
+		begin = end + 1;
+
+		if (segment.empty() || segment == ".")
+			continue;
+		if (segment == ".." && !segments.empty() && segments.back() != "..")
+			segments.pop_back();
+		else
+			segments.push_back(segment);
+	}
+
+	std::string result = absolute ? "/" : "";
+	for (size_t i = 0; i < segments.size(); ++i)
+	{
+		if (i > 0)
+			result += '/';
+		result += segments[i];
+	}
+	return result;
+}
+
+ResourceCache& ResourceCache::GetDefault()
+{
+	static ResourceCache cache;
+	return cache;
+}
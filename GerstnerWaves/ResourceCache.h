@@ -0,0 +1,85 @@
+﻿//***************************************************************************************
+// ResourceCache.h
+// Licensed under the MIT License.
+//
+// 以规范化路径(与加载选项)为键的资源缓存
+// - 同一个键的资源只加载一次，多个使用者共享同一份数据，并发的加载会等待第一次加载完成
+// - 返回的句柄为带引用计数的shared_ptr，最后一个句柄释放后资源进入LRU保留列表
+// - 保留的资源总大小超出预算时，从最久未使用的资源开始淘汰，预算为0时不保留
+// Resource cache keyed by canonical path plus load options. Handles are reference
+// counted; unreferenced entries are retained in LRU order within a memory budget.
+//***************************************************************************************
+
+#ifndef RESOURCECACHE_H
+#define RESOURCECACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+class ResourceCache
+{
+public:
+	// 默认保留64MB未被引用的资源
+	static const size_t kDefaultRetainBudget = 64 * 1024 * 1024;
+
+	// 加载回调，返回资源并通过byteSize给出其占用的内存，失败时返回nullptr
+	typedef std::function<std::shared_ptr<void>(size_t& byteSize)> Loader;
+
+	struct Statistics
+	{
+		uint64_t hitCount;				// 命中次数(包括命中保留列表中的资源)
+		uint64_t missCount;				// 未命中次数
+		uint64_t evictCount;			// 淘汰次数
+		size_t entryCount;				// 缓存的资源数目
+		size_t retainedCount;			// 其中未被引用、处于保留列表中的数目
+		size_t totalBytes;				// 缓存的资源总大小
+		size_t retainedBytes;			// 保留列表中的资源总大小
+		size_t retainBudget;
+	};
+
+	explicit ResourceCache(size_t retainBudget = kDefaultRetainBudget);
+	// 句柄可以比缓存存活得更久，缓存销毁后句柄释放时直接释放资源
+	~ResourceCache();
+
+	ResourceCache(const ResourceCache&) = delete;
+	ResourceCache& operator=(const ResourceCache&) = delete;
+
+	// 设置保留列表的预算，超出的部分立即淘汰
+	void SetRetainBudget(size_t retainBudget);
+
+	// 获取资源，不在缓存中时调用loader加载，加载失败时返回nullptr
+	std::shared_ptr<void> Acquire(const std::string& type, const std::wstring& fileName, const std::string& options,
+		const Loader& loader);
+	template<class T>
+	std::shared_ptr<T> Acquire(const std::string& type, const std::wstring& fileName, const std::string& options,
+		const Loader& loader)
+	{
+		return std::static_pointer_cast<T>(Acquire(type, fileName, options, loader));
+	}
+
+	// 只查找不加载，找不到时返回nullptr
+	std::shared_ptr<void> Find(const std::string& type, const std::wstring& fileName, const std::string& options);
+	// 放入已经加载好的资源，若该键已存在则丢弃resource并返回已有的资源
+	std::shared_ptr<void> Insert(const std::string& type, const std::wstring& fileName, const std::string& options,
+		std::shared_ptr<void> resource, size_t byteSize);
+
+	// 淘汰保留列表中的所有资源
+	void Trim();
+
+	Statistics GetStatistics() const;
+
+	// 规范化路径: ASCII字母转为小写，\转为/，并去掉路径中的.与..
+	static std::string CanonicalizePath(const wchar_t* fileName);
+
+	// 进程共享的默认缓存
+	static ResourceCache& GetDefault();
+
+private:
+	struct Impl;
+	std::shared_ptr<Impl> m_pImpl;
+};
+
+#endif
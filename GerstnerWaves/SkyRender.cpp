@@ -1,12 +1,39 @@
 ﻿#include "SkyRender.h"
 #include "Geometry.h"
 #include "d3dUtil.h"
+#include "MappedFile.h"
+#include <chrono>
 
 #pragma warning(disable: 26812)
 
 using namespace DirectX;
 using namespace Microsoft::WRL;
 
+// 输出天空盒纹理的加载耗时
+static void ReportLoadTime(const std::wstring& name, std::chrono::high_resolution_clock::time_point start)
+{
+	float ms = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	wchar_t message[512];
+	swprintf_s(message, L"[SkyRender] %ls: %.2f ms\n", name.c_str(), ms);
+	OutputDebugStringW(message);
+}
+
+// 烘焙(AssetTool cook)把天空盒展开图编码为同名的块压缩立方体DDS，存在时直接从映射的文件上传
+static HRESULT CreateCookedTextureCube(ID3D11Device* device, const std::wstring& cubemapFilename,
+	ID3D11ShaderResourceView** textureCubeView)
+{
+	size_t dotPos = cubemapFilename.find_last_of(L'.');
+	if (dotPos == std::wstring::npos)
+		return E_FAIL;
+	std::wstring ddsFilename = cubemapFilename.substr(0, dotPos) + L".dds";
+
+	MappedFile file;
+	DdsReader reader;
+	if (!file.Open(ddsFilename.c_str()) || !reader.Parse(file.GetData(), file.GetSize()) || !reader.IsCubeMap())
+		return E_FAIL;
+	return CreateTextureFromDds(device, reader, textureCubeView);
+}
+
 HRESULT SkyRender::InitResource(ID3D11Device* device, ID3D11DeviceContext* deviceContext, const std::wstring& cubemapFilename, float skySphereRadius, bool generateMips)
 {
 	// 防止重复初始化造成内存泄漏
@@ -16,6 +43,7 @@ HRESULT SkyRender::InitResource(ID3D11Device* device, ID3D11DeviceContext* devic
 
 	HRESULT hr;
 	// 天空盒纹理加载
+	auto start = std::chrono::high_resolution_clock::now();
 	if (cubemapFilename.substr(cubemapFilename.size() - 3) == L"dds")
 	{
 		hr = CreateDDSTextureFromFile(device,
@@ -26,16 +54,21 @@ HRESULT SkyRender::InitResource(ID3D11Device* device, ID3D11DeviceContext* devic
 	}
 	else
 	{
-		hr = CreateWICTexture2DCubeFromFile(device,
-			deviceContext,
-			cubemapFilename,
-			nullptr,
-			m_pTextureCubeSRV.GetAddressOf(),
-			generateMips);
+		hr = CreateCookedTextureCube(device, cubemapFilename, m_pTextureCubeSRV.GetAddressOf());
+		if (FAILED(hr))
+		{
+			hr = CreateWICTexture2DCubeFromFile(device,
+				deviceContext,
+				cubemapFilename,
+				nullptr,
+				m_pTextureCubeSRV.GetAddressOf(),
+				generateMips);
+		}
 	}
 
 	if (FAILED(hr))
 		return hr;
+	ReportLoadTime(cubemapFilename, start);
 
 	return InitResource(device, skySphereRadius);
 }
@@ -49,6 +82,7 @@ HRESULT SkyRender::InitResource(ID3D11Device* device, ID3D11DeviceContext* devic
 
 	HRESULT hr;
 	// 天空盒纹理加载
+	auto start = std::chrono::high_resolution_clock::now();
 	hr = CreateWICTexture2DCubeFromFile(device,
 		deviceContext,
 		cubemapFilenames,
@@ -57,6 +91,7 @@ HRESULT SkyRender::InitResource(ID3D11Device* device, ID3D11DeviceContext* devic
 		generateMips);
 	if (FAILED(hr))
 		return hr;
+	ReportLoadTime(cubemapFilenames[0], start);
 
 	return InitResource(device, skySphereRadius);
 }
@@ -0,0 +1,207 @@
+﻿#include "TextureAtlas.h"
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	// 以格子为单位的矩形
+	struct CellRect
+	{
+		uint32_t x;
+		uint32_t y;
+		uint32_t width;
+		uint32_t height;
+	};
+
+	bool Contains(const CellRect& outer, const CellRect& inner)
+	{
+		return inner.x >= outer.x && inner.y >= outer.y &&
+			inner.x + inner.width <= outer.x + outer.width && inner.y + inner.height <= outer.y + outer.height;
+	}
+
+	// 在width x height个格子中按order的顺序放置各纹理，全部放下时返回true
+	bool PackCells(const std::vector<std::pair<uint32_t, uint32_t>>& cells, const std::vector<size_t>& order,
+		uint32_t width, uint32_t height, std::vector<CellRect>& placed)
+	{
+		std::vector<CellRect> freeRects(1, CellRect{ 0, 0, width, height });
+		std::vector<CellRect> splitRects;
+		placed.resize(cells.size());
+		for (size_t index : order)
+		{
+			uint32_t w = cells[index].first, h = cells[index].second;
+
+			// 最短边最佳适配: 放入后剩余的短边最小，相同时比较剩余的长边
+			size_t best = freeRects.size();
+			uint32_t bestShort = UINT32_MAX, bestLong = UINT32_MAX;
+			for (size_t i = 0; i < freeRects.size(); ++i)
+			{
+				const CellRect& free = freeRects[i];
+				if (free.width < w || free.height < h)
+					continue;
+				uint32_t leftoverX = free.width - w, leftoverY = free.height - h;
+				uint32_t shortSide = (std::min)(leftoverX, leftoverY), longSide = (std::max)(leftoverX, leftoverY);
+				if (shortSide < bestShort || (shortSide == bestShort && longSide < bestLong))
+				{
+					best = i;
+					bestShort = shortSide;
+					bestLong = longSide;
+				}
+			}
+			if (best == freeRects.size())
+				return false;
+			CellRect rect = { freeRects[best].x, freeRects[best].y, w, h };
+			placed[index] = rect;
+
+			// 与新矩形相交的空闲矩形拆分为其上下左右剩余的最大矩形(彼此可以重叠)
+			splitRects.clear();
+			for (const CellRect& free : freeRects)
+			{
+				if (rect.x >= free.x + free.width || rect.x + rect.width <= free.x ||
+					rect.y >= free.y + free.height || rect.y + rect.height <= free.y)
+				{
+					splitRects.push_back(free);
+					continue;
+				}
+				if (rect.x > free.x)
+					splitRects.push_back({ free.x, free.y, rect.x - free.x, free.height });
+				if (rect.x + rect.width < free.x + free.width)
+					splitRects.push_back({ rect.x + rect.width, free.y, free.x + free.width - rect.x - rect.width, free.height });
+				if (rect.y > free.y)
+					splitRects.push_back({ free.x, free.y, free.width, rect.y - free.y });
+				if (rect.y + rect.height < free.y + free.height)
+					splitRects.push_back({ free.x, rect.y + rect.height, free.width, free.y + free.height - rect.y - rect.height });
+			}
+
+			// 去掉被其他空闲矩形包含的矩形，完全相同的只保留第一个
+			freeRects.clear();
+			for (size_t i = 0; i < splitRects.size(); ++i)
+			{
+				bool contained = false;
+				for (size_t j = 0; j < splitRects.size() && !contained; ++j)
+				{
+					contained = i != j && Contains(splitRects[j], splitRects[i]) &&
+						(j < i || !Contains(splitRects[i], splitRects[j]));
+				}
+				if (!contained)
+					freeRects.push_back(splitRects[i]);
+			}
+		}
+		return true;
+	}
+}
+
+TextureAtlas::Options TextureAtlas::GetDefaultOptions()
+{
+	return Options{ 4096, 1, 5 };
+}
+
+bool TextureAtlas::Pack(const std::vector<std::pair<uint32_t, uint32_t>>& sizes, const Options& options, Result& result)
+{
+	if (sizes.empty() || options.maxSize == 0)
+		return false;
+
+	// 纹理的宽高需要能被2^(mipCount-1)整除，第mipCount-1级中纹理的边界才落在整像素上
+	uint32_t mipCount = (std::max)(options.mipCount, 1u);
+	for (const auto& size : sizes)
+	{
+		if (size.first == 0 || size.second == 0)
+			return false;
+		while (mipCount > 1 && ((size.first | size.second) & ((1u << (mipCount - 1)) - 1)) != 0)
+			--mipCount;
+	}
+	uint32_t alignment = 1u << (mipCount - 1);
+	uint32_t border = options.gutter * alignment;
+
+	// 以alignment x alignment像素为一个格子装箱，格子的边界在前mipCount级中都落在整像素上，
+	// 盒式滤波不会把相邻格子的像素混在一起
+	std::vector<std::pair<uint32_t, uint32_t>> cells(sizes.size());
+	uint64_t area = 0;
+	uint32_t maxWidth = 0, maxHeight = 0;
+	for (size_t i = 0; i < sizes.size(); ++i)
+	{
+		cells[i].first = (sizes[i].first + 2 * border) / alignment;
+		cells[i].second = (sizes[i].second + 2 * border) / alignment;
+		area += static_cast<uint64_t>(cells[i].first) * cells[i].second;
+		maxWidth = (std::max)(maxWidth, cells[i].first);
+		maxHeight = (std::max)(maxHeight, cells[i].second);
+	}
+
+	// 先放大的纹理
+	std::vector<size_t> order(sizes.size());
+	for (size_t i = 0; i < order.size(); ++i)
+		order[i] = i;
+	std::stable_sort(order.begin(), order.end(), [&cells](size_t a, size_t b) {
+		uint32_t sideA = (std::max)(cells[a].first, cells[a].second), sideB = (std::max)(cells[b].first, cells[b].second);
+		if (sideA != sideB)
+			return sideA > sideB;
+		return static_cast<uint64_t>(cells[a].first) * cells[a].second > static_cast<uint64_t>(cells[b].first) * cells[b].second;
+	});
+
+	// 按面积从小到大尝试2的幂次尺寸，面积相同时优先接近正方形的尺寸
+	uint32_t maxCells = options.maxSize / alignment;
+	std::vector<std::pair<uint32_t, uint32_t>> candidates;
+	for (uint32_t w = 1; w <= maxCells; w *= 2)
+	{
+		for (uint32_t h = 1; h <= maxCells; h *= 2)
+		{
+			if (w >= maxWidth && h >= maxHeight && static_cast<uint64_t>(w) * h >= area)
+				candidates.emplace_back(w, h);
+		}
+	}
+	std::sort(candidates.begin(), candidates.end(), [](const std::pair<uint32_t, uint32_t>& a, const std::pair<uint32_t, uint32_t>& b) {
+		uint64_t areaA = static_cast<uint64_t>(a.first) * a.second, areaB = static_cast<uint64_t>(b.first) * b.second;
+		if (areaA != areaB)
+			return areaA < areaB;
+		return (std::max)(a.first, a.second) < (std::max)(b.first, b.second);
+	});
+
+	std::vector<CellRect> placed;
+	for (const auto& candidate : candidates)
+	{
+		if (!PackCells(cells, order, candidate.first, candidate.second, placed))
+			continue;
+
+		result.width = candidate.first * alignment;
+		result.height = candidate.second * alignment;
+		result.mipCount = mipCount;
+		result.border = border;
+		result.placements.resize(sizes.size());
+		for (size_t i = 0; i < sizes.size(); ++i)
+		{
+			result.placements[i] = { placed[i].x * alignment + border, placed[i].y * alignment + border,
+				sizes[i].first, sizes[i].second };
+		}
+		return true;
+	}
+	return false;
+}
+
+void TextureAtlas::Blit(const uint8_t* rgba, size_t rowPitch, const Placement& placement, uint32_t border,
+	uint8_t* atlas, size_t atlasRowPitch)
+{
+	size_t contentBytes = static_cast<size_t>(placement.width) * 4;
+	for (uint32_t y = 0; y < placement.height + 2 * border; ++y)
+	{
+		// 上下的边缘重复第一行与最后一行
+		uint32_t sourceY = y < border ? 0 : (std::min)(y - border, placement.height - 1);
+		const uint8_t* src = rgba + sourceY * rowPitch;
+		uint8_t* dst = atlas + (static_cast<size_t>(placement.y) - border + y) * atlasRowPitch +
+			(static_cast<size_t>(placement.x) - border) * 4;
+
+		// 左右的边缘重复行首与行尾的像素
+		for (uint32_t x = 0; x < border; ++x)
+			memcpy(dst + x * 4, src, 4);
+		memcpy(dst + border * 4, src, contentBytes);
+		for (uint32_t x = 0; x < border; ++x)
+			memcpy(dst + border * 4 + contentBytes + x * 4, src + contentBytes - 4, 4);
+	}
+}
+
+void TextureAtlas::GetUvTransform(const Placement& placement, uint32_t atlasWidth, uint32_t atlasHeight,
+	float (&scale)[2], float (&offset)[2])
+{
+	scale[0] = static_cast<float>(placement.width) / atlasWidth;
+	scale[1] = static_cast<float>(placement.height) / atlasHeight;
+	offset[0] = static_cast<float>(placement.x) / atlasWidth;
+	offset[1] = static_cast<float>(placement.y) / atlasHeight;
+}
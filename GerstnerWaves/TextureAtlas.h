@@ -0,0 +1,65 @@
+﻿//***************************************************************************************
+// TextureAtlas.h
+// Licensed under the MIT License.
+//
+// 烘焙时把模型引用的小纹理合并为一张图集，减少纹理数目与绘制时的SRV切换
+// - 按MaxRects(最短边最佳适配)装箱，图集为不超过最大边长的2的幂次尺寸
+// - 每个纹理四周留出重复边缘像素的间隔，且按2^(mipCount-1)对齐，
+//   盒式滤波生成的前mipCount级中各纹理互不串色，双线性采样也不会取到相邻纹理
+// - 纹理坐标需要在[0, 1]内(不能平铺)，按uv * scale + offset变换到图集空间
+// Cook-time texture atlas packing (MaxRects) with mip-aligned, edge-extended gutters
+// and the UV transform used to remap model texture coordinates into the atlas.
+//***************************************************************************************
+
+#ifndef TEXTUREATLAS_H
+#define TEXTUREATLAS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace TextureAtlas
+{
+	struct Options
+	{
+		uint32_t maxSize;		// 图集的最大边长
+		uint32_t gutter;		// 每一级mip中纹理四周至少保留的边缘像素数
+		uint32_t mipCount;		// 需要保证互不串色的mip级数，实际级数还受纹理尺寸限制
+	};
+
+	// 默认: 最大4096，间隔1像素，5级mip
+	Options GetDefaultOptions();
+
+	// 纹理在图集中的位置(不含边缘)
+	struct Placement
+	{
+		uint32_t x;
+		uint32_t y;
+		uint32_t width;
+		uint32_t height;
+	};
+
+	struct Result
+	{
+		uint32_t width;						// 图集尺寸
+		uint32_t height;
+		uint32_t mipCount;					// 互不串色的mip级数，图集只应生成这么多级
+		uint32_t border;					// 第0级中每个纹理四周的边缘像素数
+		std::vector<Placement> placements;	// 与输入的纹理一一对应
+	};
+
+	// 纹理的宽高以(width, height)成对给出，全部装入时返回true
+	// 纹理宽高中2的因子较少时会降低result.mipCount
+	bool Pack(const std::vector<std::pair<uint32_t, uint32_t>>& sizes, const Options& options, Result& result);
+
+	// 把RGBA8纹理复制到图集中placement的位置，并向四周border像素重复边缘像素
+	void Blit(const uint8_t* rgba, size_t rowPitch, const Placement& placement, uint32_t border,
+		uint8_t* atlas, size_t atlasRowPitch);
+
+	// 纹理坐标到图集空间的变换: uv' = uv * scale + offset，uv需要先限制在[0, 1]
+	void GetUvTransform(const Placement& placement, uint32_t atlasWidth, uint32_t atlasHeight,
+		float (&scale)[2], float (&offset)[2]);
+}
+
+#endif
@@ -0,0 +1,245 @@
+﻿#include "TextureBudget.h"
+#include "DdsReader.h"
+#include "ResourceCache.h"
+#include <algorithm>
+#include <mutex>
+#include <unordered_map>
+
+const float TextureBudget::kDefaultPriority = 1.0f;
+
+struct TextureBudget::Impl
+{
+	struct Entry
+	{
+		std::vector<size_t> mipBytes;	// 每级mip所有数组元素的字节数
+		uint32_t width;
+		uint32_t height;
+		bool blockCompressed;
+		uint32_t residentSkip;
+		uint32_t targetSkip;
+	};
+
+	size_t GetBytes(const Entry& entry, uint32_t skip) const;
+	uint32_t GetMaxSkip(const Entry& entry) const;
+	float GetPriority(const std::string& name) const;
+	// 计算所有纹理的targetSkip，需要在持有mutex时调用
+	void Plan();
+
+	mutable std::mutex mutex;
+	std::unordered_map<std::string, Entry> entries;
+	std::unordered_map<std::string, float> priorities;
+	size_t budget;
+	uint32_t minDimension;
+};
+
+namespace
+{
+	// 跳过skip级mip后的顶层尺寸是否可用
+	bool IsSkipValid(uint32_t width, uint32_t height, bool blockCompressed, uint32_t skip, uint32_t minDimension)
+	{
+		uint32_t w = (std::max)(width >> skip, 1u);
+		uint32_t h = (std::max)(height >> skip, 1u);
+		if ((std::max)(w, h) < minDimension)
+			return false;
+		// D3D11要求块压缩纹理的顶层尺寸为4的倍数
+		return !blockCompressed || (w % 4 == 0 && h % 4 == 0);
+	}
+
+	uint32_t GetMaxSkip(uint32_t width, uint32_t height, bool blockCompressed, uint32_t mipCount, uint32_t minDimension)
+	{
+		uint32_t maxSkip = 0;
+		for (uint32_t skip = 1; skip < mipCount; ++skip)
+		{
+			if (!IsSkipValid(width, height, blockCompressed, skip, minDimension))
+				break;
+			maxSkip = skip;
+		}
+		return maxSkip;
+	}
+}
+
+size_t TextureBudget::Impl::GetBytes(const Entry& entry, uint32_t skip) const
+{
+	size_t bytes = 0;
+	for (size_t i = skip; i < entry.mipBytes.size(); ++i)
+		bytes += entry.mipBytes[i];
+	return bytes;
+}
+
+uint32_t TextureBudget::Impl::GetMaxSkip(const Entry& entry) const
+{
+	return ::GetMaxSkip(entry.width, entry.height, entry.blockCompressed,
+		static_cast<uint32_t>(entry.mipBytes.size()), minDimension);
+}
+
+float TextureBudget::Impl::GetPriority(const std::string& name) const
+{
+	auto it = priorities.find(name);
+	return it == priorities.end() ? kDefaultPriority : it->second;
+}
+
+void TextureBudget::Impl::Plan()
+{
+	size_t total = 0;
+	for (auto& it : entries)
+	{
+		it.second.targetSkip = 0;
+		total += GetBytes(it.second, 0);
+	}
+
+	// 每次降低一级，纹理数目不多，直接线性查找
+	while (total > budget)
+	{
+		Entry* pVictim = nullptr;
+		float victimPriority = 0.0f;
+		size_t victimBytes = 0;
+		for (auto& it : entries)
+		{
+			Entry& entry = it.second;
+			if (entry.targetSkip >= GetMaxSkip(entry))
+				continue;
+			float priority = GetPriority(it.first);
+			size_t bytes = GetBytes(entry, entry.targetSkip);
+			if (!pVictim || priority < victimPriority || (priority == victimPriority && bytes > victimBytes))
+			{
+				pVictim = &entry;
+				victimPriority = priority;
+				victimBytes = bytes;
+			}
+		}
+		if (!pVictim)
+			break;
+
+		total -= pVictim->mipBytes[pVictim->targetSkip];
+		++pVictim->targetSkip;
+	}
+}
+
+TextureBudget::TextureBudget(size_t budget)
+	: m_pImpl(new Impl)
+{
+	m_pImpl->budget = budget;
+	m_pImpl->minDimension = kDefaultMinDimension;
+}
+
+TextureBudget::~TextureBudget()
+{
+}
+
+void TextureBudget::SetBudget(size_t budget)
+{
+	std::lock_guard<std::mutex> lock(m_pImpl->mutex);
+	m_pImpl->budget = budget;
+}
+
+size_t TextureBudget::GetBudget() const
+{
+	std::lock_guard<std::mutex> lock(m_pImpl->mutex);
+	return m_pImpl->budget;
+}
+
+void TextureBudget::SetMinDimension(uint32_t minDimension)
+{
+	std::lock_guard<std::mutex> lock(m_pImpl->mutex);
+	m_pImpl->minDimension = minDimension;
+}
+
+void TextureBudget::SetPriority(const std::wstring& fileName, float priority)
+{
+	std::lock_guard<std::mutex> lock(m_pImpl->mutex);
+	m_pImpl->priorities[ResourceCache::CanonicalizePath(fileName.c_str())] = priority;
+}
+
+uint32_t TextureBudget::Register(const std::wstring& fileName, const DdsReader& reader)
+{
+	Impl::Entry entry;
+	entry.mipBytes.resize(reader.GetMipCount());
+	for (uint32_t mip = 0; mip < reader.GetMipCount(); ++mip)
+		entry.mipBytes[mip] = GetResidentBytes(reader, mip) - GetResidentBytes(reader, mip + 1);
+	entry.width = reader.GetWidth();
+	entry.height = reader.GetHeight();
+	entry.blockCompressed = DdsReader::IsBlockCompressed(reader.GetFormat());
+	entry.residentSkip = 0;
+	entry.targetSkip = 0;
+
+	std::lock_guard<std::mutex> lock(m_pImpl->mutex);
+	std::string name = ResourceCache::CanonicalizePath(fileName.c_str());
+	Impl::Entry& registered = m_pImpl->entries[name] = std::move(entry);
+	m_pImpl->Plan();
+	registered.residentSkip = registered.targetSkip;
+	return registered.residentSkip;
+}
+
+void TextureBudget::Unregister(const std::wstring& fileName)
+{
+	std::lock_guard<std::mutex> lock(m_pImpl->mutex);
+	m_pImpl->entries.erase(ResourceCache::CanonicalizePath(fileName.c_str()));
+}
+
+void TextureBudget::SetResident(const std::wstring& fileName, uint32_t skip)
+{
+	std::lock_guard<std::mutex> lock(m_pImpl->mutex);
+	auto it = m_pImpl->entries.find(ResourceCache::CanonicalizePath(fileName.c_str()));
+	if (it != m_pImpl->entries.end())
+		it->second.residentSkip = (std::min)(skip, static_cast<uint32_t>(it->second.mipBytes.size()) - 1);
+}
+
+std::vector<TextureBudget::Request> TextureBudget::Rebalance()
+{
+	std::vector<Request> requests;
+	std::lock_guard<std::mutex> lock(m_pImpl->mutex);
+	m_pImpl->Plan();
+	for (const auto& it : m_pImpl->entries)
+	{
+		if (it.second.targetSkip != it.second.residentSkip)
+			requests.push_back({ it.first, it.second.residentSkip, it.second.targetSkip });
+	}
+	// 先降级腾出空间，再升级
+	std::sort(requests.begin(), requests.end(), [](const Request& lhs, const Request& rhs) {
+		bool lhsDowngrade = lhs.targetSkip > lhs.residentSkip;
+		bool rhsDowngrade = rhs.targetSkip > rhs.residentSkip;
+		return lhsDowngrade != rhsDowngrade ? lhsDowngrade : lhs.name < rhs.name;
+	});
+	return requests;
+}
+
+TextureBudget::Statistics TextureBudget::GetStatistics() const
+{
+	std::lock_guard<std::mutex> lock(m_pImpl->mutex);
+	Statistics statistics = {};
+	statistics.budget = m_pImpl->budget;
+	for (const auto& it : m_pImpl->entries)
+	{
+		++statistics.textureCount;
+		statistics.fullBytes += m_pImpl->GetBytes(it.second, 0);
+		statistics.residentBytes += m_pImpl->GetBytes(it.second, it.second.residentSkip);
+		statistics.trimmedMipCount += it.second.residentSkip;
+	}
+	return statistics;
+}
+
+size_t TextureBudget::GetResidentBytes(const DdsReader& reader, uint32_t skip)
+{
+	size_t bytes = 0;
+	for (uint32_t item = 0; item < reader.GetArraySize(); ++item)
+	{
+		for (uint32_t mip = skip; mip < reader.GetMipCount(); ++mip)
+		{
+			const DdsReader::Subresource& subresource = reader.GetSubresource(item, mip);
+			bytes += subresource.slicePitch * subresource.depth;
+		}
+	}
+	return bytes;
+}
+
+uint32_t TextureBudget::GetMaxSkip(const DdsReader& reader, uint32_t minDimension)
+{
+	return ::GetMaxSkip(reader.GetWidth(), reader.GetHeight(), DdsReader::IsBlockCompressed(reader.GetFormat()),
+		reader.GetMipCount(), minDimension);
+}
+
+TextureBudget& TextureBudget::GetDefault()
+{
+	static TextureBudget budget;
+	return budget;
+}
@@ -0,0 +1,91 @@
+﻿//***************************************************************************************
+// TextureBudget.h
+// Licensed under the MIT License.
+//
+// 纹理显存预算
+// - 加载DDS纹理时登记其每级mip的大小，按全局预算与纹理优先级决定跳过最大的几级mip
+// - 记录每个纹理当前驻留的字节数，预算或优先级变化后由Rebalance给出需要降级或升级的纹理
+// - 超出预算时从优先级最低的纹理开始逐级降低，同优先级时先降低驻留最大的纹理
+// Texture memory budget: decides how many top mips of each DDS texture to skip at
+// load time from a global budget and per-texture priorities, and tracks residency.
+//***************************************************************************************
+
+#ifndef TEXTUREBUDGET_H
+#define TEXTUREBUDGET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class DdsReader;
+
+class TextureBudget
+{
+public:
+	// 默认不限制
+	static const size_t kUnlimited = SIZE_MAX;
+	// 默认降级后的最大边长不小于64
+	static const uint32_t kDefaultMinDimension = 64;
+	static const float kDefaultPriority;
+
+	// 需要改变驻留mip的纹理
+	struct Request
+	{
+		std::string name;				// 规范化的路径
+		uint32_t residentSkip;			// 当前跳过的mip数
+		uint32_t targetSkip;			// 应跳过的mip数，小于residentSkip表示升级
+	};
+
+	struct Statistics
+	{
+		size_t textureCount;
+		size_t fullBytes;				// 加载完整mip链时的总大小
+		size_t residentBytes;			// 实际驻留的总大小
+		size_t budget;
+		uint64_t trimmedMipCount;		// 当前被跳过的mip总数
+	};
+
+	explicit TextureBudget(size_t budget = kUnlimited);
+	~TextureBudget();
+
+	TextureBudget(const TextureBudget&) = delete;
+	TextureBudget& operator=(const TextureBudget&) = delete;
+
+	// 设置预算，之后需要调用Rebalance获取降级或升级请求
+	void SetBudget(size_t budget);
+	size_t GetBudget() const;
+	// 降级时保留的最大边长下限，mip链短于此的纹理不会降级
+	void SetMinDimension(uint32_t minDimension);
+
+	// 设置纹理的优先级(越大越重要)，可以在加载之前设置
+	void SetPriority(const std::wstring& fileName, float priority);
+
+	// 加载时登记纹理，返回应跳过的mip数
+	// 为新纹理腾出空间而需要降级的其他纹理由之后的Rebalance给出
+	uint32_t Register(const std::wstring& fileName, const DdsReader& reader);
+	// 纹理释放时注销
+	void Unregister(const std::wstring& fileName);
+	// 应用请求重新创建纹理后，记录实际跳过的mip数
+	void SetResident(const std::wstring& fileName, uint32_t skip);
+
+	// 按预算与优先级重新计算每个纹理应跳过的mip数，返回与当前驻留不同的纹理
+	std::vector<Request> Rebalance();
+
+	Statistics GetStatistics() const;
+
+	// 跳过skip级mip后所有数组元素的总字节数
+	static size_t GetResidentBytes(const DdsReader& reader, uint32_t skip);
+	// 在最大边长不小于minDimension、块压缩纹理的尺寸为4的倍数的前提下最多可以跳过的mip数
+	static uint32_t GetMaxSkip(const DdsReader& reader, uint32_t minDimension);
+
+	// 进程共享的默认预算，d3dUtil加载DDS纹理时使用
+	static TextureBudget& GetDefault();
+
+private:
+	struct Impl;
+	std::unique_ptr<Impl> m_pImpl;
+};
+
+#endif
@@ -0,0 +1,112 @@
+﻿#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+ThreadPool::ThreadPool(size_t threadCount)
+	: m_Stop(false)
+{
+	if (threadCount == 0)
+	{
+		unsigned hardwareThreads = std::thread::hardware_concurrency();
+		threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+
+	m_Threads.reserve(threadCount);
+	for (size_t i = 0; i < threadCount; ++i)
+		m_Threads.emplace_back(&ThreadPool::WorkerThread, this);
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Stop = true;
+	}
+	m_Condition.notify_all();
+	for (auto& thread : m_Threads)
+		thread.join();
+}
+
+void ThreadPool::Enqueue(std::function<void()> task)
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_Tasks.push_back(std::move(task));
+	}
+	m_Condition.notify_one();
+}
+
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& func)
+{
+	if (count == 0)
+		return;
+	if (count == 1)
+	{
+		func(0);
+		return;
+	}
+
+	// 各线程从共享的计数器中领取下标，先领完的线程直接退出
+	// 提交出去的任务可能在ParallelFor返回后才开始执行，因此状态放在共享指针中
+	struct State
+	{
+		std::atomic<size_t> next;
+		std::atomic<size_t> remaining;
+		const std::function<void(size_t)>* func;
+		std::mutex mutex;
+		std::condition_variable done;
+	};
+	auto state = std::make_shared<State>();
+	state->next = 0;
+	state->remaining = count;
+	state->func = &func;
+
+	auto run = [state, count]()
+	{
+		for (;;)
+		{
+			size_t i = state->next.fetch_add(1);
+			if (i >= count)
+				return;
+			(*state->func)(i);
+			if (state->remaining.fetch_sub(1) == 1)
+			{
+				std::lock_guard<std::mutex> lock(state->mutex);
+				state->done.notify_all();
+			}
+		}
+	};
+
+	size_t helperCount = (std::min)(m_Threads.size(), count - 1);
+	for (size_t i = 0; i < helperCount; ++i)
+		Enqueue(run);
+	run();
+
+	// 其余线程可能仍在执行已领取的下标
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->done.wait(lock, [&state]() { return state->remaining.load() == 0; });
+}
+
+ThreadPool& ThreadPool::GetDefault()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+void ThreadPool::WorkerThread()
+{
+	for (;;)
+	{
+		std::function<void()> task;
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Condition.wait(lock, [this]() { return m_Stop || !m_Tasks.empty(); });
+			if (m_Tasks.empty())
+				return;
+			task = std::move(m_Tasks.front());
+			m_Tasks.pop_front();
+		}
+		task();
+	}
+}
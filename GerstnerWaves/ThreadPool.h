@@ -0,0 +1,56 @@
+﻿//***************************************************************************************
+// ThreadPool.h
+// Licensed under the MIT License.
+//
+// 固定数目工作线程的线程池
+// - Enqueue提交的任务按先进先出的顺序执行
+// - ParallelFor把循环拆分给工作线程，调用线程同样参与执行，因此可以在任务中嵌套调用
+// Fixed-size worker thread pool with FIFO tasks and a ParallelFor in which the
+// calling thread also takes part, so it can be used from inside tasks.
+//***************************************************************************************
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+public:
+	// threadCount为0时使用硬件线程数减1(至少为1)，调用线程会在ParallelFor中补上剩下的一个
+	explicit ThreadPool(size_t threadCount = 0);
+	// 等待队列中的任务执行完毕后结束所有工作线程
+	~ThreadPool();
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	size_t GetThreadCount() const { return m_Threads.size(); }
+
+	// 提交任务，任务在某个工作线程上执行
+	void Enqueue(std::function<void()> task);
+
+	// 对[0, count)中的每个i调用func(i)，所有调用完成后返回
+	// 调用顺序与所在线程都不确定，func需要是线程安全的
+	void ParallelFor(size_t count, const std::function<void(size_t)>& func);
+
+	// 进程共享的默认线程池，第一次使用时创建
+	static ThreadPool& GetDefault();
+
+private:
+	void WorkerThread();
+
+	std::vector<std::thread> m_Threads;
+	std::deque<std::function<void()>> m_Tasks;
+	std::mutex m_Mutex;
+	std::condition_variable m_Condition;
+	bool m_Stop;
+};
+
+#endif
@@ -0,0 +1,339 @@
+﻿//***************************************************************************************
+// AssetLoaderTest.cpp
+// Licensed under the MIT License.
+//
+// 异步资源加载服务(见AssetLoader)的测试，用临时目录中的文件与记录调用的解码、上传回调代替真实的资源，可在Linux上构建与运行
+// - 唯一的解码线程被阻塞时提交不同优先级的请求，检查解码按优先级、相同优先级按请求顺序进行
+// - 检查未完成的相同请求被合并、只解码一次，取消共享请求的一个句柄不影响其他句柄，全部取消后请求被取消
+// - 检查句柄被覆盖或析构时释放对原请求的需求
+// - 检查上传只在调用Update或Wait的线程上执行，以及读取失败与未注册类型的请求
+// 任何检查失败时返回1
+// Headless test for AssetLoader with fake decoders and uploaders.
+//***************************************************************************************
+
+#include "../../AssetLoader.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	namespace fs = std::filesystem;
+
+	int g_FailedCount = 0;
+
+	void Check(bool condition, const char* test, const char* what)
+	{
+		if (!condition)
+		{
+			fprintf(stderr, "%s: %s\n", test, what);
+			++g_FailedCount;
+		}
+	}
+
+	// 打开前阻塞等待的线程
+	class Gate
+	{
+	public:
+		void Wait()
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Condition.wait(lock, [this]() { return m_IsOpen; });
+		}
+
+		void Open()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_IsOpen = true;
+			}
+			m_Condition.notify_all();
+		}
+
+	private:
+		std::mutex m_Mutex;
+		std::condition_variable m_Condition;
+		bool m_IsOpen = false;
+	};
+
+	// 临时目录中内容为文件名的小文件
+	class TestFiles
+	{
+	public:
+		TestFiles()
+		{
+			m_Directory = fs::temp_directory_path() /
+				("AssetLoaderTest_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+			std::error_code error;
+			fs::create_directories(m_Directory, error);
+		}
+
+		~TestFiles()
+		{
+			std::error_code error;
+			fs::remove_all(m_Directory, error);
+		}
+
+		std::wstring Add(const std::string& name)
+		{
+			fs::path path = m_Directory / name;
+			std::ofstream fout(path, std::ios::out | std::ios::binary);
+			fout << name;
+			return path.wstring();
+		}
+
+		std::wstring GetMissing() const { return (m_Directory / "missing.bin").wstring(); }
+
+	private:
+		fs::path m_Directory;
+	};
+
+	// 记录解码与上传调用的资源类型，"blocker"类型的解码等待gate打开
+	struct Recorder
+	{
+		std::mutex mutex;
+		std::vector<std::string> decoded;		// 按解码的顺序记录文件内容
+		std::vector<std::string> uploaded;
+		std::thread::id uploadThread;
+		Gate gate;
+		std::atomic<bool> isBlocking{ false };	// 解码线程正在等待gate
+
+		void Register(AssetLoader& loader)
+		{
+			auto decoder = [this](const std::wstring&, const uint8_t* data, size_t size) -> std::shared_ptr<void> {
+				auto pText = std::make_shared<std::string>(reinterpret_cast<const char*>(data), size);
+				std::lock_guard<std::mutex> lock(mutex);
+				decoded.push_back(*pText);
+				return pText;
+			};
+			loader.RegisterType("text", decoder);
+			loader.RegisterType("blocker", [this, decoder](const std::wstring& fileName, const uint8_t* data, size_t size) {
+				isBlocking = true;
+				gate.Wait();
+				return decoder(fileName, data, size);
+			});
+			loader.RegisterType("upload", decoder, [this](const std::wstring&, const std::shared_ptr<void>& decoded) -> std::shared_ptr<void> {
+				auto pText = std::static_pointer_cast<std::string>(decoded);
+				std::lock_guard<std::mutex> lock(mutex);
+				uploaded.push_back(*pText);
+				uploadThread = std::this_thread::get_id();
+				return std::make_shared<std::string>(*pText + " uploaded");
+			});
+		}
+
+		size_t GetDecodedCount(const std::string& text)
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			size_t count = 0;
+			for (const auto& item : decoded)
+				count += item == text;
+			return count;
+		}
+	};
+
+	// 轮询直到状态满足条件，超时返回false
+	template<class Pred>
+	bool WaitUntil(Pred pred)
+	{
+		auto start = std::chrono::steady_clock::now();
+		while (!pred())
+		{
+			if (std::chrono::steady_clock::now() - start > std::chrono::seconds(10))
+				return false;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return true;
+	}
+
+	bool IsDecoding(const AssetLoader::Handle& handle)
+	{
+		return handle.GetState() == AssetLoader::State::Decoding;
+	}
+
+	// 提交阻塞唯一的解码线程的请求，返回时解码线程已在等待
+	AssetLoader::Handle BlockDecoding(AssetLoader& loader, Recorder& recorder, TestFiles& files, const char* test)
+	{
+		AssetLoader::Handle blocker = loader.Load("blocker", files.Add("blocker"));
+		Check(WaitUntil([&]() { return recorder.isBlocking.load(); }), test, "decode thread was not blocked");
+		return blocker;
+	}
+
+	// 唯一的解码线程被阻塞时，已读取的请求在解码队列中按优先级排序
+	void TestPriority(TestFiles& files)
+	{
+		const char* test = "Priority order";
+		Recorder recorder;
+		AssetLoader loader(1);
+		recorder.Register(loader);
+
+		AssetLoader::Handle blocker = BlockDecoding(loader, recorder, files, test);
+		AssetLoader::Handle low = loader.Load("text", files.Add("low"), AssetLoader::kPriorityLow);
+		AssetLoader::Handle high = loader.Load("text", files.Add("high"), AssetLoader::kPriorityHigh);
+		AssetLoader::Handle normal1 = loader.Load("text", files.Add("normal1"), AssetLoader::kPriorityNormal);
+		AssetLoader::Handle normal2 = loader.Load("text", files.Add("normal2"), AssetLoader::kPriorityNormal);
+		// 合并的请求以更高的优先级重新排队
+		AssetLoader::Handle lowRaised = loader.Load("text", files.Add("raised"), AssetLoader::kPriorityLow);
+		Check(WaitUntil([&]() {
+			return IsDecoding(low) && IsDecoding(high) && IsDecoding(normal1) && IsDecoding(normal2) && IsDecoding(lowRaised);
+		}), test, "requests were not read");
+		AssetLoader::Handle raised = loader.Load("text", files.Add("raised"), AssetLoader::kPriorityHigh + 1);
+
+		recorder.gate.Open();
+		for (const auto* pHandle : { &low, &high, &normal1, &normal2, &raised })
+			Check(loader.Wait(*pHandle), test, "request did not become ready");
+		Check(recorder.decoded == std::vector<std::string>({ "blocker", "raised", "high", "normal1", "normal2", "low" }), test,
+			"requests were decoded out of priority order");
+		Check(high.Get<std::string>() && *high.Get<std::string>() == "high", test, "result is wrong");
+		printf("%-28s ok\n", test);
+	}
+
+	// 合并、部分取消与全部取消
+	void TestMergeAndCancel(TestFiles& files)
+	{
+		const char* test = "Merge and cancel";
+		Recorder recorder;
+		AssetLoader loader(1);
+		recorder.Register(loader);
+
+		AssetLoader::Handle blocker = BlockDecoding(loader, recorder, files, test);
+		std::wstring sharedName = files.Add("shared");
+		std::wstring canceledName = files.Add("canceled");
+		AssetLoader::Handle shared1 = loader.Load("text", sharedName);
+		AssetLoader::Handle shared2 = loader.Load("text", sharedName);
+		AssetLoader::Handle canceled1 = loader.Load("text", canceledName);
+		AssetLoader::Handle canceled2 = loader.Load("text", canceledName);
+		// 类型不同的请求不合并
+		AssetLoader::Handle other = loader.Load("upload", sharedName);
+
+		AssetLoader::Statistics stats = loader.GetStatistics();
+		Check(stats.requestCount == 6 && stats.mergedCount == 2, test, "duplicate requests were not merged");
+		Check(loader.GetPendingCount() == 4, test, "pending count is wrong");
+
+		shared1.Cancel();
+		Check(shared2.GetState() != AssetLoader::State::Canceled, test, "canceling one of two handles canceled the request");
+		canceled1.Cancel();
+		canceled2.Cancel();
+		Check(canceled1.GetState() == AssetLoader::State::Canceled && canceled2.GetState() == AssetLoader::State::Canceled, test,
+			"canceling both handles did not cancel the request");
+
+		recorder.gate.Open();
+		Check(loader.Wait(shared2), test, "shared request did not become ready");
+		Check(loader.Wait(other), test, "request of another type did not become ready");
+		Check(!loader.Wait(canceled1), test, "Wait on a canceled request returned true");
+		// "text"与"upload"类型各解码一次
+		Check(recorder.GetDecodedCount("shared") == 2, test, "merged request was decoded more than once");
+		Check(recorder.GetDecodedCount("canceled") == 0, test, "canceled request was decoded");
+		stats = loader.GetStatistics();
+		Check(stats.canceledCount == 1 && loader.GetPendingCount() == 0, test, "counters after completion are wrong");
+		printf("%-28s ok\n", test);
+	}
+
+	// 覆盖或析构未取消的句柄时释放对原请求的需求，剩余的句柄仍可以取消请求
+	void TestHandleRelease(TestFiles& files)
+	{
+		const char* test = "Handle release";
+		Recorder recorder;
+		AssetLoader loader(1);
+		recorder.Register(loader);
+
+		AssetLoader::Handle blocker = BlockDecoding(loader, recorder, files, test);
+		std::wstring overwrittenName = files.Add("overwritten");
+		std::wstring destroyedName = files.Add("destroyed");
+
+		AssetLoader::Handle handle = loader.Load("text", overwrittenName);
+		AssetLoader::Handle remaining = loader.Load("text", overwrittenName);
+		handle = loader.Load("text", files.Add("replacement"));
+		remaining.Cancel();
+		Check(remaining.GetState() == AssetLoader::State::Canceled, test, "overwritten handle still holds the request");
+
+		AssetLoader::Handle survivor = loader.Load("text", destroyedName);
+		{
+			AssetLoader::Handle temporary = loader.Load("text", destroyedName);
+		}
+		survivor.Cancel();
+		Check(survivor.GetState() == AssetLoader::State::Canceled, test, "destroyed handle still holds the request");
+
+		// 移动到另一个句柄不改变引用数
+		AssetLoader::Handle moved = loader.Load("text", destroyedName);
+		AssetLoader::Handle target(std::move(moved));
+		Check(!moved.IsValid() && target.IsValid(), test, "move did not transfer the request");
+		moved.Cancel();
+		Check(target.GetState() != AssetLoader::State::Canceled, test, "canceling a moved-from handle canceled the request");
+
+		recorder.gate.Open();
+		Check(loader.Wait(handle), test, "replacement request did not become ready");
+		Check(loader.Wait(target), test, "moved request did not become ready");
+		Check(recorder.GetDecodedCount("overwritten") == 0, test, "canceled request was decoded");
+		printf("%-28s ok\n", test);
+	}
+
+	// 上传在调用Update或Wait的线程上执行
+	void TestUpload(TestFiles& files)
+	{
+		const char* test = "Upload stage";
+		Recorder recorder;
+		AssetLoader loader(2);
+		recorder.Register(loader);
+
+		AssetLoader::Handle first = loader.Load("upload", files.Add("first"));
+		AssetLoader::Handle second = loader.Load("upload", files.Add("second"));
+		Check(WaitUntil([&]() {
+			return first.GetState() == AssetLoader::State::WaitingForUpload && second.GetState() == AssetLoader::State::WaitingForUpload;
+		}), test, "requests did not wait for upload");
+		Check(first.Get() == nullptr && recorder.uploaded.empty(), test, "upload ran without Update");
+
+		Check(loader.Update(1) == 1, test, "Update(1) did not run one upload");
+		Check(loader.Update() == 1, test, "Update did not run the remaining upload");
+		Check(loader.Update() == 0, test, "Update ran an upload twice");
+		Check(first.IsReady() && second.IsReady(), test, "uploaded requests are not ready");
+		Check(first.Get<std::string>() && *first.Get<std::string>() == "first uploaded", test, "upload result is wrong");
+		Check(recorder.uploadThread == std::this_thread::get_id(), test, "upload ran on another thread");
+
+		// Wait在等待期间执行上传
+		AssetLoader::Handle third = loader.Load("upload", files.Add("third"));
+		Check(loader.Wait(third), test, "Wait did not run the upload");
+		Check(third.Get<std::string>() && *third.Get<std::string>() == "third uploaded", test, "result after Wait is wrong");
+		Check(recorder.uploaded.size() == 3, test, "upload count is wrong");
+		printf("%-28s ok\n", test);
+	}
+
+	void TestFailure(TestFiles& files)
+	{
+		const char* test = "Failures";
+		Recorder recorder;
+		AssetLoader loader(1);
+		recorder.Register(loader);
+
+		AssetLoader::Handle missing = loader.Load("text", files.GetMissing());
+		AssetLoader::Handle unknown = loader.Load("unknown", files.Add("unknown"));
+		Check(unknown.GetState() == AssetLoader::State::Failed, test, "unregistered type did not fail");
+		Check(!loader.Wait(missing) && missing.GetState() == AssetLoader::State::Failed, test, "missing file did not fail");
+		Check(loader.GetStatistics().failedCount == 2, test, "failed count is wrong");
+		printf("%-28s ok\n", test);
+	}
+}
+
+int main()
+{
+	TestFiles files;
+	TestPriority(files);
+	TestMergeAndCancel(files);
+	TestHandleRelease(files);
+	TestUpload(files);
+	TestFailure(files);
+
+	if (g_FailedCount > 0)
+	{
+		fprintf(stderr, "%d checks failed\n", g_FailedCount);
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}
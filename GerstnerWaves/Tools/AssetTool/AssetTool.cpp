@@ -0,0 +1,1819 @@
+﻿//***************************************************************************************
+// AssetTool.cpp
+// Licensed under the MIT License.
+//
+// 资源包命令行工具，与运行时共用AssetPackage的代码
+// 用法(在GerstnerWaves目录下运行，使资源名与程序中引用的路径一致):
+//   AssetTool pack [-store] <输出.pak> <文件或通配符>...   -store表示不压缩
+//   AssetTool list <资源包.pak>
+//   AssetTool bench <文件或通配符>...                      输出压缩率与单核/多核解压速度
+//   AssetTool cook <输出目录> <源目录>...                  增量烘焙(见CookGraph)，输出每个资源的耗时
+//   AssetTool budget <预算KB> <文件或通配符>...            按纹理预算(见TextureBudget)裁剪mip，输出节省的显存
+//   AssetTool stream [-bandwidth <每帧KB>] <文件或通配符>... 沿摄像机路径模拟mip流式加载(见MipStreamer)
+//   AssetTool bc <图像文件或通配符>...                       块压缩编码(见BcEncoder)的各实现速度(百万像素/秒)与PSNR
+//   AssetTool mips <图像文件或通配符>...                     各滤波生成mip链(见MipGenerator)的耗时与Alpha测试覆盖率
+//   AssetTool pixels [百万像素数]                            像素格式转换(见PixelConvert)各实现的吞吐量(GB/s)
+//   AssetTool indices [<.mbo文件或通配符>...]                索引压缩(见IndexCompression)在合成网格与模型(仅Windows)上的
+//                                                            压缩率以及标量与SSSE3解码的吞吐量(GB/s)
+//   AssetTool decode <图像文件或通配符>...                   内置解码器(见ImageReader)的吞吐量，Windows上并与WIC的解码结果比较
+//   AssetTool cube <图像文件或通配符>...                     拆分立方体贴图展开图(见CubeMapLayout)，比较串行与并行烘焙的耗时
+//   AssetTool atlas [-max <边长>] <输出目录> <.mbo文件或通配符>... 把模型引用的小纹理合并为图集(见TextureAtlas，仅Windows)，
+//                                                            输出图集、对照表与改写纹理坐标后的.mbo
+//   AssetTool capture [图像文件]                             截图与录制帧后台编码(见FrameEncoder)各格式的吞吐量(MB/s)，
+//                                                            以及按60帧/秒提交时丢弃的帧数
+//   AssetTool terrain [每边格数]                             各顶点类型生成地形网格(见Geometry::CreateTerrain，仅Windows)的耗时，
+//                                                            比较std::function、内联回调、多线程与按行批量回调
+// 例如:
+//   AssetTool pack Assets.pak HLSL\*.cso ..\Model\ground_35.mbo ..\Model\*.dds ..\Texture\water2.dds
+//   AssetTool cook ..\Cooked ..\Model ..\Texture
+// 模型的导入(ObjReader)与几何体生成依赖DirectXMath与Win32，只在Windows上可用，cook在其他平台上不导入.obj/.glb，
+// 也不把旧版本的.mbo重新烘焙为当前版本
+// 其余命令(包括纹理烘焙)不依赖Windows，图像由ImageReader解码，Windows上其他格式由WIC解码
+// DDS解析的语料测试、模糊测试与吞吐量测试见Tools/DdsTest
+// Command line packer for .pak files, built from the same code as the runtime.
+//***************************************************************************************
+
+#include "../../AssetPackage.h"
+#include "../../BcEncoder.h"
+#include "../../CubeMapLayout.h"
+#include "../../DdsReader.h"
+#include "../../FrameEncoder.h"
+#include "../../ImageReader.h"
+#include "../../IndexCompression.h"
+#include "../../LzCompression.h"
+#include "../../MappedFile.h"
+#include "../../MeshOptimizer.h"
+#include "../../MipGenerator.h"
+#include "../../MipStreamer.h"
+#include "../../PixelConvert.h"
+#include "../../TextureAtlas.h"
+#include "../../TextureBudget.h"
+#include "../../ThreadPool.h"
+#include "CookGraph.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <clocale>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwchar>
+#include <cwctype>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <thread>
+#ifdef _WIN32
+#include "../../Geometry.h"
+#include "../../ObjReader.h"
+#include <wincodec.h>
+#include <wrl/client.h>
+
+#pragma comment(lib, "windowscodecs.lib")
+#endif
+
+namespace
+{
+	void PrintUsage()
+	{
+		wprintf(L"Usage:\n"
+			L"  AssetTool pack [-store] <out.pak> <file or wildcard>...\n"
+			L"  AssetTool list <in.pak>\n"
+			L"  AssetTool bench <file or wildcard>...\n"
+			L"  AssetTool cook <out dir> <source dir>...\n"
+			L"  AssetTool budget <budget KiB> <file or wildcard>...\n"
+			L"  AssetTool stream [-bandwidth <KiB per frame>] <file or wildcard>...\n"
+			L"  AssetTool bc <image file or wildcard>...\n"
+			L"  AssetTool mips <image file or wildcard>...\n"
+			L"  AssetTool pixels [megapixels]\n"
+#ifdef _WIN32
+			L"  AssetTool indices [<.mbo file or wildcard>...]\n"
+#else
+			L"  AssetTool indices\n"
+#endif
+			L"  AssetTool decode <image file or wildcard>...\n"
+			L"  AssetTool cube <image file or wildcard>...\n"
+#ifdef _WIN32
+			L"  AssetTool atlas [-max <texture size>] <out dir> <.mbo file or wildcard>...\n"
+			L"  AssetTool terrain [slices]\n"
+#endif
+			L"  AssetTool capture [image file]\n");
+	}
+
+	// 文件名与带有*、?的通配符比较，与FindFirstFile相同不区分大小写
+	bool MatchWildcard(const wchar_t* name, const wchar_t* pattern)
+	{
+		if (*pattern == L'*')
+		{
+			for (const wchar_t* p = name; ; ++p)
+			{
+				if (MatchWildcard(p, pattern + 1))
+					return true;
+				if (!*p)
+					return false;
+			}
+		}
+		if (!*name)
+			return !*pattern;
+		return (*pattern == L'?' || towlower(*pattern) == towlower(*name)) && MatchWildcard(name + 1, pattern + 1);
+	}
+
+	// 展开文件名部分的通配符，路径保持参数中给出的目录部分，结果按文件名排序
+	std::vector<std::wstring> FindFiles(const wchar_t* pattern)
+	{
+		std::wstring directory = pattern;
+		size_t pos = directory.find_last_of(L"\\/");
+		std::wstring name = pos == std::wstring::npos ? directory : directory.substr(pos + 1);
+		directory = pos == std::wstring::npos ? L"" : directory.substr(0, pos + 1);
+
+		std::vector<std::wstring> fileNames;
+		std::error_code error;
+		for (std::filesystem::directory_iterator it(directory.empty() ? L"." : directory, error), end;
+			!error && it != end; it.increment(error))
+		{
+			std::error_code typeError;
+			std::wstring fileName = it->path().filename().wstring();
+			if (!it->is_directory(typeError) && MatchWildcard(fileName.c_str(), name.c_str()))
+				fileNames.push_back(directory + fileName);
+		}
+		std::sort(fileNames.begin(), fileNames.end());
+
+		return fileNames;
+	}
+
+	int Pack(int argc, wchar_t* argv[])
+	{
+		int arg = 2;
+		AssetPackage::Compression compression = AssetPackage::Compression::LZ;
+		if (wcscmp(argv[arg], L"-store") == 0)
+		{
+			compression = AssetPackage::Compression::None;
+			++arg;
+		}
+		if (arg + 1 >= argc)
+		{
+			PrintUsage();
+			return 1;
+		}
+		const wchar_t* pakFileName = argv[arg++];
+
+		AssetPackageWriter writer;
+		for (; arg < argc; ++arg)
+		{
+			std::vector<std::wstring> fileNames = FindFiles(argv[arg]);
+			if (fileNames.empty())
+				fwprintf(stderr, L"No file matches %ls\n", argv[arg]);
+			for (const auto& fileName : fileNames)
+			{
+				if (writer.AddFile(fileName.c_str(), compression))
+					wprintf(L"  %ls\n", fileName.c_str());
+				else
+					fwprintf(stderr, L"Failed to read %ls\n", fileName.c_str());
+			}
+		}
+
+		if (!writer.Write(pakFileName))
+		{
+			fwprintf(stderr, L"Failed to write %ls\n", pakFileName);
+			return 1;
+		}
+		wprintf(L"%zu entries written to %ls\n", writer.GetEntryCount(), pakFileName);
+		return 0;
+	}
+
+	// 重复解压直到累计耗时超过0.5秒，返回每秒解压的字节数
+	double MeasureDecompress(const std::vector<uint8_t>& data, const std::vector<uint8_t>& compressed, ThreadPool* pool)
+	{
+		std::vector<uint8_t> output(data.size());
+		int iterations = 0;
+		double seconds = 0.0;
+		auto start = std::chrono::high_resolution_clock::now();
+		do
+		{
+			LzCompression::DecompressBlocks(output.data(), output.size(), compressed.data(), compressed.size(), pool);
+			++iterations;
+			seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		} while (seconds < 0.5);
+		return data.size() * static_cast<double>(iterations) / seconds;
+	}
+
+	int Bench(int argc, wchar_t* argv[])
+	{
+		ThreadPool& pool = ThreadPool::GetDefault();
+		size_t threadCount = pool.GetThreadCount() + 1;
+		wprintf(L"%12ls %12ls %7ls %12ls %14ls %12ls  %ls\n", L"raw", L"compressed", L"ratio",
+			L"1 core GB/s", L"parallel GB/s", L"GB/s/core", L"file");
+
+		for (int arg = 2; arg < argc; ++arg)
+		{
+			for (const auto& fileName : FindFiles(argv[arg]))
+			{
+				std::ifstream fin(std::filesystem::path(fileName), std::ios::in | std::ios::binary);
+				std::vector<uint8_t> data((std::istreambuf_iterator<char>(fin)), std::istreambuf_iterator<char>());
+				if (data.empty())
+					continue;
+
+				std::vector<uint8_t> compressed = LzCompression::CompressBlocks(data.data(), data.size(),
+					LzCompression::kDefaultBlockSize, &pool);
+				std::vector<uint8_t> check(data.size());
+				if (!LzCompression::DecompressBlocks(check.data(), check.size(), compressed.data(), compressed.size(), &pool) ||
+					check != data)
+				{
+					fwprintf(stderr, L"Round trip failed for %ls\n", fileName.c_str());
+					return 1;
+				}
+
+				double serialSpeed = MeasureDecompress(data, compressed, nullptr);
+				double parallelSpeed = MeasureDecompress(data, compressed, &pool);
+				wprintf(L"%12zu %12zu %7.3f %12.2f %14.2f %12.2f  %ls\n", data.size(), compressed.size(),
+					static_cast<double>(compressed.size()) / data.size(), serialSpeed / 1e9, parallelSpeed / 1e9,
+					parallelSpeed / threadCount / 1e9, fileName.c_str());
+			}
+		}
+		wprintf(L"%zu threads, %zu KiB blocks\n", threadCount, LzCompression::kDefaultBlockSize / 1024);
+		return 0;
+	}
+
+#ifdef _WIN32
+	// .obj/.glb导入为.mbo，依赖为引用的.mtl与纹理
+	bool CookModel(const std::wstring& source, const std::wstring& output, std::vector<std::wstring>& dependencies)
+	{
+		// 先删除旧的输出，否则Read会直接读取已有的.mbo
+		std::error_code error;
+		std::filesystem::remove(output, error);
+		ObjReader reader;
+		if (!reader.Read(output.c_str(), source.c_str()))
+			return false;
+
+		// 流式烘焙完成后objParts为空，从输出中读取纹理名
+		if (reader.objParts.empty() && !reader.ReadMbo(output.c_str()))
+			return false;
+		dependencies = reader.dependencies;
+		for (const auto& part : reader.objParts)
+		{
+			if (!part.texStrDiffuse.empty())
+				dependencies.push_back(part.texStrDiffuse);
+		}
+		return true;
+	}
+
+	// 用WIC把图像解码为RGBA8
+	bool LoadImageWic(const std::wstring& fileName, uint32_t& width, uint32_t& height, std::vector<uint8_t>& pixels)
+	{
+		using Microsoft::WRL::ComPtr;
+		// 烘焙回调在线程池的线程上执行，每次调用各自初始化COM
+		HRESULT hrInit = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+		bool succeeded = false;
+		{
+			ComPtr<IWICImagingFactory> pFactory;
+			ComPtr<IWICBitmapDecoder> pDecoder;
+			ComPtr<IWICBitmapFrameDecode> pFrame;
+			ComPtr<IWICFormatConverter> pConverter;
+			if (SUCCEEDED(CoCreateInstance(CLSID_WICImagingFactory, nullptr, CLSCTX_INPROC_SERVER, IID_PPV_ARGS(pFactory.GetAddressOf()))) &&
+				SUCCEEDED(pFactory->CreateDecoderFromFilename(fileName.c_str(), nullptr, GENERIC_READ,
+					WICDecodeMetadataCacheOnDemand, pDecoder.GetAddressOf())) &&
+				SUCCEEDED(pDecoder->GetFrame(0, pFrame.GetAddressOf())) &&
+				SUCCEEDED(pFrame->GetSize(&width, &height)) &&
+				SUCCEEDED(pFactory->CreateFormatConverter(pConverter.GetAddressOf())) &&
+				SUCCEEDED(pConverter->Initialize(pFrame.Get(), GUID_WICPixelFormat32bppRGBA, WICBitmapDitherTypeNone,
+					nullptr, 0.0, WICBitmapPaletteTypeCustom)))
+			{
+				pixels.resize(static_cast<size_t>(width) * height * 4);
+				succeeded = SUCCEEDED(pConverter->CopyPixels(nullptr, width * 4, static_cast<UINT>(pixels.size()), pixels.data()));
+			}
+		}
+		if (SUCCEEDED(hrInit))
+			CoUninitialize();
+		return succeeded;
+	}
+#endif
+
+	// TGA、BMP与PNG由ImageReader解码，不需要初始化COM，Windows上其他格式或解码失败时使用WIC
+	bool LoadImageRgba(const std::wstring& fileName, uint32_t& width, uint32_t& height, std::vector<uint8_t>& pixels)
+	{
+		MappedFile file;
+		ImageReader reader;
+		if (file.Open(fileName.c_str()) && reader.Parse(file.GetData(), file.GetSize()))
+		{
+			width = reader.GetWidth();
+			height = reader.GetHeight();
+			pixels.resize(static_cast<size_t>(width) * height * 4);
+			if (reader.Decode(pixels.data(), width * 4))
+				return true;
+		}
+#ifdef _WIN32
+		return LoadImageWic(fileName, width, height, pixels);
+#else
+		return false;
+#endif
+	}
+
+	// 有不透明以外的像素时用BC3，否则用BC1
+	BcEncoder::Format ChooseBcFormat(const std::vector<uint8_t>& pixels)
+	{
+		for (size_t i = 3; i < pixels.size(); i += 4)
+		{
+			if (pixels[i] != 255)
+				return BcEncoder::Format::BC3;
+		}
+		return BcEncoder::Format::BC1;
+	}
+
+	// 名称中带有_nmap或normal的视为法线贴图，按线性数据滤波
+	bool IsNormalMap(const std::wstring& fileName)
+	{
+		std::wstring name = fileName;
+		std::transform(name.begin(), name.end(), name.begin(), ::towlower);
+		return name.find(L"_nmap") != std::wstring::npos || name.find(L"normal") != std::wstring::npos;
+	}
+
+	// Alpha几乎只有0与255时视为Alpha测试的纹理，生成mip时保持覆盖率
+	bool IsAlphaTested(const std::vector<uint8_t>& pixels)
+	{
+		size_t binary = 0, count = pixels.size() / 4;
+		for (size_t i = 3; i < pixels.size(); i += 4)
+			binary += (pixels[i] == 0 || pixels[i] == 255) ? 1 : 0;
+		return binary < count && binary >= count * 95 / 100;
+	}
+
+	MipGenerator::Options GetMipOptions(const std::wstring& fileName, const std::vector<uint8_t>& pixels)
+	{
+		MipGenerator::Options options = MipGenerator::GetDefaultOptions();
+		options.srgb = !IsNormalMap(fileName);
+		options.alphaReference = IsAlphaTested(pixels) ? 0.5f : -1.0f;
+		return options;
+	}
+
+	const char* GetBcFormatName(BcEncoder::Format format)
+	{
+		switch (format)
+		{
+		case BcEncoder::Format::BC1: return "BC1";
+		case BcEncoder::Format::BC3: return "BC3";
+		case BcEncoder::Format::BC4: return "BC4";
+		default: return "BC5";
+		}
+	}
+
+	// 名称中带有cube或sky的图像视为立方体贴图的展开图
+	bool IsCubeMapName(const std::wstring& fileName)
+	{
+		std::wstring name = fileName.substr(fileName.find_last_of(L"\\/") + 1);
+		std::transform(name.begin(), name.end(), name.begin(), ::towlower);
+		return name.find(L"cube") != std::wstring::npos || name.find(L"sky") != std::wstring::npos;
+	}
+
+	// 为6个面生成mip链并块压缩编码，blocks按面优先的子资源顺序存放，即立方体DDS的数据部分
+	// 各面的mip生成与编码都在pool中并行，pool为nullptr时串行处理
+	BcEncoder::Format EncodeCube(const CubeMapLayout::FaceView (&faces)[6], uint32_t faceSize, bool srgb, ThreadPool* pool,
+		std::vector<uint8_t>& blocks, uint32_t& mipCount)
+	{
+		BcEncoder::Format format = BcEncoder::Format::BC1;
+		for (const auto& face : faces)
+		{
+			for (uint32_t y = 0; y < faceSize && format == BcEncoder::Format::BC1; ++y)
+			{
+				const uint8_t* row = face.data + y * face.rowPitch;
+				for (uint32_t x = 0; x < faceSize; ++x)
+				{
+					if (row[x * 4 + 3] != 255)
+					{
+						format = BcEncoder::Format::BC3;
+						break;
+					}
+				}
+			}
+		}
+
+		// 天空盒不做Alpha测试，不需要保持覆盖率
+		MipGenerator::Options options = MipGenerator::GetDefaultOptions();
+		options.srgb = srgb;
+		options.alphaReference = -1.0f;
+		std::vector<std::vector<MipGenerator::Level>> levels;
+		CubeMapLayout::GenerateMips(faces, 6, faceSize, options, levels, 0, pool);
+		mipCount = static_cast<uint32_t>(levels[0].size());
+
+		std::vector<size_t> offsets(6 * mipCount + 1);
+		for (size_t i = 0; i < 6 * mipCount; ++i)
+		{
+			const MipGenerator::Level& level = levels[i / mipCount][i % mipCount];
+			offsets[i + 1] = offsets[i] + BcEncoder::GetEncodedSize(format, level.width, level.height);
+		}
+		blocks.resize(offsets.back());
+		auto encode = [&](size_t face) {
+			for (uint32_t mip = 0; mip < mipCount; ++mip)
+			{
+				const MipGenerator::Level& level = levels[face][mip];
+				BcEncoder::Encode(format, level.data.data(), level.width, level.height, level.width * 4,
+					blocks.data() + offsets[face * mipCount + mip], pool);
+			}
+		};
+		if (pool)
+			pool->ParallelFor(6, encode);
+		else
+		{
+			for (size_t face = 0; face < 6; ++face)
+				encode(face);
+		}
+		return format;
+	}
+
+	// 把6个面烘焙为块压缩的立方体DDS
+	bool CookCube(const CubeMapLayout::FaceView (&faces)[6], uint32_t faceSize, const std::wstring& source,
+		const std::wstring& output, const char* layoutName)
+	{
+		std::vector<uint8_t> blocks;
+		uint32_t mipCount = 0;
+		BcEncoder::Format format = EncodeCube(faces, faceSize, true, &ThreadPool::GetDefault(), blocks, mipCount);
+		wprintf(L"  %ls: %hs cube (%hs) %ux%u, %u mips\n", source.c_str(), GetBcFormatName(format), layoutName,
+			faceSize, faceSize, mipCount);
+
+		DdsReader::Desc desc = { DdsReader::Dimension::Texture2D, BcEncoder::GetDxgiFormat(format), faceSize, faceSize, 1,
+			mipCount, 6, true, format == BcEncoder::Format::BC1 ? DdsReader::AlphaMode::Opaque : DdsReader::AlphaMode::Straight };
+		std::vector<uint8_t> header = DdsReader::CreateHeader(desc);
+		std::ofstream fout(std::filesystem::path(output), std::ios::out | std::ios::binary);
+		fout.write(reinterpret_cast<const char*>(header.data()), header.size());
+		fout.write(reinterpret_cast<const char*>(blocks.data()), blocks.size());
+		return static_cast<bool>(fout);
+	}
+
+	// PNG/JPG等图像生成完整的mip链后编码为块压缩的DDS，运行时不再需要GenerateMips
+	// 名称带有cube或sky且宽高比符合展开图布局的图像烘焙为立方体DDS
+	// 输出第0级相对源图像的PSNR
+	bool CookTexture(const std::wstring& source, const std::wstring& output, std::vector<std::wstring>&)
+	{
+		uint32_t width = 0, height = 0;
+		std::vector<uint8_t> pixels;
+		if (!LoadImageRgba(source, width, height, pixels) || width == 0 || height == 0)
+			return false;
+
+		CubeMapLayout::Layout layout = CubeMapLayout::DetectLayout(width, height);
+		if (layout != CubeMapLayout::Layout::Unknown && IsCubeMapName(source))
+		{
+			CubeMapLayout::FaceView faces[6];
+			uint32_t faceSize = 0;
+			std::vector<uint8_t> scratch;
+			return CubeMapLayout::Split(pixels.data(), width, height, width * 4, layout, faces, faceSize, scratch) &&
+				CookCube(faces, faceSize, source, output, CubeMapLayout::GetLayoutName(layout));
+		}
+
+		// 各输出已经在线程池中并行烘焙，ParallelFor可以嵌套调用，大图像仍能用上空闲的线程
+		ThreadPool& pool = ThreadPool::GetDefault();
+		MipGenerator::Options options = GetMipOptions(source, pixels);
+		std::vector<MipGenerator::Level> levels;
+		MipGenerator::Generate(pixels.data(), width, height, width * 4, options, levels, 0, &pool);
+
+		BcEncoder::Format format = ChooseBcFormat(pixels);
+		std::vector<size_t> offsets(levels.size() + 1);
+		for (size_t i = 0; i < levels.size(); ++i)
+			offsets[i + 1] = offsets[i] + BcEncoder::GetEncodedSize(format, levels[i].width, levels[i].height);
+		std::vector<uint8_t> blocks(offsets.back());
+		for (size_t i = 0; i < levels.size(); ++i)
+		{
+			BcEncoder::Encode(format, levels[i].data.data(), levels[i].width, levels[i].height, levels[i].width * 4,
+				blocks.data() + offsets[i], &pool);
+		}
+
+		std::vector<uint8_t> decoded(pixels.size());
+		BcEncoder::Decode(format, blocks.data(), width, height, decoded.data(), width * 4);
+		double psnr = BcEncoder::ComputePsnr(format, pixels.data(), width * 4, decoded.data(), width * 4, width, height);
+		wprintf(L"  %ls: %hs %ux%u, %zu mips%hs, PSNR %.2f dB\n", source.c_str(), GetBcFormatName(format), width, height,
+			levels.size(), options.alphaReference >= 0.0f ? " (alpha tested)" : "", psnr);
+
+		DdsReader::Desc desc = { DdsReader::Dimension::Texture2D, BcEncoder::GetDxgiFormat(format), width, height, 1,
+			static_cast<uint32_t>(levels.size()), 1, false,
+			format == BcEncoder::Format::BC1 ? DdsReader::AlphaMode::Opaque : DdsReader::AlphaMode::Straight };
+		std::vector<uint8_t> header = DdsReader::CreateHeader(desc);
+		std::ofstream fout(std::filesystem::path(output), std::ios::out | std::ios::binary);
+		fout.write(reinterpret_cast<const char*>(header.data()), header.size());
+		fout.write(reinterpret_cast<const char*>(blocks.data()), blocks.size());
+		return static_cast<bool>(fout);
+	}
+
+	// .cube清单按+X、-X、+Y、-Y、+Z、-Z的顺序每行给出一个面的图像(相对清单所在目录)，烘焙为立方体DDS
+	// 依赖为6个面的图像
+	bool CookCubeManifest(const std::wstring& source, const std::wstring& output, std::vector<std::wstring>& dependencies)
+	{
+		std::wstring directory = source.substr(0, source.find_last_of(L"\\/") + 1);
+		std::ifstream fin(std::filesystem::path(source), std::ios::in);
+		std::string line;
+		while (dependencies.size() < 6 && std::getline(fin, line))
+		{
+			// 跳过空行与#开头的注释行，路径只支持ASCII字符
+			size_t first = line.find_first_not_of(" \t\r");
+			if (first == std::string::npos || line[first] == '#')
+				continue;
+			line = line.substr(first, line.find_last_not_of(" \t\r") + 1 - first);
+			dependencies.push_back(directory + std::wstring(line.begin(), line.end()));
+		}
+		if (dependencies.size() != 6)
+			return false;
+
+		// 6个面各自解码，解码在线程池中并行
+		std::vector<uint8_t> pixels[6];
+		uint32_t widths[6] = {}, heights[6] = {};
+		bool loaded[6] = {};
+		ThreadPool::GetDefault().ParallelFor(6, [&](size_t i) {
+			loaded[i] = LoadImageRgba(dependencies[i], widths[i], heights[i], pixels[i]);
+		});
+
+		CubeMapLayout::FaceView faces[6];
+		for (size_t i = 0; i < 6; ++i)
+		{
+			if (!loaded[i] || widths[i] == 0 || widths[i] != heights[i] || widths[i] != widths[0])
+			{
+				fwprintf(stderr, L"  %ls: face %ls is not a square image of the same size\n", source.c_str(),
+					dependencies[i].c_str());
+				return false;
+			}
+			faces[i] = { pixels[i].data(), widths[i] * 4 };
+		}
+		return CookCube(faces, widths[0], source, output, CubeMapLayout::GetLayoutName(CubeMapLayout::Layout::Faces));
+	}
+
+	// 已经是运行时格式的文件直接复制
+	bool CookCopy(const std::wstring& source, const std::wstring& output, std::vector<std::wstring>&)
+	{
+		std::error_code error;
+		return std::filesystem::copy_file(source, output, std::filesystem::copy_options::overwrite_existing, error);
+	}
+
+#ifdef _WIN32
+	// 当前版本的.mbo直接复制，旧版本的读取时已补全簇与LOD，以当前版本(含压缩的顶点与索引)重新写出
+	bool CookMbo(const std::wstring& source, const std::wstring& output, std::vector<std::wstring>& dependencies)
+	{
+		if (ObjReader::GetMboVersion(source.c_str()) == ObjReader::GetMboVersion())
+			return CookCopy(source, output, dependencies);
+
+		ObjReader reader;
+		return reader.ReadMbo(source.c_str()) && reader.WriteMbo(output.c_str());
+	}
+#endif
+
+	int Cook(int argc, wchar_t* argv[])
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		// 同名的.obj与.mbo都存在时使用先添加的.obj规则，旧版本的.mbo重新烘焙为当前版本
+		// 其他平台上不导入模型，.mbo直接复制
+		CookGraph graph;
+#ifdef _WIN32
+		std::string modelImporter = "ObjReader/mbo" + std::to_string(ObjReader::GetMboVersion());
+		graph.AddRule({ L".obj", L".mbo", modelImporter, CookModel });
+		graph.AddRule({ L".glb", L".mbo", modelImporter, CookModel });
+		graph.AddRule({ L".mbo", L"", modelImporter, CookMbo });
+#endif
+		for (const wchar_t* extension : { L".mbo", L".dds" })
+			graph.AddRule({ extension, L"", "copy/1", CookCopy });
+		// 同名的.png与.dds都存在时使用先添加的.dds复制规则
+		const char* textureImporter = "BcEncoder/1+MipGenerator/1+ImageReader/1+CubeMapLayout/1";
+		for (const wchar_t* extension : { L".png", L".jpg", L".bmp", L".tga" })
+			graph.AddRule({ extension, L".dds", textureImporter, CookTexture });
+		graph.AddRule({ L".cube", L".dds", textureImporter, CookCubeManifest });
+
+		for (int arg = 3; arg < argc; ++arg)
+		{
+			if (graph.AddSourceDirectory(argv[arg]) == 0)
+				fwprintf(stderr, L"No source file in %ls\n", argv[arg]);
+		}
+
+		ThreadPool& pool = ThreadPool::GetDefault();
+		std::vector<CookGraph::Report> reports;
+		bool succeeded = graph.Build(argv[2], pool, reports);
+
+		size_t cookedCount = 0, failedCount = 0;
+		for (const auto& report : reports)
+		{
+			if (report.status == CookGraph::Status::UpToDate)
+				continue;
+			bool failed = report.status == CookGraph::Status::Failed;
+			(failed ? failedCount : cookedCount)++;
+			fwprintf(failed ? stderr : stdout, L"%10.2f ms  %-6ls  %ls  (%ls)\n", report.seconds * 1000.0,
+				failed ? L"failed" : L"cooked", report.output.c_str(), report.reason.c_str());
+		}
+
+		double seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		wprintf(L"%zu outputs: %zu cooked, %zu up to date, %zu failed in %.2f ms (%zu threads)\n",
+			reports.size(), cookedCount, reports.size() - cookedCount - failedCount, failedCount,
+			seconds * 1000.0, pool.GetThreadCount() + 1);
+		return succeeded ? 0 : 1;
+	}
+
+	int Budget(int argc, wchar_t* argv[])
+	{
+		TextureBudget budget(static_cast<size_t>(wcstoll(argv[2], nullptr, 10)) * 1024);
+
+		// 按加载顺序登记，先登记的纹理可能需要在之后的Rebalance中降级
+		std::vector<std::wstring> fileNames;
+		for (int arg = 3; arg < argc; ++arg)
+		{
+			for (const auto& fileName : FindFiles(argv[arg]))
+			{
+				MappedFile file;
+				DdsReader reader;
+				if (!file.Open(fileName.c_str()) || !reader.Parse(file.GetData(), file.GetSize()))
+				{
+					fwprintf(stderr, L"%ls: %hs\n", fileName.c_str(), file.IsOpen() ? reader.GetError() : "cannot open");
+					continue;
+				}
+				uint32_t skip = budget.Register(fileName, reader);
+				wprintf(L"%10zu -> %10zu bytes  skip %u/%u  %ux%u  %ls\n", TextureBudget::GetResidentBytes(reader, 0),
+					TextureBudget::GetResidentBytes(reader, skip), skip, reader.GetMipCount(),
+					(std::max)(reader.GetWidth() >> skip, 1u), (std::max)(reader.GetHeight() >> skip, 1u), fileName.c_str());
+				fileNames.push_back(fileName);
+			}
+		}
+
+		for (const auto& request : budget.Rebalance())
+		{
+			wprintf(L"%-9ls skip %u -> %u  %hs\n", request.targetSkip > request.residentSkip ? L"downgrade" : L"upgrade",
+				request.residentSkip, request.targetSkip, request.name.c_str());
+			budget.SetResident(std::wstring(request.name.begin(), request.name.end()), request.targetSkip);
+		}
+
+		TextureBudget::Statistics stats = budget.GetStatistics();
+		wprintf(L"%zu textures: %zu -> %zu bytes (saved %zu bytes, %.1f%%, %llu mips skipped), budget %zu bytes\n",
+			stats.textureCount, stats.fullBytes, stats.residentBytes, stats.fullBytes - stats.residentBytes,
+			stats.fullBytes ? 100.0 * (stats.fullBytes - stats.residentBytes) / stats.fullBytes : 0.0,
+			stats.trimmedMipCount, stats.budget);
+		return 0;
+	}
+
+	// 无窗口的流式加载模拟: 每个纹理贴在一个物体上，物体沿x轴排开，
+	// 摄像机从远处飞近，贴近物体掠过后再飞远，每帧按距离设置期望的mip并以固定的带宽上传
+	int Stream(int argc, wchar_t* argv[])
+	{
+		int arg = 2;
+		size_t bandwidth = 256 * 1024;
+		if (arg + 1 < argc && wcscmp(argv[arg], L"-bandwidth") == 0)
+		{
+			bandwidth = static_cast<size_t>(wcstoll(argv[arg + 1], nullptr, 10)) * 1024;
+			arg += 2;
+		}
+
+		std::vector<std::unique_ptr<MappedFile>> files;
+		std::vector<MipStreamer::TextureId> ids;
+		MipStreamer streamer;
+		for (; arg < argc; ++arg)
+		{
+			for (const auto& fileName : FindFiles(argv[arg]))
+			{
+				std::unique_ptr<MappedFile> pFile(new MappedFile);
+				DdsReader reader;
+				if (!pFile->Open(fileName.c_str()) || !reader.Parse(pFile->GetData(), pFile->GetSize()))
+					continue;
+				ids.push_back(streamer.Add(reader));
+				files.push_back(std::move(pFile));
+			}
+		}
+		if (ids.empty())
+		{
+			fwprintf(stderr, L"No DDS file\n");
+			return 1;
+		}
+
+		// 物体边长16，纹理重复一次，间隔40
+		const float kObjectSize = 16.0f, kSpacing = 40.0f;
+		const float kFovY = 3.14159265f / 3.0f, kViewportHeight = 1080.0f;
+		const int kFrameRate = 60;
+		float lastX = (ids.size() - 1) * kSpacing;
+		struct Key { float time, x, y, z; };
+		const Key keys[] = {
+			{ 0.0f, lastX * 0.5f, 300.0f, -300.0f },
+			{ 4.0f, 0.0f, 6.0f, -12.0f },
+			{ 4.0f + ids.size() * 1.0f, lastX, 6.0f, -12.0f },
+			{ 8.0f + ids.size() * 1.0f, lastX * 0.5f, 300.0f, -300.0f },
+			{ 10.0f + ids.size() * 1.0f, lastX * 0.5f, 300.0f, -300.0f },
+		};
+		const size_t keyCount = sizeof(keys) / sizeof(keys[0]);
+		int frameCount = static_cast<int>(keys[keyCount - 1].time * kFrameRate);
+
+		// 期望的mip低于驻留的mip时开始计时，满足时记录等待的帧数
+		std::vector<int> waitStart(ids.size(), -1);
+		std::vector<int> waits;
+		int deficitFrames = 0;
+		for (int frame = 0; frame < frameCount; ++frame)
+		{
+			float time = static_cast<float>(frame) / kFrameRate;
+			size_t k = 1;
+			while (k + 1 < keyCount && keys[k].time <= time)
+				++k;
+			float t = keys[k].time > keys[k - 1].time ? (time - keys[k - 1].time) / (keys[k].time - keys[k - 1].time) : 1.0f;
+			t = (std::min)((std::max)(t, 0.0f), 1.0f);
+			float camX = keys[k - 1].x + (keys[k].x - keys[k - 1].x) * t;
+			float camY = keys[k - 1].y + (keys[k].y - keys[k - 1].y) * t;
+			float camZ = keys[k - 1].z + (keys[k].z - keys[k - 1].z) * t;
+
+			for (size_t i = 0; i < ids.size(); ++i)
+			{
+				const DdsReader& reader = streamer.GetReader(ids[i]);
+				float dx = camX - i * kSpacing;
+				float distance = (std::max)(std::sqrt(dx * dx + camY * camY + camZ * camZ) - kObjectSize * 0.5f, 0.1f);
+				float mip = MipStreamer::ComputeDesiredMip((std::max)(reader.GetWidth(), reader.GetHeight()),
+					kObjectSize, distance, kFovY, kViewportHeight);
+				streamer.SetDesiredMip(ids[i], static_cast<uint32_t>((std::max)(mip, 0.0f)));
+			}
+
+			streamer.Update(bandwidth, nullptr, nullptr);
+
+			bool deficit = false;
+			for (size_t i = 0; i < ids.size(); ++i)
+			{
+				bool satisfied = streamer.GetResidentMip(ids[i]) <= streamer.GetDesiredMip(ids[i]);
+				if (!satisfied && waitStart[i] < 0)
+					waitStart[i] = frame;
+				else if (satisfied && waitStart[i] >= 0)
+				{
+					waits.push_back(frame - waitStart[i]);
+					waitStart[i] = -1;
+				}
+				deficit |= !satisfied;
+			}
+			deficitFrames += deficit ? 1 : 0;
+		}
+
+		MipStreamer::Statistics stats = streamer.GetStatistics();
+		int maxWait = 0;
+		double totalWait = 0.0;
+		for (int wait : waits)
+		{
+			maxWait = (std::max)(maxWait, wait);
+			totalWait += wait;
+		}
+		wprintf(L"%zu textures, %.1f s path at %d fps, %zu KiB per frame\n", ids.size(),
+			static_cast<float>(frameCount) / kFrameRate, kFrameRate, bandwidth / 1024);
+		wprintf(L"full chains:   %zu bytes (loaded up front without streaming)\n", stats.fullBytes);
+		wprintf(L"startup tail:  %zu bytes\n", stats.tailBytes);
+		wprintf(L"streamed:      %llu bytes, evicted %llu bytes\n", stats.streamedBytes, stats.evictedBytes);
+		wprintf(L"peak resident: %zu bytes, final %zu bytes\n", stats.peakResidentBytes, stats.residentBytes);
+		wprintf(L"time to full quality: %zu requests, avg %.1f ms, max %.1f ms, %d frames below desired\n",
+			waits.size(), waits.empty() ? 0.0 : totalWait / waits.size() * 1000.0 / kFrameRate,
+			maxWait * 1000.0 / kFrameRate, deficitFrames);
+		return 0;
+	}
+
+	// 重复编码直到累计耗时超过0.5秒，返回每秒编码的像素数
+	double MeasureEncode(BcEncoder::Format format, const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height,
+		ThreadPool* pool, BcEncoder::Simd simd)
+	{
+		std::vector<uint8_t> blocks(BcEncoder::GetEncodedSize(format, width, height));
+		int iterations = 0;
+		double seconds = 0.0;
+		auto start = std::chrono::high_resolution_clock::now();
+		do
+		{
+			BcEncoder::Encode(format, pixels.data(), width, height, width * 4, blocks.data(), pool, simd);
+			++iterations;
+			seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		} while (seconds < 0.5);
+		return static_cast<double>(width) * height * iterations / seconds;
+	}
+
+	int Bc(int argc, wchar_t* argv[])
+	{
+		ThreadPool& pool = ThreadPool::GetDefault();
+		BcEncoder::Simd best = BcEncoder::GetBestSimd();
+		wprintf(L"%-6ls %10ls %10ls %10ls %14ls %10ls  %ls\n", L"format", L"scalar", L"SSE2", L"AVX2",
+			L"parallel MP/s", L"PSNR dB", L"file");
+
+		for (int arg = 2; arg < argc; ++arg)
+		{
+			for (const auto& fileName : FindFiles(argv[arg]))
+			{
+				uint32_t width = 0, height = 0;
+				std::vector<uint8_t> pixels;
+				if (!LoadImageRgba(fileName, width, height, pixels) || width == 0 || height == 0)
+				{
+					fwprintf(stderr, L"Failed to decode %ls\n", fileName.c_str());
+					continue;
+				}
+
+				for (BcEncoder::Format format : { BcEncoder::Format::BC1, BcEncoder::Format::BC3,
+					BcEncoder::Format::BC4, BcEncoder::Format::BC5 })
+				{
+					// 各实现的输出应当逐字节相同
+					std::vector<uint8_t> blocks(BcEncoder::GetEncodedSize(format, width, height));
+					BcEncoder::Encode(format, pixels.data(), width, height, width * 4, blocks.data(), nullptr, BcEncoder::Simd::Scalar);
+					for (BcEncoder::Simd simd : { BcEncoder::Simd::SSE2, BcEncoder::Simd::AVX2 })
+					{
+						if (static_cast<int>(simd) > static_cast<int>(best))
+							continue;
+						std::vector<uint8_t> check(blocks.size());
+						BcEncoder::Encode(format, pixels.data(), width, height, width * 4, check.data(), &pool, simd);
+						if (check != blocks)
+						{
+							fwprintf(stderr, L"%hs output of %hs differs from scalar for %ls\n", BcEncoder::GetSimdName(simd),
+								GetBcFormatName(format), fileName.c_str());
+							return 1;
+						}
+					}
+
+					std::vector<uint8_t> decoded(pixels.size());
+					BcEncoder::Decode(format, blocks.data(), width, height, decoded.data(), width * 4);
+					double psnr = BcEncoder::ComputePsnr(format, pixels.data(), width * 4, decoded.data(), width * 4, width, height);
+
+					double speeds[3] = {};
+					for (int simd = 0; simd < 3; ++simd)
+					{
+						if (simd <= static_cast<int>(best))
+							speeds[simd] = MeasureEncode(format, pixels, width, height, nullptr, static_cast<BcEncoder::Simd>(simd));
+					}
+					double parallelSpeed = MeasureEncode(format, pixels, width, height, &pool, best);
+					wprintf(L"%-6hs %10.1f %10.1f %10.1f %14.1f %10.2f  %ls\n", GetBcFormatName(format), speeds[0] / 1e6,
+						speeds[1] / 1e6, speeds[2] / 1e6, parallelSpeed / 1e6, psnr, fileName.c_str());
+				}
+			}
+		}
+		wprintf(L"%zu threads, best %hs, 0 = not supported by this CPU\n", pool.GetThreadCount() + 1,
+			BcEncoder::GetSimdName(best));
+		return 0;
+	}
+
+	// 重复生成mip链直到累计耗时超过0.5秒，返回每条链的毫秒数
+	double MeasureMips(const std::vector<uint8_t>& pixels, uint32_t width, uint32_t height,
+		const MipGenerator::Options& options, ThreadPool* pool, bool allowSimd)
+	{
+		std::vector<MipGenerator::Level> levels;
+		int iterations = 0;
+		double seconds = 0.0;
+		auto start = std::chrono::high_resolution_clock::now();
+		do
+		{
+			MipGenerator::Generate(pixels.data(), width, height, width * 4, options, levels, 0, pool, allowSimd);
+			++iterations;
+			seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		} while (seconds < 0.5);
+		return seconds * 1000.0 / iterations;
+	}
+
+	int Mips(int argc, wchar_t* argv[])
+	{
+		ThreadPool& pool = ThreadPool::GetDefault();
+		const char* filterNames[] = { "box", "kaiser", "lanczos" };
+		wprintf(L"%-8ls %10ls %10ls %12ls %20ls  %ls\n", L"filter", L"scalar ms", L"SSE2 ms", L"parallel ms",
+			L"coverage 0/1/last", L"file");
+
+		for (int arg = 2; arg < argc; ++arg)
+		{
+			for (const auto& fileName : FindFiles(argv[arg]))
+			{
+				uint32_t width = 0, height = 0;
+				std::vector<uint8_t> pixels;
+				if (!LoadImageRgba(fileName, width, height, pixels) || width == 0 || height == 0)
+				{
+					fwprintf(stderr, L"Failed to decode %ls\n", fileName.c_str());
+					continue;
+				}
+
+				for (int filter = 0; filter < 3; ++filter)
+				{
+					MipGenerator::Options options = GetMipOptions(fileName, pixels);
+					options.filter = static_cast<MipGenerator::Filter>(filter);
+
+					// SSE2与标量实现的输出应当逐字节相同
+					std::vector<MipGenerator::Level> levels, check;
+					MipGenerator::Generate(pixels.data(), width, height, width * 4, options, levels, 0, nullptr, false);
+					MipGenerator::Generate(pixels.data(), width, height, width * 4, options, check, 0, &pool, true);
+					for (size_t i = 0; i < levels.size(); ++i)
+					{
+						if (levels[i].data != check[i].data)
+						{
+							fwprintf(stderr, L"SIMD mip %zu differs from scalar for %ls\n", i, fileName.c_str());
+							return 1;
+						}
+					}
+
+					// 覆盖率按第0级的参考值统计，没有Alpha测试时按0.5
+					float reference = options.alphaReference >= 0.0f ? options.alphaReference : 0.5f;
+					float coverage[3] = {};
+					size_t coverageLevels[3] = { 0, (std::min)(static_cast<size_t>(1), levels.size() - 1), levels.size() - 1 };
+					for (int i = 0; i < 3; ++i)
+					{
+						const MipGenerator::Level& level = levels[coverageLevels[i]];
+						coverage[i] = MipGenerator::ComputeCoverage(level.data.data(), level.width, level.height, level.width * 4, reference);
+					}
+
+					double scalarMs = MeasureMips(pixels, width, height, options, nullptr, false);
+					double simdMs = MeasureMips(pixels, width, height, options, nullptr, true);
+					double parallelMs = MeasureMips(pixels, width, height, options, &pool, true);
+					wprintf(L"%-8hs %10.2f %10.2f %12.2f %8.3f/%.3f/%.3f  %ls\n", filterNames[filter], scalarMs, simdMs,
+						parallelMs, coverage[0], coverage[1], coverage[2], fileName.c_str());
+				}
+			}
+		}
+		wprintf(L"%zu threads\n", pool.GetThreadCount() + 1);
+		return 0;
+	}
+
+	int Pixels(int argc, wchar_t* argv[])
+	{
+		double megapixels = argc >= 3 ? wcstod(argv[2], nullptr) : 4.0;
+		size_t count = megapixels > 0.0 ? static_cast<size_t>(megapixels * 1024 * 1024) : 0;
+		if (count == 0)
+		{
+			fwprintf(stderr, L"Invalid pixel count\n");
+			return 1;
+		}
+
+		// 随机的源数据，浮点为-0.1~1.1以覆盖限制到0~1的情况
+		std::mt19937 rng(1);
+		std::vector<uint8_t> bytes(count * 4);
+		std::vector<uint16_t> words(count);
+		std::vector<float> floats(count * 4);
+		std::uniform_real_distribution<float> distribution(-0.1f, 1.1f);
+		for (auto& value : bytes)
+			value = static_cast<uint8_t>(rng());
+		for (auto& value : words)
+			value = static_cast<uint16_t>(rng());
+		for (auto& value : floats)
+			value = distribution(rng);
+		std::vector<uint8_t> byteOutput(count * 4);
+		std::vector<float> floatOutput(count * 4);
+
+		struct Kernel
+		{
+			const char* name;
+			size_t bytesPerPixel;		// 读写的字节数之和
+			std::function<void(PixelConvert::Simd)> run;
+		};
+		const Kernel kernels[] = {
+			{ "RGB8->RGBA8", 7, [&](PixelConvert::Simd simd) { PixelConvert::RgbToRgba(bytes.data(), byteOutput.data(), count, false, simd); } },
+			{ "BGR8->RGBA8", 7, [&](PixelConvert::Simd simd) { PixelConvert::RgbToRgba(bytes.data(), byteOutput.data(), count, true, simd); } },
+			{ "BGRA<->RGBA", 8, [&](PixelConvert::Simd simd) { PixelConvert::SwapRedBlue(bytes.data(), byteOutput.data(), count, simd); } },
+			{ "premultiply", 8, [&](PixelConvert::Simd simd) { PixelConvert::PremultiplyAlpha(bytes.data(), byteOutput.data(), count, simd); } },
+			{ "R16->R8", 3, [&](PixelConvert::Simd simd) { PixelConvert::R16ToR8(words.data(), byteOutput.data(), count, simd); } },
+			{ "sRGB->linear", 20, [&](PixelConvert::Simd simd) { PixelConvert::UnpackRgba(bytes.data(), floatOutput.data(), count, true, simd); } },
+			{ "unorm->float", 20, [&](PixelConvert::Simd simd) { PixelConvert::UnpackRgba(bytes.data(), floatOutput.data(), count, false, simd); } },
+			{ "linear->sRGB", 20, [&](PixelConvert::Simd simd) { PixelConvert::PackRgba(floats.data(), byteOutput.data(), count, true, 1.0f, simd); } },
+			{ "float->unorm", 20, [&](PixelConvert::Simd simd) { PixelConvert::PackRgba(floats.data(), byteOutput.data(), count, false, 1.0f, simd); } }
+		};
+
+		PixelConvert::Simd best = PixelConvert::GetBestSimd();
+		wprintf(L"%-14ls %10ls %10ls %10ls\n", L"kernel", L"scalar", L"SSSE3", L"AVX2");
+		for (const Kernel& kernel : kernels)
+		{
+			// 各实现的输出应当逐字节相同
+			kernel.run(PixelConvert::Simd::Scalar);
+			std::vector<uint8_t> expectedBytes = byteOutput;
+			std::vector<float> expectedFloats = floatOutput;
+			double speeds[3] = {};
+			for (int simd = 0; simd < 3; ++simd)
+			{
+				if (simd > static_cast<int>(best))
+					continue;
+				std::fill(byteOutput.begin(), byteOutput.end(), static_cast<uint8_t>(0));
+				std::fill(floatOutput.begin(), floatOutput.end(), 0.0f);
+				kernel.run(static_cast<PixelConvert::Simd>(simd));
+				if (byteOutput != expectedBytes ||
+					memcmp(floatOutput.data(), expectedFloats.data(), floatOutput.size() * sizeof(float)) != 0)
+				{
+					fwprintf(stderr, L"%hs output of %hs differs from scalar\n",
+						PixelConvert::GetSimdName(static_cast<PixelConvert::Simd>(simd)), kernel.name);
+					return 1;
+				}
+
+				// 重复转换直到累计耗时超过0.5秒
+				int iterations = 0;
+				double seconds = 0.0;
+				auto start = std::chrono::high_resolution_clock::now();
+				do
+				{
+					kernel.run(static_cast<PixelConvert::Simd>(simd));
+					++iterations;
+					seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+				} while (seconds < 0.5);
+				speeds[simd] = static_cast<double>(count) * kernel.bytesPerPixel * iterations / seconds;
+			}
+			wprintf(L"%-14hs %10.2f %10.2f %10.2f\n", kernel.name, speeds[0] / 1e9, speeds[1] / 1e9, speeds[2] / 1e9);
+		}
+		wprintf(L"%zu pixels, GB/s of bytes read and written, 0 = not supported by this CPU\n", count);
+		return 0;
+	}
+
+	// 一组用于测量索引压缩的索引，is16表示以16位存储
+	struct IndexSample
+	{
+		std::wstring name;
+		std::vector<uint32_t> indices;
+		bool is16;
+	};
+
+	// width * height个四边形的网格，按行排列
+	std::vector<uint32_t> MakeGridIndices(uint32_t width, uint32_t height)
+	{
+		std::vector<uint32_t> indices;
+		indices.reserve(static_cast<size_t>(width) * height * 6);
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				uint32_t i0 = y * (width + 1) + x, i1 = i0 + 1, i2 = i0 + width + 1, i3 = i2 + 1;
+				indices.insert(indices.end(), { i0, i2, i1, i1, i2, i3 });
+			}
+		}
+		return indices;
+	}
+
+	// 重复解码直到累计耗时超过0.25秒，返回输出的GB/s
+	template<class IndexType>
+	double MeasureIndexDecode(const std::vector<uint8_t>& encoded, size_t indexCount, bool simd)
+	{
+		std::vector<IndexType> output(indexCount);
+		int iterations = 0;
+		double seconds = 0.0;
+		auto start = std::chrono::high_resolution_clock::now();
+		do
+		{
+			if (simd)
+				IndexCompression::Decode(output.data(), indexCount, encoded.data(), encoded.size());
+			else
+				IndexCompression::DecodeScalar(output.data(), indexCount, encoded.data(), encoded.size());
+			++iterations;
+			seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		} while (seconds < 0.25);
+		return static_cast<double>(indexCount) * sizeof(IndexType) * iterations / seconds / 1e9;
+	}
+
+	// 解码后与原索引比较
+	template<class IndexType>
+	bool CheckIndexDecode(const std::vector<uint8_t>& encoded, const std::vector<uint32_t>& indices, bool simd)
+	{
+		std::vector<IndexType> output(indices.size());
+		bool status = simd ? IndexCompression::Decode(output.data(), output.size(), encoded.data(), encoded.size()) :
+			IndexCompression::DecodeScalar(output.data(), output.size(), encoded.data(), encoded.size());
+		return status && std::equal(output.begin(), output.end(), indices.begin(),
+			[](IndexType a, uint32_t b) { return a == static_cast<IndexType>(b); });
+	}
+
+	int Indices(int argc, wchar_t* argv[])
+	{
+		std::vector<IndexSample> samples;
+
+		// 合成的网格: 按行排列、顶点缓存优化并按首次使用重排顶点、三角形顺序随机打乱，以及完全随机的索引
+		std::vector<uint32_t> grid = MakeGridIndices(255, 255);
+		samples.push_back({ L"grid 255x255", grid, true });
+		std::vector<uint32_t> optimized(grid.size());
+		MeshOptimizer::OptimizeVertexCache(optimized.data(), grid.data(), grid.size(), 256 * 256);
+		std::vector<uint32_t> remap(256 * 256);
+		MeshOptimizer::OptimizeVertexFetchRemap(remap.data(), optimized.data(), optimized.size(), remap.size());
+		for (auto& index : optimized)
+			index = remap[index];
+		samples.push_back({ L"grid optimized", std::move(optimized), true });
+
+		std::mt19937 rng(30);
+		std::vector<uint32_t> shuffled = grid;
+		for (size_t i = shuffled.size() / 3; i > 1; --i)
+		{
+			size_t j = rng() % i;
+			std::swap_ranges(shuffled.begin() + (i - 1) * 3, shuffled.begin() + i * 3, shuffled.begin() + j * 3);
+		}
+		samples.push_back({ L"grid shuffled", std::move(shuffled), true });
+		std::vector<uint32_t> random(grid.size());
+		for (auto& index : random)
+			index = static_cast<uint32_t>(rng() % (256 * 256));
+		samples.push_back({ L"random", std::move(random), true });
+		samples.push_back({ L"grid 1000x1000", MakeGridIndices(1000, 1000), false });
+
+#ifdef _WIN32
+		// 模型中每个Part的原始网格
+		for (int arg = 2; arg < argc; ++arg)
+		{
+			for (const auto& fileName : FindFiles(argv[arg]))
+			{
+				ObjReader reader;
+				if (!reader.ReadMbo(fileName.c_str()))
+				{
+					fwprintf(stderr, L"Failed to read %ls\n", fileName.c_str());
+					continue;
+				}
+				for (size_t p = 0; p < reader.objParts.size(); ++p)
+				{
+					const auto& part = reader.objParts[p];
+					IndexSample sample = { fileName + L"#" + std::to_wstring(p), {}, part.indices32.empty() };
+					if (sample.is16)
+						sample.indices.assign(part.indices16.begin(), part.indices16.end());
+					else
+						sample.indices.assign(part.indices32.begin(), part.indices32.end());
+					if (!sample.indices.empty())
+						samples.push_back(std::move(sample));
+				}
+			}
+		}
+#else
+		(void)argv;
+		if (argc > 2)
+			fwprintf(stderr, L"Reading .mbo files requires ObjReader, which is only available on Windows\n");
+#endif
+
+		wprintf(L"%-16ls %9ls %4ls %10ls %10ls %7ls %8ls %11ls %11ls\n", L"indices", L"count", L"bits", L"raw bytes",
+			L"encoded", L"ratio", L"B/index", L"scalar GB/s", L"SIMD GB/s");
+		for (const auto& sample : samples)
+		{
+			const auto& indices = sample.indices;
+			std::vector<uint8_t> encoded(IndexCompression::GetEncodeBound(indices.size()));
+			encoded.resize(IndexCompression::Encode(encoded.data(), encoded.size(), indices.data(), indices.size()));
+
+			// 两种解码路径的输出都应与原索引完全相同
+			bool matches = sample.is16 ?
+				CheckIndexDecode<uint16_t>(encoded, indices, true) && CheckIndexDecode<uint16_t>(encoded, indices, false) :
+				CheckIndexDecode<uint32_t>(encoded, indices, true) && CheckIndexDecode<uint32_t>(encoded, indices, false);
+			if (encoded.empty() || !matches)
+			{
+				fwprintf(stderr, L"Index round trip failed for %ls\n", sample.name.c_str());
+				return 1;
+			}
+
+			size_t rawSize = indices.size() * (sample.is16 ? sizeof(uint16_t) : sizeof(uint32_t));
+			double scalarSpeed = sample.is16 ? MeasureIndexDecode<uint16_t>(encoded, indices.size(), false) :
+				MeasureIndexDecode<uint32_t>(encoded, indices.size(), false);
+			double simdSpeed = sample.is16 ? MeasureIndexDecode<uint16_t>(encoded, indices.size(), true) :
+				MeasureIndexDecode<uint32_t>(encoded, indices.size(), true);
+			wprintf(L"%-16ls %9zu %4d %10zu %10zu %6.1f%% %8.2f %11.2f %11.2f\n", sample.name.c_str(), indices.size(),
+				sample.is16 ? 16 : 32, rawSize, encoded.size(), 100.0 * encoded.size() / rawSize,
+				static_cast<double>(encoded.size()) / indices.size(), scalarSpeed, simdSpeed);
+		}
+		wprintf(L"ratio is relative to the raw index buffer, GB/s of decoded indices written, "
+			L"SIMD falls back to scalar without SSSE3\n");
+		return 0;
+	}
+
+	int List(const wchar_t* pakFileName)
+	{
+		AssetPackage package;
+		if (!package.Open(pakFileName))
+		{
+			fwprintf(stderr, L"Failed to open %ls\n", pakFileName);
+			return 1;
+		}
+
+		uint64_t totalSize = 0, totalStoredSize = 0;
+		for (size_t i = 0; i < package.GetEntryCount(); ++i)
+		{
+			AssetPackage::EntryInfo info = package.GetEntryInfo(i);
+			wprintf(L"%12llu %12llu %4ls  %hs\n", info.size, info.storedSize,
+				info.compression == AssetPackage::Compression::LZ ? L"lz" : L"-", info.name.c_str());
+			totalSize += info.size;
+			totalStoredSize += info.storedSize;
+		}
+		wprintf(L"%zu entries, %llu bytes (%llu stored)\n", package.GetEntryCount(), totalSize, totalStoredSize);
+		return 0;
+	}
+
+	int Decode(int argc, wchar_t* argv[])
+	{
+		const char* formatNames[] = { "?", "TGA", "BMP", "PNG" };
+		wprintf(L"%-6ls %11ls %9ls %9ls %9ls %9ls %8ls  %ls\n", L"format", L"size", L"ms", L"MB/s", L"MP/s",
+			L"WIC ms", L"max diff", L"file");
+
+		for (int arg = 2; arg < argc; ++arg)
+		{
+			for (const auto& fileName : FindFiles(argv[arg]))
+			{
+				MappedFile file;
+				ImageReader reader;
+				if (!file.Open(fileName.c_str()) || !reader.Parse(file.GetData(), file.GetSize()))
+				{
+					fwprintf(stderr, L"%ls: %hs\n", fileName.c_str(), file.IsOpen() ? reader.GetError() : "cannot open");
+					continue;
+				}
+
+				// 解码到预先分配的缓冲区，计时不包括分配
+				uint32_t width = reader.GetWidth(), height = reader.GetHeight();
+				std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+				bool decoded = true;
+				int iterations = 0;
+				double seconds = 0.0;
+				auto start = std::chrono::high_resolution_clock::now();
+				do
+				{
+					decoded = reader.Decode(pixels.data(), width * 4);
+					++iterations;
+					seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+				} while (decoded && seconds < 0.5);
+				if (!decoded)
+				{
+					fwprintf(stderr, L"%ls: %hs\n", fileName.c_str(), reader.GetError());
+					continue;
+				}
+				seconds /= iterations;
+
+				// WIC的结果作为参考，低位深的通道扩展与16位转8位的取整可能相差1
+				// 没有WIC的平台或WIC解码失败时差值输出-1
+				double wicSeconds = 0.0;
+				int maxDifference = -1;
+#ifdef _WIN32
+				uint32_t wicWidth = 0, wicHeight = 0;
+				std::vector<uint8_t> wicPixels;
+				start = std::chrono::high_resolution_clock::now();
+				bool wicDecoded = LoadImageWic(fileName, wicWidth, wicHeight, wicPixels);
+				wicSeconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+				if (wicDecoded && wicWidth == width && wicHeight == height)
+				{
+					maxDifference = 0;
+					for (size_t i = 0; i < pixels.size(); ++i)
+						maxDifference = (std::max)(maxDifference, std::abs(pixels[i] - wicPixels[i]));
+				}
+#endif
+
+				wprintf(L"%-6hs %5ux%-5u %9.2f %9.1f %9.1f %9.2f %8d  %ls\n", formatNames[static_cast<int>(reader.GetFormat())],
+					width, height, seconds * 1000.0, file.GetSize() / seconds / 1e6, width * static_cast<double>(height) / seconds / 1e6,
+					wicSeconds * 1000.0, maxDifference, fileName.c_str());
+			}
+		}
+		return 0;
+	}
+
+	// 对fn重复计时直到累计超过0.5秒，返回单次的毫秒数
+	double MeasureMilliseconds(const std::function<void()>& fn)
+	{
+		int iterations = 0;
+		double seconds = 0.0;
+		auto start = std::chrono::high_resolution_clock::now();
+		do
+		{
+			fn();
+			++iterations;
+			seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		} while (seconds < 0.5);
+		return seconds * 1000.0 / iterations;
+	}
+
+	int Cube(int argc, wchar_t* argv[])
+	{
+		ThreadPool& pool = ThreadPool::GetDefault();
+		wprintf(L"%-17hs %6ls %9ls %9ls %11ls %13ls %8ls  %ls\n", "layout", L"face", L"split ms", L"copy ms",
+			L"serial ms", L"parallel ms", L"speedup", L"file");
+
+		for (int arg = 2; arg < argc; ++arg)
+		{
+			for (const auto& fileName : FindFiles(argv[arg]))
+			{
+				uint32_t width = 0, height = 0;
+				std::vector<uint8_t> pixels;
+				CubeMapLayout::Layout layout = CubeMapLayout::Layout::Unknown;
+				if (LoadImageRgba(fileName, width, height, pixels))
+					layout = CubeMapLayout::DetectLayout(width, height);
+				if (layout == CubeMapLayout::Layout::Unknown)
+				{
+					fwprintf(stderr, L"%ls: not a cube map cross or strip\n", fileName.c_str());
+					continue;
+				}
+
+				CubeMapLayout::FaceView faces[6];
+				uint32_t faceSize = 0;
+				std::vector<uint8_t> scratch;
+				double splitMs = MeasureMilliseconds([&]() {
+					CubeMapLayout::Split(pixels.data(), width, height, width * 4, layout, faces, faceSize, scratch);
+				});
+
+				// 与逐面复制出独立图像的做法比较
+				std::vector<uint8_t> copies(static_cast<size_t>(faceSize) * faceSize * 4 * 6);
+				double copyMs = MeasureMilliseconds([&]() {
+					for (size_t face = 0; face < 6; ++face)
+					{
+						uint8_t* dst = copies.data() + face * faceSize * faceSize * 4;
+						for (uint32_t y = 0; y < faceSize; ++y)
+							memcpy(dst + static_cast<size_t>(y) * faceSize * 4, faces[face].data + y * faces[face].rowPitch, faceSize * 4);
+					}
+				});
+
+				std::vector<uint8_t> serialBlocks, parallelBlocks;
+				uint32_t mipCount = 0;
+				double serialMs = MeasureMilliseconds([&]() {
+					EncodeCube(faces, faceSize, true, nullptr, serialBlocks, mipCount);
+				});
+				double parallelMs = MeasureMilliseconds([&]() {
+					EncodeCube(faces, faceSize, true, &pool, parallelBlocks, mipCount);
+				});
+				if (serialBlocks != parallelBlocks)
+					fwprintf(stderr, L"%ls: parallel result differs from serial result\n", fileName.c_str());
+
+				wprintf(L"%-17hs %6u %9.3f %9.3f %11.2f %13.2f %8.2f  %ls\n", CubeMapLayout::GetLayoutName(layout), faceSize,
+					splitMs, copyMs, serialMs, parallelMs, serialMs / parallelMs, fileName.c_str());
+			}
+		}
+		wprintf(L"%zu threads\n", pool.GetThreadCount() + 1);
+		return 0;
+	}
+
+#ifdef _WIN32
+	// 读取纹理的第0级为RGBA8，DDS支持BC1、BC3与32位RGBA/BGRA格式，其他图像见LoadImageRgba
+	bool LoadTextureRgba(const std::wstring& fileName, uint32_t& width, uint32_t& height, std::vector<uint8_t>& pixels)
+	{
+		if (fileName.size() < 4 || _wcsicmp(fileName.c_str() + fileName.size() - 4, L".dds") != 0)
+			return LoadImageRgba(fileName, width, height, pixels);
+
+		MappedFile file;
+		DdsReader reader;
+		if (!file.Open(fileName.c_str()) || !reader.Parse(file.GetData(), file.GetSize()) ||
+			reader.GetDimension() != DdsReader::Dimension::Texture2D || reader.GetArraySize() != 1)
+			return false;
+		const DdsReader::Subresource& top = reader.GetSubresource(0, 0);
+		width = top.width;
+		height = top.height;
+		pixels.resize(static_cast<size_t>(width) * height * 4);
+		switch (reader.GetFormat())
+		{
+		case DdsFormat::BC1_UNORM: case DdsFormat::BC1_UNORM_SRGB:
+			BcEncoder::Decode(BcEncoder::Format::BC1, top.data, width, height, pixels.data(), width * 4);
+			return true;
+		case DdsFormat::BC3_UNORM: case DdsFormat::BC3_UNORM_SRGB:
+			BcEncoder::Decode(BcEncoder::Format::BC3, top.data, width, height, pixels.data(), width * 4);
+			return true;
+		case DdsFormat::R8G8B8A8_UNORM: case DdsFormat::R8G8B8A8_UNORM_SRGB:
+		case DdsFormat::B8G8R8A8_UNORM: case DdsFormat::B8G8R8A8_UNORM_SRGB:
+		{
+			bool bgra = reader.GetFormat() == DdsFormat::B8G8R8A8_UNORM || reader.GetFormat() == DdsFormat::B8G8R8A8_UNORM_SRGB;
+			for (uint32_t y = 0; y < height; ++y)
+			{
+				uint8_t* dst = pixels.data() + static_cast<size_t>(y) * width * 4;
+				memcpy(dst, top.data + y * top.rowPitch, width * 4);
+				for (uint32_t x = 0; bgra && x < width; ++x)
+					std::swap(dst[x * 4], dst[x * 4 + 2]);
+			}
+			return true;
+		}
+		default:
+			return false;
+		}
+	}
+
+	// 按GameObject::Draw的顺序依次绘制每个模型的所有Part时，漫射光纹理发生变化(需要重新绑定SRV)的次数
+	size_t CountTextureSwitches(const std::vector<ObjReader>& models)
+	{
+		size_t switches = 0;
+		const std::wstring* pCurrent = nullptr;
+		for (const auto& model : models)
+		{
+			for (const auto& part : model.objParts)
+			{
+				if (!pCurrent || _wcsicmp(pCurrent->c_str(), part.texStrDiffuse.c_str()) != 0)
+					++switches;
+				pCurrent = &part.texStrDiffuse;
+			}
+		}
+		return switches;
+	}
+
+	size_t CountUniqueTextures(const std::vector<ObjReader>& models)
+	{
+		std::vector<std::wstring> names;
+		for (const auto& model : models)
+		{
+			for (const auto& part : model.objParts)
+			{
+				std::wstring name = part.texStrDiffuse;
+				std::transform(name.begin(), name.end(), name.begin(), ::towlower);
+				if (!name.empty() && std::find(names.begin(), names.end(), name) == names.end())
+					names.push_back(name);
+			}
+		}
+		return names.size();
+	}
+
+	int Atlas(int argc, wchar_t* argv[])
+	{
+		int arg = 2;
+		uint32_t maxTextureSize = 512;
+		if (arg + 1 < argc && wcscmp(argv[arg], L"-max") == 0)
+		{
+			maxTextureSize = static_cast<uint32_t>(_wtoi(argv[arg + 1]));
+			arg += 2;
+		}
+		if (arg + 1 >= argc)
+		{
+			PrintUsage();
+			return 1;
+		}
+		std::wstring outputDirectory = argv[arg++];
+		CreateDirectoryW(outputDirectory.c_str(), nullptr);
+		if (outputDirectory.back() != L'\\' && outputDirectory.back() != L'/')
+			outputDirectory += L'\\';
+
+		std::vector<ObjReader> models;
+		std::vector<std::wstring> modelNames;
+		for (; arg < argc; ++arg)
+		{
+			for (const auto& fileName : FindFiles(argv[arg]))
+			{
+				models.emplace_back();
+				if (!models.back().ReadMbo(fileName.c_str()))
+				{
+					fwprintf(stderr, L"Failed to read %ls\n", fileName.c_str());
+					models.pop_back();
+					continue;
+				}
+				modelNames.push_back(fileName);
+			}
+		}
+		size_t texturesBefore = CountUniqueTextures(models);
+		size_t switchesBefore = CountTextureSwitches(models);
+
+		// 收集引用的纹理，任何引用它的Part的纹理坐标超出[0, 1](平铺)时不能放入图集
+		struct AtlasTexture
+		{
+			std::wstring name;
+			uint32_t width;
+			uint32_t height;
+			std::vector<uint8_t> pixels;
+			bool eligible;
+		};
+		std::vector<AtlasTexture> textures;
+		std::vector<std::vector<int>> partTextures(models.size());
+		const float kUvTolerance = 1e-3f;
+		for (size_t m = 0; m < models.size(); ++m)
+		{
+			for (const auto& part : models[m].objParts)
+			{
+				int index = -1;
+				for (size_t i = 0; i < textures.size() && index < 0; ++i)
+					index = _wcsicmp(textures[i].name.c_str(), part.texStrDiffuse.c_str()) == 0 ? static_cast<int>(i) : -1;
+				if (index < 0 && !part.texStrDiffuse.empty())
+				{
+					AtlasTexture texture = { part.texStrDiffuse, 0, 0, {}, false };
+					texture.eligible = LoadTextureRgba(texture.name, texture.width, texture.height, texture.pixels) &&
+						texture.width <= maxTextureSize && texture.height <= maxTextureSize;
+					index = static_cast<int>(textures.size());
+					textures.push_back(std::move(texture));
+				}
+				partTextures[m].push_back(index);
+
+				for (const auto& vertex : part.vertices)
+				{
+					if (index >= 0 && (vertex.tex.x < -kUvTolerance || vertex.tex.x > 1.0f + kUvTolerance ||
+						vertex.tex.y < -kUvTolerance || vertex.tex.y > 1.0f + kUvTolerance))
+					{
+						textures[index].eligible = false;
+						break;
+					}
+				}
+			}
+		}
+
+		std::vector<size_t> atlasIndices;
+		std::vector<std::pair<uint32_t, uint32_t>> sizes;
+		for (size_t i = 0; i < textures.size(); ++i)
+		{
+			wprintf(L"  %-40ls %5ux%-5u %ls\n", textures[i].name.c_str(), textures[i].width, textures[i].height,
+				textures[i].eligible ? L"atlas" : textures[i].pixels.empty() ? L"skipped (unsupported)" : L"skipped (tiled or large)");
+			if (textures[i].eligible)
+			{
+				atlasIndices.push_back(i);
+				sizes.emplace_back(textures[i].width, textures[i].height);
+			}
+		}
+		if (atlasIndices.size() < 2)
+		{
+			fwprintf(stderr, L"Fewer than 2 textures can be merged\n");
+			return 1;
+		}
+
+		TextureAtlas::Result result;
+		if (!TextureAtlas::Pack(sizes, TextureAtlas::GetDefaultOptions(), result))
+		{
+			fwprintf(stderr, L"Textures do not fit in a %ux%u atlas\n", TextureAtlas::GetDefaultOptions().maxSize,
+				TextureAtlas::GetDefaultOptions().maxSize);
+			return 1;
+		}
+
+		// 空白区域为不透明的黑色，不影响BC1/BC3的选择
+		std::vector<uint8_t> atlas(static_cast<size_t>(result.width) * result.height * 4, 0);
+		for (size_t i = 3; i < atlas.size(); i += 4)
+			atlas[i] = 255;
+		size_t usedPixels = 0;
+		for (size_t i = 0; i < atlasIndices.size(); ++i)
+		{
+			const AtlasTexture& texture = textures[atlasIndices[i]];
+			TextureAtlas::Blit(texture.pixels.data(), texture.width * 4, result.placements[i], result.border,
+				atlas.data(), result.width * 4);
+			usedPixels += static_cast<size_t>(texture.width) * texture.height;
+		}
+
+		// 只有盒式滤波的前mipCount级能保证各纹理互不串色
+		ThreadPool& pool = ThreadPool::GetDefault();
+		MipGenerator::Options mipOptions = MipGenerator::GetDefaultOptions();
+		mipOptions.filter = MipGenerator::Filter::Box;
+		mipOptions.alphaReference = IsAlphaTested(atlas) ? 0.5f : -1.0f;
+		std::vector<MipGenerator::Level> levels;
+		MipGenerator::Generate(atlas.data(), result.width, result.height, result.width * 4, mipOptions, levels,
+			result.mipCount, &pool);
+
+		BcEncoder::Format format = ChooseBcFormat(atlas);
+		std::vector<uint8_t> blocks;
+		for (const auto& level : levels)
+		{
+			size_t offset = blocks.size();
+			blocks.resize(offset + BcEncoder::GetEncodedSize(format, level.width, level.height));
+			BcEncoder::Encode(format, level.data.data(), level.width, level.height, level.width * 4, blocks.data() + offset, &pool);
+		}
+
+		std::wstring atlasName = outputDirectory + L"Atlas.dds";
+		DdsReader::Desc desc = { DdsReader::Dimension::Texture2D, BcEncoder::GetDxgiFormat(format), result.width, result.height, 1,
+			static_cast<uint32_t>(levels.size()), 1, false,
+			format == BcEncoder::Format::BC1 ? DdsReader::AlphaMode::Opaque : DdsReader::AlphaMode::Straight };
+		std::vector<uint8_t> header = DdsReader::CreateHeader(desc);
+		std::ofstream fout(atlasName, std::ios::out | std::ios::binary);
+		fout.write(reinterpret_cast<const char*>(header.data()), header.size());
+		fout.write(reinterpret_cast<const char*>(blocks.data()), blocks.size());
+		if (!fout)
+		{
+			fwprintf(stderr, L"Failed to write %ls\n", atlasName.c_str());
+			return 1;
+		}
+
+		// 对照表: 每行为原纹理名与其在图集中的像素区域以及纹理坐标变换
+		std::wofstream table(outputDirectory + L"Atlas.txt");
+		table << L"# " << atlasName << L" " << result.width << L"x" << result.height << L", " << levels.size() << L" mips\n";
+		table << L"# texture x y width height scaleU scaleV offsetU offsetV\n";
+		std::vector<std::array<float, 4>> transforms(textures.size());
+		for (size_t i = 0; i < atlasIndices.size(); ++i)
+		{
+			const TextureAtlas::Placement& placement = result.placements[i];
+			float scale[2], offset[2];
+			TextureAtlas::GetUvTransform(placement, result.width, result.height, scale, offset);
+			transforms[atlasIndices[i]] = { scale[0], scale[1], offset[0], offset[1] };
+			table << textures[atlasIndices[i]].name << L" " << placement.x << L" " << placement.y << L" " << placement.width << L" "
+				<< placement.height << L" " << scale[0] << L" " << scale[1] << L" " << offset[0] << L" " << offset[1] << L"\n";
+		}
+
+		// 改写纹理坐标与纹理名，图集中的纹理坐标需要完整的精度，不使用半精度的顶点量化
+		for (size_t m = 0; m < models.size(); ++m)
+		{
+			for (size_t p = 0; p < models[m].objParts.size(); ++p)
+			{
+				int index = partTextures[m][p];
+				if (index < 0 || !textures[index].eligible)
+					continue;
+				auto& part = models[m].objParts[p];
+				const auto& transform = transforms[index];
+				for (auto& vertex : part.vertices)
+				{
+					vertex.tex.x = (std::min)((std::max)(vertex.tex.x, 0.0f), 1.0f) * transform[0] + transform[2];
+					vertex.tex.y = (std::min)((std::max)(vertex.tex.y, 0.0f), 1.0f) * transform[1] + transform[3];
+				}
+				part.texStrDiffuse = atlasName;
+			}
+
+			// 使用同一纹理的Part相邻，绘制时连续的Part不需要切换纹理
+			std::stable_sort(models[m].objParts.begin(), models[m].objParts.end(),
+				[](const ObjReader::ObjPart& a, const ObjReader::ObjPart& b) {
+					return _wcsicmp(a.texStrDiffuse.c_str(), b.texStrDiffuse.c_str()) < 0;
+				});
+
+			std::wstring outputName = outputDirectory + modelNames[m].substr(modelNames[m].find_last_of(L"\\/") + 1);
+			if (!models[m].WriteMbo(outputName.c_str(), false))
+			{
+				fwprintf(stderr, L"Failed to write %ls\n", outputName.c_str());
+				return 1;
+			}
+			wprintf(L"  -> %ls\n", outputName.c_str());
+		}
+
+		wprintf(L"Atlas %ux%u %hs, %zu mips, %zu textures, %.1f%% used\n", result.width, result.height, GetBcFormatName(format),
+			levels.size(), atlasIndices.size(), 100.0 * usedPixels / (static_cast<double>(result.width) * result.height));
+		wprintf(L"Unique textures: %zu -> %zu\n", texturesBefore, CountUniqueTextures(models));
+		wprintf(L"SRV binds drawing each model once: %zu -> %zu\n", switchesBefore, CountTextureSwitches(models));
+		return 0;
+	}
+#endif
+
+	int Capture(int argc, wchar_t* argv[])
+	{
+		// 没有给出图像时生成1920x1080的测试图像: 渐变、色块与少量噪声，接近渲染画面的压缩难度
+		uint32_t width = 1920, height = 1080;
+		std::vector<uint8_t> image;
+		if (argc >= 3)
+		{
+			if (!LoadImageRgba(argv[2], width, height, image))
+			{
+				fwprintf(stderr, L"%ls: cannot load image\n", argv[2]);
+				return 1;
+			}
+		}
+		else
+		{
+			std::mt19937 rng(1);
+			image.resize(static_cast<size_t>(width) * height * 4);
+			for (uint32_t y = 0; y < height; ++y)
+			{
+				for (uint32_t x = 0; x < width; ++x)
+				{
+					uint8_t* p = &image[(static_cast<size_t>(y) * width + x) * 4];
+					bool block = ((x / 64) + (y / 64)) % 5 == 0;
+					p[0] = static_cast<uint8_t>(block ? 200 : x * 255 / width);
+					p[1] = static_cast<uint8_t>(block ? 80 : y * 255 / height);
+					p[2] = static_cast<uint8_t>(block ? 40 : 128 + (rng() & 7));
+					p[3] = 255;
+				}
+			}
+		}
+
+		// 每帧水平滚动一段距离，模拟摄像机移动；YUV420需要偶数宽高，多余的行列不编码
+		const int kFrameVariants = 8, kFrameCount = 30;
+		uint32_t rowPitch = width * 4;
+		std::vector<std::vector<uint8_t>> frames(kFrameVariants, std::vector<uint8_t>(image.size()));
+		for (int i = 0; i < kFrameVariants; ++i)
+		{
+			uint32_t shift = i * 16 % width;
+			for (uint32_t y = 0; y < height; ++y)
+			{
+				const uint8_t* src = image.data() + static_cast<size_t>(y) * rowPitch;
+				uint8_t* dst = frames[i].data() + static_cast<size_t>(y) * rowPitch;
+				memcpy(dst, src + shift * 4, (width - shift) * 4);
+				memcpy(dst + (width - shift) * 4, src, shift * 4);
+			}
+		}
+		width &= ~1u;
+		height &= ~1u;
+
+		const FrameEncoder::Format formats[] = { FrameEncoder::Format::Png, FrameEncoder::Format::Dds,
+			FrameEncoder::Format::Rgb, FrameEncoder::Format::Yuv420 };
+		std::vector<uint32_t> threadCounts(1, 1);
+		unsigned hardwareThreads = std::thread::hardware_concurrency();
+		if (hardwareThreads > 2)
+			threadCounts.push_back(hardwareThreads - 1);
+
+		// 不丢帧时的持续吞吐量: 输入按宽 * 高 * 4字节计算，输出为编码后的字节数(只计数，不写文件)
+		wprintf(L"%ux%u, %d frames\n", width, height, kFrameCount);
+		wprintf(L"%-8hs %8ls %10ls %11ls %12ls %8ls %10ls\n", "format", L"threads", L"frames/s", L"MB/s in",
+			L"MB/s out", L"ratio", L"ms/frame");
+		for (FrameEncoder::Format format : formats)
+		{
+			for (uint32_t threadCount : threadCounts)
+			{
+				FrameEncoder::Options options = FrameEncoder::GetDefaultOptions();
+				options.format = format;
+				options.policy = FrameEncoder::Policy::Block;
+				options.threadCount = threadCount;
+				options.maxPendingFrames = threadCount * 2;
+				FrameEncoder encoder(options, [](uint64_t, const std::vector<uint8_t>&) {});
+				for (int i = 0; i < kFrameCount; ++i)
+					encoder.Submit(frames[i % kFrameVariants].data(), width, height, rowPitch, false);
+				encoder.Flush();
+
+				FrameEncoder::Statistics stats = encoder.GetStatistics();
+				wprintf(L"%-8hs %8u %10.1f %11.1f %12.1f %8.3f %10.2f\n", FrameEncoder::GetFormatName(format), threadCount,
+					stats.encodedFrames / stats.elapsedSeconds, stats.inputBytes / stats.elapsedSeconds / 1e6,
+					stats.outputBytes / stats.elapsedSeconds / 1e6, static_cast<double>(stats.outputBytes) / stats.inputBytes,
+					stats.encodeSeconds * 1000.0 / stats.encodedFrames);
+			}
+		}
+
+		// 按60帧/秒提交、编码跟不上时丢帧(录制时的设置)
+		wprintf(L"\n60 frames/s for 2 s, drop policy, %u threads:\n", threadCounts.back());
+		for (FrameEncoder::Format format : formats)
+		{
+			FrameEncoder::Options options = FrameEncoder::GetDefaultOptions();
+			options.format = format;
+			options.threadCount = threadCounts.back();
+			options.maxPendingFrames = 8;
+			FrameEncoder encoder(options, [](uint64_t, const std::vector<uint8_t>&) {});
+			auto next = std::chrono::steady_clock::now();
+			for (int i = 0; i < 120; ++i)
+			{
+				encoder.Submit(frames[i % kFrameVariants].data(), width, height, rowPitch, false);
+				next += std::chrono::microseconds(16667);
+				std::this_thread::sleep_until(next);
+			}
+			encoder.Flush();
+			FrameEncoder::Statistics stats = encoder.GetStatistics();
+			wprintf(L"  %-8hs %llu encoded, %llu dropped\n", FrameEncoder::GetFormatName(format), stats.encodedFrames,
+				stats.droppedFrames);
+		}
+		return 0;
+	}
+
+#ifdef _WIN32
+	template<class VertexType>
+	void BenchTerrain(const char* name, UINT slices)
+	{
+		// 与波浪水面相同的用法: 高度与法线由回调给出，没有颜色的顶点类型不会调用colorFunc
+		auto heightFunc = [](float x, float z) { return 0.1f * (z * sinf(0.1f * x) + x * cosf(0.1f * z)); };
+		auto normalFunc = [](float x, float z) {
+			return DirectX::XMFLOAT3(-0.03f * z * cosf(0.1f * x) - 0.1f * cosf(0.1f * z), 1.0f,
+				-0.1f * sinf(0.1f * x) + 0.01f * x * sinf(0.1f * z));
+		};
+		auto colorFunc = [](float, float) { return DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f); };
+		const float size = 160.0f, texScale = 5.0f;
+		ThreadPool& pool = ThreadPool::GetDefault();
+
+		Geometry::MeshData<VertexType, DWORD> reference, meshData;
+		double functionMs = MeasureMilliseconds([&]() {
+			reference = Geometry::CreateTerrain<VertexType, DWORD>(DirectX::XMFLOAT2(size, size),
+				DirectX::XMUINT2(slices, slices), DirectX::XMFLOAT2(texScale, texScale), heightFunc, normalFunc);
+		});
+		double inlineMs = MeasureMilliseconds([&]() {
+			meshData = Geometry::CreateTerrain<VertexType, DWORD>(size, size, slices, slices, texScale, texScale,
+				heightFunc, normalFunc, colorFunc, nullptr);
+		});
+		double parallelMs = MeasureMilliseconds([&]() {
+			meshData = Geometry::CreateTerrain<VertexType, DWORD>(size, size, slices, slices, texScale, texScale,
+				heightFunc, normalFunc, colorFunc, &pool);
+		});
+		bool identical = meshData.indexVec == reference.indexVec &&
+			memcmp(meshData.vertexVec.data(), reference.vertexVec.data(), reference.vertexVec.size() * sizeof(VertexType)) == 0;
+
+		// 按行批量的回调: 高度一次填满一行，循环中没有函数调用
+		double rowsMs = MeasureMilliseconds([&]() {
+			meshData = Geometry::CreateTerrainByRows<VertexType, DWORD>(size, size, slices, slices, texScale, texScale,
+				[&heightFunc](const float* posX, float posZ, UINT count, float* heights) {
+					for (UINT i = 0; i < count; ++i)
+						heights[i] = heightFunc(posX[i], posZ);
+				},
+				[&normalFunc](const float* posX, float posZ, UINT count, DirectX::XMFLOAT3* normals) {
+					for (UINT i = 0; i < count; ++i)
+						normals[i] = normalFunc(posX[i], posZ);
+				},
+				[](const float*, float, UINT count, DirectX::XMFLOAT4* colors) {
+					std::fill(colors, colors + count, DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f));
+				}, &pool);
+		});
+		identical = identical && memcmp(meshData.vertexVec.data(), reference.vertexVec.data(),
+			reference.vertexVec.size() * sizeof(VertexType)) == 0;
+
+		wprintf(L"%-26hs %13.2f %10.2f %12.2f %10.2f %8.2f  %hs\n", name, functionMs, inlineMs, parallelMs, rowsMs,
+			functionMs / parallelMs, identical ? "identical" : "DIFFERENT");
+	}
+
+	int Terrain(int argc, wchar_t* argv[])
+	{
+		UINT slices = argc >= 3 ? static_cast<UINT>(_wtoi(argv[2])) : 2048;
+		if (slices == 0)
+			slices = 2048;
+		wprintf(L"CreateTerrain %ux%u slices\n", slices, slices);
+		wprintf(L"%-26hs %13ls %10ls %12ls %10ls %8ls\n", "vertex", L"function ms", L"inline ms", L"parallel ms",
+			L"rows ms", L"speedup");
+		BenchTerrain<VertexPos>("VertexPos", slices);
+		BenchTerrain<VertexPosTex>("VertexPosTex", slices);
+		BenchTerrain<VertexPosNormalTex>("VertexPosNormalTex", slices);
+		BenchTerrain<VertexPosNormalColor>("VertexPosNormalColor", slices);
+		BenchTerrain<VertexPosNormalTangentTex>("VertexPosNormalTangentTex", slices);
+		wprintf(L"%zu threads\n", ThreadPool::GetDefault().GetThreadCount() + 1);
+		return 0;
+	}
+#endif
+
+	int Run(int argc, wchar_t* argv[])
+	{
+		if (argc >= 4 && wcscmp(argv[1], L"pack") == 0)
+			return Pack(argc, argv);
+		if (argc == 3 && wcscmp(argv[1], L"list") == 0)
+			return List(argv[2]);
+		if (argc >= 3 && wcscmp(argv[1], L"bench") == 0)
+			return Bench(argc, argv);
+		if (argc >= 4 && wcscmp(argv[1], L"cook") == 0)
+			return Cook(argc, argv);
+		if (argc >= 4 && wcscmp(argv[1], L"budget") == 0)
+			return Budget(argc, argv);
+		if (argc >= 3 && wcscmp(argv[1], L"stream") == 0)
+			return Stream(argc, argv);
+		if (argc >= 3 && wcscmp(argv[1], L"bc") == 0)
+			return Bc(argc, argv);
+		if (argc >= 3 && wcscmp(argv[1], L"mips") == 0)
+			return Mips(argc, argv);
+		if (argc >= 2 && argc <= 3 && wcscmp(argv[1], L"pixels") == 0)
+			return Pixels(argc, argv);
+		if (argc >= 2 && wcscmp(argv[1], L"indices") == 0)
+			return Indices(argc, argv);
+		if (argc >= 3 && wcscmp(argv[1], L"decode") == 0)
+			return Decode(argc, argv);
+		if (argc >= 3 && wcscmp(argv[1], L"cube") == 0)
+			return Cube(argc, argv);
+#ifdef _WIN32
+		if (argc >= 4 && wcscmp(argv[1], L"atlas") == 0)
+			return Atlas(argc, argv);
+		if (argc >= 2 && argc <= 3 && wcscmp(argv[1], L"terrain") == 0)
+			return Terrain(argc, argv);
+#endif
+		if (argc >= 2 && argc <= 3 && wcscmp(argv[1], L"capture") == 0)
+			return Capture(argc, argv);
+
+		PrintUsage();
+		return 1;
+	}
+}
+
+#ifdef _WIN32
+int wmain(int argc, wchar_t* argv[])
+{
+	return Run(argc, argv);
+}
+#else
+// 参数按UTF-8转换为宽字符串，之后与Windows上的处理相同
+int main(int argc, char* argv[])
+{
+	// 使wprintf能输出非ASCII的路径
+	setlocale(LC_ALL, "");
+	std::vector<std::wstring> arguments;
+	for (int i = 0; i < argc; ++i)
+		arguments.push_back(std::filesystem::u8path(argv[i]).wstring());
+	std::vector<wchar_t*> pointers;
+	for (auto& argument : arguments)
+		pointers.push_back(&argument[0]);
+	return Run(argc, pointers.data());
+}
+#endif
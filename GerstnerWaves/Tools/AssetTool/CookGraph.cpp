@@ -0,0 +1,455 @@
+﻿#include "CookGraph.h"
+#include "../../Json.h"
+#include "../../MappedFile.h"
+#include "../../ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cwctype>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+
+namespace
+{
+	namespace fs = std::filesystem;
+
+	// 记录文件的格式版本
+	const int kCookGraphVersion = 1;
+	const wchar_t* const kCookGraphFileName = L"CookGraph.json";
+	// 生成输出路径时使用的目录分隔符，记录的键不受影响(见MakeKey)
+	const wchar_t kSeparator = static_cast<wchar_t>(fs::path::preferred_separator);
+
+	struct FileStamp
+	{
+		uint64_t size;
+		uint64_t time;			// 最后写入时间(file_time_type的计数，MSVC上即FILETIME)
+	};
+
+	struct InputRecord
+	{
+		std::wstring path;
+		FileStamp stamp;
+		uint64_t hash;
+	};
+
+	struct OutputRecord
+	{
+		std::string importer;
+		FileStamp stamp;
+		std::vector<InputRecord> inputs;	// inputs[0]为源文件
+	};
+
+	bool GetFileStamp(const std::wstring& fileName, FileStamp& stamp)
+	{
+		std::error_code error;
+		fs::path path(fileName);
+		if (!fs::is_regular_file(path, error))
+			return false;
+		uintmax_t size = fs::file_size(path, error);
+		if (error)
+			return false;
+		fs::file_time_type time = fs::last_write_time(path, error);
+		if (error)
+			return false;
+		stamp.size = static_cast<uint64_t>(size);
+		stamp.time = static_cast<uint64_t>(time.time_since_epoch().count());
+		return true;
+	}
+
+	bool operator==(const FileStamp& lhs, const FileStamp& rhs)
+	{
+		return lhs.size == rhs.size && lhs.time == rhs.time;
+	}
+
+	// 记录中的路径为UTF-8，转换由std::filesystem::path完成(wchar_t在Windows上为UTF-16，其他平台上为UTF-32)
+	std::string ToUtf8(const std::wstring& str)
+	{
+		try
+		{
+			auto result = fs::path(str).u8string();
+			return std::string(result.begin(), result.end());
+		}
+		catch (const std::exception&)
+		{
+			return std::string();
+		}
+	}
+
+	std::wstring FromUtf8(const std::string& str)
+	{
+		try
+		{
+			return fs::u8path(str).wstring();
+		}
+		catch (const std::exception&)
+		{
+			return std::wstring();
+		}
+	}
+
+	bool EqualsNoCase(const wchar_t* lhs, const wchar_t* rhs)
+	{
+		for (; *lhs && *rhs; ++lhs, ++rhs)
+		{
+			if (towlower(*lhs) != towlower(*rhs))
+				return false;
+		}
+		return *lhs == *rhs;
+	}
+
+	// 64位整数以十六进制字符串保存，避免JSON数值的精度损失
+	std::string ToHex(uint64_t value)
+	{
+		char buffer[17];
+		snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(value));
+		return buffer;
+	}
+
+	uint64_t FromHex(const JsonValue& value)
+	{
+		return strtoull(value.GetString().c_str(), nullptr, 16);
+	}
+
+	std::string EscapeJson(const std::string& str)
+	{
+		std::string result;
+		for (char c : str)
+		{
+			if (c == '"' || c == '\\')
+			{
+				result += '\\';
+				result += c;
+			}
+			else if (static_cast<unsigned char>(c) < 0x20)
+			{
+				char buffer[8];
+				snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+				result += buffer;
+			}
+			else
+			{
+				result += c;
+			}
+		}
+		return result;
+	}
+
+	// 输出路径作为记录的键，不区分大小写
+	std::wstring MakeKey(const std::wstring& output)
+	{
+		std::wstring key = output;
+		for (auto& c : key)
+			c = c == L'/' ? L'\\' : towlower(c);
+		return key;
+	}
+
+	typedef std::map<std::wstring, OutputRecord> RecordMap;
+
+	void LoadRecords(const std::wstring& fileName, RecordMap& records)
+	{
+		MappedFile file;
+		JsonValue root;
+		if (!file.Open(fileName.c_str()) ||
+			!JsonValue::Parse(reinterpret_cast<const char*>(file.GetData()), file.GetSize(), root) ||
+			root["version"].GetNumber() != kCookGraphVersion)
+			return;
+
+		const JsonValue& outputs = root["outputs"];
+		for (size_t i = 0; i < outputs.GetSize(); ++i)
+		{
+			const JsonValue& output = outputs[i];
+			OutputRecord record;
+			record.importer = output["importer"].GetString();
+			record.stamp.size = FromHex(output["size"]);
+			record.stamp.time = FromHex(output["time"]);
+
+			const JsonValue& inputs = output["inputs"];
+			for (size_t j = 0; j < inputs.GetSize(); ++j)
+			{
+				InputRecord input;
+				input.path = FromUtf8(inputs[j]["path"].GetString());
+				input.stamp.size = FromHex(inputs[j]["size"]);
+				input.stamp.time = FromHex(inputs[j]["time"]);
+				input.hash = FromHex(inputs[j]["hash"]);
+				record.inputs.push_back(input);
+			}
+			records[MakeKey(FromUtf8(output["output"].GetString()))] = record;
+		}
+	}
+
+	bool SaveRecords(const std::wstring& fileName, const std::vector<std::wstring>& outputs,
+		const std::vector<OutputRecord>& records)
+	{
+		std::string text = "{\n\t\"version\": " + std::to_string(kCookGraphVersion) + ",\n\t\"outputs\": [";
+		bool first = true;
+		for (size_t i = 0; i < outputs.size(); ++i)
+		{
+			// 烘焙失败的输出没有记录，下次会重新烘焙
+			if (records[i].inputs.empty())
+				continue;
+
+			text += first ? "\n" : ",\n";
+			first = false;
+			text += "\t\t{ \"output\": \"" + EscapeJson(ToUtf8(outputs[i])) + "\", \"importer\": \"" +
+				EscapeJson(records[i].importer) + "\", \"size\": \"" + ToHex(records[i].stamp.size) +
+				"\", \"time\": \"" + ToHex(records[i].stamp.time) + "\",\n\t\t  \"inputs\": [";
+			for (size_t j = 0; j < records[i].inputs.size(); ++j)
+			{
+				const InputRecord& input = records[i].inputs[j];
+				text += j ? ",\n\t\t\t" : "\n\t\t\t";
+				text += "{ \"path\": \"" + EscapeJson(ToUtf8(input.path)) + "\", \"size\": \"" + ToHex(input.stamp.size) +
+					"\", \"time\": \"" + ToHex(input.stamp.time) + "\", \"hash\": \"" + ToHex(input.hash) + "\" }";
+			}
+			text += " ] }";
+		}
+		text += "\n\t]\n}\n";
+
+		// 先写入临时文件再替换，避免中途失败留下损坏的记录
+		fs::path tempFileName = fileName + L".tmp";
+		{
+			std::ofstream fout(tempFileName, std::ios::out | std::ios::binary);
+			if (!fout.write(text.data(), text.size()))
+				return false;
+		}
+		std::error_code error;
+		fs::rename(tempFileName, fs::path(fileName), error);
+		return !error;
+	}
+
+	// 逐级创建输出文件所在的目录
+	void CreateParentDirectories(const std::wstring& fileName)
+	{
+		std::error_code error;
+		fs::path directory = fs::path(fileName).parent_path();
+		if (!directory.empty())
+			fs::create_directories(directory, error);
+	}
+
+	// 记录一个输入的大小、修改时间与哈希，文件不存在时返回false
+	bool RecordInput(const std::wstring& fileName, InputRecord& input)
+	{
+		input.path = fileName;
+		return GetFileStamp(fileName, input.stamp) && CookGraph::HashFile(fileName, input.hash);
+	}
+}
+
+void CookGraph::AddRule(Rule rule)
+{
+	m_Rules.push_back(std::move(rule));
+}
+
+size_t CookGraph::AddSourceDirectory(const std::wstring& directory)
+{
+	std::wstring path = directory;
+	while (!path.empty() && (path.back() == L'\\' || path.back() == L'/'))
+		path.pop_back();
+	size_t pos = path.find_last_of(L"\\/");
+	std::wstring name = pos == std::wstring::npos ? path : path.substr(pos + 1);
+
+	size_t oldCount = m_Sources.size();
+	AddDirectory(path, name + kSeparator);
+
+	// 多个源文件对应同一输出时(如tree.obj与tree.mbo)，只保留先添加的规则对应的源文件
+	std::stable_sort(m_Sources.begin() + oldCount, m_Sources.end(), [](const Source& lhs, const Source& rhs) {
+		std::wstring lhsKey = MakeKey(lhs.output), rhsKey = MakeKey(rhs.output);
+		return lhsKey != rhsKey ? lhsKey < rhsKey : lhs.ruleIndex < rhs.ruleIndex;
+	});
+	m_Sources.erase(std::unique(m_Sources.begin() + oldCount, m_Sources.end(), [](const Source& lhs, const Source& rhs) {
+		return MakeKey(lhs.output) == MakeKey(rhs.output);
+	}), m_Sources.end());
+
+	return m_Sources.size() - oldCount;
+}
+
+void CookGraph::AddDirectory(const std::wstring& directory, const std::wstring& outputPrefix)
+{
+	std::error_code error;
+	for (fs::directory_iterator it(fs::path(directory), error), end; !error && it != end; it.increment(error))
+	{
+		std::wstring fileName = it->path().filename().wstring();
+		std::error_code typeError;
+		if (it->is_directory(typeError))
+		{
+			AddDirectory(directory + kSeparator + fileName, outputPrefix + fileName + kSeparator);
+			continue;
+		}
+
+		size_t dotPos = fileName.find_last_of(L'.');
+		if (dotPos == std::wstring::npos)
+			continue;
+		for (size_t i = 0; i < m_Rules.size(); ++i)
+		{
+			if (!EqualsNoCase(fileName.c_str() + dotPos, m_Rules[i].sourceExtension.c_str()))
+				continue;
+
+			Source source;
+			source.source = directory + kSeparator + fileName;
+			source.output = outputPrefix + (m_Rules[i].outputExtension.empty() ? fileName :
+				fileName.substr(0, dotPos) + m_Rules[i].outputExtension);
+			source.ruleIndex = i;
+			m_Sources.push_back(source);
+			break;
+		}
+	}
+}
+
+bool CookGraph::Build(const std::wstring& outputDirectory, ThreadPool& pool, std::vector<Report>& reports)
+{
+	std::wstring recordFileName = outputDirectory + kSeparator + kCookGraphFileName;
+	RecordMap oldRecords;
+	LoadRecords(recordFileName, oldRecords);
+
+	size_t count = m_Sources.size();
+	std::vector<std::wstring> outputs(count);
+	std::vector<OutputRecord> records(count);
+	std::unique_ptr<bool[]> recordChanged(new bool[count]());
+	reports.assign(count, Report());
+
+	pool.ParallelFor(count, [&](size_t i) {
+		auto start = std::chrono::high_resolution_clock::now();
+		const Source& source = m_Sources[i];
+		const Rule& rule = m_Rules[source.ruleIndex];
+		std::wstring outputFileName = outputDirectory + kSeparator + source.output;
+		Report& report = reports[i];
+		report.output = source.output;
+		outputs[i] = source.output;
+
+		//
+		// 检查输出是否过期
+		//
+		auto it = oldRecords.find(MakeKey(source.output));
+		FileStamp outputStamp;
+		if (it == oldRecords.end())
+			report.reason = L"new output";
+		else if (it->second.importer != rule.importer)
+			report.reason = L"importer changed";
+		else if (!GetFileStamp(outputFileName, outputStamp) || !(outputStamp == it->second.stamp))
+			report.reason = L"output missing or modified";
+		else if (it->second.inputs.empty() || MakeKey(it->second.inputs[0].path) != MakeKey(source.source))
+			report.reason = L"source moved";
+		else
+		{
+			records[i] = it->second;
+			for (InputRecord& input : records[i].inputs)
+			{
+				FileStamp stamp;
+				if (!GetFileStamp(input.path, stamp))
+				{
+					report.reason = input.path + L" removed";
+					break;
+				}
+				if (stamp == input.stamp)
+					continue;
+
+				// 大小或修改时间变化，再比较内容，内容未变时只更新记录
+				uint64_t hash;
+				if (!HashFile(input.path, hash) || hash != input.hash)
+				{
+					report.reason = input.path + L" changed";
+					break;
+				}
+				input.stamp = stamp;
+				recordChanged[i] = true;
+			}
+		}
+
+		if (report.reason.empty())
+		{
+			report.status = Status::UpToDate;
+		}
+		else
+		{
+			//
+			// 重新烘焙并记录全部输入
+			//
+			recordChanged[i] = true;
+			records[i] = OutputRecord();
+			CreateParentDirectories(outputFileName);
+
+			std::vector<std::wstring> dependencies;
+			InputRecord input;
+			if (rule.cooker(source.source, outputFileName, dependencies) &&
+				GetFileStamp(outputFileName, records[i].stamp) && RecordInput(source.source, input))
+			{
+				records[i].importer = rule.importer;
+				records[i].inputs.push_back(input);
+				for (const auto& dependency : dependencies)
+				{
+					bool duplicated = false;
+					for (const auto& recorded : records[i].inputs)
+						duplicated = duplicated || MakeKey(recorded.path) == MakeKey(dependency);
+					if (!duplicated && RecordInput(dependency, input))
+						records[i].inputs.push_back(input);
+				}
+				report.status = Status::Cooked;
+			}
+			else
+			{
+				records[i] = OutputRecord();
+				report.status = Status::Failed;
+			}
+		}
+
+		report.seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	});
+
+	// 源文件被删除的输出不再记录
+	bool changed = oldRecords.size() != count;
+	bool succeeded = true;
+	for (size_t i = 0; i < count; ++i)
+	{
+		changed = changed || recordChanged[i];
+		succeeded = succeeded && reports[i].status != Status::Failed;
+	}
+	if (changed)
+	{
+		std::error_code error;
+		fs::create_directories(fs::path(outputDirectory), error);
+		if (!SaveRecords(recordFileName, outputs, records))
+			succeeded = false;
+	}
+
+	std::vector<size_t> order(count);
+	for (size_t i = 0; i < count; ++i)
+		order[i] = i;
+	std::sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+		return MakeKey(reports[lhs].output) < MakeKey(reports[rhs].output);
+	});
+	std::vector<Report> sortedReports(count);
+	for (size_t i = 0; i < count; ++i)
+		sortedReports[i] = std::move(reports[order[i]]);
+	reports.swap(sortedReports);
+
+	return succeeded;
+}
+
+bool CookGraph::HashFile(const std::wstring& fileName, uint64_t& hash)
+{
+	// 按8字节的字混合，每个字的乘法与移位使所有位都参与后续的结果
+	hash = 0xcbf29ce484222325ull;
+	MappedFile file;
+	if (!file.Open(fileName.c_str()))
+	{
+		// 空文件无法映射
+		FileStamp stamp;
+		return GetFileStamp(fileName, stamp) && stamp.size == 0;
+	}
+
+	const uint8_t* data = file.GetData();
+	size_t size = file.GetSize();
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8)
+	{
+		uint64_t word;
+		memcpy(&word, data + i, sizeof(word));
+		hash = (hash ^ word) * 0x9E3779B97F4A7C15ull;
+		hash ^= hash >> 29;
+	}
+	for (; i < size; ++i)
+		hash = (hash ^ data[i]) * 0x100000001B3ull;
+	hash ^= size;
+	return true;
+}
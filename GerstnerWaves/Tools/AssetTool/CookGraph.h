@@ -0,0 +1,86 @@
+﻿//***************************************************************************************
+// CookGraph.h
+// Licensed under the MIT License.
+//
+// 增量烘焙图
+// - 每个源文件按扩展名匹配一条规则，生成输出目录下对应的一个输出文件
+// - 每个输出记录其全部输入(源文件与烘焙时读取的其他文件)的大小、修改时间与内容哈希，以及导入器版本
+// - 输入的大小与修改时间均未变化时不读取文件内容，变化时再比较内容哈希，只有内容或导入器变化才重新烘焙
+// - 需要检查与烘焙的输出在线程池中并行处理，记录保存在输出目录下的CookGraph.json中
+// Incremental cook graph: every output records the size, timestamp and content hash
+// of each of its inputs plus the importer version, and is rebuilt in parallel only
+// when one of them really changed.
+//***************************************************************************************
+
+#ifndef COOKGRAPH_H
+#define COOKGRAPH_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+class CookGraph
+{
+public:
+	// 烘焙回调，把source烘焙为output
+	// [Out]dependencies	除源文件外烘焙时读取的其他文件，不存在的文件会被忽略
+	// 返回是否成功
+	typedef std::function<bool(const std::wstring& source, const std::wstring& output,
+		std::vector<std::wstring>& dependencies)> Cooker;
+
+	struct Rule
+	{
+		std::wstring sourceExtension;		// 源文件扩展名，如L".obj"，不区分大小写
+		std::wstring outputExtension;		// 输出文件扩展名，为空时与源文件相同
+		std::string importer;				// 导入器名称与版本，变化时所有输出都会重新烘焙
+		Cooker cooker;
+	};
+
+	enum class Status
+	{
+		UpToDate,
+		Cooked,
+		Failed
+	};
+
+	// 每个输出的处理结果
+	struct Report
+	{
+		std::wstring output;
+		Status status;
+		std::wstring reason;				// 重新烘焙的原因
+		double seconds;						// 检查与烘焙的耗时
+	};
+
+	void AddRule(Rule rule);
+
+	// 递归地添加目录下所有能匹配规则的文件，输出位于输出目录下以该目录名命名的子目录中
+	// 例如..\Model\tree.obj -> <输出目录>\Model\tree.mbo
+	// 返回添加的文件数目
+	size_t AddSourceDirectory(const std::wstring& directory);
+
+	// 检查并烘焙所有输出，reports按输出路径排序
+	// 返回是否全部成功
+	bool Build(const std::wstring& outputDirectory, ThreadPool& pool, std::vector<Report>& reports);
+
+	// 文件内容的64位哈希
+	static bool HashFile(const std::wstring& fileName, uint64_t& hash);
+
+private:
+	struct Source
+	{
+		std::wstring source;
+		std::wstring output;				// 相对于输出目录的路径
+		size_t ruleIndex;
+	};
+
+	void AddDirectory(const std::wstring& directory, const std::wstring& outputPrefix);
+
+	std::vector<Rule> m_Rules;
+	std::vector<Source> m_Sources;
+};
+
+#endif
@@ -0,0 +1,326 @@
+﻿//***************************************************************************************
+// DdsTest.cpp
+// Licensed under the MIT License.
+//
+// DDS解析(见DdsReader)的语料测试、模糊测试与吞吐量测试，只依赖DdsReader与MappedFile，可在Linux上构建与运行
+// 用法:
+//   DdsTest [-fuzz <次数>] [-bench <毫秒>] <DDS文件或目录>...
+// - 先测试由CreateHeader生成的各种维度、格式与mip数的文件，再递归地测试目录下所有的.dds文件
+// - 每个文件都需要解析成功、描述与文件头一致、所有子资源位于文件之内，截断的文件需要解析失败
+// - -fuzz对每个文件随机改写与截断指定次数，解析失败是预期的，但不能越界
+// - -bench对每个映射的文件反复解析指定的时间，输出每次解析的耗时与对应的文件字节数的吞吐量
+// 任何文件不满足以上要求时返回1
+// 例如(在GerstnerWaves目录下):
+//   DdsTest -fuzz 1000 ../Texture ../Model
+// Corpus, fuzz and throughput test for the DDS parser, portable to Linux.
+//***************************************************************************************
+
+#include "../../DdsReader.h"
+#include "../../MappedFile.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	namespace fs = std::filesystem;
+
+	struct Settings
+	{
+		int fuzzCount;
+		double benchSeconds;
+	};
+
+	struct Totals
+	{
+		size_t fileCount;
+		size_t failedCount;
+		uint64_t parseCount;
+		uint64_t parsedBytes;
+		double parseSeconds;
+	};
+
+	// 路径按UTF-8输出
+	std::string GetDisplayName(const fs::path& path)
+	{
+		auto name = path.generic_u8string();
+		return std::string(name.begin(), name.end());
+	}
+
+	const char* GetDimensionName(const DdsReader& reader)
+	{
+		switch (reader.GetDimension())
+		{
+		case DdsReader::Dimension::Texture1D: return "1D";
+		case DdsReader::Dimension::Texture2D: return reader.IsCubeMap() ? "cube" : "2D";
+		case DdsReader::Dimension::Texture3D: return "3D";
+		default: return "?";
+		}
+	}
+
+	// 检查解析结果的每个子资源都位于输入数据之内，且总字节数与子资源之和一致
+	bool CheckSubresources(const DdsReader& reader, const uint8_t* data, size_t size)
+	{
+		size_t dataSize = 0;
+		for (const auto& subresource : reader.GetSubresources())
+		{
+			size_t offset = static_cast<size_t>(subresource.data - data);
+			if (subresource.data < data || offset > size || subresource.slicePitch * subresource.depth > size - offset)
+				return false;
+			dataSize += subresource.slicePitch * subresource.depth;
+		}
+		return dataSize == reader.GetDataSize() &&
+			reader.GetSubresources().size() == static_cast<size_t>(reader.GetArraySize()) * reader.GetMipCount();
+	}
+
+	// 随机改写文件头附近与随机位置的字节、截断文件，解析失败是预期的，但不能越界
+	bool Fuzz(const std::string& name, const uint8_t* data, size_t size, int count)
+	{
+		std::mt19937 random(12345);
+		size_t acceptedCount = 0;
+		for (int i = 0; i < count; ++i)
+		{
+			std::vector<uint8_t> mutated(data, data + size);
+			int editCount = 1 + static_cast<int>(random() % 8);
+			for (int j = 0; j < editCount && !mutated.empty(); ++j)
+			{
+				// 多数改写落在文件头(魔数+头+DX10头共148字节)中
+				size_t range = (random() % 4 != 0) ? (std::min)(size, static_cast<size_t>(148)) : size;
+				size_t pos = random() % range;
+				switch (random() % 3)
+				{
+				case 0: mutated[pos] = static_cast<uint8_t>(random()); break;
+				case 1: mutated[pos] ^= static_cast<uint8_t>(1u << (random() % 8)); break;
+				default: mutated[pos] = (random() % 2) ? 0xff : 0x00; break;
+				}
+			}
+			if (random() % 4 == 0)
+				mutated.resize(random() % (mutated.size() + 1));
+
+			// 复制到恰好大小的缓冲区，使越界读取能被内存检查工具发现
+			std::unique_ptr<uint8_t[]> buffer(new uint8_t[(std::max)(mutated.size(), static_cast<size_t>(1))]);
+			std::copy(mutated.begin(), mutated.end(), buffer.get());
+			DdsReader reader;
+			if (!reader.Parse(buffer.get(), mutated.size()))
+				continue;
+			++acceptedCount;
+			if (!CheckSubresources(reader, buffer.get(), mutated.size()))
+			{
+				fprintf(stderr, "%s: fuzz iteration %d produced an out of bounds subresource\n", name.c_str(), i);
+				return false;
+			}
+		}
+		printf("  fuzz: %d mutations, %zu accepted\n", count, acceptedCount);
+		return true;
+	}
+
+	// 解析只读取文件头，速度按每秒解析的文件数与对应的文件字节数给出
+	void Bench(const uint8_t* data, size_t size, double benchSeconds, Totals& totals)
+	{
+		DdsReader reader;
+		uint64_t iterations = 0;
+		auto start = std::chrono::high_resolution_clock::now();
+		double seconds = 0.0;
+		do
+		{
+			for (int i = 0; i < 1000; ++i)
+				reader.Parse(data, size);
+			iterations += 1000;
+			seconds = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		} while (seconds < benchSeconds);
+
+		printf("  parse: %.3f us, %.2f GB/s\n", seconds / iterations * 1e6,
+			static_cast<double>(size) * iterations / seconds / 1e9);
+		totals.parseCount += iterations;
+		totals.parsedBytes += static_cast<uint64_t>(size) * iterations;
+		totals.parseSeconds += seconds;
+	}
+
+	// 测试一个完整的DDS文件，expected不为空时还要求解析结果与其一致
+	bool TestFile(const std::string& name, const uint8_t* data, size_t size, const DdsReader::Desc* expected,
+		const Settings& settings, Totals& totals)
+	{
+		++totals.fileCount;
+		DdsReader reader;
+		if (!reader.Parse(data, size))
+		{
+			fprintf(stderr, "%s: %s\n", name.c_str(), reader.GetError());
+			return false;
+		}
+		if (!CheckSubresources(reader, data, size))
+		{
+			fprintf(stderr, "%s: subresource out of bounds\n", name.c_str());
+			return false;
+		}
+		if (expected && (reader.GetDimension() != expected->dimension || reader.GetFormat() != expected->format ||
+			reader.GetWidth() != expected->width || reader.GetHeight() != expected->height ||
+			reader.GetDepth() != expected->depth || reader.GetMipCount() != expected->mipCount ||
+			reader.GetArraySize() != expected->arraySize || reader.IsCubeMap() != expected->isCubeMap ||
+			reader.GetAlphaMode() != expected->alphaMode))
+		{
+			fprintf(stderr, "%s: parsed description does not match the header\n", name.c_str());
+			return false;
+		}
+		printf("%s: %-4s %ux%ux%u mips %u array %u format %u, %zu of %zu bytes in %zu subresources\n",
+			name.c_str(), GetDimensionName(reader), reader.GetWidth(), reader.GetHeight(), reader.GetDepth(),
+			reader.GetMipCount(), reader.GetArraySize(), reader.GetFormat(), reader.GetDataSize(), size,
+			reader.GetSubresources().size());
+
+		// 数据恰好到文件末尾时，缺少最后一个字节的文件需要被识别为截断
+		size_t dataEnd = 0;
+		for (const auto& subresource : reader.GetSubresources())
+			dataEnd = (std::max)(dataEnd, static_cast<size_t>(subresource.data - data) + subresource.slicePitch * subresource.depth);
+		if (dataEnd == size)
+		{
+			std::vector<uint8_t> truncated(data, data + size - 1);
+			DdsReader truncatedReader;
+			if (truncatedReader.Parse(truncated.data(), truncated.size()))
+			{
+				fprintf(stderr, "%s: truncated file was accepted\n", name.c_str());
+				return false;
+			}
+		}
+
+		if (settings.benchSeconds > 0.0)
+			Bench(data, size, settings.benchSeconds, totals);
+		return settings.fuzzCount <= 0 || Fuzz(name, data, size, settings.fuzzCount);
+	}
+
+	// 用CreateHeader生成各种维度、格式与mip数的文件，数据部分为0
+	bool TestGenerated(const Settings& settings, Totals& totals)
+	{
+		using Dimension = DdsReader::Dimension;
+		using AlphaMode = DdsReader::AlphaMode;
+		const DdsReader::Desc descs[] = {
+			{ Dimension::Texture2D, DdsFormat::R8G8B8A8_UNORM, 256, 256, 1, 9, 1, false, AlphaMode::Straight },
+			{ Dimension::Texture2D, DdsFormat::BC1_UNORM_SRGB, 100, 60, 1, 7, 1, false, AlphaMode::Opaque },
+			{ Dimension::Texture2D, DdsFormat::BC3_UNORM, 64, 64, 1, 7, 6, true, AlphaMode::Straight },
+			{ Dimension::Texture2D, DdsFormat::BC7_UNORM, 128, 32, 1, 1, 4, false, AlphaMode::Premultiplied },
+			{ Dimension::Texture2D, DdsFormat::BC5_UNORM, 3, 5, 1, 3, 1, false, AlphaMode::Unknown },
+			{ Dimension::Texture3D, DdsFormat::R16G16B16A16_FLOAT, 32, 32, 8, 6, 1, false, AlphaMode::Unknown },
+			{ Dimension::Texture1D, DdsFormat::R32_FLOAT, 1024, 1, 1, 11, 2, false, AlphaMode::Unknown },
+		};
+
+		bool succeeded = true;
+		for (size_t i = 0; i < sizeof(descs) / sizeof(descs[0]); ++i)
+		{
+			const DdsReader::Desc& desc = descs[i];
+			std::vector<uint8_t> file = DdsReader::CreateHeader(desc);
+			size_t headerSize = file.size();
+			for (uint32_t item = 0; item < desc.arraySize; ++item)
+			{
+				for (uint32_t mip = 0; mip < desc.mipCount; ++mip)
+				{
+					size_t rowPitch = 0, slicePitch = 0, rowCount = 0;
+					DdsReader::GetSurfaceInfo((std::max)(desc.width >> mip, 1u), (std::max)(desc.height >> mip, 1u),
+						desc.format, rowPitch, slicePitch, rowCount);
+					file.resize(file.size() + slicePitch * (std::max)(desc.depth >> mip, 1u));
+				}
+			}
+
+			std::string name = "generated[" + std::to_string(i) + "]";
+			DdsReader reader;
+			if (!TestFile(name, file.data(), file.size(), &desc, settings, totals))
+				succeeded = false;
+			else if (reader.Parse(file.data(), file.size()) && reader.GetDataSize() != file.size() - headerSize)
+			{
+				fprintf(stderr, "%s: %zu data bytes, expected %zu\n", name.c_str(), reader.GetDataSize(), file.size() - headerSize);
+				succeeded = false;
+			}
+		}
+		return succeeded;
+	}
+
+	bool IsDdsFile(const fs::path& path)
+	{
+		std::string extension = path.extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) {
+			return static_cast<char>(c >= 'A' && c <= 'Z' ? c - 'A' + 'a' : c);
+		});
+		return extension == ".dds";
+	}
+
+	// 目录按路径排序后递归遍历，使输出的顺序固定
+	void CollectFiles(const fs::path& path, std::vector<fs::path>& files)
+	{
+		std::error_code error;
+		if (fs::is_regular_file(path, error))
+		{
+			files.push_back(path);
+			return;
+		}
+		std::vector<fs::path> found;
+		for (fs::recursive_directory_iterator it(path, error), end; !error && it != end; it.increment(error))
+		{
+			if (it->is_regular_file(error) && IsDdsFile(it->path()))
+				found.push_back(it->path());
+		}
+		std::sort(found.begin(), found.end());
+		files.insert(files.end(), found.begin(), found.end());
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Settings settings = { 0, 0.1 };
+	int arg = 1;
+	for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2)
+	{
+		if (strcmp(argv[arg], "-fuzz") == 0)
+			settings.fuzzCount = atoi(argv[arg + 1]);
+		else if (strcmp(argv[arg], "-bench") == 0)
+			settings.benchSeconds = atof(argv[arg + 1]) / 1000.0;
+		else
+			break;
+	}
+	if (arg < argc && argv[arg][0] == '-')
+	{
+		printf("Usage:\n  DdsTest [-fuzz <count>] [-bench <milliseconds>] <dds file or directory>...\n");
+		return 1;
+	}
+
+	Totals totals = {};
+	if (!TestGenerated(settings, totals))
+		++totals.failedCount;
+
+	for (; arg < argc; ++arg)
+	{
+		std::vector<fs::path> files;
+		CollectFiles(fs::u8path(argv[arg]), files);
+		if (files.empty())
+		{
+			fprintf(stderr, "No DDS file in %s\n", argv[arg]);
+			++totals.failedCount;
+		}
+		for (const auto& path : files)
+		{
+			std::string name = GetDisplayName(path);
+			MappedFile file;
+			if (!file.Open(path.wstring().c_str()))
+			{
+				fprintf(stderr, "%s: cannot open\n", name.c_str());
+				++totals.failedCount;
+				++totals.fileCount;
+				continue;
+			}
+			if (!TestFile(name, file.GetData(), file.GetSize(), nullptr, settings, totals))
+				++totals.failedCount;
+		}
+	}
+
+	printf("%zu files, %zu failed", totals.fileCount, totals.failedCount);
+	if (totals.parseSeconds > 0.0)
+	{
+		printf(", average parse %.3f us, %.2f GB/s", totals.parseSeconds / totals.parseCount * 1e6,
+			static_cast<double>(totals.parsedBytes) / totals.parseSeconds / 1e9);
+	}
+	printf("\n");
+	return totals.failedCount == 0 ? 0 : 1;
+}
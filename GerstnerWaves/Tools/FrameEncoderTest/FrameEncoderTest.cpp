@@ -0,0 +1,439 @@
+﻿//***************************************************************************************
+// FrameEncoderTest.cpp
+// Licensed under the MIT License.
+//
+// 截图与录制的后台编码(见FrameEncoder)的测试，用CPU上生成的帧代替读回的后备缓冲区，可在Linux上构建与运行
+// - PNG由ImageReader解码、DDS由DdsReader解析后与输入逐像素比较，RGB24逐字节比较，YUV420与浮点的BT.709结果比较
+// - 每帧的内容由帧序号决定，检查输出按提交的顺序进行
+// - 输出回调被阻塞时检查Drop策略丢弃的帧数与Block策略阻塞的提交，以及编码失败的帧的统计
+// - 检查写入文件的输出回调生成的文件
+// 任何检查失败时返回1
+// Headless test for FrameEncoder fed with synthetic CPU frames.
+//***************************************************************************************
+
+#include "../../DdsReader.h"
+#include "../../FrameEncoder.h"
+#include "../../ImageReader.h"
+#include "../../MappedFile.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	namespace fs = std::filesystem;
+
+	int g_FailedCount = 0;
+
+	void Check(bool condition, const char* test, const char* what)
+	{
+		if (!condition)
+		{
+			fprintf(stderr, "%s: %s\n", test, what);
+			++g_FailedCount;
+		}
+	}
+
+	// 一帧合成的图像，行距大于宽度*4，检查编码器按行距读取
+	struct Frame
+	{
+		uint32_t width;
+		uint32_t height;
+		size_t rowPitch;
+		bool bgra;
+		std::vector<uint8_t> pixels;
+
+		// 按RGBA的顺序取一个像素的分量
+		const uint8_t* GetPixel(uint32_t x, uint32_t y) const { return pixels.data() + y * rowPitch + x * 4; }
+		uint8_t R(uint32_t x, uint32_t y) const { return GetPixel(x, y)[bgra ? 2 : 0]; }
+		uint8_t G(uint32_t x, uint32_t y) const { return GetPixel(x, y)[1]; }
+		uint8_t B(uint32_t x, uint32_t y) const { return GetPixel(x, y)[bgra ? 0 : 2]; }
+	};
+
+	// 内容由帧序号决定的图像，包含渐变与噪声，Alpha为随意的值(编码器应忽略)
+	Frame MakeFrame(uint32_t width, uint32_t height, bool bgra, uint32_t frameIndex)
+	{
+		Frame frame = { width, height, static_cast<size_t>(width) * 4 + 12, bgra, {} };
+		frame.pixels.resize(frame.rowPitch * height, 0xCD);
+		uint32_t seed = 0x9E3779B9u * (frameIndex + 1);
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			uint8_t* row = frame.pixels.data() + y * frame.rowPitch;
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				seed = seed * 1664525u + 1013904223u;
+				row[x * 4 + 0] = static_cast<uint8_t>(x * 3 + frameIndex * 17);
+				row[x * 4 + 1] = static_cast<uint8_t>(y * 5 + frameIndex * 29);
+				row[x * 4 + 2] = static_cast<uint8_t>((x + y) % 64 < 32 ? seed >> 24 : frameIndex * 41);
+				row[x * 4 + 3] = static_cast<uint8_t>(seed >> 16);
+			}
+		}
+		return frame;
+	}
+
+	bool CheckPng(const Frame& frame, const std::vector<uint8_t>& data)
+	{
+		ImageReader reader;
+		if (!reader.Parse(data.data(), data.size()) || reader.GetFormat() != ImageReader::Format::Png ||
+			reader.GetWidth() != frame.width || reader.GetHeight() != frame.height || reader.HasAlpha())
+			return false;
+		std::vector<uint8_t> decoded(static_cast<size_t>(frame.width) * frame.height * 4);
+		if (!reader.Decode(decoded.data(), frame.width * 4))
+			return false;
+		for (uint32_t y = 0; y < frame.height; ++y)
+		{
+			for (uint32_t x = 0; x < frame.width; ++x)
+			{
+				const uint8_t* p = decoded.data() + (static_cast<size_t>(y) * frame.width + x) * 4;
+				if (p[0] != frame.R(x, y) || p[1] != frame.G(x, y) || p[2] != frame.B(x, y) || p[3] != 255)
+					return false;
+			}
+		}
+		return true;
+	}
+
+	bool CheckDds(const Frame& frame, const std::vector<uint8_t>& data)
+	{
+		DdsReader reader;
+		if (!reader.Parse(data.data(), data.size()) || reader.GetWidth() != frame.width || reader.GetHeight() != frame.height ||
+			reader.GetMipCount() != 1 || reader.GetArraySize() != 1 ||
+			reader.GetFormat() != (frame.bgra ? DdsFormat::B8G8R8A8_UNORM : DdsFormat::R8G8B8A8_UNORM))
+			return false;
+		const DdsReader::Subresource& subresource = reader.GetSubresource(0, 0);
+		for (uint32_t y = 0; y < frame.height; ++y)
+		{
+			if (memcmp(subresource.data + y * subresource.rowPitch, frame.pixels.data() + y * frame.rowPitch, frame.width * 4) != 0)
+				return false;
+		}
+		return true;
+	}
+
+	bool CheckRgb(const Frame& frame, const std::vector<uint8_t>& data)
+	{
+		if (data.size() != static_cast<size_t>(frame.width) * frame.height * 3)
+			return false;
+		const uint8_t* p = data.data();
+		for (uint32_t y = 0; y < frame.height; ++y)
+		{
+			for (uint32_t x = 0; x < frame.width; ++x, p += 3)
+			{
+				if (p[0] != frame.R(x, y) || p[1] != frame.G(x, y) || p[2] != frame.B(x, y))
+					return false;
+			}
+		}
+		return true;
+	}
+
+	// 与浮点计算的BT.709有限范围的结果比较，U、V取2x2像素的平均值
+	// 编码器的系数放大256倍后取整，Y最多相差1，U、V在饱和的颜色上最多相差约1.4
+	bool CheckYuv420(const Frame& frame, const std::vector<uint8_t>& data)
+	{
+		uint32_t width = frame.width, height = frame.height;
+		size_t lumaSize = static_cast<size_t>(width) * height;
+		if (data.size() != lumaSize * 3 / 2)
+			return false;
+		const uint8_t* planeU = data.data() + lumaSize;
+		const uint8_t* planeV = planeU + lumaSize / 4;
+		auto luma = [](double r, double g, double b) { return 0.2126 * r + 0.7152 * g + 0.0722 * b; };
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				double expected = 16.0 + luma(frame.R(x, y), frame.G(x, y), frame.B(x, y)) * 219.0 / 255.0;
+				if (std::abs(data[static_cast<size_t>(y) * width + x] - expected) > 1.0)
+					return false;
+			}
+		}
+		for (uint32_t y = 0; y < height; y += 2)
+		{
+			for (uint32_t x = 0; x < width; x += 2)
+			{
+				double r = 0.0, g = 0.0, b = 0.0;
+				for (uint32_t i = 0; i < 4; ++i)
+				{
+					r += frame.R(x + i % 2, y + i / 2) / 4.0;
+					g += frame.G(x + i % 2, y + i / 2) / 4.0;
+					b += frame.B(x + i % 2, y + i / 2) / 4.0;
+				}
+				double l = luma(r, g, b);
+				double u = 128.0 + (b - l) / 1.8556 * 224.0 / 255.0;
+				double v = 128.0 + (r - l) / 1.5748 * 224.0 / 255.0;
+				size_t index = static_cast<size_t>(y / 2) * (width / 2) + x / 2;
+				if (std::abs(planeU[index] - u) > 1.5 || std::abs(planeV[index] - v) > 1.5)
+					return false;
+			}
+		}
+		return true;
+	}
+
+	bool CheckOutput(FrameEncoder::Format format, const Frame& frame, const std::vector<uint8_t>& data)
+	{
+		switch (format)
+		{
+		case FrameEncoder::Format::Png: return CheckPng(frame, data);
+		case FrameEncoder::Format::Dds: return CheckDds(frame, data);
+		case FrameEncoder::Format::Rgb: return CheckRgb(frame, data);
+		default: return CheckYuv420(frame, data);
+		}
+	}
+
+	// 纯色的帧，检查YUV的取值范围: 黑为(16, 128, 128)，白为(235, 128, 128)
+	void TestYuvRange()
+	{
+		const uint8_t colors[][4] = { { 0, 0, 0 }, { 255, 255, 255 }, { 255, 0, 0 }, { 0, 255, 0 }, { 0, 0, 255 } };
+		for (const auto& color : colors)
+		{
+			Frame frame = { 4, 2, 16, false, std::vector<uint8_t>(32) };
+			for (size_t i = 0; i < frame.pixels.size(); i += 4)
+				std::copy(color, color + 3, frame.pixels.begin() + i);
+			std::vector<uint8_t> output;
+			bool encoded = FrameEncoder::Encode(FrameEncoder::Format::Yuv420, frame.pixels.data(), frame.width, frame.height,
+				frame.rowPitch, false, 1, output);
+			Check(encoded && CheckYuv420(frame, output), "YUV420 solid color", "differs from BT.709");
+		}
+		Frame black = MakeFrame(2, 2, false, 0), white = black;
+		std::fill(black.pixels.begin(), black.pixels.end(), static_cast<uint8_t>(0));
+		std::fill(white.pixels.begin(), white.pixels.end(), static_cast<uint8_t>(255));
+		std::vector<uint8_t> output;
+		FrameEncoder::Encode(FrameEncoder::Format::Yuv420, black.pixels.data(), 2, 2, black.rowPitch, false, 1, output);
+		Check(output.size() == 6 && output[0] == 16 && output[4] == 128 && output[5] == 128, "YUV420 black", "is not (16, 128, 128)");
+		FrameEncoder::Encode(FrameEncoder::Format::Yuv420, white.pixels.data(), 2, 2, white.rowPitch, false, 1, output);
+		Check(output.size() == 6 && output[0] == 235 && output[4] == 128 && output[5] == 128, "YUV420 white", "is not (235, 128, 128)");
+	}
+
+	// 各格式、各线程数下提交一系列帧，输出需要按顺序且与输入一致
+	void TestFormat(FrameEncoder::Format format, bool bgra, uint32_t threadCount)
+	{
+		const uint32_t frameCount = 12, width = 66, height = 38;
+		std::string test = std::string(FrameEncoder::GetFormatName(format)) + (bgra ? " BGRA" : " RGBA") + ", " +
+			std::to_string(threadCount) + " threads";
+		std::vector<Frame> frames;
+		for (uint32_t i = 0; i < frameCount; ++i)
+			frames.push_back(MakeFrame(width, height, bgra, i));
+
+		FrameEncoder::Options options = FrameEncoder::GetDefaultOptions();
+		options.format = format;
+		options.policy = FrameEncoder::Policy::Block;
+		options.maxPendingFrames = 3;
+		options.threadCount = threadCount;
+		uint64_t expectedIndex = 0;
+		bool inOrder = true, matched = true;
+		size_t outputBytes = 0;
+		{
+			FrameEncoder encoder(options, [&](uint64_t frameIndex, const std::vector<uint8_t>& data) {
+				inOrder = inOrder && frameIndex == expectedIndex++;
+				matched = matched && frameIndex < frameCount && CheckOutput(format, frames[frameIndex], data);
+				outputBytes += data.size();
+			});
+			for (const auto& frame : frames)
+				Check(encoder.Submit(frame.pixels.data(), frame.width, frame.height, frame.rowPitch, frame.bgra), test.c_str(), "Submit blocked and failed");
+			encoder.Flush();
+
+			FrameEncoder::Statistics stats = encoder.GetStatistics();
+			Check(stats.submittedFrames == frameCount && stats.encodedFrames == frameCount && stats.droppedFrames == 0,
+				test.c_str(), "frame counters are wrong");
+			Check(stats.inputBytes == static_cast<uint64_t>(frameCount) * width * height * 4 && stats.outputBytes == outputBytes,
+				test.c_str(), "byte counters are wrong");
+		}
+		Check(expectedIndex == frameCount, test.c_str(), "not every frame was output");
+		Check(inOrder, test.c_str(), "frames were output out of order");
+		Check(matched, test.c_str(), "output does not match the input");
+		printf("%-28s %zu bytes\n", test.c_str(), outputBytes);
+	}
+
+	// 阻塞输出回调直到Open，模拟编码或写入跟不上提交的情况
+	class Gate
+	{
+	public:
+		void Wait()
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_Condition.wait(lock, [this]() { return m_IsOpen; });
+		}
+		void Open()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_IsOpen = true;
+			}
+			m_Condition.notify_all();
+		}
+	private:
+		std::mutex m_Mutex;
+		std::condition_variable m_Condition;
+		bool m_IsOpen = false;
+	};
+
+	// 最多2帧尚未输出，输出被阻塞时之后提交的帧都被丢弃，编码失败的帧也计入丢弃
+	void TestDrop()
+	{
+		const char* test = "Drop policy";
+		FrameEncoder::Options options = FrameEncoder::GetDefaultOptions();
+		options.format = FrameEncoder::Format::Dds;
+		options.maxPendingFrames = 2;
+		options.threadCount = 1;
+		Gate gate;
+		std::vector<uint64_t> indices;
+		FrameEncoder encoder(options, [&](uint64_t frameIndex, const std::vector<uint8_t>&) {
+			gate.Wait();
+			indices.push_back(frameIndex);
+		});
+
+		Frame frame = MakeFrame(16, 8, true, 0);
+		for (int i = 0; i < 5; ++i)
+		{
+			bool accepted = encoder.Submit(frame.pixels.data(), frame.width, frame.height, frame.rowPitch, frame.bgra);
+			Check(accepted == (i < 2), test, i < 2 ? "frame within the limit was dropped" : "frame over the limit was accepted");
+		}
+		Check(!encoder.CanSubmit(), test, "CanSubmit is true while the queue is full");
+		FrameEncoder::Statistics stats = encoder.GetStatistics();
+		Check(stats.submittedFrames == 5 && stats.droppedFrames == 3 && stats.encodedFrames == 0, test, "counters while blocked are wrong");
+
+		gate.Open();
+		encoder.Flush();
+		Check(encoder.CanSubmit(), test, "CanSubmit is false after Flush");
+
+		// 输出恢复后可以继续提交，帧序号不含丢弃的帧
+		Check(encoder.Submit(frame.pixels.data(), frame.width, frame.height, frame.rowPitch, frame.bgra), test, "Submit after Flush failed");
+		encoder.Flush();
+		stats = encoder.GetStatistics();
+		Check(stats.submittedFrames == 6 && stats.droppedFrames == 3 && stats.encodedFrames == 3, test, "counters after Flush are wrong");
+		Check(indices == std::vector<uint64_t>({ 0, 1, 2 }), test, "accepted frames are not numbered in order");
+
+		// YUV420要求宽高为偶数，编码失败的帧不输出，计入丢弃的帧
+		FrameEncoder::Options yuvOptions = options;
+		yuvOptions.format = FrameEncoder::Format::Yuv420;
+		yuvOptions.policy = FrameEncoder::Policy::Block;
+		std::vector<uint64_t> yuvIndices;
+		FrameEncoder yuvEncoder(yuvOptions, [&](uint64_t frameIndex, const std::vector<uint8_t>&) { yuvIndices.push_back(frameIndex); });
+		Frame odd = MakeFrame(15, 8, true, 1);
+		yuvEncoder.Submit(frame.pixels.data(), frame.width, frame.height, frame.rowPitch, frame.bgra);
+		yuvEncoder.Submit(odd.pixels.data(), odd.width, odd.height, odd.rowPitch, odd.bgra);
+		yuvEncoder.Submit(frame.pixels.data(), frame.width, frame.height, frame.rowPitch, frame.bgra);
+		yuvEncoder.Flush();
+		stats = yuvEncoder.GetStatistics();
+		Check(stats.submittedFrames == 3 && stats.encodedFrames == 2 && stats.droppedFrames == 1, "Encode failure", "counters are wrong");
+		Check(yuvIndices == std::vector<uint64_t>({ 0, 2 }), "Encode failure", "failed frame was output");
+		printf("%-28s ok\n", test);
+	}
+
+	// 最多2帧尚未输出，输出被阻塞时第3次提交需要等待，输出恢复后全部帧按顺序输出
+	void TestBlock()
+	{
+		const char* test = "Block policy";
+		FrameEncoder::Options options = FrameEncoder::GetDefaultOptions();
+		options.format = FrameEncoder::Format::Rgb;
+		options.policy = FrameEncoder::Policy::Block;
+		options.maxPendingFrames = 2;
+		options.threadCount = 2;
+		Gate gate;
+		std::vector<uint64_t> indices;
+		FrameEncoder encoder(options, [&](uint64_t frameIndex, const std::vector<uint8_t>&) {
+			gate.Wait();
+			indices.push_back(frameIndex);
+		});
+
+		Frame frame = MakeFrame(16, 8, false, 0);
+		std::atomic<int> submittedCount(0);
+		std::thread submitter([&]() {
+			for (int i = 0; i < 4; ++i)
+			{
+				encoder.Submit(frame.pixels.data(), frame.width, frame.height, frame.rowPitch, frame.bgra);
+				++submittedCount;
+			}
+		});
+		// 输出被阻塞期间第3次提交不能返回
+		std::this_thread::sleep_for(std::chrono::milliseconds(50));
+		Check(submittedCount == 2, test, "Submit did not block while the queue was full");
+		gate.Open();
+		submitter.join();
+		encoder.Flush();
+
+		FrameEncoder::Statistics stats = encoder.GetStatistics();
+		Check(stats.submittedFrames == 4 && stats.encodedFrames == 4 && stats.droppedFrames == 0, test, "counters are wrong");
+		Check(indices == std::vector<uint64_t>({ 0, 1, 2, 3 }), test, "frames were output out of order");
+		printf("%-28s ok\n", test);
+	}
+
+	std::vector<uint8_t> ReadFile(const fs::path& path)
+	{
+		MappedFile file;
+		if (!file.Open(path.wstring().c_str()))
+			return std::vector<uint8_t>();
+		return std::vector<uint8_t>(file.GetData(), file.GetData() + file.GetSize());
+	}
+
+	// PNG每帧一个文件，YUV420依次追加到同一个文件
+	void TestFileSink()
+	{
+		const char* test = "File sink";
+		fs::path directory = fs::temp_directory_path() /
+			("FrameEncoderTest_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+		std::error_code error;
+		fs::create_directories(directory, error);
+
+		std::vector<Frame> frames;
+		for (uint32_t i = 0; i < 3; ++i)
+			frames.push_back(MakeFrame(32, 16, true, i));
+		for (FrameEncoder::Format format : { FrameEncoder::Format::Png, FrameEncoder::Format::Yuv420 })
+		{
+			FrameEncoder::Options options = FrameEncoder::GetDefaultOptions();
+			options.format = format;
+			options.policy = FrameEncoder::Policy::Block;
+			std::wstring path = (directory / "capture").wstring();
+			FrameEncoder encoder(options, FrameEncoder::CreateFileSink(path, format));
+			for (const auto& frame : frames)
+				encoder.Submit(frame.pixels.data(), frame.width, frame.height, frame.rowPitch, frame.bgra);
+			encoder.Flush();
+		}
+
+		for (size_t i = 0; i < frames.size(); ++i)
+		{
+			std::vector<uint8_t> png = ReadFile(directory / ("capture_00000" + std::to_string(i) + ".png"));
+			Check(CheckPng(frames[i], png), test, "PNG file is missing or wrong");
+		}
+		std::vector<uint8_t> yuv = ReadFile(directory / "capture.yuv");
+		size_t frameSize = 32 * 16 * 3 / 2;
+		Check(yuv.size() == frameSize * frames.size(), test, "YUV420 file has the wrong size");
+		for (size_t i = 0; i < frames.size() && yuv.size() == frameSize * frames.size(); ++i)
+		{
+			std::vector<uint8_t> data(yuv.begin() + i * frameSize, yuv.begin() + (i + 1) * frameSize);
+			Check(CheckYuv420(frames[i], data), test, "YUV420 frame in the sequence is wrong");
+		}
+
+		fs::remove_all(directory, error);
+		printf("%-28s ok\n", test);
+	}
+}
+
+int main()
+{
+	TestYuvRange();
+	for (FrameEncoder::Format format : { FrameEncoder::Format::Png, FrameEncoder::Format::Dds, FrameEncoder::Format::Rgb,
+		FrameEncoder::Format::Yuv420 })
+	{
+		TestFormat(format, false, 1);
+		TestFormat(format, true, 3);
+	}
+	TestDrop();
+	TestBlock();
+	TestFileSink();
+
+	if (g_FailedCount > 0)
+	{
+		fprintf(stderr, "%d checks failed\n", g_FailedCount);
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}
@@ -0,0 +1,215 @@
+﻿//***************************************************************************************
+// IndexCompressionTest.cpp
+// Licensed under the MIT License.
+//
+// 索引压缩(见IndexCompression)的往返测试，只依赖IndexCompression，可在Linux上构建与运行
+// - 随机、单调递增、网格三角形列表以及每个差值都需要4字节的最坏情况下，编码后分别以16位与32位输出、
+//   SSSE3与标量解码，结果都与输入完全相同，且不写出indexCount之外的元素
+// - 16位与32位输入的编码结果相同，编码大小不超过GetEncodeBound，最坏情况下恰好等于它
+// - 截断的数据与不足的输出缓冲区都被拒绝
+// 压缩率与解码吞吐量见AssetTool的indices命令
+// 任何检查失败时返回1
+// Round-trip test for the delta + Stream VByte index codec, portable to Linux.
+//***************************************************************************************
+
+#include "../../IndexCompression.h"
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+	int g_FailedCount = 0;
+
+	void Check(bool condition, const std::string& test, const char* what)
+	{
+		if (!condition)
+		{
+			fprintf(stderr, "%s: %s\n", test.c_str(), what);
+			++g_FailedCount;
+		}
+	}
+
+	// 解码并与原索引比较，输出缓冲区多留一个哨兵元素检查越界写入
+	// 输入复制到恰好encodedSize字节的缓冲区，越界读取可以被AddressSanitizer发现
+	template<class IndexType>
+	bool DecodeMatches(bool simd, const std::vector<uint32_t>& indices, const std::vector<uint8_t>& encoded, size_t encodedSize)
+	{
+		const IndexType sentinel = static_cast<IndexType>(0xA5A5A5A5u);
+		std::vector<uint8_t> input(encoded.begin(), encoded.begin() + encodedSize);
+		std::vector<IndexType> decoded(indices.size() + 1, sentinel);
+		bool status = simd ? IndexCompression::Decode(decoded.data(), indices.size(), input.data(), input.size()) :
+			IndexCompression::DecodeScalar(decoded.data(), indices.size(), input.data(), input.size());
+		if (!status || decoded.back() != sentinel)
+			return false;
+		for (size_t i = 0; i < indices.size(); ++i)
+		{
+			if (decoded[i] != static_cast<IndexType>(indices[i]))
+				return false;
+		}
+		return true;
+	}
+
+	// 任一解码路径接受了截断的数据时返回false
+	template<class IndexType>
+	bool RejectsTruncated(size_t indexCount, const std::vector<uint8_t>& encoded, size_t truncatedSize)
+	{
+		std::vector<uint8_t> input(encoded.begin(), encoded.begin() + truncatedSize);
+		std::vector<IndexType> decoded(indexCount);
+		return !IndexCompression::Decode(decoded.data(), indexCount, input.data(), input.size()) &&
+			!IndexCompression::DecodeScalar(decoded.data(), indexCount, input.data(), input.size());
+	}
+
+	// 返回编码后的大小
+	size_t TestRoundTrip(const std::string& test, const std::vector<uint32_t>& indices)
+	{
+		bool fits16 = true;
+		for (uint32_t index : indices)
+			fits16 = fits16 && index <= 0xffff;
+
+		size_t bound = IndexCompression::GetEncodeBound(indices.size());
+		// 多留16字节的空间，检查数据之后有多余的字节时同样正确解码
+		std::vector<uint8_t> encoded(bound + 16, 0xCD);
+		size_t encodedSize = IndexCompression::Encode(encoded.data(), bound, indices.data(), indices.size());
+		Check(encodedSize > 0 || indices.empty(), test, "Encode failed with a buffer of GetEncodeBound bytes");
+		Check(encodedSize <= bound, test, "encoded size exceeds GetEncodeBound");
+
+		if (fits16)
+		{
+			std::vector<uint16_t> indices16(indices.begin(), indices.end());
+			std::vector<uint8_t> encoded16(bound);
+			size_t encodedSize16 = IndexCompression::Encode(encoded16.data(), bound, indices16.data(), indices16.size());
+			Check(encodedSize16 == encodedSize && std::equal(encoded16.begin(), encoded16.begin() + encodedSize16, encoded.begin()), test,
+				"16-bit and 32-bit input encode differently");
+		}
+
+		for (bool simd : { true, false })
+		{
+			const char* path = simd ? "SIMD" : "scalar";
+			Check(DecodeMatches<uint32_t>(simd, indices, encoded, encodedSize), test + " " + path, "32-bit output differs from the input");
+			Check(DecodeMatches<uint32_t>(simd, indices, encoded, encoded.size()), test + " " + path, "trailing bytes break decoding");
+			if (fits16)
+				Check(DecodeMatches<uint16_t>(simd, indices, encoded, encodedSize), test + " " + path, "16-bit output differs from the input");
+		}
+
+		// 截断: 较短的数据逐字节检查，较长的只检查末尾、控制字节边界与开头附近
+		std::vector<size_t> truncatedSizes;
+		if (encodedSize <= 512)
+		{
+			for (size_t size = 0; size < encodedSize; ++size)
+				truncatedSizes.push_back(size);
+		}
+		else
+		{
+			size_t controlSize = (indices.size() + 3) / 4;
+			truncatedSizes = { 0, 1, controlSize - 1, controlSize, controlSize + 1, encodedSize / 2,
+				encodedSize - 17, encodedSize - 16, encodedSize - 15, encodedSize - 2, encodedSize - 1 };
+		}
+		bool rejected = true;
+		for (size_t size : truncatedSizes)
+			rejected = rejected && RejectsTruncated<uint32_t>(indices.size(), encoded, size) &&
+				(!fits16 || RejectsTruncated<uint16_t>(indices.size(), encoded, size));
+		Check(rejected, test, "truncated data was accepted");
+
+		// 输出缓冲区不足
+		if (encodedSize > 0)
+		{
+			std::vector<uint8_t> small(encodedSize - 1);
+			Check(IndexCompression::Encode(small.data(), small.size(), indices.data(), indices.size()) == 0, test,
+				"Encode did not fail with a buffer one byte too small");
+		}
+		return encodedSize;
+	}
+
+	std::vector<uint32_t> MakeGrid(uint32_t width, uint32_t height)
+	{
+		std::vector<uint32_t> indices;
+		for (uint32_t y = 0; y < height; ++y)
+		{
+			for (uint32_t x = 0; x < width; ++x)
+			{
+				uint32_t i0 = y * (width + 1) + x, i1 = i0 + 1, i2 = i0 + width + 1, i3 = i2 + 1;
+				indices.insert(indices.end(), { i0, i2, i1, i1, i2, i3 });
+			}
+		}
+		return indices;
+	}
+
+	void TestPatterns()
+	{
+		std::mt19937 rng(30);
+
+		// 各种长度检查SSSE3的4个一组与标量处理的尾部
+		for (size_t count = 0; count <= 41; ++count)
+		{
+			std::vector<uint32_t> indices(count);
+			for (auto& index : indices)
+				index = static_cast<uint32_t>(rng() % 300);
+			TestRoundTrip("length " + std::to_string(count), indices);
+		}
+
+		std::vector<uint32_t> random16(100003), random32(100003);
+		for (size_t i = 0; i < random16.size(); ++i)
+		{
+			random16[i] = static_cast<uint32_t>(rng() & 0xffff);
+			random32[i] = static_cast<uint32_t>(rng());
+		}
+		TestRoundTrip("random 16-bit", random16);
+		TestRoundTrip("random 32-bit", random32);
+
+		// 单调递增: 差值为1时每个索引1字节，跨越16位与24位的边界
+		std::vector<uint32_t> monotone(70000), strided(70000);
+		for (uint32_t i = 0; i < monotone.size(); ++i)
+		{
+			monotone[i] = i;
+			strided[i] = i * 251;
+		}
+		size_t monotoneSize = TestRoundTrip("monotone", monotone);
+		Check(monotoneSize == (monotone.size() + 3) / 4 + monotone.size(), "monotone", "unit deltas do not take one byte each");
+		TestRoundTrip("monotone strided", strided);
+		std::vector<uint32_t> descending(monotone.rbegin(), monotone.rend());
+		TestRoundTrip("descending", descending);
+
+		std::vector<uint32_t> grid = MakeGrid(255, 255);
+		TestRoundTrip("grid", grid);
+		std::vector<uint32_t> bigGrid = MakeGrid(1024, 300);
+		TestRoundTrip("grid 32-bit", bigGrid);
+
+		// 最坏情况: 差值交替为INT32_MIN与INT32_MAX附近的值，ZigZag后都需要4字节
+		std::vector<uint32_t> worst(4099);
+		for (size_t i = 0; i < worst.size(); ++i)
+			worst[i] = (i % 4 == 0) ? 0x80000000u : (i % 4 == 2) ? 0x7fffffffu : 0u;
+		size_t worstSize = TestRoundTrip("worst-case deltas", worst);
+		Check(worstSize == IndexCompression::GetEncodeBound(worst.size()), "worst-case deltas", "4-byte deltas do not reach GetEncodeBound");
+
+		// 相同的值、全部字节数的混合
+		std::vector<uint32_t> constant(1000, 0xfffeu);
+		TestRoundTrip("constant", constant);
+		std::vector<uint32_t> mixed;
+		const uint32_t magnitudes[] = { 0x7fu, 0x7fffu, 0x7fffffu, 0x7fffffffu };
+		uint32_t prev = 0x40000000u;
+		for (int i = 0; i < 20000; ++i)
+		{
+			uint32_t delta = static_cast<uint32_t>(rng()) % magnitudes[rng() % 4];
+			prev += (rng() & 1) ? delta : 0u - delta;
+			mixed.push_back(prev);
+		}
+		TestRoundTrip("mixed byte counts", mixed);
+		printf("%-28s ok\n", "Index round trips");
+	}
+}
+
+int main()
+{
+	TestPatterns();
+
+	if (g_FailedCount > 0)
+	{
+		fprintf(stderr, "%d checks failed\n", g_FailedCount);
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}
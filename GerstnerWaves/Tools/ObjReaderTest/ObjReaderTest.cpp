@@ -0,0 +1,405 @@
+﻿//***************************************************************************************
+// ObjReaderTest.cpp
+// Licensed under the MIT License.
+//
+// .obj烘焙为.mbo的测试，在临时目录中生成多个Part、多种材质的.obj与.mtl。ObjReader依赖DirectXMath与Win32，只在Windows上构建
+// - 内存路径(ReadObj、PrepareForCook后WriteMbo)与流式路径(CookStreaming)的.mbo逐字节相同，
+//   流式路径分别使用默认的内存预算与每个缓存只能容纳一页的预算，后者读取顶点属性时必然淘汰页
+// - 量化与不量化顶点两种格式，Read的烘焙结果与内存路径相同，没有三角形的组不写入.mbo
+// - 烘焙后顶点按簇划分后的索引的首次使用顺序排列，LOD的索引仍然有效
+// - 版本1的.mbo读取时补全簇与LOD，重新写出为当前版本
+// - 成功与失败(面引用了不存在的顶点、不支持的多边形)时.pos/.tex/.normal/.face.tmp临时文件都被删除，失败时不保留.mbo
+// 任何检查失败时返回1
+// Checks that the streaming and in-memory .obj cook paths write identical .mbo files.
+//***************************************************************************************
+
+#include "../../ObjReader.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+	namespace fs = std::filesystem;
+
+	int g_FailedCount = 0;
+
+	void Check(bool condition, const std::string& test, const char* what)
+	{
+		if (!condition)
+		{
+			fprintf(stderr, "%s: %s\n", test.c_str(), what);
+			++g_FailedCount;
+		}
+	}
+
+	// 测试结束时删除的临时目录
+	class TestDirectory
+	{
+	public:
+		TestDirectory()
+		{
+			m_Directory = fs::temp_directory_path() /
+				("ObjReaderTest_" + std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()));
+			std::error_code error;
+			fs::create_directories(m_Directory, error);
+		}
+
+		~TestDirectory()
+		{
+			std::error_code error;
+			fs::remove_all(m_Directory, error);
+		}
+
+		std::wstring GetPath(const std::string& name) const { return (m_Directory / name).wstring(); }
+
+	private:
+		fs::path m_Directory;
+	};
+
+	struct Grid
+	{
+		int width, height;		// 四边形数目
+		const char* name;
+		const char* material;	// 为空时使用默认材质
+		bool byColumn;			// 按列输出三角形，相邻的面引用相距较远的顶点
+	};
+
+	// 网格的顶点属性全部写在所有面之前，面按grids的逆序输出，使各Part引用的顶点分散在临时文件的不同页中
+	// 开头是没有三角形的组(与Maya导出的default组相同)，中间再插入一个空的组
+	std::string MakeObj(const std::vector<Grid>& grids)
+	{
+		std::string obj = "# ObjReaderTest\nmtllib test.mtl\ng default\n";
+		std::vector<int> firstVertices;
+		int vertexCount = 0;
+		char line[128];
+		for (size_t g = 0; g < grids.size(); ++g)
+		{
+			firstVertices.push_back(vertexCount + 1);
+			for (int y = 0; y <= grids[g].height; ++y)
+			{
+				for (int x = 0; x <= grids[g].width; ++x)
+				{
+					float u = static_cast<float>(x) / grids[g].width, v = static_cast<float>(y) / grids[g].height;
+					// 起伏的曲面，法线各不相同，纹理坐标超出[0, 1]
+					float h = 0.25f * sinf(u * 6.0f + static_cast<float>(g)) * cosf(v * 5.0f);
+					snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", u * 4.0f + g * 5.0f, h, v * 3.0f);
+					obj += line;
+					snprintf(line, sizeof(line), "vt %.6f %.6f\n", u * 2.0f, v * 3.0f - 1.0f);
+					obj += line;
+					snprintf(line, sizeof(line), "vn %.6f %.6f %.6f\n", -h, 1.0f, 0.5f * h);
+					obj += line;
+					++vertexCount;
+				}
+			}
+		}
+
+		for (size_t g = grids.size(); g-- > 0;)
+		{
+			const Grid& grid = grids[g];
+			obj += std::string("o ") + grid.name + "\n";
+			if (grid.material)
+				obj += std::string("usemtl ") + grid.material + "\n";
+			int rows = grid.byColumn ? grid.width : grid.height;
+			int columns = grid.byColumn ? grid.height : grid.width;
+			for (int i = 0; i < rows; ++i)
+			{
+				for (int j = 0; j < columns; ++j)
+				{
+					int x = grid.byColumn ? i : j, y = grid.byColumn ? j : i;
+					int i0 = firstVertices[g] + y * (grid.width + 1) + x, i1 = i0 + 1, i2 = i0 + grid.width + 1, i3 = i2 + 1;
+					snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d\n", i0, i0, i0, i1, i1, i1, i2, i2, i2);
+					obj += line;
+					snprintf(line, sizeof(line), "f %d/%d/%d %d/%d/%d %d/%d/%d\n", i1, i1, i1, i3, i3, i3, i2, i2, i2);
+					obj += line;
+				}
+			}
+			if (g == grids.size() / 2)
+				obj += "g empty\n";
+		}
+		return obj;
+	}
+
+	const char kMtl[] =
+		"newmtl stone\n"
+		"Ka 0.2 0.2 0.2\nKd 0.6 0.55 0.5\nKs 0.1 0.1 0.1\nNs 8\n"
+		"map_Kd stone.dds\n"
+		"newmtl leaf\n"
+		"Ka 0.1 0.3 0.1\nKd 0.2 0.7 0.2\nKs 0.4 0.4 0.4\nNs 32\nd 0.8\n";
+
+	void WriteText(const std::wstring& fileName, const std::string& text)
+	{
+		std::ofstream fout(fs::path(fileName), std::ios::out | std::ios::binary);
+		fout << text;
+	}
+
+	std::vector<char> ReadBytes(const std::wstring& fileName)
+	{
+		std::ifstream fin(fs::path(fileName), std::ios::in | std::ios::binary);
+		return std::vector<char>(std::istreambuf_iterator<char>(fin), std::istreambuf_iterator<char>());
+	}
+
+	bool Exists(const std::wstring& fileName)
+	{
+		std::error_code error;
+		return fs::exists(fs::path(fileName), error);
+	}
+
+	// 流式导入溢出的临时文件都已删除
+	bool SpillFilesRemoved(const std::wstring& mboFileName)
+	{
+		for (const wchar_t* suffix : { L".pos.tmp", L".tex.tmp", L".normal.tmp", L".face.tmp" })
+		{
+			if (Exists(mboFileName + suffix))
+				return false;
+		}
+		return true;
+	}
+
+	void TestCookPaths()
+	{
+		const char* test = "Cook paths";
+		TestDirectory directory;
+		// 第二个网格超过一页(4096个元素)的顶点，且按列输出三角形
+		std::vector<Grid> grids = {
+			{ 24, 20, "rock", "stone", false },
+			{ 70, 64, "bush", "leaf", true },
+			{ 16, 40, "plain", nullptr, false },
+		};
+		std::wstring objFileName = directory.GetPath("test.obj");
+		WriteText(objFileName, MakeObj(grids));
+		WriteText(directory.GetPath("test.mtl"), kMtl);
+
+		for (bool compressVertices : { true, false })
+		{
+			std::string suffix = compressVertices ? "quantized" : "float";
+			std::wstring memoryMbo = directory.GetPath("memory_" + suffix + ".mbo");
+			ObjReader memory;
+			Check(memory.ReadObj(objFileName.c_str()), test, "ReadObj failed");
+			Check(memory.objParts.size() == grids.size(), test, "groups without faces were kept");
+			memory.PrepareForCook(memoryMbo.c_str(), 0);
+			Check(memory.WriteMbo(memoryMbo.c_str(), compressVertices), test, "WriteMbo failed");
+			std::vector<char> expected = ReadBytes(memoryMbo);
+			Check(!expected.empty(), test, "the in-memory path wrote no .mbo");
+
+			// 默认预算下不淘汰页，1字节的预算下每个缓存只有一页
+			for (size_t budget : { static_cast<size_t>(256 * 1024 * 1024), static_cast<size_t>(1) })
+			{
+				std::string name = suffix + (budget == 1 ? " tiny budget" : " default budget");
+				std::wstring streamingMbo = directory.GetPath("streaming.mbo");
+				ObjReader streaming;
+				ObjReader::StreamingReport report = {};
+				Check(streaming.CookStreaming(streamingMbo.c_str(), objFileName.c_str(), budget, compressVertices, &report),
+					test, "CookStreaming failed");
+				Check(ReadBytes(streamingMbo) == expected, name, "the streamed .mbo differs from the in-memory path");
+				Check(report.partCount == grids.size(), name, "groups without faces were streamed");
+				Check(streaming.objParts.empty(), name, "objParts is not empty after CookStreaming");
+				Check(SpillFilesRemoved(streamingMbo), name, "spill files left after a successful cook");
+				if (budget == 1)
+				{
+					size_t pageBytes = 4096 * (sizeof(DirectX::XMFLOAT3) * 2 + sizeof(DirectX::XMFLOAT2) + sizeof(DWORD) * 9);
+					Check(report.peakCacheBytes <= pageBytes, name, "caches grew beyond one page each");
+				}
+
+				// 读回后各Part的材质保持.obj中的顺序
+				ObjReader reader;
+				Check(reader.ReadMbo(streamingMbo.c_str()) && reader.objParts.size() == grids.size(), name, "ReadMbo failed");
+				if (reader.objParts.size() == grids.size())
+				{
+					Check(reader.objParts[0].texStrDiffuse.empty() && reader.objParts[0].material.diffuse.x == 0.8f, name,
+						"the last grid lost the default material");
+					Check(reader.objParts[1].texStrDiffuse.empty() && reader.objParts[1].material.diffuse.w == 0.8f, name,
+						"the leaf material was not applied");
+					Check(reader.objParts[2].texStrDiffuse == directory.GetPath("stone.dds"), name,
+						"the stone texture was not applied");
+					for (const auto& part : reader.objParts)
+						Check(!part.vertices.empty() && !part.clusters.empty(), name, "a part has no vertices or clusters");
+				}
+			}
+		}
+
+		// Read在没有.mbo时与内存路径相同
+		std::wstring readMbo = directory.GetPath("read.mbo");
+		ObjReader reader;
+		Check(reader.Read(readMbo.c_str(), objFileName.c_str()), test, "Read failed");
+		Check(ReadBytes(readMbo) == ReadBytes(directory.GetPath("memory_quantized.mbo")), test,
+			"Read cooked a different .mbo");
+		printf("%-28s ok\n", test);
+	}
+
+	template<class IndexType>
+	bool IsFirstUseOrder(const std::vector<IndexType>& indices, size_t vertexCount)
+	{
+		size_t nextVertex = 0;
+		std::vector<bool> used(vertexCount);
+		for (IndexType index : indices)
+		{
+			if (index >= vertexCount)
+				return false;
+			if (!used[index])
+			{
+				if (index != nextVertex)
+					return false;
+				used[index] = true;
+				++nextVertex;
+			}
+		}
+		return true;
+	}
+
+	template<class IndexType>
+	bool IndicesInRange(const std::vector<IndexType>& indices, size_t vertexCount)
+	{
+		return std::all_of(indices.begin(), indices.end(), [vertexCount](IndexType index) { return index < vertexCount; });
+	}
+
+	// 烘焙后顶点按最终(簇划分后)三角形顺序的首次使用顺序排列，LOD的索引仍然有效
+	void TestFetchOrder()
+	{
+		const char* test = "Fetch order";
+		TestDirectory directory;
+		std::wstring objFileName = directory.GetPath("test.obj");
+		WriteText(objFileName, MakeObj({ { 90, 80, "terrain", "stone", false }, { 30, 12, "strip", nullptr, true } }));
+		WriteText(directory.GetPath("test.mtl"), kMtl);
+
+		ObjReader reader;
+		Check(reader.ReadObj(objFileName.c_str()), test, "ReadObj failed");
+		reader.PrepareForCook(directory.GetPath("test.mbo").c_str(), 0);
+		for (const auto& part : reader.objParts)
+		{
+			size_t vertexCount = part.vertices.size();
+			Check(part.clusters.size() > 1 && !part.lods.empty(), test, "no clusters or LODs were built");
+			Check(IsFirstUseOrder(part.indices16, vertexCount) && IsFirstUseOrder(part.indices32, vertexCount), test,
+				"vertices are not in first-use order of the cooked indices");
+			for (const auto& lod : part.lods)
+				Check(IndicesInRange(lod.indices16, vertexCount) && IndicesInRange(lod.indices32, vertexCount), test,
+					"a LOD references a missing vertex");
+		}
+		printf("%-28s ok\n", test);
+	}
+
+	// 写出没有文件标识与版本号的版本1文件(仓库中的Model/*.mbo即为该格式)，顶点与索引未经优化，没有LOD与簇
+	void WriteLegacyMbo(const std::wstring& fileName, const ObjReader& reader)
+	{
+		std::ofstream fout(fs::path(fileName), std::ios::out | std::ios::binary);
+		UINT parts = static_cast<UINT>(reader.objParts.size());
+		fout.write(reinterpret_cast<const char*>(&parts), sizeof(UINT));
+		fout.write(reinterpret_cast<const char*>(&reader.vMax), sizeof(DirectX::XMFLOAT3));
+		fout.write(reinterpret_cast<const char*>(&reader.vMin), sizeof(DirectX::XMFLOAT3));
+		for (const auto& part : reader.objParts)
+		{
+			wchar_t filePath[MAX_PATH] = {};
+			part.texStrDiffuse.copy(filePath, MAX_PATH - 1);
+			fout.write(reinterpret_cast<const char*>(filePath), sizeof(filePath));
+			fout.write(reinterpret_cast<const char*>(&part.material), sizeof(Material));
+			UINT vertexCount = static_cast<UINT>(part.vertices.size());
+			UINT indexCount = static_cast<UINT>(part.indices16.size() + part.indices32.size());
+			fout.write(reinterpret_cast<const char*>(&vertexCount), sizeof(UINT));
+			fout.write(reinterpret_cast<const char*>(&indexCount), sizeof(UINT));
+			fout.write(reinterpret_cast<const char*>(part.vertices.data()), vertexCount * sizeof(VertexPosNormalTex));
+			if (!part.indices32.empty())
+				fout.write(reinterpret_cast<const char*>(part.indices32.data()), indexCount * sizeof(DWORD));
+			else
+				fout.write(reinterpret_cast<const char*>(part.indices16.data()), indexCount * sizeof(WORD));
+		}
+	}
+
+	// 旧版本的.mbo读取时补全簇与LOD，重新写出后为当前版本且内容不再变化
+	void TestLegacyUpgrade()
+	{
+		const char* test = "Legacy upgrade";
+		TestDirectory directory;
+		std::wstring objFileName = directory.GetPath("test.obj");
+		WriteText(objFileName, MakeObj({ { 60, 50, "terrain", "stone", false }, { 12, 10, "rock", nullptr, true } }));
+		WriteText(directory.GetPath("test.mtl"), kMtl);
+
+		ObjReader source;
+		Check(source.ReadObj(objFileName.c_str()), test, "ReadObj failed");
+		std::wstring legacyMbo = directory.GetPath("legacy.mbo");
+		WriteLegacyMbo(legacyMbo, source);
+		Check(ObjReader::GetMboVersion(legacyMbo.c_str()) == 1, test, "a headerless .mbo is not version 1");
+
+		ObjReader legacy;
+		Check(legacy.ReadMbo(legacyMbo.c_str()) && legacy.objParts.size() == source.objParts.size(), test, "ReadMbo failed");
+		for (const auto& part : legacy.objParts)
+		{
+			Check(!part.clusters.empty() && !part.lods.empty(), test, "clusters or LODs were not built on load");
+			Check(IsFirstUseOrder(part.indices16, part.vertices.size()) && IsFirstUseOrder(part.indices32, part.vertices.size()),
+				test, "the upgraded part is not in first-use order");
+		}
+
+		std::wstring upgradedMbo = directory.GetPath("upgraded.mbo");
+		Check(legacy.WriteMbo(upgradedMbo.c_str()), test, "WriteMbo failed");
+		Check(ObjReader::GetMboVersion(upgradedMbo.c_str()) == ObjReader::GetMboVersion(), test,
+			"the rewritten .mbo is not the current version");
+
+		// 当前版本读取时不再改动网格
+		ObjReader upgraded;
+		Check(upgraded.ReadMbo(upgradedMbo.c_str()) && upgraded.objParts.size() == legacy.objParts.size(), test,
+			"reading the upgraded .mbo failed");
+		for (size_t i = 0; i < upgraded.objParts.size() && i < legacy.objParts.size(); ++i)
+		{
+			const auto& lhs = upgraded.objParts[i];
+			const auto& rhs = legacy.objParts[i];
+			Check(lhs.indices16 == rhs.indices16 && lhs.indices32 == rhs.indices32 &&
+				lhs.clusters.size() == rhs.clusters.size() && lhs.lods.size() == rhs.lods.size(), test,
+				"the upgraded .mbo does not match the mesh upgraded on load");
+		}
+		Check(ObjReader::GetMboVersion(directory.GetPath("missing.mbo").c_str()) == 0, test, "a missing file has a version");
+		printf("%-28s ok\n", test);
+	}
+
+	void TestCookFailures()
+	{
+		const char* test = "Cook failures";
+		TestDirectory directory;
+		WriteText(directory.GetPath("test.mtl"), kMtl);
+		std::string obj = MakeObj({ { 70, 64, "bush", "leaf", true }, { 8, 8, "rock", "stone", false } });
+
+		// 最后一个Part的面引用了不存在的顶点，流式路径在第二遍中失败；多边形面在第一遍中失败
+		const std::pair<const char*, std::string> cases[] = {
+			{ "missing vertex", obj + "o broken\nf 1/1/1 2/2/2 99999/1/1\n" },
+			{ "missing normal", obj + "o broken\nf 1/1/1 2/2/99999 3/3/3\n" },
+			{ "quad face", obj + "o broken\nf 1/1/1 2/2/2 3/3/3 4/4/4\n" },
+		};
+		for (const auto& c : cases)
+		{
+			std::wstring objFileName = directory.GetPath("broken.obj");
+			std::wstring mboFileName = directory.GetPath("broken.mbo");
+			WriteText(objFileName, c.second);
+
+			ObjReader streaming;
+			Check(!streaming.CookStreaming(mboFileName.c_str(), objFileName.c_str(), 1), c.first, "CookStreaming succeeded");
+			Check(!Exists(mboFileName), c.first, "a partial .mbo was kept");
+			Check(SpillFilesRemoved(mboFileName), c.first, "spill files left after a failed cook");
+
+			ObjReader memory;
+			Check(!memory.Read(mboFileName.c_str(), objFileName.c_str()), c.first, "Read succeeded");
+			Check(!Exists(mboFileName), c.first, "Read wrote a .mbo");
+		}
+		printf("%-28s ok\n", test);
+	}
+}
+
+int main()
+{
+	TestCookPaths();
+	TestFetchOrder();
+	TestLegacyUpgrade();
+	TestCookFailures();
+
+	if (g_FailedCount > 0)
+	{
+		fprintf(stderr, "%d checks failed\n", g_FailedCount);
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}
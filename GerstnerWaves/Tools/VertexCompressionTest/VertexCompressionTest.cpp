@@ -0,0 +1,359 @@
+﻿//***************************************************************************************
+// VertexCompressionTest.cpp
+// Licensed under the MIT License.
+//
+// 顶点量化压缩(见VertexCompression)的往返测试，只依赖VertexCompression，可在Linux上构建与运行
+// - 遍历全部65536个半精度浮点数，检查HalfToFloat的值、FloatToHalf的往返以及相邻两数中点的舍入(到偶数)
+// - 检查随机与边界顶点(退化的AABB、正负坐标轴法线、[0, 1]之外的纹理坐标)编码、解码后的误差在量化精度之内
+// - 检查MeasureError对已知误差的统计
+// - 检查SSE2的Decode与DecodeScalar的结果逐位相同，包括随机的位模式与不是4的倍数的顶点数
+// 任何检查失败时返回1
+// Round-trip test for the vertex quantization codec, portable to Linux.
+//***************************************************************************************
+
+#include "../../VertexCompression.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+namespace
+{
+	using namespace VertexCompression;
+
+	int g_FailedCount = 0;
+
+	void Check(bool condition, const char* test, const char* what)
+	{
+		if (!condition)
+		{
+			fprintf(stderr, "%s: %s\n", test, what);
+			++g_FailedCount;
+		}
+	}
+
+	uint32_t FloatBits(float value)
+	{
+		uint32_t bits;
+		memcpy(&bits, &value, sizeof(float));
+		return bits;
+	}
+
+	// 按定义计算半精度浮点数的值
+	double ReferenceHalf(uint16_t h)
+	{
+		int exponent = (h >> 10) & 0x1f;
+		int mantissa = h & 0x3ff;
+		double sign = (h & 0x8000) ? -1.0 : 1.0;
+		if (exponent == 0)
+			return sign * ldexp(mantissa, -24);
+		if (exponent == 31)
+			return mantissa ? NAN : sign * INFINITY;
+		return sign * ldexp(mantissa + 1024, exponent - 25);
+	}
+
+	bool IsHalfNan(uint16_t h)
+	{
+		return (h & 0x7c00) == 0x7c00 && (h & 0x3ff) != 0;
+	}
+
+	void TestHalf()
+	{
+		const char* test = "Half float";
+		int valueErrors = 0, roundTripErrors = 0, roundingErrors = 0;
+		for (uint32_t i = 0; i < 65536; ++i)
+		{
+			uint16_t h = static_cast<uint16_t>(i);
+			float f = HalfToFloat(h);
+			double reference = ReferenceHalf(h);
+			if (IsHalfNan(h))
+			{
+				// NaN保留符号，转换回来为静默NaN
+				valueErrors += !std::isnan(f);
+				roundTripErrors += FloatToHalf(f) != ((h & 0x8000) | 0x7e00);
+				continue;
+			}
+			valueErrors += static_cast<double>(f) != reference || std::signbit(f) != ((h & 0x8000) != 0);
+			roundTripErrors += FloatToHalf(f) != h;
+
+			// 与下一个有限数的中点舍入到尾数为偶数的一个，中点两侧各偏移一个ulp时舍入到较近的一个
+			uint16_t next = static_cast<uint16_t>(h + 1);
+			if ((h & 0x7fff) >= 0x7bff)
+				continue;
+			float middle = static_cast<float>((reference + ReferenceHalf(next)) * 0.5);
+			uint16_t even = (h & 1) ? next : h;
+			roundingErrors += FloatToHalf(middle) != even;
+			roundingErrors += FloatToHalf(nextafterf(middle, 0.0f)) != h;
+			roundingErrors += FloatToHalf(nextafterf(middle, middle * 2.0f)) != next;
+		}
+		Check(valueErrors == 0, test, "HalfToFloat does not match the definition");
+		Check(roundTripErrors == 0, test, "FloatToHalf(HalfToFloat(h)) != h");
+		Check(roundingErrors == 0, test, "FloatToHalf does not round to nearest even");
+
+		// 溢出为无穷大，超出半精度范围的小数下溢为0
+		Check(FloatToHalf(65520.0f) == 0x7c00 && FloatToHalf(-1e10f) == 0xfc00, test, "overflow does not give infinity");
+		Check(FloatToHalf(65519.0f) == 0x7bff, test, "largest finite value is wrong");
+		Check(FloatToHalf(1e-10f) == 0 && FloatToHalf(-1e-10f) == 0x8000, test, "underflow does not give signed zero");
+		printf("%-28s ok\n", test);
+	}
+
+	FloatVertex MakeVertex(float px, float py, float pz, float nx, float ny, float nz, float u, float v)
+	{
+		FloatVertex vertex = { { px, py, pz }, { nx, ny, nz }, { u, v } };
+		return vertex;
+	}
+
+	void RandomUnit(std::mt19937& rng, float normal[3])
+	{
+		std::normal_distribution<float> gauss;
+		float length = 0.0f;
+		while (length < 1e-3f)
+		{
+			for (int k = 0; k < 3; ++k)
+				normal[k] = gauss(rng);
+			length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		}
+		for (int k = 0; k < 3; ++k)
+			normal[k] /= length;
+	}
+
+	// 编码后解码，检查误差在量化精度之内，并检查Decode与DecodeScalar一致
+	ErrorStatistics RoundTrip(const std::vector<FloatVertex>& vertices, const char* test, QuantizationParams* pParams = nullptr)
+	{
+		QuantizationParams params = ComputeQuantization(vertices.data(), vertices.size());
+		std::vector<PackedVertex> packed(vertices.size());
+		std::vector<FloatVertex> decoded(vertices.size()), decodedScalar(vertices.size());
+		Encode(packed.data(), vertices.data(), vertices.size(), params);
+		Decode(decoded.data(), packed.data(), packed.size(), params);
+		DecodeScalar(decodedScalar.data(), packed.data(), packed.size(), params);
+		Check(memcmp(decoded.data(), decodedScalar.data(), decoded.size() * sizeof(FloatVertex)) == 0, test,
+			"Decode and DecodeScalar differ");
+
+		// 位置的误差不超过半个量化步长(每个分量)加上AABB范围内单精度的舍入误差
+		float halfStep = 0.0f, extent = 0.0f;
+		for (int k = 0; k < 3; ++k)
+		{
+			halfStep += params.posScale[k] * params.posScale[k] * 0.25f;
+			extent = (std::max)({ extent, fabsf(params.posMin[k]), fabsf(params.posMin[k] + params.posScale[k] * 65535.0f) });
+		}
+		halfStep = sqrtf(halfStep) + extent * 1e-6f;
+		// 法线的夹角用双精度计算，MeasureError中单精度的acosf在夹角很小时只能分辨约0.03度
+		double maxNormalAngle = 0.0;
+		for (size_t i = 0; i < vertices.size(); ++i)
+		{
+			const FloatVertex& a = vertices[i];
+			const FloatVertex& b = decoded[i];
+			float dx = a.pos[0] - b.pos[0], dy = a.pos[1] - b.pos[1], dz = a.pos[2] - b.pos[2];
+			if (sqrtf(dx * dx + dy * dy + dz * dz) > halfStep)
+			{
+				Check(false, test, "position error exceeds half a quantization step");
+				break;
+			}
+			double cross[3] = {
+				static_cast<double>(a.normal[1]) * b.normal[2] - static_cast<double>(a.normal[2]) * b.normal[1],
+				static_cast<double>(a.normal[2]) * b.normal[0] - static_cast<double>(a.normal[0]) * b.normal[2],
+				static_cast<double>(a.normal[0]) * b.normal[1] - static_cast<double>(a.normal[1]) * b.normal[0] };
+			double dot = static_cast<double>(a.normal[0]) * b.normal[0] + static_cast<double>(a.normal[1]) * b.normal[1] +
+				static_cast<double>(a.normal[2]) * b.normal[2];
+			maxNormalAngle = (std::max)(maxNormalAngle, atan2(sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]), dot));
+			bool texExact = b.tex[0] == HalfToFloat(FloatToHalf(a.tex[0])) && b.tex[1] == HalfToFloat(FloatToHalf(a.tex[1]));
+			if (!texExact)
+			{
+				Check(false, test, "texture coordinates are not the nearest half floats");
+				break;
+			}
+		}
+		// 16位八面体编码在折叠处的最大误差约为0.0075度(3百万个随机方向的测量值)
+		Check(maxNormalAngle * 57.29577951308232 < 0.01, test, "normal error exceeds the octahedral quantization error");
+		if (pParams)
+			*pParams = params;
+		return MeasureError(vertices.data(), decoded.data(), vertices.size());
+	}
+
+	void TestRandomVertices()
+	{
+		const char* test = "Random vertices";
+		std::mt19937 rng(29);
+		std::uniform_real_distribution<float> posDist(-250.0f, 250.0f), texDist(0.0f, 1.0f);
+		// 4的倍数与不是4的倍数的顶点数都要检查SSE2与标量部分的衔接
+		for (size_t count : { 1, 3, 4, 5, 1000, 4099 })
+		{
+			std::vector<FloatVertex> vertices(count);
+			for (auto& vertex : vertices)
+			{
+				for (int k = 0; k < 3; ++k)
+					vertex.pos[k] = posDist(rng);
+				RandomUnit(rng, vertex.normal);
+				vertex.tex[0] = texDist(rng);
+				vertex.tex[1] = texDist(rng);
+			}
+			ErrorStatistics stats = RoundTrip(vertices, test);
+			// [0, 1]内半精度的误差不超过2^-12
+			Check(stats.maxNormalError < 0.05f, test, "normal error reported by MeasureError is too large");
+			Check(stats.maxTexError <= 1.0f / 4096.0f, test, "texture coordinate error is too large");
+		}
+		printf("%-28s ok\n", test);
+	}
+
+	void TestEdgeVertices()
+	{
+		const char* test = "Edge-case vertices";
+
+		// 所有顶点重合: 量化步长为0，解码后精确还原
+		std::vector<FloatVertex> point(7, MakeVertex(1.5f, -2.25f, 1000.0f, 0.0f, 1.0f, 0.0f, 0.5f, 0.5f));
+		QuantizationParams params;
+		ErrorStatistics stats = RoundTrip(point, test, &params);
+		Check(params.posScale[0] == 0.0f && params.posScale[1] == 0.0f && params.posScale[2] == 0.0f, test,
+			"degenerate AABB has a nonzero scale");
+		Check(stats.maxPosError == 0.0f, test, "degenerate AABB does not decode exactly");
+
+		// 平面(y方向退化)上的顶点，y精确还原
+		std::vector<FloatVertex> plane;
+		for (int i = 0; i < 9; ++i)
+			plane.push_back(MakeVertex(i * 0.37f, 3.0f, -i * 1.1f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f));
+		RoundTrip(plane, test, &params);
+		Check(params.posScale[1] == 0.0f, test, "flat axis has a nonzero scale");
+
+		// 正负坐标轴方向的法线精确还原
+		const float axes[6][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+		std::vector<FloatVertex> axisVertices;
+		for (const auto& axis : axes)
+			axisVertices.push_back(MakeVertex(axis[0], axis[1], axis[2], axis[0], axis[1], axis[2], 0.0f, 1.0f));
+		std::vector<PackedVertex> packed(axisVertices.size());
+		std::vector<FloatVertex> decoded(axisVertices.size());
+		params = ComputeQuantization(axisVertices.data(), axisVertices.size());
+		Encode(packed.data(), axisVertices.data(), axisVertices.size(), params);
+		Decode(decoded.data(), packed.data(), packed.size(), params);
+		for (size_t i = 0; i < axisVertices.size(); ++i)
+		{
+			bool exact = true;
+			for (int k = 0; k < 3; ++k)
+				exact = exact && decoded[i].normal[k] == axisVertices[i].normal[k];
+			Check(exact, test, "axis normal does not decode exactly");
+		}
+		stats = RoundTrip(axisVertices, test);
+		Check(stats.maxNormalError == 0.0f && stats.maxTexError == 0.0f, test, "axis vertices have an error");
+
+		// 八面体的折叠边上(z接近0)与z为负的法线
+		std::vector<FloatVertex> folded;
+		for (int i = 0; i < 64; ++i)
+		{
+			float angle = i * 0.0981747704f;
+			float z = (i % 3 - 1) * 1e-4f;
+			folded.push_back(MakeVertex(0.0f, 0.0f, 0.0f, cosf(angle), sinf(angle), z, 0.0f, 0.0f));
+			folded.push_back(MakeVertex(0.0f, 0.0f, 0.0f, cosf(angle) * 0.6f, sinf(angle) * 0.6f, -0.8f, 0.0f, 0.0f));
+		}
+		stats = RoundTrip(folded, test);
+		Check(stats.maxNormalError < 0.05f, test, "normal on the octahedral fold has a large error");
+
+		// [0, 1]之外的纹理坐标(重复纹理)，误差不超过半精度的相对舍入误差
+		const float uvs[] = { -3.75f, 17.5f, 1000.25f, -0.001f, 2.0f / 3.0f, 65504.0f, -65504.0f, 1e-6f };
+		std::vector<FloatVertex> tiled;
+		for (float u : uvs)
+			tiled.push_back(MakeVertex(u, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, u, -u));
+		std::vector<PackedVertex> tiledPacked(tiled.size());
+		std::vector<FloatVertex> tiledDecoded(tiled.size());
+		params = ComputeQuantization(tiled.data(), tiled.size());
+		Encode(tiledPacked.data(), tiled.data(), tiled.size(), params);
+		Decode(tiledDecoded.data(), tiledPacked.data(), tiledPacked.size(), params);
+		for (size_t i = 0; i < tiled.size(); ++i)
+		{
+			float u = tiled[i].tex[0];
+			float bound = (std::max)(fabsf(u) / 2048.0f, 1.0f / 16777216.0f);
+			Check(fabsf(tiledDecoded[i].tex[0] - u) <= bound && tiledDecoded[i].tex[1] == -tiledDecoded[i].tex[0], test,
+				"texture coordinate outside [0, 1] has a large error");
+		}
+		RoundTrip(tiled, test);
+
+		// 没有顶点
+		params = ComputeQuantization(nullptr, 0);
+		Check(params.posScale[0] == 0.0f && params.posMin[0] == 0.0f, test, "empty input has nonzero parameters");
+		printf("%-28s ok\n", test);
+	}
+
+	// MeasureError统计的是已知的偏移
+	void TestMeasureError()
+	{
+		const char* test = "MeasureError";
+		std::vector<FloatVertex> original = {
+			MakeVertex(0, 0, 0, 0, 0, 1, 0.0f, 0.0f),
+			MakeVertex(1, 1, 1, 0, 0, 2, 0.5f, 0.5f),	// 未归一化的法线按方向比较
+			MakeVertex(2, 2, 2, 0, 0, 0, 1.0f, 1.0f)	// 零长度法线不计入
+		};
+		std::vector<FloatVertex> decoded = {
+			MakeVertex(3, 4, 0, 0, 0, 1, 0.0f, 0.0f),
+			MakeVertex(1, 1, 1, 1, 0, 0, 0.5f, 0.25f),
+			MakeVertex(2, 2, 2, 0, 1, 0, 1.0f, 1.0f)
+		};
+		ErrorStatistics stats = MeasureError(original.data(), decoded.data(), original.size());
+		Check(fabsf(stats.maxPosError - 5.0f) < 1e-6f, test, "position error is wrong");
+		Check(fabsf(stats.maxNormalError - 90.0f) < 1e-3f, test, "normal error is wrong");
+		Check(stats.maxTexError == 0.25f, test, "texture coordinate error is wrong");
+		stats = MeasureError(original.data(), original.data(), original.size());
+		Check(stats.maxPosError == 0.0f && stats.maxNormalError == 0.0f && stats.maxTexError == 0.0f, test, "identical input has an error");
+		printf("%-28s ok\n", test);
+	}
+
+	// 随机的位模式(包括NaN与无穷大的纹理坐标、任意的八面体坐标)下Decode与DecodeScalar逐位相同
+	void TestDecodeBitExact()
+	{
+		const char* test = "SIMD matches scalar";
+		std::mt19937 rng(30);
+		QuantizationParams params = { { -12.5f, 0.0f, 3.0f }, { 0.001f, 0.5f, 1e-7f } };
+		for (size_t count : { 0, 1, 2, 3, 4, 7, 8, 65537 })
+		{
+			std::vector<PackedVertex> packed(count);
+			for (auto& vertex : packed)
+			{
+				uint32_t words[4] = { static_cast<uint32_t>(rng()), static_cast<uint32_t>(rng()), static_cast<uint32_t>(rng()), static_cast<uint32_t>(rng()) };
+				memcpy(&vertex, words, sizeof(vertex));
+			}
+			std::vector<FloatVertex> decoded(count), decodedScalar(count);
+			Decode(decoded.data(), packed.data(), count, params);
+			DecodeScalar(decodedScalar.data(), packed.data(), count, params);
+			Check(count == 0 || memcmp(decoded.data(), decodedScalar.data(), count * sizeof(FloatVertex)) == 0, test,
+				"Decode and DecodeScalar differ");
+		}
+
+		// 八面体坐标的边界值与半精度的特殊值
+		const int16_t snorms[] = { 0, 1, -1, 32767, -32767, -32768, 16384, -16384 };
+		const uint16_t halves[] = { 0x0000, 0x8000, 0x0001, 0x03ff, 0x0400, 0x7bff, 0x7c00, 0xfc00, 0x7e00, 0x7c01, 0xffff };
+		std::vector<PackedVertex> special;
+		for (int16_t u : snorms)
+			for (int16_t v : snorms)
+				for (uint16_t h : halves)
+					special.push_back({ { 0, 65535, 32768, 0 }, { u, v }, { h, static_cast<uint16_t>(h ^ 0x8000) } });
+		std::vector<FloatVertex> decoded(special.size()), decodedScalar(special.size());
+		Decode(decoded.data(), special.data(), special.size(), params);
+		DecodeScalar(decodedScalar.data(), special.data(), special.size(), params);
+		size_t mismatches = 0;
+		for (size_t i = 0; i < special.size(); ++i)
+		{
+			const float* a = &decoded[i].pos[0];
+			const float* b = &decodedScalar[i].pos[0];
+			for (int k = 0; k < 8; ++k)
+				mismatches += FloatBits(a[k]) != FloatBits(b[k]);
+		}
+		Check(mismatches == 0, test, "Decode and DecodeScalar differ on special values");
+		printf("%-28s ok\n", test);
+	}
+}
+
+int main()
+{
+	TestHalf();
+	TestRandomVertices();
+	TestEdgeVertices();
+	TestMeasureError();
+	TestDecodeBitExact();
+
+	if (g_FailedCount > 0)
+	{
+		fprintf(stderr, "%d checks failed\n", g_FailedCount);
+		return 1;
+	}
+	printf("All checks passed\n");
+	return 0;
+}
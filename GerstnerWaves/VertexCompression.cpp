@@ -0,0 +1,315 @@
+﻿#include "VertexCompression.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define VERTEXCOMPRESSION_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+	uint32_t FloatAsUint(float value)
+	{
+		uint32_t result;
+		memcpy(&result, &value, sizeof(float));
+		return result;
+	}
+
+	float UintAsFloat(uint32_t value)
+	{
+		float result;
+		memcpy(&result, &value, sizeof(float));
+		return result;
+	}
+
+	float DecodeSnorm16(int16_t value)
+	{
+		return (std::max)(static_cast<float>(value) * (1.0f / 32767.0f), -1.0f);
+	}
+
+	void DecodeOctahedral(int16_t u, int16_t v, float normal[3])
+	{
+		float x = DecodeSnorm16(u);
+		float y = DecodeSnorm16(v);
+		float z = 1.0f - fabsf(x) - fabsf(y);
+		// 下半球的点被折叠到了外侧的四个三角形中，需要展开
+		float t = (std::max)(-z, 0.0f);
+		x = x >= 0.0f ? x - t : x + t;
+		y = y >= 0.0f ? y - t : y + t;
+
+		float length = sqrtf(x * x + y * y + z * z);
+		normal[0] = x / length;
+		normal[1] = y / length;
+		normal[2] = z / length;
+	}
+
+	void EncodeOctahedral(const float normal[3], int16_t& outU, int16_t& outV)
+	{
+		float x = normal[0], y = normal[1], z = normal[2];
+		float l1 = fabsf(x) + fabsf(y) + fabsf(z);
+		if (l1 == 0.0f)
+		{
+			outU = outV = 0;
+			return;
+		}
+
+		float u = x / l1, v = y / l1;
+		if (z < 0.0f)
+		{
+			float fu = (1.0f - fabsf(v)) * (u >= 0.0f ? 1.0f : -1.0f);
+			float fv = (1.0f - fabsf(u)) * (v >= 0.0f ? 1.0f : -1.0f);
+			u = fu;
+			v = fv;
+		}
+
+		// 在相邻的四个量化值中选择解码后与原法线夹角最小的一个
+		float su = floorf(u * 32767.0f), sv = floorf(v * 32767.0f);
+		float bestDot = -FLT_MAX;
+		for (int i = 0; i < 4; ++i)
+		{
+			float cu = (std::min)((std::max)(su + (i & 1), -32767.0f), 32767.0f);
+			float cv = (std::min)((std::max)(sv + (i >> 1), -32767.0f), 32767.0f);
+			float decoded[3];
+			DecodeOctahedral(static_cast<int16_t>(cu), static_cast<int16_t>(cv), decoded);
+			float dot = decoded[0] * x + decoded[1] * y + decoded[2] * z;
+			if (dot > bestDot)
+			{
+				bestDot = dot;
+				outU = static_cast<int16_t>(cu);
+				outV = static_cast<int16_t>(cv);
+			}
+		}
+	}
+
+#ifdef VERTEXCOMPRESSION_SSE2
+	// 将每个32位通道低16位中的半精度浮点转换为单精度浮点
+	__m128 HalfToFloat4(__m128i h)
+	{
+		const __m128i maskNoSign = _mm_set1_epi32(0x7fff);
+		const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23));
+		const __m128i wasInfNan = _mm_set1_epi32(0x7bff);
+		const __m128 expInfNan = _mm_castsi128_ps(_mm_set1_epi32(255 << 23));
+
+		__m128i expMant = _mm_and_si128(maskNoSign, h);
+		__m128i justSign = _mm_xor_si128(h, expMant);
+		// 移位后乘以2^112即可完成指数偏移的调整，同时正确处理非规格化数
+		__m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(expMant, 13)), magic);
+		__m128i isInfNan = _mm_cmpgt_epi32(expMant, wasInfNan);
+		__m128 sign = _mm_castsi128_ps(_mm_slli_epi32(justSign, 16));
+		__m128 infNanExp = _mm_and_ps(_mm_castsi128_ps(isInfNan), expInfNan);
+		return _mm_or_ps(scaled, _mm_or_ps(sign, infNanExp));
+	}
+
+	// 对16位有符号数进行符号扩展后转为[-1, 1]的浮点数
+	__m128 Snorm16ToFloat4(__m128i value)
+	{
+		__m128 result = _mm_mul_ps(_mm_cvtepi32_ps(value), _mm_set1_ps(1.0f / 32767.0f));
+		return _mm_max_ps(result, _mm_set1_ps(-1.0f));
+	}
+
+	void DecodeSSE2(VertexCompression::FloatVertex* destination, const VertexCompression::PackedVertex* vertices,
+		size_t vertexCount, const VertexCompression::QuantizationParams& params)
+	{
+		const __m128i mask16 = _mm_set1_epi32(0xffff);
+		const __m128 signMask = _mm_set1_ps(-0.0f);
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 one = _mm_set1_ps(1.0f);
+		const __m128 minX = _mm_set1_ps(params.posMin[0]), minY = _mm_set1_ps(params.posMin[1]), minZ = _mm_set1_ps(params.posMin[2]);
+		const __m128 scaleX = _mm_set1_ps(params.posScale[0]), scaleY = _mm_set1_ps(params.posScale[1]), scaleZ = _mm_set1_ps(params.posScale[2]);
+
+		for (size_t i = 0; i < vertexCount; i += 4)
+		{
+			__m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(vertices + i));
+			__m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(vertices + i + 1));
+			__m128i v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(vertices + i + 2));
+			__m128i v3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(vertices + i + 3));
+
+			// 转置为SoA：每个寄存器存放4个顶点的同一个32位字
+			__m128i t0 = _mm_unpacklo_epi32(v0, v1);	// xy0 xy1 zw0 zw1
+			__m128i t1 = _mm_unpacklo_epi32(v2, v3);	// xy2 xy3 zw2 zw3
+			__m128i t2 = _mm_unpackhi_epi32(v0, v1);	// n0 n1 uv0 uv1
+			__m128i t3 = _mm_unpackhi_epi32(v2, v3);	// n2 n3 uv2 uv3
+			__m128i xy = _mm_unpacklo_epi64(t0, t1);
+			__m128i zw = _mm_unpackhi_epi64(t0, t1);
+			__m128i n = _mm_unpacklo_epi64(t2, t3);
+			__m128i uv = _mm_unpackhi_epi64(t2, t3);
+
+			// 位置
+			__m128 px = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(xy, mask16)), scaleX), minX);
+			__m128 py = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(xy, 16)), scaleY), minY);
+			__m128 pz = _mm_add_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(zw, mask16)), scaleZ), minZ);
+
+			// 八面体法线
+			__m128 nx = Snorm16ToFloat4(_mm_srai_epi32(_mm_slli_epi32(n, 16), 16));
+			__m128 ny = Snorm16ToFloat4(_mm_srai_epi32(n, 16));
+			__m128 nz = _mm_sub_ps(_mm_sub_ps(one, _mm_andnot_ps(signMask, nx)), _mm_andnot_ps(signMask, ny));
+			__m128 t = _mm_max_ps(_mm_sub_ps(zero, nz), zero);
+			nx = _mm_sub_ps(nx, _mm_or_ps(t, _mm_and_ps(nx, signMask)));
+			ny = _mm_sub_ps(ny, _mm_or_ps(t, _mm_and_ps(ny, signMask)));
+			__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz)));
+			nx = _mm_div_ps(nx, length);
+			ny = _mm_div_ps(ny, length);
+			nz = _mm_div_ps(nz, length);
+
+			// 纹理坐标
+			__m128 tu = HalfToFloat4(_mm_and_si128(uv, mask16));
+			__m128 tv = HalfToFloat4(_mm_srli_epi32(uv, 16));
+
+			// 转置回AoS并写出
+			_MM_TRANSPOSE4_PS(px, py, pz, nx);
+			_MM_TRANSPOSE4_PS(ny, nz, tu, tv);
+			float* out = reinterpret_cast<float*>(destination + i);
+			_mm_storeu_ps(out, px);
+			_mm_storeu_ps(out + 4, ny);
+			_mm_storeu_ps(out + 8, py);
+			_mm_storeu_ps(out + 12, nz);
+			_mm_storeu_ps(out + 16, pz);
+			_mm_storeu_ps(out + 20, tu);
+			_mm_storeu_ps(out + 24, nx);
+			_mm_storeu_ps(out + 28, tv);
+		}
+	}
+#endif
+}
+
+VertexCompression::QuantizationParams VertexCompression::ComputeQuantization(const FloatVertex* vertices, size_t vertexCount)
+{
+	float minV[3] = { FLT_MAX, FLT_MAX, FLT_MAX }, maxV[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		for (int k = 0; k < 3; ++k)
+		{
+			minV[k] = (std::min)(minV[k], vertices[i].pos[k]);
+			maxV[k] = (std::max)(maxV[k], vertices[i].pos[k]);
+		}
+	}
+
+	QuantizationParams params = {};
+	if (vertexCount == 0)
+		return params;
+
+	for (int k = 0; k < 3; ++k)
+	{
+		params.posMin[k] = minV[k];
+		params.posScale[k] = (maxV[k] - minV[k]) / 65535.0f;
+	}
+	return params;
+}
+
+void VertexCompression::Encode(PackedVertex* destination, const FloatVertex* vertices, size_t vertexCount, const QuantizationParams& params)
+{
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		const FloatVertex& src = vertices[i];
+		PackedVertex& dst = destination[i];
+
+		for (int k = 0; k < 3; ++k)
+		{
+			float q = params.posScale[k] > 0.0f ? (src.pos[k] - params.posMin[k]) / params.posScale[k] : 0.0f;
+			dst.pos[k] = static_cast<uint16_t>((std::min)((std::max)(q + 0.5f, 0.0f), 65535.0f));
+		}
+		dst.pos[3] = 0;
+
+		EncodeOctahedral(src.normal, dst.normal[0], dst.normal[1]);
+
+		dst.tex[0] = FloatToHalf(src.tex[0]);
+		dst.tex[1] = FloatToHalf(src.tex[1]);
+	}
+}
+
+void VertexCompression::Decode(FloatVertex* destination, const PackedVertex* vertices, size_t vertexCount, const QuantizationParams& params)
+{
+	size_t simdCount = 0;
+#ifdef VERTEXCOMPRESSION_SSE2
+	simdCount = vertexCount & ~static_cast<size_t>(3);
+	DecodeSSE2(destination, vertices, simdCount, params);
+#endif
+	DecodeScalar(destination + simdCount, vertices + simdCount, vertexCount - simdCount, params);
+}
+
+void VertexCompression::DecodeScalar(FloatVertex* destination, const PackedVertex* vertices, size_t vertexCount, const QuantizationParams& params)
+{
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		const PackedVertex& src = vertices[i];
+		FloatVertex& dst = destination[i];
+
+		for (int k = 0; k < 3; ++k)
+			dst.pos[k] = static_cast<float>(src.pos[k]) * params.posScale[k] + params.posMin[k];
+
+		DecodeOctahedral(src.normal[0], src.normal[1], dst.normal);
+
+		dst.tex[0] = HalfToFloat(src.tex[0]);
+		dst.tex[1] = HalfToFloat(src.tex[1]);
+	}
+}
+
+VertexCompression::ErrorStatistics VertexCompression::MeasureError(const FloatVertex* original, const FloatVertex* decoded, size_t vertexCount)
+{
+	ErrorStatistics stats = {};
+	for (size_t i = 0; i < vertexCount; ++i)
+	{
+		const FloatVertex& a = original[i];
+		const FloatVertex& b = decoded[i];
+
+		float dx = a.pos[0] - b.pos[0], dy = a.pos[1] - b.pos[1], dz = a.pos[2] - b.pos[2];
+		stats.maxPosError = (std::max)(stats.maxPosError, sqrtf(dx * dx + dy * dy + dz * dz));
+
+		float lengthA = sqrtf(a.normal[0] * a.normal[0] + a.normal[1] * a.normal[1] + a.normal[2] * a.normal[2]);
+		if (lengthA > 0.0f)
+		{
+			float dot = (a.normal[0] * b.normal[0] + a.normal[1] * b.normal[1] + a.normal[2] * b.normal[2]) / lengthA;
+			dot = (std::min)((std::max)(dot, -1.0f), 1.0f);
+			stats.maxNormalError = (std::max)(stats.maxNormalError, acosf(dot) * 57.2957795f);
+		}
+
+		stats.maxTexError = (std::max)(stats.maxTexError, fabsf(a.tex[0] - b.tex[0]));
+		stats.maxTexError = (std::max)(stats.maxTexError, fabsf(a.tex[1] - b.tex[1]));
+	}
+	return stats;
+}
+
+uint16_t VertexCompression::FloatToHalf(float value)
+{
+	// 舍入到最近的偶数
+	uint32_t f = FloatAsUint(value);
+	uint32_t sign = f & 0x80000000u;
+	f ^= sign;
+
+	uint16_t result;
+	if (f >= 0x47800000u)
+	{
+		// 溢出、无穷大或NaN
+		result = f > 0x7f800000u ? 0x7e00 : 0x7c00;
+	}
+	else if (f < 0x38800000u)
+	{
+		// 非规格化数或0：借助浮点加法完成舍入
+		const float denormMagic = UintAsFloat(((127 - 15) + (23 - 10) + 1) << 23);
+		float sum = UintAsFloat(f) + denormMagic;
+		result = static_cast<uint16_t>(FloatAsUint(sum) - FloatAsUint(denormMagic));
+	}
+	else
+	{
+		uint32_t mantissaOdd = (f >> 13) & 1;
+		f += (static_cast<uint32_t>(15 - 127) << 23) + 0xfff;
+		f += mantissaOdd;
+		result = static_cast<uint16_t>(f >> 13);
+	}
+
+	return static_cast<uint16_t>(result | (sign >> 16));
+}
+
+float VertexCompression::HalfToFloat(uint16_t value)
+{
+	uint32_t expMant = value & 0x7fffu;
+	uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+	float scaled = UintAsFloat(expMant << 13) * UintAsFloat((254 - 15) << 23);
+	uint32_t result = FloatAsUint(scaled) | sign;
+	if (expMant > 0x7bffu)
+		result |= 255u << 23;
+	return UintAsFloat(result);
+}
@@ -0,0 +1,75 @@
+﻿//***************************************************************************************
+// VertexCompression.h
+// Licensed under the MIT License.
+//
+// 烘焙模型使用的顶点量化压缩：位置按Part的AABB量化为16位，法线使用2x16位八面体编码，
+// 纹理坐标使用半精度浮点，每个顶点从32字节压缩到16字节。解码使用SSE2批量进行
+// Quantized vertex compression for cooked models: positions quantized to 16 bits
+// relative to the part AABB, 2x16-bit octahedral normals and half-float UVs,
+// 32 bytes down to 16 bytes per vertex. Decoding is batched with SSE2.
+//***************************************************************************************
+
+#ifndef VERTEXCOMPRESSION_H
+#define VERTEXCOMPRESSION_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace VertexCompression
+{
+	// 未压缩顶点的布局，与VertexPosNormalTex一致
+	struct FloatVertex
+	{
+		float pos[3];
+		float normal[3];
+		float tex[2];
+	};
+
+	// 压缩后的顶点，会被直接写入.mbo文件
+	struct PackedVertex
+	{
+		uint16_t pos[4];		// 相对AABB的16位定点数，pos[3]未使用
+		int16_t normal[2];		// 八面体编码的法线(snorm16)
+		uint16_t tex[2];		// 半精度浮点纹理坐标
+	};
+
+	// 位置的反量化参数：pos = posMin + q * posScale
+	struct QuantizationParams
+	{
+		float posMin[3];
+		float posScale[3];
+	};
+
+	// 各属性的最大误差
+	struct ErrorStatistics
+	{
+		float maxPosError;		// 模型空间下的最大距离
+		float maxNormalError;	// 最大夹角(度)
+		float maxTexError;		// 纹理坐标各分量的最大差值
+	};
+
+	static_assert(sizeof(FloatVertex) == 32, "The size of FloatVertex must be 32 bytes!");
+	static_assert(sizeof(PackedVertex) == 16, "The layout of PackedVertex is stored in .mbo files!");
+	static_assert(sizeof(QuantizationParams) == 24, "The layout of QuantizationParams is stored in .mbo files!");
+
+	// 根据顶点位置计算量化参数
+	QuantizationParams ComputeQuantization(const FloatVertex* vertices, size_t vertexCount);
+
+	// 压缩顶点
+	void Encode(PackedVertex* destination, const FloatVertex* vertices, size_t vertexCount, const QuantizationParams& params);
+
+	// 解码顶点，可用时使用SSE2每次处理4个顶点
+	void Decode(FloatVertex* destination, const PackedVertex* vertices, size_t vertexCount, const QuantizationParams& params);
+
+	// 逐顶点的标量解码，结果与Decode一致，用于验证
+	void DecodeScalar(FloatVertex* destination, const PackedVertex* vertices, size_t vertexCount, const QuantizationParams& params);
+
+	// 统计原始顶点与解码后顶点之间的误差
+	ErrorStatistics MeasureError(const FloatVertex* original, const FloatVertex* decoded, size_t vertexCount);
+
+	// 半精度浮点转换
+	uint16_t FloatToHalf(float value);
+	float HalfToFloat(uint16_t value);
+}
+
+#endif
@@ -25,6 +25,7 @@
 // For now, we just load the first frame (note: DirectXTex supports multi-frame images)
 
 #include "WICTextureLoader.h"
+#include "PixelConvert.h"
 
 #include <dxgiformat.h>
 #include <assert.h>
@@ -293,6 +294,82 @@ namespace
     }
 
 
+    //---------------------------------------------------------------------------------
+    // Converts 24bpp RGB/BGR and 32bpp BGRA sources to 32bpp RGBA with the SIMD kernels
+    // in PixelConvert instead of a WIC format converter, a band of rows at a time.
+    // Returns S_FALSE if the conversion is not handled here.
+    HRESULT CopyPixelsWithKernels(
+        _In_ IWICBitmapSource* source,
+        _In_ const WICPixelFormatGUID& sourceFormat,
+        _In_ const WICPixelFormatGUID& targetFormat,
+        _In_ UINT width,
+        _In_ UINT height,
+        _In_ size_t rowPitch,
+        _Out_writes_bytes_(rowPitch * height) uint8_t* pixels)
+    {
+        if (memcmp(&targetFormat, &GUID_WICPixelFormat32bppRGBA, sizeof(GUID)) != 0)
+            return S_FALSE;
+
+        size_t sourceBytes;
+        bool swapRedBlue;
+        if (memcmp(&sourceFormat, &GUID_WICPixelFormat24bppRGB, sizeof(GUID)) == 0)
+        {
+            sourceBytes = 3;
+            swapRedBlue = false;
+        }
+        else if (memcmp(&sourceFormat, &GUID_WICPixelFormat24bppBGR, sizeof(GUID)) == 0)
+        {
+            sourceBytes = 3;
+            swapRedBlue = true;
+        }
+        else if (memcmp(&sourceFormat, &GUID_WICPixelFormat32bppBGRA, sizeof(GUID)) == 0)
+        {
+            sourceBytes = 4;
+            swapRedBlue = true;
+        }
+        else
+        {
+            return S_FALSE;
+        }
+
+        const UINT bandRows = 64;
+        size_t sourcePitch = size_t(width) * sourceBytes;
+        std::unique_ptr<uint8_t[]> band;
+        if (sourceBytes == 3)
+        {
+            band.reset(new (std::nothrow) uint8_t[sourcePitch * bandRows]);
+            if (!band)
+                return E_OUTOFMEMORY;
+        }
+
+        for (UINT y = 0; y < height; y += bandRows)
+        {
+            UINT rows = std::min<UINT>(bandRows, height - y);
+            WICRect rect = { 0, static_cast<INT>(y), static_cast<INT>(width), static_cast<INT>(rows) };
+            uint8_t* dest = pixels + size_t(y) * rowPitch;
+            if (sourceBytes == 4)
+            {
+                // Same size as the destination, swizzle in place
+                HRESULT hr = source->CopyPixels(&rect, static_cast<UINT>(rowPitch), static_cast<UINT>(rowPitch * rows), dest);
+                if (FAILED(hr))
+                    return hr;
+                for (UINT row = 0; row < rows; ++row)
+                    PixelConvert::SwapRedBlue(dest + row * rowPitch, dest + row * rowPitch, width);
+            }
+            else
+            {
+                HRESULT hr = source->CopyPixels(&rect, static_cast<UINT>(sourcePitch), static_cast<UINT>(sourcePitch * rows), band.get());
+                if (FAILED(hr))
+                    return hr;
+                for (UINT row = 0; row < rows; ++row)
+                    PixelConvert::RgbToRgba(band.get() + row * sourcePitch, dest + row * rowPitch, width, swapRedBlue);
+            }
+        }
+
+        return S_OK;
+    }
+
+
     //---------------------------------------------------------------------------------
     HRESULT CreateTextureFromWIC(_In_ ID3D11Device* d3dDevice,
         _In_opt_ ID3D11DeviceContext* d3dContext,
@@ -546,6 +623,11 @@ namespace
                 if (FAILED(hr))
                     return hr;
             }
+            else if ((hr = CopyPixelsWithKernels(scaler.Get(), pfScaler, convertGUID, twidth, theight, rowPitch, temp.get())) != S_FALSE)
+            {
+                if (FAILED(hr))
+                    return hr;
+            }
             else
             {
                 ComPtr<IWICFormatConverter> FC;
@@ -569,6 +651,12 @@ namespace
                     return hr;
             }
         }
+        else if ((hr = CopyPixelsWithKernels(frame, pixelFormat, convertGUID, width, height, rowPitch, temp.get())) != S_FALSE)
+        {
+            // Format conversion with PixelConvert
+            if (FAILED(hr))
+                return hr;
+        }
         else
         {
             // Format conversion but no resize
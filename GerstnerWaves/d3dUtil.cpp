@@ -1,4 +1,13 @@
 ﻿#include "d3dUtil.h"
+#include "AssetPackage.h"
+#include "CubeMapLayout.h"
+#include "ImageReader.h"
+#include "MappedFile.h"
+#include "MipGenerator.h"
+#include "ResourceCache.h"
+#include "TextureBudget.h"
+#include "ThreadPool.h"
+#include <algorithm>
 
 using namespace DirectX;
 
@@ -44,6 +53,16 @@ HRESULT CreateShaderFromFile(
 {
 	HRESULT hr = S_OK;
 
+	// 优先从挂载的资源包中读取编译好的着色器
+	AssetView view;
+	std::vector<uint8_t> buffer;
+	if (csoFileNameInOut && AssetPackage::FindMounted(csoFileNameInOut, view, buffer) &&
+		SUCCEEDED(D3DCreateBlob(view.size, ppBlobOut)))
+	{
+		memcpy((*ppBlobOut)->GetBufferPointer(), view.data, view.size);
+		return hr;
+	}
+
 	// 寻找是否有已经编译好的顶点着色器
 	if (csoFileNameInOut && D3DReadFileToBlob(csoFileNameInOut, ppBlobOut) == S_OK)
 	{
@@ -83,6 +102,416 @@ HRESULT CreateShaderFromFile(
 	return hr;
 }
 
+//
+// 纹理相关函数
+//
+
+static bool IsDDSFileName(const wchar_t * fileName)
+{
+	size_t length = wcslen(fileName);
+	return length > 4 && _wcsicmp(fileName + length - 4, L".dds") == 0;
+}
+
+// 把ImageReader解码出的RGBA8图像创建为只有一级mip的纹理，与WICTextureLoader不生成mip时的结果一致
+static HRESULT CreateTextureFromImage(
+	ID3D11Device * d3dDevice,
+	ImageReader & reader,
+	ID3D11ShaderResourceView ** textureView)
+{
+	UINT width = reader.GetWidth();
+	UINT height = reader.GetHeight();
+	std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+	if (!reader.Decode(pixels.data(), width * 4))
+		return HRESULT_FROM_WIN32(ERROR_INVALID_DATA);
+
+	DXGI_FORMAT format = reader.IsSrgb() ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+	D3D11_TEXTURE2D_DESC texDesc;
+	texDesc.Width = width;
+	texDesc.Height = height;
+	texDesc.MipLevels = 1;
+	texDesc.ArraySize = 1;
+	texDesc.Format = format;
+	texDesc.SampleDesc.Count = 1;
+	texDesc.SampleDesc.Quality = 0;
+	texDesc.Usage = D3D11_USAGE_DEFAULT;
+	texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	texDesc.CPUAccessFlags = 0;
+	texDesc.MiscFlags = 0;
+
+	D3D11_SUBRESOURCE_DATA initData;
+	initData.pSysMem = pixels.data();
+	initData.SysMemPitch = width * 4;
+	initData.SysMemSlicePitch = 0;
+
+	ID3D11Texture2D * pTexture = nullptr;
+	HRESULT hr = d3dDevice->CreateTexture2D(&texDesc, &initData, &pTexture);
+	if (FAILED(hr))
+		return hr;
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+	ZeroMemory(&srvDesc, sizeof(srvDesc));
+	srvDesc.Format = format;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+	srvDesc.Texture2D.MipLevels = 1;
+	hr = d3dDevice->CreateShaderResourceView(pTexture, &srvDesc, textureView);
+	pTexture->Release();
+	return hr;
+}
+
+HRESULT CreateTextureFromFile(
+	ID3D11Device * d3dDevice,
+	const wchar_t * fileName,
+	ID3D11ShaderResourceView ** textureView)
+{
+	AssetView view;
+	std::vector<uint8_t> buffer;
+	if (!IsDDSFileName(fileName))
+	{
+		// 烘焙(AssetTool cook)把PNG等图像编码为同名的块压缩DDS，存在时优先使用
+		std::wstring ddsFileName = fileName;
+		size_t dotPos = ddsFileName.find_last_of(L'.');
+		if (dotPos != std::wstring::npos && ddsFileName.find_first_of(L"\\/", dotPos) == std::wstring::npos)
+		{
+			ddsFileName.replace(dotPos, std::wstring::npos, L".dds");
+			if (AssetPackage::FindMounted(ddsFileName.c_str(), view, buffer) ||
+				GetFileAttributesW(ddsFileName.c_str()) != INVALID_FILE_ATTRIBUTES)
+				return CreateTextureFromFile(d3dDevice, ddsFileName.c_str(), textureView);
+		}
+	}
+
+	if (AssetPackage::FindMounted(fileName, view, buffer))
+		return CreateTextureFromMemory(d3dDevice, fileName, view.data, view.size, textureView);
+
+	if (IsDDSFileName(fileName))
+	{
+		// 映射文件后原地解析，子资源数据从映射内存直接上传
+		MappedFile file;
+		DdsReader reader;
+		if (file.Open(fileName) && reader.Parse(file.GetData(), file.GetSize()))
+			return CreateTextureFromDds(d3dDevice, reader, textureView, TextureBudget::GetDefault().Register(fileName, reader));
+		return CreateDDSTextureFromFile(d3dDevice, fileName, nullptr, textureView);
+	}
+	else
+	{
+		// 同样映射文件，TGA、BMP与PNG由ImageReader直接解码
+		MappedFile file;
+		if (file.Open(fileName))
+			return CreateTextureFromMemory(d3dDevice, fileName, file.GetData(), file.GetSize(), textureView);
+		return CreateWICTextureFromFile(d3dDevice, fileName, nullptr, textureView);
+	}
+}
+
+HRESULT CreateTextureFromMemory(
+	ID3D11Device * d3dDevice,
+	const wchar_t * fileName,
+	const uint8_t * data,
+	size_t size,
+	ID3D11ShaderResourceView ** textureView)
+{
+	if (IsDDSFileName(fileName))
+	{
+		DdsReader reader;
+		if (reader.Parse(data, size))
+			return CreateTextureFromDds(d3dDevice, reader, textureView, TextureBudget::GetDefault().Register(fileName, reader));
+		// 解析失败时交给DDSTextureLoader处理，由它给出具体的错误
+		return CreateDDSTextureFromMemory(d3dDevice, data, size, nullptr, textureView);
+	}
+	else
+	{
+		// 其他格式或解码失败时交给WIC处理
+		ImageReader reader;
+		if (reader.Parse(data, size) && SUCCEEDED(CreateTextureFromImage(d3dDevice, reader, textureView)))
+			return S_OK;
+		return CreateWICTextureFromMemory(d3dDevice, data, size, nullptr, textureView);
+	}
+}
+
+// 创建从第skipMips级开始的纹理与视图，initData为nullptr时不提供初始数据
+static HRESULT CreateDdsTextureResource(
+	ID3D11Device * d3dDevice,
+	const DdsReader & reader,
+	UINT skipMips,
+	const D3D11_SUBRESOURCE_DATA * initData,
+	ID3D11ShaderResourceView ** textureView)
+{
+	UINT mipCount = reader.GetMipCount() - skipMips;
+	UINT arraySize = reader.GetArraySize();
+	const DdsReader::Subresource& top = reader.GetSubresource(0, skipMips);
+	DXGI_FORMAT format = static_cast<DXGI_FORMAT>(reader.GetFormat());
+
+	HRESULT hr = S_OK;
+	ID3D11Resource * pResource = nullptr;
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+	ZeroMemory(&srvDesc, sizeof(srvDesc));
+	srvDesc.Format = format;
+
+	switch (reader.GetDimension())
+	{
+	case DdsReader::Dimension::Texture1D:
+	{
+		D3D11_TEXTURE1D_DESC texDesc;
+		texDesc.Width = top.width;
+		texDesc.MipLevels = mipCount;
+		texDesc.ArraySize = arraySize;
+		texDesc.Format = format;
+		texDesc.Usage = D3D11_USAGE_DEFAULT;
+		texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		texDesc.CPUAccessFlags = 0;
+		texDesc.MiscFlags = 0;
+		ID3D11Texture1D * pTexture = nullptr;
+		hr = d3dDevice->CreateTexture1D(&texDesc, initData, &pTexture);
+		pResource = pTexture;
+
+		if (arraySize > 1)
+		{
+			srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE1DARRAY;
+			srvDesc.Texture1DArray.MipLevels = mipCount;
+			srvDesc.Texture1DArray.ArraySize = arraySize;
+		}
+		else
+		{
+			srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE1D;
+			srvDesc.Texture1D.MipLevels = mipCount;
+		}
+		break;
+	}
+
+	case DdsReader::Dimension::Texture2D:
+	{
+		D3D11_TEXTURE2D_DESC texDesc;
+		texDesc.Width = top.width;
+		texDesc.Height = top.height;
+		texDesc.MipLevels = mipCount;
+		texDesc.ArraySize = arraySize;
+		texDesc.Format = format;
+		texDesc.SampleDesc.Count = 1;
+		texDesc.SampleDesc.Quality = 0;
+		texDesc.Usage = D3D11_USAGE_DEFAULT;
+		texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		texDesc.CPUAccessFlags = 0;
+		texDesc.MiscFlags = reader.IsCubeMap() ? D3D11_RESOURCE_MISC_TEXTURECUBE : 0;
+		ID3D11Texture2D * pTexture = nullptr;
+		hr = d3dDevice->CreateTexture2D(&texDesc, initData, &pTexture);
+		pResource = pTexture;
+
+		if (reader.IsCubeMap())
+		{
+			if (arraySize > 6)
+			{
+				srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBEARRAY;
+				srvDesc.TextureCubeArray.MipLevels = mipCount;
+				srvDesc.TextureCubeArray.NumCubes = arraySize / 6;
+			}
+			else
+			{
+				srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+				srvDesc.TextureCube.MipLevels = mipCount;
+			}
+		}
+		else if (arraySize > 1)
+		{
+			srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+			srvDesc.Texture2DArray.MipLevels = mipCount;
+			srvDesc.Texture2DArray.ArraySize = arraySize;
+		}
+		else
+		{
+			srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+			srvDesc.Texture2D.MipLevels = mipCount;
+		}
+		break;
+	}
+
+	case DdsReader::Dimension::Texture3D:
+	{
+		D3D11_TEXTURE3D_DESC texDesc;
+		texDesc.Width = top.width;
+		texDesc.Height = top.height;
+		texDesc.Depth = top.depth;
+		texDesc.MipLevels = mipCount;
+		texDesc.Format = format;
+		texDesc.Usage = D3D11_USAGE_DEFAULT;
+		texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+		texDesc.CPUAccessFlags = 0;
+		texDesc.MiscFlags = 0;
+		ID3D11Texture3D * pTexture = nullptr;
+		hr = d3dDevice->CreateTexture3D(&texDesc, initData, &pTexture);
+		pResource = pTexture;
+
+		srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE3D;
+		srvDesc.Texture3D.MipLevels = mipCount;
+		break;
+	}
+
+	default:
+		return E_INVALIDARG;
+	}
+
+	if (FAILED(hr))
+		return hr;
+
+	hr = d3dDevice->CreateShaderResourceView(pResource, &srvDesc, textureView);
+	pResource->Release();
+	return hr;
+}
+
+HRESULT CreateTextureFromDds(
+	ID3D11Device * d3dDevice,
+	const DdsReader & reader,
+	ID3D11ShaderResourceView ** textureView,
+	UINT skipMips)
+{
+	if (!d3dDevice || !textureView || reader.GetSubresources().empty())
+		return E_INVALIDARG;
+	*textureView = nullptr;
+
+	// 跳过的mip不上传，纹理从第skipMips级开始
+	skipMips = (std::min)(skipMips, reader.GetMipCount() - 1);
+	UINT mipCount = reader.GetMipCount() - skipMips;
+	UINT arraySize = reader.GetArraySize();
+	std::vector<D3D11_SUBRESOURCE_DATA> initData(static_cast<size_t>(arraySize) * mipCount);
+	for (UINT item = 0; item < arraySize; ++item)
+	{
+		for (UINT mip = 0; mip < mipCount; ++mip)
+		{
+			const DdsReader::Subresource& subresource = reader.GetSubresource(item, skipMips + mip);
+			D3D11_SUBRESOURCE_DATA& data = initData[item * mipCount + mip];
+			data.pSysMem = subresource.data;
+			data.SysMemPitch = static_cast<UINT>(subresource.rowPitch);
+			data.SysMemSlicePitch = static_cast<UINT>(subresource.slicePitch);
+		}
+	}
+
+	return CreateDdsTextureResource(d3dDevice, reader, skipMips, initData.data(), textureView);
+}
+
+HRESULT CreateStreamingTextureFromDds(
+	ID3D11Device * d3dDevice,
+	ID3D11DeviceContext * deviceContext,
+	const DdsReader & reader,
+	UINT firstMip,
+	ID3D11ShaderResourceView ** textureView)
+{
+	if (!d3dDevice || !deviceContext || !textureView || reader.GetSubresources().empty())
+		return E_INVALIDARG;
+	*textureView = nullptr;
+
+	// 分配完整的mip链，只上传从firstMip开始的几级
+	HRESULT hr = CreateDdsTextureResource(d3dDevice, reader, 0, nullptr, textureView);
+	if (FAILED(hr))
+		return hr;
+
+	firstMip = (std::min)(firstMip, reader.GetMipCount() - 1);
+	for (UINT mip = reader.GetMipCount(); mip-- > firstMip;)
+		UpdateStreamingTextureMip(deviceContext, *textureView, reader, mip);
+	return S_OK;
+}
+
+void UpdateStreamingTextureMip(
+	ID3D11DeviceContext * deviceContext,
+	ID3D11ShaderResourceView * textureView,
+	const DdsReader & reader,
+	UINT mip)
+{
+	ID3D11Resource * pResource = nullptr;
+	textureView->GetResource(&pResource);
+	for (UINT item = 0; item < reader.GetArraySize(); ++item)
+	{
+		const DdsReader::Subresource& subresource = reader.GetSubresource(item, mip);
+		deviceContext->UpdateSubresource(pResource, D3D11CalcSubresource(mip, item, reader.GetMipCount()), nullptr,
+			subresource.data, static_cast<UINT>(subresource.rowPitch), static_cast<UINT>(subresource.slicePitch));
+	}
+	// 采样不会访问比mip更大的、尚未上传的级别
+	deviceContext->SetResourceMinLOD(pResource, static_cast<FLOAT>(mip));
+	pResource->Release();
+}
+
+// 估算纹理占用的显存，用于资源缓存的预算
+static size_t GetTextureByteSize(ID3D11ShaderResourceView * textureView)
+{
+	ID3D11Resource * pResource = nullptr;
+	ID3D11Texture2D * pTexture = nullptr;
+	textureView->GetResource(&pResource);
+	HRESULT hr = pResource->QueryInterface(__uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&pTexture));
+	pResource->Release();
+	if (FAILED(hr))
+		return 0;
+
+	D3D11_TEXTURE2D_DESC texDesc;
+	pTexture->GetDesc(&texDesc);
+	pTexture->Release();
+
+	// 块压缩格式以4x4为单位，其余格式按常见的位数估算
+	size_t blockBytes = 0;
+	size_t pixelBits = 32;
+	switch (texDesc.Format)
+	{
+	case DXGI_FORMAT_BC1_TYPELESS: case DXGI_FORMAT_BC1_UNORM: case DXGI_FORMAT_BC1_UNORM_SRGB:
+	case DXGI_FORMAT_BC4_TYPELESS: case DXGI_FORMAT_BC4_UNORM: case DXGI_FORMAT_BC4_SNORM:
+		blockBytes = 8; break;
+	case DXGI_FORMAT_BC2_TYPELESS: case DXGI_FORMAT_BC2_UNORM: case DXGI_FORMAT_BC2_UNORM_SRGB:
+	case DXGI_FORMAT_BC3_TYPELESS: case DXGI_FORMAT_BC3_UNORM: case DXGI_FORMAT_BC3_UNORM_SRGB:
+	case DXGI_FORMAT_BC5_TYPELESS: case DXGI_FORMAT_BC5_UNORM: case DXGI_FORMAT_BC5_SNORM:
+	case DXGI_FORMAT_BC6H_TYPELESS: case DXGI_FORMAT_BC6H_UF16: case DXGI_FORMAT_BC6H_SF16:
+	case DXGI_FORMAT_BC7_TYPELESS: case DXGI_FORMAT_BC7_UNORM: case DXGI_FORMAT_BC7_UNORM_SRGB:
+		blockBytes = 16; break;
+	case DXGI_FORMAT_R32G32B32A32_FLOAT: pixelBits = 128; break;
+	case DXGI_FORMAT_R16G16B16A16_FLOAT: case DXGI_FORMAT_R16G16B16A16_UNORM: case DXGI_FORMAT_R32G32_FLOAT:
+		pixelBits = 64; break;
+	case DXGI_FORMAT_R8G8_UNORM: case DXGI_FORMAT_R16_FLOAT: case DXGI_FORMAT_R16_UNORM:
+		pixelBits = 16; break;
+	case DXGI_FORMAT_R8_UNORM: case DXGI_FORMAT_A8_UNORM:
+		pixelBits = 8; break;
+	default: break;
+	}
+
+	size_t byteSize = 0;
+	for (UINT i = 0; i < texDesc.MipLevels; ++i)
+	{
+		size_t width = (std::max)(texDesc.Width >> i, 1u);
+		size_t height = (std::max)(texDesc.Height >> i, 1u);
+		if (blockBytes)
+			byteSize += ((width + 3) / 4) * ((height + 3) / 4) * blockBytes;
+		else
+			byteSize += width * height * pixelBits / 8;
+	}
+	return byteSize * texDesc.ArraySize;
+}
+
+HRESULT CreateTextureFromCache(
+	ID3D11Device * d3dDevice,
+	const wchar_t * fileName,
+	ID3D11ShaderResourceView ** textureView,
+	std::shared_ptr<void>& reference,
+	const uint8_t * data,
+	size_t size)
+{
+	HRESULT hr = S_OK;
+	reference = ResourceCache::GetDefault().Acquire("texture", fileName, "", [&](size_t& byteSize) {
+		ID3D11ShaderResourceView * pTexture = nullptr;
+		if (data)
+			hr = CreateTextureFromMemory(d3dDevice, fileName, data, size, &pTexture);
+		else
+			hr = CreateTextureFromFile(d3dDevice, fileName, &pTexture);
+		if (FAILED(hr))
+			return std::shared_ptr<void>();
+		byteSize = GetTextureByteSize(pTexture);
+		// 缓存通过shared_ptr持有视图的一个COM引用，淘汰时同时从纹理预算中注销
+		std::wstring name = fileName;
+		return std::shared_ptr<void>(pTexture, [name](ID3D11ShaderResourceView * p) {
+			p->Release();
+			if (IsDDSFileName(name.c_str()))
+				TextureBudget::GetDefault().Unregister(name);
+		});
+	});
+	if (!reference)
+		return FAILED(hr) ? hr : E_FAIL;
+
+	*textureView = static_cast<ID3D11ShaderResourceView*>(reference.get());
+	(*textureView)->AddRef();
+	return S_OK;
+}
+
 //
 // 缓冲区相关函数
 //
@@ -384,164 +813,245 @@ HRESULT CreateRandomTexture1D(
 	return S_OK;
 }
 
-HRESULT CreateTexture2DArrayFromFile(
+// 读取纹理到CPU可读的暂存资源，先按DDS读取，失败时按WIC读取
+static HRESULT CreateStagingTextureFromFile(
 	ID3D11Device* d3dDevice,
-	ID3D11DeviceContext* d3dDeviceContext,
-	const std::vector<std::wstring>& fileNames,
-	ID3D11Texture2D** textureArray,
-	ID3D11ShaderResourceView** textureArrayView,
-	bool generateMips)
+	const std::wstring& fileName,
+	ID3D11Texture2D** texture)
 {
-	// 检查设备、文件名数组是否非空
-	if (!d3dDevice || fileNames.empty())
-		return E_INVALIDARG;
-
-	HRESULT hr;
-	UINT arraySize = (UINT)fileNames.size();
-
-	// ******************
-	// 读取第一个纹理
-	//
-	ID3D11Texture2D* pTexture;
-	D3D11_TEXTURE2D_DESC texDesc;
-
-	hr = CreateDDSTextureFromFileEx(d3dDevice,
-		fileNames[0].c_str(), 0, D3D11_USAGE_STAGING, 0,
+	HRESULT hr = CreateDDSTextureFromFileEx(d3dDevice,
+		fileName.c_str(), 0, D3D11_USAGE_STAGING, 0,
 		D3D11_CPU_ACCESS_WRITE | D3D11_CPU_ACCESS_READ,
-		0, false, reinterpret_cast<ID3D11Resource**>(&pTexture), nullptr);
+		0, false, reinterpret_cast<ID3D11Resource**>(texture), nullptr);
 	if (FAILED(hr))
 	{
 		hr = CreateWICTextureFromFileEx(d3dDevice,
-			fileNames[0].c_str(), 0, D3D11_USAGE_STAGING, 0,
+			fileName.c_str(), 0, D3D11_USAGE_STAGING, 0,
 			D3D11_CPU_ACCESS_WRITE | D3D11_CPU_ACCESS_READ,
-			0, false, reinterpret_cast<ID3D11Resource**>(&pTexture), nullptr);
+			0, WIC_LOADER_DEFAULT, reinterpret_cast<ID3D11Resource**>(texture), nullptr);
 	}
+	return hr;
+}
 
-	if (FAILED(hr))
-		return hr;
+// 8位RGBA/BGRA格式可以在CPU上生成mip(MipGenerator不区分通道顺序)
+static bool IsCpuMipFormat(DXGI_FORMAT format, bool& srgb)
+{
+	switch (format)
+	{
+	case DXGI_FORMAT_R8G8B8A8_UNORM:
+	case DXGI_FORMAT_B8G8R8A8_UNORM:
+	case DXGI_FORMAT_B8G8R8X8_UNORM:
+		srgb = false;
+		return true;
+	case DXGI_FORMAT_R8G8B8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8A8_UNORM_SRGB:
+	case DXGI_FORMAT_B8G8R8X8_UNORM_SRGB:
+		srgb = true;
+		return true;
+	default:
+		return false;
+	}
+}
 
-	// 读取创建好的纹理信息
-	pTexture->GetDesc(&texDesc);
+// 纹理数组的一个元素来自暂存纹理第0级中从(left, top)开始的区域
+struct StagingSlice
+{
+	ID3D11Texture2D* texture;
+	UINT left;
+	UINT top;
+};
+
+// 由暂存纹理创建纹理数组，每个元素的宽高为width x height
+// 源纹理本身带有mip时直接复制，否则generateMips为true时在CPU上生成mip，各元素并行生成且元素内按行并行
+// 代替GPU的GenerateMips，纹理不再需要D3D11_BIND_RENDER_TARGET与D3D11_RESOURCE_MISC_GENERATE_MIPS
+static HRESULT CreateTextureArrayFromStaging(
+	ID3D11Device* d3dDevice,
+	ID3D11DeviceContext* d3dDeviceContext,
+	const std::vector<StagingSlice>& slices,
+	UINT width,
+	UINT height,
+	bool generateMips,
+	ID3D11Texture2D** textureArray)
+{
+	D3D11_TEXTURE2D_DESC srcDesc;
+	slices[0].texture->GetDesc(&srcDesc);
+
+	bool srgb = false;
+	bool sourceMips = srcDesc.MipLevels > 1 && srcDesc.Width == width && srcDesc.Height == height;
+	bool cpuMips = generateMips && !sourceMips && IsCpuMipFormat(srcDesc.Format, srgb);
+	if (generateMips && !sourceMips && !cpuMips)
+		OutputDebugStringW(L"[d3dUtil] 纹理格式不是8位RGBA/BGRA，无法在CPU上生成mip，只使用第0级\n");
 
-	// ******************
-	// 创建纹理数组
-	//
 	D3D11_TEXTURE2D_DESC texArrayDesc;
-	texArrayDesc.Width = texDesc.Width;
-	texArrayDesc.Height = texDesc.Height;
-	texArrayDesc.MipLevels = generateMips ? 0 : texDesc.MipLevels;
-	texArrayDesc.ArraySize = arraySize;
-	texArrayDesc.Format = texDesc.Format;
+	texArrayDesc.Width = width;
+	texArrayDesc.Height = height;
+	texArrayDesc.MipLevels = sourceMips ? srcDesc.MipLevels : (cpuMips ? MipGenerator::GetMipCount(width, height) : 1);
+	texArrayDesc.ArraySize = (UINT)slices.size();
+	texArrayDesc.Format = srcDesc.Format;
 	texArrayDesc.SampleDesc.Count = 1;		// 不能使用多重采样
 	texArrayDesc.SampleDesc.Quality = 0;
 	texArrayDesc.Usage = D3D11_USAGE_DEFAULT;
-	texArrayDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE | (generateMips ? D3D11_BIND_RENDER_TARGET : 0);
+	texArrayDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
 	texArrayDesc.CPUAccessFlags = 0;
-	texArrayDesc.MiscFlags = (generateMips ? D3D11_RESOURCE_MISC_GENERATE_MIPS : 0);
+	texArrayDesc.MiscFlags = 0;
 
 	ID3D11Texture2D* pTexArray = nullptr;
-	hr = d3dDevice->CreateTexture2D(&texArrayDesc, nullptr, &pTexArray);
+	HRESULT hr = d3dDevice->CreateTexture2D(&texArrayDesc, nullptr, &pTexArray);
 	if (FAILED(hr))
-	{
-		SAFE_RELEASE(pTexture);
 		return hr;
-	}
 
-	// 获取实际创建的纹理数组信息
-	pTexArray->GetDesc(&texArrayDesc);
-	UINT updateMipLevels = generateMips ? 1 : texArrayDesc.MipLevels;
-
-	// 写入到纹理数组第一个元素
-	D3D11_MAPPED_SUBRESOURCE mappedTex2D;
-	for (UINT i = 0; i < updateMipLevels; ++i)
+	if (!cpuMips)
 	{
-		d3dDeviceContext->Map(pTexture, i, D3D11_MAP_READ, 0, &mappedTex2D);
-		d3dDeviceContext->UpdateSubresource(pTexArray, i, nullptr,
-			mappedTex2D.pData, mappedTex2D.RowPitch, mappedTex2D.DepthPitch);
-		d3dDeviceContext->Unmap(pTexture, i);
+		// 直接复制源纹理的子资源(或第0级中的区域)
+		for (UINT i = 0; i < texArrayDesc.ArraySize; ++i)
+		{
+			for (UINT j = 0; j < texArrayDesc.MipLevels; ++j)
+			{
+				D3D11_BOX box;
+				box.left = slices[i].left >> j;
+				box.top = slices[i].top >> j;
+				box.front = 0;
+				box.right = box.left + (std::max)(width >> j, 1u);
+				box.bottom = box.top + (std::max)(height >> j, 1u);
+				box.back = 1;
+				d3dDeviceContext->CopySubresourceRegion(pTexArray,
+					D3D11CalcSubresource(j, i, texArrayDesc.MipLevels),	// i * mipLevel + j
+					0, 0, 0, slices[i].texture, j, &box);
+			}
+		}
 	}
-	SAFE_RELEASE(pTexture);
-
-	// ******************
-	// 读取剩余的纹理并加载入纹理数组
-	//
-	D3D11_TEXTURE2D_DESC currTexDesc;
-	for (UINT i = 1; i < texArrayDesc.ArraySize; ++i)
+	else
 	{
-		hr = CreateDDSTextureFromFileEx(d3dDevice,
-			fileNames[0].c_str(), 0, D3D11_USAGE_STAGING, 0,
-			D3D11_CPU_ACCESS_WRITE | D3D11_CPU_ACCESS_READ,
-			0, false, reinterpret_cast<ID3D11Resource**>(&pTexture), nullptr);
-		if (FAILED(hr))
+		// 映射各元素所在纹理的第0级，多个元素可以来自同一纹理
+		std::vector<D3D11_MAPPED_SUBRESOURCE> mapped(slices.size());
+		std::vector<bool> owner(slices.size(), true);
+		for (size_t i = 0; i < slices.size(); ++i)
 		{
-			hr = CreateWICTextureFromFileEx(d3dDevice,
-				fileNames[0].c_str(), 0, D3D11_USAGE_STAGING, 0,
-				D3D11_CPU_ACCESS_WRITE | D3D11_CPU_ACCESS_READ,
-				0, WIC_LOADER_DEFAULT, reinterpret_cast<ID3D11Resource**>(&pTexture), nullptr);
+			for (size_t j = 0; j < i && owner[i]; ++j)
+			{
+				if (slices[j].texture == slices[i].texture)
+				{
+					mapped[i] = mapped[j];
+					owner[i] = false;
+				}
+			}
+			if (owner[i])
+				hr = d3dDeviceContext->Map(slices[i].texture, 0, D3D11_MAP_READ, 0, &mapped[i]);
+			if (FAILED(hr))
+			{
+				for (size_t j = 0; j < i; ++j)
+				{
+					if (owner[j])
+						d3dDeviceContext->Unmap(slices[j].texture, 0);
+				}
+				SAFE_RELEASE(pTexArray);
+				return hr;
+			}
 		}
 
-		if (FAILED(hr))
+		// 运行时使用最快的盒式滤波，与GPU的GenerateMips相当，需要更好的滤波时使用AssetTool烘焙
+		MipGenerator::Options options = MipGenerator::GetDefaultOptions();
+		options.filter = MipGenerator::Filter::Box;
+		options.srgb = srgb;
+		ThreadPool& pool = ThreadPool::GetDefault();
+		std::vector<std::vector<MipGenerator::Level>> levels(slices.size());
+		pool.ParallelFor(slices.size(), [&](size_t i) {
+			const uint8_t* pData = static_cast<const uint8_t*>(mapped[i].pData) +
+				(size_t)slices[i].top * mapped[i].RowPitch + (size_t)slices[i].left * 4;
+			MipGenerator::Generate(pData, width, height, mapped[i].RowPitch, options, levels[i],
+				texArrayDesc.MipLevels, &pool);
+		});
+
+		for (size_t i = 0; i < slices.size(); ++i)
 		{
-			SAFE_RELEASE(pTexArray);
-			return hr;
+			if (owner[i])
+				d3dDeviceContext->Unmap(slices[i].texture, 0);
+			for (UINT j = 0; j < texArrayDesc.MipLevels; ++j)
+			{
+				d3dDeviceContext->UpdateSubresource(pTexArray, D3D11CalcSubresource(j, (UINT)i, texArrayDesc.MipLevels),
+					nullptr, levels[i][j].data.data(), levels[i][j].width * 4, 0);
+			}
 		}
+	}
 
-		pTexture->GetDesc(&currTexDesc);
-		// 需要检验所有纹理的mipLevels，宽度和高度，数据格式是否一致，
-		// 若存在数据格式不一致的情况，请使用dxtex.exe(DirectX Texture Tool)
-		// 将所有的图片转成一致的数据格式
-		if (currTexDesc.MipLevels != texDesc.MipLevels || currTexDesc.Width != texDesc.Width ||
-			currTexDesc.Height != texDesc.Height || currTexDesc.Format != texDesc.Format)
+	*textureArray = pTexArray;
+	return S_OK;
+}
+
+HRESULT CreateTexture2DArrayFromFile(
+	ID3D11Device* d3dDevice,
+	ID3D11DeviceContext* d3dDeviceContext,
+	const std::vector<std::wstring>& fileNames,
+	ID3D11Texture2D** textureArray,
+	ID3D11ShaderResourceView** textureArrayView,
+	bool generateMips)
+{
+	// 检查设备、文件名数组是否非空
+	if (!d3dDevice || !d3dDeviceContext || fileNames.empty())
+		return E_INVALIDARG;
+
+	HRESULT hr;
+	UINT arraySize = (UINT)fileNames.size();
+
+	// ******************
+	// 读取所有纹理
+	//
+	std::vector<ID3D11Texture2D*> srcTexVec(arraySize, nullptr);
+	std::vector<StagingSlice> slices(arraySize);
+	D3D11_TEXTURE2D_DESC texDesc, currTexDesc;
+	for (UINT i = 0; i < arraySize; ++i)
+	{
+		hr = CreateStagingTextureFromFile(d3dDevice, fileNames[i], &srcTexVec[i]);
+		if (SUCCEEDED(hr))
 		{
-			SAFE_RELEASE(pTexArray);
-			SAFE_RELEASE(pTexture);
-			return E_FAIL;
+			srcTexVec[i]->GetDesc(i == 0 ? &texDesc : &currTexDesc);
+			// 需要检验所有纹理的mipLevels，宽度和高度，数据格式是否一致，
+			// 若存在数据格式不一致的情况，请使用dxtex.exe(DirectX Texture Tool)
+			// 将所有的图片转成一致的数据格式
+			if (i > 0 && (currTexDesc.MipLevels != texDesc.MipLevels || currTexDesc.Width != texDesc.Width ||
+				currTexDesc.Height != texDesc.Height || currTexDesc.Format != texDesc.Format))
+				hr = E_FAIL;
 		}
-		// 写入到纹理数组的对应元素
-		for (UINT j = 0; j < updateMipLevels; ++j)
+
+		if (FAILED(hr))
 		{
-			// 允许映射索引i纹理中，索引j的mipmap等级的2D纹理
-			d3dDeviceContext->Map(pTexture, j, D3D11_MAP_READ, 0, &mappedTex2D);
-			d3dDeviceContext->UpdateSubresource(pTexArray,
-				D3D11CalcSubresource(j, i, texArrayDesc.MipLevels),	// i * mipLevel + j
-				nullptr, mappedTex2D.pData, mappedTex2D.RowPitch, mappedTex2D.DepthPitch);
-			// 停止映射
-			d3dDeviceContext->Unmap(pTexture, j);
+			for (UINT j = 0; j <= i; ++j)
+				SAFE_RELEASE(srcTexVec[j]);
+			return hr;
 		}
-		SAFE_RELEASE(pTexture);
+		slices[i] = { srcTexVec[i], 0, 0 };
 	}
 
+	// ******************
+	// 创建纹理数组，必要时在CPU上生成mip
+	//
+	ID3D11Texture2D* pTexArray = nullptr;
+	hr = CreateTextureArrayFromStaging(d3dDevice, d3dDeviceContext, slices, texDesc.Width, texDesc.Height,
+		generateMips, &pTexArray);
+	for (UINT i = 0; i < arraySize; ++i)
+		SAFE_RELEASE(srcTexVec[i]);
+	if (FAILED(hr))
+		return hr;
+
 	// ******************
 	// 必要时创建纹理数组的SRV
 	//
-	if (generateMips || textureArrayView)
+	if (textureArrayView)
 	{
 		D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc;
-		viewDesc.Format = texArrayDesc.Format;
+		viewDesc.Format = texDesc.Format;
 		viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
 		viewDesc.Texture2DArray.MostDetailedMip = 0;
 		viewDesc.Texture2DArray.MipLevels = -1;
 		viewDesc.Texture2DArray.FirstArraySlice = 0;
 		viewDesc.Texture2DArray.ArraySize = arraySize;
 
-		ID3D11ShaderResourceView* pTexArraySRV;
-		hr = d3dDevice->CreateShaderResourceView(pTexArray, &viewDesc, &pTexArraySRV);
+		hr = d3dDevice->CreateShaderResourceView(pTexArray, &viewDesc, textureArrayView);
 		if (FAILED(hr))
 		{
 			SAFE_RELEASE(pTexArray);
 			return hr;
 		}
-
-		// 生成mipmaps
-		if (generateMips)
-		{
-			d3dDeviceContext->GenerateMips(pTexArraySRV);
-		}
-
-		if (textureArrayView)
-			*textureArrayView = pTexArraySRV;
-		else
-			SAFE_RELEASE(pTexArraySRV);
 	}
 
 	if (textureArray)
@@ -552,6 +1062,141 @@ HRESULT CreateTexture2DArrayFromFile(
 	return S_OK;
 }
 
+// CPU可以访问的8位RGBA/BGRA图像
+// TGA、BMP与PNG由ImageReader解码到内存，不需要设备；其他格式由WIC读取到暂存纹理后映射，直接访问映射的内存
+struct CpuImage
+{
+	CpuImage()
+		: data(), rowPitch(), width(), height(), format(DXGI_FORMAT_UNKNOWN), srgb(), pStaging(), pContext()
+	{
+	}
+
+	~CpuImage()
+	{
+		if (pStaging)
+		{
+			pContext->Unmap(pStaging, 0);
+			pStaging->Release();
+		}
+	}
+
+	CpuImage(const CpuImage&) = delete;
+	CpuImage& operator=(const CpuImage&) = delete;
+
+	// 由ImageReader解码，不访问设备，可以在工作线程中调用
+	bool Decode(const std::wstring& fileName)
+	{
+		MappedFile file;
+		ImageReader reader;
+		if (!file.Open(fileName.c_str()) || !reader.Parse(file.GetData(), file.GetSize()))
+			return false;
+		width = reader.GetWidth();
+		height = reader.GetHeight();
+		pixels.resize(static_cast<size_t>(width) * height * 4);
+		if (!reader.Decode(pixels.data(), width * 4))
+			return false;
+		data = pixels.data();
+		rowPitch = static_cast<size_t>(width) * 4;
+		srgb = reader.IsSrgb();
+		format = srgb ? DXGI_FORMAT_R8G8B8A8_UNORM_SRGB : DXGI_FORMAT_R8G8B8A8_UNORM;
+		return true;
+	}
+
+	// 经WIC读取到暂存纹理并映射第0级
+	HRESULT LoadStaging(ID3D11Device* d3dDevice, ID3D11DeviceContext* d3dDeviceContext, const std::wstring& fileName)
+	{
+		ID3D11Texture2D* pTexture = nullptr;
+		HRESULT hr = CreateWICTextureFromFileEx(d3dDevice,
+			fileName.c_str(), 0, D3D11_USAGE_STAGING, 0,
+			D3D11_CPU_ACCESS_WRITE | D3D11_CPU_ACCESS_READ,
+			0, WIC_LOADER_DEFAULT, reinterpret_cast<ID3D11Resource**>(&pTexture), nullptr);
+		if (FAILED(hr))
+			return hr;
+
+		D3D11_TEXTURE2D_DESC texDesc;
+		pTexture->GetDesc(&texDesc);
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		if (!IsCpuMipFormat(texDesc.Format, srgb))
+			hr = E_FAIL;
+		else
+			hr = d3dDeviceContext->Map(pTexture, 0, D3D11_MAP_READ, 0, &mapped);
+		if (FAILED(hr))
+		{
+			pTexture->Release();
+			return hr;
+		}
+
+		pStaging = pTexture;
+		pContext = d3dDeviceContext;
+		data = static_cast<const uint8_t*>(mapped.pData);
+		rowPitch = mapped.RowPitch;
+		width = texDesc.Width;
+		height = texDesc.Height;
+		format = texDesc.Format;
+		return S_OK;
+	}
+
+	const uint8_t* data;
+	size_t rowPitch;
+	UINT width;
+	UINT height;
+	DXGI_FORMAT format;
+	bool srgb;
+
+	std::vector<uint8_t> pixels;
+	ID3D11Texture2D* pStaging;
+	ID3D11DeviceContext* pContext;
+};
+
+// 由各面的视图创建立方体纹理(每6个面为一个立方体)，面的像素为format格式(8位RGBA/BGRA)
+// generateMips为true时各面并行在CPU上生成mip，第0级总是直接从面的视图上传，纹理连同所有mip一次创建
+static HRESULT CreateTextureCubeFromFaces(
+	ID3D11Device* d3dDevice,
+	const std::vector<CubeMapLayout::FaceView>& faces,
+	UINT faceSize,
+	DXGI_FORMAT format,
+	bool srgb,
+	bool generateMips,
+	ID3D11Texture2D** textureArray)
+{
+	UINT mipLevels = generateMips ? MipGenerator::GetMipCount(faceSize, faceSize) : 1;
+	std::vector<std::vector<MipGenerator::Level>> levels;
+	if (mipLevels > 1)
+	{
+		// 与CreateTextureArrayFromStaging一样使用最快的盒式滤波
+		MipGenerator::Options options = MipGenerator::GetDefaultOptions();
+		options.filter = MipGenerator::Filter::Box;
+		options.srgb = srgb;
+		CubeMapLayout::GenerateMips(faces.data(), faces.size(), faceSize, options, levels, mipLevels, &ThreadPool::GetDefault());
+	}
+
+	std::vector<D3D11_SUBRESOURCE_DATA> initData(faces.size() * mipLevels);
+	for (size_t i = 0; i < faces.size(); ++i)
+	{
+		for (UINT j = 0; j < mipLevels; ++j)
+		{
+			D3D11_SUBRESOURCE_DATA& subresource = initData[i * mipLevels + j];
+			subresource.pSysMem = j == 0 ? faces[i].data : levels[i][j].data.data();
+			subresource.SysMemPitch = j == 0 ? static_cast<UINT>(faces[i].rowPitch) : levels[i][j].width * 4;
+			subresource.SysMemSlicePitch = 0;
+		}
+	}
+
+	D3D11_TEXTURE2D_DESC texArrayDesc;
+	texArrayDesc.Width = faceSize;
+	texArrayDesc.Height = faceSize;
+	texArrayDesc.MipLevels = mipLevels;
+	texArrayDesc.ArraySize = static_cast<UINT>(faces.size());
+	texArrayDesc.Format = format;
+	texArrayDesc.SampleDesc.Count = 1;		// 不能使用多重采样
+	texArrayDesc.SampleDesc.Quality = 0;
+	texArrayDesc.Usage = D3D11_USAGE_DEFAULT;
+	texArrayDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+	texArrayDesc.CPUAccessFlags = 0;
+	texArrayDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;	// 允许从中创建TextureCube
+	return d3dDevice->CreateTexture2D(&texArrayDesc, initData.data(), textureArray);
+}
+
 HRESULT CreateWICTexture2DCubeFromFile(
 	ID3D11Device * d3dDevice,
 	ID3D11DeviceContext * d3dDeviceContext,
@@ -566,168 +1211,44 @@ HRESULT CreateWICTexture2DCubeFromFile(
 		return E_INVALIDARG;
 
 	// ******************
-	// 读取天空盒纹理
+	// 读取天空盒纹理到CPU可以直接访问的内存
 	//
 
-	ID3D11Texture2D* srcTex = nullptr;
-	ID3D11ShaderResourceView* srcTexSRV = nullptr;
-
-	// 该资源用于GPU复制
-	HRESULT hResult = CreateWICTextureFromFile(d3dDevice,
-		(generateMips ? d3dDeviceContext : nullptr),
-		cubeMapFileName.c_str(),
-		(ID3D11Resource**)&srcTex,
-		(generateMips ? &srcTexSRV : nullptr));
-
-	// 文件未打开
-	if (FAILED(hResult))
+	CpuImage image;
+	if (!image.Decode(cubeMapFileName))
 	{
-		return hResult;
-	}
-
-	D3D11_TEXTURE2D_DESC texDesc, texArrayDesc;
-	srcTex->GetDesc(&texDesc);
-
-	// 要求宽高比4:3
-	if (texDesc.Width * 3 != texDesc.Height * 4)
-	{
-		SAFE_RELEASE(srcTex);
-		SAFE_RELEASE(srcTexSRV);
-		return E_FAIL;
+		HRESULT hr = image.LoadStaging(d3dDevice, d3dDeviceContext, cubeMapFileName);
+		// 文件未打开
+		if (FAILED(hr))
+			return hr;
 	}
 
 	// ******************
-	// 创建包含6个纹理的数组
+	// 按宽高比识别十字或条带布局，按D3D11_TEXTURECUBE_FACE的顺序取出6个面
+	// 每个面直接引用位图中的区域(按位图的行距访问)，不需要先复制出来
 	//
 
-	UINT squareLength = texDesc.Width / 4;
-	texArrayDesc.Width = squareLength;
-	texArrayDesc.Height = squareLength;
-	texArrayDesc.MipLevels = (generateMips ? texDesc.MipLevels - 2 : 1);	// 立方体的mip等级比整张位图的少2
-	texArrayDesc.ArraySize = 6;
-	texArrayDesc.Format = texDesc.Format;
-	texArrayDesc.SampleDesc.Count = 1;
-	texArrayDesc.SampleDesc.Quality = 0;
-	texArrayDesc.Usage = D3D11_USAGE_DEFAULT;
-	texArrayDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-	texArrayDesc.CPUAccessFlags = 0;
-	texArrayDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;	// 允许从中创建TextureCube
+	CubeMapLayout::FaceView faces[6];
+	UINT squareLength = 0;
+	std::vector<uint8_t> scratch;
+	CubeMapLayout::Layout layout = CubeMapLayout::DetectLayout(image.width, image.height);
+	if (!CubeMapLayout::Split(image.data, image.width, image.height, image.rowPitch, layout, faces, squareLength, scratch))
+		return E_FAIL;
 
 	ID3D11Texture2D* texArray = nullptr;
-	hResult = d3dDevice->CreateTexture2D(&texArrayDesc, nullptr, &texArray);
+	HRESULT hResult = CreateTextureCubeFromFaces(d3dDevice, std::vector<CubeMapLayout::FaceView>(faces, faces + 6),
+		squareLength, image.format, image.srgb, generateMips, &texArray);
 	if (FAILED(hResult))
-	{
-		SAFE_RELEASE(srcTex);
-		SAFE_RELEASE(srcTexSRV);
 		return hResult;
-	}
-
-	// ******************
-	// 选取原天空盒纹理的6个子正方形区域，拷贝到该数组中
-	//
-
-	D3D11_BOX box;
-	// box坐标轴如下: 
-	//    front
-	//   / 
-	//  /_____right
-	//  |
-	//  |
-	//  bottom
-	box.front = 0;
-	box.back = 1;
-
-	for (UINT i = 0; i < texArrayDesc.MipLevels; ++i)
-	{
-		// +X面拷贝
-		box.left = squareLength * 2;
-		box.top = squareLength;
-		box.right = squareLength * 3;
-		box.bottom = squareLength * 2;
-		d3dDeviceContext->CopySubresourceRegion(
-			texArray,
-			D3D11CalcSubresource(i, D3D11_TEXTURECUBE_FACE_POSITIVE_X, texArrayDesc.MipLevels),
-			0, 0, 0,
-			srcTex,
-			i,
-			&box);
-
-		// -X面拷贝
-		box.left = 0;
-		box.top = squareLength;
-		box.right = squareLength;
-		box.bottom = squareLength * 2;
-		d3dDeviceContext->CopySubresourceRegion(
-			texArray,
-			D3D11CalcSubresource(i, D3D11_TEXTURECUBE_FACE_NEGATIVE_X, texArrayDesc.MipLevels),
-			0, 0, 0,
-			srcTex,
-			i,
-			&box);
-
-		// +Y面拷贝
-		box.left = squareLength;
-		box.top = 0;
-		box.right = squareLength * 2;
-		box.bottom = squareLength;
-		d3dDeviceContext->CopySubresourceRegion(
-			texArray,
-			D3D11CalcSubresource(i, D3D11_TEXTURECUBE_FACE_POSITIVE_Y, texArrayDesc.MipLevels),
-			0, 0, 0,
-			srcTex,
-			i,
-			&box);
-
-
-		// -Y面拷贝
-		box.left = squareLength;
-		box.top = squareLength * 2;
-		box.right = squareLength * 2;
-		box.bottom = squareLength * 3;
-		d3dDeviceContext->CopySubresourceRegion(
-			texArray,
-			D3D11CalcSubresource(i, D3D11_TEXTURECUBE_FACE_NEGATIVE_Y, texArrayDesc.MipLevels),
-			0, 0, 0,
-			srcTex,
-			i,
-			&box);
-
-		// +Z面拷贝
-		box.left = squareLength;
-		box.top = squareLength;
-		box.right = squareLength * 2;
-		box.bottom = squareLength * 2;
-		d3dDeviceContext->CopySubresourceRegion(
-			texArray,
-			D3D11CalcSubresource(i, D3D11_TEXTURECUBE_FACE_POSITIVE_Z, texArrayDesc.MipLevels),
-			0, 0, 0,
-			srcTex,
-			i,
-			&box);
-
-		// -Z面拷贝
-		box.left = squareLength * 3;
-		box.top = squareLength;
-		box.right = squareLength * 4;
-		box.bottom = squareLength * 2;
-		d3dDeviceContext->CopySubresourceRegion(
-			texArray,
-			D3D11CalcSubresource(i, D3D11_TEXTURECUBE_FACE_NEGATIVE_Z, texArrayDesc.MipLevels),
-			0, 0, 0,
-			srcTex,
-			i,
-			&box);
-
-		// 下一个mipLevel的纹理宽高都是原来的1/2
-		squareLength /= 2;
-	}
-
 
 	// ******************
 	// 创建立方体纹理的SRV
 	//
 	if (textureCubeView)
 	{
+		D3D11_TEXTURE2D_DESC texArrayDesc;
+		texArray->GetDesc(&texArrayDesc);
+
 		D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc;
 		viewDesc.Format = texArrayDesc.Format;
 		viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
@@ -747,9 +1268,6 @@ HRESULT CreateWICTexture2DCubeFromFile(
 		SAFE_RELEASE(texArray);
 	}
 
-	SAFE_RELEASE(srcTex);
-	SAFE_RELEASE(srcTexSRV);
-
 	return hResult;
 }
 
@@ -762,107 +1280,60 @@ HRESULT CreateWICTexture2DCubeFromFile(
 	bool generateMips)
 {
 	// 检查设备与设备上下文是否非空
-	// 文件名数目需要不小于6
+	// 文件名数目需要为6的倍数
 	// 纹理数组和资源视图只要有其中一个非空即可
 	UINT arraySize = (UINT)cubeMapFileNames.size();
 
-	if (!d3dDevice || !d3dDeviceContext || arraySize < 6 || !(textureArray || textureCubeView))
+	if (!d3dDevice || !d3dDeviceContext || arraySize < 6 || arraySize % 6 != 0 || !(textureArray || textureCubeView))
 		return E_INVALIDARG;
 
 	// ******************
-	// 读取纹理
+	// 读取各面的纹理，ImageReader能解码的文件在线程池中并行解码，其余经WIC读取到暂存资源
 	//
 
 	HRESULT hResult;
-	std::vector<ID3D11Texture2D*> srcTexVec(arraySize, nullptr);
-	std::vector<ID3D11ShaderResourceView*> srcTexSRVVec(arraySize, nullptr);
-	std::vector<D3D11_TEXTURE2D_DESC> texDescVec(arraySize);
+	std::vector<CpuImage> images(arraySize);
+	std::vector<char> decoded(arraySize);
+	ThreadPool::GetDefault().ParallelFor(arraySize, [&](size_t i) {
+		decoded[i] = images[i].Decode(cubeMapFileNames[i]);
+	});
 
+	std::vector<CubeMapLayout::FaceView> faces(arraySize);
 	for (UINT i = 0; i < arraySize; ++i)
 	{
-		// 该资源用于GPU复制
-		hResult = CreateWICTextureFromFile(d3dDevice,
-			(generateMips ? d3dDeviceContext : nullptr),
-			cubeMapFileNames[i].c_str(),
-			(ID3D11Resource**)&srcTexVec[i],
-			(generateMips ? &srcTexSRVVec[i] : nullptr));
-
-		// 文件未打开
-		if (hResult != S_OK)
-			return hResult;
-
-		// 读取创建好的纹理信息
-		srcTexVec[i]->GetDesc(&texDescVec[i]);
+		if (!decoded[i])
+		{
+			hResult = images[i].LoadStaging(d3dDevice, d3dDeviceContext, cubeMapFileNames[i]);
+			// 文件未打开
+			if (FAILED(hResult))
+				return hResult;
+		}
 
-		// 需要检验所有纹理的mipLevels，宽度和高度，数据格式是否一致，
+		// 需要检验所有纹理是否为同样宽高与数据格式的正方形，
 		// 若存在数据格式不一致的情况，请使用dxtex.exe(DirectX Texture Tool)
 		// 将所有的图片转成一致的数据格式
-		if (texDescVec[i].MipLevels != texDescVec[0].MipLevels || texDescVec[i].Width != texDescVec[0].Width ||
-			texDescVec[i].Height != texDescVec[0].Height || texDescVec[i].Format != texDescVec[0].Format)
-		{
-			for (UINT j = 0; j < i; ++j)
-			{
-				SAFE_RELEASE(srcTexVec[j]);
-				SAFE_RELEASE(srcTexSRVVec[j]);
-			}
+		if (images[i].width != images[i].height || images[i].width != images[0].width || images[i].format != images[0].format)
 			return E_FAIL;
-		}
+		faces[i] = { images[i].data, images[i].rowPitch };
 	}
 
 	// ******************
-	// 创建纹理数组
+	// 创建纹理数组，必要时在CPU上生成mip
 	//
-	D3D11_TEXTURE2D_DESC texArrayDesc;
-	texArrayDesc.Width = texDescVec[0].Width;
-	texArrayDesc.Height = texDescVec[0].Height;
-	texArrayDesc.MipLevels = (generateMips ? texDescVec[0].MipLevels : 1);
-	texArrayDesc.ArraySize = arraySize;
-	texArrayDesc.Format = texDescVec[0].Format;
-	texArrayDesc.SampleDesc.Count = 1;
-	texArrayDesc.SampleDesc.Quality = 0;
-	texArrayDesc.Usage = D3D11_USAGE_DEFAULT;
-	texArrayDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-	texArrayDesc.CPUAccessFlags = 0;
-	texArrayDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;	// 允许从中创建TextureCube
-
 	ID3D11Texture2D* texArray = nullptr;
-	hResult = d3dDevice->CreateTexture2D(&texArrayDesc, nullptr, &texArray);
-
+	hResult = CreateTextureCubeFromFaces(d3dDevice, faces, images[0].width, images[0].format, images[0].srgb,
+		generateMips, &texArray);
 	if (FAILED(hResult))
-	{
-		for (UINT i = 0; i < arraySize; ++i)
-		{
-			SAFE_RELEASE(srcTexVec[i]);
-			SAFE_RELEASE(srcTexSRVVec[i]);
-		}
-
 		return hResult;
-	}
-
-	// ******************
-	// 将原纹理的所有子资源拷贝到该数组中
-	//
-	texArray->GetDesc(&texArrayDesc);
-
-	for (UINT i = 0; i < arraySize; ++i)
-	{
-		for (UINT j = 0; j < texArrayDesc.MipLevels; ++j)
-		{
-			d3dDeviceContext->CopySubresourceRegion(
-				texArray,
-				D3D11CalcSubresource(j, i, texArrayDesc.MipLevels),
-				0, 0, 0,
-				srcTexVec[i],
-				j,
-				nullptr);
-		}
-	}
 
 	// ******************
 	// 创建立方体纹理的SRV
 	//
 	if (textureCubeView)
 	{
+		D3D11_TEXTURE2D_DESC texArrayDesc;
+		texArray->GetDesc(&texArrayDesc);
+
 		D3D11_SHADER_RESOURCE_VIEW_DESC viewDesc;
 		viewDesc.Format = texArrayDesc.Format;
 		viewDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
@@ -882,12 +1353,5 @@ HRESULT CreateWICTexture2DCubeFromFile(
 		SAFE_RELEASE(texArray);
 	}
 
-	// 释放所有资源
-	for (UINT i = 0; i < arraySize; ++i)
-	{
-		SAFE_RELEASE(srcTexVec[i]);
-		SAFE_RELEASE(srcTexSRVVec[i]);
-	}
-
 	return hResult;
 }
@@ -18,9 +18,11 @@
 #include <vector>
 #include <string>
 #include <random>
+#include <memory>
 #include "ScreenGrab.h"
 #include "DDSTextureLoader.h"	
 #include "WICTextureLoader.h"
+#include "DdsReader.h"
 
 //
 // 宏相关
@@ -190,6 +192,107 @@ HRESULT CreateShaderFromFile(
 	LPCSTR shaderModel,
 	ID3DBlob** ppBlobOut);
 
+//
+// 纹理相关函数
+//
+
+// ------------------------------
+// CreateTextureFromFile函数
+// ------------------------------
+// 根据扩展名选择DDS或WIC加载纹理，挂载了资源包(见AssetPackage)且包含该文件时直接从资源包的映射内存中创建
+// DDS纹理登记到默认的纹理预算(见TextureBudget)中，超出预算时跳过最大的几级mip
+// 其他格式的图像存在烘焙出的同名DDS(见BcEncoder)时改为加载该DDS
+// TGA、BMP与PNG由ImageReader直接解码为RGBA8，不经过WIC；其他格式使用WIC
+// [In]d3dDevice			D3D设备
+// [In]fileName				纹理文件名
+// [Out]textureView			输出的着色器资源视图
+HRESULT CreateTextureFromFile(
+	ID3D11Device * d3dDevice,
+	const wchar_t * fileName,
+	ID3D11ShaderResourceView ** textureView);
+
+// ------------------------------
+// CreateTextureFromMemory函数
+// ------------------------------
+// 从内存中的纹理文件数据创建纹理，根据fileName的扩展名选择DDS或其他图像格式
+// 其他格式优先由ImageReader解码(TGA、BMP、PNG)，无法识别或解码失败时使用WIC
+// [In]d3dDevice			D3D设备
+// [In]fileName				纹理文件名，仅用于判断格式
+// [In]data					纹理文件数据
+// [In]size					纹理文件字节数
+// [Out]textureView			输出的着色器资源视图
+HRESULT CreateTextureFromMemory(
+	ID3D11Device * d3dDevice,
+	const wchar_t * fileName,
+	const uint8_t * data,
+	size_t size,
+	ID3D11ShaderResourceView ** textureView);
+
+// ------------------------------
+// CreateTextureFromDds函数
+// ------------------------------
+// 从已解析的DDS文件(见DdsReader)创建纹理，子资源数据直接从解析时的输入数据上传
+// 支持一维、二维、三维纹理及其数组与立方体贴图(数组)
+// [In]d3dDevice			D3D设备
+// [In]reader				解析成功的DdsReader
+// [Out]textureView			输出的着色器资源视图
+// [In]skipMips				跳过最大的几级mip，至少保留最后一级
+HRESULT CreateTextureFromDds(
+	ID3D11Device * d3dDevice,
+	const DdsReader & reader,
+	ID3D11ShaderResourceView ** textureView,
+	UINT skipMips = 0);
+
+// ------------------------------
+// CreateStreamingTextureFromDds函数
+// ------------------------------
+// 为mip流式加载(见MipStreamer)创建纹理: 分配完整的mip链，只上传从firstMip开始的几级，
+// 并用SetResourceMinLOD把采样限制在已上传的mip上
+// [In]d3dDevice			D3D设备
+// [In]deviceContext		D3D设备上下文
+// [In]reader				解析成功的DdsReader
+// [In]firstMip				立即上传的第一级mip
+// [Out]textureView			输出的着色器资源视图
+HRESULT CreateStreamingTextureFromDds(
+	ID3D11Device * d3dDevice,
+	ID3D11DeviceContext * deviceContext,
+	const DdsReader & reader,
+	UINT firstMip,
+	ID3D11ShaderResourceView ** textureView);
+
+// ------------------------------
+// UpdateStreamingTextureMip函数
+// ------------------------------
+// 上传流式纹理的第mip级(所有数组元素)，并把采样的最高一级mip设为mip
+// [In]deviceContext		D3D设备上下文
+// [In]textureView			CreateStreamingTextureFromDds创建的视图
+// [In]reader				创建时使用的DdsReader
+// [In]mip					要上传的mip，需要比当前已上传的最高一级大一级
+void UpdateStreamingTextureMip(
+	ID3D11DeviceContext * deviceContext,
+	ID3D11ShaderResourceView * textureView,
+	const DdsReader & reader,
+	UINT mip);
+
+// ------------------------------
+// CreateTextureFromCache函数
+// ------------------------------
+// 通过默认的资源缓存(见ResourceCache)获取纹理，同一路径的纹理只创建一次
+// 缓存未命中时，data为nullptr则使用CreateTextureFromFile创建，否则使用CreateTextureFromMemory创建
+// [In]d3dDevice			D3D设备
+// [In]fileName				纹理文件名
+// [Out]textureView			输出的着色器资源视图，引用计数已增加
+// [Out]reference			纹理在缓存中的引用，指向该着色器资源视图，持有期间纹理不会被缓存淘汰
+// [In]data					已经读取的纹理文件数据(可选)
+// [In]size					纹理文件字节数
+HRESULT CreateTextureFromCache(
+	ID3D11Device * d3dDevice,
+	const wchar_t * fileName,
+	ID3D11ShaderResourceView ** textureView,
+	std::shared_ptr<void>& reference,
+	const uint8_t * data = nullptr,
+	size_t size = 0);
+
 //
 // 缓冲区相关函数
 //
@@ -330,10 +433,10 @@ HRESULT CreateRandomTexture1D(
 // 该函数要求所有纹理的宽高、数据格式、mip等级一致
 // [In]d3dDevice			D3D设备
 // [In]d3dDeviceContext		D3D设备上下文
-// [In]fileNames			dds文件名数组
+// [In]fileNames			dds或位图文件名数组
 // [OutOpt]textureArray		输出的纹理数组资源
 // [OutOpt]textureArrayView 输出的纹理数组资源视图
-// [In]generateMips			是否生成mipmaps
+// [In]generateMips			源纹理没有mip时是否在CPU上生成mipmaps(见MipGenerator)
 HRESULT CreateTexture2DArrayFromFile(
 	ID3D11Device* d3dDevice,
 	ID3D11DeviceContext* d3dDeviceContext,
@@ -351,16 +454,18 @@ HRESULT CreateTexture2DArrayFromFile(
 // CreateWICTexture2DCubeFromFile函数
 // ------------------------------
 // 根据给定的一张包含立方体六个面的位图，创建纹理立方体
-// 要求纹理宽高比为4:3，且按下面形式布局:
+// 按宽高比识别布局(见CubeMapLayout)，支持水平十字(4:3)、竖直十字(3:4)与按+X、-X、+Y、-Y、+Z、-Z排列的条带(6:1、1:6)
+// 水平十字按下面形式布局，竖直十字把-Z旋转180度后放在-Y的下方:
 // .  +Y .  .
 // -X +Z +X -Z 
 // .  -Y .  .
+// TGA、BMP与PNG由ImageReader解码，其他格式使用WIC；各面直接引用位图中的区域，纹理连同mip一次创建
 // [In]d3dDevice			D3D设备
 // [In]d3dDeviceContext		D3D设备上下文
 // [In]cubeMapFileName		位图文件名
 // [OutOpt]textureArray		输出的纹理数组资源
 // [OutOpt]textureCubeView	输出的纹理立方体资源视图
-// [In]generateMips			是否生成mipmaps
+// [In]generateMips			是否在CPU上生成mipmaps(见MipGenerator)
 HRESULT CreateWICTexture2DCubeFromFile(
 	ID3D11Device * d3dDevice,
 	ID3D11DeviceContext * d3dDeviceContext,
@@ -373,14 +478,14 @@ HRESULT CreateWICTexture2DCubeFromFile(
 // CreateWICTexture2DCubeFromFile函数
 // ------------------------------
 // 根据按D3D11_TEXTURECUBE_FACE索引顺序给定的六张纹理，创建纹理立方体
-// 要求位图是同样宽高、数据格式的正方形
-// 你也可以给定超过6张的纹理，然后在获取到纹理数组的基础上自行创建更多的资源视图
+// 要求位图是同样宽高、数据格式的正方形，ImageReader能解码的位图在线程池中并行解码
+// 你也可以给定6的倍数张纹理，然后在获取到纹理数组的基础上自行创建更多的资源视图
 // [In]d3dDevice			D3D设备
 // [In]d3dDeviceContext		D3D设备上下文
 // [In]cubeMapFileNames		位图文件名数组
 // [OutOpt]textureArray		输出的纹理数组资源
 // [OutOpt]textureCubeView	输出的纹理立方体资源视图
-// [In]generateMips			是否生成mipmaps
+// [In]generateMips			是否在CPU上生成mipmaps(见MipGenerator)
 HRESULT CreateWICTexture2DCubeFromFile(
 	ID3D11Device * d3dDevice,
 	ID3D11DeviceContext * d3dDeviceContext,